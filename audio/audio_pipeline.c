@@ -0,0 +1,367 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <retro_atomic.h>
+#include <retro_miscellaneous.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#include "audio_pipeline.h"
+
+/* The ring indices are published with memory barriers,
+ * without them there is no audio thread. */
+#if defined(HAVE_THREADS) && defined(HAVE_RETRO_ATOMIC)
+#define HAVE_AUDIO_PIPELINE_THREAD
+#endif
+
+#ifdef HAVE_AUDIO_PIPELINE_THREAD
+#include <rthreads/rthreads.h>
+
+struct audio_pipeline
+{
+   audio_pipeline_process_t process;
+   audio_pipeline_write_t write;
+   void *data;
+
+   sthread_t *thread;
+
+   /* Held by the audio thread while it runs the callbacks. */
+   slock_t *lock;
+
+   /* Only used to sleep and wake up, never to touch the ring. */
+   slock_t *cond_lock;
+   scond_t *data_cond;
+   scond_t *room_cond;
+
+   int16_t *samples;
+   size_t *counts;
+   bool *slowmotion;
+   size_t slot_samples;
+   size_t chunk_samples;
+   unsigned num_slots;
+
+   /* Chunks handed over and chunks written. Only the
+    * producer writes head, only the audio thread tail. */
+   volatile uint32_t head;
+   volatile uint32_t tail;
+   volatile uint32_t producer_waiting;
+   volatile uint32_t consumer_waiting;
+   volatile bool die;
+
+   /* Producer side: the slot at head while it is filled. */
+   bool filling;
+   bool fill_slowmotion;
+   size_t fill;
+
+   audio_pipeline_stats_t stats;
+};
+
+static void audio_pipeline_thread(void *data)
+{
+   audio_pipeline_t *pipeline = (audio_pipeline_t*)data;
+
+   for (;;)
+   {
+      const void *output = NULL;
+      size_t output_size;
+      retro_time_t start, processed, written;
+      uint32_t tail      = pipeline->tail;
+      unsigned slot;
+
+      if (pipeline->head == tail)
+      {
+         bool die;
+
+         /* Announce the wait before checking again, so that a
+          * chunk handed over in between always wakes us up. */
+         slock_lock(pipeline->cond_lock);
+         pipeline->consumer_waiting = 1;
+         RETRO_ATOMIC_BARRIER();
+         while (pipeline->head == tail && !pipeline->die)
+            scond_wait(pipeline->data_cond, pipeline->cond_lock);
+         pipeline->consumer_waiting = 0;
+         die = pipeline->head == tail;
+         slock_unlock(pipeline->cond_lock);
+
+         if (die)
+            break;
+      }
+
+      /* Don't read the chunk before its index. */
+      RETRO_ATOMIC_BARRIER();
+
+      slot        = tail % pipeline->num_slots;
+
+      slock_lock(pipeline->lock);
+      start       = cpu_features_get_time_usec();
+      output_size = pipeline->process(pipeline->data,
+            pipeline->samples + slot * pipeline->slot_samples,
+            pipeline->counts[slot], pipeline->slowmotion[slot], &output);
+      processed   = cpu_features_get_time_usec();
+      if (output_size)
+         pipeline->write(pipeline->data, output, output_size);
+      written     = cpu_features_get_time_usec();
+      slock_unlock(pipeline->lock);
+
+      pipeline->stats.chunks++;
+      pipeline->stats.process_usec += processed - start;
+      pipeline->stats.write_usec   += written - processed;
+
+      /* Done with the slot, give it back. */
+      RETRO_ATOMIC_BARRIER();
+      pipeline->tail = tail + 1;
+      RETRO_ATOMIC_BARRIER();
+
+      if (pipeline->producer_waiting)
+      {
+         slock_lock(pipeline->cond_lock);
+         scond_signal(pipeline->room_cond);
+         slock_unlock(pipeline->cond_lock);
+      }
+   }
+}
+
+/* Waits until at least @slots_free slots of the ring are free. */
+static void audio_pipeline_wait(audio_pipeline_t *pipeline,
+      unsigned slots_free)
+{
+   slock_lock(pipeline->cond_lock);
+   pipeline->producer_waiting = 1;
+   RETRO_ATOMIC_BARRIER();
+   while (pipeline->head - pipeline->tail > pipeline->num_slots - slots_free)
+      scond_wait(pipeline->room_cond, pipeline->cond_lock);
+   pipeline->producer_waiting = 0;
+   slock_unlock(pipeline->cond_lock);
+}
+
+static void audio_pipeline_publish(audio_pipeline_t *pipeline)
+{
+   unsigned slot                = pipeline->head % pipeline->num_slots;
+
+   pipeline->counts[slot]       = pipeline->fill;
+   pipeline->slowmotion[slot]   = pipeline->fill_slowmotion;
+   pipeline->filling            = false;
+
+   /* The chunk has to be visible before its index. */
+   RETRO_ATOMIC_BARRIER();
+   pipeline->head               = pipeline->head + 1;
+   RETRO_ATOMIC_BARRIER();
+
+   if (pipeline->consumer_waiting)
+   {
+      slock_lock(pipeline->cond_lock);
+      scond_signal(pipeline->data_cond);
+      slock_unlock(pipeline->cond_lock);
+   }
+}
+
+audio_pipeline_t *audio_pipeline_new(size_t slot_samples,
+      size_t chunk_samples, unsigned num_slots,
+      audio_pipeline_process_t process, audio_pipeline_write_t write_cb,
+      void *data)
+{
+   audio_pipeline_t *pipeline = NULL;
+
+   if (!process || !write_cb || !slot_samples || num_slots < 2)
+      return NULL;
+
+   pipeline                = (audio_pipeline_t*)calloc(1, sizeof(*pipeline));
+   if (!pipeline)
+      return NULL;
+
+   pipeline->process       = process;
+   pipeline->write         = write_cb;
+   pipeline->data          = data;
+   pipeline->slot_samples  = slot_samples;
+   pipeline->chunk_samples = MIN(MAX(chunk_samples, 1), slot_samples);
+   pipeline->num_slots     = num_slots;
+
+   pipeline->samples       = (int16_t*)malloc(
+         num_slots * slot_samples * sizeof(*pipeline->samples));
+   pipeline->counts        = (size_t*)calloc(num_slots,
+         sizeof(*pipeline->counts));
+   pipeline->slowmotion    = (bool*)calloc(num_slots,
+         sizeof(*pipeline->slowmotion));
+
+   if (!pipeline->samples || !pipeline->counts || !pipeline->slowmotion)
+      goto error;
+
+   if (!(pipeline->lock      = slock_new()))
+      goto error;
+   if (!(pipeline->cond_lock = slock_new()))
+      goto error;
+   if (!(pipeline->data_cond = scond_new()))
+      goto error;
+   if (!(pipeline->room_cond = scond_new()))
+      goto error;
+
+   if (!(pipeline->thread    = sthread_create(
+               audio_pipeline_thread, pipeline)))
+      goto error;
+
+   return pipeline;
+
+error:
+   audio_pipeline_free(pipeline);
+   return NULL;
+}
+
+void audio_pipeline_free(audio_pipeline_t *pipeline)
+{
+   if (!pipeline)
+      return;
+
+   if (pipeline->thread)
+   {
+      audio_pipeline_flush(pipeline);
+
+      slock_lock(pipeline->cond_lock);
+      pipeline->die = true;
+      scond_signal(pipeline->data_cond);
+      slock_unlock(pipeline->cond_lock);
+
+      sthread_join(pipeline->thread);
+   }
+
+   if (pipeline->lock)
+      slock_free(pipeline->lock);
+   if (pipeline->cond_lock)
+      slock_free(pipeline->cond_lock);
+   if (pipeline->data_cond)
+      scond_free(pipeline->data_cond);
+   if (pipeline->room_cond)
+      scond_free(pipeline->room_cond);
+
+   free(pipeline->samples);
+   free(pipeline->counts);
+   free(pipeline->slowmotion);
+   free(pipeline);
+}
+
+void audio_pipeline_push(audio_pipeline_t *pipeline,
+      const int16_t *samples, size_t count,
+      bool is_slowmotion, bool block)
+{
+   retro_time_t start = cpu_features_get_time_usec();
+
+   while (count)
+   {
+      size_t len;
+      int16_t *dst;
+
+      if (pipeline->filling && (pipeline->fill == pipeline->slot_samples
+               || pipeline->fill_slowmotion != is_slowmotion))
+         audio_pipeline_publish(pipeline);
+
+      if (!pipeline->filling)
+      {
+         /* The slot at head must not be in use by the audio thread. */
+         if (pipeline->head - pipeline->tail >= pipeline->num_slots)
+         {
+            retro_time_t wait_start;
+
+            if (!block)
+            {
+               pipeline->stats.dropped_samples += count;
+               break;
+            }
+
+            wait_start = cpu_features_get_time_usec();
+            audio_pipeline_wait(pipeline, 1);
+            pipeline->stats.wait_usec += cpu_features_get_time_usec()
+               - wait_start;
+         }
+
+         /* Don't write the slot before the audio thread is done. */
+         RETRO_ATOMIC_BARRIER();
+
+         pipeline->filling         = true;
+         pipeline->fill_slowmotion = is_slowmotion;
+         pipeline->fill            = 0;
+      }
+
+      dst             = pipeline->samples
+         + (pipeline->head % pipeline->num_slots) * pipeline->slot_samples;
+      len             = MIN(count, pipeline->slot_samples - pipeline->fill);
+
+      memcpy(dst + pipeline->fill, samples, len * sizeof(*samples));
+      pipeline->fill += len;
+      samples        += len;
+      count          -= len;
+
+      if (pipeline->fill >= pipeline->chunk_samples)
+         audio_pipeline_publish(pipeline);
+   }
+
+   pipeline->stats.pushes++;
+   pipeline->stats.push_usec += cpu_features_get_time_usec() - start;
+}
+
+void audio_pipeline_flush(audio_pipeline_t *pipeline)
+{
+   if (pipeline->filling && pipeline->fill)
+      audio_pipeline_publish(pipeline);
+   pipeline->filling = false;
+
+   audio_pipeline_wait(pipeline, pipeline->num_slots);
+}
+
+void audio_pipeline_lock(audio_pipeline_t *pipeline)
+{
+   slock_lock(pipeline->lock);
+}
+
+void audio_pipeline_unlock(audio_pipeline_t *pipeline)
+{
+   slock_unlock(pipeline->lock);
+}
+
+void audio_pipeline_get_stats(audio_pipeline_t *pipeline,
+      audio_pipeline_stats_t *stats)
+{
+   *stats = pipeline->stats;
+}
+#else
+audio_pipeline_t *audio_pipeline_new(size_t slot_samples,
+      size_t chunk_samples, unsigned num_slots,
+      audio_pipeline_process_t process, audio_pipeline_write_t write_cb,
+      void *data)
+{
+   return NULL;
+}
+
+void audio_pipeline_free(audio_pipeline_t *pipeline) { }
+
+void audio_pipeline_push(audio_pipeline_t *pipeline,
+      const int16_t *samples, size_t count,
+      bool is_slowmotion, bool block) { }
+
+void audio_pipeline_flush(audio_pipeline_t *pipeline) { }
+void audio_pipeline_lock(audio_pipeline_t *pipeline) { }
+void audio_pipeline_unlock(audio_pipeline_t *pipeline) { }
+
+void audio_pipeline_get_stats(audio_pipeline_t *pipeline,
+      audio_pipeline_stats_t *stats)
+{
+   memset(stats, 0, sizeof(*stats));
+}
+#endif
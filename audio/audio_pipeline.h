@@ -0,0 +1,157 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RARCH_AUDIO_PIPELINE_H__
+#define RARCH_AUDIO_PIPELINE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+typedef struct audio_pipeline audio_pipeline_t;
+
+/**
+ * audio_pipeline_process_t:
+ * @data         : Userdata passed to audio_pipeline_new().
+ * @samples      : Interleaved stereo samples of one chunk.
+ * @count        : Amount of samples (not frames) in @samples.
+ * @is_slowmotion: Whether the chunk was produced in slow motion.
+ * @output       : Set to the data to pass to the write callback.
+ *
+ * Runs the conversion, DSP, resampling and mixing chain.
+ *
+ * Returns: size of @output in bytes.
+ **/
+typedef size_t (*audio_pipeline_process_t)(void *data,
+      const int16_t *samples, size_t count, bool is_slowmotion,
+      const void **output);
+
+/**
+ * audio_pipeline_write_t:
+ * @data         : Userdata passed to audio_pipeline_new().
+ * @output       : Output of the process callback.
+ * @size         : Size of @output in bytes.
+ *
+ * Hands a processed chunk to the audio driver.
+ **/
+typedef void (*audio_pipeline_write_t)(void *data,
+      const void *output, size_t size);
+
+typedef struct audio_pipeline_stats
+{
+   /* Updated by the audio thread. */
+   uint64_t chunks;
+   uint64_t process_usec;
+   uint64_t write_usec;
+
+   /* Updated by the thread calling audio_pipeline_push(). */
+   uint64_t pushes;
+   uint64_t push_usec;
+   uint64_t wait_usec;
+   uint64_t dropped_samples;
+} audio_pipeline_stats_t;
+
+/**
+ * audio_pipeline_new:
+ * @slot_samples : Most samples a single chunk can hold,
+ *                 the process callback never gets more.
+ * @chunk_samples: Samples a chunk is handed over at. Smaller
+ *                 pushes are gathered until they reach it.
+ * @num_slots    : Chunks the ring holds, including the one
+ *                 being filled and the one being processed.
+ * @process      : Runs the processing chain of a chunk.
+ * @write_cb     : Writes a processed chunk.
+ * @data         : Userdata passed to the callbacks.
+ *
+ * Starts a thread which runs @process and @write_cb for every
+ * chunk pushed with audio_pipeline_push(). Samples go through
+ * a single producer, single consumer ring, so pushing never
+ * takes a lock unless the ring is full or the audio thread
+ * has gone to sleep.
+ *
+ * Returns: the pipeline, or NULL if threads or atomics are not
+ * available, in which case the caller should process chunks
+ * itself.
+ **/
+audio_pipeline_t *audio_pipeline_new(size_t slot_samples,
+      size_t chunk_samples, unsigned num_slots,
+      audio_pipeline_process_t process, audio_pipeline_write_t write_cb,
+      void *data);
+
+/**
+ * audio_pipeline_free:
+ * @pipeline     : The pipeline.
+ *
+ * Processes the samples still queued and stops the thread.
+ **/
+void audio_pipeline_free(audio_pipeline_t *pipeline);
+
+/**
+ * audio_pipeline_push:
+ * @pipeline     : The pipeline.
+ * @samples      : Interleaved stereo samples.
+ * @count        : Amount of samples (not frames).
+ * @is_slowmotion: Whether the samples were produced in slow motion.
+ * @block        : Wait for the audio thread if the ring is full,
+ *                 otherwise the samples which don't fit are dropped.
+ *
+ * Queues samples for the audio thread. Must always be called
+ * from the same thread.
+ **/
+void audio_pipeline_push(audio_pipeline_t *pipeline,
+      const int16_t *samples, size_t count,
+      bool is_slowmotion, bool block);
+
+/**
+ * audio_pipeline_flush:
+ * @pipeline     : The pipeline.
+ *
+ * Hands over a partially filled chunk and waits until the
+ * audio thread has written every queued chunk. Must be called
+ * from the thread calling audio_pipeline_push().
+ **/
+void audio_pipeline_flush(audio_pipeline_t *pipeline);
+
+/**
+ * audio_pipeline_lock:
+ * @pipeline     : The pipeline.
+ *
+ * The audio thread holds this lock while it runs the callbacks
+ * of a chunk. Take it before changing state they use, such as
+ * the DSP filter, mixer streams or the driver's blocking state.
+ **/
+void audio_pipeline_lock(audio_pipeline_t *pipeline);
+
+void audio_pipeline_unlock(audio_pipeline_t *pipeline);
+
+/**
+ * audio_pipeline_get_stats:
+ * @pipeline     : The pipeline.
+ * @stats        : Filled with the counters so far.
+ *
+ * Counters of the audio thread are only exact after
+ * audio_pipeline_flush().
+ **/
+void audio_pipeline_get_stats(audio_pipeline_t *pipeline,
+      audio_pipeline_stats_t *stats);
+
+RETRO_END_DECLS
+
+#endif
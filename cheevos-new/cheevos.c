@@ -130,6 +130,8 @@ typedef struct
    rcheevos_lboard_t* lboards;
 
    rcheevos_fixups_t fixups;
+   rcheevos_memrefs_t memrefs;
+   uint32_t memory_key;
 
    char token[32];
 } rcheevos_locals_t;
@@ -164,6 +166,8 @@ static rcheevos_locals_t rcheevos_locals =
    NULL, /* unofficial */
    NULL, /* lboards */
    {0},  /* fixups */
+   {0},  /* memrefs */
+   0,    /* memory_key */
    {0},  /* token */
 };
 
@@ -381,6 +385,7 @@ static int rcheevos_parse(const char* json)
    rcheevos_racheevo_t* rac  = NULL;
 
    rcheevos_fixup_init(&rcheevos_locals.fixups);
+   rcheevos_memrefs_init(&rcheevos_locals.memrefs);
 
    res = rcheevos_get_patchdata(json, &rcheevos_locals.patchdata);
 
@@ -523,6 +528,7 @@ error:
    CHEEVOS_FREE(rcheevos_locals.lboards);
    rcheevos_free_patchdata(&rcheevos_locals.patchdata);
    rcheevos_fixup_destroy(&rcheevos_locals.fixups);
+   rcheevos_memrefs_destroy(&rcheevos_locals.memrefs);
    return -1;
 }
 
@@ -654,10 +660,15 @@ static void rcheevos_award(rcheevos_cheevo_t* cheevo, int mode)
 
 static unsigned rcheevos_peek(unsigned address, unsigned num_bytes, void* ud)
 {
-   const uint8_t* data = rcheevos_fixup_find(&rcheevos_locals.fixups,
-      address, rcheevos_locals.patchdata.console_id);
+   const uint8_t* data = rcheevos_memrefs_find(&rcheevos_locals.memrefs,
+      address, num_bytes);
    unsigned value = 0;
 
+   /* Addresses computed at runtime aren't in the snapshot. */
+   if (!data)
+      data = rcheevos_fixup_find(&rcheevos_locals.fixups,
+         address, rcheevos_locals.patchdata.console_id);
+
    if (data)
    {
       switch (num_bytes)
@@ -742,6 +753,7 @@ static void rcheevos_test_cheevo_set(bool official)
                   /* clear out the trigger so it shows up as 'Unsupported' in the menu */
                   CHEEVOS_FREE(cheevo->trigger);
                   cheevo->trigger = NULL;
+                  rcheevos_locals.memrefs.dirty = true;
 
                   continue;
                }
@@ -1109,6 +1121,7 @@ bool rcheevos_unload(void)
       CHEEVOS_FREE(rcheevos_locals.lboards);
       rcheevos_free_patchdata(&rcheevos_locals.patchdata);
       rcheevos_fixup_destroy(&rcheevos_locals.fixups);
+      rcheevos_memrefs_destroy(&rcheevos_locals.memrefs);
 
       rcheevos_locals.core       = NULL;
       rcheevos_locals.unofficial = NULL;
@@ -1159,10 +1172,61 @@ bool rcheevos_toggle_hardcore_mode(void)
    return true;
 }
 
+static void rcheevos_update_memrefs(void)
+{
+   rcheevos_memrefs_t* memrefs = &rcheevos_locals.memrefs;
+   uint32_t memory_key         = rcheevos_memory_key();
+
+   if (memory_key != rcheevos_locals.memory_key)
+   {
+      /* The core moved its memory, every resolved address is stale. */
+      rcheevos_fixup_destroy(&rcheevos_locals.fixups);
+      rcheevos_locals.memory_key = memory_key;
+      memrefs->dirty             = true;
+   }
+
+   if (memrefs->dirty)
+   {
+      unsigned i, count;
+      const rcheevos_cheevo_t* cheevo;
+      const rcheevos_lboard_t* lboard;
+
+      memrefs->count = 0;
+
+      cheevo = rcheevos_locals.core;
+      for (i = 0, count = rcheevos_locals.patchdata.core_count; i < count; i++, cheevo++)
+      {
+         if (cheevo->trigger)
+            rcheevos_memrefs_add(memrefs, cheevo->trigger->memrefs);
+      }
+
+      cheevo = rcheevos_locals.unofficial;
+      for (i = 0, count = rcheevos_locals.patchdata.unofficial_count; i < count; i++, cheevo++)
+      {
+         if (cheevo->trigger)
+            rcheevos_memrefs_add(memrefs, cheevo->trigger->memrefs);
+      }
+
+      lboard = rcheevos_locals.lboards;
+      for (i = 0, count = rcheevos_locals.patchdata.lboard_count; i < count; i++, lboard++)
+      {
+         if (lboard->lboard)
+            rcheevos_memrefs_add(memrefs, lboard->lboard->memrefs);
+      }
+
+      rcheevos_memrefs_resolve(memrefs, &rcheevos_locals.fixups,
+            rcheevos_locals.patchdata.console_id);
+   }
+
+   rcheevos_memrefs_snapshot(memrefs);
+}
+
 void rcheevos_test(void)
 {
    settings_t *settings = config_get_ptr();
 
+   rcheevos_update_memrefs();
+
    rcheevos_test_cheevo_set(true);
 
    if (settings)
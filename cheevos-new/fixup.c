@@ -13,6 +13,9 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "fixup.h"
 #include "cheevos.h"
 #include "util.h"
@@ -286,3 +289,282 @@ const uint8_t* rcheevos_patch_address(unsigned address, int console)
 
    return (const uint8_t*)pointer + address;
 }
+
+uint32_t rcheevos_memory_key(void)
+{
+   rarch_system_info_t* system = runloop_get_system_info();
+   uint32_t key = 2166136261U;
+   unsigned i;
+
+#define RCHEEVOS_KEY_MIX(value) \
+   do { key = (key ^ (uint32_t)(value)) * 16777619U; } while (0)
+
+   if (system->mmaps.num_descriptors != 0)
+   {
+      for (i = 0; i < system->mmaps.num_descriptors; i++)
+      {
+         const rarch_memory_descriptor_t* desc = &system->mmaps.descriptors[i];
+
+         RCHEEVOS_KEY_MIX((uintptr_t)desc->core.ptr);
+         RCHEEVOS_KEY_MIX(desc->core.start);
+         RCHEEVOS_KEY_MIX(desc->core.len);
+      }
+   }
+   else
+   {
+      static const unsigned ids[] =
+      {
+         RETRO_MEMORY_SYSTEM_RAM, RETRO_MEMORY_SAVE_RAM,
+         RETRO_MEMORY_VIDEO_RAM, RETRO_MEMORY_RTC
+      };
+
+      for (i = 0; i < sizeof(ids) / sizeof(ids[0]); i++)
+      {
+         retro_ctx_memory_info_t meminfo;
+
+         meminfo.id = ids[i];
+         core_get_memory(&meminfo);
+
+         RCHEEVOS_KEY_MIX((uintptr_t)meminfo.data);
+         RCHEEVOS_KEY_MIX(meminfo.size);
+      }
+   }
+
+#undef RCHEEVOS_KEY_MIX
+
+   return key;
+}
+
+static unsigned rcheevos_memref_hash(unsigned address, unsigned mask)
+{
+   address ^= address >> 16;
+   address *= 0x45d9f3bU;
+   address ^= address >> 16;
+
+   return address & mask;
+}
+
+static int rcheevos_cmpslot(const void* e1, const void* e2)
+{
+   const rcheevos_memref_slot_t* s1 = (const rcheevos_memref_slot_t*)e1;
+   const rcheevos_memref_slot_t* s2 = (const rcheevos_memref_slot_t*)e2;
+
+   if (s1->address < s2->address)
+   {
+      return -1;
+   }
+   else if (s1->address > s2->address)
+   {
+      return 1;
+   }
+   else
+   {
+      return 0;
+   }
+}
+
+void rcheevos_memrefs_init(rcheevos_memrefs_t* memrefs)
+{
+   memrefs->slots = NULL;
+   memrefs->capacity = memrefs->count = 0;
+   memrefs->buckets = NULL;
+   memrefs->bucket_mask = 0;
+   memrefs->snapshot = NULL;
+   memrefs->dirty = true;
+}
+
+void rcheevos_memrefs_destroy(rcheevos_memrefs_t* memrefs)
+{
+   CHEEVOS_FREE(memrefs->slots);
+   CHEEVOS_FREE(memrefs->buckets);
+   CHEEVOS_FREE(memrefs->snapshot);
+   rcheevos_memrefs_init(memrefs);
+}
+
+static void rcheevos_memrefs_push(rcheevos_memrefs_t* memrefs, unsigned address, unsigned num_bytes)
+{
+   rcheevos_memref_slot_t* slot;
+
+   if (memrefs->count == memrefs->capacity)
+   {
+      unsigned new_capacity = memrefs->capacity == 0 ? 64 : memrefs->capacity * 2;
+      rcheevos_memref_slot_t* new_slots = (rcheevos_memref_slot_t*)
+         realloc(memrefs->slots, new_capacity * sizeof(rcheevos_memref_slot_t));
+
+      if (new_slots == NULL)
+      {
+         return;
+      }
+
+      memrefs->slots = new_slots;
+      memrefs->capacity = new_capacity;
+   }
+
+   slot = memrefs->slots + memrefs->count++;
+   slot->address = address;
+   slot->num_bytes = num_bytes;
+   slot->offset = 0;
+   slot->location = NULL;
+}
+
+void rcheevos_memrefs_add(rcheevos_memrefs_t* memrefs, const rc_memref_value_t* memref)
+{
+   for (; memref != NULL; memref = memref->next)
+   {
+      unsigned num_bytes;
+
+      switch (memref->memref.size)
+      {
+         case RC_MEMSIZE_16_BITS:
+            num_bytes = 2;
+            break;
+         case RC_MEMSIZE_24_BITS:
+         case RC_MEMSIZE_32_BITS:
+            num_bytes = 4;
+            break;
+         default:
+            num_bytes = 1;
+            break;
+      }
+
+      rcheevos_memrefs_push(memrefs, memref->memref.address, num_bytes);
+
+      /* The entry following an indirect reference holds the dereferenced
+       * address, which changes at runtime and is read from live memory. */
+      if (memref->memref.is_indirect && memref->next != NULL)
+      {
+         memref = memref->next;
+      }
+   }
+}
+
+bool rcheevos_memrefs_resolve(rcheevos_memrefs_t* memrefs, rcheevos_fixups_t* fixups, int console)
+{
+   unsigned i, count, num_buckets, size;
+
+   CHEEVOS_FREE(memrefs->buckets);
+   CHEEVOS_FREE(memrefs->snapshot);
+   memrefs->buckets = NULL;
+   memrefs->snapshot = NULL;
+   memrefs->bucket_mask = 0;
+   memrefs->dirty = false;
+
+   if (memrefs->count == 0)
+   {
+      return true;
+   }
+
+   /* Merge references to the same address, keeping the widest read. */
+   qsort(memrefs->slots, memrefs->count, sizeof(rcheevos_memref_slot_t), rcheevos_cmpslot);
+
+   for (i = 1, count = 1; i < memrefs->count; i++)
+   {
+      rcheevos_memref_slot_t* last = memrefs->slots + count - 1;
+
+      if (memrefs->slots[i].address == last->address)
+      {
+         if (memrefs->slots[i].num_bytes > last->num_bytes)
+         {
+            last->num_bytes = memrefs->slots[i].num_bytes;
+         }
+      }
+      else
+      {
+         memrefs->slots[count++] = memrefs->slots[i];
+      }
+   }
+
+   memrefs->count = count;
+
+   for (i = 0, size = 0; i < count; i++)
+   {
+      memrefs->slots[i].offset = size;
+      memrefs->slots[i].location = rcheevos_fixup_find(fixups, memrefs->slots[i].address, console);
+      size += memrefs->slots[i].num_bytes;
+   }
+
+   for (num_buckets = 16; num_buckets < count * 2; num_buckets *= 2)
+   {
+      /* nothing */
+   }
+
+   memrefs->snapshot = (uint8_t*)calloc(1, size);
+   memrefs->buckets = (unsigned*)calloc(num_buckets, sizeof(unsigned));
+
+   if (memrefs->snapshot == NULL || memrefs->buckets == NULL)
+   {
+      CHEEVOS_FREE(memrefs->buckets);
+      CHEEVOS_FREE(memrefs->snapshot);
+      memrefs->buckets = NULL;
+      memrefs->snapshot = NULL;
+      return false;
+   }
+
+   memrefs->bucket_mask = num_buckets - 1;
+
+   for (i = 0; i < count; i++)
+   {
+      unsigned bucket = rcheevos_memref_hash(memrefs->slots[i].address, memrefs->bucket_mask);
+
+      while (memrefs->buckets[bucket] != 0)
+      {
+         bucket = (bucket + 1) & memrefs->bucket_mask;
+      }
+
+      memrefs->buckets[bucket] = i + 1;
+   }
+
+   CHEEVOS_LOG(RCHEEVOS_TAG "resolved %u memory references into a %u byte snapshot\n", count, size);
+   return true;
+}
+
+void rcheevos_memrefs_snapshot(rcheevos_memrefs_t* memrefs)
+{
+   const rcheevos_memref_slot_t* slot = memrefs->slots;
+   const rcheevos_memref_slot_t* end  = slot + memrefs->count;
+   uint8_t* snapshot = memrefs->snapshot;
+
+   if (snapshot == NULL)
+   {
+      return;
+   }
+
+   for (; slot < end; slot++)
+   {
+      if (slot->location != NULL)
+      {
+         memcpy(snapshot + slot->offset, slot->location, slot->num_bytes);
+      }
+   }
+}
+
+const uint8_t* rcheevos_memrefs_find(const rcheevos_memrefs_t* memrefs, unsigned address, unsigned num_bytes)
+{
+   unsigned bucket, index;
+
+   if (memrefs->buckets == NULL)
+   {
+      return NULL;
+   }
+
+   bucket = rcheevos_memref_hash(address, memrefs->bucket_mask);
+
+   while ((index = memrefs->buckets[bucket]) != 0)
+   {
+      const rcheevos_memref_slot_t* slot = memrefs->slots + index - 1;
+
+      if (slot->address == address)
+      {
+         if (slot->location == NULL || num_bytes > slot->num_bytes)
+         {
+            return NULL;
+         }
+
+         return memrefs->snapshot + slot->offset;
+      }
+
+      bucket = (bucket + 1) & memrefs->bucket_mask;
+   }
+
+   return NULL;
+}
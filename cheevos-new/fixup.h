@@ -43,6 +43,48 @@ const uint8_t* rcheevos_fixup_find(rcheevos_fixups_t* fixups, unsigned address,
 
 const uint8_t* rcheevos_patch_address(unsigned address, int console);
 
+/* Changes whenever the core exposes its memory at different locations,
+ * which makes every pointer returned above stale. */
+uint32_t rcheevos_memory_key(void);
+
+/* Table of the memory references used by the loaded achievements and
+ * leaderboards, resolved to host pointers once and copied into a dense
+ * snapshot every frame so the evaluation reads from a single buffer. */
+struct rc_memref_value_t;
+
+typedef struct
+{
+   unsigned address;
+   unsigned num_bytes;
+   unsigned offset;
+   const uint8_t* location;
+} rcheevos_memref_slot_t;
+
+typedef struct
+{
+   rcheevos_memref_slot_t* slots;
+   unsigned capacity, count;
+   unsigned* buckets;
+   unsigned bucket_mask;
+   uint8_t* snapshot;
+   bool dirty;
+} rcheevos_memrefs_t;
+
+void rcheevos_memrefs_init(rcheevos_memrefs_t* memrefs);
+void rcheevos_memrefs_destroy(rcheevos_memrefs_t* memrefs);
+
+/* Collects the direct references of a rcheevos memref list. */
+void rcheevos_memrefs_add(rcheevos_memrefs_t* memrefs, const struct rc_memref_value_t* memref);
+
+/* Merges the collected references and resolves them through the fixups. */
+bool rcheevos_memrefs_resolve(rcheevos_memrefs_t* memrefs, rcheevos_fixups_t* fixups, int console);
+
+void rcheevos_memrefs_snapshot(rcheevos_memrefs_t* memrefs);
+
+/* Returns the snapshot bytes for the address, or NULL if the address isn't
+ * in the table and has to be read from the live memory instead. */
+const uint8_t* rcheevos_memrefs_find(const rcheevos_memrefs_t* memrefs, unsigned address, unsigned num_bytes);
+
 RETRO_END_DECLS
 
 #endif
@@ -312,6 +312,9 @@
 #define DEFAULT_THREADED_DATA_RUNLOOP_ENABLE false
 #endif
 
+/* Number of worker threads used by the threaded task queue. */
+#define DEFAULT_THREADED_DATA_RUNLOOP_WORKERS 1
+
 /* Set to true if HW render cores should get their private context. */
 #define DEFAULT_VIDEO_SHARED_CONTEXT false
 
@@ -747,6 +750,11 @@ static const bool audio_enable_menu_bgm    = false;
 /* Will sync audio. (recommended) */
 #define DEFAULT_AUDIO_SYNC true
 
+/* Converts, filters, resamples and mixes audio on a
+ * thread of its own instead of the emulation thread.
+ * Adds up to two chunks of latency. */
+#define DEFAULT_AUDIO_PIPELINE_THREAD false
+
 /* Audio rate control. */
 #if !defined(RARCH_CONSOLE)
 #define DEFAULT_RATE_CONTROL true
@@ -854,6 +862,10 @@ static const unsigned netplay_delay_frames = 16;
 
 static const int netplay_check_frames = 600;
 
+/* Snapshot the core for rollback only every few frames,
+ * as often as pays off, and replay from the last one. */
+static const bool netplay_sparse_snapshots = false;
+
 static const bool netplay_use_mitm_server = false;
 
 static const char *netplay_mitm_server = "nyc";
@@ -121,6 +121,7 @@ typedef struct settings
       bool audio_enable_menu_notice;
       bool audio_enable_menu_bgm;
       bool audio_sync;
+      bool audio_pipeline_thread;
       bool audio_rate_control;
       bool audio_wasapi_exclusive_mode;
       bool audio_wasapi_float_format;
@@ -269,6 +270,7 @@ typedef struct settings
       bool netplay_stateless_mode;
       bool netplay_nat_traversal;
       bool netplay_use_mitm_server;
+      bool netplay_sparse_snapshots;
       bool netplay_request_devices[MAX_USERS];
 
       /* Network */
@@ -488,6 +490,7 @@ typedef struct settings
       unsigned rewind_granularity;
       unsigned rewind_buffer_size_step;
       unsigned autosave_interval;
+      unsigned threaded_data_runloop_workers;
       unsigned network_cmd_port;
       unsigned network_remote_base_port;
       unsigned keymapper_port;
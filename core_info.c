@@ -15,6 +15,9 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stddef.h>
+#include <sys/stat.h>
+
 #include <compat/strl.h>
 #include <string/stdstring.h>
 #include <file/config_file.h>
@@ -22,6 +25,8 @@
 #include <lists/dir_list.h>
 #include <file/archive_file.h>
 #include <streams/file_stream.h>
+#include <encodings/utf.h>
+#include <rhash.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -94,61 +99,152 @@ static void core_info_list_resolve_all_extensions(
 #endif
 }
 
-static void core_info_list_resolve_all_firmware(
-      core_info_list_t *core_info_list)
+/* Info file keys that map straight onto a string of core_info_t.
+ * Fields with a list are also split on '|'. */
+typedef struct core_info_string_field
 {
-   size_t i;
-   unsigned c;
+   const char *key;
+   size_t offset;
+   size_t list_offset;
+} core_info_string_field_t;
+
+#define CORE_INFO_NO_LIST ((size_t)-1)
+
+static const core_info_string_field_t core_info_string_fields[] = {
+   { "display_name",         offsetof(core_info_t, display_name),
+      CORE_INFO_NO_LIST },
+   { "display_version",      offsetof(core_info_t, display_version),
+      CORE_INFO_NO_LIST },
+   { "corename",             offsetof(core_info_t, core_name),
+      CORE_INFO_NO_LIST },
+   { "systemname",           offsetof(core_info_t, systemname),
+      CORE_INFO_NO_LIST },
+   { "systemid",             offsetof(core_info_t, system_id),
+      CORE_INFO_NO_LIST },
+   { "manufacturer",         offsetof(core_info_t, system_manufacturer),
+      CORE_INFO_NO_LIST },
+   { "supported_extensions", offsetof(core_info_t, supported_extensions),
+      offsetof(core_info_t, supported_extensions_list) },
+   { "authors",              offsetof(core_info_t, authors),
+      offsetof(core_info_t, authors_list) },
+   { "permissions",          offsetof(core_info_t, permissions),
+      offsetof(core_info_t, permissions_list) },
+   { "license",              offsetof(core_info_t, licenses),
+      offsetof(core_info_t, licenses_list) },
+   { "categories",           offsetof(core_info_t, categories),
+      offsetof(core_info_t, categories_list) },
+   { "database",             offsetof(core_info_t, databases),
+      offsetof(core_info_t, databases_list) },
+   { "notes",                offsetof(core_info_t, notes),
+      offsetof(core_info_t, note_list) },
+   { "required_hw_api",      offsetof(core_info_t, required_hw_api),
+      offsetof(core_info_t, required_hw_api_list) },
+};
 
-   for (i = 0; i < core_info_list->count; i++)
-   {
-      unsigned count                  = 0;
-      core_info_firmware_t *firmware  = NULL;
-      core_info_t *info               = (core_info_t*)&core_info_list->list[i];
-      config_file_t *config           = (config_file_t*)info->config_data;
+#define CORE_INFO_NUM_STRING_FIELDS \
+   (sizeof(core_info_string_fields) / sizeof(core_info_string_fields[0]))
 
-      if (!config || !config_get_uint(config, "firmware_count", &count))
-         continue;
+static char **core_info_string_ptr(core_info_t *info, size_t offset)
+{
+   return (char**)((uint8_t*)info + offset);
+}
 
-      firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
+static void core_info_set_string(core_info_t *info,
+      const core_info_string_field_t *field, const char *value)
+{
+   char **str = NULL;
 
-      if (!firmware)
-         continue;
+   if (string_is_empty(value))
+      return;
+
+   str  = core_info_string_ptr(info, field->offset);
+   *str = strdup(value);
+
+   if (*str && field->list_offset != CORE_INFO_NO_LIST)
+      *(struct string_list**)((uint8_t*)info + field->list_offset) =
+         string_split(*str, "|");
+}
 
-      info->firmware = firmware;
+static void core_info_parse_firmware(core_info_t *info,
+      config_file_t *config)
+{
+   unsigned c;
+   unsigned count                 = 0;
+   core_info_firmware_t *firmware = NULL;
 
-      for (c = 0; c < count; c++)
+   if (!config_get_uint(config, "firmware_count", &count) || count == 0)
+      return;
+
+   if (!(firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware))))
+      return;
+
+   info->firmware       = firmware;
+   info->firmware_count = count;
+
+   for (c = 0; c < count; c++)
+   {
+      char path_key[64];
+      char desc_key[64];
+      char opt_key[64];
+      bool tmp_bool     = false;
+      char *tmp         = NULL;
+      path_key[0]       = desc_key[0] = opt_key[0] = '\0';
+
+      snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
+      snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
+      snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
+
+      if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
       {
-         char path_key[64];
-         char desc_key[64];
-         char opt_key[64];
-         bool tmp_bool     = false;
-         char *tmp         = NULL;
-         path_key[0]       = desc_key[0] = opt_key[0] = '\0';
-
-         snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
-         snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
-         snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
-
-         if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].path = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].desc = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (tmp)
-            free(tmp);
+         info->firmware[c].path = strdup(tmp);
+         free(tmp);
+         tmp = NULL;
+      }
+      if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
+      {
+         info->firmware[c].desc = strdup(tmp);
+         free(tmp);
          tmp = NULL;
-         if (config_get_bool(config, opt_key , &tmp_bool))
-            info->firmware[c].optional = tmp_bool;
       }
+      if (tmp)
+         free(tmp);
+      tmp = NULL;
+      if (config_get_bool(config, opt_key , &tmp_bool))
+         info->firmware[c].optional = tmp_bool;
+   }
+}
+
+static void core_info_parse_file(core_info_t *info, const char *info_path)
+{
+   size_t i;
+   bool tmp_bool       = false;
+   config_file_t *conf = config_file_new_from_path_to_string(info_path);
+
+   if (!conf)
+      return;
+
+   for (i = 0; i < CORE_INFO_NUM_STRING_FIELDS; i++)
+   {
+      char *tmp = NULL;
+
+      if (config_get_string(conf, core_info_string_fields[i].key, &tmp))
+         core_info_set_string(info, &core_info_string_fields[i], tmp);
+
+      if (tmp)
+         free(tmp);
    }
+
+   if (config_get_bool(conf, "supports_no_game", &tmp_bool))
+      info->supports_no_game = tmp_bool;
+
+   if (config_get_bool(conf, "database_match_archive_member", &tmp_bool))
+      info->database_match_archive_member = tmp_bool;
+
+   core_info_parse_firmware(info, conf);
+
+   info->has_info = true;
+
+   config_file_free(conf);
 }
 
 static void core_info_list_free(core_info_list_t *core_info_list)
@@ -185,7 +281,6 @@ static void core_info_list_free(core_info_list_t *core_info_list)
       string_list_free(info->categories_list);
       string_list_free(info->databases_list);
       string_list_free(info->required_hw_api_list);
-      config_file_free((config_file_t*)info->config_data);
 
       for (j = 0; j < info->firmware_count; j++)
       {
@@ -200,25 +295,18 @@ static void core_info_list_free(core_info_list_t *core_info_list)
    free(core_info_list);
 }
 
-static config_file_t *core_info_list_iterate(
+static void core_info_get_info_path(
       const char *current_path,
-      const char *path_basedir)
+      const char *path_basedir,
+      char *s, size_t len)
 {
-   size_t info_path_base_size = PATH_MAX_LENGTH * sizeof(char);
-   char *info_path_base       = NULL;
-   char *info_path            = NULL;
-   config_file_t *conf        = NULL;
-
-   if (!current_path)
-      return NULL;
-
-   info_path_base             = (char*)malloc(info_path_base_size);
+   char info_path_base[PATH_MAX_LENGTH];
 
    info_path_base[0] = '\0';
 
    fill_pathname_base_noext(info_path_base,
          current_path,
-         info_path_base_size);
+         sizeof(info_path_base));
 
 #if defined(RARCH_MOBILE) || (defined(RARCH_CONSOLE) && !defined(PSP) && !defined(_3DS) && !defined(VITA) && !defined(PS2) && !defined(HW_WUP))
    {
@@ -228,30 +316,508 @@ static config_file_t *core_info_list_iterate(
    }
 #endif
 
-   strlcat(info_path_base, ".info", info_path_base_size);
+   strlcat(info_path_base, ".info", sizeof(info_path_base));
+
+   fill_pathname_join(s, path_basedir, info_path_base, len);
+}
+
+/* Core info cache
+ *
+ * Parsing every .info file on each core list refresh is slow
+ * on devices with slow storage, so the parsed fields are kept
+ * in a single binary file in the cache directory, along with
+ * the size and modification time of the .info file they came
+ * from. Unchanged entries are taken from the cache, anything
+ * else is parsed again and the cache is rewritten. The info
+ * directory itself is read-only on many installs
+ * (/usr/share/libretro/info), so the cache doesn't go there.
+ *
+ * The cache is only used on platforms where the modification
+ * time of a file can be read, see core_info_get_file_id(). */
+
+#define CORE_INFO_CACHE_FILE    "core_info.cache"
+#define CORE_INFO_CACHE_MAGIC   "RCINFO1"
+#define CORE_INFO_CACHE_ENDIAN  0x01020304
+#define CORE_INFO_CACHE_NULL    0xFFFFFFFF
+
+typedef struct core_info_file_id
+{
+   int64_t size;
+   int64_t mtime;
+} core_info_file_id_t;
+
+typedef struct core_info_cache_header
+{
+   char magic[8];
+   uint32_t endian;
+   uint32_t count;
+} core_info_cache_header_t;
+
+typedef struct core_info_cache_entry
+{
+   core_info_file_id_t id;
+   const char *info_path;
+   size_t data; /* offset of the parsed fields */
+   uint32_t path_hash;
+   bool used;
+} core_info_cache_entry_t;
+
+typedef struct core_info_cache
+{
+   uint8_t *buf;
+   size_t len;
+   core_info_cache_entry_t *entries;
+   size_t count;
+} core_info_cache_t;
+
+/* Bounds checked reader over the cache file */
+typedef struct core_info_cache_reader
+{
+   const uint8_t *data;
+   size_t len;
+   size_t pos;
+} core_info_cache_reader_t;
+
+typedef struct core_info_cache_writer
+{
+   uint8_t *data;
+   size_t len;
+   size_t capacity;
+   bool error;
+} core_info_cache_writer_t;
+
+static bool core_info_get_file_id(const char *path, core_info_file_id_t *id)
+{
+#if defined(_WIN32) && !defined(_XBOX) && !defined(LEGACY_WIN32)
+   struct _stat64 buf;
+   int ret;
+   wchar_t *path_w = utf8_to_utf16_string_alloc(path);
+
+   if (!path_w)
+      return false;
+
+   ret = _wstat64(path_w, &buf);
+   free(path_w);
+
+   if (ret != 0)
+      return false;
+
+   id->size  = (int64_t)buf.st_size;
+   id->mtime = (int64_t)buf.st_mtime;
+   return true;
+#elif defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
+   struct stat buf;
+
+   if (stat(path, &buf) != 0)
+      return false;
+
+   id->size  = (int64_t)buf.st_size;
+   id->mtime = (int64_t)buf.st_mtime;
+   return true;
+#else
+   return false;
+#endif
+}
+
+static bool core_info_cache_read_u32(core_info_cache_reader_t *reader,
+      uint32_t *value)
+{
+   if (reader->len - reader->pos < sizeof(*value))
+      return false;
+
+   memcpy(value, reader->data + reader->pos, sizeof(*value));
+   reader->pos += sizeof(*value);
+   return true;
+}
+
+static bool core_info_cache_read_i64(core_info_cache_reader_t *reader,
+      int64_t *value)
+{
+   if (reader->len - reader->pos < sizeof(*value))
+      return false;
+
+   memcpy(value, reader->data + reader->pos, sizeof(*value));
+   reader->pos += sizeof(*value);
+   return true;
+}
+
+/* Strings are stored with their length and a terminating '\0',
+ * so they can be used in place */
+static bool core_info_cache_read_string(core_info_cache_reader_t *reader,
+      const char **value)
+{
+   uint32_t len = 0;
+
+   if (!core_info_cache_read_u32(reader, &len))
+      return false;
+
+   if (len == CORE_INFO_CACHE_NULL)
+   {
+      *value = NULL;
+      return true;
+   }
+
+   if (      reader->len - reader->pos < (size_t)len + 1
+         || reader->data[reader->pos + len] != '\0')
+      return false;
+
+   *value       = (const char*)reader->data + reader->pos;
+   reader->pos += (size_t)len + 1;
+   return true;
+}
+
+/* Reads the parsed fields of an entry. If 'info' is NULL,
+ * the fields are only checked and skipped. */
+static bool core_info_cache_read_info(core_info_cache_reader_t *reader,
+      core_info_t *info)
+{
+   size_t i;
+   uint32_t flags          = 0;
+   uint32_t firmware_count = 0;
+
+   for (i = 0; i < CORE_INFO_NUM_STRING_FIELDS; i++)
+   {
+      const char *value = NULL;
+
+      if (!core_info_cache_read_string(reader, &value))
+         return false;
+
+      if (info)
+         core_info_set_string(info, &core_info_string_fields[i], value);
+   }
+
+   if (     !core_info_cache_read_u32(reader, &flags)
+         || !core_info_cache_read_u32(reader, &firmware_count))
+      return false;
+
+   /* Each firmware takes at least 12 bytes */
+   if (firmware_count > (reader->len - reader->pos) / 12)
+      return false;
+
+   if (info)
+   {
+      info->supports_no_game              = (flags & 1) != 0;
+      info->database_match_archive_member = (flags & 2) != 0;
+
+      if (firmware_count > 0)
+      {
+         if (!(info->firmware = (core_info_firmware_t*)calloc(
+                     firmware_count, sizeof(*info->firmware))))
+            return false;
+         info->firmware_count = firmware_count;
+      }
+   }
+
+   for (i = 0; i < firmware_count; i++)
+   {
+      const char *path = NULL;
+      const char *desc = NULL;
+      uint32_t optional = 0;
+
+      if (     !core_info_cache_read_string(reader, &path)
+            || !core_info_cache_read_string(reader, &desc)
+            || !core_info_cache_read_u32(reader, &optional))
+         return false;
+
+      if (info)
+      {
+         if (!string_is_empty(path))
+            info->firmware[i].path = strdup(path);
+         if (!string_is_empty(desc))
+            info->firmware[i].desc = strdup(desc);
+         info->firmware[i].optional = optional != 0;
+      }
+   }
+
+   if (info)
+      info->has_info = true;
+
+   return true;
+}
+
+static void core_info_cache_free(core_info_cache_t *cache)
+{
+   if (!cache)
+      return;
+
+   if (cache->buf)
+      free(cache->buf);
+   if (cache->entries)
+      free(cache->entries);
+   free(cache);
+}
+
+static core_info_cache_t *core_info_cache_load(const char *cache_path)
+{
+   size_t i;
+   void *buf                        = NULL;
+   int64_t len                      = 0;
+   core_info_cache_header_t header;
+   core_info_cache_reader_t reader;
+   core_info_cache_t *cache         = NULL;
+
+   if (!path_is_valid(cache_path))
+      return NULL;
+
+   if (!filestream_read_file(cache_path, &buf, &len))
+      return NULL;
+
+   if ((size_t)len < sizeof(header))
+      goto error;
+
+   memcpy(&header, buf, sizeof(header));
+
+   if (     memcmp(header.magic, CORE_INFO_CACHE_MAGIC,
+               sizeof(header.magic)) != 0
+         || header.endian != CORE_INFO_CACHE_ENDIAN
+         || header.count  > (size_t)len / 32)
+      goto error;
+
+   if (!(cache = (core_info_cache_t*)calloc(1, sizeof(*cache))))
+      goto error;
+
+   cache->buf   = (uint8_t*)buf;
+   cache->len   = (size_t)len;
+   buf          = NULL;
+
+   if (header.count > 0 && !(cache->entries = (core_info_cache_entry_t*)
+            calloc(header.count, sizeof(*cache->entries))))
+      goto error;
+
+   reader.data  = cache->buf;
+   reader.len   = cache->len;
+   reader.pos   = sizeof(header);
 
-   info_path = (char*)malloc(info_path_base_size);
-   fill_pathname_join(info_path,
-         path_basedir,
-         info_path_base, info_path_base_size);
-   free(info_path_base);
-   info_path_base = NULL;
+   for (i = 0; i < header.count; i++)
+   {
+      core_info_cache_entry_t *entry = &cache->entries[i];
+
+      if (     !core_info_cache_read_string(&reader, &entry->info_path)
+            || !entry->info_path
+            || !core_info_cache_read_i64(&reader, &entry->id.size)
+            || !core_info_cache_read_i64(&reader, &entry->id.mtime))
+         goto error;
+
+      entry->path_hash = djb2_calculate(entry->info_path);
+      entry->data      = reader.pos;
+
+      if (!core_info_cache_read_info(&reader, NULL))
+         goto error;
+   }
+
+   cache->count = header.count;
+   return cache;
+
+error:
+   if (buf)
+      free(buf);
+   core_info_cache_free(cache);
+   RARCH_WARN("[Core Info]: Ignoring invalid cache \"%s\".\n", cache_path);
+   return NULL;
+}
+
+/* Fills 'info' from the cache, if it has an up to date
+ * entry for 'info_path' */
+static bool core_info_cache_take(core_info_cache_t *cache,
+      const char *info_path, const core_info_file_id_t *id,
+      core_info_t *info)
+{
+   size_t i;
+   uint32_t path_hash;
+
+   if (!cache)
+      return false;
+
+   path_hash = djb2_calculate(info_path);
+
+   for (i = 0; i < cache->count; i++)
+   {
+      core_info_cache_entry_t *entry = &cache->entries[i];
+      core_info_cache_reader_t reader;
+
+      if (     entry->path_hash != path_hash
+            || !string_is_equal(entry->info_path, info_path))
+         continue;
+
+      if (     entry->id.size  != id->size
+            || entry->id.mtime != id->mtime)
+         return false;
+
+      reader.data = cache->buf;
+      reader.len  = cache->len;
+      reader.pos  = entry->data;
+
+      entry->used = true;
+
+      return core_info_cache_read_info(&reader, info);
+   }
+
+   return false;
+}
+
+static void core_info_cache_write(core_info_cache_writer_t *writer,
+      const void *data, size_t len)
+{
+   if (writer->error)
+      return;
+
+   if (writer->len + len > writer->capacity)
+   {
+      size_t new_capacity = writer->capacity ? writer->capacity * 2 : 16384;
+      uint8_t *tmp        = NULL;
+
+      while (new_capacity < writer->len + len)
+         new_capacity *= 2;
+
+      if (!(tmp = (uint8_t*)realloc(writer->data, new_capacity)))
+      {
+         writer->error = true;
+         return;
+      }
+
+      writer->data     = tmp;
+      writer->capacity = new_capacity;
+   }
+
+   memcpy(writer->data + writer->len, data, len);
+   writer->len += len;
+}
 
-   if (path_is_valid(info_path))
-      conf = config_file_new_from_path_to_string(info_path);
-   free(info_path);
+static void core_info_cache_write_u32(core_info_cache_writer_t *writer,
+      uint32_t value)
+{
+   core_info_cache_write(writer, &value, sizeof(value));
+}
 
-   return conf;
+static void core_info_cache_write_string(core_info_cache_writer_t *writer,
+      const char *value)
+{
+   if (!value)
+   {
+      core_info_cache_write_u32(writer, CORE_INFO_CACHE_NULL);
+      return;
+   }
+
+   core_info_cache_write_u32(writer, (uint32_t)strlen(value));
+   core_info_cache_write(writer, value, strlen(value) + 1);
+}
+
+static void core_info_cache_write_info(core_info_cache_writer_t *writer,
+      core_info_t *info, const char *info_path,
+      const core_info_file_id_t *id)
+{
+   size_t i;
+   uint32_t flags = 0;
+
+   core_info_cache_write_string(writer, info_path);
+   core_info_cache_write(writer, &id->size,  sizeof(id->size));
+   core_info_cache_write(writer, &id->mtime, sizeof(id->mtime));
+
+   for (i = 0; i < CORE_INFO_NUM_STRING_FIELDS; i++)
+      core_info_cache_write_string(writer,
+            *core_info_string_ptr(info, core_info_string_fields[i].offset));
+
+   if (info->supports_no_game)
+      flags |= 1;
+   if (info->database_match_archive_member)
+      flags |= 2;
+
+   core_info_cache_write_u32(writer, flags);
+   core_info_cache_write_u32(writer, (uint32_t)info->firmware_count);
+
+   for (i = 0; i < info->firmware_count; i++)
+   {
+      core_info_cache_write_string(writer, info->firmware[i].path);
+      core_info_cache_write_string(writer, info->firmware[i].desc);
+      core_info_cache_write_u32(writer, info->firmware[i].optional ? 1 : 0);
+   }
+}
+
+/* Writes a new cache for all cores with an .info file.
+ * 'info_paths' and 'ids' are indexed like the core list,
+ * entries without an info path are skipped. */
+static void core_info_cache_save(const char *cache_path,
+      core_info_list_t *core_info_list,
+      char **info_paths, const core_info_file_id_t *ids)
+{
+   size_t i, j;
+   char tmp_path[PATH_MAX_LENGTH];
+   core_info_cache_header_t header;
+   core_info_cache_writer_t writer;
+   bool success = false;
+
+   memset(&header, 0, sizeof(header));
+   memset(&writer, 0, sizeof(writer));
+   memcpy(header.magic, CORE_INFO_CACHE_MAGIC, sizeof(header.magic));
+   header.endian = CORE_INFO_CACHE_ENDIAN;
+
+   /* Count is filled in once known */
+   core_info_cache_write(&writer, &header, sizeof(header));
+
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      bool duplicate = false;
+
+      if (!info_paths[i] || !core_info_list->list[i].has_info)
+         continue;
+
+      /* Several cores may share an .info file */
+      for (j = 0; j < i; j++)
+      {
+         if (info_paths[j] && string_is_equal(info_paths[j], info_paths[i]))
+         {
+            duplicate = true;
+            break;
+         }
+      }
+
+      if (duplicate)
+         continue;
+
+      core_info_cache_write_info(&writer, &core_info_list->list[i],
+            info_paths[i], &ids[i]);
+      header.count++;
+   }
+
+   if (writer.error)
+      goto end;
+
+   memcpy(writer.data, &header, sizeof(header));
+
+   /* Write to a temporary file first, so that an interrupted
+    * write never leaves a damaged cache behind */
+   strlcpy(tmp_path, cache_path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   if (filestream_write_file(tmp_path, writer.data, (int64_t)writer.len))
+   {
+      filestream_delete(cache_path);
+      success = filestream_rename(tmp_path, cache_path) == 0;
+   }
+
+   if (!success)
+      filestream_delete(tmp_path);
+
+end:
+   if (!success)
+      RARCH_WARN("[Core Info]: Failed to write cache \"%s\".\n", cache_path);
+   free(writer.data);
 }
 
 static core_info_list_t *core_info_list_new(const char *path,
       const char *libretro_info_dir,
+      const char *dir_cache,
       const char *exts,
       bool dir_show_hidden_files)
 {
    size_t i;
+   char cache_path[PATH_MAX_LENGTH];
    core_info_t *core_info           = NULL;
    core_info_list_t *core_info_list = NULL;
+   core_info_cache_t *cache         = NULL;
+   char **info_paths                = NULL;
+   core_info_file_id_t *ids         = NULL;
+   bool cache_dirty                 = false;
    const char       *path_basedir   = libretro_info_dir;
    struct string_list *contents     = string_list_new();
    bool                          ok = dir_list_append(contents, path, exts,
@@ -295,185 +861,79 @@ static core_info_list_t *core_info_list_new(const char *path,
    core_info_list->list  = core_info;
    core_info_list->count = contents->size;
 
-   for (i = 0; i < contents->size; i++)
-   {
-      const char *base_path = contents->elems[i].data;
-      config_file_t *conf   = core_info_list_iterate(base_path,
-            path_basedir);
+   cache_path[0]         = '\0';
 
-      if (conf)
-      {
-         char *tmp           = NULL;
-
-         if (config_get_string(conf, "display_name", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].display_name = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(conf, "display_version", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].display_version = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(conf, "corename", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].core_name = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "systemname", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].systemname = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "systemid", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].system_id = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "manufacturer", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].system_manufacturer = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         {
-            unsigned count      = 0;
-            config_get_uint(conf, "firmware_count", &count);
-            core_info[i].firmware_count = count;
-         }
-
-         if (config_get_string(conf, "supported_extensions", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].supported_extensions      = strdup(tmp);
-            core_info[i].supported_extensions_list =
-               string_split(core_info[i].supported_extensions, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "authors", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].authors      = strdup(tmp);
-            core_info[i].authors_list =
-               string_split(core_info[i].authors, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "permissions", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].permissions      = strdup(tmp);
-            core_info[i].permissions_list =
-               string_split(core_info[i].permissions, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "license", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].licenses      = strdup(tmp);
-            core_info[i].licenses_list =
-               string_split(core_info[i].licenses, "|");
+   if (contents->size > 0)
+   {
+      info_paths = (char**)calloc(contents->size, sizeof(*info_paths));
+      ids        = (core_info_file_id_t*)calloc(contents->size, sizeof(*ids));
+   }
 
-            free(tmp);
-            tmp = NULL;
-         }
+   if (info_paths && ids && !string_is_empty(dir_cache))
+   {
+      fill_pathname_join(cache_path, dir_cache,
+            CORE_INFO_CACHE_FILE, sizeof(cache_path));
+      cache = core_info_cache_load(cache_path);
+   }
 
-         if (config_get_string(conf, "categories", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].categories      = strdup(tmp);
-            core_info[i].categories_list =
-               string_split(core_info[i].categories, "|");
+   for (i = 0; i < contents->size; i++)
+   {
+      char info_path[PATH_MAX_LENGTH];
+      const char *base_path = contents->elems[i].data;
 
-            free(tmp);
-            tmp = NULL;
-         }
+      if (string_is_empty(base_path))
+         continue;
 
-         if (config_get_string(conf, "database", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].databases      = strdup(tmp);
-            core_info[i].databases_list =
-               string_split(core_info[i].databases, "|");
+      core_info_get_info_path(base_path, path_basedir,
+            info_path, sizeof(info_path));
 
-            free(tmp);
-            tmp = NULL;
-         }
+      if (info_paths && ids && core_info_get_file_id(info_path, &ids[i]))
+      {
+         info_paths[i] = strdup(info_path);
 
-         if (config_get_string(conf, "notes", &tmp)
-               && !string_is_empty(tmp))
+         if (!core_info_cache_take(cache, info_path, &ids[i], &core_info[i]))
          {
-            core_info[i].notes     = strdup(tmp);
-            core_info[i].note_list = string_split(core_info[i].notes, "|");
-
-            free(tmp);
-            tmp = NULL;
+            core_info_parse_file(&core_info[i], info_path);
+            cache_dirty = true;
          }
+      }
+      else if (path_is_valid(info_path))
+         core_info_parse_file(&core_info[i], info_path);
 
-         if (config_get_string(conf, "required_hw_api", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].required_hw_api = strdup(tmp);
-            core_info[i].required_hw_api_list = string_split(core_info[i].required_hw_api, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
+      core_info[i].path = strdup(base_path);
 
-         if (tmp)
-            free(tmp);
-         tmp    = NULL;
+      if (!core_info[i].display_name)
+         core_info[i].display_name =
+            strdup(path_basename(core_info[i].path));
+   }
 
+   /* Drop entries of removed cores from the cache too */
+   if (cache)
+   {
+      for (i = 0; i < cache->count; i++)
+      {
+         if (!cache->entries[i].used)
          {
-            bool tmp_bool       = false;
-            if (config_get_bool(conf, "supports_no_game",
-                     &tmp_bool))
-               core_info[i].supports_no_game = tmp_bool;
-
-            if (config_get_bool(conf, "database_match_archive_member",
-                     &tmp_bool))
-               core_info[i].database_match_archive_member = tmp_bool;
+            cache_dirty = true;
+            break;
          }
-
-         core_info[i].config_data = conf;
       }
+   }
 
-      if (!string_is_empty(base_path))
-         core_info[i].path = strdup(base_path);
+   if (cache_dirty && !string_is_empty(cache_path))
+      core_info_cache_save(cache_path, core_info_list, info_paths, ids);
 
-      if (!core_info[i].display_name)
-         core_info[i].display_name =
-            strdup(path_basename(core_info[i].path));
-   }
+   core_info_list_resolve_all_extensions(core_info_list);
 
-   if (core_info_list)
+   core_info_cache_free(cache);
+
+   if (info_paths)
    {
-      core_info_list_resolve_all_extensions(core_info_list);
-      core_info_list_resolve_all_firmware(core_info_list);
+      for (i = 0; i < contents->size; i++)
+         free(info_paths[i]);
+      free(info_paths);
    }
+   free(ids);
 
    string_list_free(contents);
    return core_info_list;
@@ -651,10 +1111,11 @@ void core_info_deinit_list(void)
 }
 
 bool core_info_init_list(const char *path_info, const char *dir_cores,
-      const char *exts, bool dir_show_hidden_files)
+      const char *dir_cache, const char *exts, bool dir_show_hidden_files)
 {
    if (!(core_info_curr_list = core_info_list_new(dir_cores,
                !string_is_empty(path_info) ? path_info : dir_cores,
+               dir_cache,
                exts,
                dir_show_hidden_files)))
       return false;
@@ -791,6 +1252,7 @@ void core_info_get_name(const char *path, char *s, size_t len,
 
    for (i = 0; i < contents->size; i++)
    {
+      char info_path[PATH_MAX_LENGTH];
       config_file_t *conf             = NULL;
       char *new_core_name             = NULL;
       const char *current_path        = contents->elems[i].data;
@@ -798,10 +1260,13 @@ void core_info_get_name(const char *path, char *s, size_t len,
       if (!string_is_equal(path_basename(current_path), core_path_basename))
          continue;
 
-      conf = core_info_list_iterate(contents->elems[i].data,
-               path_basedir);
+      core_info_get_info_path(current_path, path_basedir,
+            info_path, sizeof(info_path));
+
+      if (!path_is_valid(info_path))
+         continue;
 
-      if (!conf)
+      if (!(conf = config_file_new_from_path_to_string(info_path)))
          continue;
 
       if (config_get_string(conf, get_display_name 
@@ -828,11 +1293,7 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
       return 0;
 
    for (i = 0; i < core_info_list->count; i++)
-   {
-      config_file_t *conf = (config_file_t*)
-         core_info_list->list[i].config_data;
-      num += !!conf;
-   }
+      num += core_info_list->list[i].has_info ? 1 : 0;
 
    return num;
 }
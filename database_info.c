@@ -17,10 +17,16 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <compat/strl.h>
+#include <encodings/crc32.h>
 #include <retro_endianness.h>
+#include <retro_miscellaneous.h>
+#include <rhash.h>
 #include <file/file_path.h>
+#include <streams/file_stream.h>
 #include <lists/string_list.h>
 #include <lists/dir_list.h>
 #include <string/stdstring.h>
@@ -146,167 +152,221 @@ char *bin_to_hex_alloc(const uint8_t *data, size_t len)
    return ret;
 }
 
-static int database_cursor_iterate(libretrodb_cursor_t *cur,
-      database_info_t *db_info)
+static char *database_info_strdup(const char *s, uint32_t len)
 {
-   unsigned i;
-   struct rmsgpack_dom_value item;
-   const char* str                = NULL;
+   char *ret = (char*)malloc(len + 1);
 
-   if (libretrodb_cursor_read_item(cur, &item) != 0)
-      return -1;
+   if (!ret)
+      return NULL;
 
-   if (item.type != RDT_MAP)
-   {
-      rmsgpack_dom_value_free(&item);
+   memcpy(ret, s, len);
+   ret[len] = '\0';
+   return ret;
+}
+
+/* Fills 'db_info' straight from the mapped record,
+ * only allocating the fields that are kept */
+static int database_info_from_view(const struct rmsgpack_view *item,
+      database_info_t *db_info)
+{
+   uint32_t i;
+   uint32_t count;
+   struct rmsgpack_view val;
+
+   if (rmsgpack_view_type(item) != RDT_MAP)
       return 1;
-   }
 
    db_info->analog_supported       = -1;
    db_info->rumble_supported       = -1;
    db_info->coop_supported         = -1;
 
-   for (i = 0; i < item.val.map.len; i++)
+   count                           = rmsgpack_view_len(item);
+
+   if (count == 0 || rmsgpack_view_child(item, &val) < 0)
+      return 0;
+
+   for (i = 0; i < count; i++)
    {
-      struct rmsgpack_dom_value *key = &item.val.map.items[i].key;
-      struct rmsgpack_dom_value *val = &item.val.map.items[i].value;
+      char str[32];
+      uint32_t key_len               = 0;
+      uint32_t val_len               = 0;
+      const char *key                = rmsgpack_view_bytes(&val, &key_len);
       const char *val_string         = NULL;
 
-      if (!key || !val)
-         continue;
+      if (rmsgpack_view_next(&val) < 0)
+         break;
+
+      /* Keys are short, a stack copy keeps the
+       * comparisons below plain C strings */
+      str[0] = '\0';
+      if (key && key_len < sizeof(str))
+      {
+         memcpy(str, key, key_len);
+         str[key_len] = '\0';
+      }
 
-      val_string                     = val->val.string.buff;
-      str                            = key->val.string.buff;
+      val_string                     = rmsgpack_view_bytes(&val, &val_len);
 
+      /* c_converter can emit a key twice (e.g. 'serial' from
+       * both the game and the rom), the first one wins */
       if (string_is_equal(str, "publisher"))
       {
-         if (!string_is_empty(val_string))
-            db_info->publisher = strdup(val_string);
+         if (val_len && !db_info->publisher)
+            db_info->publisher = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "developer"))
       {
-         if (!string_is_empty(val_string))
-            db_info->developer = string_split(val_string, "|");
+         if (val_len && !db_info->developer)
+         {
+            char *developer = database_info_strdup(val_string, val_len);
+            if (developer)
+            {
+               db_info->developer = string_split(developer, "|");
+               free(developer);
+            }
+         }
       }
       else if (string_is_equal(str, "serial"))
       {
-         if (!string_is_empty(val_string))
-            db_info->serial = strdup(val_string);
+         if (val_len && !db_info->serial)
+            db_info->serial = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "rom_name"))
       {
-         if (!string_is_empty(val_string))
-            db_info->rom_name = strdup(val_string);
+         if (val_len && !db_info->rom_name)
+            db_info->rom_name = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "name"))
       {
-         if (!string_is_empty(val_string))
-            db_info->name = strdup(val_string);
+         if (val_len && !db_info->name)
+            db_info->name = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "description"))
       {
-         if (!string_is_empty(val_string))
-            db_info->description = strdup(val_string);
+         if (val_len && !db_info->description)
+            db_info->description = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "genre"))
       {
-         if (!string_is_empty(val_string))
-            db_info->genre = strdup(val_string);
+         if (val_len && !db_info->genre)
+            db_info->genre = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "origin"))
       {
-         if (!string_is_empty(val_string))
-            db_info->origin = strdup(val_string);
+         if (val_len && !db_info->origin)
+            db_info->origin = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "franchise"))
       {
-         if (!string_is_empty(val_string))
-            db_info->franchise = strdup(val_string);
+         if (val_len && !db_info->franchise)
+            db_info->franchise = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "bbfc_rating"))
       {
-         if (!string_is_empty(val_string))
-            db_info->bbfc_rating = strdup(val_string);
+         if (val_len && !db_info->bbfc_rating)
+            db_info->bbfc_rating = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "esrb_rating"))
       {
-         if (!string_is_empty(val_string))
-            db_info->esrb_rating = strdup(val_string);
+         if (val_len && !db_info->esrb_rating)
+            db_info->esrb_rating = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "elspa_rating"))
       {
-         if (!string_is_empty(val_string))
-            db_info->elspa_rating = strdup(val_string);
+         if (val_len && !db_info->elspa_rating)
+            db_info->elspa_rating = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "cero_rating"))
       {
-         if (!string_is_empty(val_string))
-            db_info->cero_rating          = strdup(val_string);
+         if (val_len && !db_info->cero_rating)
+            db_info->cero_rating          = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "pegi_rating"))
       {
-         if (!string_is_empty(val_string))
-            db_info->pegi_rating          = strdup(val_string);
+         if (val_len && !db_info->pegi_rating)
+            db_info->pegi_rating          = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "enhancement_hw"))
       {
-         if (!string_is_empty(val_string))
-            db_info->enhancement_hw       = strdup(val_string);
+         if (val_len && !db_info->enhancement_hw)
+            db_info->enhancement_hw       = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "edge_review"))
       {
-         if (!string_is_empty(val_string))
-            db_info->edge_magazine_review = strdup(val_string);
+         if (val_len && !db_info->edge_magazine_review)
+            db_info->edge_magazine_review = database_info_strdup(val_string, val_len);
       }
       else if (string_is_equal(str, "edge_rating"))
-         db_info->edge_magazine_rating    = (unsigned)val->val.uint_;
+         db_info->edge_magazine_rating    = (unsigned)rmsgpack_view_uint(&val);
       else if (string_is_equal(str, "edge_issue"))
-         db_info->edge_magazine_issue     = (unsigned)val->val.uint_;
+         db_info->edge_magazine_issue     = (unsigned)rmsgpack_view_uint(&val);
       else if (string_is_equal(str, "famitsu_rating"))
-         db_info->famitsu_magazine_rating = (unsigned)val->val.uint_;
+         db_info->famitsu_magazine_rating = (unsigned)rmsgpack_view_uint(&val);
       else if (string_is_equal(str, "tgdb_rating"))
-         db_info->tgdb_rating             = (unsigned)val->val.uint_;
+         db_info->tgdb_rating             = (unsigned)rmsgpack_view_uint(&val);
       else if (string_is_equal(str, "users"))
-         db_info->max_users               = (unsigned)val->val.uint_;
+         db_info->max_users               = (unsigned)rmsgpack_view_uint(&val);
       else if (string_is_equal(str, "releasemonth"))
-         db_info->releasemonth            = (unsigned)val->val.uint_;
+         db_info->releasemonth            = (unsigned)rmsgpack_view_uint(&val);
       else if (string_is_equal(str, "releaseyear"))
-         db_info->releaseyear             = (unsigned)val->val.uint_;
+         db_info->releaseyear             = (unsigned)rmsgpack_view_uint(&val);
       else if (string_is_equal(str, "rumble"))
-         db_info->rumble_supported        = (int)val->val.uint_;
+         db_info->rumble_supported        = (int)rmsgpack_view_uint(&val);
       else if (string_is_equal(str, "coop"))
-         db_info->coop_supported          = (int)val->val.uint_;
+         db_info->coop_supported          = (int)rmsgpack_view_uint(&val);
       else if (string_is_equal(str, "analog"))
-         db_info->analog_supported        = (int)val->val.uint_;
+         db_info->analog_supported        = (int)rmsgpack_view_uint(&val);
       else if (string_is_equal(str, "size"))
-         db_info->size                    = (unsigned)val->val.uint_;
+         db_info->size                    = (unsigned)rmsgpack_view_uint(&val);
       else if (string_is_equal(str, "crc"))
-         db_info->crc32 = swap_if_little32(
-               *(uint32_t*)val->val.binary.buff);
+      {
+         uint32_t crc = 0;
+         if (val_len >= sizeof(crc))
+            memcpy(&crc, val_string, sizeof(crc));
+         db_info->crc32 = swap_if_little32(crc);
+      }
       else if (string_is_equal(str, "sha1"))
-         db_info->sha1 = bin_to_hex_alloc(
-               (uint8_t*)val->val.binary.buff, val->val.binary.len);
+      {
+         if (val_len && !db_info->sha1)
+            db_info->sha1 = bin_to_hex_alloc(
+                  (const uint8_t*)val_string, val_len);
+      }
       else if (string_is_equal(str, "md5"))
-         db_info->md5 = bin_to_hex_alloc(
-               (uint8_t*)val->val.binary.buff, val->val.binary.len);
+      {
+         if (val_len && !db_info->md5)
+            db_info->md5 = bin_to_hex_alloc(
+                  (const uint8_t*)val_string, val_len);
+      }
       else
       {
          RARCH_LOG("Unknown key: %s\n", str);
       }
-   }
 
-   rmsgpack_dom_value_free(&item);
+      if (rmsgpack_view_next(&val) < 0)
+         break;
+   }
 
    return 0;
 }
 
+static int database_cursor_iterate(libretrodb_cursor_t *cur,
+      database_info_t *db_info)
+{
+   struct rmsgpack_view item;
+
+   if (libretrodb_cursor_read_view(cur, &item) != 0)
+      return -1;
+
+   return database_info_from_view(&item, db_info);
+}
+
 static int database_cursor_open(libretrodb_t *db,
       libretrodb_cursor_t *cur, const char *path, const char *query)
 {
    const char *error     = NULL;
    libretrodb_query_t *q = NULL;
 
-   if ((libretrodb_open(path, db)) != 0)
+   if ((libretrodb_open_mapped(path, db)) != 0)
       return -1;
 
    if (query)
@@ -368,7 +428,10 @@ database_info_handle_t *database_info_dir_init(const char *dir,
       enum database_type type, retro_task_t *task,
       bool show_hidden_files)
 {
+   size_t i;
+   union string_list_elem_attr attr;
    core_info_list_t *core_info_list = NULL;
+   struct dir_list      *dir_list   = NULL;
    struct string_list       *list   = NULL;
    database_info_handle_t     *db   = (database_info_handle_t*)
       calloc(1, sizeof(*db));
@@ -378,16 +441,35 @@ database_info_handle_t *database_info_dir_init(const char *dir,
 
    core_info_get_list(&core_info_list);
 
-   list = dir_list_new(dir, core_info_list ? core_info_list->all_ext : NULL,
+   /* Subdirectories are read concurrently. The scan
+    * prunes entries from the list as it goes, so the
+    * result still has to become a string list. */
+   dir_list = dir_list_new_parallel(dir,
+         core_info_list ? core_info_list->all_ext : NULL,
          false, show_hidden_files,
-         false, true);
+         false, true, false, 0);
 
-   if (!list)
+   if (!dir_list || !(list = string_list_new()))
    {
+      dir_list_parallel_free(dir_list);
       free(db);
       return NULL;
    }
 
+   for (i = 0; i < dir_list->size; i++)
+   {
+      attr.i = dir_list->entries[i].type;
+      if (!string_list_append(list, dir_list->entries[i].path, attr))
+      {
+         dir_list_parallel_free(dir_list);
+         string_list_free(list);
+         free(db);
+         return NULL;
+      }
+   }
+
+   dir_list_parallel_free(dir_list);
+
    dir_list_prioritize(list);
 
    db->list           = list;
@@ -589,3 +671,718 @@ void database_info_list_free(database_info_list_t *database_info_list)
 
    free(database_info_list->list);
 }
+
+/* Scan index
+ *
+ * Content scans look up every file by CRC (or serial) in every
+ * RDB. Running a libretrodb query for each lookup decodes the
+ * whole database each time, so instead every RDB is walked once
+ * and its crc/serial keys are stored in bucketed tables that
+ * point back at the record offsets. Matching records are then
+ * read directly from those offsets. Tables are built lazily,
+ * the first time a database is looked up, and are cached in
+ * 'cache_dir' (if set) for later scans. A cached index is only
+ * used if the RDB still has the size, record count and CRC32
+ * it had when the index was written. */
+
+#define DATABASE_INDEX_MAGIC   "RDBIDX2"
+#define DATABASE_INDEX_ENDIAN  0x01020304
+#define DATABASE_INDEX_NO_KEY  0xFFFFFFFF
+
+typedef struct database_index_entry
+{
+   uint32_t key;     /* crc32, or djb2 hash of the serial */
+   uint32_t serial;  /* offset of serial in string pool */
+   uint64_t offset;  /* record offset in the RDB */
+} database_index_entry_t;
+
+typedef struct database_index_table
+{
+   database_index_entry_t *entries;
+   uint32_t *buckets; /* bucket_count + 1 start positions */
+   uint32_t count;
+   uint32_t bucket_count;
+} database_index_table_t;
+
+typedef struct database_index_header
+{
+   char magic[8];
+   uint32_t endian;
+   uint32_t rdb_crc;
+   uint64_t rdb_size;
+   uint64_t rdb_count;
+   uint32_t crc_count;
+   uint32_t crc_buckets;
+   uint32_t serial_count;
+   uint32_t serial_buckets;
+   uint64_t serials_size;
+} database_index_header_t;
+
+typedef struct database_index_rdb
+{
+   uint32_t path_hash;
+   char *path;
+   char *serials;
+   uint64_t serials_size;
+   database_index_table_t crc;
+   database_index_table_t serial;
+} database_index_rdb_t;
+
+struct database_info_index
+{
+   database_index_rdb_t *rdbs;
+   size_t count;
+   size_t capacity;
+   char cache_dir[PATH_MAX_LENGTH];
+};
+
+static void database_index_table_free(database_index_table_t *table)
+{
+   if (table->entries)
+      free(table->entries);
+   if (table->buckets)
+      free(table->buckets);
+   table->entries = NULL;
+   table->buckets = NULL;
+   table->count   = 0;
+}
+
+/* Sorts 'count' entries into 'bucket_count' buckets on the low
+ * bits of their key. This is a stable counting sort, so entries
+ * keep their database order inside each bucket. */
+static bool database_index_table_build(database_index_table_t *table,
+      const database_index_entry_t *entries, uint32_t count)
+{
+   uint32_t i;
+   uint32_t mask         = 0;
+   uint32_t bucket_count = 1;
+
+   while (bucket_count < count)
+      bucket_count <<= 1;
+   mask                  = bucket_count - 1;
+
+   table->count          = count;
+   table->bucket_count   = bucket_count;
+   table->buckets        = (uint32_t*)calloc(bucket_count + 1,
+         sizeof(*table->buckets));
+   table->entries        = (database_index_entry_t*)malloc(
+         (count ? count : 1) * sizeof(*table->entries));
+
+   if (!table->buckets || !table->entries)
+   {
+      database_index_table_free(table);
+      return false;
+   }
+
+   for (i = 0; i < count; i++)
+      table->buckets[(entries[i].key & mask) + 1]++;
+   for (i = 0; i < bucket_count; i++)
+      table->buckets[i + 1] += table->buckets[i];
+
+   /* Scatter, using the bucket starts as write cursors and
+    * shifting them back afterwards */
+   for (i = 0; i < count; i++)
+      table->entries[table->buckets[entries[i].key & mask]++] = entries[i];
+   for (i = bucket_count; i > 0; i--)
+      table->buckets[i] = table->buckets[i - 1];
+   table->buckets[0] = 0;
+
+   return true;
+}
+
+static bool database_index_push(database_index_entry_t **entries,
+      uint32_t *count, uint32_t *capacity,
+      uint32_t key, uint32_t serial, uint64_t offset)
+{
+   if (*count == *capacity)
+   {
+      uint32_t new_capacity        = *capacity ? *capacity * 2 : 256;
+      database_index_entry_t *tmp  = (database_index_entry_t*)
+         realloc(*entries, new_capacity * sizeof(**entries));
+
+      if (!tmp)
+         return false;
+
+      *entries  = tmp;
+      *capacity = new_capacity;
+   }
+
+   (*entries)[*count].key    = key;
+   (*entries)[*count].serial = serial;
+   (*entries)[*count].offset = offset;
+   (*count)++;
+
+   return true;
+}
+
+/* Walks all records of the RDB once, collecting the
+ * offset of every record that has a crc and/or serial */
+static bool database_index_rdb_scan(database_index_rdb_t *rdb,
+      libretrodb_t *db)
+{
+   struct rmsgpack_view item;
+   database_index_entry_t *crcs    = NULL;
+   database_index_entry_t *serials = NULL;
+   uint32_t crc_count              = 0;
+   uint32_t crc_capacity           = 0;
+   uint32_t serial_count           = 0;
+   uint32_t serial_capacity        = 0;
+   uint64_t pool_size              = 0;
+   uint64_t pool_capacity          = 0;
+   bool success                    = false;
+   libretrodb_cursor_t *cur        = libretrodb_cursor_new();
+
+   if (!cur || libretrodb_cursor_open(db, cur, NULL) != 0)
+      goto end;
+
+   for (;;)
+   {
+      struct rmsgpack_view val;
+      uint64_t offset                = libretrodb_cursor_tell(cur);
+
+      if (libretrodb_cursor_read_view(cur, &item) != 0)
+         break;
+
+      if (rmsgpack_view_type(&item) != RDT_MAP)
+         continue;
+
+      /* Keys have to match the libretrodb query semantics,
+       * which only ever compare binary values */
+      if (     rmsgpack_view_map_find(&item, "crc", 3, &val) == 0
+            && rmsgpack_view_type(&val) == RDT_BINARY
+            && rmsgpack_view_len(&val) == 4)
+      {
+         uint32_t len = 0;
+         uint32_t crc = 0;
+
+         memcpy(&crc, rmsgpack_view_bytes(&val, &len), sizeof(crc));
+         crc = swap_if_little32(crc);
+
+         if (!database_index_push(&crcs, &crc_count, &crc_capacity,
+                  crc, DATABASE_INDEX_NO_KEY, offset))
+            goto end;
+      }
+
+      if (     rmsgpack_view_map_find(&item, "serial", 6, &val) == 0
+            && rmsgpack_view_type(&val) == RDT_BINARY
+            && rmsgpack_view_len(&val) > 0)
+      {
+         uint32_t len      = 0;
+         const char *bytes = rmsgpack_view_bytes(&val, &len);
+
+         if (pool_size + len + 1 > pool_capacity)
+         {
+            uint64_t new_capacity = pool_capacity ? pool_capacity * 2 : 4096;
+            char *tmp             = NULL;
+
+            while (new_capacity < pool_size + len + 1)
+               new_capacity *= 2;
+
+            if (!(tmp = (char*)realloc(rdb->serials, (size_t)new_capacity)))
+               goto end;
+
+            rdb->serials  = tmp;
+            pool_capacity = new_capacity;
+         }
+
+         memcpy(rdb->serials + pool_size, bytes, len);
+         rdb->serials[pool_size + len] = '\0';
+
+         if (!database_index_push(&serials, &serial_count, &serial_capacity,
+                  djb2_calculate(rdb->serials + pool_size),
+                  (uint32_t)pool_size, offset))
+            goto end;
+
+         pool_size += len + 1;
+      }
+   }
+
+   rdb->serials_size = pool_size;
+
+   success = database_index_table_build(&rdb->crc, crcs, crc_count)
+      && database_index_table_build(&rdb->serial, serials, serial_count);
+
+end:
+   if (cur)
+   {
+      libretrodb_cursor_close(cur);
+      libretrodb_cursor_free(cur);
+   }
+   if (crcs)
+      free(crcs);
+   if (serials)
+      free(serials);
+
+   return success;
+}
+
+static void database_index_cache_path(char *s, size_t len,
+      const char *cache_dir, const char *rdb_path)
+{
+   fill_pathname_join(s, cache_dir, path_basename(rdb_path), len);
+   strlcat(s, ".idx", len);
+}
+
+static bool database_index_table_valid(const database_index_table_t *table)
+{
+   uint32_t i;
+
+   if (     table->bucket_count == 0
+         || (table->bucket_count & (table->bucket_count - 1)) != 0
+         || table->buckets[table->bucket_count] != table->count)
+      return false;
+
+   for (i = 0; i < table->bucket_count; i++)
+      if (table->buckets[i] > table->buckets[i + 1])
+         return false;
+
+   return true;
+}
+
+static bool database_index_read_array(RFILE *file, void **data,
+      uint64_t size)
+{
+   if (!(*data = malloc(size ? (size_t)size : 1)))
+      return false;
+
+   return filestream_read(file, *data, (int64_t)size) == (int64_t)size;
+}
+
+static bool database_index_rdb_load(database_index_rdb_t *rdb,
+      const char *cache_path, uint64_t rdb_size, uint64_t rdb_count,
+      const char *rdb_path)
+{
+   database_index_header_t header;
+   uint64_t expected_size = 0;
+   bool success           = false;
+   RFILE *file            = filestream_open(cache_path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   if (filestream_read(file, &header, sizeof(header)) != sizeof(header))
+      goto end;
+
+   if (memcmp(header.magic, DATABASE_INDEX_MAGIC, sizeof(header.magic)) != 0
+         || header.endian    != DATABASE_INDEX_ENDIAN
+         || header.rdb_size  != rdb_size
+         || header.rdb_count != rdb_count)
+      goto end;
+
+   /* Size and count stay the same when an update only
+    * fixes a CRC or serial, so check the contents too */
+   if (header.rdb_crc != file_crc32(0, rdb_path))
+      goto end;
+
+   expected_size = sizeof(header)
+      + (uint64_t)header.crc_count         * sizeof(database_index_entry_t)
+      + ((uint64_t)header.crc_buckets + 1) * sizeof(uint32_t)
+      + (uint64_t)header.serial_count      * sizeof(database_index_entry_t)
+      + ((uint64_t)header.serial_buckets + 1) * sizeof(uint32_t)
+      + header.serials_size;
+
+   /* Truncated or otherwise damaged file */
+   if ((uint64_t)filestream_get_size(file) != expected_size)
+      goto end;
+
+   rdb->crc.count           = header.crc_count;
+   rdb->crc.bucket_count    = header.crc_buckets;
+   rdb->serial.count        = header.serial_count;
+   rdb->serial.bucket_count = header.serial_buckets;
+   rdb->serials_size        = header.serials_size;
+
+   success =
+         database_index_read_array(file, (void**)&rdb->crc.entries,
+            header.crc_count * sizeof(database_index_entry_t))
+      && database_index_read_array(file, (void**)&rdb->crc.buckets,
+            ((uint64_t)header.crc_buckets + 1) * sizeof(uint32_t))
+      && database_index_read_array(file, (void**)&rdb->serial.entries,
+            header.serial_count * sizeof(database_index_entry_t))
+      && database_index_read_array(file, (void**)&rdb->serial.buckets,
+            ((uint64_t)header.serial_buckets + 1) * sizeof(uint32_t))
+      && database_index_read_array(file, (void**)&rdb->serials,
+            header.serials_size);
+
+   /* Sanity check the tables, lookups index them directly */
+   if (success)
+      success =
+            database_index_table_valid(&rdb->crc)
+         && database_index_table_valid(&rdb->serial)
+         && (rdb->serials_size == 0
+               || rdb->serials[rdb->serials_size - 1] == '\0');
+
+end:
+   filestream_close(file);
+   return success;
+}
+
+static void database_index_rdb_save(database_index_rdb_t *rdb,
+      const char *cache_path, uint64_t rdb_size, uint64_t rdb_count,
+      const char *rdb_path)
+{
+   database_index_header_t header;
+   char tmp_path[PATH_MAX_LENGTH];
+   bool success = false;
+   RFILE *file  = NULL;
+
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, DATABASE_INDEX_MAGIC, sizeof(header.magic));
+   header.endian         = DATABASE_INDEX_ENDIAN;
+   header.rdb_crc        = file_crc32(0, rdb_path);
+   header.rdb_size       = rdb_size;
+   header.rdb_count      = rdb_count;
+   header.crc_count      = rdb->crc.count;
+   header.crc_buckets    = rdb->crc.bucket_count;
+   header.serial_count   = rdb->serial.count;
+   header.serial_buckets = rdb->serial.bucket_count;
+   header.serials_size   = rdb->serials_size;
+
+   /* Write to a temporary file first, so that concurrent
+    * scans never see a partially written index */
+   strlcpy(tmp_path, cache_path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   if (!(file = filestream_open(tmp_path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return;
+
+   success =
+         filestream_write(file, &header, sizeof(header)) == sizeof(header)
+      && filestream_write(file, rdb->crc.entries,
+            rdb->crc.count * sizeof(database_index_entry_t))
+         == (int64_t)(rdb->crc.count * sizeof(database_index_entry_t))
+      && filestream_write(file, rdb->crc.buckets,
+            (rdb->crc.bucket_count + 1) * sizeof(uint32_t))
+         == (int64_t)((rdb->crc.bucket_count + 1) * sizeof(uint32_t))
+      && filestream_write(file, rdb->serial.entries,
+            rdb->serial.count * sizeof(database_index_entry_t))
+         == (int64_t)(rdb->serial.count * sizeof(database_index_entry_t))
+      && filestream_write(file, rdb->serial.buckets,
+            (rdb->serial.bucket_count + 1) * sizeof(uint32_t))
+         == (int64_t)((rdb->serial.bucket_count + 1) * sizeof(uint32_t))
+      && filestream_write(file, rdb->serials, (int64_t)rdb->serials_size)
+         == (int64_t)rdb->serials_size;
+
+   filestream_close(file);
+
+   if (success)
+   {
+      filestream_delete(cache_path);
+      success = filestream_rename(tmp_path, cache_path) == 0;
+   }
+
+   if (!success)
+   {
+      filestream_delete(tmp_path);
+      RARCH_WARN("[Database]: Failed to write index cache \"%s\".\n",
+            cache_path);
+   }
+}
+
+static void database_index_rdb_free(database_index_rdb_t *rdb)
+{
+   if (rdb->path)
+      free(rdb->path);
+   if (rdb->serials)
+      free(rdb->serials);
+   database_index_table_free(&rdb->crc);
+   database_index_table_free(&rdb->serial);
+   rdb->path    = NULL;
+   rdb->serials = NULL;
+}
+
+static database_index_rdb_t *database_index_get_rdb(
+      database_info_index_t *index, const char *rdb_path)
+{
+   size_t i;
+   database_index_rdb_t rdb;
+   char cache_path[PATH_MAX_LENGTH];
+   uint64_t rdb_size     = 0;
+   uint64_t rdb_count    = 0;
+   uint32_t path_hash    = djb2_calculate(rdb_path);
+   libretrodb_t *db      = NULL;
+   bool loaded           = false;
+
+   for (i = 0; i < index->count; i++)
+   {
+      if (     index->rdbs[i].path_hash == path_hash
+            && string_is_equal(index->rdbs[i].path, rdb_path))
+         return &index->rdbs[i];
+   }
+
+   if (index->count == index->capacity)
+   {
+      size_t new_capacity        = index->capacity ? index->capacity * 2 : 32;
+      database_index_rdb_t *tmp  = (database_index_rdb_t*)realloc(
+            index->rdbs, new_capacity * sizeof(*tmp));
+
+      if (!tmp)
+         return NULL;
+
+      index->rdbs     = tmp;
+      index->capacity = new_capacity;
+   }
+
+   memset(&rdb, 0, sizeof(rdb));
+   cache_path[0] = '\0';
+
+   if (!(db = libretrodb_new()))
+      return NULL;
+
+   if (libretrodb_open_mapped(rdb_path, db) != 0)
+   {
+      libretrodb_free(db);
+      return NULL;
+   }
+
+   rdb_size  = (uint64_t)path_get_size(rdb_path);
+   rdb_count = libretrodb_get_count(db);
+
+   if (!string_is_empty(index->cache_dir))
+   {
+      database_index_cache_path(cache_path, sizeof(cache_path),
+            index->cache_dir, rdb_path);
+
+      if (!(loaded = database_index_rdb_load(&rdb, cache_path,
+                  rdb_size, rdb_count, rdb_path)))
+      {
+         database_index_rdb_free(&rdb);
+         memset(&rdb, 0, sizeof(rdb));
+      }
+   }
+
+   if (!loaded)
+   {
+      if (!database_index_rdb_scan(&rdb, db))
+      {
+         database_index_rdb_free(&rdb);
+         libretrodb_close(db);
+         libretrodb_free(db);
+         return NULL;
+      }
+
+      if (!string_is_empty(cache_path))
+         database_index_rdb_save(&rdb, cache_path, rdb_size, rdb_count,
+               rdb_path);
+   }
+
+   libretrodb_close(db);
+   libretrodb_free(db);
+
+   rdb.path_hash = path_hash;
+   rdb.path      = strdup(rdb_path);
+
+   index->rdbs[index->count] = rdb;
+   return &index->rdbs[index->count++];
+}
+
+static int database_index_offset_compare(const void *a, const void *b)
+{
+   uint64_t l = *(const uint64_t*)a;
+   uint64_t r = *(const uint64_t*)b;
+   return (l > r) - (l < r);
+}
+
+/* Reads the records at 'offsets' (sorted, so the list comes
+ * out in database order, as a query would return it) */
+static database_info_list_t *database_index_read_list(const char *rdb_path,
+      uint64_t *offsets, size_t count)
+{
+   size_t i;
+   database_info_list_t *list = (database_info_list_t*)
+      malloc(sizeof(*list));
+   libretrodb_t *db           = NULL;
+
+   if (!list)
+      return NULL;
+
+   list->count = 0;
+   list->list  = NULL;
+
+   if (count == 0)
+      return list;
+
+   if (!(list->list = (database_info_t*)calloc(count, sizeof(*list->list))))
+      goto error;
+
+   if (!(db = libretrodb_new()))
+      goto error;
+
+   if (libretrodb_open_mapped(rdb_path, db) != 0)
+      goto error;
+
+   qsort(offsets, count, sizeof(*offsets), database_index_offset_compare);
+
+   for (i = 0; i < count; i++)
+   {
+      struct rmsgpack_view item;
+
+      if (i > 0 && offsets[i] == offsets[i - 1])
+         continue;
+
+      if (libretrodb_read_view_at(db, offsets[i], &item) != 0)
+         continue;
+
+      if (database_info_from_view(&item,
+               &list->list[list->count]) == 0)
+         list->count++;
+   }
+
+   libretrodb_close(db);
+   libretrodb_free(db);
+
+   if (list->count == 0)
+   {
+      free(list->list);
+      list->list = NULL;
+   }
+
+   return list;
+
+error:
+   if (db)
+   {
+      libretrodb_close(db);
+      libretrodb_free(db);
+   }
+   if (list->list)
+      free(list->list);
+   free(list);
+   return NULL;
+}
+
+static bool database_index_collect(uint64_t **offsets,
+      size_t *count, size_t *capacity, uint64_t offset)
+{
+   if (*count == *capacity)
+   {
+      size_t new_capacity = *capacity ? *capacity * 2 : 8;
+      uint64_t *tmp       = (uint64_t*)realloc(*offsets,
+            new_capacity * sizeof(*tmp));
+
+      if (!tmp)
+         return false;
+
+      *offsets  = tmp;
+      *capacity = new_capacity;
+   }
+
+   (*offsets)[(*count)++] = offset;
+   return true;
+}
+
+database_info_index_t *database_info_index_new(const char *cache_dir)
+{
+   database_info_index_t *index = (database_info_index_t*)
+      calloc(1, sizeof(*index));
+
+   if (!index)
+      return NULL;
+
+   if (!string_is_empty(cache_dir) && path_is_directory(cache_dir))
+      strlcpy(index->cache_dir, cache_dir, sizeof(index->cache_dir));
+
+   return index;
+}
+
+void database_info_index_free(database_info_index_t *index)
+{
+   size_t i;
+
+   if (!index)
+      return;
+
+   for (i = 0; i < index->count; i++)
+      database_index_rdb_free(&index->rdbs[i]);
+
+   if (index->rdbs)
+      free(index->rdbs);
+   free(index);
+}
+
+database_info_list_t *database_info_index_find_crc(
+      database_info_index_t *index, const char *rdb_path,
+      uint32_t crc, uint32_t alt_crc)
+{
+   unsigned k;
+   database_info_list_t *list = NULL;
+   uint64_t *offsets          = NULL;
+   size_t count               = 0;
+   size_t capacity            = 0;
+   uint32_t keys[2];
+   database_index_rdb_t *rdb  = NULL;
+
+   if (!index || !(rdb = database_index_get_rdb(index, rdb_path)))
+      return NULL;
+
+   keys[0] = crc;
+   keys[1] = alt_crc;
+
+   for (k = 0; k < 2; k++)
+   {
+      uint32_t i;
+      uint32_t bucket = keys[k] & (rdb->crc.bucket_count - 1);
+
+      if (k == 1 && keys[1] == keys[0])
+         break;
+
+      for (i  = rdb->crc.buckets[bucket];
+           i  < rdb->crc.buckets[bucket + 1]; i++)
+      {
+         if (rdb->crc.entries[i].key == keys[k])
+            if (!database_index_collect(&offsets, &count, &capacity,
+                     rdb->crc.entries[i].offset))
+               goto end;
+      }
+   }
+
+   list = database_index_read_list(rdb_path, offsets, count);
+
+end:
+   if (offsets)
+      free(offsets);
+   return list;
+}
+
+database_info_list_t *database_info_index_find_serial(
+      database_info_index_t *index, const char *rdb_path,
+      const char *serial)
+{
+   uint32_t i;
+   uint32_t hash;
+   uint32_t bucket;
+   database_info_list_t *list = NULL;
+   uint64_t *offsets          = NULL;
+   size_t count               = 0;
+   size_t capacity            = 0;
+   database_index_rdb_t *rdb  = NULL;
+
+   if (!index || !(rdb = database_index_get_rdb(index, rdb_path)))
+      return NULL;
+
+   hash   = djb2_calculate(serial);
+   bucket = hash & (rdb->serial.bucket_count - 1);
+
+   for (i  = rdb->serial.buckets[bucket];
+        i  < rdb->serial.buckets[bucket + 1]; i++)
+   {
+      const database_index_entry_t *entry = &rdb->serial.entries[i];
+
+      if (     entry->key == hash
+            && entry->serial < rdb->serials_size
+            && string_is_equal(rdb->serials + entry->serial, serial))
+         if (!database_index_collect(&offsets, &count, &capacity,
+                  entry->offset))
+            goto end;
+   }
+
+   list = database_index_read_list(rdb_path, offsets, count);
+
+end:
+   if (offsets)
+      free(offsets);
+   return list;
+}
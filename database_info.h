@@ -125,6 +125,30 @@ database_info_list_t *database_info_list_new(const char *rdb_path,
 
 void database_info_list_free(database_info_list_t *list);
 
+typedef struct database_info_index database_info_index_t;
+
+/* Creates a lookup index for content scans. Per-database
+ * tables are built the first time a database is queried and,
+ * if @cache_dir is a valid directory, cached there so later
+ * scans can skip decoding the database entirely. */
+database_info_index_t *database_info_index_new(const char *cache_dir);
+
+void database_info_index_free(database_info_index_t *index);
+
+/* Returns all entries of @rdb_path whose crc is @crc or @alt_crc,
+ * in database order. Same result as database_info_list_new()
+ * with a "{crc:or(b\"...\",b\"...\")}" query. */
+database_info_list_t *database_info_index_find_crc(
+      database_info_index_t *index, const char *rdb_path,
+      uint32_t crc, uint32_t alt_crc);
+
+/* Returns all entries of @rdb_path whose serial is @serial,
+ * in database order. Same result as database_info_list_new()
+ * with a "{'serial': b'...'}" query. */
+database_info_list_t *database_info_index_find_serial(
+      database_info_index_t *index, const char *rdb_path,
+      const char *serial);
+
 database_info_handle_t *database_info_dir_init(const char *dir,
       enum database_type type, retro_task_t *task,
       bool show_hidden_files);
@@ -98,6 +98,28 @@ static bool gl_core_raster_font_upload_atlas(gl_core_raster_t *font)
    return true;
 }
 
+/* Uploads the part of the atlas which changed. */
+static void gl_core_raster_font_update_atlas(gl_core_raster_t *font)
+{
+   const struct font_atlas *atlas = font->atlas;
+
+   if (!font->tex || !atlas->dirty_width || !atlas->dirty_height)
+   {
+      gl_core_raster_font_upload_atlas(font);
+      return;
+   }
+
+   glBindTexture(GL_TEXTURE_2D, font->tex);
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   glPixelStorei(GL_UNPACK_ROW_LENGTH, atlas->width);
+   glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   glTexSubImage2D(GL_TEXTURE_2D, 0, atlas->dirty_x, atlas->dirty_y,
+                   atlas->dirty_width, atlas->dirty_height, GL_RED, GL_UNSIGNED_BYTE,
+                   atlas->buffer + atlas->dirty_y * atlas->width + atlas->dirty_x);
+   glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+   glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 static void *gl_core_raster_font_init_font(void *data,
       const char *font_path, float font_size,
       bool is_threaded)
@@ -174,7 +196,7 @@ static void gl_core_raster_font_draw_vertices(gl_core_raster_t *font,
 {
    if (font->atlas->dirty)
    {
-      gl_core_raster_font_upload_atlas(font);
+      gl_core_raster_font_update_atlas(font);
       font->atlas->dirty   = false;
    }
 
@@ -178,6 +178,66 @@ static bool gl_raster_font_upload_atlas(gl_raster_t *font)
    return true;
 }
 
+/* Uploads the part of the atlas which changed, the
+ * font texture must be bound. */
+static void gl_raster_font_update_atlas(gl_raster_t *font)
+{
+   unsigned i, j;
+   GLenum gl_format                     = GL_LUMINANCE_ALPHA;
+   size_t ncomponents                   = 2;
+   uint8_t       *tmp                   = NULL;
+   const struct font_atlas *atlas       = font->atlas;
+   unsigned width                       = atlas->dirty_width;
+   unsigned height                      = atlas->dirty_height;
+#if defined(GL_VERSION_3_0)
+   struct retro_hw_render_callback *hwr = video_driver_get_hw_context();
+#endif
+
+   if (!width || !height)
+   {
+      gl_raster_font_upload_atlas(font);
+      return;
+   }
+
+#if defined(GL_VERSION_3_0)
+   if (font->gl->core_context_in_use ||
+        (hwr->context_type == RETRO_HW_CONTEXT_OPENGL &&
+         hwr->version_major >= 3))
+   {
+      gl_format   = GL_RED;
+      ncomponents = 1;
+   }
+#endif
+
+   tmp = (uint8_t*)malloc(width * height * ncomponents);
+   if (!tmp)
+      return;
+
+   for (i = 0; i < height; ++i)
+   {
+      const uint8_t *src = &atlas->buffer[
+         (atlas->dirty_y + i) * atlas->width + atlas->dirty_x];
+      uint8_t       *dst = &tmp[i * width * ncomponents];
+
+      if (ncomponents == 1)
+         memcpy(dst, src, width);
+      else
+      {
+         for (j = 0; j < width; ++j)
+         {
+            *dst++ = 0xff;
+            *dst++ = *src++;
+         }
+      }
+   }
+
+   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+   glTexSubImage2D(GL_TEXTURE_2D, 0, atlas->dirty_x, atlas->dirty_y,
+         width, height, gl_format, GL_UNSIGNED_BYTE, tmp);
+
+   free(tmp);
+}
+
 static void *gl_raster_font_init_font(void *data,
       const char *font_path, float font_size,
       bool is_threaded)
@@ -265,7 +325,7 @@ static void gl_raster_font_draw_vertices(gl_raster_t *font,
 {
    if (font->atlas->dirty)
    {
-      gl_raster_font_upload_atlas(font);
+      gl_raster_font_update_atlas(font);
       font->atlas->dirty   = false;
    }
 
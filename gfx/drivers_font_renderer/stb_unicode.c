@@ -25,6 +25,7 @@
 #endif
 
 #include "../font_driver.h"
+#include "../font_atlas_cache.h"
 #include "../../verbosity.h"
 
 #ifndef STB_TRUETYPE_IMPLEMENTATION
@@ -40,15 +41,6 @@
 
 #define STB_UNICODE_ATLAS_ROWS 16
 #define STB_UNICODE_ATLAS_COLS 16
-#define STB_UNICODE_ATLAS_SIZE (STB_UNICODE_ATLAS_ROWS * STB_UNICODE_ATLAS_COLS)
-
-typedef struct stb_unicode_atlas_slot
-{
-   struct font_glyph glyph;
-   unsigned charcode;
-   unsigned last_used;
-   struct stb_unicode_atlas_slot* next;
-}stb_unicode_atlas_slot_t;
 
 typedef struct
 {
@@ -61,9 +53,7 @@ typedef struct
    float scale_factor;
 
    struct font_atlas atlas;
-   stb_unicode_atlas_slot_t atlas_slots[STB_UNICODE_ATLAS_SIZE];
-   stb_unicode_atlas_slot_t* uc_map[0x100];
-   unsigned usage_counter;
+   font_atlas_cache_t *cache;
 } stb_unicode_font_renderer_t;
 
 /* Ugly little thing... */
@@ -83,110 +73,67 @@ static void font_renderer_stb_unicode_free(void *data)
 {
    stb_unicode_font_renderer_t *self = (stb_unicode_font_renderer_t*)data;
 
+   font_atlas_cache_free(self->cache);
    free(self->atlas.buffer);
    free(self->font_data);
    free(self);
 }
 
-static stb_unicode_atlas_slot_t* font_renderer_stb_unicode_get_slot(stb_unicode_font_renderer_t *handle)
-{
-   int i, map_id;
-   unsigned oldest = 0;
-
-   for (i = 1; i < STB_UNICODE_ATLAS_SIZE; i++)
-      if((handle->usage_counter - handle->atlas_slots[i].last_used) >
-         (handle->usage_counter - handle->atlas_slots[oldest].last_used))
-         oldest = i;
-
-   /* remove from map */
-   map_id = handle->atlas_slots[oldest].charcode & 0xFF;
-   if(handle->uc_map[map_id] == &handle->atlas_slots[oldest])
-      handle->uc_map[map_id] = handle->atlas_slots[oldest].next;
-   else if (handle->uc_map[map_id])
-   {
-      stb_unicode_atlas_slot_t* ptr = handle->uc_map[map_id];
-      while(ptr->next && ptr->next != &handle->atlas_slots[oldest])
-         ptr = ptr->next;
-      ptr->next = handle->atlas_slots[oldest].next;
-   }
-
-   return &handle->atlas_slots[oldest];
-}
-
 static const struct font_glyph *font_renderer_stb_unicode_get_glyph(
       void *data, uint32_t charcode)
 {
    int glyph_index                      = 0;
    int x0                               = 0;
+   int y0                               = 0;
+   int x1                               = 0;
    int y1                               = 0;
    int advance_width                    = 0;
    int left_side_bearing                = 0;
-   unsigned map_id                      = 0;
-   uint8_t *dst                         = NULL;
-   stb_unicode_atlas_slot_t* atlas_slot = NULL;
+   struct font_glyph *glyph             = NULL;
+   const struct font_glyph *cached      = NULL;
    stb_unicode_font_renderer_t *self    = (stb_unicode_font_renderer_t*)data;
 
    if(!self)
       return NULL;
 
-   map_id                               = charcode & 0xFF;
-   atlas_slot                           = self->uc_map[map_id];
+   if ((cached = font_atlas_cache_find(self->cache, charcode)))
+      return cached;
 
-   while(atlas_slot)
-   {
-      if(atlas_slot->charcode == charcode)
-      {
-         atlas_slot->last_used = self->usage_counter++;
-         return &atlas_slot->glyph;
-      }
-      atlas_slot = atlas_slot->next;
-   }
+   glyph_index              = stbtt_FindGlyphIndex(&self->info, charcode);
 
-   atlas_slot             = font_renderer_stb_unicode_get_slot(self);
-   atlas_slot->charcode   = charcode;
-   atlas_slot->next       = self->uc_map[map_id];
-   self->uc_map[map_id] = atlas_slot;
+   stbtt_GetGlyphHMetrics(&self->info, glyph_index, &advance_width, &left_side_bearing);
 
-   glyph_index              = stbtt_FindGlyphIndex(&self->info, charcode);
+   /* Empty glyphs have an empty box and take no room in the atlas. */
+   stbtt_GetGlyphBitmapBox(&self->info, glyph_index,
+         self->scale_factor, self->scale_factor, &x0, &y0, &x1, &y1);
 
-   dst = (uint8_t*)self->atlas.buffer + atlas_slot->glyph.atlas_offset_x
-         + atlas_slot->glyph.atlas_offset_y * self->atlas.width;
+   glyph = font_atlas_cache_add(self->cache, charcode, x1 - x0, y1 - y0);
+   if (!glyph)
+      return NULL;
 
-   stbtt_GetGlyphHMetrics(&self->info, glyph_index, &advance_width, &left_side_bearing);
-   if (stbtt_GetGlyphBox(&self->info, glyph_index, &x0, NULL, NULL, &y1))
+   if (x1 > x0 && y1 > y0)
    {
-      stbtt_MakeGlyphBitmap(&self->info, dst, self->max_glyph_width, self->max_glyph_height,
+      uint8_t *dst = (uint8_t*)self->atlas.buffer + glyph->atlas_offset_x
+            + glyph->atlas_offset_y * self->atlas.width;
+
+      stbtt_MakeGlyphBitmap(&self->info, dst, x1 - x0, y1 - y0,
             self->atlas.width, self->scale_factor, self->scale_factor, glyph_index);
    }
-   else
-   {
-      /* This means the glyph is empty. In this case, stbtt_MakeGlyphBitmap()
-       * fills the corresponding region of the atlas buffer with garbage,
-       * so just zero it */
-      int x, y;
-      for (x = 0; x < self->max_glyph_width; x++)
-         for (y = 0; y < self->max_glyph_height; y++)
-            dst[x + (y * self->atlas.width)] = 0;
-   }
-
-   atlas_slot->glyph.width          = self->max_glyph_width;
-   atlas_slot->glyph.height         = self->max_glyph_height;
-   atlas_slot->glyph.advance_x      = round_away_from_zero((float)advance_width * self->scale_factor);
-   atlas_slot->glyph.advance_y      = 0;
-   atlas_slot->glyph.draw_offset_x  = round_away_from_zero((float)x0 * self->scale_factor);
-   atlas_slot->glyph.draw_offset_y  = round_away_from_zero((float)(-y1) * self->scale_factor);
 
-   self->atlas.dirty = true;
-   atlas_slot->last_used = self->usage_counter++;
-   return &atlas_slot->glyph;
+   glyph->width          = x1 - x0;
+   glyph->height         = y1 - y0;
+   glyph->advance_x      = round_away_from_zero((float)advance_width * self->scale_factor);
+   glyph->advance_y      = 0;
+   glyph->draw_offset_x  = x0;
+   glyph->draw_offset_y  = y0;
 
+   return glyph;
 }
 
 static bool font_renderer_stb_unicode_create_atlas(
       stb_unicode_font_renderer_t *self, float font_size)
 {
-   unsigned i, x, y;
-   stb_unicode_atlas_slot_t* slot = NULL;
+   unsigned i;
 
    self->max_glyph_width  = font_size < 0 ? -font_size : font_size;
    self->max_glyph_height = font_size < 0 ? -font_size : font_size;
@@ -200,17 +147,8 @@ static bool font_renderer_stb_unicode_create_atlas(
    if (!self->atlas.buffer)
       return false;
 
-   slot = self->atlas_slots;
-
-   for (y = 0; y < STB_UNICODE_ATLAS_ROWS; y++)
-   {
-      for (x = 0; x < STB_UNICODE_ATLAS_COLS; x++)
-      {
-         slot->glyph.atlas_offset_x = x * self->max_glyph_width;
-         slot->glyph.atlas_offset_y = y * self->max_glyph_height;
-         slot++;
-      }
-   }
+   if (!(self->cache = font_atlas_cache_new(&self->atlas)))
+      return false;
 
    for (i = 0; i < 256; i++)
       font_renderer_stb_unicode_get_glyph(self, i);
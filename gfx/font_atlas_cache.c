@@ -0,0 +1,420 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_miscellaneous.h>
+
+#include "font_atlas_cache.h"
+
+#define FONT_ATLAS_CACHE_BUCKET_BITS 11
+#define FONT_ATLAS_CACHE_BUCKETS     (1 << FONT_ATLAS_CACHE_BUCKET_BITS)
+
+/* Empty texels right and below of every glyph, so that
+ * linear filtering never picks up a neighbour. */
+#define FONT_ATLAS_CACHE_PADDING     1
+
+/* Shelf heights are rounded up to this, so that glyphs
+ * of about the same height share shelves. */
+#define FONT_ATLAS_CACHE_SHELF_ALIGN 4
+
+/* Glyphs only go to shelves at most half again as tall,
+ * unless this many evictions didn't make room for them. */
+#define FONT_ATLAS_CACHE_RELAX       16
+
+typedef struct font_atlas_cache_entry
+{
+   struct font_glyph glyph;
+   uint32_t code;
+
+   struct font_atlas_cache_entry *hash_next;
+   struct font_atlas_cache_entry *lru_prev;
+   struct font_atlas_cache_entry *lru_next;
+
+   /* Next free entry, or next hole of the shelf. */
+   struct font_atlas_cache_entry *free_next;
+
+   /* Room taken in the shelf, including padding.
+    * Shelf is -1 for glyphs without a bitmap. */
+   int shelf;
+   unsigned x;
+   unsigned width;
+} font_atlas_cache_entry_t;
+
+typedef struct font_atlas_cache_shelf
+{
+   unsigned y;
+   unsigned height;
+   /* First column nothing has been packed at. */
+   unsigned x;
+   unsigned glyphs;
+   /* Room of evicted glyphs left of x. */
+   font_atlas_cache_entry_t *holes;
+} font_atlas_cache_shelf_t;
+
+struct font_atlas_cache
+{
+   struct font_atlas *atlas;
+
+   /* Room to pack into, the padding of glyphs at the
+    * right and bottom edges may fall outside the atlas. */
+   unsigned space_width;
+   unsigned space_height;
+
+   font_atlas_cache_shelf_t *shelves;
+   unsigned num_shelves;
+   unsigned max_shelves;
+   /* Top of the room below the shelves. */
+   unsigned shelves_bottom;
+
+   font_atlas_cache_entry_t *free_entries;
+   font_atlas_cache_entry_t *buckets[FONT_ATLAS_CACHE_BUCKETS];
+   /* Sentinel of the LRU list, next is the least recently used. */
+   font_atlas_cache_entry_t lru;
+
+   font_atlas_cache_stats_t stats;
+   font_atlas_cache_entry_t entries[FONT_ATLAS_CACHE_GLYPHS];
+};
+
+static INLINE unsigned font_atlas_cache_hash(uint32_t code)
+{
+   return (code * 2654435761u) >> (32 - FONT_ATLAS_CACHE_BUCKET_BITS);
+}
+
+static INLINE void font_atlas_cache_lru_unlink(font_atlas_cache_entry_t *entry)
+{
+   entry->lru_prev->lru_next = entry->lru_next;
+   entry->lru_next->lru_prev = entry->lru_prev;
+}
+
+static INLINE void font_atlas_cache_lru_push(font_atlas_cache_t *cache,
+      font_atlas_cache_entry_t *entry)
+{
+   entry->lru_prev           = cache->lru.lru_prev;
+   entry->lru_next           = &cache->lru;
+   cache->lru.lru_prev->lru_next = entry;
+   cache->lru.lru_prev       = entry;
+}
+
+static void font_atlas_cache_mark_dirty(struct font_atlas *atlas,
+      unsigned x, unsigned y, unsigned width, unsigned height)
+{
+   unsigned right, bottom;
+
+   if (!atlas->dirty)
+   {
+      atlas->dirty_x      = x;
+      atlas->dirty_y      = y;
+      atlas->dirty_width  = width;
+      atlas->dirty_height = height;
+      atlas->dirty        = true;
+      return;
+   }
+
+   /* An empty rectangle already covers the whole atlas. */
+   if (!atlas->dirty_width || !atlas->dirty_height)
+      return;
+
+   right               = MAX(atlas->dirty_x + atlas->dirty_width,  x + width);
+   bottom              = MAX(atlas->dirty_y + atlas->dirty_height, y + height);
+   atlas->dirty_x      = MIN(atlas->dirty_x, x);
+   atlas->dirty_y      = MIN(atlas->dirty_y, y);
+   atlas->dirty_width  = right  - atlas->dirty_x;
+   atlas->dirty_height = bottom - atlas->dirty_y;
+}
+
+static void font_atlas_cache_reset_shelf(font_atlas_cache_t *cache,
+      font_atlas_cache_shelf_t *shelf)
+{
+   while (shelf->holes)
+   {
+      font_atlas_cache_entry_t *hole = shelf->holes;
+      shelf->holes                   = hole->free_next;
+      hole->free_next                = cache->free_entries;
+      cache->free_entries            = hole;
+   }
+
+   shelf->x = 0;
+
+   /* Drop empty shelves at the bottom, so that the room
+    * can be split again for glyphs of another height. */
+   while (cache->num_shelves
+         && !cache->shelves[cache->num_shelves - 1].glyphs)
+   {
+      cache->num_shelves--;
+      cache->shelves_bottom = cache->shelves[cache->num_shelves].y;
+   }
+}
+
+/* Removes the least recently used glyph. With @reclaim its
+ * entry is always freed, even if its room can't be reused
+ * until the rest of its shelf is evicted. */
+static bool font_atlas_cache_evict(font_atlas_cache_t *cache, bool reclaim)
+{
+   font_atlas_cache_entry_t **link;
+   font_atlas_cache_entry_t *entry = cache->lru.lru_next;
+
+   if (entry == &cache->lru)
+      return false;
+
+   font_atlas_cache_lru_unlink(entry);
+
+   for (link = &cache->buckets[font_atlas_cache_hash(entry->code)];
+         *link != entry; link = &(*link)->hash_next);
+   *link = entry->hash_next;
+
+   cache->stats.evictions++;
+   cache->stats.glyphs--;
+
+   if (entry->shelf >= 0)
+   {
+      font_atlas_cache_shelf_t *shelf = &cache->shelves[entry->shelf];
+
+      if (--shelf->glyphs == 0)
+         font_atlas_cache_reset_shelf(cache, shelf);
+      else if (entry->x + entry->width == shelf->x)
+         shelf->x = entry->x;
+      else if (!reclaim)
+      {
+         entry->free_next = shelf->holes;
+         shelf->holes     = entry;
+         return true;
+      }
+   }
+
+   entry->free_next    = cache->free_entries;
+   cache->free_entries = entry;
+   return true;
+}
+
+/* Finds room for a glyph of @width x @height texels
+ * including padding, in the shelf fitting it best. */
+static font_atlas_cache_entry_t *font_atlas_cache_place(
+      font_atlas_cache_t *cache, unsigned width, unsigned height,
+      bool relaxed)
+{
+   unsigned i;
+   font_atlas_cache_shelf_t *shelf  = NULL;
+   font_atlas_cache_entry_t **hole  = NULL;
+   font_atlas_cache_entry_t *entry  = NULL;
+   unsigned max_height              = relaxed
+      ? cache->space_height : height + height / 2;
+
+   for (i = 0; i < cache->num_shelves; i++)
+   {
+      font_atlas_cache_shelf_t *s     = &cache->shelves[i];
+      font_atlas_cache_entry_t **link = NULL;
+
+      if (s->height < height || s->height > max_height)
+         continue;
+      if (shelf && s->height >= shelf->height)
+         continue;
+
+      if (s->x + width > cache->space_width)
+      {
+         for (link = &s->holes; *link; link = &(*link)->free_next)
+            if ((*link)->width >= width)
+               break;
+         if (!*link)
+            continue;
+      }
+
+      shelf = s;
+      hole  = link;
+   }
+
+   if (hole)
+   {
+      entry     = *hole;
+      *hole     = entry->free_next;
+   }
+   else
+   {
+      unsigned shelf_height = (height + FONT_ATLAS_CACHE_SHELF_ALIGN - 1)
+         & ~(FONT_ATLAS_CACHE_SHELF_ALIGN - 1);
+
+      /* Start a new shelf if none fits the glyph well. */
+      if ((!shelf || shelf->height > shelf_height)
+            && cache->num_shelves < cache->max_shelves
+            && cache->shelves_bottom + height <= cache->space_height)
+      {
+         shelf                 = &cache->shelves[cache->num_shelves++];
+         shelf->y              = cache->shelves_bottom;
+         shelf->height         = MIN(shelf_height,
+               cache->space_height - cache->shelves_bottom);
+         shelf->x              = 0;
+         shelf->glyphs         = 0;
+         shelf->holes          = NULL;
+         cache->shelves_bottom += shelf->height;
+      }
+
+      if (!shelf)
+         return NULL;
+
+      entry               = cache->free_entries;
+      cache->free_entries = entry->free_next;
+      entry->x            = shelf->x;
+      entry->width        = width;
+      shelf->x           += width;
+   }
+
+   entry->shelf = (int)(shelf - cache->shelves);
+   shelf->glyphs++;
+   return entry;
+}
+
+font_atlas_cache_t *font_atlas_cache_new(struct font_atlas *atlas)
+{
+   unsigned i;
+   font_atlas_cache_t *cache = NULL;
+
+   if (!atlas || !atlas->buffer || !atlas->width || !atlas->height)
+      return NULL;
+
+   cache                     = (font_atlas_cache_t*)calloc(1, sizeof(*cache));
+   if (!cache)
+      return NULL;
+
+   cache->atlas              = atlas;
+   cache->space_width        = atlas->width  + FONT_ATLAS_CACHE_PADDING;
+   cache->space_height       = atlas->height + FONT_ATLAS_CACHE_PADDING;
+   cache->max_shelves        = cache->space_height
+      / FONT_ATLAS_CACHE_SHELF_ALIGN + 1;
+   cache->shelves            = (font_atlas_cache_shelf_t*)calloc(
+         cache->max_shelves, sizeof(*cache->shelves));
+
+   if (!cache->shelves)
+   {
+      free(cache);
+      return NULL;
+   }
+
+   cache->lru.lru_prev       = &cache->lru;
+   cache->lru.lru_next       = &cache->lru;
+
+   for (i = FONT_ATLAS_CACHE_GLYPHS; i-- > 0; )
+   {
+      cache->entries[i].free_next = cache->free_entries;
+      cache->free_entries         = &cache->entries[i];
+   }
+
+   return cache;
+}
+
+void font_atlas_cache_free(font_atlas_cache_t *cache)
+{
+   if (!cache)
+      return;
+
+   free(cache->shelves);
+   free(cache);
+}
+
+const struct font_glyph *font_atlas_cache_find(font_atlas_cache_t *cache,
+      uint32_t code)
+{
+   font_atlas_cache_entry_t *entry =
+      cache->buckets[font_atlas_cache_hash(code)];
+
+   for (; entry; entry = entry->hash_next)
+   {
+      if (entry->code != code)
+         continue;
+
+      font_atlas_cache_lru_unlink(entry);
+      font_atlas_cache_lru_push(cache, entry);
+      cache->stats.hits++;
+      return &entry->glyph;
+   }
+
+   cache->stats.misses++;
+   return NULL;
+}
+
+struct font_glyph *font_atlas_cache_add(font_atlas_cache_t *cache,
+      uint32_t code, unsigned width, unsigned height)
+{
+   unsigned bucket;
+   font_atlas_cache_entry_t *entry = NULL;
+   struct font_atlas *atlas        = cache->atlas;
+
+   if (width > atlas->width || height > atlas->height)
+      return NULL;
+
+   if (!cache->free_entries)
+      font_atlas_cache_evict(cache, true);
+
+   if (!width || !height)
+   {
+      entry               = cache->free_entries;
+      cache->free_entries = entry->free_next;
+      entry->shelf        = -1;
+      entry->x            = 0;
+      entry->width        = 0;
+   }
+   else
+   {
+      unsigned evictions = 0;
+
+      width  += FONT_ATLAS_CACHE_PADDING;
+      height += FONT_ATLAS_CACHE_PADDING;
+
+      while (!(entry = font_atlas_cache_place(cache, width, height,
+                  evictions >= FONT_ATLAS_CACHE_RELAX)))
+      {
+         if (!font_atlas_cache_evict(cache, false))
+            return NULL;
+         evictions++;
+      }
+   }
+
+   memset(&entry->glyph, 0, sizeof(entry->glyph));
+   entry->code      = code;
+
+   if (entry->shelf >= 0)
+   {
+      unsigned y;
+      const font_atlas_cache_shelf_t *shelf = &cache->shelves[entry->shelf];
+      unsigned clear_width  = MIN(width,  atlas->width  - entry->x);
+      unsigned clear_height = MIN(height, atlas->height - shelf->y);
+      uint8_t *dst          = atlas->buffer
+         + shelf->y * atlas->width + entry->x;
+
+      for (y = 0; y < clear_height; y++, dst += atlas->width)
+         memset(dst, 0, clear_width);
+
+      entry->glyph.atlas_offset_x = entry->x;
+      entry->glyph.atlas_offset_y = shelf->y;
+
+      font_atlas_cache_mark_dirty(atlas, entry->x, shelf->y,
+            clear_width, clear_height);
+   }
+
+   bucket                 = font_atlas_cache_hash(code);
+   entry->hash_next       = cache->buckets[bucket];
+   cache->buckets[bucket] = entry;
+   font_atlas_cache_lru_push(cache, entry);
+   cache->stats.glyphs++;
+
+   return &entry->glyph;
+}
+
+void font_atlas_cache_get_stats(const font_atlas_cache_t *cache,
+      font_atlas_cache_stats_t *stats)
+{
+   *stats = cache->stats;
+}
@@ -0,0 +1,93 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FONT_ATLAS_CACHE_H
+#define __FONT_ATLAS_CACHE_H
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+#include "font_driver.h"
+
+/* Most glyphs a cache holds at once, whatever their size. */
+#define FONT_ATLAS_CACHE_GLYPHS 1024
+
+RETRO_BEGIN_DECLS
+
+typedef struct font_atlas_cache font_atlas_cache_t;
+
+typedef struct font_atlas_cache_stats
+{
+   unsigned hits;
+   unsigned misses;
+   unsigned evictions;
+   unsigned glyphs;
+} font_atlas_cache_stats_t;
+
+/**
+ * font_atlas_cache_new:
+ * @atlas        : Atlas the glyphs are packed into. Its buffer and
+ *                 size must be set and outlive the cache.
+ *
+ * Creates a glyph cache which packs glyphs of any size into
+ * shelves of the atlas and evicts the least recently used ones
+ * when it runs out of room.
+ *
+ * Returns: the cache, or NULL on allocation failure.
+ **/
+font_atlas_cache_t *font_atlas_cache_new(struct font_atlas *atlas);
+
+void font_atlas_cache_free(font_atlas_cache_t *cache);
+
+/**
+ * font_atlas_cache_find:
+ * @cache        : The cache.
+ * @code         : Character code.
+ *
+ * Looks up a cached glyph and marks it as the most recently used.
+ *
+ * Returns: the glyph, or NULL if it isn't cached.
+ **/
+const struct font_glyph *font_atlas_cache_find(font_atlas_cache_t *cache,
+      uint32_t code);
+
+/**
+ * font_atlas_cache_add:
+ * @cache        : The cache.
+ * @code         : Character code, must not be cached yet.
+ * @width        : Width of the glyph bitmap in texels.
+ * @height       : Height of the glyph bitmap in texels.
+ *
+ * Reserves room for a glyph bitmap, evicting the least recently
+ * used glyphs as needed. The room is cleared and added to the
+ * dirty rectangle of the atlas, the caller rasterizes the glyph
+ * at its atlas offsets and fills in the rest of its metrics.
+ * Glyphs without a bitmap take no room at all.
+ *
+ * Returns: the glyph, valid until it is evicted, or NULL if
+ * it is larger than the atlas.
+ **/
+struct font_glyph *font_atlas_cache_add(font_atlas_cache_t *cache,
+      uint32_t code, unsigned width, unsigned height);
+
+void font_atlas_cache_get_stats(const font_atlas_cache_t *cache,
+      font_atlas_cache_stats_t *stats);
+
+RETRO_END_DECLS
+
+#endif
@@ -1076,12 +1076,39 @@ void font_driver_flush(unsigned width, unsigned height, void *font_data,
 int font_driver_get_message_width(void *font_data,
       const char *msg, unsigned len, float scale)
 {
+   unsigned i;
+   uint32_t hash;
+   font_width_cache_entry_t *entry = NULL;
    font_data_t *font = (font_data_t*)(font_data ? font_data : video_font_driver);
    if (len == 0 && msg)
       len = (unsigned)strlen(msg);
-   if (font && font->renderer && font->renderer->get_message_width)
+   if (!font || !font->renderer || !font->renderer->get_message_width)
+      return -1;
+
+   /* Menu drivers measure the same labels every frame,
+    * while glyph metrics never change for a font. */
+   if (!msg || len > FONT_WIDTH_CACHE_MSG_LEN)
       return font->renderer->get_message_width(font->renderer_data, msg, len, scale);
-   return -1;
+
+   hash  = 5381;
+   for (i = 0; i < len; i++)
+      hash = (hash << 5) + hash + (uint8_t)msg[i];
+   hash ^= len;
+
+   entry = &font->width_cache[hash & (FONT_WIDTH_CACHE_SIZE - 1)];
+
+   if (     entry->hash  == hash
+         && entry->len   == len
+         && entry->scale == scale
+         && !memcmp(entry->msg, msg, len))
+      return entry->width;
+
+   entry->hash  = hash;
+   entry->len   = len;
+   entry->scale = scale;
+   entry->width = font->renderer->get_message_width(font->renderer_data, msg, len, scale);
+   memcpy(entry->msg, msg, len);
+   return entry->width;
 }
 
 int font_driver_get_line_height(void *font_data, float scale)
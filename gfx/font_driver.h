@@ -58,6 +58,13 @@ struct font_atlas
    uint8_t *buffer; /* Alpha channel. */
    unsigned width;
    unsigned height;
+
+   /* Part of the buffer changed since dirty was last cleared,
+    * an empty rectangle means all of it. */
+   unsigned dirty_x;
+   unsigned dirty_y;
+   unsigned dirty_width;
+   unsigned dirty_height;
    bool dirty;
 };
 
@@ -117,11 +124,27 @@ typedef struct font_renderer_driver
    int (*get_line_height)(void* data);
 } font_renderer_driver_t;
 
+/* Messages at most this long have their width cached. */
+#define FONT_WIDTH_CACHE_MSG_LEN 63
+#define FONT_WIDTH_CACHE_SIZE    256
+
+typedef struct font_width_cache_entry
+{
+   uint32_t hash;
+   unsigned len;
+   float scale;
+   int width;
+   char msg[FONT_WIDTH_CACHE_MSG_LEN];
+} font_width_cache_entry_t;
+
 typedef struct
 {
    const font_renderer_t *renderer;
    void *renderer_data;
    float size;
+
+   /* Widths of recently measured messages, by hash. */
+   font_width_cache_entry_t width_cache[FONT_WIDTH_CACHE_SIZE];
 } font_data_t;
 
 /* font_path can be NULL for default font. */
@@ -33,6 +33,7 @@
 #include "../performance_counters.h"
 #include "../verbosity.h"
 #include "video_filter.h"
+#include "video_frame_jobs.h"
 #include "video_filters/softfilter.h"
 
 struct rarch_soft_plug
@@ -43,47 +44,6 @@ struct rarch_soft_plug
    const struct softfilter_implementation *impl;
 };
 
-#ifdef HAVE_THREADS
-#include <rthreads/rthreads.h>
-
-struct filter_thread_data
-{
-   sthread_t *thread;
-   const struct softfilter_work_packet *packet;
-   scond_t *cond;
-   slock_t *lock;
-   void *userdata;
-   bool die;
-   bool done;
-};
-
-static void filter_thread_loop(void *data)
-{
-   struct filter_thread_data *thr = (struct filter_thread_data*)data;
-
-   for (;;)
-   {
-      bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
-
-      if (die)
-         break;
-
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
-
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
-   }
-}
-#endif
-
 struct rarch_softfilter
 {
    config_file_t *conf;
@@ -100,9 +60,7 @@ struct rarch_softfilter
    struct softfilter_work_packet *packets;
    unsigned threads;
 
-#ifdef HAVE_THREADS
-   struct filter_thread_data *thread_data;
-#endif
+   video_frame_jobs_t *jobs;
 };
 
 static const struct softfilter_implementation *
@@ -134,12 +92,10 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
       softfilter_simd_mask_t cpu_features,
       unsigned threads)
 {
-   unsigned input_fmts, input_fmt, output_fmts, i = 0;
+   unsigned input_fmts, input_fmt, output_fmts;
    struct config_file_userdata userdata;
    char key[64], name[64];
 
-   (void)i;
-
    key[0] = name[0] = '\0';
 
    snprintf(key, sizeof(key), "filter");
@@ -207,11 +163,16 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    filt->max_width = max_width;
    filt->max_height = max_height;
 
+   /* Work packets are row bands run on the shared frame job pool,
+    * sized for an input row and the 2x2 output it turns into. */
+   filt->jobs = video_frame_jobs_shared();
+   if (threads == RARCH_SOFTFILTER_THREADS_AUTO)
+      threads = video_frame_jobs_bands(filt->jobs, max_height,
+            max_width * sizeof(uint32_t) * 5);
+
    filt->impl_data = filt->impl->create(
          &softfilter_config, input_fmt, input_fmt, max_width, max_height,
-         threads != RARCH_SOFTFILTER_THREADS_AUTO ? threads :
-         cpu_features_get_core_amount(), cpu_features,
-         &userdata);
+         threads, cpu_features, &userdata);
    if (!filt->impl_data)
    {
       RARCH_ERR("Failed to create softfilter state.\n");
@@ -226,7 +187,8 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    }
 
    filt->threads = threads;
-   RARCH_LOG("Using %u threads for softfilter.\n", threads);
+   RARCH_LOG("Using %u work packets on %u threads for softfilter.\n",
+         threads, video_frame_jobs_num_threads(filt->jobs));
 
    filt->packets = (struct softfilter_work_packet*)
       calloc(threads, sizeof(*filt->packets));
@@ -236,32 +198,6 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
       return false;
    }
 
-#ifdef HAVE_THREADS
-   if(filt->threads>1){
-      filt->thread_data = (struct filter_thread_data*)
-         calloc(threads, sizeof(*filt->thread_data));
-      if (!filt->thread_data)
-         return false;
-
-      for (i = 0; i < threads; i++)
-      {
-         filt->thread_data[i].userdata = filt->impl_data;
-         filt->thread_data[i].done = true;
-
-         filt->thread_data[i].lock = slock_new();
-         if (!filt->thread_data[i].lock)
-            return false;
-         filt->thread_data[i].cond = scond_new();
-         if (!filt->thread_data[i].cond)
-            return false;
-         filt->thread_data[i].thread = sthread_create(
-               filter_thread_loop, &filt->thread_data[i]);
-         if (!filt->thread_data[i].thread)
-            return false;
-      }
-   }
-#endif
-
    return true;
 }
 
@@ -476,24 +412,6 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
    free(filt->plugs);
 #endif
 
-#ifdef HAVE_THREADS
-   if(filt->threads>1){
-      for (i = 0; i < filt->threads; i++)
-      {
-         if (!filt->thread_data[i].thread)
-            continue;
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].die = true;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-         sthread_join(filt->thread_data[i].thread);
-         slock_free(filt->thread_data[i].lock);
-         scond_free(filt->thread_data[i].cond);
-      }
-      free(filt->thread_data);
-   }
-#endif
-
    if (filt->conf)
       config_file_free(filt->conf);
 
@@ -522,13 +440,19 @@ enum retro_pixel_format rarch_softfilter_get_output_format(
    return filt->out_pix_fmt;
 }
 
+static void softfilter_job(void *data, unsigned index)
+{
+   rarch_softfilter_t *filt = (rarch_softfilter_t*)data;
+
+   filt->packets[index].work(filt->impl_data,
+         filt->packets[index].thread_data);
+}
+
 void rarch_softfilter_process(rarch_softfilter_t *filt,
       void *output, size_t output_stride,
       const void *input, unsigned width, unsigned height,
       size_t input_stride)
 {
-   unsigned i;
-
    if (!filt)
       return;
 
@@ -536,38 +460,5 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
       filt->impl->get_work_packets(filt->impl_data, filt->packets,
             output, output_stride, input, width, height, input_stride);
 
-#ifdef HAVE_THREADS
-   if(filt->threads>1){
-      /* Fire off workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Firing off filter thread %u ...\n", i);
-#endif
-         filt->thread_data[i].packet = &filt->packets[i];
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].done = false;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-      }
-
-      /* Wait for workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Waiting for filter thread %u ...\n", i);
-#endif
-         slock_lock(filt->thread_data[i].lock);
-         while (!filt->thread_data[i].done)
-            scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-         slock_unlock(filt->thread_data[i].lock);
-      }
-   } else {
-      for (i = 0; i < filt->threads; i++)
-         filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
-   }
-#else
-   for (i = 0; i < filt->threads; i++)
-      filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
-#endif
+   video_frame_jobs_run(filt->jobs, softfilter_job, filt, filt->threads);
 }
@@ -232,6 +232,8 @@ static void *twoxbr_generic_create(const struct softfilter_config *config,
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
+   /* Rows at the band edges are filtered differently, so the
+    * frame is not split. */
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
    if (!filt->workers)
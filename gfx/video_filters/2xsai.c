@@ -15,6 +15,7 @@
  */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -39,11 +40,208 @@ struct softfilter_thread_data
    int last;
 };
 
+/* Processes pixels 0 and up of a row, returns the first pixel
+ * left for the scalar loop. */
+typedef unsigned (*twoxsai_row_t)(const void *in, unsigned nextline,
+      void *out0, void *out1, unsigned width);
+
 struct filter_data
 {
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   twoxsai_row_t row;
+};
+
+/* The interpolation masks of twoxsai_interpolate(2)_*,
+ * by lane width. */
+#define TWOXSAI_HALF_16          0xF7DE
+#define TWOXSAI_HALF_LOW_16      0x0821
+#define TWOXSAI_QUARTER_16       0xE79C
+#define TWOXSAI_QUARTER_LOW_16   0x1863
+#define TWOXSAI_HALF_32          0xFEFEFEFE
+#define TWOXSAI_HALF_LOW_32      0x01010101
+#define TWOXSAI_QUARTER_32       0xFCFCFCFC
+#define TWOXSAI_QUARTER_LOW_32   0x03030303
+
+/* twoxsai_function, a vector of pixels at a time. Every branch
+ * becomes a lane mask, the products are picked with them.
+ * The interpolations don't carry out of a 16-bit lane. */
+#define TWOXSAI_SIMD_ROW(isa, bits) \
+static INLINE SOFTFILTER_TARGET_##isa SF(isa, t) twoxsai_interpolate_##isa##_##bits( \
+      SF(isa, t) a, SF(isa, t) b) \
+{ \
+   SF(isa, t) half = SF(isa, set##bits)(TWOXSAI_HALF_##bits); \
+   return SF(isa, add##bits)(SF(isa, add##bits)( \
+            SF(isa, srl##bits)(SF(isa, and)(a, half), 1), \
+            SF(isa, srl##bits)(SF(isa, and)(b, half), 1)), \
+         SF(isa, and)(SF(isa, and)(a, b), SF(isa, set##bits)(TWOXSAI_HALF_LOW_##bits))); \
+} \
+\
+static INLINE SOFTFILTER_TARGET_##isa SF(isa, t) twoxsai_interpolate2_##isa##_##bits( \
+      SF(isa, t) a, SF(isa, t) b, SF(isa, t) c, SF(isa, t) d) \
+{ \
+   SF(isa, t) quarter     = SF(isa, set##bits)(TWOXSAI_QUARTER_##bits); \
+   SF(isa, t) quarter_low = SF(isa, set##bits)(TWOXSAI_QUARTER_LOW_##bits); \
+   SF(isa, t) high        = SF(isa, add##bits)( \
+         SF(isa, add##bits)( \
+            SF(isa, srl##bits)(SF(isa, and)(a, quarter), 2), \
+            SF(isa, srl##bits)(SF(isa, and)(b, quarter), 2)), \
+         SF(isa, add##bits)( \
+            SF(isa, srl##bits)(SF(isa, and)(c, quarter), 2), \
+            SF(isa, srl##bits)(SF(isa, and)(d, quarter), 2))); \
+   SF(isa, t) low         = SF(isa, add##bits)( \
+         SF(isa, add##bits)(SF(isa, and)(a, quarter_low), SF(isa, and)(b, quarter_low)), \
+         SF(isa, add##bits)(SF(isa, and)(c, quarter_low), SF(isa, and)(d, quarter_low))); \
+   return SF(isa, add##bits)(high, \
+         SF(isa, and)(SF(isa, srl##bits)(low, 2), quarter_low)); \
+} \
+\
+static SOFTFILTER_TARGET_##isa unsigned twoxsai_row_##isa##_##bits( \
+      const void *in_data, unsigned nextline, \
+      void *out0_data, void *out1_data, unsigned width) \
+{ \
+   const uint##bits##_t *in    = (const uint##bits##_t*)in_data; \
+   const uint##bits##_t *up    = in - nextline; \
+   const uint##bits##_t *down  = in + nextline; \
+   const uint##bits##_t *down2 = down + nextline; \
+   uint##bits##_t *out0        = (uint##bits##_t*)out0_data; \
+   uint##bits##_t *out1        = (uint##bits##_t*)out1_data; \
+   const unsigned n            = SF(isa, bytes) / (bits / 8); \
+   unsigned x; \
+   \
+   for (x = 0; x + n <= width; x += n) \
+   { \
+      SF(isa, t) lo, hi, r; \
+      SF(isa, t) c1, c2, c3, c4; \
+      SF(isa, t) pA, pB, qA, qC; \
+      SF(isa, t) product_A, product_B, product1_A, product1_C, product2_A, product2_B; \
+      SF(isa, t) colorI = SF(isa, load)(up + x - 1); \
+      SF(isa, t) colorE = SF(isa, load)(up + x); \
+      SF(isa, t) colorF = SF(isa, load)(up + x + 1); \
+      SF(isa, t) colorJ = SF(isa, load)(up + x + 2); \
+      SF(isa, t) colorG = SF(isa, load)(in + x - 1); \
+      SF(isa, t) colorA = SF(isa, load)(in + x); \
+      SF(isa, t) colorB = SF(isa, load)(in + x + 1); \
+      SF(isa, t) colorK = SF(isa, load)(in + x + 2); \
+      SF(isa, t) colorH = SF(isa, load)(down + x - 1); \
+      SF(isa, t) colorC = SF(isa, load)(down + x); \
+      SF(isa, t) colorD = SF(isa, load)(down + x + 1); \
+      SF(isa, t) colorL = SF(isa, load)(down + x + 2); \
+      SF(isa, t) colorM = SF(isa, load)(down2 + x - 1); \
+      SF(isa, t) colorN = SF(isa, load)(down2 + x); \
+      SF(isa, t) colorO = SF(isa, load)(down2 + x + 1); \
+      SF(isa, t) zero   = SF(isa, xor)(colorA, colorA); \
+      SF(isa, t) ones   = SF(isa, cmpeq##bits)(colorA, colorA); \
+      SF(isa, t) eqAD   = SF(isa, cmpeq##bits)(colorA, colorD); \
+      SF(isa, t) eqBC   = SF(isa, cmpeq##bits)(colorB, colorC); \
+      SF(isa, t) eqAF   = SF(isa, cmpeq##bits)(colorA, colorF); \
+      SF(isa, t) eqAH   = SF(isa, cmpeq##bits)(colorA, colorH); \
+      SF(isa, t) eqAI   = SF(isa, cmpeq##bits)(colorA, colorI); \
+      SF(isa, t) eqBE   = SF(isa, cmpeq##bits)(colorB, colorE); \
+      SF(isa, t) eqCG   = SF(isa, cmpeq##bits)(colorC, colorG); \
+      \
+      /* The four branches */ \
+      c1 = SF(isa, andnot)(eqAD, eqBC); \
+      c2 = SF(isa, andnot)(eqBC, eqAD); \
+      c3 = SF(isa, and)(eqAD, eqBC); \
+      c4 = SF(isa, andnot)(ones, SF(isa, or)(eqAD, eqBC)); \
+      \
+      pA = SF(isa, andnot)(SF(isa, and)(SF(isa, and)( \
+                  SF(isa, cmpeq##bits)(colorA, colorC), eqAF), \
+               SF(isa, cmpeq##bits)(colorB, colorJ)), eqBE); \
+      pB = SF(isa, andnot)(SF(isa, and)(SF(isa, and)( \
+                  eqBE, SF(isa, cmpeq##bits)(colorB, colorD)), eqAI), eqAF); \
+      qA = SF(isa, andnot)(SF(isa, and)(SF(isa, and)( \
+                  SF(isa, cmpeq##bits)(colorA, colorB), eqAH), \
+               SF(isa, cmpeq##bits)(colorC, colorM)), eqCG); \
+      qC = SF(isa, andnot)(SF(isa, and)(SF(isa, and)( \
+                  eqCG, SF(isa, cmpeq##bits)(colorC, colorD)), eqAI), eqAH); \
+      \
+      product_A  = SF(isa, or)(SF(isa, and)(c1, SF(isa, or)(pA, SF(isa, and)( \
+                     SF(isa, cmpeq##bits)(colorA, colorE), \
+                     SF(isa, cmpeq##bits)(colorB, colorL)))), \
+                  SF(isa, and)(c4, pA)); \
+      product_B  = SF(isa, or)(SF(isa, and)(c2, SF(isa, or)(pB, SF(isa, and)( \
+                     SF(isa, cmpeq##bits)(colorB, colorF), eqAH))), \
+                  SF(isa, andnot)(SF(isa, and)(c4, pB), pA)); \
+      product1_A = SF(isa, or)(SF(isa, and)(c1, SF(isa, or)(qA, SF(isa, and)( \
+                     SF(isa, cmpeq##bits)(colorA, colorG), \
+                     SF(isa, cmpeq##bits)(colorC, colorO)))), \
+                  SF(isa, and)(c4, qA)); \
+      product1_C = SF(isa, or)(SF(isa, and)(c2, SF(isa, or)(qC, SF(isa, and)( \
+                     SF(isa, cmpeq##bits)(colorC, colorH), eqAF))), \
+                  SF(isa, andnot)(SF(isa, and)(c4, qC), qA)); \
+      \
+      /* twoxsai_result, each term is 0 or -1 per lane */ \
+      r = SF(isa, add##bits)( \
+            SF(isa, add##bits)( \
+               SF(isa, sub##bits)( \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(colorA, colorG), SF(isa, cmpeq##bits)(colorA, colorE)), \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(colorB, colorG), eqBE)), \
+               SF(isa, sub##bits)( \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(colorB, colorK), SF(isa, cmpeq##bits)(colorB, colorF)), \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(colorA, colorK), eqAF))), \
+            SF(isa, add##bits)( \
+               SF(isa, sub##bits)( \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(colorB, colorH), SF(isa, cmpeq##bits)(colorB, colorN)), \
+                  SF(isa, and)(eqAH, SF(isa, cmpeq##bits)(colorA, colorN))), \
+               SF(isa, sub##bits)( \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(colorA, colorL), SF(isa, cmpeq##bits)(colorA, colorO)), \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(colorB, colorL), SF(isa, cmpeq##bits)(colorB, colorO))))); \
+      product2_A = SF(isa, or)(c1, SF(isa, and)(c3, SF(isa, cmpgt##bits)(r, zero))); \
+      product2_B = SF(isa, or)(c2, SF(isa, and)(c3, SF(isa, cmpgt##bits)(zero, r))); \
+      \
+      SF(isa, zip##bits)(colorA, \
+            SF(isa, select)(product_A, colorA, SF(isa, select)(product_B, colorB, \
+                  twoxsai_interpolate_##isa##_##bits(colorA, colorB))), \
+            &lo, &hi); \
+      SF(isa, store)(out0 + (x << 1), lo); \
+      SF(isa, store)(out0 + (x << 1) + n, hi); \
+      \
+      SF(isa, zip##bits)( \
+            SF(isa, select)(product1_A, colorA, SF(isa, select)(product1_C, colorC, \
+                  twoxsai_interpolate_##isa##_##bits(colorA, colorC))), \
+            SF(isa, select)(product2_A, colorA, SF(isa, select)(product2_B, colorB, \
+                  twoxsai_interpolate2_##isa##_##bits(colorA, colorB, colorC, colorD))), \
+            &lo, &hi); \
+      SF(isa, store)(out1 + (x << 1), lo); \
+      SF(isa, store)(out1 + (x << 1) + n, hi); \
+   } \
+   \
+   return x; \
+}
+
+#ifdef SOFTFILTER_HAVE_AVX2
+TWOXSAI_SIMD_ROW(avx2, 16)
+TWOXSAI_SIMD_ROW(avx2, 32)
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+TWOXSAI_SIMD_ROW(sse2, 16)
+TWOXSAI_SIMD_ROW(sse2, 32)
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+TWOXSAI_SIMD_ROW(neon, 16)
+TWOXSAI_SIMD_ROW(neon, 32)
+#endif
+
+/* In order of preference */
+static const struct
+{
+   softfilter_simd_mask_t simd;
+   twoxsai_row_t rgb565;
+   twoxsai_row_t xrgb8888;
+} twoxsai_rows[] = {
+#ifdef SOFTFILTER_HAVE_AVX2
+   { SOFTFILTER_SIMD_AVX2, twoxsai_row_avx2_16, twoxsai_row_avx2_32 },
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+   { SOFTFILTER_SIMD_SSE2, twoxsai_row_sse2_16, twoxsai_row_sse2_32 },
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+   { SOFTFILTER_SIMD_NEON, twoxsai_row_neon_16, twoxsai_row_neon_32 },
+#endif
+   { 0,                    NULL,                NULL                },
 };
 
 static unsigned twoxsai_generic_input_fmts(void)
@@ -67,17 +265,23 @@ static void *twoxsai_generic_create(const struct softfilter_config *config,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
+   unsigned i;
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
 
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
+   /* Rows at the band edges are filtered differently, so the
+    * frame is not split. */
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   for (i = 0; (twoxsai_rows[i].simd & simd) != twoxsai_rows[i].simd; )
+      i++;
+   filt->row     = (in_fmt == SOFTFILTER_FMT_RGB565)
+      ? twoxsai_rows[i].rgb565 : twoxsai_rows[i].xrgb8888;
    if (!filt->workers)
    {
       free(filt);
@@ -226,7 +430,8 @@ static void twoxsai_generic_destroy(void *data)
 
 static void twoxsai_generic_xrgb8888(unsigned width, unsigned height,
       int first, int last, uint32_t *src,
-      unsigned src_stride, uint32_t *dst, unsigned dst_stride)
+      unsigned src_stride, uint32_t *dst, unsigned dst_stride,
+      twoxsai_row_t row)
 {
    unsigned finish;
    unsigned nextline = (last) ? 0 : src_stride;
@@ -236,7 +441,18 @@ static void twoxsai_generic_xrgb8888(unsigned width, unsigned height,
       uint32_t *in  = (uint32_t*)src;
       uint32_t *out = (uint32_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+
+      if (row)
+      {
+         unsigned x = row(in, nextline, out, out + dst_stride, width);
+
+         in     += x;
+         out    += x << 1;
+         finish -= x;
+      }
+
+      for (; finish; finish -= 1)
       {
          twoxsai_declare_variables(uint32_t, in, nextline);
 
@@ -258,7 +474,8 @@ static void twoxsai_generic_xrgb8888(unsigned width, unsigned height,
 
 static void twoxsai_generic_rgb565(unsigned width, unsigned height,
       int first, int last, uint16_t *src,
-      unsigned src_stride, uint16_t *dst, unsigned dst_stride)
+      unsigned src_stride, uint16_t *dst, unsigned dst_stride,
+      twoxsai_row_t row)
 {
    unsigned finish;
    unsigned nextline = (last) ? 0 : src_stride;
@@ -268,7 +485,18 @@ static void twoxsai_generic_rgb565(unsigned width, unsigned height,
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+
+      if (row)
+      {
+         unsigned x = row(in, nextline, out, out + dst_stride, width);
+
+         in     += x;
+         out    += x << 1;
+         finish -= x;
+      }
+
+      for (; finish; finish -= 1)
       {
          twoxsai_declare_variables(uint16_t, in, nextline);
 
@@ -290,6 +518,7 @@ static void twoxsai_generic_rgb565(unsigned width, unsigned height,
 
 static void twoxsai_work_cb_rgb565(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr =
       (struct softfilter_thread_data*)thread_data;
    uint16_t *input = (uint16_t*)thr->in_data;
@@ -301,11 +530,12 @@ static void twoxsai_work_cb_rgb565(void *data, void *thread_data)
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
-         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
+         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565), filt->row);
 }
 
 static void twoxsai_work_cb_xrgb8888(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr =
       (struct softfilter_thread_data*)thread_data;
    uint32_t *input = (uint32_t*)thr->in_data;
@@ -317,7 +547,7 @@ static void twoxsai_work_cb_xrgb8888(void *data, void *thread_data)
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
          output,
-         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
+         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888), filt->row);
 }
 
 static void twoxsai_generic_packets(void *data,
@@ -15,6 +15,7 @@
  */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -39,11 +40,84 @@ struct softfilter_thread_data
    int last;
 };
 
+/* Processes pixels 1 and up of a row, returns the first pixel
+ * left for the scalar loop. */
+typedef unsigned (*epx_row_t)(const uint16_t *above, const uint16_t *src,
+      const uint16_t *below, uint16_t *out0, uint16_t *out1, unsigned width);
+
 struct filter_data
 {
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   epx_row_t row;
+};
+
+/* The middle loop of epx_generic_rgb565, a vector of pixels at
+ * a time. Output pixels are in memory order on either endian. */
+#define EPX_SIMD_ROW(isa) \
+static SOFTFILTER_TARGET_##isa unsigned epx_row_##isa(const uint16_t *above, \
+      const uint16_t *src, const uint16_t *below, \
+      uint16_t *out0, uint16_t *out1, unsigned width) \
+{ \
+   const unsigned n = SF(isa, bytes) / 2; \
+   unsigned x; \
+   \
+   for (x = 1; x + n < width; x += n) \
+   { \
+      SF(isa, t) lo, hi; \
+      SF(isa, t) colorA = SF(isa, load)(src + x - 1); \
+      SF(isa, t) colorX = SF(isa, load)(src + x); \
+      SF(isa, t) colorC = SF(isa, load)(src + x + 1); \
+      SF(isa, t) colorB = SF(isa, load)(below + x); \
+      SF(isa, t) colorD = SF(isa, load)(above + x); \
+      SF(isa, t) skip   = SF(isa, or)(SF(isa, cmpeq16)(colorA, colorC), \
+            SF(isa, cmpeq16)(colorB, colorD)); \
+      \
+      SF(isa, zip16)( \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq16)(colorD, colorA), skip), colorD, colorX), \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq16)(colorC, colorD), skip), colorC, colorX), \
+            &lo, &hi); \
+      SF(isa, store)(out0 + (x << 1), lo); \
+      SF(isa, store)(out0 + (x << 1) + n, hi); \
+      \
+      SF(isa, zip16)( \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq16)(colorA, colorB), skip), colorA, colorX), \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq16)(colorB, colorC), skip), colorB, colorX), \
+            &lo, &hi); \
+      SF(isa, store)(out1 + (x << 1), lo); \
+      SF(isa, store)(out1 + (x << 1) + n, hi); \
+   } \
+   \
+   return x; \
+}
+
+#ifdef SOFTFILTER_HAVE_AVX2
+EPX_SIMD_ROW(avx2)
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+EPX_SIMD_ROW(sse2)
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+EPX_SIMD_ROW(neon)
+#endif
+
+/* In order of preference */
+static const struct
+{
+   softfilter_simd_mask_t simd;
+   epx_row_t rgb565;
+} epx_rows[] = {
+#ifdef SOFTFILTER_HAVE_AVX2
+   { SOFTFILTER_SIMD_AVX2, epx_row_avx2 },
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+   { SOFTFILTER_SIMD_SSE2, epx_row_sse2 },
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+   { SOFTFILTER_SIMD_NEON, epx_row_neon },
+#endif
+   { 0,                    NULL         },
 };
 
 static unsigned epx_generic_input_fmts(void)
@@ -67,16 +141,19 @@ static void *epx_generic_create(const struct softfilter_config *config,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
+   unsigned i;
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   for (i = 0; (epx_rows[i].simd & simd) != epx_rows[i].simd; )
+      i++;
+   filt->row     = epx_rows[i].rgb565;
    if (!filt->workers)
    {
       free(filt);
@@ -106,7 +183,8 @@ static void epx_generic_destroy(void *data)
 
 static void epx_generic_rgb565 (unsigned width, unsigned height,
       int first, int lsat, uint16_t *src,
-      unsigned src_stride, uint16_t *dst, unsigned dst_stride)
+      unsigned src_stride, uint16_t *dst, unsigned dst_stride,
+      epx_row_t row)
 {
    uint16_t colorX, colorA, colorB, colorC, colorD;
    uint16_t *sP, *uP, *lP;
@@ -144,7 +222,24 @@ static void epx_generic_rgb565 (unsigned width, unsigned height,
       dP1++;
       dP2++;
 
-      for (w = width - 2; w; w--)
+      w = width - 2;
+
+      if (row)
+      {
+         unsigned x = row(src - src_stride, src, src + src_stride,
+               dst, dst + dst_stride, width);
+
+         colorX = src[x - 1];
+         colorC = src[x];
+         sP     = src + x;
+         uP     = src - src_stride + x;
+         lP     = src + src_stride + x;
+         dP1   += x - 1;
+         dP2   += x - 1;
+         w      = width - 1 - x;
+      }
+
+      for (; w; w--)
       {
          colorA = colorX;
          colorX = colorC;
@@ -196,6 +291,7 @@ static void epx_generic_rgb565 (unsigned width, unsigned height,
 
 static void epx_work_cb_rgb565(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr =
       (struct softfilter_thread_data*)thread_data;
    uint16_t *input = (uint16_t*)thr->in_data;
@@ -207,7 +303,7 @@ static void epx_work_cb_rgb565(void *data, void *thread_data)
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
-         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
+         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565), filt->row);
 }
 
 static void epx_generic_packets(void *data,
@@ -15,6 +15,7 @@
  */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 
 #ifdef RARCH_INTERNAL
@@ -38,11 +39,107 @@ struct softfilter_thread_data
    int last;
 };
 
+/* Processes pixels 1 and up of a row, returns the first pixel
+ * left for the scalar loop. */
+typedef unsigned (*lq2x_row_t)(const void *above, const void *src,
+      const void *below, void *out0, void *out1, unsigned width);
+
 struct filter_data
 {
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   lq2x_row_t row;
+};
+
+/* (C + A - ((C ^ A) & 0x0821)) >> 1 without the carry out of
+ * the 16-bit lane: C + A is 2 * (C & A) + (C ^ A) and the low
+ * bit of ((C ^ A) & ~0x0821) is clear. */
+#define LQ2X_BLEND_16(isa, C, A) \
+   SF(isa, add16)(SF(isa, and)(C, A), SF(isa, srl16)( \
+         SF(isa, andnot)(SF(isa, xor)(C, A), SF(isa, set16)(0x0821)), 1))
+
+/* Wraps around in the 32-bit lane like the scalar code does. */
+#define LQ2X_BLEND_32(isa, C, A) \
+   SF(isa, srl32)(SF(isa, sub32)(SF(isa, add32)(C, A), \
+         SF(isa, and)(SF(isa, xor)(C, A), SF(isa, set32)(0x0421))), 1)
+
+/* The same as the scalar loops, a vector of pixels at a time. */
+#define LQ2X_SIMD_ROW(isa, bits) \
+static SOFTFILTER_TARGET_##isa unsigned lq2x_row_##isa##_##bits( \
+      const void *above_data, const void *src_data, \
+      const void *below_data, void *out0_data, void *out1_data, \
+      unsigned width) \
+{ \
+   const uint##bits##_t *above = (const uint##bits##_t*)above_data; \
+   const uint##bits##_t *src   = (const uint##bits##_t*)src_data; \
+   const uint##bits##_t *below = (const uint##bits##_t*)below_data; \
+   uint##bits##_t *out0        = (uint##bits##_t*)out0_data; \
+   uint##bits##_t *out1        = (uint##bits##_t*)out1_data; \
+   const unsigned n            = SF(isa, bytes) / (bits / 8); \
+   unsigned x; \
+   \
+   for (x = 1; x + n < width; x += n) \
+   { \
+      SF(isa, t) lo, hi; \
+      SF(isa, t) A    = SF(isa, load)(above + x); \
+      SF(isa, t) B    = SF(isa, load)(src + x - 1); \
+      SF(isa, t) C    = SF(isa, load)(src + x); \
+      SF(isa, t) D    = SF(isa, load)(src + x + 1); \
+      SF(isa, t) E    = SF(isa, load)(below + x); \
+      SF(isa, t) CA   = LQ2X_BLEND_##bits(isa, C, A); \
+      SF(isa, t) CE   = LQ2X_BLEND_##bits(isa, C, E); \
+      SF(isa, t) skip = SF(isa, or)(SF(isa, cmpeq##bits)(A, E), \
+            SF(isa, cmpeq##bits)(B, D)); \
+      \
+      SF(isa, zip##bits)( \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq##bits)(A, B), skip), CA, C), \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq##bits)(A, D), skip), CA, C), \
+            &lo, &hi); \
+      SF(isa, store)(out0 + (x << 1), lo); \
+      SF(isa, store)(out0 + (x << 1) + n, hi); \
+      \
+      SF(isa, zip##bits)( \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq##bits)(E, B), skip), CE, C), \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq##bits)(E, D), skip), CE, C), \
+            &lo, &hi); \
+      SF(isa, store)(out1 + (x << 1), lo); \
+      SF(isa, store)(out1 + (x << 1) + n, hi); \
+   } \
+   \
+   return x; \
+}
+
+#ifdef SOFTFILTER_HAVE_AVX2
+LQ2X_SIMD_ROW(avx2, 16)
+LQ2X_SIMD_ROW(avx2, 32)
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+LQ2X_SIMD_ROW(sse2, 16)
+LQ2X_SIMD_ROW(sse2, 32)
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+LQ2X_SIMD_ROW(neon, 16)
+LQ2X_SIMD_ROW(neon, 32)
+#endif
+
+/* In order of preference */
+static const struct
+{
+   softfilter_simd_mask_t simd;
+   lq2x_row_t rgb565;
+   lq2x_row_t xrgb8888;
+} lq2x_rows[] = {
+#ifdef SOFTFILTER_HAVE_AVX2
+   { SOFTFILTER_SIMD_AVX2, lq2x_row_avx2_16, lq2x_row_avx2_32 },
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+   { SOFTFILTER_SIMD_SSE2, lq2x_row_sse2_16, lq2x_row_sse2_32 },
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+   { SOFTFILTER_SIMD_NEON, lq2x_row_neon_16, lq2x_row_neon_32 },
+#endif
+   { 0,                    NULL,             NULL             },
 };
 
 static unsigned lq2x_generic_input_fmts(void)
@@ -66,16 +163,22 @@ static void *lq2x_generic_create(const struct softfilter_config *config,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
+   unsigned i;
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
+   /* Rows at the band edges are filtered differently, so the
+    * frame is not split. */
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   for (i = 0; (lq2x_rows[i].simd & simd) != lq2x_rows[i].simd; )
+      i++;
+   filt->row     = (in_fmt == SOFTFILTER_FMT_RGB565)
+      ? lq2x_rows[i].rgb565 : lq2x_rows[i].xrgb8888;
    if (!filt->workers)
    {
       free(filt);
@@ -103,9 +206,65 @@ static void lq2x_generic_destroy(void *data)
    free(filt);
 }
 
+static INLINE void lq2x_pixel_rgb565(const uint16_t *above,
+      const uint16_t *src, const uint16_t *below,
+      uint16_t *out0, uint16_t *out1, unsigned x, unsigned width)
+{
+   uint16_t A, B, C, D, E, c;
+   A = above[x];
+   B = (x > 0) ? src[x - 1] : src[x];
+   C = src[x];
+   D = (x < width - 1) ? src[x + 1] : src[x];
+   E = below[x];
+   c = C;
+
+   if(A != E && B != D)
+   {
+      out0[(x << 1)]     = (A == B ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
+      out0[(x << 1) + 1] = (A == D ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
+      out1[(x << 1)]     = (E == B ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
+      out1[(x << 1) + 1] = (E == D ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
+   }
+   else
+   {
+      out0[(x << 1)]     = c;
+      out0[(x << 1) + 1] = c;
+      out1[(x << 1)]     = c;
+      out1[(x << 1) + 1] = c;
+   }
+}
+
+static INLINE void lq2x_pixel_xrgb8888(const uint32_t *above,
+      const uint32_t *src, const uint32_t *below,
+      uint32_t *out0, uint32_t *out1, unsigned x, unsigned width)
+{
+   uint32_t A = above[x];
+   uint32_t B = (x > 0) ? src[x - 1] : src[x];
+   uint32_t C = src[x];
+   uint32_t D = (x < width - 1) ? src[x + 1] : src[x];
+   uint32_t E = below[x];
+   uint32_t c = C;
+
+   if(A != E && B != D)
+   {
+      out0[(x << 1)]     = (A == B ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
+      out0[(x << 1) + 1] = (A == D ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
+      out1[(x << 1)]     = (E == B ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
+      out1[(x << 1) + 1] = (E == D ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
+   }
+   else
+   {
+      out0[(x << 1)]     = c;
+      out0[(x << 1) + 1] = c;
+      out1[(x << 1)]     = c;
+      out1[(x << 1) + 1] = c;
+   }
+}
+
 static void lq2x_generic_rgb565(unsigned width, unsigned height,
       int first, int last, uint16_t *src,
-      unsigned src_stride, uint16_t *dst, unsigned dst_stride)
+      unsigned src_stride, uint16_t *dst, unsigned dst_stride,
+      lq2x_row_t row)
 {
    unsigned x, y;
    uint16_t *out0 = (uint16_t*)dst;
@@ -115,42 +274,29 @@ static void lq2x_generic_rgb565(unsigned width, unsigned height,
    {
       int prevline = (y == 0 ? 0 : src_stride);
       int nextline = (y == height - 1 || last) ? 0 : src_stride;
+      const uint16_t *above = src - prevline;
+      const uint16_t *below = src + nextline;
 
-      for(x = 0; x < width; x++)
+      x = 0;
+      if (row && width > 1)
       {
-         uint16_t A, B, C, D, E, c;
-         A = *(src - prevline);
-         B = (x > 0) ? *(src - 1) : *src;
-         C = *src;
-         D = (x < width - 1) ? *(src + 1) : *src;
-         E = *(src++ + nextline);
-         c = C;
-
-         if(A != E && B != D)
-         {
-            *out0++ = (A == B ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out0++ = (A == D ? ((C + A - ((C ^ A) & 0x0821)) >> 1) : c);
-            *out1++ = (E == B ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-            *out1++ = (E == D ? ((C + E - ((C ^ E) & 0x0821)) >> 1) : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
+         lq2x_pixel_rgb565(above, src, below, out0, out1, 0, width);
+         x = row(above, src, below, out0, out1, width);
       }
 
-      src += src_stride - width;
-      out0 += dst_stride + dst_stride - (width << 1);
-      out1 += dst_stride + dst_stride - (width << 1);
+      for(; x < width; x++)
+         lq2x_pixel_rgb565(above, src, below, out0, out1, x, width);
+
+      src  += src_stride;
+      out0 += dst_stride + dst_stride;
+      out1 += dst_stride + dst_stride;
    }
 }
 
 static void lq2x_generic_xrgb8888(unsigned width, unsigned height,
       int first, int last, uint32_t *src,
-      unsigned src_stride, uint32_t *dst, unsigned dst_stride)
+      unsigned src_stride, uint32_t *dst, unsigned dst_stride,
+      lq2x_row_t row)
 {
    unsigned x, y;
    uint32_t *out0 = (uint32_t*)dst;
@@ -160,40 +306,28 @@ static void lq2x_generic_xrgb8888(unsigned width, unsigned height,
    {
       int prevline = (y == 0 ? 0 : src_stride);
       int nextline = (y == height - 1 || last) ? 0 : src_stride;
+      const uint32_t *above = src - prevline;
+      const uint32_t *below = src + nextline;
 
-      for(x = 0; x < width; x++)
+      x = 0;
+      if (row && width > 1)
       {
-         uint32_t A = *(src - prevline);
-         uint32_t B = (x > 0) ? *(src - 1) : *src;
-         uint32_t C = *src;
-         uint32_t D = (x < width - 1) ? *(src + 1) : *src;
-         uint32_t E = *(src++ + nextline);
-         uint32_t c = C;
-
-         if(A != E && B != D)
-         {
-            *out0++ = (A == B ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out0++ = (A == D ? (C + A - ((C ^ A) & 0x0421)) >> 1 : c);
-            *out1++ = (E == B ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-            *out1++ = (E == D ? (C + E - ((C ^ E) & 0x0421)) >> 1 : c);
-         }
-         else
-         {
-            *out0++ = c;
-            *out0++ = c;
-            *out1++ = c;
-            *out1++ = c;
-         }
+         lq2x_pixel_xrgb8888(above, src, below, out0, out1, 0, width);
+         x = row(above, src, below, out0, out1, width);
       }
 
-      src += src_stride - width;
-      out0 += dst_stride + dst_stride - (width << 1);
-      out1 += dst_stride + dst_stride - (width << 1);
+      for(; x < width; x++)
+         lq2x_pixel_xrgb8888(above, src, below, out0, out1, x, width);
+
+      src  += src_stride;
+      out0 += dst_stride + dst_stride;
+      out1 += dst_stride + dst_stride;
    }
 }
 
 static void lq2x_work_cb_rgb565(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr =
       (struct softfilter_thread_data*)thread_data;
    uint16_t *input = (uint16_t*)thr->in_data;
@@ -205,11 +339,12 @@ static void lq2x_work_cb_rgb565(void *data, void *thread_data)
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
-         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
+         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565), filt->row);
 }
 
 static void lq2x_work_cb_xrgb8888(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr =
       (struct softfilter_thread_data*)thread_data;
    uint32_t *input = (uint32_t*)thr->in_data;
@@ -217,13 +352,11 @@ static void lq2x_work_cb_xrgb8888(void *data, void *thread_data)
    unsigned width = thr->width;
    unsigned height = thr->height;
 
-   (void)data;
-
    lq2x_generic_xrgb8888(width, height,
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
          output,
-         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
+         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888), filt->row);
 }
 
 static void lq2x_generic_packets(void *data,
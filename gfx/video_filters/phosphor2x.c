@@ -15,6 +15,7 @@
  */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <boolean.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,11 +43,17 @@ struct softfilter_thread_data
    int last;
 };
 
+/* Splats and blends pixels 0 and up of a line, returns the
+ * first pixel left for the scalar loops. */
+typedef unsigned (*phosphor2x_blit_t)(void *out, const void *in,
+      unsigned width);
+
 struct filter_data
 {
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   phosphor2x_blit_t blit;
    float phosphor_bleed;
    float scale_add;
    float scale_times;
@@ -56,6 +63,16 @@ struct filter_data
    float phosphor_bloom_565[64];
    float scan_range_8888[256];
    float scan_range_565[64];
+
+   /* With the SIMD kernels, the per component float math of the
+    * bleed and scanline passes is looked up instead, the tables
+    * hold what the scalar passes compute. */
+   uint8_t bleed_8888[256];
+   uint8_t bleed_green_8888[256];
+   uint8_t bleed_565[64];
+   uint8_t bleed_green_565[64];
+   uint8_t scanline_565[64 * 64];
+   uint8_t *scanline_8888;
 };
 
 #define clamp8(x) ((x) > 255 ? 255 : ((x < 0) ? 0 : (uint32_t)x))
@@ -78,6 +95,73 @@ struct filter_data
 #define blend_pixels_xrgb8888(a, b) (((a >> 1) & 0x7f7f7f7f) + ((b >> 1) & 0x7f7f7f7f))
 #define blend_pixels_rgb565(a, b) (((a&0xF7DE) >> 1) + ((b&0xF7DE) >> 1))
 
+#define PHOSPHOR2X_BLEND_16(isa, a, b) \
+   SF(isa, add16)( \
+         SF(isa, srl16)(SF(isa, and)(a, SF(isa, set16)(0xF7DE)), 1), \
+         SF(isa, srl16)(SF(isa, and)(b, SF(isa, set16)(0xF7DE)), 1))
+
+#define PHOSPHOR2X_BLEND_32(isa, a, b) \
+   SF(isa, add32)( \
+         SF(isa, and)(SF(isa, srl32)(a, 1), SF(isa, set32)(0x7f7f7f7f)), \
+         SF(isa, and)(SF(isa, srl32)(b, 1), SF(isa, set32)(0x7f7f7f7f)))
+
+/* The splat and blend loops of blit_linear_line_*, a vector
+ * of pixels at a time. */
+#define PHOSPHOR2X_SIMD_BLIT(isa, bits) \
+static SOFTFILTER_TARGET_##isa unsigned phosphor2x_blit_##isa##_##bits( \
+      void *out_data, const void *in_data, unsigned width) \
+{ \
+   const uint##bits##_t *in = (const uint##bits##_t*)in_data; \
+   uint##bits##_t *out      = (uint##bits##_t*)out_data; \
+   const unsigned n         = SF(isa, bytes) / (bits / 8); \
+   unsigned i; \
+   \
+   for (i = 0; i + n < width; i += n) \
+   { \
+      SF(isa, t) lo, hi; \
+      SF(isa, t) a = SF(isa, load)(in + i); \
+      SF(isa, t) b = SF(isa, load)(in + i + 1); \
+      \
+      SF(isa, zip##bits)(a, PHOSPHOR2X_BLEND_##bits(isa, a, b), &lo, &hi); \
+      SF(isa, store)(out + (i << 1), lo); \
+      SF(isa, store)(out + (i << 1) + n, hi); \
+   } \
+   \
+   return i; \
+}
+
+#ifdef SOFTFILTER_HAVE_AVX2
+PHOSPHOR2X_SIMD_BLIT(avx2, 16)
+PHOSPHOR2X_SIMD_BLIT(avx2, 32)
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+PHOSPHOR2X_SIMD_BLIT(sse2, 16)
+PHOSPHOR2X_SIMD_BLIT(sse2, 32)
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+PHOSPHOR2X_SIMD_BLIT(neon, 16)
+PHOSPHOR2X_SIMD_BLIT(neon, 32)
+#endif
+
+/* In order of preference */
+static const struct
+{
+   softfilter_simd_mask_t simd;
+   phosphor2x_blit_t rgb565;
+   phosphor2x_blit_t xrgb8888;
+} phosphor2x_blits[] = {
+#ifdef SOFTFILTER_HAVE_AVX2
+   { SOFTFILTER_SIMD_AVX2, phosphor2x_blit_avx2_16, phosphor2x_blit_avx2_32 },
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+   { SOFTFILTER_SIMD_SSE2, phosphor2x_blit_sse2_16, phosphor2x_blit_sse2_32 },
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+   { SOFTFILTER_SIMD_NEON, phosphor2x_blit_neon_16, phosphor2x_blit_neon_32 },
+#endif
+   { 0,                    NULL,                    NULL                    },
+};
+
 static INLINE unsigned max_component_xrgb8888(uint32_t color)
 {
    unsigned red   = red_xrgb8888(color);
@@ -103,16 +187,17 @@ static INLINE unsigned max_component_rgb565(uint32_t color)
 }
 
 static void blit_linear_line_xrgb8888(uint32_t * out,
-      const uint32_t *in, unsigned width)
+      const uint32_t *in, unsigned width, phosphor2x_blit_t blit)
 {
    unsigned i;
+   unsigned start = blit ? blit(out, in, width) : 0;
 
    /* Splat pixels out on the line. */
-   for (i = 0; i < width; i++)
+   for (i = start; i < width; i++)
       out[i << 1] = in[i];
 
    /* Blend in-between pixels. */
-   for (i = 1; i < (width << 1) - 1; i += 2)
+   for (i = (start << 1) + 1; i < (width << 1) - 1; i += 2)
       out[i] = blend_pixels_xrgb8888(out[i - 1], out[i + 1]);
 
    /* Blend edge pixels against black. */
@@ -122,16 +207,17 @@ static void blit_linear_line_xrgb8888(uint32_t * out,
 }
 
 static void blit_linear_line_rgb565(uint16_t * out,
-      const uint16_t *in, unsigned width)
+      const uint16_t *in, unsigned width, phosphor2x_blit_t blit)
 {
    unsigned i;
+   unsigned start = blit ? blit(out, in, width) : 0;
 
    /* Splat pixels out on the line. */
-   for (i = 0; i < width; i++)
+   for (i = start; i < width; i++)
       out[i << 1] = in[i];
 
    /* Blend in-between pixels. */
-   for (i = 1; i < (width << 1) - 1; i += 2)
+   for (i = (start << 1) + 1; i < (width << 1) - 1; i += 2)
       out[i] =
          blend_pixels_rgb565(out[i - 1], out[i + 1]);
 
@@ -211,6 +297,123 @@ static void bleed_phosphors_rgb565(void *data,
    }
 }
 
+static void bleed_phosphors_table_xrgb8888(const struct filter_data *filt,
+      uint32_t *scanline, unsigned width)
+{
+   unsigned x;
+
+   /* Red phosphor */
+   for (x = 0; x < width; x += 2)
+      set_red_xrgb8888(scanline[x + 1],
+            filt->bleed_8888[red_xrgb8888(scanline[x])]);
+
+   /* Green phosphor */
+   for (x = 0; x < width; x++)
+      set_green_xrgb8888(scanline[x],
+            filt->bleed_green_8888[green_xrgb8888(scanline[x])]);
+
+   /* Blue phosphor */
+   set_blue_xrgb8888(scanline[0], 0);
+   for (x = 1; x < width; x += 2)
+      set_blue_xrgb8888(scanline[x + 1],
+            filt->bleed_8888[blue_xrgb8888(scanline[x])]);
+}
+
+static void bleed_phosphors_table_rgb565(const struct filter_data *filt,
+      uint16_t *scanline, unsigned width)
+{
+   unsigned x;
+
+   /* Red phosphor */
+   for (x = 0; x < width; x += 2)
+      set_red_rgb565(scanline[x + 1],
+            filt->bleed_565[red_rgb565(scanline[x])]);
+
+   /* Green phosphor */
+   for (x = 0; x < width; x++)
+      set_green_rgb565(scanline[x],
+            filt->bleed_green_565[green_rgb565(scanline[x])]);
+
+   /* Blue phosphor */
+   set_blue_rgb565(scanline[0], 0);
+   for (x = 1; x < width; x += 2)
+      set_blue_rgb565(scanline[x + 1],
+            filt->bleed_565[blue_rgb565(scanline[x])]);
+}
+
+static void scanlines_table_xrgb8888(const struct filter_data *filt,
+      uint32_t *scan_out, const uint32_t *line, unsigned width)
+{
+   unsigned x;
+
+   for (x = 0; x < width; x++)
+   {
+      const uint8_t *scan = filt->scanline_8888 +
+         (max_component_xrgb8888(line[x]) << 8);
+
+      scan_out[x] = (scan[red_xrgb8888(line[x])] << 16)
+         | (scan[green_xrgb8888(line[x])] << 8)
+         | scan[blue_xrgb8888(line[x])];
+   }
+}
+
+static void scanlines_table_rgb565(const struct filter_data *filt,
+      uint16_t *scan_out, const uint16_t *line, unsigned width)
+{
+   unsigned x;
+
+   for (x = 0; x < width; x++)
+   {
+      const uint8_t *scan = filt->scanline_565 +
+         (max_component_rgb565(line[x]) << 6);
+
+      scan_out[x] = ((scan[red_rgb565(line[x])] & 0x3e) << 10)
+         | ((scan[green_rgb565(line[x])] & 0x3f) << 5)
+         | ((scan[blue_rgb565(line[x])] & 0x3e) >> 1);
+   }
+}
+
+/* Evaluates the float math of the bleed and scanline passes for
+ * every component value, the same way they do. */
+static bool phosphor2x_init_tables(struct filter_data *filt)
+{
+   unsigned i, c;
+
+   for (i = 0; i < 256; i++)
+   {
+      filt->bleed_8888[i]       = clamp8(i * filt->phosphor_bleed *
+            filt->phosphor_bloom_8888[i]);
+      filt->bleed_green_8888[i] = clamp8((i >> 1) + 0.5 * i *
+            filt->phosphor_bleed * filt->phosphor_bloom_8888[i]);
+   }
+
+   for (i = 0; i < 64; i++)
+   {
+      filt->bleed_565[i]        = clamp6(i * filt->phosphor_bleed *
+            filt->phosphor_bloom_565[i]);
+      filt->bleed_green_565[i]  = clamp6((i >> 1) + 0.5 * i *
+            filt->phosphor_bleed * filt->phosphor_bloom_565[i]);
+
+      for (c = 0; c < 64; c++)
+         filt->scanline_565[(i << 6) + c] =
+            (uint16_t)(filt->scan_range_565[i] * c);
+   }
+
+   if (filt->in_fmt != SOFTFILTER_FMT_XRGB8888)
+      return true;
+
+   filt->scanline_8888 = (uint8_t*)malloc(256 * 256);
+   if (!filt->scanline_8888)
+      return false;
+
+   for (i = 0; i < 256; i++)
+      for (c = 0; c < 256; c++)
+         filt->scanline_8888[(i << 8) + c] =
+            (uint32_t)(filt->scan_range_8888[i] * c);
+
+   return true;
+}
+
 static unsigned phosphor2x_generic_input_fmts(void)
 {
    return SOFTFILTER_FMT_RGB565 | SOFTFILTER_FMT_XRGB8888;
@@ -235,7 +438,6 @@ static void *phosphor2x_generic_create(const struct softfilter_config *config,
    unsigned i;
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
 
-   (void)simd;
    (void)out_fmt;
    (void)max_width;
    (void)max_height;
@@ -246,8 +448,12 @@ static void *phosphor2x_generic_create(const struct softfilter_config *config,
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   for (i = 0; (phosphor2x_blits[i].simd & simd) != phosphor2x_blits[i].simd; )
+      i++;
+   filt->blit    = (in_fmt == SOFTFILTER_FMT_RGB565)
+      ? phosphor2x_blits[i].rgb565 : phosphor2x_blits[i].xrgb8888;
    if (!filt->workers)
    {
       free(filt);
@@ -285,6 +491,9 @@ static void *phosphor2x_generic_create(const struct softfilter_config *config,
          (filt->scanrange_high - filt->scanrange_low) / 31.0f;
    }
 
+   if (filt->blit && !phosphor2x_init_tables(filt))
+      filt->blit = NULL;
+
    return filt;
 }
 
@@ -304,6 +513,7 @@ static void phosphor2x_generic_destroy(void *data)
    if (!filt)
       return;
 
+   free(filt->scanline_8888);
    free(filt->workers);
    free(filt);
 }
@@ -331,15 +541,24 @@ static void phosphor2x_generic_xrgb8888(void *data,
       uint32_t *out_line      = (uint32_t*)(dst + y * (dst_stride) * 2);
 
       /* Bilinear stretch horizontally. */
-      blit_linear_line_xrgb8888(out_line, in_line, width);
+      blit_linear_line_xrgb8888(out_line, in_line, width, filt->blit);
 
       /* Mask 'n bleed phosphors */
-      bleed_phosphors_xrgb8888(filt, out_line, width << 1);
+      if (filt->blit)
+         bleed_phosphors_table_xrgb8888(filt, out_line, width << 1);
+      else
+         bleed_phosphors_xrgb8888(filt, out_line, width << 1);
 
       /* Apply scanlines */
 
       scan_out = (uint32_t*)out_line + (dst_stride);
 
+      if (filt->blit)
+      {
+         scanlines_table_xrgb8888(filt, scan_out, out_line, width << 1);
+         continue;
+      }
+
       for (x = 0; x < (width << 1); x++)
       {
          unsigned max = max_component_xrgb8888(out_line[x]);
@@ -378,14 +597,23 @@ static void phosphor2x_generic_rgb565(void *data,
       const uint16_t *in_line = (const uint16_t*)(src + y * (src_stride));
 
       /* Bilinear stretch horizontally. */
-      blit_linear_line_rgb565(out_line, in_line, width);
+      blit_linear_line_rgb565(out_line, in_line, width, filt->blit);
 
       /* Mask 'n bleed phosphors. */
-      bleed_phosphors_rgb565(filt, out_line, width << 1);
+      if (filt->blit)
+         bleed_phosphors_table_rgb565(filt, out_line, width << 1);
+      else
+         bleed_phosphors_rgb565(filt, out_line, width << 1);
 
       /* Apply scanlines. */
       scan_out = (uint16_t*)(out_line + (dst_stride));
 
+      if (filt->blit)
+      {
+         scanlines_table_rgb565(filt, scan_out, out_line, width << 1);
+         continue;
+      }
+
       for (x = 0; x < (width << 1); x++)
       {
          unsigned max = max_component_rgb565(out_line[x]);
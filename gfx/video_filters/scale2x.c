@@ -17,6 +17,7 @@
 /* Compile: gcc -o scale2x.so -shared scale2x.c -std=c99 -O3 -Wall -pedantic -fPIC */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 
 #ifdef RARCH_INTERNAL
@@ -40,72 +41,161 @@ struct softfilter_thread_data
    int last;
 };
 
+/* Processes pixels 1 and up of a row, returns the first pixel
+ * left for the scalar loop. */
+typedef unsigned (*scale2x_row_t)(const void *above, const void *src,
+      const void *below, void *out0, void *out1, unsigned width);
+
 struct filter_data
 {
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   scale2x_row_t row;
 };
 
-#define SCALE2X_GENERIC(typename_t, width, height, first, last, src, src_stride, dst, dst_stride, out0, out1) \
+#define SCALE2X_PIXEL(typename_t, x) \
+   { \
+      const typename_t A = above[x]; \
+      const typename_t B = (x > 0) ? src[x - 1] : src[x]; \
+      const typename_t C = src[x]; \
+      const typename_t D = (x < width - 1) ? src[x + 1] : src[x]; \
+      const typename_t E = below[x]; \
+      \
+      if (A != E && B != D) \
+      { \
+         out0[(x << 1)]     = (A == B ? A : C); \
+         out0[(x << 1) + 1] = (A == D ? A : C); \
+         out1[(x << 1)]     = (E == B ? E : C); \
+         out1[(x << 1) + 1] = (E == D ? E : C); \
+      } \
+      else \
+      { \
+         out0[(x << 1)]     = C; \
+         out0[(x << 1) + 1] = C; \
+         out1[(x << 1)]     = C; \
+         out1[(x << 1) + 1] = C; \
+      } \
+   }
+
+#define SCALE2X_GENERIC(typename_t, width, height, first, last, src, src_stride, dst, dst_stride, row) \
    for (y = 0; y < height; ++y) \
    { \
       const int prevline = ((y == 0) && first) ? 0 : src_stride; \
       const int nextline = ((y == height - 1) && last) ? 0 : src_stride; \
+      const typename_t *above = src - prevline; \
+      const typename_t *below = src + nextline; \
+      typename_t *out0 = dst; \
+      typename_t *out1 = dst + dst_stride; \
       \
-      for (x = 0; x < width; ++x) \
+      x = 0; \
+      if (row && width > 1) \
       { \
-         const typename_t A = *(src - prevline); \
-         const typename_t B = (x > 0) ? *(src - 1) : *src; \
-         const typename_t C = *src; \
-         const typename_t D = (x < width - 1) ? *(src + 1) : *src; \
-         const typename_t E = *(src++ + nextline); \
-         \
-         if (A != E && B != D) \
-         { \
-            *out0++ = (A == B ? A : C); \
-            *out0++ = (A == D ? A : C); \
-            *out1++ = (E == B ? E : C); \
-            *out1++ = (E == D ? E : C); \
-         } \
-         else \
-         { \
-            *out0++ = C; \
-            *out0++ = C; \
-            *out1++ = C; \
-            *out1++ = C; \
-         } \
+         SCALE2X_PIXEL(typename_t, 0); \
+         x = row(above, src, below, out0, out1, width); \
       } \
       \
-      src += src_stride - width; \
-      out0 += dst_stride + dst_stride - (width * SCALE2X_SCALE); \
-      out1 += dst_stride + dst_stride - (width * SCALE2X_SCALE); \
+      for (; x < width; ++x) \
+         SCALE2X_PIXEL(typename_t, x); \
+      \
+      src += src_stride; \
+      dst += dst_stride + dst_stride; \
    }
 
+/* The same as SCALE2X_PIXEL, a vector of pixels at a time. */
+#define SCALE2X_SIMD_ROW(isa, bits) \
+static SOFTFILTER_TARGET_##isa unsigned scale2x_row_##isa##_##bits( \
+      const void *above_data, const void *src_data, \
+      const void *below_data, void *out0_data, void *out1_data, \
+      unsigned width) \
+{ \
+   const uint##bits##_t *above = (const uint##bits##_t*)above_data; \
+   const uint##bits##_t *src   = (const uint##bits##_t*)src_data; \
+   const uint##bits##_t *below = (const uint##bits##_t*)below_data; \
+   uint##bits##_t *out0        = (uint##bits##_t*)out0_data; \
+   uint##bits##_t *out1        = (uint##bits##_t*)out1_data; \
+   const unsigned n            = SF(isa, bytes) / (bits / 8); \
+   unsigned x; \
+   \
+   for (x = 1; x + n < width; x += n) \
+   { \
+      SF(isa, t) lo, hi; \
+      SF(isa, t) A    = SF(isa, load)(above + x); \
+      SF(isa, t) B    = SF(isa, load)(src + x - 1); \
+      SF(isa, t) C    = SF(isa, load)(src + x); \
+      SF(isa, t) D    = SF(isa, load)(src + x + 1); \
+      SF(isa, t) E    = SF(isa, load)(below + x); \
+      SF(isa, t) skip = SF(isa, or)(SF(isa, cmpeq##bits)(A, E), \
+            SF(isa, cmpeq##bits)(B, D)); \
+      \
+      SF(isa, zip##bits)( \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq##bits)(A, B), skip), A, C), \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq##bits)(A, D), skip), A, C), \
+            &lo, &hi); \
+      SF(isa, store)(out0 + (x << 1), lo); \
+      SF(isa, store)(out0 + (x << 1) + n, hi); \
+      \
+      SF(isa, zip##bits)( \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq##bits)(E, B), skip), E, C), \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, cmpeq##bits)(E, D), skip), E, C), \
+            &lo, &hi); \
+      SF(isa, store)(out1 + (x << 1), lo); \
+      SF(isa, store)(out1 + (x << 1) + n, hi); \
+   } \
+   \
+   return x; \
+}
+
+#ifdef SOFTFILTER_HAVE_AVX2
+SCALE2X_SIMD_ROW(avx2, 16)
+SCALE2X_SIMD_ROW(avx2, 32)
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+SCALE2X_SIMD_ROW(sse2, 16)
+SCALE2X_SIMD_ROW(sse2, 32)
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+SCALE2X_SIMD_ROW(neon, 16)
+SCALE2X_SIMD_ROW(neon, 32)
+#endif
+
+/* In order of preference */
+static const struct
+{
+   softfilter_simd_mask_t simd;
+   scale2x_row_t rgb565;
+   scale2x_row_t xrgb8888;
+} scale2x_rows[] = {
+#ifdef SOFTFILTER_HAVE_AVX2
+   { SOFTFILTER_SIMD_AVX2, scale2x_row_avx2_16, scale2x_row_avx2_32 },
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+   { SOFTFILTER_SIMD_SSE2, scale2x_row_sse2_16, scale2x_row_sse2_32 },
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+   { SOFTFILTER_SIMD_NEON, scale2x_row_neon_16, scale2x_row_neon_32 },
+#endif
+   { 0,                    NULL,                NULL                },
+};
+
 static void scale2x_generic_rgb565(unsigned width, unsigned height,
       int first, int last,
       const uint16_t *src, unsigned src_stride,
-      uint16_t *dst, unsigned dst_stride)
+      uint16_t *dst, unsigned dst_stride, scale2x_row_t row)
 {
    unsigned x, y;
-   uint16_t *out0, *out1;
-   out0 = (uint16_t*)dst;
-   out1 = (uint16_t*)(dst + dst_stride);
    SCALE2X_GENERIC(uint16_t, width, height, first, last,
-         src, src_stride, dst, dst_stride, out0, out1);
+         src, src_stride, dst, dst_stride, row);
 }
 
 static void scale2x_generic_xrgb8888(unsigned width, unsigned height,
       int first, int last,
       const uint32_t *src, unsigned src_stride,
-      uint32_t *dst, unsigned dst_stride)
+      uint32_t *dst, unsigned dst_stride, scale2x_row_t row)
 {
    unsigned x, y;
-   uint32_t *out0 = (uint32_t*)dst;
-   uint32_t *out1 = (uint32_t*)(dst + dst_stride);
-
    SCALE2X_GENERIC(uint32_t, width, height, first, last,
-         src, src_stride, dst, dst_stride, out0, out1);
+         src, src_stride, dst, dst_stride, row);
 }
 
 static unsigned scale2x_generic_input_fmts(void)
@@ -129,16 +219,20 @@ static void *scale2x_generic_create(const struct softfilter_config *config,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
+   unsigned i;
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
-   (void)simd;
    (void)config;
    (void)userdata;
    if (!filt)
       return NULL;
    filt->workers = (struct softfilter_thread_data*)
       calloc(threads, sizeof(struct softfilter_thread_data));
-   filt->threads = 1;
+   filt->threads = threads;
    filt->in_fmt  = in_fmt;
+   for (i = 0; (scale2x_rows[i].simd & simd) != scale2x_rows[i].simd; )
+      i++;
+   filt->row     = (in_fmt == SOFTFILTER_FMT_RGB565)
+      ? scale2x_rows[i].rgb565 : scale2x_rows[i].xrgb8888;
    if (!filt->workers)
    {
       free(filt);
@@ -168,6 +262,7 @@ static void scale2x_generic_destroy(void *data)
 
 static void scale2x_work_cb_xrgb8888(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr =
       (struct softfilter_thread_data*)thread_data;
    const uint32_t *input = (const uint32_t*)thr->in_data;
@@ -179,11 +274,12 @@ static void scale2x_work_cb_xrgb8888(void *data, void *thread_data)
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
          output,
-         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
+         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888), filt->row);
 }
 
 static void scale2x_work_cb_rgb565(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr =
       (struct softfilter_thread_data*)thread_data;
    const uint16_t *input = (const uint16_t*)thr->in_data;
@@ -195,7 +291,7 @@ static void scale2x_work_cb_rgb565(void *data, void *thread_data)
          thr->first, thr->last, input,
          (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
          output,
-         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
+         (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565), filt->row);
 }
 
 static void scale2x_generic_packets(void *data,
@@ -222,7 +318,7 @@ static void scale2x_generic_packets(void *data,
 
       /* Workers need to know if they can access pixels
        * outside their given buffer. */
-      thr->first = y_start;
+      thr->first = y_start == 0;
       thr->last = y_end == height;
 
       if (filt->in_fmt == SOFTFILTER_FMT_XRGB8888)
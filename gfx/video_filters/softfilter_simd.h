@@ -0,0 +1,285 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOFTFILTER_SIMD_H__
+#define SOFTFILTER_SIMD_H__
+
+/* Vector operations shared by the softfilter kernels.
+ *
+ * Every backend (sse2, avx2, neon) provides the same set of
+ * operations, named sf_<backend>_<op>, on a vector of RGB565
+ * (16-bit lanes) or XRGB8888 (32-bit lanes) pixels. A filter
+ * writes its kernel once as a macro taking the backend name,
+ * instantiates it for each backend that was compiled in and
+ * picks one in create() from the SIMD mask it is given.
+ *
+ * Loads and stores are unaligned. Comparisons return lanes
+ * with all bits set or cleared, sf_*_select() takes such a
+ * mask. sf_*_zip16/32 interleave two vectors lane by lane
+ * and return the result in memory order, which is how the
+ * 2x scalers write two output pixels per input pixel. */
+
+#include <stdint.h>
+#include <retro_inline.h>
+
+#include "softfilter.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_IX86) || defined(_M_AMD64) || defined(_M_X64)
+#if defined(__SSE2__) || defined(_M_AMD64) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SOFTFILTER_HAVE_SSE2
+#endif
+
+/* AVX2 is not part of the baseline; build it with a target
+ * attribute and only use it if the CPU reports it. */
+#if defined(__clang__)
+#if (__clang_major__ > 3) || (__clang_major__ == 3 && __clang_minor__ >= 8)
+#define SOFTFILTER_HAVE_AVX2
+#define SOFTFILTER_TARGET_avx2 __attribute__((target("avx2")))
+#endif
+#elif defined(__GNUC__)
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define SOFTFILTER_HAVE_AVX2
+#define SOFTFILTER_TARGET_avx2 __attribute__((target("avx2")))
+#endif
+#elif defined(_MSC_VER) && (_MSC_VER >= 1800)
+#define SOFTFILTER_HAVE_AVX2
+#define SOFTFILTER_TARGET_avx2
+#endif
+#endif
+
+/* The NEON kernels have not been run on ARM hardware yet, so
+ * they are opt-in: build with -DSOFTFILTER_WANT_NEON to use them
+ * and compare against the scalar output with softfilter_check. */
+#if defined(SOFTFILTER_WANT_NEON) && (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#define SOFTFILTER_HAVE_NEON
+#endif
+
+#define SOFTFILTER_TARGET_sse2
+#define SOFTFILTER_TARGET_neon
+
+/* Names the operation 'op' of backend 'isa'. */
+#define SF(isa, op) sf_##isa##_##op
+
+#ifdef SOFTFILTER_HAVE_SSE2
+#include <emmintrin.h>
+
+#define sf_sse2_bytes 16
+
+typedef __m128i sf_sse2_t;
+
+static INLINE __m128i sf_sse2_load(const void *p)
+{
+   return _mm_loadu_si128((const __m128i*)p);
+}
+
+static INLINE void sf_sse2_store(void *p, __m128i v)
+{
+   _mm_storeu_si128((__m128i*)p, v);
+}
+
+static INLINE __m128i sf_sse2_set16(uint16_t x)     { return _mm_set1_epi16((short)x); }
+static INLINE __m128i sf_sse2_set32(uint32_t x)     { return _mm_set1_epi32((int)x); }
+static INLINE __m128i sf_sse2_and(__m128i a, __m128i b) { return _mm_and_si128(a, b); }
+static INLINE __m128i sf_sse2_or(__m128i a, __m128i b)  { return _mm_or_si128(a, b); }
+static INLINE __m128i sf_sse2_xor(__m128i a, __m128i b) { return _mm_xor_si128(a, b); }
+/* a & ~b */
+static INLINE __m128i sf_sse2_andnot(__m128i a, __m128i b) { return _mm_andnot_si128(b, a); }
+static INLINE __m128i sf_sse2_add16(__m128i a, __m128i b)   { return _mm_add_epi16(a, b); }
+static INLINE __m128i sf_sse2_add32(__m128i a, __m128i b)   { return _mm_add_epi32(a, b); }
+static INLINE __m128i sf_sse2_sub16(__m128i a, __m128i b)   { return _mm_sub_epi16(a, b); }
+static INLINE __m128i sf_sse2_sub32(__m128i a, __m128i b)   { return _mm_sub_epi32(a, b); }
+static INLINE __m128i sf_sse2_cmpeq16(__m128i a, __m128i b) { return _mm_cmpeq_epi16(a, b); }
+static INLINE __m128i sf_sse2_cmpeq32(__m128i a, __m128i b) { return _mm_cmpeq_epi32(a, b); }
+/* Signed */
+static INLINE __m128i sf_sse2_cmpgt16(__m128i a, __m128i b) { return _mm_cmpgt_epi16(a, b); }
+static INLINE __m128i sf_sse2_cmpgt32(__m128i a, __m128i b) { return _mm_cmpgt_epi32(a, b); }
+
+static INLINE __m128i sf_sse2_select(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+#define sf_sse2_srl16(v, n) _mm_srli_epi16(v, n)
+#define sf_sse2_srl32(v, n) _mm_srli_epi32(v, n)
+#define sf_sse2_sll16(v, n) _mm_slli_epi16(v, n)
+#define sf_sse2_sll32(v, n) _mm_slli_epi32(v, n)
+
+static INLINE void sf_sse2_zip16(__m128i a, __m128i b, __m128i *lo, __m128i *hi)
+{
+   *lo = _mm_unpacklo_epi16(a, b);
+   *hi = _mm_unpackhi_epi16(a, b);
+}
+
+static INLINE void sf_sse2_zip32(__m128i a, __m128i b, __m128i *lo, __m128i *hi)
+{
+   *lo = _mm_unpacklo_epi32(a, b);
+   *hi = _mm_unpackhi_epi32(a, b);
+}
+#endif
+
+#ifdef SOFTFILTER_HAVE_AVX2
+#include <immintrin.h>
+
+#define sf_avx2_bytes 32
+
+typedef __m256i sf_avx2_t;
+
+#define SF_AVX2_INLINE static INLINE SOFTFILTER_TARGET_avx2
+
+SF_AVX2_INLINE __m256i sf_avx2_load(const void *p)
+{
+   return _mm256_loadu_si256((const __m256i*)p);
+}
+
+SF_AVX2_INLINE void sf_avx2_store(void *p, __m256i v)
+{
+   _mm256_storeu_si256((__m256i*)p, v);
+}
+
+SF_AVX2_INLINE __m256i sf_avx2_set16(uint16_t x)     { return _mm256_set1_epi16((short)x); }
+SF_AVX2_INLINE __m256i sf_avx2_set32(uint32_t x)     { return _mm256_set1_epi32((int)x); }
+SF_AVX2_INLINE __m256i sf_avx2_and(__m256i a, __m256i b) { return _mm256_and_si256(a, b); }
+SF_AVX2_INLINE __m256i sf_avx2_or(__m256i a, __m256i b)  { return _mm256_or_si256(a, b); }
+SF_AVX2_INLINE __m256i sf_avx2_xor(__m256i a, __m256i b) { return _mm256_xor_si256(a, b); }
+/* a & ~b */
+SF_AVX2_INLINE __m256i sf_avx2_andnot(__m256i a, __m256i b) { return _mm256_andnot_si256(b, a); }
+SF_AVX2_INLINE __m256i sf_avx2_add16(__m256i a, __m256i b)   { return _mm256_add_epi16(a, b); }
+SF_AVX2_INLINE __m256i sf_avx2_add32(__m256i a, __m256i b)   { return _mm256_add_epi32(a, b); }
+SF_AVX2_INLINE __m256i sf_avx2_sub16(__m256i a, __m256i b)   { return _mm256_sub_epi16(a, b); }
+SF_AVX2_INLINE __m256i sf_avx2_sub32(__m256i a, __m256i b)   { return _mm256_sub_epi32(a, b); }
+SF_AVX2_INLINE __m256i sf_avx2_cmpeq16(__m256i a, __m256i b) { return _mm256_cmpeq_epi16(a, b); }
+SF_AVX2_INLINE __m256i sf_avx2_cmpeq32(__m256i a, __m256i b) { return _mm256_cmpeq_epi32(a, b); }
+/* Signed */
+SF_AVX2_INLINE __m256i sf_avx2_cmpgt16(__m256i a, __m256i b) { return _mm256_cmpgt_epi16(a, b); }
+SF_AVX2_INLINE __m256i sf_avx2_cmpgt32(__m256i a, __m256i b) { return _mm256_cmpgt_epi32(a, b); }
+
+SF_AVX2_INLINE __m256i sf_avx2_select(__m256i mask, __m256i a, __m256i b)
+{
+   return _mm256_blendv_epi8(b, a, mask);
+}
+
+#define sf_avx2_srl16(v, n) _mm256_srli_epi16(v, n)
+#define sf_avx2_srl32(v, n) _mm256_srli_epi32(v, n)
+#define sf_avx2_sll16(v, n) _mm256_slli_epi16(v, n)
+#define sf_avx2_sll32(v, n) _mm256_slli_epi32(v, n)
+
+/* The unpack instructions work within each 128-bit half,
+ * put the halves back in memory order. */
+SF_AVX2_INLINE void sf_avx2_zip16(__m256i a, __m256i b, __m256i *lo, __m256i *hi)
+{
+   __m256i l = _mm256_unpacklo_epi16(a, b);
+   __m256i h = _mm256_unpackhi_epi16(a, b);
+   *lo       = _mm256_permute2x128_si256(l, h, 0x20);
+   *hi       = _mm256_permute2x128_si256(l, h, 0x31);
+}
+
+SF_AVX2_INLINE void sf_avx2_zip32(__m256i a, __m256i b, __m256i *lo, __m256i *hi)
+{
+   __m256i l = _mm256_unpacklo_epi32(a, b);
+   __m256i h = _mm256_unpackhi_epi32(a, b);
+   *lo       = _mm256_permute2x128_si256(l, h, 0x20);
+   *hi       = _mm256_permute2x128_si256(l, h, 0x31);
+}
+#endif
+
+#ifdef SOFTFILTER_HAVE_NEON
+#include <arm_neon.h>
+
+#define sf_neon_bytes 16
+
+typedef uint32x4_t sf_neon_t;
+
+#define SF_NEON_U16(v) vreinterpretq_u16_u32(v)
+#define SF_NEON_S16(v) vreinterpretq_s16_u32(v)
+#define SF_NEON_S32(v) vreinterpretq_s32_u32(v)
+#define SF_NEON_U32(v) vreinterpretq_u32_u16(v)
+
+static INLINE uint32x4_t sf_neon_load(const void *p)
+{
+   return vreinterpretq_u32_u8(vld1q_u8((const uint8_t*)p));
+}
+
+static INLINE void sf_neon_store(void *p, uint32x4_t v)
+{
+   vst1q_u8((uint8_t*)p, vreinterpretq_u8_u32(v));
+}
+
+static INLINE uint32x4_t sf_neon_set16(uint16_t x)        { return SF_NEON_U32(vdupq_n_u16(x)); }
+static INLINE uint32x4_t sf_neon_set32(uint32_t x)        { return vdupq_n_u32(x); }
+static INLINE uint32x4_t sf_neon_and(uint32x4_t a, uint32x4_t b) { return vandq_u32(a, b); }
+static INLINE uint32x4_t sf_neon_or(uint32x4_t a, uint32x4_t b)  { return vorrq_u32(a, b); }
+static INLINE uint32x4_t sf_neon_xor(uint32x4_t a, uint32x4_t b) { return veorq_u32(a, b); }
+/* a & ~b */
+static INLINE uint32x4_t sf_neon_andnot(uint32x4_t a, uint32x4_t b) { return vbicq_u32(a, b); }
+
+static INLINE uint32x4_t sf_neon_add16(uint32x4_t a, uint32x4_t b)
+{
+   return SF_NEON_U32(vaddq_u16(SF_NEON_U16(a), SF_NEON_U16(b)));
+}
+
+static INLINE uint32x4_t sf_neon_add32(uint32x4_t a, uint32x4_t b) { return vaddq_u32(a, b); }
+
+static INLINE uint32x4_t sf_neon_sub16(uint32x4_t a, uint32x4_t b)
+{
+   return SF_NEON_U32(vsubq_u16(SF_NEON_U16(a), SF_NEON_U16(b)));
+}
+
+static INLINE uint32x4_t sf_neon_sub32(uint32x4_t a, uint32x4_t b) { return vsubq_u32(a, b); }
+
+static INLINE uint32x4_t sf_neon_cmpeq16(uint32x4_t a, uint32x4_t b)
+{
+   return SF_NEON_U32(vceqq_u16(SF_NEON_U16(a), SF_NEON_U16(b)));
+}
+
+static INLINE uint32x4_t sf_neon_cmpeq32(uint32x4_t a, uint32x4_t b) { return vceqq_u32(a, b); }
+
+/* Signed */
+static INLINE uint32x4_t sf_neon_cmpgt16(uint32x4_t a, uint32x4_t b)
+{
+   return SF_NEON_U32(vcgtq_s16(SF_NEON_S16(a), SF_NEON_S16(b)));
+}
+
+static INLINE uint32x4_t sf_neon_cmpgt32(uint32x4_t a, uint32x4_t b)
+{
+   return vcgtq_s32(SF_NEON_S32(a), SF_NEON_S32(b));
+}
+
+static INLINE uint32x4_t sf_neon_select(uint32x4_t mask, uint32x4_t a, uint32x4_t b)
+{
+   return vbslq_u32(mask, a, b);
+}
+
+#define sf_neon_srl16(v, n) SF_NEON_U32(vshrq_n_u16(SF_NEON_U16(v), n))
+#define sf_neon_srl32(v, n) vshrq_n_u32(v, n)
+#define sf_neon_sll16(v, n) SF_NEON_U32(vshlq_n_u16(SF_NEON_U16(v), n))
+#define sf_neon_sll32(v, n) vshlq_n_u32(v, n)
+
+static INLINE void sf_neon_zip16(uint32x4_t a, uint32x4_t b, uint32x4_t *lo, uint32x4_t *hi)
+{
+   uint16x8x2_t z = vzipq_u16(SF_NEON_U16(a), SF_NEON_U16(b));
+   *lo            = SF_NEON_U32(z.val[0]);
+   *hi            = SF_NEON_U32(z.val[1]);
+}
+
+static INLINE void sf_neon_zip32(uint32x4_t a, uint32x4_t b, uint32x4_t *lo, uint32x4_t *hi)
+{
+   uint32x4x2_t z = vzipq_u32(a, b);
+   *lo            = z.val[0];
+   *hi            = z.val[1];
+}
+#endif
+
+#endif
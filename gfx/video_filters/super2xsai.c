@@ -17,6 +17,7 @@
 /* Compile: gcc -o supertwoxsai.so -shared supertwoxsai.c -std=c99 -O3 -Wall -pedantic -fPIC */
 
 #include "softfilter.h"
+#include "softfilter_simd.h"
 #include <stdlib.h>
 
 #ifdef RARCH_INTERNAL
@@ -40,11 +41,218 @@ struct softfilter_thread_data
    int last;
 };
 
+/* Processes pixels 0 and up of a row, returns the first pixel
+ * left for the scalar loop. */
+typedef unsigned (*supertwoxsai_row_t)(const void *in, unsigned nextline,
+      void *out0, void *out1, unsigned width);
+
 struct filter_data
 {
    unsigned threads;
    struct softfilter_thread_data *workers;
    unsigned in_fmt;
+   supertwoxsai_row_t row;
+};
+
+/* The interpolation masks of supertwoxsai_interpolate(2)_*,
+ * by lane width. */
+#define SUPERTWOXSAI_HALF_16          0xF7DE
+#define SUPERTWOXSAI_HALF_LOW_16      0x0821
+#define SUPERTWOXSAI_QUARTER_16       0xE79C
+#define SUPERTWOXSAI_QUARTER_LOW_16   0x1863
+#define SUPERTWOXSAI_HALF_32          0xFEFEFEFE
+#define SUPERTWOXSAI_HALF_LOW_32      0x01010101
+#define SUPERTWOXSAI_QUARTER_32       0xFCFCFCFC
+#define SUPERTWOXSAI_QUARTER_LOW_32   0x03030303
+
+/* supertwoxsai_function, a vector of pixels at a time. Every
+ * branch becomes a lane mask, the products are picked with
+ * them. The interpolations don't carry out of a 16-bit lane. */
+#define SUPERTWOXSAI_SIMD_ROW(isa, bits) \
+static INLINE SOFTFILTER_TARGET_##isa SF(isa, t) supertwoxsai_interpolate_##isa##_##bits( \
+      SF(isa, t) a, SF(isa, t) b) \
+{ \
+   SF(isa, t) half = SF(isa, set##bits)(SUPERTWOXSAI_HALF_##bits); \
+   return SF(isa, add##bits)(SF(isa, add##bits)( \
+            SF(isa, srl##bits)(SF(isa, and)(a, half), 1), \
+            SF(isa, srl##bits)(SF(isa, and)(b, half), 1)), \
+         SF(isa, and)(SF(isa, and)(a, b), SF(isa, set##bits)(SUPERTWOXSAI_HALF_LOW_##bits))); \
+} \
+\
+/* supertwoxsai_interpolate2(a, a, a, b) */ \
+static INLINE SOFTFILTER_TARGET_##isa SF(isa, t) supertwoxsai_interpolate2_##isa##_##bits( \
+      SF(isa, t) a, SF(isa, t) b) \
+{ \
+   SF(isa, t) quarter     = SF(isa, set##bits)(SUPERTWOXSAI_QUARTER_##bits); \
+   SF(isa, t) quarter_low = SF(isa, set##bits)(SUPERTWOXSAI_QUARTER_LOW_##bits); \
+   SF(isa, t) a_high      = SF(isa, srl##bits)(SF(isa, and)(a, quarter), 2); \
+   SF(isa, t) a_low       = SF(isa, and)(a, quarter_low); \
+   SF(isa, t) high        = SF(isa, add##bits)( \
+         SF(isa, add##bits)(a_high, a_high), \
+         SF(isa, add##bits)(a_high, SF(isa, srl##bits)(SF(isa, and)(b, quarter), 2))); \
+   SF(isa, t) low         = SF(isa, add##bits)( \
+         SF(isa, add##bits)(a_low, a_low), \
+         SF(isa, add##bits)(a_low, SF(isa, and)(b, quarter_low))); \
+   return SF(isa, add##bits)(high, \
+         SF(isa, and)(SF(isa, srl##bits)(low, 2), quarter_low)); \
+} \
+\
+static SOFTFILTER_TARGET_##isa unsigned supertwoxsai_row_##isa##_##bits( \
+      const void *in_data, unsigned nextline, \
+      void *out0_data, void *out1_data, unsigned width) \
+{ \
+   const uint##bits##_t *in    = (const uint##bits##_t*)in_data; \
+   const uint##bits##_t *up    = in - nextline; \
+   const uint##bits##_t *down  = in + nextline; \
+   const uint##bits##_t *down2 = down + nextline; \
+   uint##bits##_t *out0        = (uint##bits##_t*)out0_data; \
+   uint##bits##_t *out1        = (uint##bits##_t*)out1_data; \
+   const unsigned n            = SF(isa, bytes) / (bits / 8); \
+   unsigned x; \
+   \
+   for (x = 0; x + n <= width; x += n) \
+   { \
+      SF(isa, t) lo, hi, r, c1, c2, c3, c4, i25, i56, i23, shared; \
+      SF(isa, t) product1a, product1b, product2a, product2b; \
+      SF(isa, t) colorB0 = SF(isa, load)(up + x - 1); \
+      SF(isa, t) colorB1 = SF(isa, load)(up + x); \
+      SF(isa, t) colorB2 = SF(isa, load)(up + x + 1); \
+      SF(isa, t) colorB3 = SF(isa, load)(up + x + 2); \
+      SF(isa, t) color4  = SF(isa, load)(in + x - 1); \
+      SF(isa, t) color5  = SF(isa, load)(in + x); \
+      SF(isa, t) color6  = SF(isa, load)(in + x + 1); \
+      SF(isa, t) colorS2 = SF(isa, load)(in + x + 2); \
+      SF(isa, t) color1  = SF(isa, load)(down + x - 1); \
+      SF(isa, t) color2  = SF(isa, load)(down + x); \
+      SF(isa, t) color3  = SF(isa, load)(down + x + 1); \
+      SF(isa, t) colorS1 = SF(isa, load)(down + x + 2); \
+      SF(isa, t) colorA0 = SF(isa, load)(down2 + x - 1); \
+      SF(isa, t) colorA1 = SF(isa, load)(down2 + x); \
+      SF(isa, t) colorA2 = SF(isa, load)(down2 + x + 1); \
+      SF(isa, t) colorA3 = SF(isa, load)(down2 + x + 2); \
+      SF(isa, t) zero    = SF(isa, xor)(color5, color5); \
+      SF(isa, t) ones    = SF(isa, cmpeq##bits)(color5, color5); \
+      SF(isa, t) eq26    = SF(isa, cmpeq##bits)(color2, color6); \
+      SF(isa, t) eq53    = SF(isa, cmpeq##bits)(color5, color3); \
+      SF(isa, t) eq52    = SF(isa, cmpeq##bits)(color5, color2); \
+      SF(isa, t) eq63    = SF(isa, cmpeq##bits)(color6, color3); \
+      \
+      /* The four branches */ \
+      c1 = SF(isa, andnot)(eq26, eq53); \
+      c2 = SF(isa, andnot)(eq53, eq26); \
+      c3 = SF(isa, and)(eq26, eq53); \
+      c4 = SF(isa, andnot)(ones, SF(isa, or)(eq26, eq53)); \
+      \
+      /* supertwoxsai_result, each term is 0 or -1 per lane */ \
+      r = SF(isa, add##bits)( \
+            SF(isa, add##bits)( \
+               SF(isa, sub##bits)( \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(color6, color1), SF(isa, cmpeq##bits)(color6, colorA1)), \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(color5, color1), SF(isa, cmpeq##bits)(color5, colorA1))), \
+               SF(isa, sub##bits)( \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(color6, color4), SF(isa, cmpeq##bits)(color6, colorB1)), \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(color5, color4), SF(isa, cmpeq##bits)(color5, colorB1)))), \
+            SF(isa, add##bits)( \
+               SF(isa, sub##bits)( \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(color6, colorA2), SF(isa, cmpeq##bits)(color6, colorS1)), \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(color5, colorA2), SF(isa, cmpeq##bits)(color5, colorS1))), \
+               SF(isa, sub##bits)( \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(color6, colorB2), SF(isa, cmpeq##bits)(color6, colorS2)), \
+                  SF(isa, and)(SF(isa, cmpeq##bits)(color5, colorB2), SF(isa, cmpeq##bits)(color5, colorS2))))); \
+      \
+      i25 = supertwoxsai_interpolate_##isa##_##bits(color2, color5); \
+      i56 = supertwoxsai_interpolate_##isa##_##bits(color5, color6); \
+      i23 = supertwoxsai_interpolate_##isa##_##bits(color2, color3); \
+      \
+      /* product1b and product2b of the first three branches */ \
+      shared = SF(isa, select)(c1, color2, \
+            SF(isa, select)(SF(isa, or)(c2, SF(isa, and)(c3, SF(isa, cmpgt##bits)(zero, r))), color5, \
+               SF(isa, select)(SF(isa, and)(c3, SF(isa, cmpgt##bits)(r, zero)), color6, i56))); \
+      \
+      product2b = SF(isa, select)(c4, \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, andnot)(SF(isa, and)(eq63, \
+                        SF(isa, cmpeq##bits)(color3, colorA1)), \
+                     SF(isa, cmpeq##bits)(color2, colorA2)), \
+                  SF(isa, cmpeq##bits)(color3, colorA0)), \
+               supertwoxsai_interpolate2_##isa##_##bits(color3, color2), \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, andnot)(SF(isa, and)(eq52, \
+                        SF(isa, cmpeq##bits)(color2, colorA2)), \
+                     SF(isa, cmpeq##bits)(colorA1, color3)), \
+                  SF(isa, cmpeq##bits)(color2, colorA3)), \
+               supertwoxsai_interpolate2_##isa##_##bits(color2, color3), i23)), \
+            shared); \
+      product1b = SF(isa, select)(c4, \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, andnot)(SF(isa, and)(eq63, \
+                        SF(isa, cmpeq##bits)(color6, colorB1)), \
+                     SF(isa, cmpeq##bits)(color5, colorB2)), \
+                  SF(isa, cmpeq##bits)(color6, colorB0)), \
+               supertwoxsai_interpolate2_##isa##_##bits(color6, color5), \
+            SF(isa, select)(SF(isa, andnot)(SF(isa, andnot)(SF(isa, and)(eq52, \
+                        SF(isa, cmpeq##bits)(color5, colorB2)), \
+                     SF(isa, cmpeq##bits)(colorB1, color6)), \
+                  SF(isa, cmpeq##bits)(color5, colorB3)), \
+               supertwoxsai_interpolate2_##isa##_##bits(color5, color6), i56)), \
+            shared); \
+      \
+      product2a = SF(isa, select)(SF(isa, or)( \
+               SF(isa, andnot)(SF(isa, and)(c2, SF(isa, cmpeq##bits)(color4, color5)), \
+                  SF(isa, cmpeq##bits)(color5, colorA2)), \
+               SF(isa, andnot)(SF(isa, andnot)(SF(isa, and)( \
+                        SF(isa, cmpeq##bits)(color5, color1), SF(isa, cmpeq##bits)(color6, color5)), \
+                     SF(isa, cmpeq##bits)(color4, color2)), \
+                  SF(isa, cmpeq##bits)(color5, colorA0))), \
+            i25, color2); \
+      product1a = SF(isa, select)(SF(isa, or)( \
+               SF(isa, andnot)(SF(isa, and)(c1, SF(isa, cmpeq##bits)(color1, color2)), \
+                  SF(isa, cmpeq##bits)(color2, colorB2)), \
+               SF(isa, andnot)(SF(isa, andnot)(SF(isa, and)( \
+                        SF(isa, cmpeq##bits)(color4, color2), SF(isa, cmpeq##bits)(color3, color2)), \
+                     SF(isa, cmpeq##bits)(color1, color5)), \
+                  SF(isa, cmpeq##bits)(color2, colorB0))), \
+            i25, color5); \
+      \
+      SF(isa, zip##bits)(product1a, product1b, &lo, &hi); \
+      SF(isa, store)(out0 + (x << 1), lo); \
+      SF(isa, store)(out0 + (x << 1) + n, hi); \
+      \
+      SF(isa, zip##bits)(product2a, product2b, &lo, &hi); \
+      SF(isa, store)(out1 + (x << 1), lo); \
+      SF(isa, store)(out1 + (x << 1) + n, hi); \
+   } \
+   \
+   return x; \
+}
+
+#ifdef SOFTFILTER_HAVE_AVX2
+SUPERTWOXSAI_SIMD_ROW(avx2, 16)
+SUPERTWOXSAI_SIMD_ROW(avx2, 32)
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+SUPERTWOXSAI_SIMD_ROW(sse2, 16)
+SUPERTWOXSAI_SIMD_ROW(sse2, 32)
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+SUPERTWOXSAI_SIMD_ROW(neon, 16)
+SUPERTWOXSAI_SIMD_ROW(neon, 32)
+#endif
+
+/* In order of preference */
+static const struct
+{
+   softfilter_simd_mask_t simd;
+   supertwoxsai_row_t rgb565;
+   supertwoxsai_row_t xrgb8888;
+} supertwoxsai_rows[] = {
+#ifdef SOFTFILTER_HAVE_AVX2
+   { SOFTFILTER_SIMD_AVX2, supertwoxsai_row_avx2_16, supertwoxsai_row_avx2_32 },
+#endif
+#ifdef SOFTFILTER_HAVE_SSE2
+   { SOFTFILTER_SIMD_SSE2, supertwoxsai_row_sse2_16, supertwoxsai_row_sse2_32 },
+#endif
+#ifdef SOFTFILTER_HAVE_NEON
+   { SOFTFILTER_SIMD_NEON, supertwoxsai_row_neon_16, supertwoxsai_row_neon_32 },
+#endif
+   { 0,                    NULL,                     NULL                     },
 };
 
 static unsigned supertwoxsai_generic_input_fmts(void)
@@ -68,17 +276,23 @@ static void *supertwoxsai_generic_create(const struct softfilter_config *config,
       unsigned max_width, unsigned max_height,
       unsigned threads, softfilter_simd_mask_t simd, void *userdata)
 {
+   unsigned i;
    struct filter_data *filt = (struct filter_data*)calloc(1, sizeof(*filt));
    if (!filt)
       return NULL;
 
-   (void)simd;
    (void)config;
    (void)userdata;
 
    filt->workers = (struct softfilter_thread_data*)calloc(threads, sizeof(struct softfilter_thread_data));
+   /* Rows at the band edges are filtered differently, so the
+    * frame is not split. */
    filt->threads = 1;
    filt->in_fmt  = in_fmt;
+   for (i = 0; (supertwoxsai_rows[i].simd & simd) != supertwoxsai_rows[i].simd; )
+      i++;
+   filt->row     = (in_fmt == SOFTFILTER_FMT_RGB565)
+      ? supertwoxsai_rows[i].rgb565 : supertwoxsai_rows[i].xrgb8888;
 
    if (!filt->workers)
    {
@@ -202,7 +416,8 @@ static void supertwoxsai_generic_destroy(void *data)
 
 static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
       int first, int last, uint32_t *src,
-      unsigned src_stride, uint32_t *dst, unsigned dst_stride)
+      unsigned src_stride, uint32_t *dst, unsigned dst_stride,
+      supertwoxsai_row_t row)
 {
    unsigned finish;
    unsigned nextline = (last) ? 0 : src_stride;
@@ -212,7 +427,18 @@ static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
       uint32_t *in  = (uint32_t*)src;
       uint32_t *out = (uint32_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+
+      if (row)
+      {
+         unsigned x = row(in, nextline, out, out + dst_stride, width);
+
+         in     += x;
+         out    += x << 1;
+         finish -= x;
+      }
+
+      for (; finish; finish -= 1)
       {
          supertwoxsai_declare_variables(uint32_t, in, nextline);
 
@@ -232,7 +458,8 @@ static void supertwoxsai_generic_xrgb8888(unsigned width, unsigned height,
 
 static void supertwoxsai_generic_rgb565(unsigned width, unsigned height,
       int first, int last, uint16_t *src,
-      unsigned src_stride, uint16_t *dst, unsigned dst_stride)
+      unsigned src_stride, uint16_t *dst, unsigned dst_stride,
+      supertwoxsai_row_t row)
 {
    unsigned finish;
    unsigned nextline = (last) ? 0 : src_stride;
@@ -242,7 +469,18 @@ static void supertwoxsai_generic_rgb565(unsigned width, unsigned height,
       uint16_t *in  = (uint16_t*)src;
       uint16_t *out = (uint16_t*)dst;
 
-      for (finish = width; finish; finish -= 1)
+      finish = width;
+
+      if (row)
+      {
+         unsigned x = row(in, nextline, out, out + dst_stride, width);
+
+         in     += x;
+         out    += x << 1;
+         finish -= x;
+      }
+
+      for (; finish; finish -= 1)
       {
          supertwoxsai_declare_variables(uint16_t, in, nextline);
 
@@ -262,6 +500,7 @@ static void supertwoxsai_generic_rgb565(unsigned width, unsigned height,
 
 static void supertwoxsai_work_cb_rgb565(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
    uint16_t *input = (uint16_t*)thr->in_data;
    uint16_t *output = (uint16_t*)thr->out_data;
@@ -272,11 +511,12 @@ static void supertwoxsai_work_cb_rgb565(void *data, void *thread_data)
          thr->first, thr->last, input,
         (unsigned)(thr->in_pitch / SOFTFILTER_BPP_RGB565),
         output,
-        (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565));
+        (unsigned)(thr->out_pitch / SOFTFILTER_BPP_RGB565), filt->row);
 }
 
 static void supertwoxsai_work_cb_xrgb8888(void *data, void *thread_data)
 {
+   struct filter_data *filt = (struct filter_data*)data;
    struct softfilter_thread_data *thr = (struct softfilter_thread_data*)thread_data;
    uint32_t *input = (uint32_t*)thr->in_data;
    uint32_t *output = (uint32_t*)thr->out_data;
@@ -287,7 +527,7 @@ static void supertwoxsai_work_cb_xrgb8888(void *data, void *thread_data)
          thr->first, thr->last, input,
             (unsigned)(thr->in_pitch / SOFTFILTER_BPP_XRGB8888),
             output,
-            (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888));
+            (unsigned)(thr->out_pitch / SOFTFILTER_BPP_XRGB8888), filt->row);
 }
 
 static void supertwoxsai_generic_packets(void *data,
@@ -0,0 +1,407 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <features/features_cpu.h>
+#include <retro_atomic.h>
+#include <retro_inline.h>
+#include <retro_miscellaneous.h>
+
+#ifdef HAVE_CONFIG_H
+#include "../config.h"
+#endif
+
+#include "video_frame_jobs.h"
+
+/* The workers need atomics, without them every job runs on
+ * the calling thread. */
+#if defined(HAVE_THREADS) && defined(HAVE_RETRO_ATOMIC)
+#define HAVE_FRAME_JOBS_THREADS
+#endif
+
+#ifdef HAVE_FRAME_JOBS_THREADS
+#include <rthreads/rthreads.h>
+
+/* Spin iterations an idle worker waits for the next job before
+ * it sleeps. Doubles each time a job arrives while spinning,
+ * halves each time the worker had to be woken up. */
+#define FRAME_JOBS_SPIN_MIN   64
+#define FRAME_JOBS_SPIN_MAX   8192
+
+/* Spin iterations the calling thread waits for the last jobs. */
+#define FRAME_JOBS_SPIN_DONE  4096
+
+/* The claim counter holds the low 16 bits of the generation it
+ * belongs to and the index of the next job, so a worker which
+ * is late to a frame can never take a job of the next one. */
+#define FRAME_JOBS_CLAIM(generation) (((generation) & 0xffff) << 16)
+#define FRAME_JOBS_CLAIM_CLOSED      0xffffffffU
+#endif
+
+/* Threads a pool gets by default. Frames are small, beyond
+ * this the wakeups cost more than the extra cores win. */
+#define FRAME_JOBS_DEFAULT_THREADS 8
+
+struct video_frame_jobs
+{
+   unsigned num_threads;
+
+#ifdef HAVE_FRAME_JOBS_THREADS
+   sthread_t **workers;
+   unsigned num_workers;
+
+   /* Serializes callers of video_frame_jobs_run(). */
+   slock_t *dispatch_lock;
+
+   slock_t *lock;
+   scond_t *work_cond;
+   scond_t *done_cond;
+
+   video_frame_job_t job;
+   void *data;
+   unsigned count;
+
+   volatile uint32_t generation;
+   volatile uint32_t claim;
+   volatile uint32_t done;
+   volatile uint32_t sleepers;
+   volatile uint32_t waiting;
+   volatile bool die;
+#endif
+};
+
+static video_frame_jobs_t *video_frame_jobs_shared_pool = NULL;
+
+#ifdef HAVE_FRAME_JOBS_THREADS
+/* Takes jobs of the given generation until none are left. */
+static void video_frame_jobs_drain(video_frame_jobs_t *jobs,
+      uint32_t generation)
+{
+   video_frame_job_t job = jobs->job;
+   void *data            = jobs->data;
+   uint32_t count        = jobs->count;
+   uint32_t tag          = FRAME_JOBS_CLAIM(generation);
+
+   /* If the fields above already belong to the next frame,
+    * the claim counter is closed or tagged with the next
+    * generation, and nothing is taken. */
+   RETRO_ATOMIC_BARRIER();
+
+   for (;;)
+   {
+      uint32_t claim = jobs->claim;
+      uint32_t index = claim & 0xffff;
+
+      if ((claim & 0xffff0000) != tag || index >= count)
+         return;
+
+      if (!RETRO_ATOMIC_CAS(&jobs->claim, claim, claim + 1))
+         continue;
+
+      job(data, index);
+
+      /* The caller checks the counter before it goes to sleep,
+       * only wake it up if it does. */
+      if (     RETRO_ATOMIC_ADD(&jobs->done, 1) == count
+            && jobs->waiting)
+      {
+         slock_lock(jobs->lock);
+         scond_signal(jobs->done_cond);
+         slock_unlock(jobs->lock);
+      }
+   }
+}
+
+static void video_frame_jobs_worker(void *userdata)
+{
+   video_frame_jobs_t *jobs = (video_frame_jobs_t*)userdata;
+   unsigned spin            = FRAME_JOBS_SPIN_MIN;
+   uint32_t seen            = 0;
+
+   for (;;)
+   {
+      unsigned i;
+
+      for (i = 0; i < spin; i++)
+      {
+         if (jobs->generation != seen || jobs->die)
+            break;
+         RETRO_ATOMIC_PAUSE();
+      }
+
+      if (i < spin)
+      {
+         if (spin < FRAME_JOBS_SPIN_MAX)
+            spin <<= 1;
+      }
+      else
+      {
+         slock_lock(jobs->lock);
+         RETRO_ATOMIC_ADD(&jobs->sleepers, 1);
+         while (jobs->generation == seen && !jobs->die)
+            scond_wait(jobs->work_cond, jobs->lock);
+         RETRO_ATOMIC_ADD(&jobs->sleepers, -1);
+         slock_unlock(jobs->lock);
+
+         if (spin > FRAME_JOBS_SPIN_MIN)
+            spin >>= 1;
+      }
+
+      if (jobs->die)
+         break;
+
+      RETRO_ATOMIC_BARRIER();
+      seen = jobs->generation;
+      video_frame_jobs_drain(jobs, seen);
+   }
+}
+#endif
+
+video_frame_jobs_t *video_frame_jobs_new(unsigned threads)
+{
+#ifdef HAVE_FRAME_JOBS_THREADS
+   unsigned i;
+#endif
+   video_frame_jobs_t *jobs = (video_frame_jobs_t*)
+      calloc(1, sizeof(*jobs));
+
+   if (!jobs)
+      return NULL;
+
+   if (threads == 0)
+      threads = MIN(cpu_features_get_core_amount(),
+            FRAME_JOBS_DEFAULT_THREADS);
+   jobs->num_threads = MAX(threads, 1);
+
+#ifdef HAVE_FRAME_JOBS_THREADS
+   if (jobs->num_threads == 1)
+      return jobs;
+
+   jobs->claim         = FRAME_JOBS_CLAIM_CLOSED;
+   jobs->dispatch_lock = slock_new();
+   jobs->lock          = slock_new();
+   jobs->work_cond     = scond_new();
+   jobs->done_cond     = scond_new();
+   jobs->workers       = (sthread_t**)calloc(
+         jobs->num_threads - 1, sizeof(*jobs->workers));
+
+   if (     !jobs->dispatch_lock || !jobs->lock
+         || !jobs->work_cond     || !jobs->done_cond
+         || !jobs->workers)
+      goto error;
+
+   for (i = 0; i < jobs->num_threads - 1; i++)
+   {
+      if (!(jobs->workers[i] = sthread_create(
+                  video_frame_jobs_worker, jobs)))
+         goto error;
+      jobs->num_workers++;
+   }
+
+   return jobs;
+
+error:
+   video_frame_jobs_free(jobs);
+   return NULL;
+#else
+   jobs->num_threads = 1;
+   return jobs;
+#endif
+}
+
+void video_frame_jobs_free(video_frame_jobs_t *jobs)
+{
+#ifdef HAVE_FRAME_JOBS_THREADS
+   unsigned i;
+#endif
+
+   if (!jobs)
+      return;
+
+#ifdef HAVE_FRAME_JOBS_THREADS
+   if (jobs->num_workers)
+   {
+      slock_lock(jobs->lock);
+      jobs->die = true;
+      scond_broadcast(jobs->work_cond);
+      slock_unlock(jobs->lock);
+
+      for (i = 0; i < jobs->num_workers; i++)
+         sthread_join(jobs->workers[i]);
+   }
+
+   free(jobs->workers);
+   if (jobs->dispatch_lock)
+      slock_free(jobs->dispatch_lock);
+   if (jobs->lock)
+      slock_free(jobs->lock);
+   if (jobs->work_cond)
+      scond_free(jobs->work_cond);
+   if (jobs->done_cond)
+      scond_free(jobs->done_cond);
+#endif
+
+   free(jobs);
+}
+
+video_frame_jobs_t *video_frame_jobs_shared(void)
+{
+   if (!video_frame_jobs_shared_pool)
+      video_frame_jobs_shared_pool = video_frame_jobs_new(0);
+   return video_frame_jobs_shared_pool;
+}
+
+void video_frame_jobs_shared_free(void)
+{
+   video_frame_jobs_free(video_frame_jobs_shared_pool);
+   video_frame_jobs_shared_pool = NULL;
+}
+
+unsigned video_frame_jobs_num_threads(video_frame_jobs_t *jobs)
+{
+   return jobs ? jobs->num_threads : 1;
+}
+
+unsigned video_frame_jobs_bands(video_frame_jobs_t *jobs,
+      unsigned height, size_t row_size)
+{
+   unsigned threads = video_frame_jobs_num_threads(jobs);
+   size_t rows      = MAX(VIDEO_FRAME_JOBS_BAND_SIZE / MAX(row_size, 1), 1);
+   unsigned bands   = (unsigned)((height + rows - 1) / rows);
+
+   if (     threads == 1 || height < 2
+         || (size_t)height * row_size < VIDEO_FRAME_JOBS_MIN_SIZE)
+      return 1;
+
+   /* Round up, so no thread is left with a single band at the
+    * end of the frame. Frames with fewer bands than threads
+    * leave the rest of the pool idle instead. */
+   if (bands > threads)
+      bands = ((bands + threads - 1) / threads) * threads;
+
+   return MIN(bands, MIN(height, VIDEO_FRAME_JOBS_MAX));
+}
+
+void video_frame_jobs_run(video_frame_jobs_t *jobs,
+      video_frame_job_t job, void *data, unsigned count)
+{
+   unsigned i;
+#ifdef HAVE_FRAME_JOBS_THREADS
+   uint32_t generation;
+
+   if (     jobs && jobs->num_workers
+         && count > 1 && count <= VIDEO_FRAME_JOBS_MAX)
+   {
+      slock_lock(jobs->dispatch_lock);
+
+      /* Close the claim counter before the job is replaced,
+       * see video_frame_jobs_drain(). */
+      jobs->claim = FRAME_JOBS_CLAIM_CLOSED;
+      RETRO_ATOMIC_BARRIER();
+
+      generation  = jobs->generation + 1;
+      jobs->job   = job;
+      jobs->data  = data;
+      jobs->count = count;
+      jobs->done  = 0;
+      RETRO_ATOMIC_BARRIER();
+
+      jobs->claim = FRAME_JOBS_CLAIM(generation);
+      RETRO_ATOMIC_ADD(&jobs->generation, 1);
+
+      /* Workers count themselves as sleeping before they check
+       * the generation, one of both sides sees the other. */
+      if (jobs->sleepers)
+      {
+         slock_lock(jobs->lock);
+         scond_broadcast(jobs->work_cond);
+         slock_unlock(jobs->lock);
+      }
+
+      video_frame_jobs_drain(jobs, generation);
+
+      for (i = 0; i < FRAME_JOBS_SPIN_DONE && jobs->done != count; i++)
+         RETRO_ATOMIC_PAUSE();
+
+      if (jobs->done != count)
+      {
+         slock_lock(jobs->lock);
+         RETRO_ATOMIC_ADD(&jobs->waiting, 1);
+         while (jobs->done != count)
+            scond_wait(jobs->done_cond, jobs->lock);
+         RETRO_ATOMIC_ADD(&jobs->waiting, -1);
+         slock_unlock(jobs->lock);
+      }
+
+      RETRO_ATOMIC_BARRIER();
+      slock_unlock(jobs->dispatch_lock);
+      return;
+   }
+#else
+   (void)jobs;
+#endif
+
+   for (i = 0; i < count; i++)
+      job(data, i);
+}
+
+struct video_frame_jobs_pixconv
+{
+   const struct scaler_ctx *ctx;
+   uint8_t *output;
+   const uint8_t *input;
+   unsigned bands;
+};
+
+static void video_frame_jobs_pixconv_band(void *data, unsigned index)
+{
+   struct video_frame_jobs_pixconv *conv =
+      (struct video_frame_jobs_pixconv*)data;
+   const struct scaler_ctx *ctx = conv->ctx;
+   int y_start = (int)(((int64_t)ctx->out_height * index) / conv->bands);
+   int y_end   = (int)(((int64_t)ctx->out_height * (index + 1)) / conv->bands);
+
+   ctx->direct_pixconv(
+         conv->output + (ptrdiff_t)y_start * ctx->out_stride,
+         conv->input  + (ptrdiff_t)y_start * ctx->in_stride,
+         ctx->out_width, y_end - y_start,
+         ctx->out_stride, ctx->in_stride);
+}
+
+void video_frame_jobs_scale(video_frame_jobs_t *jobs,
+      struct scaler_ctx *ctx, void *output, const void *input)
+{
+   struct video_frame_jobs_pixconv conv;
+
+   /* Scaling goes through the intermediate frames of the
+    * scaler context, only straight conversion is split up. */
+   if (!ctx->unscaled || !ctx->direct_pixconv)
+   {
+      scaler_ctx_scale(ctx, output, input);
+      return;
+   }
+
+   conv.ctx    = ctx;
+   conv.output = (uint8_t*)output;
+   conv.input  = (const uint8_t*)input;
+   conv.bands  = video_frame_jobs_bands(jobs, ctx->out_height,
+         abs(ctx->in_stride) + abs(ctx->out_stride));
+
+   video_frame_jobs_run(jobs, video_frame_jobs_pixconv_band,
+         &conv, conv.bands);
+}
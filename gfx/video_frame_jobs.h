@@ -0,0 +1,135 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RARCH_VIDEO_FRAME_JOBS_H__
+#define RARCH_VIDEO_FRAME_JOBS_H__
+
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+#include <gfx/scaler/scaler.h>
+
+/* Most jobs a single video_frame_jobs_run() call can split
+ * a frame into. */
+#define VIDEO_FRAME_JOBS_MAX        256
+
+/* Bytes a row band should touch, input and output together,
+ * so that a band stays in a core's L2 cache while it is
+ * being worked on. */
+#define VIDEO_FRAME_JOBS_BAND_SIZE  (128 * 1024)
+
+/* Frames touching fewer bytes than this are done in one band,
+ * waking the pool would cost more than it saves. */
+#define VIDEO_FRAME_JOBS_MIN_SIZE   (4 * VIDEO_FRAME_JOBS_BAND_SIZE)
+
+RETRO_BEGIN_DECLS
+
+typedef struct video_frame_jobs video_frame_jobs_t;
+
+/**
+ * video_frame_job_t:
+ * @data         : Userdata passed to video_frame_jobs_run().
+ * @index        : Index of the job, 0 to count - 1.
+ *
+ * Runs one part of a per-frame job, e.g. one row band.
+ **/
+typedef void (*video_frame_job_t)(void *data, unsigned index);
+
+/**
+ * video_frame_jobs_new:
+ * @threads      : Threads working on a frame, including the
+ *                 thread calling video_frame_jobs_run().
+ *                 0 uses one thread per CPU core.
+ *
+ * Creates a pool of persistent worker threads for per-frame
+ * CPU work. Idle workers spin briefly for the next job before
+ * they go to sleep, so stages running back to back within a
+ * frame don't pay for a wakeup each.
+ *
+ * Without thread support, jobs run on the calling thread.
+ *
+ * Returns: new pool, or NULL on error.
+ **/
+video_frame_jobs_t *video_frame_jobs_new(unsigned threads);
+
+void video_frame_jobs_free(video_frame_jobs_t *jobs);
+
+/**
+ * video_frame_jobs_shared:
+ *
+ * The pool shared by the per-frame stages of the main thread
+ * (softfilters, pixel conversion). Created on the first call,
+ * which has to happen on the main thread.
+ **/
+video_frame_jobs_t *video_frame_jobs_shared(void);
+
+void video_frame_jobs_shared_free(void);
+
+/**
+ * video_frame_jobs_num_threads:
+ * @jobs         : Pool, may be NULL.
+ *
+ * Returns: number of threads working on a job, including the
+ * calling thread.
+ **/
+unsigned video_frame_jobs_num_threads(video_frame_jobs_t *jobs);
+
+/**
+ * video_frame_jobs_bands:
+ * @jobs         : Pool, may be NULL.
+ * @height       : Rows in the frame.
+ * @row_size     : Bytes a row reads and writes.
+ *
+ * Returns: number of row bands to split the frame into, so
+ * that each band fits VIDEO_FRAME_JOBS_BAND_SIZE and every
+ * thread gets the same number of bands. Frames smaller than
+ * VIDEO_FRAME_JOBS_MIN_SIZE get a single band.
+ **/
+unsigned video_frame_jobs_bands(video_frame_jobs_t *jobs,
+      unsigned height, size_t row_size);
+
+/**
+ * video_frame_jobs_run:
+ * @jobs         : Pool, may be NULL.
+ * @job          : Job callback.
+ * @data         : Userdata for @job.
+ * @count        : Number of parts, at most VIDEO_FRAME_JOBS_MAX.
+ *
+ * Calls @job for indices 0 to @count - 1 on the pool and the
+ * calling thread, and returns when all of them are done.
+ * Can be called from any thread, calls are serialized.
+ **/
+void video_frame_jobs_run(video_frame_jobs_t *jobs,
+      video_frame_job_t job, void *data, unsigned count);
+
+/**
+ * video_frame_jobs_scale:
+ * @jobs         : Pool, may be NULL.
+ * @ctx          : Scaler context.
+ * @output       : Output image.
+ * @input        : Input image.
+ *
+ * Same as scaler_ctx_scale_direct(). Pixel conversion without
+ * scaling is split into row bands and run on the pool.
+ **/
+void video_frame_jobs_scale(video_frame_jobs_t *jobs,
+      struct scaler_ctx *ctx, void *output, const void *input);
+
+RETRO_END_DECLS
+
+#endif
@@ -145,6 +145,19 @@ struct thread_packet
    } data;
 };
 
+/* Number of frame slots, see thread_video::frame */
+#define THREAD_VIDEO_FRAME_SLOTS 3
+
+struct thread_video_frame
+{
+   uint8_t *buffer;
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+   uint64_t count;
+   char msg[255];
+};
+
 struct thread_video
 {
    slock_t *lock;
@@ -186,8 +199,13 @@ struct thread_video
    bool is_idle;
 
    retro_time_t last_time;
+   /* Frames handed to the thread, and how many of them were
+    * replaced by a newer one before the thread picked them up */
    unsigned hit_count;
    unsigned miss_count;
+   /* Time from a frame being handed over to being picked up */
+   retro_time_t latency_total;
+   retro_time_t latency_max;
 
    float *alpha_mod;
    unsigned alpha_mods;
@@ -202,17 +220,29 @@ struct thread_video
    struct video_viewport vp;
    struct video_viewport read_vp; /* Last viewport reported to caller. */
 
+   /* Triple buffered frame mailbox. The caller fills
+    * slots[write], the thread draws slots[read], and
+    * slots[ready] holds the newest frame not drawn yet.
+    *
+    * Only the caller touches 'write' and only the thread
+    * touches 'read'; handing a slot over just swaps an index
+    * with 'ready' under thr->lock, so frames are copied and
+    * drawn without holding it. The swap stays on the lock
+    * instead of RETRO_ATOMIC_CAS, since the thread sleeps on
+    * cond_thread and the caller paces on cond_cmd, which both
+    * need it anyway. */
    struct
    {
       slock_t *lock;
-      uint8_t *buffer;
-      unsigned width;
-      unsigned height;
-      unsigned pitch;
-      bool updated;
+      struct thread_video_frame slots[THREAD_VIDEO_FRAME_SLOTS];
+      size_t size;
+      unsigned write;
+      unsigned ready;
+      unsigned read;
+      retro_time_t ready_time;
+      bool updated;   /* slots[ready] has not been picked up */
+      bool rendering; /* the thread is drawing slots[read] */
       bool within_thread;
-      uint64_t count;
-      char msg[255];
    } frame;
 
    video_driver_t video_thread;
@@ -568,7 +598,23 @@ static void video_thread_loop(void *data)
       while (thr->send_cmd == CMD_VIDEO_NONE && !thr->frame.updated)
          scond_wait(thr->cond_thread, thr->lock);
       if (thr->frame.updated)
-         updated = true;
+      {
+         /* Take the newest frame, hand back the one drawn last */
+         unsigned read        = thr->frame.read;
+         retro_time_t latency = cpu_features_get_time_usec()
+            - thr->frame.ready_time;
+
+         thr->frame.read      = thr->frame.ready;
+         thr->frame.ready     = read;
+         thr->frame.updated   = false;
+         thr->frame.rendering = true;
+
+         thr->latency_total  += latency;
+         if (latency > thr->latency_max)
+            thr->latency_max  = latency;
+
+         updated              = true;
+      }
 
       /* To avoid race condition where send_cmd is updated
        * right after the switch is checked. */
@@ -601,12 +647,14 @@ static void video_thread_loop(void *data)
          if (thr->driver && thr->driver->frame)
          {
             video_frame_info_t video_info;
+            const struct thread_video_frame *slot =
+               &thr->frame.slots[thr->frame.read];
             video_driver_build_info(&video_info);
 
             ret = thr->driver->frame(thr->driver_data,
-                  thr->frame.buffer, thr->frame.width, thr->frame.height,
-                  thr->frame.count,
-                  thr->frame.pitch, *thr->frame.msg ? thr->frame.msg : NULL,
+                  slot->buffer, slot->width, slot->height,
+                  slot->count,
+                  slot->pitch, *slot->msg ? slot->msg : NULL,
                   &video_info);
          }
 
@@ -625,11 +673,11 @@ static void video_thread_loop(void *data)
             thr->driver->viewport_info(thr->driver_data, &vp);
 
          slock_lock(thr->lock);
-         thr->alive         = alive;
-         thr->focus         = focus;
-         thr->has_windowed  = has_windowed;
-         thr->frame.updated = false;
-         thr->vp            = vp;
+         thr->alive           = alive;
+         thr->focus           = focus;
+         thr->has_windowed    = has_windowed;
+         thr->frame.rendering = false;
+         thr->vp              = vp;
          scond_signal(thr->cond_cmd);
          slock_unlock(thr->lock);
       }
@@ -697,6 +745,7 @@ static bool video_thread_frame(void *data, const void *frame_,
       unsigned pitch, const char *msg, video_frame_info_t *video_info)
 {
    unsigned copy_stride;
+   struct thread_video_frame *slot     = NULL;
    const uint8_t *src                  = NULL;
    uint8_t *dst                        = NULL;
    thread_video_t *thr                 = (thread_video_t*)data;
@@ -713,11 +762,57 @@ static bool video_thread_frame(void *data, const void *frame_,
       return false;
    }
 
+   /* slots[write] belongs to us, fill it without the lock */
+   slot        = &thr->frame.slots[thr->frame.write];
+   src         = (const uint8_t*)frame_;
+   dst         = slot->buffer;
+
+   /* A dupe shows the last frame handed over again. That slot
+    * is only ever read until we hand over slots[write], so it
+    * can be copied from once its index is known. */
+   if (!src)
+   {
+      const struct thread_video_frame *last = NULL;
+
+      slock_lock(thr->lock);
+      last   = &thr->frame.slots[thr->frame.updated
+         ? thr->frame.ready : thr->frame.read];
+      slock_unlock(thr->lock);
+
+      /* Before the first frame, that is the initial fill */
+      if (last->width)
+      {
+         width  = last->width;
+         height = last->height;
+      }
+      src    = last->buffer;
+   }
+
    copy_stride = width * (thr->info.rgb32
          ? sizeof(uint32_t) : sizeof(uint16_t));
 
-   src = (const uint8_t*)frame_;
-   dst = thr->frame.buffer;
+   /* Slots are packed */
+   if (!frame_)
+      pitch    = copy_stride;
+
+   /* Skip the copy if the core rendered straight into the slot,
+    * see thread_get_current_software_framebuffer() */
+   if (src != dst || pitch != copy_stride)
+   {
+      unsigned h;
+      for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
+         memcpy(dst, src, copy_stride);
+   }
+
+   slot->width  = width;
+   slot->height = height;
+   slot->count  = frame_count;
+   slot->pitch  = copy_stride;
+
+   if (msg)
+      strlcpy(slot->msg, msg, sizeof(slot->msg));
+   else
+      *slot->msg = '\0';
 
    slock_lock(thr->lock);
 
@@ -728,7 +823,10 @@ static bool video_thread_frame(void *data, const void *frame_,
          roundf(1000000 / video_info->refresh_rate);
       retro_time_t target = thr->last_time + target_frame_time;
 
-      /* Ideally, use absolute time, but that is only a good idea on POSIX. */
+      /* Give the thread until the frame time is up to pick up
+       * the previous frame, so it does not get replaced.
+       *
+       * Ideally, use absolute time, but that is only a good idea on POSIX. */
       while (thr->frame.updated)
       {
          retro_time_t current = cpu_features_get_time_usec();
@@ -742,41 +840,29 @@ static bool video_thread_frame(void *data, const void *frame_,
       }
    }
 
-   /* Drop frame if updated flag is still set, as thread is
-    * still working on last frame. */
-   if (!thr->frame.updated)
-   {
-      if (src)
-      {
-         unsigned h;
-         for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
-            memcpy(dst, src, copy_stride);
-      }
-
-      thr->frame.updated = true;
-      thr->frame.width  = width;
-      thr->frame.height = height;
-      thr->frame.count  = frame_count;
-      thr->frame.pitch  = copy_stride;
+   /* If the thread is still busy with an older frame,
+    * the one waiting in slots[ready] is replaced. */
+   if (thr->frame.updated)
+      thr->miss_count++;
+   thr->hit_count++;
 
-      if (msg)
-         strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
-      else
-         *thr->frame.msg = '\0';
+   {
+      unsigned ready        = thr->frame.ready;
+      thr->frame.ready      = thr->frame.write;
+      thr->frame.write      = ready;
+   }
+   thr->frame.updated       = true;
+   thr->frame.ready_time    = cpu_features_get_time_usec();
 
-      scond_signal(thr->cond_thread);
+   scond_signal(thr->cond_thread);
 
 #if defined(HAVE_MENU)
-      if (thr->texture.enable)
-      {
-         while (thr->frame.updated)
-            scond_wait(thr->cond_cmd, thr->lock);
-      }
-#endif
-      thr->hit_count++;
+   if (thr->texture.enable)
+   {
+      while (thr->frame.updated || thr->frame.rendering)
+         scond_wait(thr->cond_cmd, thr->lock);
    }
-   else
-      thr->miss_count++;
+#endif
 
    slock_unlock(thr->lock);
 
@@ -795,6 +881,7 @@ static bool video_thread_init(thread_video_t *thr,
       const video_info_t info,
       input_driver_t **input, void **input_data)
 {
+   unsigned i;
    size_t max_size;
    thread_packet_t pkt = {CMD_INIT};
 
@@ -814,12 +901,23 @@ static bool video_thread_init(thread_video_t *thr,
    max_size                  = info.input_scale * RARCH_SCALE_BASE;
    max_size                 *= max_size;
    max_size                 *= info.rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
-   thr->frame.buffer         = (uint8_t*)malloc(max_size);
+   thr->frame.size           = max_size;
 
-   if (!thr->frame.buffer)
-      return false;
+   for (i = 0; i < THREAD_VIDEO_FRAME_SLOTS; i++)
+   {
+      struct thread_video_frame *slot = &thr->frame.slots[i];
+
+      slot->buffer           = (uint8_t*)malloc(max_size);
 
-   memset(thr->frame.buffer, 0x80, max_size);
+      if (!slot->buffer)
+         return false;
+
+      memset(slot->buffer, 0x80, max_size);
+   }
+
+   thr->frame.write          = 0;
+   thr->frame.ready          = 1;
+   thr->frame.read           = 2;
 
    thr->last_time            = cpu_features_get_time_usec();
    thr->thread               = sthread_create(video_thread_loop, thr);
@@ -916,6 +1014,7 @@ static bool video_thread_read_viewport(void *data, uint8_t *buffer, bool is_idle
 
 static void video_thread_free(void *data)
 {
+   unsigned i;
    thread_video_t *thr = (thread_video_t*)data;
    thread_packet_t pkt = { CMD_FREE };
 
@@ -929,7 +1028,8 @@ static void video_thread_free(void *data)
 #if defined(HAVE_MENU)
    free(thr->texture.frame);
 #endif
-   free(thr->frame.buffer);
+   for (i = 0; i < THREAD_VIDEO_FRAME_SLOTS; i++)
+      free(thr->frame.slots[i].buffer);
    slock_free(thr->frame.lock);
    slock_free(thr->lock);
    scond_free(thr->cond_cmd);
@@ -938,8 +1038,13 @@ static void video_thread_free(void *data)
    free(thr->alpha_mod);
    slock_free(thr->alpha_lock);
 
-   RARCH_LOG("Threaded video stats: Frames pushed: %u, Frames dropped: %u.\n",
-         thr->hit_count, thr->miss_count);
+   RARCH_LOG("Threaded video stats: Frames pushed: %u, Frames dropped: %u,"
+         " Latency: %u us avg, %u us max.\n",
+         thr->hit_count, thr->miss_count,
+         (unsigned)(thr->latency_total /
+            (thr->hit_count > thr->miss_count
+             ? thr->hit_count - thr->miss_count : 1)),
+         (unsigned)thr->latency_max);
 
    free(thr);
 }
@@ -1222,6 +1327,39 @@ static void thread_apply_state_changes(void *data)
    slock_unlock(thr->frame.lock);
 }
 
+/* Lets the core render straight into the slot the next
+ * video_thread_frame() call hands over, saving a copy. */
+static bool thread_get_current_software_framebuffer(void *data,
+      struct retro_framebuffer *framebuffer)
+{
+   size_t pitch;
+   thread_video_t *thr         = (thread_video_t*)data;
+   enum retro_pixel_format fmt = video_driver_get_pixel_format();
+
+   if (!thr || !framebuffer)
+      return false;
+
+   /* 0RGB1555 is converted before it gets here */
+   if (fmt == RETRO_PIXEL_FORMAT_0RGB1555)
+      return false;
+
+   pitch = framebuffer->width * (thr->info.rgb32
+         ? sizeof(uint32_t) : sizeof(uint16_t));
+
+   if (fmt == RETRO_PIXEL_FORMAT_XRGB8888 && !thr->info.rgb32)
+      return false;
+
+   if (pitch * framebuffer->height > thr->frame.size)
+      return false;
+
+   framebuffer->data         = thr->frame.slots[thr->frame.write].buffer;
+   framebuffer->pitch        = pitch;
+   framebuffer->format       = fmt;
+   framebuffer->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+
+   return true;
+}
+
 /* This is read-only state which should not
  * have any kind of race condition. */
 static struct video_shader *thread_get_current_shader(void *data)
@@ -1262,7 +1400,7 @@ static const video_poke_interface_t thread_poke = {
    NULL,
 
    thread_get_current_shader,
-   NULL,                      /* get_current_software_framebuffer */
+   thread_get_current_software_framebuffer,
    NULL                       /* get_hw_render_interface */
 };
 
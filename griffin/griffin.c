@@ -203,6 +203,7 @@ MD5
 CHEATS
 ============================================================ */
 #include "../managers/cheat_manager.c"
+#include "../managers/cheat_search.c"
 #include "../libretro-common/hash/rhash.c"
 
 /*============================================================
@@ -522,6 +523,7 @@ FONTS
 
 #include "../gfx/drivers_font_renderer/bitmapfont.c"
 #include "../gfx/font_driver.c"
+#include "../gfx/font_atlas_cache.c"
 
 #if defined(HAVE_D3D9) && defined(HAVE_D3DX)
 #include "../gfx/drivers_font/d3d_w32_font.c"
@@ -947,6 +949,7 @@ DYNAMIC
 ============================================================ */
 #include "../libretro-common/dynamic/dylib.c"
 #include "../gfx/video_filter.c"
+#include "../gfx/video_frame_jobs.c"
 #include "../libretro-common/audio/dsp_filter.c"
 
 /*============================================================
@@ -1167,6 +1170,7 @@ THREAD
 #include "../libretro-common/rthreads/rthreads.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
+#include "../audio/audio_pipeline.c"
 #endif
 
 /* needed for both playlists and netplay lobbies */
@@ -1177,6 +1181,7 @@ NETPLAY
 ============================================================ */
 #ifdef HAVE_NETWORKING
 #include "../network/netplay/netplay_delta.c"
+#include "../network/netplay/netplay_state_delta.c"
 #include "../network/netplay/netplay_frontend.c"
 #include "../network/netplay/netplay_handshake.c"
 #include "../network/netplay/netplay_init.c"
@@ -1185,6 +1190,7 @@ NETPLAY
 #include "../network/netplay/netplay_sync.c"
 #include "../network/netplay/netplay_discovery.c"
 #include "../network/netplay/netplay_buf.c"
+#include "../network/netplay/netplay_relay.c"
 #include "../network/netplay/netplay_room_parse.c"
 #include "../libretro-common/net/net_compat.c"
 #include "../libretro-common/net/net_socket.c"
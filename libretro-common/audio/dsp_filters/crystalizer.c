@@ -27,6 +27,8 @@
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
+#include "dspfilter_simd.h"
+
 struct delta_data
 {
    float intensity;
@@ -58,6 +60,61 @@ static void delta_process(void *data, struct dspfilter_output *output,
    }
 }
 
+/* The previous frame of each vector comes from the vector
+ * before it, or from the last frame of the previous call. */
+#define DELTA_SIMD_PROCESS(isa) \
+static DSPFILTER_TARGET_##isa void delta_process_##isa(void *data, \
+      struct dspfilter_output *output, const struct dspfilter_input *input) \
+{ \
+   unsigned i, c; \
+   float last[DF(isa, floats)] = {0}; \
+   struct delta_data *d     = (struct delta_data*)data; \
+   float *out               = input->samples; \
+   unsigned samples         = input->frames * 2; \
+   DF(isa, t) intensity     = DF(isa, set1)(d->intensity); \
+   DF(isa, t) prev; \
+   \
+   output->samples          = input->samples; \
+   output->frames           = input->frames; \
+   \
+   last[DF(isa, floats) - 2] = d->old[0]; \
+   last[DF(isa, floats) - 1] = d->old[1]; \
+   prev                     = DF(isa, load)(last); \
+   \
+   for (i = 0; i + DF(isa, floats) <= samples; i += DF(isa, floats)) \
+   { \
+      DF(isa, t) cur = DF(isa, load)(out + i); \
+      DF(isa, t) old = DF(isa, prev)(prev, cur); \
+      DF(isa, store)(out + i, DF(isa, add)(cur, \
+               DF(isa, mul)(DF(isa, sub)(cur, old), intensity))); \
+      prev           = cur; \
+   } \
+   \
+   DF(isa, store)(last, prev); \
+   d->old[0]                = last[DF(isa, floats) - 2]; \
+   d->old[1]                = last[DF(isa, floats) - 1]; \
+   \
+   for (; i < samples; i += 2) \
+   { \
+      for (c = 0; c < 2; c++) \
+      { \
+         float current = out[i + c]; \
+         out[i + c]    = current + (current - d->old[c]) * d->intensity; \
+         d->old[c]     = current; \
+      } \
+   } \
+}
+
+#ifdef DSPFILTER_HAVE_AVX
+DELTA_SIMD_PROCESS(avx)
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+DELTA_SIMD_PROCESS(sse)
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+DELTA_SIMD_PROCESS(neon)
+#endif
+
 static void *delta_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
@@ -68,13 +125,26 @@ static void *delta_init(const struct dspfilter_info *info,
    return d;
 }
 
-static const struct dspfilter_implementation delta_plug = {
-   delta_init,
-   delta_process,
-   delta_free,
-   DSPFILTER_API_VERSION,
-   "Delta Sharpening",
-   "crystalizer",
+#define DELTA_IMPL(process) \
+   { delta_init, process, delta_free, \
+     DSPFILTER_API_VERSION, "Delta Sharpening", "crystalizer" }
+
+/* In order of preference */
+static const struct
+{
+   dspfilter_simd_mask_t simd;
+   struct dspfilter_implementation impl;
+} delta_impls[] = {
+#ifdef DSPFILTER_HAVE_AVX
+   { DSPFILTER_SIMD_AVX,  DELTA_IMPL(delta_process_avx) },
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+   { DSPFILTER_SIMD_SSE,  DELTA_IMPL(delta_process_sse) },
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+   { DSPFILTER_SIMD_NEON, DELTA_IMPL(delta_process_neon) },
+#endif
+   { 0,                   DELTA_IMPL(delta_process) },
 };
 
 #ifdef HAVE_FILTERS_BUILTIN
@@ -83,8 +153,10 @@ static const struct dspfilter_implementation delta_plug = {
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
-   return &delta_plug;
+   unsigned i;
+   for (i = 0; (delta_impls[i].simd & mask) != delta_impls[i].simd; )
+      i++;
+   return &delta_impls[i].impl;
 }
 
 #undef dspfilter_get_implementation
@@ -0,0 +1,297 @@
+/* Copyright  (C) 2010-2018 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (dspfilter_simd.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DSPFILTER_SIMD_H__
+#define DSPFILTER_SIMD_H__
+
+/* Vector operations shared by the DSP filter kernels.
+ *
+ * Every backend (sse, avx, neon) provides the same set of
+ * operations, named df_<backend>_<op>, on a vector of floats
+ * holding interleaved stereo frames (LRLR...). A filter writes
+ * its kernel once as a macro taking the backend name,
+ * instantiates it for each backend that was compiled in and
+ * returns the matching dspfilter_implementation from
+ * dspfilter_get_implementation().
+ *
+ * The kernels do the same float operations in the same order
+ * as the scalar code, so their output matches it exactly.
+ * The exception is division on 32-bit ARM, which has no
+ * vector divide and uses a refined reciprocal instead. */
+
+#include <retro_inline.h>
+#include <libretro_dspfilter.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_IX86) || defined(_M_AMD64) || defined(_M_X64)
+#if defined(__SSE__) || defined(_M_AMD64) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define DSPFILTER_HAVE_SSE
+#endif
+
+/* AVX is not part of the baseline; build it with a target
+ * attribute and only use it if the CPU reports it. */
+#if defined(__clang__)
+#if (__clang_major__ > 3) || (__clang_major__ == 3 && __clang_minor__ >= 8)
+#define DSPFILTER_HAVE_AVX
+#define DSPFILTER_TARGET_avx __attribute__((target("avx")))
+#endif
+#elif defined(__GNUC__)
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define DSPFILTER_HAVE_AVX
+#define DSPFILTER_TARGET_avx __attribute__((target("avx")))
+#endif
+#elif defined(_MSC_VER) && (_MSC_VER >= 1800)
+#define DSPFILTER_HAVE_AVX
+#define DSPFILTER_TARGET_avx
+#endif
+#endif
+
+/* The NEON kernels have not been run on ARM hardware yet, so
+ * they are opt-in: build with -DDSPFILTER_WANT_NEON to use them
+ * and compare against the scalar output with dspfilter_bench. */
+#if defined(DSPFILTER_WANT_NEON) && (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#define DSPFILTER_HAVE_NEON
+#endif
+
+#define DSPFILTER_TARGET_sse
+#define DSPFILTER_TARGET_neon
+
+/* Names the operation 'op' of backend 'isa'. */
+#define DF(isa, op) df_##isa##_##op
+
+/* State of one channel of a biquad filter. */
+struct dspfilter_biquad_channel
+{
+   float xn1, xn2;
+   float yn1, yn2;
+};
+
+#ifdef DSPFILTER_HAVE_SSE
+#include <xmmintrin.h>
+
+/* Floats in a vector */
+#define df_sse_floats 4
+
+typedef __m128 df_sse_t;
+
+static INLINE __m128 df_sse_load(const float *p)         { return _mm_loadu_ps(p); }
+static INLINE void df_sse_store(float *p, __m128 v)      { _mm_storeu_ps(p, v); }
+static INLINE __m128 df_sse_zero(void)                   { return _mm_setzero_ps(); }
+static INLINE __m128 df_sse_set1(float x)                { return _mm_set1_ps(x); }
+/* One value per channel */
+static INLINE __m128 df_sse_set2(float l, float r)       { return _mm_setr_ps(l, r, l, r); }
+static INLINE __m128 df_sse_add(__m128 a, __m128 b)      { return _mm_add_ps(a, b); }
+static INLINE __m128 df_sse_sub(__m128 a, __m128 b)      { return _mm_sub_ps(a, b); }
+static INLINE __m128 df_sse_mul(__m128 a, __m128 b)      { return _mm_mul_ps(a, b); }
+static INLINE __m128 df_sse_div(__m128 a, __m128 b)      { return _mm_div_ps(a, b); }
+
+/* Loads/stores a single frame in the first two lanes. */
+static INLINE __m128 df_sse_load2(const float *p)
+{
+   return _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)p);
+}
+
+static INLINE void df_sse_store2(float *p, __m128 v)     { _mm_storel_pi((__m64*)p, v); }
+
+/* Left, or right, channel of each frame in both lanes */
+static INLINE __m128 df_sse_dup_l(__m128 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0)); }
+static INLINE __m128 df_sse_dup_r(__m128 v) { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1)); }
+/* Swaps the channels of each frame */
+static INLINE __m128 df_sse_swap(__m128 v)  { return _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)); }
+
+/* The frames of 'cur' moved one frame up, with the
+ * last frame of 'prev' in front. */
+static INLINE __m128 df_sse_prev(__m128 prev, __m128 cur)
+{
+   return _mm_shuffle_ps(prev, cur, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+/* a - b in the left lanes, a + b in the right lanes */
+static INLINE __m128 df_sse_addsub(__m128 a, __m128 b)
+{
+   return _mm_add_ps(a, _mm_xor_ps(b, _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f)));
+}
+#endif
+
+#ifdef DSPFILTER_HAVE_AVX
+#include <immintrin.h>
+
+#define df_avx_floats 8
+
+typedef __m256 df_avx_t;
+
+#define DF_AVX_INLINE static INLINE DSPFILTER_TARGET_avx
+
+DF_AVX_INLINE __m256 df_avx_load(const float *p)         { return _mm256_loadu_ps(p); }
+DF_AVX_INLINE void df_avx_store(float *p, __m256 v)      { _mm256_storeu_ps(p, v); }
+DF_AVX_INLINE __m256 df_avx_zero(void)                   { return _mm256_setzero_ps(); }
+DF_AVX_INLINE __m256 df_avx_set1(float x)                { return _mm256_set1_ps(x); }
+DF_AVX_INLINE __m256 df_avx_set2(float l, float r)       { return _mm256_setr_ps(l, r, l, r, l, r, l, r); }
+DF_AVX_INLINE __m256 df_avx_add(__m256 a, __m256 b)      { return _mm256_add_ps(a, b); }
+DF_AVX_INLINE __m256 df_avx_sub(__m256 a, __m256 b)      { return _mm256_sub_ps(a, b); }
+DF_AVX_INLINE __m256 df_avx_mul(__m256 a, __m256 b)      { return _mm256_mul_ps(a, b); }
+DF_AVX_INLINE __m256 df_avx_div(__m256 a, __m256 b)      { return _mm256_div_ps(a, b); }
+
+DF_AVX_INLINE __m256 df_avx_dup_l(__m256 v) { return _mm256_permute_ps(v, _MM_SHUFFLE(2, 2, 0, 0)); }
+DF_AVX_INLINE __m256 df_avx_dup_r(__m256 v) { return _mm256_permute_ps(v, _MM_SHUFFLE(3, 3, 1, 1)); }
+DF_AVX_INLINE __m256 df_avx_swap(__m256 v)  { return _mm256_permute_ps(v, _MM_SHUFFLE(2, 3, 0, 1)); }
+
+/* Shuffles work within each 128-bit half, bring the
+ * neighbouring halves together first. */
+DF_AVX_INLINE __m256 df_avx_prev(__m256 prev, __m256 cur)
+{
+   __m256 t = _mm256_permute2f128_ps(prev, cur, 0x21);
+   return _mm256_shuffle_ps(t, cur, _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+DF_AVX_INLINE __m256 df_avx_addsub(__m256 a, __m256 b)   { return _mm256_addsub_ps(a, b); }
+#endif
+
+#ifdef DSPFILTER_HAVE_NEON
+#include <arm_neon.h>
+
+#define df_neon_floats 4
+
+typedef float32x4_t df_neon_t;
+
+static INLINE float32x4_t df_neon_load(const float *p)   { return vld1q_f32(p); }
+static INLINE void df_neon_store(float *p, float32x4_t v) { vst1q_f32(p, v); }
+static INLINE float32x4_t df_neon_zero(void)              { return vdupq_n_f32(0.0f); }
+static INLINE float32x4_t df_neon_set1(float x)           { return vdupq_n_f32(x); }
+
+static INLINE float32x4_t df_neon_set2(float l, float r)
+{
+   float32x2_t v = vset_lane_f32(r, vdup_n_f32(l), 1);
+   return vcombine_f32(v, v);
+}
+
+static INLINE float32x4_t df_neon_add(float32x4_t a, float32x4_t b) { return vaddq_f32(a, b); }
+static INLINE float32x4_t df_neon_sub(float32x4_t a, float32x4_t b) { return vsubq_f32(a, b); }
+static INLINE float32x4_t df_neon_mul(float32x4_t a, float32x4_t b) { return vmulq_f32(a, b); }
+
+static INLINE float32x4_t df_neon_div(float32x4_t a, float32x4_t b)
+{
+#if defined(__aarch64__)
+   return vdivq_f32(a, b);
+#else
+   /* Reciprocal estimate with two Newton-Raphson steps */
+   float32x4_t r = vrecpeq_f32(b);
+   r             = vmulq_f32(vrecpsq_f32(b, r), r);
+   r             = vmulq_f32(vrecpsq_f32(b, r), r);
+   return vmulq_f32(a, r);
+#endif
+}
+
+static INLINE float32x4_t df_neon_load2(const float *p)
+{
+   return vcombine_f32(vld1_f32(p), vdup_n_f32(0.0f));
+}
+
+static INLINE void df_neon_store2(float *p, float32x4_t v) { vst1_f32(p, vget_low_f32(v)); }
+
+static INLINE float32x4_t df_neon_dup_l(float32x4_t v)    { return vtrnq_f32(v, v).val[0]; }
+static INLINE float32x4_t df_neon_dup_r(float32x4_t v)    { return vtrnq_f32(v, v).val[1]; }
+static INLINE float32x4_t df_neon_swap(float32x4_t v)     { return vrev64q_f32(v); }
+
+static INLINE float32x4_t df_neon_prev(float32x4_t prev, float32x4_t cur)
+{
+   return vextq_f32(prev, cur, 2);
+}
+
+static INLINE float32x4_t df_neon_addsub(float32x4_t a, float32x4_t b)
+{
+   static const uint32_t sign[4] = { 0x80000000u, 0, 0x80000000u, 0 };
+   return vaddq_f32(a, vreinterpretq_f32_u32(
+            veorq_u32(vreinterpretq_u32_f32(b), vld1q_u32(sign))));
+}
+#endif
+
+/* Complex multiply of interleaved (real, imag) pairs,
+ * as fft_complex_mul(a, b). */
+#define DSPFILTER_CMUL(isa) \
+static INLINE DSPFILTER_TARGET_##isa DF(isa, t) DF(isa, cmul)(DF(isa, t) a, DF(isa, t) b) \
+{ \
+   return DF(isa, addsub)(DF(isa, mul)(DF(isa, dup_l)(a), b), \
+         DF(isa, mul)(DF(isa, dup_r)(a), DF(isa, swap)(b))); \
+}
+
+/* Runs a stereo biquad filter over 'frames' frames in place,
+ * with both channels in the first two lanes of a vector. */
+#define DSPFILTER_BIQUAD(isa) \
+static INLINE DSPFILTER_TARGET_##isa void DF(isa, biquad)(float *samples, unsigned frames, \
+      float b0, float b1, float b2, float a0, float a1, float a2, \
+      struct dspfilter_biquad_channel *l, struct dspfilter_biquad_channel *r) \
+{ \
+   unsigned i; \
+   float tmp[2]; \
+   DF(isa, t) vb0 = DF(isa, set1)(b0); \
+   DF(isa, t) vb1 = DF(isa, set1)(b1); \
+   DF(isa, t) vb2 = DF(isa, set1)(b2); \
+   DF(isa, t) va0 = DF(isa, set1)(a0); \
+   DF(isa, t) va1 = DF(isa, set1)(a1); \
+   DF(isa, t) va2 = DF(isa, set1)(a2); \
+   DF(isa, t) xn1, xn2, yn1, yn2; \
+   \
+   /* The other lanes stay zero, rather than decaying into \
+    * denormals which are slow to compute with. */ \
+   tmp[0] = l->xn1; tmp[1] = r->xn1; xn1 = DF(isa, load2)(tmp); \
+   tmp[0] = l->xn2; tmp[1] = r->xn2; xn2 = DF(isa, load2)(tmp); \
+   tmp[0] = l->yn1; tmp[1] = r->yn1; yn1 = DF(isa, load2)(tmp); \
+   tmp[0] = l->yn2; tmp[1] = r->yn2; yn2 = DF(isa, load2)(tmp); \
+   \
+   for (i = 0; i < frames; i++, samples += 2) \
+   { \
+      DF(isa, t) x = DF(isa, load2)(samples); \
+      DF(isa, t) y = DF(isa, add)(DF(isa, mul)(vb0, x), DF(isa, mul)(vb1, xn1)); \
+      y            = DF(isa, add)(y, DF(isa, mul)(vb2, xn2)); \
+      y            = DF(isa, sub)(y, DF(isa, mul)(va1, yn1)); \
+      y            = DF(isa, sub)(y, DF(isa, mul)(va2, yn2)); \
+      y            = DF(isa, div)(y, va0); \
+      \
+      xn2          = xn1; \
+      xn1          = x; \
+      yn2          = yn1; \
+      yn1          = y; \
+      \
+      DF(isa, store2)(samples, y); \
+   } \
+   \
+   DF(isa, store2)(tmp, xn1); l->xn1 = tmp[0]; r->xn1 = tmp[1]; \
+   DF(isa, store2)(tmp, xn2); l->xn2 = tmp[0]; r->xn2 = tmp[1]; \
+   DF(isa, store2)(tmp, yn1); l->yn1 = tmp[0]; r->yn1 = tmp[1]; \
+   DF(isa, store2)(tmp, yn2); l->yn2 = tmp[0]; r->yn2 = tmp[1]; \
+}
+
+#ifdef DSPFILTER_HAVE_SSE
+DSPFILTER_CMUL(sse)
+DSPFILTER_BIQUAD(sse)
+#endif
+
+#ifdef DSPFILTER_HAVE_AVX
+DSPFILTER_CMUL(avx)
+#endif
+
+#ifdef DSPFILTER_HAVE_NEON
+DSPFILTER_CMUL(neon)
+DSPFILTER_BIQUAD(neon)
+#endif
+
+#endif
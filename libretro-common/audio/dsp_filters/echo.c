@@ -25,6 +25,8 @@
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
+#include "dspfilter_simd.h"
+
 struct echo_channel
 {
    float *buffer;
@@ -97,6 +99,101 @@ static void echo_process(void *data, struct dspfilter_output *output,
    }
 }
 
+/* Until the shortest delay line wraps around, every frame
+ * reads what was written a whole delay earlier, so the frames
+ * of such a block do not depend on each other. */
+#define ECHO_SIMD_PROCESS(isa) \
+static DSPFILTER_TARGET_##isa void echo_process_##isa(void *data, \
+      struct dspfilter_output *output, const struct dspfilter_input *input) \
+{ \
+   unsigned i, c; \
+   struct echo_data *echo = (struct echo_data*)data; \
+   float *out             = input->samples; \
+   unsigned frames        = input->frames; \
+   DF(isa, t) amp         = DF(isa, set1)(echo->amp); \
+   \
+   output->samples        = input->samples; \
+   output->frames         = input->frames; \
+   \
+   while (frames) \
+   { \
+      unsigned block = frames; \
+      \
+      for (c = 0; c < echo->num_channels; c++) \
+      { \
+         unsigned avail = echo->channels[c].frames - echo->channels[c].ptr; \
+         if (avail < block) \
+            block = avail; \
+      } \
+      \
+      for (i = 0; i + DF(isa, floats) / 2 <= block; i += DF(isa, floats) / 2) \
+      { \
+         DF(isa, t) in = DF(isa, load)(out + (i << 1)); \
+         DF(isa, t) e  = DF(isa, zero)(); \
+         \
+         for (c = 0; c < echo->num_channels; c++) \
+            e = DF(isa, add)(e, DF(isa, load)(echo->channels[c].buffer \
+                     + ((echo->channels[c].ptr + i) << 1))); \
+         \
+         e = DF(isa, mul)(e, amp); \
+         \
+         for (c = 0; c < echo->num_channels; c++) \
+            DF(isa, store)(echo->channels[c].buffer \
+                  + ((echo->channels[c].ptr + i) << 1), \
+                  DF(isa, add)(in, DF(isa, mul)( \
+                        DF(isa, set1)(echo->channels[c].feedback), e))); \
+         \
+         DF(isa, store)(out + (i << 1), DF(isa, add)(in, e)); \
+      } \
+      \
+      for (; i < block; i++) \
+      { \
+         float *frame     = out + (i << 1); \
+         float echo_left  = 0.0f; \
+         float echo_right = 0.0f; \
+         \
+         for (c = 0; c < echo->num_channels; c++) \
+         { \
+            const float *buf = echo->channels[c].buffer \
+               + ((echo->channels[c].ptr + i) << 1); \
+            echo_left       += buf[0]; \
+            echo_right      += buf[1]; \
+         } \
+         \
+         echo_left  *= echo->amp; \
+         echo_right *= echo->amp; \
+         \
+         for (c = 0; c < echo->num_channels; c++) \
+         { \
+            float *buf = echo->channels[c].buffer \
+               + ((echo->channels[c].ptr + i) << 1); \
+            buf[0]     = frame[0] + echo->channels[c].feedback * echo_left; \
+            buf[1]     = frame[1] + echo->channels[c].feedback * echo_right; \
+         } \
+         \
+         frame[0]   += echo_left; \
+         frame[1]   += echo_right; \
+      } \
+      \
+      for (c = 0; c < echo->num_channels; c++) \
+         echo->channels[c].ptr = (echo->channels[c].ptr + block) \
+            % echo->channels[c].frames; \
+      \
+      out    += block << 1; \
+      frames -= block; \
+   } \
+}
+
+#ifdef DSPFILTER_HAVE_AVX
+ECHO_SIMD_PROCESS(avx)
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+ECHO_SIMD_PROCESS(sse)
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+ECHO_SIMD_PROCESS(neon)
+#endif
+
 static void *echo_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
@@ -157,14 +254,26 @@ error:
    return NULL;
 }
 
-static const struct dspfilter_implementation echo_plug = {
-   echo_init,
-   echo_process,
-   echo_free,
+#define ECHO_IMPL(process) \
+   { echo_init, process, echo_free, \
+     DSPFILTER_API_VERSION, "Multi-Echo", "echo" }
 
-   DSPFILTER_API_VERSION,
-   "Multi-Echo",
-   "echo",
+/* In order of preference */
+static const struct
+{
+   dspfilter_simd_mask_t simd;
+   struct dspfilter_implementation impl;
+} echo_impls[] = {
+#ifdef DSPFILTER_HAVE_AVX
+   { DSPFILTER_SIMD_AVX,  ECHO_IMPL(echo_process_avx) },
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+   { DSPFILTER_SIMD_SSE,  ECHO_IMPL(echo_process_sse) },
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+   { DSPFILTER_SIMD_NEON, ECHO_IMPL(echo_process_neon) },
+#endif
+   { 0,                   ECHO_IMPL(echo_process) },
 };
 
 #ifdef HAVE_FILTERS_BUILTIN
@@ -173,8 +282,10 @@ static const struct dspfilter_implementation echo_plug = {
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
-   return &echo_plug;
+   unsigned i;
+   for (i = 0; (echo_impls[i].simd & mask) != echo_impls[i].simd; )
+      i++;
+   return &echo_impls[i].impl;
 }
 
 #undef dspfilter_get_implementation
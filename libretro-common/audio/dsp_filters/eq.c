@@ -31,9 +31,15 @@
 
 #include "fft/fft.c"
 
+struct eq_data;
+
+/* Filters the stereo block in eq->block into out. */
+typedef void (*eq_filter_block_t)(struct eq_data *eq, float *out);
+
 struct eq_data
 {
    fft_t *fft;
+   eq_filter_block_t filter_block;
    float buffer[8 * 1024];
 
    float *save;
@@ -64,6 +70,74 @@ static void eq_free(void *data)
    free(eq);
 }
 
+static void eq_filter_block(struct eq_data *eq, float *out)
+{
+   unsigned i, c;
+
+   for (c = 0; c < 2; c++)
+   {
+      fft_process_forward(eq->fft, eq->fftblock, eq->block + c, 2);
+      for (i = 0; i < 2 * eq->block_size; i++)
+         eq->fftblock[i] = fft_complex_mul(eq->fftblock[i], eq->filter[i]);
+      fft_process_inverse(eq->fft, out + c, eq->fftblock, 2);
+   }
+
+   /* Overlap add method, so add in saved block now. */
+   for (i = 0; i < 2 * eq->block_size; i++)
+      out[i] += eq->save[i];
+}
+
+/* Block sizes are powers of two of at least 4 frames here,
+ * so the loops don't need a scalar tail. */
+#define EQ_SIMD_FILTER_BLOCK(isa) \
+static DSPFILTER_TARGET_##isa void eq_filter_block_##isa(struct eq_data *eq, float *out) \
+{ \
+   unsigned i, c; \
+   float *spectrum      = (float*)eq->fftblock; \
+   const float *filter  = (const float*)eq->filter; \
+   \
+   for (c = 0; c < 2; c++) \
+   { \
+      fft_process_forward(eq->fft, eq->fftblock, eq->block + c, 2); \
+      for (i = 0; i < 4 * eq->block_size; i += DF(isa, floats)) \
+         DF(isa, store)(spectrum + i, DF(isa, cmul)( \
+                  DF(isa, load)(spectrum + i), DF(isa, load)(filter + i))); \
+      fft_process_inverse(eq->fft, out + c, eq->fftblock, 2); \
+   } \
+   \
+   for (i = 0; i < 2 * eq->block_size; i += DF(isa, floats)) \
+      DF(isa, store)(out + i, DF(isa, add)( \
+               DF(isa, load)(out + i), DF(isa, load)(eq->save + i))); \
+}
+
+#ifdef DSPFILTER_HAVE_AVX
+EQ_SIMD_FILTER_BLOCK(avx)
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+EQ_SIMD_FILTER_BLOCK(sse)
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+EQ_SIMD_FILTER_BLOCK(neon)
+#endif
+
+/* In order of preference */
+static const struct
+{
+   dspfilter_simd_mask_t simd;
+   eq_filter_block_t filter_block;
+} eq_filter_blocks[] = {
+#ifdef DSPFILTER_HAVE_AVX
+   { DSPFILTER_SIMD_AVX,  eq_filter_block_avx  },
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+   { DSPFILTER_SIMD_SSE,  eq_filter_block_sse  },
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+   { DSPFILTER_SIMD_NEON, eq_filter_block_neon },
+#endif
+   { 0,                   eq_filter_block      },
+};
+
 static void eq_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
@@ -95,19 +169,7 @@ static void eq_process(void *data, struct dspfilter_output *output,
       // Convolve a new block.
       if (eq->block_ptr == eq->block_size)
       {
-         unsigned i, c;
-
-         for (c = 0; c < 2; c++)
-         {
-            fft_process_forward(eq->fft, eq->fftblock, eq->block + c, 2);
-            for (i = 0; i < 2 * eq->block_size; i++)
-               eq->fftblock[i] = fft_complex_mul(eq->fftblock[i], eq->filter[i]);
-            fft_process_inverse(eq->fft, out + c, eq->fftblock, 2);
-         }
-
-         // Overlap add method, so add in saved block now.
-         for (i = 0; i < 2 * eq->block_size; i++)
-            out[i] += eq->save[i];
+         eq->filter_block(eq, out);
 
          // Save block for later.
          memcpy(eq->save, out + 2 * eq->block_size, 2 * eq->block_size * sizeof(float));
@@ -256,8 +318,9 @@ end:
    free(time_filter);
 }
 
-static void *eq_init(const struct dspfilter_info *info,
-      const struct dspfilter_config *config, void *userdata)
+static void *eq_init_simd(const struct dspfilter_info *info,
+      const struct dspfilter_config *config, void *userdata,
+      dspfilter_simd_mask_t simd)
 {
    float *frequencies, *gain;
    unsigned num_freq, num_gain, i, size;
@@ -309,7 +372,14 @@ static void *eq_init(const struct dspfilter_info *info,
    /* Use an FFT which is twice the block size with zero-padding
     * to make circular convolution => proper convolution.
     */
-   eq->fft = fft_new(size_log2 + 1);
+   if (size < 4)
+      simd = 0;
+
+   eq->fft = fft_new_simd(size_log2 + 1, simd);
+
+   for (i = 0; (eq_filter_blocks[i].simd & simd) != eq_filter_blocks[i].simd; )
+      i++;
+   eq->filter_block = eq_filter_blocks[i].filter_block;
 
    if (!eq->fft || !eq->fftblock || !eq->save || !eq->block || !eq->filter)
       goto error;
@@ -327,14 +397,46 @@ error:
    return NULL;
 }
 
-static const struct dspfilter_implementation eq_plug = {
-   eq_init,
-   eq_process,
-   eq_free,
+/* The FFT picks its kernels when it is created, so each
+ * implementation has its own init. */
+#define EQ_INIT(isa, simd) \
+static void *eq_init_##isa(const struct dspfilter_info *info, \
+      const struct dspfilter_config *config, void *userdata) \
+{ \
+   return eq_init_simd(info, config, userdata, simd); \
+}
 
-   DSPFILTER_API_VERSION,
-   "Linear-Phase FFT Equalizer",
-   "eq",
+EQ_INIT(c, 0)
+#ifdef DSPFILTER_HAVE_AVX
+EQ_INIT(avx, DSPFILTER_SIMD_AVX)
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+EQ_INIT(sse, DSPFILTER_SIMD_SSE)
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+EQ_INIT(neon, DSPFILTER_SIMD_NEON)
+#endif
+
+#define EQ_IMPL(init) \
+   { init, eq_process, eq_free, \
+     DSPFILTER_API_VERSION, "Linear-Phase FFT Equalizer", "eq" }
+
+/* In order of preference */
+static const struct
+{
+   dspfilter_simd_mask_t simd;
+   struct dspfilter_implementation impl;
+} eq_impls[] = {
+#ifdef DSPFILTER_HAVE_AVX
+   { DSPFILTER_SIMD_AVX,  EQ_IMPL(eq_init_avx) },
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+   { DSPFILTER_SIMD_SSE,  EQ_IMPL(eq_init_sse) },
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+   { DSPFILTER_SIMD_NEON, EQ_IMPL(eq_init_neon) },
+#endif
+   { 0,                   EQ_IMPL(eq_init_c) },
 };
 
 #ifdef HAVE_FILTERS_BUILTIN
@@ -343,8 +445,10 @@ static const struct dspfilter_implementation eq_plug = {
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
-   return &eq_plug;
+   unsigned i;
+   for (i = 0; (eq_impls[i].simd & mask) != eq_impls[i].simd; )
+      i++;
+   return &eq_impls[i].impl;
 }
 
 #undef dspfilter_get_implementation
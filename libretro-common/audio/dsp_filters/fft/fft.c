@@ -24,15 +24,28 @@
 #include <stdlib.h>
 
 #include "fft.h"
+#include "../dspfilter_simd.h"
 
 #include <retro_miscellaneous.h>
 
+/* Runs the butterflies of one stage, with the twiddle factors
+ * of the stage in order. */
+typedef void (*fft_stage_t)(fft_complex_t *butterfly_buf,
+      const fft_complex_t *twiddle, unsigned step_size, unsigned samples);
+
 struct fft
 {
    fft_complex_t *interleave_buffer;
    fft_complex_t *phase_lut;
+   /* Twiddle factors of the forward and inverse transform,
+    * stage after stage, for the vector stages. */
+   fft_complex_t *twiddle[2];
    unsigned *bitinverse_buffer;
    unsigned size;
+
+   fft_stage_t stage;
+   /* Smallest stage the vector stage can do. */
+   unsigned stage_min;
 };
 
 static unsigned bitswap(unsigned x, unsigned size_log2)
@@ -96,9 +109,75 @@ static void resolve_float(float *out, const fft_complex_t *in, unsigned samples,
       *out = gain * in->real;
 }
 
+static void build_twiddle(fft_complex_t *out,
+      const fft_complex_t *phase_lut, int phase_dir, unsigned size)
+{
+   unsigned step_size, i;
+   for (step_size = 1; step_size < size; step_size <<= 1)
+   {
+      int phase_step = (int)size * phase_dir / (int)step_size;
+      for (i = 0; i < step_size; i++)
+         *out++ = phase_lut[phase_step * (int)i];
+   }
+}
+
+#define FFT_SIMD_STAGE(isa) \
+static DSPFILTER_TARGET_##isa void fft_stage_##isa(fft_complex_t *butterfly_buf, \
+      const fft_complex_t *twiddle, unsigned step_size, unsigned samples) \
+{ \
+   unsigned i, j; \
+   for (i = 0; i < samples; i += step_size << 1) \
+   { \
+      for (j = 0; j < step_size; j += DF(isa, floats) / 2) \
+      { \
+         float *a       = (float*)(butterfly_buf + i + j); \
+         float *b       = (float*)(butterfly_buf + i + j + step_size); \
+         DF(isa, t) va  = DF(isa, load)(a); \
+         DF(isa, t) mod = DF(isa, cmul)( \
+               DF(isa, load)((const float*)(twiddle + j)), DF(isa, load)(b)); \
+         DF(isa, store)(b, DF(isa, sub)(va, mod)); \
+         DF(isa, store)(a, DF(isa, add)(va, mod)); \
+      } \
+   } \
+}
+
+#ifdef DSPFILTER_HAVE_AVX
+FFT_SIMD_STAGE(avx)
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+FFT_SIMD_STAGE(sse)
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+FFT_SIMD_STAGE(neon)
+#endif
+
+/* In order of preference */
+static const struct
+{
+   dspfilter_simd_mask_t simd;
+   fft_stage_t stage;
+   unsigned stage_min;
+} fft_stages[] = {
+#ifdef DSPFILTER_HAVE_AVX
+   { DSPFILTER_SIMD_AVX,  fft_stage_avx,  df_avx_floats / 2  },
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+   { DSPFILTER_SIMD_SSE,  fft_stage_sse,  df_sse_floats / 2  },
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+   { DSPFILTER_SIMD_NEON, fft_stage_neon, df_neon_floats / 2 },
+#endif
+   { 0,                   NULL,           0                  },
+};
+
 fft_t *fft_new(unsigned block_size_log2)
 {
-   unsigned size;
+   return fft_new_simd(block_size_log2, 0);
+}
+
+fft_t *fft_new_simd(unsigned block_size_log2, dspfilter_simd_mask_t simd)
+{
+   unsigned i, size;
    fft_t *fft = (fft_t*)calloc(1, sizeof(*fft));
    if (!fft)
       return NULL;
@@ -115,6 +194,24 @@ fft_t *fft_new(unsigned block_size_log2)
 
    build_bitinverse(fft->bitinverse_buffer, block_size_log2);
    build_phase_lut(fft->phase_lut, size);
+
+   for (i = 0; (fft_stages[i].simd & simd) != fft_stages[i].simd; )
+      i++;
+
+   if (fft_stages[i].stage)
+   {
+      fft->twiddle[0] = (fft_complex_t*)calloc(size, sizeof(*fft->twiddle[0]));
+      fft->twiddle[1] = (fft_complex_t*)calloc(size, sizeof(*fft->twiddle[1]));
+      if (!fft->twiddle[0] || !fft->twiddle[1])
+         goto error;
+
+      build_twiddle(fft->twiddle[0], fft->phase_lut + size, -1, size);
+      build_twiddle(fft->twiddle[1], fft->phase_lut + size,  1, size);
+
+      fft->stage     = fft_stages[i].stage;
+      fft->stage_min = fft_stages[i].stage_min;
+   }
+
    return fft;
 
 error:
@@ -130,6 +227,8 @@ void fft_free(fft_t *fft)
    free(fft->interleave_buffer);
    free(fft->bitinverse_buffer);
    free(fft->phase_lut);
+   free(fft->twiddle[0]);
+   free(fft->twiddle[1]);
    free(fft);
 }
 
@@ -154,51 +253,47 @@ static void butterflies(fft_complex_t *butterfly_buf,
    }
 }
 
-void fft_process_forward_complex(fft_t *fft,
-      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+static void fft_butterflies(fft_t *fft,
+      fft_complex_t *butterfly_buf, int phase_dir)
 {
    unsigned step_size;
-   unsigned samples = fft->size;
-   interleave_complex(fft->bitinverse_buffer, out, in, samples, step);
+   const fft_complex_t *twiddle = fft->twiddle[phase_dir > 0];
 
-   for (step_size = 1; step_size < samples; step_size <<= 1)
+   for (step_size = 1; step_size < fft->size; step_size <<= 1)
    {
-      butterflies(out,
-            fft->phase_lut + samples,
-            -1, step_size, samples);
+      if (fft->stage && step_size >= fft->stage_min)
+         fft->stage(butterfly_buf, twiddle + step_size - 1,
+               step_size, fft->size);
+      else
+         butterflies(butterfly_buf, fft->phase_lut + fft->size,
+               phase_dir, step_size, fft->size);
    }
 }
 
+void fft_process_forward_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+{
+   unsigned samples = fft->size;
+   interleave_complex(fft->bitinverse_buffer, out, in, samples, step);
+   fft_butterflies(fft, out, -1);
+}
+
 void fft_process_forward(fft_t *fft,
       fft_complex_t *out, const float *in, unsigned step)
 {
-   unsigned step_size;
    unsigned samples = fft->size;
    interleave_float(fft->bitinverse_buffer, out, in, samples, step);
-
-   for (step_size = 1; step_size < fft->size; step_size <<= 1)
-   {
-      butterflies(out,
-            fft->phase_lut + samples,
-            -1, step_size, samples);
-   }
+   fft_butterflies(fft, out, -1);
 }
 
 void fft_process_inverse(fft_t *fft,
       float *out, const fft_complex_t *in, unsigned step)
 {
-   unsigned step_size;
    unsigned samples = fft->size;
 
    interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer,
          in, samples, 1);
-
-   for (step_size = 1; step_size < samples; step_size <<= 1)
-   {
-      butterflies(fft->interleave_buffer,
-            fft->phase_lut + samples,
-            1, step_size, samples);
-   }
+   fft_butterflies(fft, fft->interleave_buffer, 1);
 
    resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
 }
@@ -25,11 +25,16 @@
 
 #include <retro_inline.h>
 #include <math/complex.h>
+#include <libretro_dspfilter.h>
 
 typedef struct fft fft_t;
 
 fft_t *fft_new(unsigned block_size_log2);
 
+/* Same as fft_new(), but runs the butterflies with the
+ * vector instructions in 'simd' where it can. */
+fft_t *fft_new_simd(unsigned block_size_log2, dspfilter_simd_mask_t simd);
+
 void fft_free(fft_t *fft);
 
 void fft_process_forward_complex(fft_t *fft,
@@ -28,6 +28,8 @@
 #include <libretro_dspfilter.h>
 #include <string/stdstring.h>
 
+#include "dspfilter_simd.h"
+
 #define sqr(a) ((a) * (a))
 
 /* filter types */
@@ -52,11 +54,7 @@ struct iir_data
    float b0, b1, b2;
    float a0, a1, a2;
 
-   struct
-   {
-      float xn1, xn2;
-      float yn1, yn2;
-   } l, r;
+   struct dspfilter_biquad_channel l, r;
 };
 
 static void iir_free(void *data)
@@ -124,6 +122,29 @@ static void iir_process(void *data, struct dspfilter_output *output,
    iir->r.yn2 = yn2_r;
 }
 
+#define IIR_SIMD_PROCESS(isa) \
+static DSPFILTER_TARGET_##isa void iir_process_##isa(void *data, \
+      struct dspfilter_output *output, const struct dspfilter_input *input) \
+{ \
+   struct iir_data *iir = (struct iir_data*)data; \
+   \
+   output->samples      = input->samples; \
+   output->frames       = input->frames; \
+   \
+   DF(isa, biquad)(input->samples, input->frames, \
+         iir->b0, iir->b1, iir->b2, iir->a0, iir->a1, iir->a2, \
+         &iir->l, &iir->r); \
+}
+
+/* A biquad only has the two channels to work on in parallel,
+ * wider vectors don't help. */
+#ifdef DSPFILTER_HAVE_SSE
+IIR_SIMD_PROCESS(sse)
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+IIR_SIMD_PROCESS(neon)
+#endif
+
 #define CHECK(x) if (string_is_equal(str, #x)) return x
 static enum IIRFilter str_to_type(const char *str)
 {
@@ -347,14 +368,23 @@ static void *iir_init(const struct dspfilter_info *info,
    return iir;
 }
 
-static const struct dspfilter_implementation iir_plug = {
-   iir_init,
-   iir_process,
-   iir_free,
+#define IIR_IMPL(process) \
+   { iir_init, process, iir_free, \
+     DSPFILTER_API_VERSION, "IIR", "iir" }
 
-   DSPFILTER_API_VERSION,
-   "IIR",
-   "iir",
+/* In order of preference */
+static const struct
+{
+   dspfilter_simd_mask_t simd;
+   struct dspfilter_implementation impl;
+} iir_impls[] = {
+#ifdef DSPFILTER_HAVE_SSE
+   { DSPFILTER_SIMD_SSE,  IIR_IMPL(iir_process_sse) },
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+   { DSPFILTER_SIMD_NEON, IIR_IMPL(iir_process_neon) },
+#endif
+   { 0,                   IIR_IMPL(iir_process) },
 };
 
 #ifdef HAVE_FILTERS_BUILTIN
@@ -363,8 +393,10 @@ static const struct dspfilter_implementation iir_plug = {
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
-   return &iir_plug;
+   unsigned i;
+   for (i = 0; (iir_impls[i].simd & mask) != iir_impls[i].simd; )
+      i++;
+   return &iir_impls[i].impl;
 }
 
 #undef dspfilter_get_implementation
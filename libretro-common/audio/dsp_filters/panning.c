@@ -26,6 +26,8 @@
 
 #include <libretro_dspfilter.h>
 
+#include "dspfilter_simd.h"
+
 struct panning_data
 {
    float left[2];
@@ -56,6 +58,49 @@ static void panning_process(void *data, struct dspfilter_output *output,
    }
 }
 
+/* Mixes the left and right channel of each frame with
+ * { left[0], right[0] } and { left[1], right[1] }. */
+#define PANNING_SIMD_PROCESS(isa) \
+static DSPFILTER_TARGET_##isa void panning_process_##isa(void *data, \
+      struct dspfilter_output *output, const struct dspfilter_input *input) \
+{ \
+   unsigned i; \
+   struct panning_data *pan = (struct panning_data*)data; \
+   float *out               = input->samples; \
+   unsigned samples         = input->frames * 2; \
+   DF(isa, t) mix_l         = DF(isa, set2)(pan->left[0], pan->right[0]); \
+   DF(isa, t) mix_r         = DF(isa, set2)(pan->left[1], pan->right[1]); \
+   \
+   output->samples          = input->samples; \
+   output->frames           = input->frames; \
+   \
+   for (i = 0; i + DF(isa, floats) <= samples; i += DF(isa, floats)) \
+   { \
+      DF(isa, t) v = DF(isa, load)(out + i); \
+      DF(isa, store)(out + i, DF(isa, add)( \
+               DF(isa, mul)(DF(isa, dup_l)(v), mix_l), \
+               DF(isa, mul)(DF(isa, dup_r)(v), mix_r))); \
+   } \
+   \
+   for (; i < samples; i += 2) \
+   { \
+      float left  = out[i + 0]; \
+      float right = out[i + 1]; \
+      out[i + 0]  = left * pan->left[0]  + right * pan->left[1]; \
+      out[i + 1]  = left * pan->right[0] + right * pan->right[1]; \
+   } \
+}
+
+#ifdef DSPFILTER_HAVE_AVX
+PANNING_SIMD_PROCESS(avx)
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+PANNING_SIMD_PROCESS(sse)
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+PANNING_SIMD_PROCESS(neon)
+#endif
+
 static void *panning_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
@@ -87,14 +132,26 @@ static void *panning_init(const struct dspfilter_info *info,
    return pan;
 }
 
-static const struct dspfilter_implementation panning = {
-   panning_init,
-   panning_process,
-   panning_free,
+#define PANNING_IMPL(process) \
+   { panning_init, process, panning_free, \
+     DSPFILTER_API_VERSION, "Panning", "panning" }
 
-   DSPFILTER_API_VERSION,
-   "Panning",
-   "panning",
+/* In order of preference */
+static const struct
+{
+   dspfilter_simd_mask_t simd;
+   struct dspfilter_implementation impl;
+} panning_impls[] = {
+#ifdef DSPFILTER_HAVE_AVX
+   { DSPFILTER_SIMD_AVX,  PANNING_IMPL(panning_process_avx) },
+#endif
+#ifdef DSPFILTER_HAVE_SSE
+   { DSPFILTER_SIMD_SSE,  PANNING_IMPL(panning_process_sse) },
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+   { DSPFILTER_SIMD_NEON, PANNING_IMPL(panning_process_neon) },
+#endif
+   { 0,                   PANNING_IMPL(panning_process) },
 };
 
 #ifdef HAVE_FILTERS_BUILTIN
@@ -104,8 +161,10 @@ static const struct dspfilter_implementation panning = {
 const struct dspfilter_implementation *
 dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
-   return &panning;
+   unsigned i;
+   for (i = 0; (panning_impls[i].simd & mask) != panning_impls[i].simd; )
+      i++;
+   return &panning_impls[i].impl;
 }
 
 #undef dspfilter_get_implementation
@@ -27,6 +27,8 @@
 #include <retro_miscellaneous.h>
 #include <libretro_dspfilter.h>
 
+#include "dspfilter_simd.h"
+
 #define WAHWAH_LFO_SKIP_SAMPLES 30
 
 struct wahwah_data
@@ -38,10 +40,7 @@ struct wahwah_data
    float depth, freqofs, res;
    unsigned long skipcount;
 
-   struct
-   {
-      float xn1, xn2, yn1, yn2;
-   } l, r;
+   struct dspfilter_biquad_channel l, r;
 };
 
 static void wahwah_free(void *data)
@@ -50,6 +49,28 @@ static void wahwah_free(void *data)
       free(data);
 }
 
+/* Moves the filter along the LFO. */
+static void wahwah_update(struct wahwah_data *wah, unsigned long skipcount)
+{
+   float omega, sn, cs, alpha;
+   float frequency = (1.0 + cos(skipcount * wah->lfoskip + wah->phase)) / 2.0;
+
+   frequency = frequency * wah->depth * (1.0 - wah->freqofs) + wah->freqofs;
+   frequency = exp((frequency - 1.0) * 6.0);
+
+   omega     = M_PI * frequency;
+   sn        = sin(omega);
+   cs        = cos(omega);
+   alpha     = sn / (2.0 * wah->res);
+
+   wah->b0   = (1.0 - cs) / 2.0;
+   wah->b1   = 1.0 - cs;
+   wah->b2   = (1.0 - cs) / 2.0;
+   wah->a0   = 1.0 + alpha;
+   wah->a1   = -2.0 * cs;
+   wah->a2   = 1.0 - alpha;
+}
+
 static void wahwah_process(void *data, struct dspfilter_output *output,
       const struct dspfilter_input *input)
 {
@@ -66,25 +87,7 @@ static void wahwah_process(void *data, struct dspfilter_output *output,
       float in[2] = { out[0], out[1] };
 
       if ((wah->skipcount++ % WAHWAH_LFO_SKIP_SAMPLES) == 0)
-      {
-         float omega, sn, cs, alpha;
-         float frequency = (1.0 + cos(wah->skipcount * wah->lfoskip + wah->phase)) / 2.0;
-
-         frequency = frequency * wah->depth * (1.0 - wah->freqofs) + wah->freqofs;
-         frequency = exp((frequency - 1.0) * 6.0);
-
-         omega     = M_PI * frequency;
-         sn        = sin(omega);
-         cs        = cos(omega);
-         alpha     = sn / (2.0 * wah->res);
-
-         wah->b0   = (1.0 - cs) / 2.0;
-         wah->b1   = 1.0 - cs;
-         wah->b2   = (1.0 - cs) / 2.0;
-         wah->a0   = 1.0 + alpha;
-         wah->a1   = -2.0 * cs;
-         wah->a2   = 1.0 - alpha;
-      }
+         wahwah_update(wah, wah->skipcount);
 
       out_l      = (wah->b0 * in[0] + wah->b1 * wah->l.xn1 + wah->b2 * wah->l.xn2 - wah->a1 * wah->l.yn1 - wah->a2 * wah->l.yn2) / wah->a0;
       out_r      = (wah->b0 * in[1] + wah->b1 * wah->r.xn1 + wah->b2 * wah->r.xn2 - wah->a1 * wah->r.yn1 - wah->a2 * wah->r.yn2) / wah->a0;
@@ -104,6 +107,47 @@ static void wahwah_process(void *data, struct dspfilter_output *output,
    }
 }
 
+/* The coefficients stay the same between LFO updates,
+ * run the biquad over each such stretch at once. */
+#define WAHWAH_SIMD_PROCESS(isa) \
+static DSPFILTER_TARGET_##isa void wahwah_process_##isa(void *data, \
+      struct dspfilter_output *output, const struct dspfilter_input *input) \
+{ \
+   struct wahwah_data *wah = (struct wahwah_data*)data; \
+   float *out              = input->samples; \
+   unsigned frames         = input->frames; \
+   \
+   output->samples         = input->samples; \
+   output->frames          = input->frames; \
+   \
+   while (frames) \
+   { \
+      unsigned pos   = (unsigned)(wah->skipcount % WAHWAH_LFO_SKIP_SAMPLES); \
+      unsigned block = WAHWAH_LFO_SKIP_SAMPLES - pos; \
+      \
+      if (block > frames) \
+         block = frames; \
+      \
+      if (pos == 0) \
+         wahwah_update(wah, wah->skipcount + 1); \
+      \
+      DF(isa, biquad)(out, block, \
+            wah->b0, wah->b1, wah->b2, wah->a0, wah->a1, wah->a2, \
+            &wah->l, &wah->r); \
+      \
+      wah->skipcount += block; \
+      out            += block << 1; \
+      frames         -= block; \
+   } \
+}
+
+#ifdef DSPFILTER_HAVE_SSE
+WAHWAH_SIMD_PROCESS(sse)
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+WAHWAH_SIMD_PROCESS(neon)
+#endif
+
 static void *wahwah_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
@@ -123,14 +167,23 @@ static void *wahwah_init(const struct dspfilter_info *info,
    return wah;
 }
 
-static const struct dspfilter_implementation wahwah_plug = {
-   wahwah_init,
-   wahwah_process,
-   wahwah_free,
+#define WAHWAH_IMPL(process) \
+   { wahwah_init, process, wahwah_free, \
+     DSPFILTER_API_VERSION, "Wah-Wah", "wahwah" }
 
-   DSPFILTER_API_VERSION,
-   "Wah-Wah",
-   "wahwah",
+/* In order of preference */
+static const struct
+{
+   dspfilter_simd_mask_t simd;
+   struct dspfilter_implementation impl;
+} wahwah_impls[] = {
+#ifdef DSPFILTER_HAVE_SSE
+   { DSPFILTER_SIMD_SSE,  WAHWAH_IMPL(wahwah_process_sse) },
+#endif
+#ifdef DSPFILTER_HAVE_NEON
+   { DSPFILTER_SIMD_NEON, WAHWAH_IMPL(wahwah_process_neon) },
+#endif
+   { 0,                   WAHWAH_IMPL(wahwah_process) },
 };
 
 #ifdef HAVE_FILTERS_BUILTIN
@@ -140,8 +193,10 @@ static const struct dspfilter_implementation wahwah_plug = {
 const struct dspfilter_implementation *
 dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
-   (void)mask;
-   return &wahwah_plug;
+   unsigned i;
+   for (i = 0; (wahwah_impls[i].simd & mask) != wahwah_impls[i].simd; )
+      i++;
+   return &wahwah_impls[i].impl;
 }
 
 #undef dspfilter_get_implementation
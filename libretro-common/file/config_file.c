@@ -51,6 +51,8 @@
 
 #define MAX_INCLUDE_DEPTH 16
 
+#define CONFIG_ENTRIES_MAP_MIN_SIZE 64
+
 struct config_entry_list
 {
    /* If we got this from an #include,
@@ -60,6 +62,11 @@ struct config_entry_list
    char *key;
    char *value;
    struct config_entry_list *next;
+
+   /* Hash of key, and next entry in the
+    * same entries_map bucket */
+   uint32_t hash;
+   struct config_entry_list *map_next;
 };
 
 struct config_include_list
@@ -71,10 +78,147 @@ struct config_include_list
 static config_file_t *config_file_new_internal(
       const char *path, unsigned depth, config_file_cb_t *cb);
 
+/* djb2 */
+static uint32_t config_file_hash(const char *key)
+{
+   const unsigned char *aux = (const unsigned char*)key;
+   uint32_t            hash = 5381;
+
+   while (*aux)
+      hash = (hash << 5) + hash + *aux++;
+
+   return hash;
+}
+
+static struct config_entry_list *config_get_entry(
+      const config_file_t *conf, const char *key)
+{
+   uint32_t hash;
+   struct config_entry_list *entry = NULL;
+
+   if (!conf->entries_map || !key)
+      return NULL;
+
+   hash = config_file_hash(key);
+
+   for (entry = conf->entries_map[hash & (conf->entries_map_size - 1)];
+         entry; entry = entry->map_next)
+   {
+      if (entry->hash == hash && string_is_equal(key, entry->key))
+         return entry;
+   }
+
+   return NULL;
+}
+
+static bool config_file_map_grow(config_file_t *conf)
+{
+   size_t i;
+   size_t size                          = conf->entries_map_size ?
+      conf->entries_map_size * 2 : CONFIG_ENTRIES_MAP_MIN_SIZE;
+   struct config_entry_list **map       = (struct config_entry_list**)
+      calloc(size, sizeof(*map));
+
+   if (!map)
+      return false;
+
+   for (i = 0; i < conf->entries_map_size; i++)
+   {
+      struct config_entry_list *entry = conf->entries_map[i];
+
+      while (entry)
+      {
+         struct config_entry_list *next = entry->map_next;
+         size_t idx                     = entry->hash & (size - 1);
+
+         entry->map_next = map[idx];
+         map[idx]        = entry;
+         entry           = next;
+      }
+   }
+
+   free(conf->entries_map);
+
+   conf->entries_map      = map;
+   conf->entries_map_size = size;
+
+   return true;
+}
+
+/* Registers an entry that was added to the end
+ * of the entry list. Only the first occurrence
+ * of a key is looked up, so later duplicates
+ * are not registered. */
+static void config_file_map_add(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   size_t idx;
+
+   entry->map_next = NULL;
+
+   if (!entry->key)
+      return;
+
+   entry->hash = config_file_hash(entry->key);
+
+   if (config_get_entry(conf, entry->key))
+      return;
+
+   if (conf->entries_map_count >= conf->entries_map_size)
+      if (!config_file_map_grow(conf))
+         return;
+
+   idx                    = entry->hash & (conf->entries_map_size - 1);
+   entry->map_next        = conf->entries_map[idx];
+   conf->entries_map[idx] = entry;
+   conf->entries_map_count++;
+}
+
+static void config_file_map_remove(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   struct config_entry_list **prev = NULL;
+
+   if (!conf->entries_map)
+      return;
+
+   for (prev = &conf->entries_map[entry->hash & (conf->entries_map_size - 1)];
+         *prev; prev = &(*prev)->map_next)
+   {
+      if (*prev != entry)
+         continue;
+
+      *prev           = entry->map_next;
+      entry->map_next = NULL;
+      conf->entries_map_count--;
+      return;
+   }
+}
+
+/* Rebuilds the hash index and the tail pointer
+ * after the entry list has been reordered */
+static void config_file_map_rebuild(config_file_t *conf)
+{
+   struct config_entry_list *entry = NULL;
+
+   if (conf->entries_map)
+      memset(conf->entries_map, 0,
+            conf->entries_map_size * sizeof(*conf->entries_map));
+   conf->entries_map_count = 0;
+   conf->tail              = NULL;
+
+   for (entry = conf->entries; entry; entry = entry->next)
+   {
+      config_file_map_add(conf, entry);
+      conf->tail = entry;
+   }
+}
+
 static int config_sort_compare_func(struct config_entry_list *a,
       struct config_entry_list *b)
 {
-   return (a && b) ? strcasecmp(a->key, b->key) : 0;
+   /* Keys of unset entries are NULL */
+   return (a && b && a->key && b->key) ? strcasecmp(a->key, b->key) : 0;
 }
 
 /* https://stackoverflow.com/questions/7685/merge-sort-a-linked-list */
@@ -227,45 +371,26 @@ static char *extract_value(char *line, bool is_value)
 static void add_child_list(config_file_t *parent, config_file_t *child)
 {
    struct config_entry_list *list = child->entries;
-   if (parent->entries)
-   {
-      struct config_entry_list *head = parent->entries;
-      while (head->next)
-         head = head->next;
 
-      /* set list readonly */
-      while (list)
-      {
-         list->readonly = true;
-         list           = list->next;
-      }
-      head->next        = child->entries;
-   }
+   if (!list)
+      return;
+
+   if (parent->tail)
+      parent->tail->next = list;
    else
+      parent->entries    = list;
+
+   /* set list readonly, and rebase tail */
+   while (list)
    {
-      /* set list readonly */
-      while (list)
-      {
-         list->readonly = true;
-         list           = list->next;
-      }
-      parent->entries   = child->entries;
+      list->readonly = true;
+      config_file_map_add(parent, list);
+      parent->tail   = list;
+      list           = list->next;
    }
 
    child->entries = NULL;
-
-   /* Rebase tail. */
-   if (parent->entries)
-   {
-      struct config_entry_list *head =
-         (struct config_entry_list*)parent->entries;
-
-      while (head->next)
-         head = head->next;
-      parent->tail = head;
-   }
-   else
-      parent->tail = NULL;
+   child->tail    = NULL;
 }
 
 static void add_sub_conf(config_file_t *conf, char *path, config_file_cb_t *cb)
@@ -449,6 +574,7 @@ static config_file_t *config_file_new_internal(
             conf->entries    = list;
 
          conf->tail = list;
+         config_file_map_add(conf, list);
 
          if (cb != NULL && list->key != NULL && list->value != NULL)
             cb->config_file_new_entry_cb(list->key, list->value) ;
@@ -510,6 +636,7 @@ void config_file_free(config_file_t *conf)
 
    if (conf->path)
       free(conf->path);
+   free(conf->entries_map);
    free(conf);
 }
 
@@ -524,6 +651,9 @@ bool config_append_file(config_file_t *conf, const char *path)
       new_conf->tail->next = conf->entries;
       conf->entries        = new_conf->entries; /* Pilfer. */
       new_conf->entries    = NULL;
+
+      /* Prepended keys take priority */
+      config_file_map_rebuild(conf);
    }
 
    config_file_free(new_conf);
@@ -535,21 +665,13 @@ config_file_t *config_file_new_from_string(const char *from_string,
 {
    size_t i;
    struct string_list *lines = NULL;
-   struct config_file *conf  = (struct config_file*)malloc(sizeof(*conf));
+   struct config_file *conf  = config_file_new_alloc();
    if (!conf)
       return NULL;
 
    if (!from_string)
       return conf;
 
-   conf->path                     = NULL;
-   conf->entries                  = NULL;
-   conf->tail                     = NULL;
-   conf->last                     = NULL;
-   conf->includes                 = NULL;
-   conf->include_depth            = 0;
-   conf->guaranteed_no_duplicates = false ;
-
    if (!string_is_empty(path))
       conf->path                  = strdup(path);
 
@@ -585,6 +707,7 @@ config_file_t *config_file_new_from_string(const char *from_string,
                conf->entries    = list;
 
             conf->tail          = list;
+            config_file_map_add(conf, list);
          }
       }
 
@@ -641,34 +764,16 @@ config_file_t *config_file_new_alloc(void)
    conf->includes                 = NULL;
    conf->include_depth            = 0;
    conf->guaranteed_no_duplicates = false ;
+   conf->entries_map              = NULL;
+   conf->entries_map_size         = 0;
+   conf->entries_map_count        = 0;
 
    return conf;
 }
 
-static struct config_entry_list *config_get_entry(
-      const config_file_t *conf,
-      const char *key, struct config_entry_list **prev)
-{
-   struct config_entry_list *entry    = NULL;
-   struct config_entry_list *previous = prev ? *prev : NULL;
-
-   for (entry = conf->entries; entry; entry = entry->next)
-   {
-      if (string_is_equal(key, entry->key))
-         return entry;
-
-      previous = entry;
-   }
-
-   if (prev)
-      *prev = previous;
-
-   return NULL;
-}
-
 bool config_get_double(config_file_t *conf, const char *key, double *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (!entry)
       return false;
@@ -679,7 +784,7 @@ bool config_get_double(config_file_t *conf, const char *key, double *in)
 
 bool config_get_float(config_file_t *conf, const char *key, float *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (!entry)
       return false;
@@ -691,7 +796,7 @@ bool config_get_float(config_file_t *conf, const char *key, float *in)
 
 bool config_get_int(config_file_t *conf, const char *key, int *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -710,7 +815,7 @@ bool config_get_int(config_file_t *conf, const char *key, int *in)
 
 bool config_get_size_t(config_file_t *conf, const char *key, size_t *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -729,7 +834,7 @@ bool config_get_size_t(config_file_t *conf, const char *key, size_t *in)
 #if defined(__STDC_VERSION__) && __STDC_VERSION__>=199901L
 bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -748,7 +853,7 @@ bool config_get_uint64(config_file_t *conf, const char *key, uint64_t *in)
 
 bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -767,7 +872,7 @@ bool config_get_uint(config_file_t *conf, const char *key, unsigned *in)
 
 bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
    errno = 0;
 
    if (entry)
@@ -786,7 +891,7 @@ bool config_get_hex(config_file_t *conf, const char *key, unsigned *in)
 
 bool config_get_char(config_file_t *conf, const char *key, char *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -802,7 +907,7 @@ bool config_get_char(config_file_t *conf, const char *key, char *in)
 
 bool config_get_string(config_file_t *conf, const char *key, char **str)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (!entry)
       return false;
@@ -821,7 +926,7 @@ bool config_get_config_path(config_file_t *conf, char *s, size_t len)
 bool config_get_array(config_file_t *conf, const char *key,
       char *buf, size_t size)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
       return strlcpy(buf, entry->value, size) < size;
@@ -835,7 +940,7 @@ bool config_get_path(config_file_t *conf, const char *key,
    if (config_get_array(conf, key, buf, size))
       return true;
 #else
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -848,7 +953,7 @@ bool config_get_path(config_file_t *conf, const char *key,
 
 bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 {
-   const struct config_entry_list *entry = config_get_entry(conf, key, NULL);
+   const struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (entry)
    {
@@ -869,8 +974,8 @@ bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 
 void config_set_string(config_file_t *conf, const char *key, const char *val)
 {
-   struct config_entry_list *last  = (conf->guaranteed_no_duplicates && conf->last) ? conf->last : conf->entries;
-   struct config_entry_list *entry = conf->guaranteed_no_duplicates?NULL:config_get_entry(conf, key, &last);
+   struct config_entry_list *entry = conf->guaranteed_no_duplicates ?
+      NULL : config_get_entry(conf, key);
 
    if (entry && !entry->readonly)
    {
@@ -892,26 +997,42 @@ void config_set_string(config_file_t *conf, const char *key, const char *val)
    entry->value     = strdup(val);
    entry->next      = NULL;
 
-   if (last)
-      last->next    = entry;
+   if (conf->tail)
+      conf->tail->next = entry;
    else
-      conf->entries = entry;
+      conf->entries    = entry;
 
+   conf->tail       = entry;
    conf->last       = entry;
+
+   config_file_map_add(conf, entry);
 }
 
 void config_unset(config_file_t *conf, const char *key)
 {
-   struct config_entry_list *last  = conf->entries;
-   struct config_entry_list *entry = config_get_entry(conf, key, &last);
+   struct config_entry_list *next  = NULL;
+   struct config_entry_list *entry = config_get_entry(conf, key);
 
    if (!entry)
       return;
 
-   entry->key   = NULL;
-   entry->value = NULL;
+   config_file_map_remove(conf, entry);
+
+   /* A later duplicate of the key, if any,
+    * now becomes the one that is looked up */
+   for (next = entry->next; next; next = next->next)
+   {
+      if (string_is_equal(entry->key, next->key))
+      {
+         config_file_map_add(conf, next);
+         break;
+      }
+   }
+
    free(entry->key);
    free(entry->value);
+   entry->key   = NULL;
+   entry->value = NULL;
 }
 
 void config_set_path(config_file_t *conf, const char *entry, const char *val)
@@ -1052,6 +1173,7 @@ void config_file_dump_orbis(config_file_t *conf, int fd)
 
    list = merge_sort_linked_list((struct config_entry_list*)conf->entries, config_sort_compare_func);
    conf->entries = list;
+   config_file_map_rebuild(conf);
 
    while (list)
    {
@@ -1085,6 +1207,9 @@ void config_file_dump(config_file_t *conf, FILE *file, bool sort)
 
    conf->entries = list;
 
+   if (sort)
+      config_file_map_rebuild(conf);
+
    while (list)
    {
       if (!list->readonly && list->key)
@@ -1095,16 +1220,7 @@ void config_file_dump(config_file_t *conf, FILE *file, bool sort)
 
 bool config_entry_exists(config_file_t *conf, const char *entry)
 {
-   struct config_entry_list *list = conf->entries;
-
-   while (list)
-   {
-      if (string_is_equal(entry, list->key))
-         return true;
-      list = list->next;
-   }
-
-   return false;
+   return config_get_entry(conf, entry) != NULL;
 }
 
 bool config_get_entry_list_head(config_file_t *conf,
@@ -27,12 +27,30 @@
 #include <stddef.h>
 
 #include <retro_common_api.h>
+#include <boolean.h>
 
 RETRO_BEGIN_DECLS
 
+enum encoding_crc32_impl
+{
+   ENCODING_CRC32_IMPL_AUTO = 0,
+   ENCODING_CRC32_IMPL_TABLE,
+   ENCODING_CRC32_IMPL_SLICE8,
+   ENCODING_CRC32_IMPL_PCLMUL,
+   ENCODING_CRC32_IMPL_ARMV8
+};
+
+/* Uses the fastest implementation supported by the
+ * build and the CPU, picked on first use. */
 uint32_t encoding_crc32(uint32_t crc, const uint8_t *buf, size_t len);
 uint32_t file_crc32(uint32_t crc, const char *path);
 
+/* Specific implementations, for testing and benchmarking.
+ * encoding_crc32_impl() returns 0 if @impl is not available. */
+bool encoding_crc32_impl_available(enum encoding_crc32_impl impl);
+uint32_t encoding_crc32_impl(enum encoding_crc32_impl impl,
+      uint32_t crc, const uint8_t *buf, size_t len);
+
 RETRO_END_DECLS
 
 #endif
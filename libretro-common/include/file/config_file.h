@@ -61,6 +61,12 @@ struct config_file
    bool guaranteed_no_duplicates;
 
    struct config_include_list *includes;
+
+   /* Hash index of 'entries', mapping each key
+    * to its first occurrence in the list */
+   struct config_entry_list **entries_map;
+   size_t entries_map_size;
+   size_t entries_map_count;
 };
 
 typedef struct config_file config_file_t;
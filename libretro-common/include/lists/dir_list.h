@@ -25,10 +25,31 @@
 
 #include <retro_common_api.h>
 
+#include <stdint.h>
+#include <boolean.h>
+
 #include <lists/string_list.h>
 
 RETRO_BEGIN_DECLS
 
+struct dir_list_entry
+{
+   /* Owned by the list */
+   const char *path;
+   /* -1 for directories, or when sizes were not requested */
+   int64_t size;
+   /* enum rarch_file_type, as attr.i of a dir_list_new() listing */
+   int type;
+};
+
+struct dir_list
+{
+   struct dir_list_entry *entries;
+   size_t size;
+   /* Storage for the paths */
+   void *arena;
+};
+
 /**
  * dir_list_append:
  * @list               : existing list to append to.
@@ -63,6 +84,47 @@ bool dir_list_append(struct string_list *list, const char *dir, const char *ext,
 struct string_list *dir_list_new(const char *dir, const char *ext,
       bool include_dirs, bool include_hidden, bool include_compressed, bool recursive);
 
+/**
+ * dir_list_new_parallel:
+ * @dir                : directory path.
+ * @ext                : allowed extensions of file directory entries to include.
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : include compressed files, even when not part of ext.
+ * @recursive          : list directory contents recursively
+ * @get_size           : fill in the size of each file.
+ * @num_threads        : number of directories read at once, 0 picks a default.
+ *
+ * Create a directory listing, reading subdirectories
+ * concurrently. Filters entries the same way as dir_list_new(),
+ * but the order of the entries is not defined.
+ *
+ * Returns: pointer to a directory listing on success,
+ * NULL in case of error. Has to be freed with dir_list_parallel_free().
+ **/
+struct dir_list *dir_list_new_parallel(const char *dir, const char *ext,
+      bool include_dirs, bool include_hidden, bool include_compressed,
+      bool recursive, bool get_size, unsigned num_threads);
+
+/**
+ * dir_list_parallel_sort:
+ * @list      : pointer to the directory listing.
+ * @dir_first : move the directories in the listing to the top?
+ *
+ * Sorts a directory listing created by dir_list_new_parallel().
+ *
+ **/
+void dir_list_parallel_sort(struct dir_list *list, bool dir_first);
+
+/**
+ * dir_list_parallel_free:
+ * @list : pointer to the directory listing
+ *
+ * Frees a directory listing created by dir_list_new_parallel().
+ *
+ **/
+void dir_list_parallel_free(struct dir_list *list);
+
 /**
  * dir_list_sort:
  * @list      : pointer to the directory listing.
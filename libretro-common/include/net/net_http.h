@@ -34,6 +34,11 @@ RETRO_BEGIN_DECLS
 struct http_t;
 struct http_connection_t;
 
+/* Receives the response body piece by piece, see
+ * net_http_set_write_cb(). Returning false aborts the transfer. */
+typedef bool (*net_http_write_cb_t)(void *userdata,
+      const void *data, size_t len);
+
 struct http_connection_t *net_http_connection_new(const char *url, const char *method, const char *data);
 
 bool net_http_connection_iterate(struct http_connection_t *conn);
@@ -44,10 +49,37 @@ void net_http_connection_free(struct http_connection_t *conn);
 
 void net_http_connection_set_user_agent(struct http_connection_t* conn, const char* user_agent);
 
+/* Asks the server to keep the connection open after the
+ * response, so it can be reused with net_http_new_reuse(). */
+void net_http_connection_set_keep_alive(struct http_connection_t *conn,
+      bool keep_alive);
+
 const char *net_http_connection_url(struct http_connection_t *conn);
 
+/* Whether 'state' is connected to the host 'conn' points at. */
+bool net_http_connection_matches(struct http_connection_t *conn,
+      struct http_t *state);
+
 struct http_t *net_http_new(struct http_connection_t *conn);
 
+/* Sends the request for 'conn' over the connection of 'idle',
+ * a finished transfer for which net_http_keep_alive() holds.
+ * 'idle' is reused for the new transfer, or deleted if the
+ * request could not be sent, in which case NULL is returned. */
+struct http_t *net_http_new_reuse(struct http_connection_t *conn,
+      struct http_t *idle);
+
+/* Returns true if the transfer is done and its connection
+ * can take another request. */
+bool net_http_keep_alive(struct http_t *state);
+
+/* Hands the body of successful (20x) responses to 'write_cb'
+ * as it arrives instead of collecting it in memory; the
+ * buffer returned by net_http_data() then stays empty.
+ * Must be called before the headers have been received. */
+void net_http_set_write_cb(struct http_t *state,
+      net_http_write_cb_t write_cb, void *userdata);
+
 /* You can use this to call net_http_update
  * only when something will happen; select() it for reading. */
 int net_http_fd(struct http_t *state);
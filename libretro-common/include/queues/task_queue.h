@@ -32,6 +32,8 @@
 
 RETRO_BEGIN_DECLS
 
+#define TASK_QUEUE_MAX_WORKERS 16
+
 enum task_type
 {
    TASK_TYPE_NONE,
@@ -42,6 +44,20 @@ enum task_type
    TASK_TYPE_BLOCKING
 };
 
+enum task_priority
+{
+   /* Default priority. Tasks of the same priority
+    * are run round-robin. */
+   TASK_PRIORITY_NORMAL = 0,
+   /* Runs ahead of normal and low priority tasks
+    * (e.g. image loads visible in the user interface). */
+   TASK_PRIORITY_HIGH,
+   /* Runs when no higher priority task is pending
+    * (e.g. bulk content scans). */
+   TASK_PRIORITY_LOW,
+   TASK_PRIORITY_LAST
+};
+
 typedef struct retro_task retro_task_t;
 typedef void (*retro_task_callback_t)(retro_task_t *task,
       void *task_data,
@@ -111,6 +127,10 @@ struct retro_task
 
    enum task_type type;
 
+   /* scheduling priority; only honoured by
+    * the threaded implementation. */
+   enum task_priority priority;
+
    /* task identifier */
    uint32_t ident;
 
@@ -192,6 +212,16 @@ void task_queue_unset_threaded(void);
 
 bool task_queue_is_threaded(void);
 
+/* Sets the number of worker threads used by
+ * the threaded implementation. Clamped to
+ * [1, TASK_QUEUE_MAX_WORKERS]. Takes effect
+ * on the next task_queue_init() - or on the
+ * next task_queue_check() if the task system
+ * is already running threaded. */
+void task_queue_set_worker_count(unsigned count);
+
+unsigned task_queue_get_worker_count(void);
+
 /**
  * Calls func for every running task
  * until it returns true.
@@ -244,6 +274,11 @@ void task_queue_deinit(void);
  * and chooses an appropriate
  * implementation according to the settings.
  *
+ * The threaded implementation starts
+ * task_queue_get_worker_count() workers,
+ * each owning one deque per priority level.
+ * Idle workers steal from the others.
+ *
  * This must only be called from the main thread. */
 void task_queue_init(bool threaded, retro_task_queue_msg_t msg_push);
 
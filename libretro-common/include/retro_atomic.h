@@ -0,0 +1,61 @@
+/* Copyright  (C) 2010-2018 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (retro_atomic.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_COMMON_RETRO_ATOMIC_H
+#define __LIBRETRO_COMMON_RETRO_ATOMIC_H
+
+#include <stdint.h>
+
+/* Atomic operations on 32-bit values, for lock-free handoffs
+ * between threads. HAVE_RETRO_ATOMIC is defined when the
+ * compiler provides them; code falling back to locks or a
+ * single thread should check it first.
+ *
+ * RETRO_ATOMIC_ADD returns the new value, RETRO_ATOMIC_CAS
+ * whether the swap happened. Both are full barriers. */
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_4) || (defined(_MSC_VER) && !defined(_XBOX))
+#define HAVE_RETRO_ATOMIC
+
+#if defined(_MSC_VER)
+#include <windows.h>
+
+#define RETRO_ATOMIC_ADD(ptr, val)         ((uint32_t)InterlockedExchangeAdd((LONG volatile*)(ptr), (LONG)(val)) + (uint32_t)(val))
+#define RETRO_ATOMIC_CAS(ptr, oldval, val) ((uint32_t)InterlockedCompareExchange((LONG volatile*)(ptr), (LONG)(val), (LONG)(oldval)) == (uint32_t)(oldval))
+#define RETRO_ATOMIC_BARRIER()             MemoryBarrier()
+#define RETRO_ATOMIC_PAUSE()               YieldProcessor()
+#else
+#define RETRO_ATOMIC_ADD(ptr, val)         __sync_add_and_fetch((ptr), (val))
+#define RETRO_ATOMIC_CAS(ptr, oldval, val) __sync_bool_compare_and_swap((ptr), (oldval), (val))
+#define RETRO_ATOMIC_BARRIER()             __sync_synchronize()
+
+/* Spin-wait hint for the CPU. */
+#if defined(__i386__) || defined(__x86_64__)
+#define RETRO_ATOMIC_PAUSE()               __asm__ __volatile__("pause")
+#elif defined(__aarch64__) || defined(__ARM_ARCH_7A__)
+#define RETRO_ATOMIC_PAUSE()               __asm__ __volatile__("yield")
+#else
+#define RETRO_ATOMIC_PAUSE()               RETRO_ATOMIC_BARRIER()
+#endif
+#endif
+#endif
+
+#endif
@@ -21,6 +21,8 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 
 #if defined(_WIN32) && defined(_XBOX)
 #include <xtl.h>
@@ -38,6 +40,17 @@
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+/* Workers used by dir_list_new_parallel() when none are
+ * given. Listing is bound by filesystem latency rather
+ * than CPU, so this is not tied to the core count. */
+#define DIR_LIST_DEFAULT_THREADS 8
+
+#define DIR_LIST_ARENA_BLOCK     (64 * 1024)
+
 static int qstrcmp_plain(const void *a_, const void *b_)
 {
    const struct string_list_elem *a = (const struct string_list_elem*)a_;
@@ -238,3 +251,612 @@ struct string_list *dir_list_new(const char *dir,
 
    return list;
 }
+
+/* Strings of a parallel listing are carved out of large
+ * blocks, which are only freed together with the list */
+struct dir_list_arena
+{
+   struct dir_list_arena *next;
+   size_t used;
+   size_t cap;
+   char data[1];
+};
+
+/* Open addressing set of extensions, compared without case */
+struct dir_list_ext_set
+{
+   char **exts;
+   size_t mask;
+};
+
+/* State of one worker; entries and strings are merged
+ * into the list once all workers are done */
+struct dir_list_worker
+{
+   struct dir_list_entry *entries;
+   struct dir_list_arena *arena;
+   struct dir_list_walk *walk;
+   size_t size;
+   size_t cap;
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+#endif
+};
+
+struct dir_list_walk
+{
+   struct dir_list_ext_set ext_set;
+   /* Directories waiting to be read, the paths live in
+    * the arena of the worker that found them */
+   const char **queue;
+   size_t queue_size;
+   size_t queue_cap;
+   /* Workers currently reading a directory */
+   unsigned busy;
+   bool include_dirs;
+   bool include_hidden;
+   bool include_compressed;
+   bool recursive;
+   bool get_size;
+   bool error;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+   scond_t *cond;
+#endif
+};
+
+static uint32_t dir_list_ext_hash(const char *ext)
+{
+   uint32_t hash = 5381;
+
+   while (*ext)
+      hash = (hash << 5) + hash + (unsigned char)tolower((unsigned char)*ext++);
+
+   return hash;
+}
+
+static bool dir_list_ext_set_init(struct dir_list_ext_set *set,
+      const char *ext)
+{
+   size_t i;
+   struct string_list *ext_list = NULL;
+
+   set->exts = NULL;
+   set->mask = 0;
+
+   if (!ext)
+      return true;
+
+   if (!(ext_list = string_split(ext, "|")))
+      return false;
+
+   /* Keep the table at most half full */
+   set->mask = 15;
+   while (set->mask + 1 < ext_list->size * 2)
+      set->mask = (set->mask << 1) | 1;
+
+   if (!(set->exts = (char**)calloc(set->mask + 1, sizeof(*set->exts))))
+   {
+      string_list_free(ext_list);
+      return false;
+   }
+
+   for (i = 0; i < ext_list->size; i++)
+   {
+      size_t slot;
+      char *elem   = ext_list->elems[i].data;
+
+      /* dir_list_read() also matches extensions given with
+       * a leading '.' (see string_list_find_elem_prefix()),
+       * so store those without it */
+      if (*elem == '.')
+         memmove(elem, elem + 1, strlen(elem));
+
+      slot         = dir_list_ext_hash(elem) & set->mask;
+
+      while (set->exts[slot] && !string_is_equal_noncase(
+               set->exts[slot], elem))
+         slot = (slot + 1) & set->mask;
+
+      if (set->exts[slot])
+         continue;
+
+      /* Take the string over from the split list */
+      set->exts[slot]           = elem;
+      ext_list->elems[i].data   = NULL;
+   }
+
+   string_list_free(ext_list);
+   return true;
+}
+
+static bool dir_list_ext_set_has(const struct dir_list_ext_set *set,
+      const char *ext)
+{
+   size_t slot;
+
+   if (!set->exts)
+      return false;
+
+   slot = dir_list_ext_hash(ext) & set->mask;
+
+   while (set->exts[slot])
+   {
+      if (string_is_equal_noncase(set->exts[slot], ext))
+         return true;
+      slot = (slot + 1) & set->mask;
+   }
+
+   return false;
+}
+
+static void dir_list_ext_set_free(struct dir_list_ext_set *set)
+{
+   size_t i;
+
+   if (!set->exts)
+      return;
+
+   for (i = 0; i <= set->mask; i++)
+      free(set->exts[i]);
+   free(set->exts);
+   set->exts = NULL;
+}
+
+static char *dir_list_arena_join(struct dir_list_arena **arena,
+      const char *dir, const char *name)
+{
+   char *out;
+   size_t dir_len  = strlen(dir);
+   size_t name_len = strlen(name);
+   /* Room for a separator and the terminator */
+   size_t len      = dir_len + name_len + 2;
+
+   if (!*arena || (*arena)->cap - (*arena)->used < len)
+   {
+      size_t cap = len > DIR_LIST_ARENA_BLOCK ? len : DIR_LIST_ARENA_BLOCK;
+      struct dir_list_arena *block = (struct dir_list_arena*)malloc(
+            sizeof(*block) + cap);
+
+      if (!block)
+         return NULL;
+
+      block->next = *arena;
+      block->used = 0;
+      block->cap  = cap;
+      *arena      = block;
+   }
+
+   out = (*arena)->data + (*arena)->used;
+   memcpy(out, dir, dir_len);
+   /* Same separator as fill_pathname_join() would use */
+   if (dir_len && !path_char_is_slash(dir[dir_len - 1]))
+   {
+      const char *last_slash = find_last_slash(dir);
+      out[dir_len++]         = last_slash
+         ? *last_slash : path_default_slash_c();
+   }
+   memcpy(out + dir_len, name, name_len + 1);
+
+   (*arena)->used += dir_len + name_len + 1;
+
+   return out;
+}
+
+static bool dir_list_worker_push(struct dir_list_worker *worker,
+      const char *path, int type)
+{
+   struct dir_list_entry *entry;
+
+   if (worker->size >= worker->cap)
+   {
+      size_t new_cap = worker->cap ? worker->cap * 2 : 256;
+      struct dir_list_entry *entries = (struct dir_list_entry*)
+         realloc(worker->entries, new_cap * sizeof(*entries));
+
+      if (!entries)
+         return false;
+
+      worker->entries = entries;
+      worker->cap     = new_cap;
+   }
+
+   entry       = &worker->entries[worker->size++];
+   entry->path = path;
+   entry->type = type;
+   entry->size = -1;
+
+   if (worker->walk->get_size && type != RARCH_DIRECTORY)
+      entry->size = path_get_size(path);
+
+   return true;
+}
+
+static bool dir_list_walk_enqueue(struct dir_list_walk *walk,
+      const char *dir)
+{
+   bool ret = true;
+
+#ifdef HAVE_THREADS
+   if (walk->lock)
+      slock_lock(walk->lock);
+#endif
+   if (walk->queue_size >= walk->queue_cap)
+   {
+      size_t new_cap     = walk->queue_cap ? walk->queue_cap * 2 : 64;
+      const char **queue = (const char**)realloc(
+            (void*)walk->queue, new_cap * sizeof(*queue));
+
+      if (queue)
+      {
+         walk->queue     = queue;
+         walk->queue_cap = new_cap;
+      }
+      else
+         ret             = false;
+   }
+
+   if (ret)
+   {
+      walk->queue[walk->queue_size++] = dir;
+#ifdef HAVE_THREADS
+      if (walk->cond)
+         scond_signal(walk->cond);
+#endif
+   }
+#ifdef HAVE_THREADS
+   if (walk->lock)
+      slock_unlock(walk->lock);
+#endif
+
+   return ret;
+}
+
+/* Stops every worker, the listing will be dropped */
+static void dir_list_walk_fail(struct dir_list_walk *walk)
+{
+#ifdef HAVE_THREADS
+   if (walk->lock)
+      slock_lock(walk->lock);
+#endif
+   walk->error = true;
+#ifdef HAVE_THREADS
+   if (walk->cond)
+      scond_broadcast(walk->cond);
+   if (walk->lock)
+      slock_unlock(walk->lock);
+#endif
+}
+
+/* Same filtering as dir_list_read(), but subdirectories
+ * are queued for any worker to pick up */
+static bool dir_list_walk_read(struct dir_list_worker *worker,
+      const char *dir)
+{
+   struct dir_list_walk *walk = worker->walk;
+   struct RDIR *entry         = retro_opendir_include_hidden(
+         dir, walk->include_hidden);
+
+   if (!entry || retro_dirent_error(entry))
+   {
+      if (entry)
+         retro_closedir(entry);
+      return false;
+   }
+
+   while (retro_readdir(entry))
+   {
+      int type;
+      char *file_path  = NULL;
+      const char *name = retro_dirent_get_name(entry);
+
+      if (!walk->include_hidden && *name == '.')
+         continue;
+      if (!strcmp(name, ".") || !strcmp(name, ".."))
+         continue;
+
+      if (retro_dirent_is_dir(entry, NULL))
+      {
+         if (!walk->recursive && !walk->include_dirs)
+            continue;
+
+         if (!(file_path = dir_list_arena_join(&worker->arena, dir, name)))
+            goto error;
+
+         if (walk->recursive && !dir_list_walk_enqueue(walk, file_path))
+            goto error;
+
+         if (!walk->include_dirs)
+            continue;
+         type = RARCH_DIRECTORY;
+      }
+      else
+      {
+         const char *file_ext = path_get_extension(name);
+
+         /* See dir_list_read() for why explicitly supported
+          * formats take precedence over archives */
+         if (dir_list_ext_set_has(&walk->ext_set, file_ext))
+            type = RARCH_PLAIN_FILE;
+         else
+         {
+            bool is_compressed_file = path_is_compressed_file(name);
+
+            type = is_compressed_file
+               ? RARCH_COMPRESSED_ARCHIVE : RARCH_FILETYPE_UNSET;
+
+            if (walk->ext_set.exts &&
+                  (!is_compressed_file || !walk->include_compressed))
+               continue;
+         }
+
+         if (!(file_path = dir_list_arena_join(&worker->arena, dir, name)))
+            goto error;
+      }
+
+      if (!dir_list_worker_push(worker, file_path, type))
+         goto error;
+   }
+
+   retro_closedir(entry);
+   return true;
+
+error:
+   retro_closedir(entry);
+   dir_list_walk_fail(walk);
+   return true;
+}
+
+#ifdef HAVE_THREADS
+static void dir_list_walk_worker(void *data)
+{
+   struct dir_list_worker *worker = (struct dir_list_worker*)data;
+   struct dir_list_walk   *walk   = worker->walk;
+
+   slock_lock(walk->lock);
+   for (;;)
+   {
+      const char *dir;
+
+      while (!walk->queue_size && walk->busy && !walk->error)
+         scond_wait(walk->cond, walk->lock);
+
+      if (!walk->queue_size || walk->error)
+         break;
+
+      dir = walk->queue[--walk->queue_size];
+      walk->busy++;
+      slock_unlock(walk->lock);
+
+      dir_list_walk_read(worker, dir);
+
+      slock_lock(walk->lock);
+      walk->busy--;
+      /* Wake everyone up once the queue has run dry */
+      if (!walk->busy && !walk->queue_size)
+         scond_broadcast(walk->cond);
+   }
+   scond_broadcast(walk->cond);
+   slock_unlock(walk->lock);
+}
+#endif
+
+/**
+ * dir_list_new_parallel:
+ * @dir                : directory path.
+ * @ext                : allowed extensions of file directory entries to include.
+ * @include_dirs       : include directories as part of the finished directory listing?
+ * @include_hidden     : include hidden files and directories as part of the finished directory listing?
+ * @include_compressed : include compressed files, even when not part of ext.
+ * @recursive          : list directory contents recursively
+ * @get_size           : fill in the size of each file.
+ * @num_threads        : number of directories read at once, 0 picks a default.
+ *
+ * Create a directory listing, reading subdirectories
+ * concurrently. Filters entries the same way as dir_list_new(),
+ * but the order of the entries is not defined.
+ *
+ * Returns: pointer to a directory listing on success,
+ * NULL in case of error. Has to be freed with dir_list_parallel_free().
+ **/
+struct dir_list *dir_list_new_parallel(const char *dir,
+      const char *ext, bool include_dirs,
+      bool include_hidden, bool include_compressed,
+      bool recursive, bool get_size, unsigned num_threads)
+{
+   unsigned i;
+   size_t total                    = 0;
+   struct dir_list_walk walk;
+   struct dir_list_worker *workers = NULL;
+   struct dir_list *list           = NULL;
+   struct dir_list_arena *arena    = NULL;
+
+   memset(&walk, 0, sizeof(walk));
+
+   walk.include_dirs       = include_dirs;
+   walk.include_hidden     = include_hidden;
+   walk.include_compressed = include_compressed;
+   walk.recursive          = recursive;
+   walk.get_size           = get_size;
+
+   if (!num_threads)
+      num_threads = DIR_LIST_DEFAULT_THREADS;
+   /* Nothing to share without subdirectories */
+   if (!recursive)
+      num_threads = 1;
+
+#ifdef HAVE_THREADS
+   if (num_threads > 1)
+   {
+      walk.lock = slock_new();
+      walk.cond = scond_new();
+   }
+#else
+   num_threads = 1;
+#endif
+
+   if (!dir_list_ext_set_init(&walk.ext_set, ext))
+      goto end;
+
+   if (!(workers = (struct dir_list_worker*)calloc(
+               num_threads, sizeof(*workers))))
+      goto end;
+
+   for (i = 0; i < num_threads; i++)
+      workers[i].walk = &walk;
+
+   /* The top directory is read up front, so that failing
+    * to open it can be reported like dir_list_new() does */
+   if (!dir_list_walk_read(&workers[0], dir) || walk.error)
+      goto end;
+
+#ifdef HAVE_THREADS
+   if (walk.lock && walk.cond && walk.queue_size)
+   {
+      for (i = 1; i < num_threads; i++)
+         workers[i].thread = sthread_create(
+               dir_list_walk_worker, &workers[i]);
+      /* This thread works too, if no worker could be
+       * started the walk simply runs here */
+      dir_list_walk_worker(&workers[0]);
+      for (i = 1; i < num_threads; i++)
+         if (workers[i].thread)
+            sthread_join(workers[i].thread);
+   }
+   else
+#endif
+   {
+      while (walk.queue_size && !walk.error)
+         dir_list_walk_read(&workers[0], walk.queue[--walk.queue_size]);
+   }
+
+   if (walk.error)
+      goto end;
+
+   for (i = 0; i < num_threads; i++)
+      total += workers[i].size;
+
+   if (!(list = (struct dir_list*)calloc(1, sizeof(*list))))
+      goto end;
+
+   if (total && !(list->entries = (struct dir_list_entry*)malloc(
+               total * sizeof(*list->entries))))
+   {
+      free(list);
+      list = NULL;
+      goto end;
+   }
+
+   for (i = 0; i < num_threads; i++)
+   {
+      if (workers[i].size)
+         memcpy(list->entries + list->size, workers[i].entries,
+               workers[i].size * sizeof(*list->entries));
+      list->size += workers[i].size;
+   }
+
+end:
+   /* On success the string blocks move to the list */
+   if (workers)
+   {
+      for (i = 0; i < num_threads; i++)
+      {
+         struct dir_list_arena *block = workers[i].arena;
+
+         while (block)
+         {
+            struct dir_list_arena *next = block->next;
+            block->next                 = arena;
+            arena                       = block;
+            block                       = next;
+         }
+
+         free(workers[i].entries);
+      }
+      free(workers);
+   }
+
+   if (list)
+      list->arena = arena;
+   else
+   {
+      while (arena)
+      {
+         struct dir_list_arena *next = arena->next;
+         free(arena);
+         arena = next;
+      }
+   }
+
+#ifdef HAVE_THREADS
+   if (walk.cond)
+      scond_free(walk.cond);
+   if (walk.lock)
+      slock_free(walk.lock);
+#endif
+   free((void*)walk.queue);
+   dir_list_ext_set_free(&walk.ext_set);
+
+   return list;
+}
+
+static int dir_list_entry_cmp_plain(const void *a_, const void *b_)
+{
+   const struct dir_list_entry *a = (const struct dir_list_entry*)a_;
+   const struct dir_list_entry *b = (const struct dir_list_entry*)b_;
+
+   return strcasecmp(a->path, b->path);
+}
+
+static int dir_list_entry_cmp_dir(const void *a_, const void *b_)
+{
+   const struct dir_list_entry *a = (const struct dir_list_entry*)a_;
+   const struct dir_list_entry *b = (const struct dir_list_entry*)b_;
+
+   /* Sort directories before files. */
+   if (a->type != b->type)
+      return b->type - a->type;
+   return strcasecmp(a->path, b->path);
+}
+
+/**
+ * dir_list_parallel_sort:
+ * @list      : pointer to the directory listing.
+ * @dir_first : move the directories in the listing to the top?
+ *
+ * Sorts a directory listing created by dir_list_new_parallel().
+ *
+ **/
+void dir_list_parallel_sort(struct dir_list *list, bool dir_first)
+{
+   if (list && list->size)
+      qsort(list->entries, list->size, sizeof(struct dir_list_entry),
+            dir_first ? dir_list_entry_cmp_dir : dir_list_entry_cmp_plain);
+}
+
+/**
+ * dir_list_parallel_free:
+ * @list : pointer to the directory listing
+ *
+ * Frees a directory listing created by dir_list_new_parallel().
+ *
+ **/
+void dir_list_parallel_free(struct dir_list *list)
+{
+   struct dir_list_arena *arena;
+
+   if (!list)
+      return;
+
+   arena = (struct dir_list_arena*)list->arena;
+
+   while (arena)
+   {
+      struct dir_list_arena *next = arena->next;
+      free(arena);
+      arena = next;
+   }
+
+   free(list->entries);
+   free(list);
+}
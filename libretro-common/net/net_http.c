@@ -67,11 +67,21 @@ struct http_t
    char part;
    char bodytype;
    bool error;
+   /* The server agreed to keep the connection open */
+   bool keep_alive;
+   /* Body is handed to write_cb instead of being kept in 'data' */
+   bool streaming;
 
    size_t pos;
    size_t len;
    size_t buflen;
+   /* Body bytes already handed to write_cb */
+   size_t written;
    char *data;
+   net_http_write_cb_t write_cb;
+   void *write_userdata;
+   char *host;
+   int port;
    struct http_socket_state_t sock_state;
 };
 
@@ -86,6 +96,7 @@ struct http_connection_t
    char *postdatacopy;
    char* useragentcopy;
    int port;
+   bool keep_alive;
    struct http_socket_state_t sock_state;
 };
 
@@ -226,27 +237,52 @@ static int net_http_new_socket(struct http_connection_t *conn)
    return fd;
 }
 
+/* Request headers are collected here and sent in one go,
+ * many small writes stall on Nagle's algorithm once the
+ * connection is reused for a second request */
+struct http_request_buf
+{
+   char *data;
+   size_t len;
+   size_t cap;
+};
+
 static void net_http_send_str(
-      struct http_socket_state_t *sock_state, bool *error, const char *text)
+      struct http_request_buf *request, bool *error, const char *text)
 {
    size_t text_size;
    if (*error)
       return;
    text_size = strlen(text);
-#ifdef HAVE_SSL
-   if (sock_state->ssl)
+   if (request->len + text_size > request->cap)
    {
-      if (!ssl_socket_send_all_blocking(
-               sock_state->ssl_ctx, text, text_size, true))
+      size_t new_cap = (request->cap ? request->cap : 256);
+      char  *new_data;
+      while (new_cap < request->len + text_size)
+         new_cap *= 2;
+      if (!(new_data = (char*)realloc(request->data, new_cap)))
+      {
          *error = true;
+         return;
+      }
+      request->data = new_data;
+      request->cap  = new_cap;
    }
-   else
+   memcpy(request->data + request->len, text, text_size);
+   request->len += text_size;
+}
+
+static bool net_http_send_buf(
+      struct http_socket_state_t *sock_state,
+      struct http_request_buf *request)
+{
+#ifdef HAVE_SSL
+   if (sock_state->ssl)
+      return ssl_socket_send_all_blocking(
+            sock_state->ssl_ctx, request->data, request->len, true);
 #endif
-   {
-      if (!socket_send_all_blocking(
-               sock_state->fd, text, text_size, true))
-         *error = true;
-   }
+   return socket_send_all_blocking(
+         sock_state->fd, request->data, request->len, true);
 }
 
 struct http_connection_t *net_http_connection_new(const char *url,
@@ -445,43 +481,53 @@ void net_http_connection_set_user_agent(struct http_connection_t* conn, const ch
    conn->useragentcopy = user_agent ? strdup(user_agent) : NULL;
 }
 
+void net_http_connection_set_keep_alive(struct http_connection_t *conn,
+      bool keep_alive)
+{
+   conn->keep_alive = keep_alive;
+}
+
 const char *net_http_connection_url(struct http_connection_t *conn)
 {
    return conn->urlcopy;
 }
 
-struct http_t *net_http_new(struct http_connection_t *conn)
+bool net_http_connection_matches(struct http_connection_t *conn,
+      struct http_t *state)
 {
-   bool error            = false;
-   int fd                = -1;
-   struct http_t *state  = NULL;
-
-   if (!conn)
-      goto error;
+   if (!conn || !state || !conn->domain || !state->host)
+      return false;
 
-   fd = net_http_new_socket(conn);
+   return conn->port == state->port
+      && conn->sock_state.ssl == state->sock_state.ssl
+      && string_is_equal_case_insensitive(conn->domain, state->host);
+}
 
-   if (fd < 0)
-      goto error;
+static bool net_http_send_request(struct http_connection_t *conn)
+{
+   struct http_request_buf request;
+   bool error = false;
 
-   error = false;
+   request.data = NULL;
+   request.len  = 0;
+   request.cap  = 0;
 
    /* This is a bit lazy, but it works. */
    if (conn->methodcopy)
    {
-      net_http_send_str(&conn->sock_state, &error, conn->methodcopy);
-      net_http_send_str(&conn->sock_state, &error, " /");
+      net_http_send_str(&request, &error, conn->methodcopy);
+      net_http_send_str(&request, &error, " /");
    }
    else
    {
-      net_http_send_str(&conn->sock_state, &error, "GET /");
+      net_http_send_str(&request, &error, "GET /");
    }
 
-   net_http_send_str(&conn->sock_state, &error, conn->location);
-   net_http_send_str(&conn->sock_state, &error, " HTTP/1.1\r\n");
+   net_http_send_str(&request, &error, conn->location);
+   net_http_send_str(&request, &error, " HTTP/1.1\r\n");
 
-   net_http_send_str(&conn->sock_state, &error, "Host: ");
-   net_http_send_str(&conn->sock_state, &error, conn->domain);
+   net_http_send_str(&request, &error, "Host: ");
+   net_http_send_str(&request, &error, conn->domain);
 
    if (!conn->port)
    {
@@ -490,17 +536,17 @@ struct http_t *net_http_new(struct http_connection_t *conn)
       portstr[0] = '\0';
 
       snprintf(portstr, sizeof(portstr), ":%i", conn->port);
-      net_http_send_str(&conn->sock_state, &error, portstr);
+      net_http_send_str(&request, &error, portstr);
    }
 
-   net_http_send_str(&conn->sock_state, &error, "\r\n");
+   net_http_send_str(&request, &error, "\r\n");
 
    /* This is not being set anywhere yet */
    if (conn->contenttypecopy)
    {
-      net_http_send_str(&conn->sock_state, &error, "Content-Type: ");
-      net_http_send_str(&conn->sock_state, &error, conn->contenttypecopy);
-      net_http_send_str(&conn->sock_state, &error, "\r\n");
+      net_http_send_str(&request, &error, "Content-Type: ");
+      net_http_send_str(&request, &error, conn->contenttypecopy);
+      net_http_send_str(&request, &error, "\r\n");
    }
 
    if (conn->methodcopy && (string_is_equal(conn->methodcopy, "POST")))
@@ -509,13 +555,16 @@ struct http_t *net_http_new(struct http_connection_t *conn)
       char *len_str        = NULL;
 
       if (!conn->postdatacopy)
-         goto error;
+      {
+         free(request.data);
+         return false;
+      }
 
       if (!conn->contenttypecopy)
-         net_http_send_str(&conn->sock_state, &error,
+         net_http_send_str(&request, &error,
                "Content-Type: application/x-www-form-urlencoded\r\n");
 
-      net_http_send_str(&conn->sock_state, &error, "Content-Length: ");
+      net_http_send_str(&request, &error, "Content-Length: ");
 
       post_len = strlen(conn->postdatacopy);
 #ifdef _WIN32
@@ -530,41 +579,85 @@ struct http_t *net_http_new(struct http_connection_t *conn)
 
       len_str[len] = '\0';
 
-      net_http_send_str(&conn->sock_state, &error, len_str);
-      net_http_send_str(&conn->sock_state, &error, "\r\n");
+      net_http_send_str(&request, &error, len_str);
+      net_http_send_str(&request, &error, "\r\n");
 
       free(len_str);
    }
 
-   net_http_send_str(&conn->sock_state, &error, "User-Agent: ");
+   net_http_send_str(&request, &error, "User-Agent: ");
    if (conn->useragentcopy)
-      net_http_send_str(&conn->sock_state, &error, conn->useragentcopy);
+      net_http_send_str(&request, &error, conn->useragentcopy);
    else
-      net_http_send_str(&conn->sock_state, &error, "libretro");
-   net_http_send_str(&conn->sock_state, &error, "\r\n");
+      net_http_send_str(&request, &error, "libretro");
+   net_http_send_str(&request, &error, "\r\n");
 
-   net_http_send_str(&conn->sock_state, &error, "Connection: close\r\n");
-   net_http_send_str(&conn->sock_state, &error, "\r\n");
+   if (conn->keep_alive)
+      net_http_send_str(&request, &error, "Connection: keep-alive\r\n");
+   else
+      net_http_send_str(&request, &error, "Connection: close\r\n");
+   net_http_send_str(&request, &error, "\r\n");
 
    if (conn->methodcopy && (string_is_equal(conn->methodcopy, "POST")))
-      net_http_send_str(&conn->sock_state, &error, conn->postdatacopy);
+      net_http_send_str(&request, &error, conn->postdatacopy);
 
-   if (error)
+   if (!error)
+      error = !net_http_send_buf(&conn->sock_state, &request);
+
+   free(request.data);
+   return !error;
+}
+
+/* Gets 'state' ready to parse the response to the request
+ * just sent over 'conn'. Any previous data buffer is owned
+ * by whoever called net_http_data(), so it is not freed. */
+static bool net_http_state_init(struct http_t *state,
+      struct http_connection_t *conn)
+{
+   state->sock_state     = conn->sock_state;
+   state->status         = -1;
+   state->part           = P_HEADER_TOP;
+   state->bodytype       = T_FULL;
+   state->error          = false;
+   state->keep_alive     = conn->keep_alive;
+   state->streaming      = false;
+   state->pos            = 0;
+   state->len            = 0;
+   state->written        = 0;
+   state->write_cb       = NULL;
+   state->write_userdata = NULL;
+   state->port           = conn->port;
+   state->buflen         = 512;
+   state->data           = (char*)malloc(state->buflen);
+
+   if (!state->host || !string_is_equal(state->host, conn->domain))
+   {
+      free(state->host);
+      state->host        = strdup(conn->domain);
+   }
+
+   return state->data && state->host;
+}
+
+struct http_t *net_http_new(struct http_connection_t *conn)
+{
+   int fd                = -1;
+   struct http_t *state  = NULL;
+
+   if (!conn)
       goto error;
 
-   state             = (struct http_t*)malloc(sizeof(struct http_t));
-   state->sock_state = conn->sock_state;
-   state->status     = -1;
-   state->data       = NULL;
-   state->part       = P_HEADER_TOP;
-   state->bodytype   = T_FULL;
-   state->error      = false;
-   state->pos        = 0;
-   state->len        = 0;
-   state->buflen     = 512;
-   state->data       = (char*)malloc(state->buflen);
-
-   if (!state->data)
+   fd = net_http_new_socket(conn);
+
+   if (fd < 0)
+      goto error;
+
+   if (!net_http_send_request(conn))
+      goto error;
+
+   state             = (struct http_t*)calloc(1, sizeof(struct http_t));
+
+   if (!state || !net_http_state_init(state, conn))
       goto error;
 
    return state;
@@ -592,10 +685,73 @@ error:
       socket_close(fd);
 #endif
    if (state)
+   {
+      free(state->data);
+      free(state->host);
       free(state);
+   }
+   return NULL;
+}
+
+struct http_t *net_http_new_reuse(struct http_connection_t *conn,
+      struct http_t *idle)
+{
+   if (!conn || !idle)
+      goto error;
+
+   if (!net_http_connection_matches(conn, idle) || !net_http_keep_alive(idle))
+      goto error;
+
+   conn->sock_state = idle->sock_state;
+
+   if (!net_http_send_request(conn) || !net_http_state_init(idle, conn))
+      goto error;
+
+   return idle;
+
+error:
+   if (conn)
+   {
+      conn->sock_state.fd      = -1;
+      conn->sock_state.ssl_ctx = NULL;
+   }
+   net_http_delete(idle);
    return NULL;
 }
 
+bool net_http_keep_alive(struct http_t *state)
+{
+   return state && state->keep_alive
+      && state->part == P_DONE && !state->error
+      && state->bodytype != T_FULL;
+}
+
+void net_http_set_write_cb(struct http_t *state,
+      net_http_write_cb_t write_cb, void *userdata)
+{
+   if (!state)
+      return;
+
+   state->write_cb       = write_cb;
+   state->write_userdata = userdata;
+}
+
+/* Hands the first 'len' bytes of the buffer to write_cb */
+static bool net_http_write_body(struct http_t *state, size_t len)
+{
+   if (!len)
+      return true;
+
+   if (!state->write_cb(state->write_userdata, state->data, len))
+      return false;
+
+   memmove(state->data, state->data + len, state->pos - len);
+   state->pos     -= len;
+   state->written += len;
+
+   return true;
+}
+
 int net_http_fd(struct http_t *state)
 {
    if (!state)
@@ -653,8 +809,19 @@ bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
 
          if (state->part == P_HEADER_TOP)
          {
+            /* A reused connection may still hold the
+             * CRLF that ended the previous chunked body */
+            if (state->data[0] == '\0')
+            {
+               memmove(state->data, lineend + 1, dataend-(lineend+1));
+               state->pos = (dataend-(lineend + 1));
+               continue;
+            }
             if (strncmp(state->data, "HTTP/1.", STRLEN_CONST("HTTP/1."))!=0)
                goto fail;
+            /* HTTP/1.0 closes unless told otherwise */
+            if (state->data[STRLEN_CONST("HTTP/1.")] == '0')
+               state->keep_alive = false;
             state->status = (int)strtoul(state->data 
                   + STRLEN_CONST("HTTP/1.1 "), NULL, 10);
             state->part   = P_HEADER;
@@ -670,6 +837,9 @@ bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
             }
             if (string_is_equal(state->data, "Transfer-Encoding: chunked"))
                state->bodytype = T_CHUNK;
+            if (string_is_equal_case_insensitive(state->data,
+                     "Connection: close"))
+               state->keep_alive = false;
 
             /* TODO: save headers somewhere */
             if (state->data[0]=='\0')
@@ -677,6 +847,9 @@ bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
                state->part = P_BODY;
                if (state->bodytype == T_CHUNK)
                   state->part = P_BODY_CHUNKLEN;
+               /* Error pages are never streamed */
+               state->streaming = state->write_cb
+                  && state->status >= 200 && state->status <= 299;
             }
          }
 
@@ -719,7 +892,8 @@ bool net_http_update(struct http_t *state, size_t* progress, size_t* total)
             if (state->bodytype == T_FULL)
             {
                state->part = P_DONE;
-               state->data = (char*)realloc(state->data, state->len);
+               if (!state->streaming)
+                  state->data = (char*)realloc(state->data, state->len);
             }
             else
                goto fail;
@@ -770,9 +944,14 @@ parse_again:
                   state->part = P_BODY;
                   if (state->len == 0)
                   {
+                     /* Only the CRLF ending the body may follow,
+                      * anything else (trailers) rules out reuse */
+                     if (newlen > 2 || memcmp(end, "\r\n", newlen))
+                        state->keep_alive = false;
                      state->part = P_DONE;
                      state->len  = state->pos;
-                     state->data = (char*)realloc(state->data, state->len);
+                     if (!state->streaming)
+                        state->data = (char*)realloc(state->data, state->len);
                   }
                   goto parse_again;
                }
@@ -799,18 +978,48 @@ parse_again:
       {
          state->pos += newlen;
 
-         if (state->pos == state->len)
+         if (state->streaming && !net_http_write_body(state, state->pos))
+            goto fail;
+
+         if (state->written + state->pos == state->len)
          {
             state->part = P_DONE;
-            state->data = (char*)realloc(state->data, state->len);
+            if (!state->streaming)
+               state->data = (char*)realloc(state->data, state->len);
          }
-         if (state->pos > state->len)
+         if (state->written + state->pos > state->len)
             goto fail;
       }
+
+      /* With chunked bodies, everything before 'len' is
+       * body while waiting for the next chunk length, and
+       * everything before 'pos' otherwise */
+      if (state->streaming && state->bodytype == T_CHUNK)
+      {
+         if (state->part == P_BODY_CHUNKLEN)
+         {
+            size_t body_len = state->len;
+
+            if (!net_http_write_body(state, body_len))
+               goto fail;
+            state->len     -= body_len;
+         }
+         else if (state->part == P_BODY)
+         {
+            if (!net_http_write_body(state, state->pos))
+               goto fail;
+         }
+         else if (state->part == P_DONE)
+         {
+            if (!net_http_write_body(state, state->len))
+               goto fail;
+            state->len      = state->written;
+         }
+      }
    }
 
    if (progress)
-      *progress = state->pos;
+      *progress = state->written + state->pos;
 
    if (total)
    {
@@ -874,6 +1083,7 @@ void net_http_delete(struct http_t *state)
       }
 #endif
    }
+   free(state->host);
    free(state);
 }
 
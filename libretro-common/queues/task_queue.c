@@ -23,6 +23,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 
 #include <queues/task_queue.h>
 
@@ -287,36 +288,218 @@ static struct retro_task_impl impl_regular = {
 };
 
 #ifdef HAVE_THREADS
+/* Every TASK_QUEUE_STARVATION_LIMIT picks, a worker
+ * searches its deques lowest priority first so that
+ * long-running high priority tasks cannot starve
+ * the others. */
+#define TASK_QUEUE_STARVATION_LIMIT 8
+
+typedef struct
+{
+   retro_task_t **elems;
+   size_t capacity;
+   size_t head;
+   size_t count;
+} task_deque_t;
+
+typedef struct
+{
+   sthread_t *thread;
+   slock_t *lock; /* protects deques */
+   task_deque_t deques[TASK_PRIORITY_LAST];
+   unsigned id;
+   unsigned picks;
+} task_worker_t;
+
+static const enum task_priority task_priority_order[TASK_PRIORITY_LAST] = {
+   TASK_PRIORITY_HIGH,
+   TASK_PRIORITY_NORMAL,
+   TASK_PRIORITY_LOW
+};
+
 static slock_t *running_lock    = NULL;
 static slock_t *finished_lock   = NULL;
 static slock_t *property_lock   = NULL;
 static slock_t *queue_lock      = NULL;
+static slock_t *sched_lock      = NULL;
 static scond_t *worker_cond     = NULL;
-static sthread_t *worker_thread = NULL;
-static bool worker_continue     = true; /* use running_lock when touching it */
+static task_worker_t *workers   = NULL;
+static unsigned workers_active  = 0;
+static unsigned worker_next     = 0; /* use sched_lock when touching it */
+static size_t tasks_queued      = 0; /* use sched_lock when touching it */
+static bool worker_continue     = true; /* use sched_lock when touching it */
+#endif
+
+static unsigned task_worker_count = 1;
+
+#ifdef HAVE_THREADS
+static bool task_deque_push_back(task_deque_t *dq, retro_task_t *task)
+{
+   if (dq->count == dq->capacity)
+   {
+      size_t i;
+      size_t new_capacity   = dq->capacity ? dq->capacity * 2 : 16;
+      retro_task_t **elems  = (retro_task_t**)
+         malloc(new_capacity * sizeof(*elems));
+
+      if (!elems)
+         return false;
+
+      for (i = 0; i < dq->count; i++)
+         elems[i] = dq->elems[(dq->head + i) % dq->capacity];
+
+      free(dq->elems);
+      dq->elems    = elems;
+      dq->capacity = new_capacity;
+      dq->head     = 0;
+   }
+
+   dq->elems[(dq->head + dq->count) % dq->capacity] = task;
+   dq->count++;
+
+   return true;
+}
+
+static retro_task_t *task_deque_pop_front(task_deque_t *dq)
+{
+   retro_task_t *task = NULL;
+
+   if (dq->count == 0)
+      return NULL;
+
+   task     = dq->elems[dq->head];
+   dq->head = (dq->head + 1) % dq->capacity;
+   dq->count--;
+
+   return task;
+}
+
+static retro_task_t *task_deque_pop_back(task_deque_t *dq)
+{
+   if (dq->count == 0)
+      return NULL;
+
+   dq->count--;
+
+   return dq->elems[(dq->head + dq->count) % dq->capacity];
+}
+
+static void task_deque_free(task_deque_t *dq)
+{
+   free(dq->elems);
+   dq->elems    = NULL;
+   dq->capacity = 0;
+   dq->head     = 0;
+   dq->count    = 0;
+}
+
+static enum task_priority task_get_priority(retro_task_t *task)
+{
+   if ((unsigned)task->priority >= TASK_PRIORITY_LAST)
+      return TASK_PRIORITY_NORMAL;
+   return task->priority;
+}
+
+/* Queues a task on the deque of worker.
+ * If worker is NULL, workers are picked
+ * round-robin.
+ *
+ * Returns false if the deque could not grow,
+ * the task is not queued then. */
+static bool task_worker_schedule(task_worker_t *worker, retro_task_t *task)
+{
+   task_deque_t *dq = NULL;
+
+   if (!worker)
+   {
+      slock_lock(sched_lock);
+      worker      = &workers[worker_next];
+      worker_next = (worker_next + 1) % workers_active;
+      slock_unlock(sched_lock);
+   }
+
+   dq = &worker->deques[task_get_priority(task)];
+
+   slock_lock(worker->lock);
+   if (!task_deque_push_back(dq, task))
+   {
+      slock_unlock(worker->lock);
+      return false;
+   }
+   slock_unlock(worker->lock);
+
+   slock_lock(sched_lock);
+   tasks_queued++;
+   scond_signal(worker_cond);
+   slock_unlock(sched_lock);
+
+   return true;
+}
+
+/* Takes the oldest task of the given priority from
+ * the worker's own deque, or failing that steals the
+ * newest one from another worker. */
+static retro_task_t *task_worker_take(task_worker_t *worker,
+      enum task_priority prio)
+{
+   unsigned i;
+   retro_task_t *task = NULL;
+
+   slock_lock(worker->lock);
+   task = task_deque_pop_front(&worker->deques[prio]);
+   slock_unlock(worker->lock);
+
+   for (i = 1; !task && i < workers_active; i++)
+   {
+      task_worker_t *victim = &workers[(worker->id + i) % workers_active];
+
+      slock_lock(victim->lock);
+      task = task_deque_pop_back(&victim->deques[prio]);
+      slock_unlock(victim->lock);
+   }
+
+   return task;
+}
+
+static retro_task_t *task_worker_next(task_worker_t *worker)
+{
+   unsigned i;
+   retro_task_t *task = NULL;
+   bool lowest_first  = (++worker->picks % TASK_QUEUE_STARVATION_LIMIT) == 0;
+
+   for (i = 0; !task && i < TASK_PRIORITY_LAST; i++)
+   {
+      unsigned idx = lowest_first ? (TASK_PRIORITY_LAST - 1 - i) : i;
+      task         = task_worker_take(worker, task_priority_order[idx]);
+   }
+
+   if (task)
+   {
+      slock_lock(sched_lock);
+      tasks_queued--;
+      slock_unlock(sched_lock);
+   }
+
+   return task;
+}
 
 static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
 {
    retro_task_t     *t = NULL;
-   retro_task_t *front = NULL;
-
-   slock_lock(queue_lock);
-   front = queue->front;
-   slock_unlock(queue_lock);
 
    /* Remove first element if needed */
-   if (task == front)
+   if (task == queue->front)
    {
-      slock_lock(queue_lock);
       queue->front = task->next;
-      slock_unlock(queue_lock);
+      if (queue->back == task)
+         queue->back = NULL;
       task->next   = NULL;
 
       return;
    }
 
    /* Parse queue */
-   t = front;
+   t = queue->front;
 
    while (t && t->next)
    {
@@ -324,6 +507,8 @@ static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
       if (t->next == task)
       {
          t->next    = task->next;
+         if (queue->back == task)
+            queue->back = t;
          task->next = NULL;
          break;
       }
@@ -333,14 +518,39 @@ static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
    }
 }
 
+/* Finishes a task that could not be queued
+ * with an error. running_lock must be held. */
+static void task_worker_fail(retro_task_t *task)
+{
+   slock_lock(queue_lock);
+   task_queue_remove(&tasks_running, task);
+   slock_unlock(queue_lock);
+
+   slock_lock(property_lock);
+   if (!task->error)
+      task->error  = strdup("Out of memory");
+   task->finished  = true;
+   slock_unlock(property_lock);
+
+   slock_lock(finished_lock);
+   task_queue_put(&tasks_finished, task);
+   slock_unlock(finished_lock);
+}
+
 static void retro_task_threaded_push_running(retro_task_t *task)
 {
    slock_lock(running_lock);
    slock_lock(queue_lock);
    task_queue_put(&tasks_running, task);
-   scond_signal(worker_cond);
    slock_unlock(queue_lock);
    slock_unlock(running_lock);
+
+   if (!task_worker_schedule(NULL, task))
+   {
+      slock_lock(running_lock);
+      task_worker_fail(task);
+      slock_unlock(running_lock);
+   }
 }
 
 static void retro_task_threaded_cancel(void *task)
@@ -437,47 +647,48 @@ static void retro_task_threaded_retrieve(task_retriever_data_t *data)
 
 static void threaded_worker(void *userdata)
 {
-   (void)userdata;
+   task_worker_t *worker = (task_worker_t*)userdata;
 
    for (;;)
    {
       retro_task_t *task  = NULL;
       bool finished = false;
 
-      if (!worker_continue)
-         break; /* should we keep running until all tasks finished? */
+      slock_lock(sched_lock);
+      while (worker_continue && tasks_queued == 0)
+         scond_wait(worker_cond, sched_lock);
 
-      slock_lock(running_lock);
-
-      /* Get first task to run */
-      task = tasks_running.front;
-      if (task == NULL)
+      if (!worker_continue)
       {
-         scond_wait(worker_cond, running_lock);
-         slock_unlock(running_lock);
-         continue;
+         slock_unlock(sched_lock);
+         break; /* should we keep running until all tasks finished? */
       }
+      slock_unlock(sched_lock);
 
-      slock_unlock(running_lock);
+      /* Another worker may have taken it first */
+      if (!(task = task_worker_next(worker)))
+         continue;
 
-      task->handler(task);
+      /* Re-add unfinished tasks to this worker's deque,
+       * if it can't grow this worker keeps running it */
+      do
+      {
+         task->handler(task);
 
-      slock_lock(property_lock);
-      finished = task->finished;
-      slock_unlock(property_lock);
-
-      slock_lock(running_lock);
-      task_queue_remove(&tasks_running, task);
-      slock_unlock(running_lock);
+         slock_lock(property_lock);
+         finished = task->finished;
+         slock_unlock(property_lock);
+      } while (!finished && !task_worker_schedule(worker, task));
 
       /* Update queue */
-      if (!finished)
-      {
-         /* Re-add task to running queue */
-         retro_task_threaded_push_running(task);
-      }
-      else
+      if (finished)
       {
+         slock_lock(running_lock);
+         slock_lock(queue_lock);
+         task_queue_remove(&tasks_running, task);
+         slock_unlock(queue_lock);
+         slock_unlock(running_lock);
+
          /* Add task to finished queue */
          slock_lock(finished_lock);
          task_queue_put(&tasks_finished, task);
@@ -488,40 +699,86 @@ static void threaded_worker(void *userdata)
 
 static void retro_task_threaded_init(void)
 {
-   running_lock  = slock_new();
-   finished_lock = slock_new();
-   property_lock = slock_new();
-   queue_lock    = slock_new();
-   worker_cond   = scond_new();
+   unsigned i;
+   retro_task_t *task = NULL;
+   retro_task_t *next = NULL;
+
+   running_lock   = slock_new();
+   finished_lock  = slock_new();
+   property_lock  = slock_new();
+   queue_lock     = slock_new();
+   sched_lock     = slock_new();
+   worker_cond    = scond_new();
+
+   workers_active = task_worker_count;
+   worker_next    = 0;
+   tasks_queued   = 0;
+   workers        = (task_worker_t*)
+      calloc(workers_active, sizeof(*workers));
+
+   for (i = 0; i < workers_active; i++)
+   {
+      workers[i].id   = i;
+      workers[i].lock = slock_new();
+   }
 
+   /* Tasks left on hold by a previous
+    * implementation are spread over the workers */
    slock_lock(running_lock);
-   worker_continue = true;
+   for (task = tasks_running.front; task; task = next)
+   {
+      next = task->next;
+      if (!task_worker_schedule(NULL, task))
+         task_worker_fail(task);
+   }
    slock_unlock(running_lock);
 
-   worker_thread = sthread_create(threaded_worker, NULL);
+   slock_lock(sched_lock);
+   worker_continue = true;
+   slock_unlock(sched_lock);
+
+   for (i = 0; i < workers_active; i++)
+      workers[i].thread = sthread_create(threaded_worker, &workers[i]);
 }
 
 static void retro_task_threaded_deinit(void)
 {
-   slock_lock(running_lock);
+   unsigned i;
+
+   slock_lock(sched_lock);
    worker_continue = false;
-   scond_signal(worker_cond);
-   slock_unlock(running_lock);
+   scond_broadcast(worker_cond);
+   slock_unlock(sched_lock);
+
+   for (i = 0; i < workers_active; i++)
+      sthread_join(workers[i].thread);
+
+   for (i = 0; i < workers_active; i++)
+   {
+      unsigned j;
+      for (j = 0; j < TASK_PRIORITY_LAST; j++)
+         task_deque_free(&workers[i].deques[j]);
+      slock_free(workers[i].lock);
+   }
 
-   sthread_join(worker_thread);
+   free(workers);
 
    scond_free(worker_cond);
    slock_free(running_lock);
    slock_free(finished_lock);
    slock_free(property_lock);
    slock_free(queue_lock);
-
-   worker_thread = NULL;
-   worker_cond   = NULL;
-   running_lock  = NULL;
-   finished_lock = NULL;
-   property_lock = NULL;
-   queue_lock = NULL;
+   slock_free(sched_lock);
+
+   workers        = NULL;
+   workers_active = 0;
+   tasks_queued   = 0;
+   worker_cond    = NULL;
+   running_lock   = NULL;
+   finished_lock  = NULL;
+   property_lock  = NULL;
+   queue_lock     = NULL;
+   sched_lock     = NULL;
 }
 
 static struct retro_task_impl impl_threaded = {
@@ -582,6 +839,21 @@ bool task_queue_is_threaded(void)
    return task_threaded_enable;
 }
 
+void task_queue_set_worker_count(unsigned count)
+{
+   if (count < 1)
+      count = 1;
+   else if (count > TASK_QUEUE_MAX_WORKERS)
+      count = TASK_QUEUE_MAX_WORKERS;
+
+   task_worker_count = count;
+}
+
+unsigned task_queue_get_worker_count(void)
+{
+   return task_worker_count;
+}
+
 bool task_queue_find(task_finder_data_t *find_data)
 {
    if (!impl_current->find(find_data->func, find_data->userdata))
@@ -600,7 +872,8 @@ void task_queue_check(void)
    bool current_threaded = (impl_current == &impl_threaded);
    bool want_threaded    = task_queue_is_threaded();
 
-   if (want_threaded != current_threaded)
+   if (want_threaded != current_threaded ||
+         (current_threaded && workers_active != task_worker_count))
       task_queue_deinit();
 
    if (!impl_current)
@@ -0,0 +1,91 @@
+/* Loads a config file the way the frontend does on
+ * startup and on save: parse it, look up every key,
+ * then set every key again.
+ *
+ * Usage: config_file_bench <retroarch.cfg> [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <file/config_file.h>
+#include <features/features_cpu.h>
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   retro_time_t t_load    = 0;
+   retro_time_t t_get     = 0;
+   retro_time_t t_set     = 0;
+   unsigned iterations    = 100;
+   size_t num_keys        = 0;
+
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s <retroarch.cfg> [iterations]\n", argv[0]);
+      return 1;
+   }
+
+   if (argc > 2)
+      iterations = (unsigned)strtoul(argv[2], NULL, 10);
+
+   for (i = 0; i < iterations; i++)
+   {
+      size_t j;
+      char buf[4096];
+      char **keys                    = NULL;
+      struct config_file_entry entry = {0};
+      retro_time_t t_start           = cpu_features_get_time_usec();
+      config_file_t *conf            = config_file_new(argv[1]);
+
+      if (!conf)
+      {
+         fprintf(stderr, "Could not open %s\n", argv[1]);
+         return 1;
+      }
+
+      t_load  += cpu_features_get_time_usec() - t_start;
+
+      /* Copy the keys, so that the lookups below
+       * are not helped by walking the list */
+      num_keys = 0;
+      if (config_get_entry_list_head(conf, &entry))
+      {
+         do
+         {
+            char **tmp = (char**)realloc(keys, (num_keys + 1) * sizeof(*keys));
+            if (!tmp)
+               break;
+            keys             = tmp;
+            keys[num_keys++] = strdup(entry.key);
+         } while (config_get_entry_list_next(&entry));
+      }
+
+      t_start = cpu_features_get_time_usec();
+      for (j = 0; j < num_keys; j++)
+         config_get_array(conf, keys[j], buf, sizeof(buf));
+      t_get  += cpu_features_get_time_usec() - t_start;
+
+      t_start = cpu_features_get_time_usec();
+      for (j = 0; j < num_keys; j++)
+         config_set_string(conf, keys[j], "bench");
+      t_set  += cpu_features_get_time_usec() - t_start;
+
+      for (j = 0; j < num_keys; j++)
+         free(keys[j]);
+      free(keys);
+
+      config_file_free(conf);
+   }
+
+   if (iterations)
+   {
+      printf("%u keys, %u iterations\n", (unsigned)num_keys, iterations);
+      printf("load: %8.1f us\n", (double)t_load / iterations);
+      printf("get:  %8.1f us\n", (double)t_get  / iterations);
+      printf("set:  %8.1f us\n", (double)t_set  / iterations);
+   }
+
+   return 0;
+}
@@ -0,0 +1,129 @@
+/* Checks that dir_list_new_parallel() lists the same paths,
+ * with the same types, as dir_list_new() for a range of
+ * extension filters and flags, then times both.
+ *
+ * Without a directory, a small tree with hidden files, nested
+ * directories, archives and mixed case extensions is created
+ * under "dir_list_check.tmp" and listed instead.
+ *
+ * Usage: dir_list_check [directory]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_miscellaneous.h>
+#include <file/file_path.h>
+#include <features/features_cpu.h>
+#include <lists/dir_list.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#define TREE_DIR "dir_list_check.tmp"
+
+static const char *tree_files[] = {
+   "a.bin", "B.CUE", "c.zip", "d.txt", "noext", ".hidden.bin",
+   "sub/e.bin", "sub/f.7z", "sub/.g.cue", "sub/deep/h.BIN",
+   "sub/deep/i.iso", ".hiddendir/j.bin", "empty/",
+};
+
+static const char *exts[] = {
+   NULL, "bin", "bin|cue", ".bin|CUE", "zip|bin", "iso|.7z|txt", ".",
+};
+
+static bool make_tree(void)
+{
+   size_t i;
+
+   for (i = 0; i < sizeof(tree_files) / sizeof(tree_files[0]); i++)
+   {
+      char path[PATH_MAX_LENGTH];
+      char dir[PATH_MAX_LENGTH];
+
+      fill_pathname_join(path, TREE_DIR, tree_files[i], sizeof(path));
+      fill_pathname_basedir(dir, path, sizeof(dir));
+
+      if (!path_is_directory(dir) && !path_mkdir(dir))
+         return false;
+
+      if (path[strlen(path) - 1] != '/'
+            && !filestream_write_file(path, "x", 1))
+         return false;
+   }
+
+   return true;
+}
+
+static bool check(const char *dir, const char *ext, bool include_dirs,
+      bool include_hidden, bool include_compressed, bool recursive)
+{
+   size_t i;
+   retro_time_t t_serial, t_parallel;
+   bool ok                   = true;
+   retro_time_t t_start      = cpu_features_get_time_usec();
+   struct string_list *a     = dir_list_new(dir, ext, include_dirs,
+         include_hidden, include_compressed, recursive);
+   struct dir_list *b        = NULL;
+
+   t_serial   = cpu_features_get_time_usec() - t_start;
+   t_start    = cpu_features_get_time_usec();
+   b          = dir_list_new_parallel(dir, ext, include_dirs,
+         include_hidden, include_compressed, recursive, false, 0);
+   t_parallel = cpu_features_get_time_usec() - t_start;
+
+   if (!a || !b)
+      ok = !a && !b;
+   else
+   {
+      dir_list_sort(a, true);
+      dir_list_parallel_sort(b, true);
+
+      ok = a->size == b->size;
+
+      for (i = 0; ok && i < a->size; i++)
+         ok =  string_is_equal(a->elems[i].data, b->entries[i].path)
+            && a->elems[i].attr.i == b->entries[i].type;
+   }
+
+   printf("%-4s %-12s dirs %d hidden %d compressed %d recursive %d: "
+         "%5u entries, serial %6.1f ms, parallel %6.1f ms\n",
+         ok ? "ok" : "FAIL", ext ? ext : "(any)",
+         include_dirs, include_hidden, include_compressed, recursive,
+         a ? (unsigned)a->size : 0,
+         t_serial / 1000.0, t_parallel / 1000.0);
+
+   if (a)
+      dir_list_free(a);
+   if (b)
+      dir_list_parallel_free(b);
+
+   return ok;
+}
+
+int main(int argc, char *argv[])
+{
+   size_t i;
+   unsigned flags;
+   unsigned failed = 0;
+   const char *dir = argc > 1 ? argv[1] : TREE_DIR;
+
+   if (argc <= 1 && !make_tree())
+   {
+      fprintf(stderr, "Failed to create \"%s\".\n", TREE_DIR);
+      return 1;
+   }
+
+   for (i = 0; i < sizeof(exts) / sizeof(exts[0]); i++)
+      for (flags = 0; flags < 16; flags++)
+         if (!check(dir, exts[i], flags & 1, flags & 2, flags & 4, flags & 8))
+            failed++;
+
+   /* A directory that doesn't exist fails both ways */
+   if (!check(TREE_DIR "/missing", NULL, false, false, false, true))
+      failed++;
+
+   printf("%u mismatches\n", failed);
+
+   return failed ? 1 : 0;
+}
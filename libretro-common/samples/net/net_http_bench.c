@@ -0,0 +1,299 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (net_http_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/* Fetches thumbnail sized files from a loopback server, once
+ * with a new connection per file and once over one keep-alive
+ * connection, then downloads a large file in memory and streamed
+ * to disk. Peak RSS is printed after each pass. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include <net/net_http.h>
+#include <net/net_compat.h>
+
+#define THUMB_SIZE  (48 * 1024)
+#define THUMB_COUNT 500
+#define CORE_SIZE   (64 * 1024 * 1024)
+
+static int server_port;
+static char *payload;
+
+static double now_sec(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static long peak_rss_kb(void)
+{
+   struct rusage ru;
+   getrusage(RUSAGE_SELF, &ru);
+   return ru.ru_maxrss;
+}
+
+static bool write_all(int fd, const char *buf, size_t len)
+{
+   while (len)
+   {
+      ssize_t ret = send(fd, buf, len, MSG_NOSIGNAL);
+      if (ret <= 0)
+         return false;
+      buf += ret;
+      len -= ret;
+   }
+   return true;
+}
+
+static void *client_thread(void *data)
+{
+   char req[4096];
+   size_t have = 0;
+   int fd      = (int)(intptr_t)data;
+
+   for (;;)
+   {
+      char hdr[256];
+      char *end;
+      size_t body;
+      bool close_conn;
+      ssize_t ret;
+
+      while (!(end = strstr(req, "\r\n\r\n")))
+      {
+         if (have >= sizeof(req) - 1)
+            goto done;
+         ret = recv(fd, req + have, sizeof(req) - 1 - have, 0);
+         if (ret <= 0)
+            goto done;
+         have      += ret;
+         req[have]  = '\0';
+      }
+
+      body       = strstr(req, "GET /core") ? CORE_SIZE : THUMB_SIZE;
+      close_conn = strstr(req, "Connection: close") != NULL;
+
+      snprintf(hdr, sizeof(hdr),
+            "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n"
+            "Connection: %s\r\n\r\n",
+            (unsigned)body, close_conn ? "close" : "keep-alive");
+
+      if (!write_all(fd, hdr, strlen(hdr)) || !write_all(fd, payload, body))
+         goto done;
+
+      end  += 4;
+      have -= end - req;
+      memmove(req, end, have + 1);
+
+      if (close_conn)
+         break;
+   }
+
+done:
+   close(fd);
+   return NULL;
+}
+
+static void *server_thread(void *data)
+{
+   int lfd = (int)(intptr_t)data;
+
+   for (;;)
+   {
+      pthread_t thread;
+      int one = 1;
+      int fd  = accept(lfd, NULL, NULL);
+      if (fd < 0)
+         break;
+      setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      pthread_create(&thread, NULL, client_thread, (void*)(intptr_t)fd);
+      pthread_detach(thread);
+   }
+
+   return NULL;
+}
+
+static bool start_server(void)
+{
+   pthread_t thread;
+   struct sockaddr_in addr;
+   socklen_t len = sizeof(addr);
+   int one       = 1;
+   int lfd       = socket(AF_INET, SOCK_STREAM, 0);
+
+   if (lfd < 0)
+      return false;
+
+   setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   if (     bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+         || listen(lfd, 16) < 0
+         || getsockname(lfd, (struct sockaddr*)&addr, &len) < 0)
+      return false;
+
+   server_port = ntohs(addr.sin_port);
+   return pthread_create(&thread, NULL, server_thread,
+         (void*)(intptr_t)lfd) == 0;
+}
+
+static bool write_file_cb(void *userdata, const void *data, size_t len)
+{
+   return fwrite(data, 1, len, (FILE*)userdata) == len;
+}
+
+/* Runs one GET, reusing 'idle' when given. Returns the
+ * finished handle, which the caller owns. */
+static struct http_t *fetch(const char *path, struct http_t *idle,
+      FILE *sink, size_t *len)
+{
+   char url[256];
+   uint8_t *data;
+   struct http_t *http;
+   struct http_connection_t *conn;
+
+   snprintf(url, sizeof(url), "http://127.0.0.1:%d%s", server_port, path);
+
+   conn = net_http_connection_new(url, "GET", NULL);
+   net_http_connection_set_keep_alive(conn, idle != NULL || !sink);
+   while (!net_http_connection_iterate(conn)) {}
+   net_http_connection_done(conn);
+
+   http = idle ? net_http_new_reuse(conn, idle) : net_http_new(conn);
+   if (!http)
+   {
+      net_http_connection_free(conn);
+      return NULL;
+   }
+
+   if (sink)
+      net_http_set_write_cb(http, write_file_cb, sink);
+
+   while (!net_http_update(http, NULL, NULL)) {}
+
+   data = net_http_data(http, len, false);
+   free(data);
+   net_http_connection_free(conn);
+
+   if (net_http_error(http))
+   {
+      net_http_delete(http);
+      return NULL;
+   }
+
+   return http;
+}
+
+static void bench_thumbnails(bool keep_alive)
+{
+   unsigned i;
+   size_t len;
+   struct http_t *idle = NULL;
+   double start        = now_sec();
+
+   for (i = 0; i < THUMB_COUNT; i++)
+   {
+      struct http_t *http = fetch("/thumb", idle, NULL, &len);
+
+      if (!http || len != THUMB_SIZE)
+      {
+         printf("thumbnail %u failed\n", i);
+         return;
+      }
+
+      idle = NULL;
+      if (keep_alive && net_http_keep_alive(http))
+         idle = http;
+      else
+         net_http_delete(http);
+   }
+
+   if (idle)
+      net_http_delete(idle);
+
+   printf("thumbnails, %-10s: %8.0f files/s, peak RSS %ld KiB\n",
+         keep_alive ? "keep-alive" : "close",
+         THUMB_COUNT / (now_sec() - start), peak_rss_kb());
+}
+
+static void bench_core(bool stream)
+{
+   size_t len;
+   struct http_t *http;
+   FILE *sink   = NULL;
+   double start = now_sec();
+
+   if (stream && !(sink = tmpfile()))
+      return;
+
+   http = fetch("/core", NULL, sink, &len);
+
+   if (!http || len != CORE_SIZE)
+      printf("core download failed\n");
+   else
+      printf("core,       %-10s: %8.1f MiB/s,   peak RSS %ld KiB\n",
+            stream ? "streamed" : "in memory",
+            CORE_SIZE / (1024.0 * 1024.0) / (now_sec() - start),
+            peak_rss_kb());
+
+   if (http)
+      net_http_delete(http);
+   if (sink)
+      fclose(sink);
+}
+
+int main(int argc, char *argv[])
+{
+   if (!network_init())
+      return 1;
+
+   payload = (char*)malloc(CORE_SIZE);
+   memset(payload, 'x', CORE_SIZE);
+
+   if (!start_server())
+   {
+      printf("could not start loopback server\n");
+      return 1;
+   }
+
+   bench_thumbnails(false);
+   bench_thumbnails(true);
+
+   /* Streamed first, ru_maxrss only ever grows */
+   bench_core(true);
+   bench_core(false);
+
+   return 0;
+}
@@ -32,6 +32,8 @@
 #include <sys/stat.h>
 #include <stdlib.h>
 
+#include <boolean.h>
+#include <memmap.h>
 #include <streams/file_stream.h>
 #include <retro_endianness.h>
 #include <string/stdstring.h>
@@ -46,12 +48,33 @@
 
 #define MAGIC_NUMBER "RARCHDB"
 
+#if defined(HAVE_MMAN) && !defined(_WIN32)
+#include <fcntl.h>
+#define LIBRETRODB_HAVE_MMAP
+#endif
+
 struct node_iter_ctx
 {
 	libretrodb_t *db;
 	libretrodb_index_t *idx;
 };
 
+struct libretrodb_index
+{
+	char name[50];
+	uint64_t key_size;
+	uint64_t next;
+};
+
+/* Index table of a mapped database, pointing
+ * straight into the mapping */
+typedef struct libretrodb_resident_index
+{
+   libretrodb_index_t header;
+   const uint8_t *entries;
+   uint64_t count;
+} libretrodb_resident_index_t;
+
 struct libretrodb
 {
 	RFILE *fd;
@@ -59,13 +82,12 @@ struct libretrodb
 	uint64_t count;
 	uint64_t first_index_offset;
    char *path;
-};
-
-struct libretrodb_index
-{
-	char name[50];
-	uint64_t key_size;
-	uint64_t next;
+   /* Only set by libretrodb_open_mapped() */
+   const uint8_t *map;
+   uint64_t map_size;
+   bool map_is_mmap;
+   libretrodb_resident_index_t *indices;
+   unsigned num_indices;
 };
 
 typedef struct libretrodb_metadata
@@ -86,6 +108,7 @@ struct libretrodb_cursor
 	int eof;
 	libretrodb_query_t *query;
 	libretrodb_t *db;
+   uint64_t offset; /* next item, for mapped databases */
 };
 
 static struct rmsgpack_dom_value sentinal;
@@ -173,8 +196,7 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    if ((rv = rmsgpack_dom_write(fd, &sentinal)) < 0)
       goto clean;
 
-   header.metadata_offset = swap_if_little64(filestream_seek(
-            fd, 0, RETRO_VFS_SEEK_POSITION_CURRENT));
+   header.metadata_offset = swap_if_little64(filestream_tell(fd));
    md.count = item_count;
    libretrodb_write_metadata(fd, &md);
    filestream_seek(fd, root, RETRO_VFS_SEEK_POSITION_START);
@@ -204,12 +226,33 @@ static void libretrodb_write_index_header(RFILE *fd, libretrodb_index_t *idx)
    rmsgpack_write_uint(fd, idx->next);
 }
 
+static void libretrodb_unmap(libretrodb_t *db)
+{
+   if (db->map)
+   {
+#ifdef LIBRETRODB_HAVE_MMAP
+      if (db->map_is_mmap)
+         munmap((void*)db->map, (size_t)db->map_size);
+      else
+#endif
+         free((void*)db->map);
+   }
+   if (db->indices)
+      free(db->indices);
+   db->map         = NULL;
+   db->map_size    = 0;
+   db->map_is_mmap = false;
+   db->indices     = NULL;
+   db->num_indices = 0;
+}
+
 void libretrodb_close(libretrodb_t *db)
 {
    if (db->fd)
       filestream_close(db->fd);
    if (!string_is_empty(db->path))
       free(db->path);
+   libretrodb_unmap(db);
    db->path = NULL;
    db->fd   = NULL;
 }
@@ -238,7 +281,7 @@ int libretrodb_open(const char *path, libretrodb_t *db)
       goto error;
    }
 
-   if (strncmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0)
+   if (memcmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1) != 0)
    {
       rv = -EINVAL;
       goto error;
@@ -265,6 +308,177 @@ error:
    return rv;
 }
 
+static bool libretrodb_map_file(libretrodb_t *db, const char *path)
+{
+   int64_t len = 0;
+   void *buf   = NULL;
+#ifdef LIBRETRODB_HAVE_MMAP
+   struct stat st;
+   int fd      = open(path, O_RDONLY);
+
+   if (fd >= 0)
+   {
+      if (fstat(fd, &st) == 0 && st.st_size > 0)
+      {
+         buf = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+         if (buf == MAP_FAILED)
+            buf = NULL;
+      }
+      close(fd);
+
+      if (buf)
+      {
+         db->map         = (const uint8_t*)buf;
+         db->map_size    = (uint64_t)st.st_size;
+         db->map_is_mmap = true;
+         return true;
+      }
+   }
+#endif
+
+   /* No mmap (or a path only the VFS layer understands),
+    * keep a private copy of the file instead */
+   if (!filestream_read_file(path, &buf, &len) || len <= 0)
+   {
+      if (buf)
+         free(buf);
+      return false;
+   }
+
+   db->map         = (const uint8_t*)buf;
+   db->map_size    = (uint64_t)len;
+   db->map_is_mmap = false;
+   return true;
+}
+
+/* Index headers are maps of name, key_size and next,
+ * followed by 'next' bytes of sorted (key, offset) pairs */
+static bool libretrodb_load_indices(libretrodb_t *db)
+{
+   uint64_t offset = db->first_index_offset;
+
+   while (offset < db->map_size)
+   {
+      struct rmsgpack_view view;
+      struct rmsgpack_view field;
+      libretrodb_resident_index_t idx;
+      libretrodb_resident_index_t *tmp = NULL;
+      size_t header_size               = 0;
+      uint32_t name_len                = 0;
+      const char *name                 = NULL;
+
+      if (rmsgpack_view_init(&view, db->map + offset,
+               (size_t)(db->map_size - offset)) < 0)
+         return false;
+      if ((header_size = rmsgpack_view_size(&view)) == 0)
+         return false;
+
+      memset(&idx, 0, sizeof(idx));
+
+      if (rmsgpack_view_map_find(&view, "name", 4, &field) == 0)
+         name = rmsgpack_view_bytes(&field, &name_len);
+      if (rmsgpack_view_map_find(&view, "key_size", 8, &field) == 0)
+         idx.header.key_size = rmsgpack_view_uint(&field);
+      if (rmsgpack_view_map_find(&view, "next", 4, &field) == 0)
+         idx.header.next     = rmsgpack_view_uint(&field);
+
+      offset += header_size;
+
+      if (     !name
+            || idx.header.key_size == 0
+            || idx.header.key_size > 0xff
+            || idx.header.next > db->map_size - offset)
+         return false;
+
+      if (name_len >= sizeof(idx.header.name))
+         name_len = sizeof(idx.header.name) - 1;
+      memcpy(idx.header.name, name, name_len);
+
+      idx.entries = db->map + offset;
+      idx.count   = idx.header.next / (idx.header.key_size + sizeof(uint64_t));
+
+      if (!(tmp = (libretrodb_resident_index_t*)realloc(db->indices,
+                  (db->num_indices + 1) * sizeof(*tmp))))
+         return false;
+
+      db->indices                    = tmp;
+      db->indices[db->num_indices++] = idx;
+      offset                        += idx.header.next;
+   }
+
+   return true;
+}
+
+/**
+ * libretrodb_open_mapped:
+ * @path                : Path to the database.
+ * @db                  : Handle to database.
+ *
+ * Opens the database read-only by mapping it into memory.
+ * Index tables are located once here and stay resident,
+ * and cursors read items as views into the mapping.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_open_mapped(const char *path, libretrodb_t *db)
+{
+   libretrodb_header_t header;
+   struct rmsgpack_view view;
+   struct rmsgpack_view field;
+   size_t md_size = 0;
+
+   if (!string_is_empty(db->path))
+      free(db->path);
+   libretrodb_unmap(db);
+
+   db->path = NULL;
+   db->root = 0;
+
+   if (!libretrodb_map_file(db, path))
+      return -EIO;
+
+   if (db->map_size < sizeof(header))
+      goto error;
+
+   memcpy(&header, db->map, sizeof(header));
+
+   if (memcmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1) != 0)
+      goto error;
+
+   header.metadata_offset = swap_if_little64(header.metadata_offset);
+
+   if (header.metadata_offset >= db->map_size)
+      goto error;
+
+   if (rmsgpack_view_init(&view, db->map + header.metadata_offset,
+            (size_t)(db->map_size - header.metadata_offset)) < 0)
+      goto error;
+   if ((md_size = rmsgpack_view_size(&view)) == 0)
+      goto error;
+   if (rmsgpack_view_map_find(&view, "count", 5, &field) < 0)
+      goto error;
+
+   db->count              = rmsgpack_view_uint(&field);
+   db->first_index_offset = header.metadata_offset + md_size;
+
+   /* A broken index only costs the indexed lookups */
+   if (!libretrodb_load_indices(db))
+   {
+      if (db->indices)
+         free(db->indices);
+      db->indices     = NULL;
+      db->num_indices = 0;
+   }
+
+   db->path = strdup(path);
+   return 0;
+
+error:
+   libretrodb_unmap(db);
+   return -EINVAL;
+}
+
 static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
       libretrodb_index_t *idx)
 {
@@ -289,28 +503,54 @@ static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
    return -1;
 }
 
+/* Entries are 'field_size' key bytes followed by
+ * the native endian offset of the item */
 static int binsearch(const void *buff, const void *item,
       uint64_t count, uint8_t field_size, uint64_t *offset)
 {
-   int mid            = (int)(count / 2);
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t *current  = (uint64_t *)buff + (mid * item_size);
-   int rv             = memcmp(current, item, field_size);
+   const uint8_t *entries = (const uint8_t*)buff;
+   size_t item_size       = field_size + sizeof(uint64_t);
+   uint64_t lo            = 0;
+   uint64_t hi            = count;
 
-   if (rv == 0)
+   while (lo < hi)
    {
-      *offset = *(uint64_t *)(current + field_size);
-      return 0;
+      uint64_t mid           = lo + (hi - lo) / 2;
+      const uint8_t *current = entries + mid * item_size;
+      int rv                 = memcmp(current, item, field_size);
+
+      if (rv == 0)
+      {
+         memcpy(offset, current + field_size, sizeof(uint64_t));
+         return 0;
+      }
+
+      if (rv > 0)
+         hi = mid;
+      else
+         lo = mid + 1;
    }
 
-   if (count == 0)
-      return -1;
+   return -1;
+}
+
+static int libretrodb_find_resident(libretrodb_t *db,
+      const char *index_name, const void *key, uint64_t *offset)
+{
+   unsigned i;
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+   for (i = 0; i < db->num_indices; i++)
+   {
+      libretrodb_resident_index_t *idx = &db->indices[i];
+
+      if (!string_is_equal(idx->header.name, index_name))
+         continue;
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+      return binsearch(idx->entries, key, idx->count,
+            (uint8_t)idx->header.key_size, offset);
+   }
+
+   return -1;
 }
 
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
@@ -322,6 +562,16 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
    uint64_t offset;
    ssize_t bufflen, nread = 0;
 
+   if (db->map)
+   {
+      struct rmsgpack_view view;
+
+      if (libretrodb_find_entry_view(db, index_name, key, &view) < 0)
+         return -1;
+
+      return rmsgpack_dom_read_view(&view, out);
+   }
+
    if (libretrodb_find_index(db, index_name, &idx) < 0)
       return -1;
 
@@ -333,7 +583,7 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
 
    while (nread < bufflen)
    {
-      void *buff_ = (uint64_t *)buff + nread;
+      void *buff_ = (uint8_t *)buff + nread;
       rv = (int)filestream_read(db->fd, buff_, bufflen - nread);
 
       if (rv <= 0)
@@ -344,16 +594,46 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
       nread += rv;
    }
 
-   rv = binsearch(buff, key, db->count, (ssize_t)idx.key_size, &offset);
+   rv = binsearch(buff, key,
+         idx.next / (idx.key_size + sizeof(uint64_t)),
+         (uint8_t)idx.key_size, &offset);
    free(buff);
 
-   if (rv == 0)
-      filestream_seek(db->fd, (ssize_t)offset,
-            RETRO_VFS_SEEK_POSITION_START);
+   if (rv != 0)
+      return -1;
+
+   filestream_seek(db->fd, (ssize_t)offset,
+         RETRO_VFS_SEEK_POSITION_START);
 
    return rmsgpack_dom_read(db->fd, out);
 }
 
+/**
+ * libretrodb_find_entry_view:
+ * @db                  : Handle to a mapped database.
+ * @index_name          : Name of the index to search.
+ * @key                 : Key, as long as the index key size.
+ * @out                 : View of the matching item.
+ *
+ * Looks up @key in the resident index. @out stays
+ * valid until @db is closed.
+ *
+ * Returns: 0 if found, otherwise negative.
+ **/
+int libretrodb_find_entry_view(libretrodb_t *db, const char *index_name,
+      const void *key, struct rmsgpack_view *out)
+{
+   uint64_t offset = 0;
+
+   if (!db || !db->map)
+      return -EINVAL;
+
+   if (libretrodb_find_resident(db, index_name, key, &offset) < 0)
+      return -1;
+
+   return libretrodb_read_view_at(db, offset, out);
+}
+
 /**
  * libretrodb_cursor_reset:
  * @cursor              : Handle to database cursor.
@@ -364,7 +644,12 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
  **/
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
-   cursor->eof = 0;
+   cursor->eof    = 0;
+   cursor->offset = cursor->db->root + sizeof(libretrodb_header_t);
+
+   if (cursor->db->map)
+      return 0;
+
    return (int)filestream_seek(cursor->fd,
          (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
          RETRO_VFS_SEEK_POSITION_START);
@@ -378,6 +663,16 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
    if (cursor->eof)
       return EOF;
 
+   if (cursor->db->map)
+   {
+      struct rmsgpack_view view;
+
+      if ((rv = libretrodb_cursor_read_view(cursor, &view)) != 0)
+         return rv;
+
+      return rmsgpack_dom_read_view(&view, out);
+   }
+
 retry:
    rv = rmsgpack_dom_read(cursor->fd, out);
    if (rv < 0)
@@ -401,6 +696,138 @@ retry:
    return 0;
 }
 
+/**
+ * libretrodb_cursor_read_view:
+ * @cursor              : Handle to a cursor on a mapped database.
+ * @out                 : View of the item read.
+ *
+ * Like libretrodb_cursor_read_item(), but returns a view
+ * into the mapping instead of decoding the item. The query
+ * of the cursor runs on the view as well.
+ *
+ * Returns: 0 if successful, EOF at the end of the database,
+ * otherwise negative.
+ **/
+int libretrodb_cursor_read_view(libretrodb_cursor_t *cursor,
+      struct rmsgpack_view *out)
+{
+   size_t size      = 0;
+   libretrodb_t *db = cursor->db;
+
+   if (!db || !db->map)
+      return -EINVAL;
+
+   for (;;)
+   {
+      if (cursor->eof)
+         return EOF;
+
+      if (libretrodb_read_view_at(db, cursor->offset, out) < 0)
+         return -EINVAL;
+
+      if ((size = rmsgpack_view_size(out)) == 0)
+         return -EINVAL;
+
+      cursor->offset += size;
+
+      if (rmsgpack_view_type(out) == RDT_NULL)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+
+      if (     !cursor->query
+            || libretrodb_query_filter_view(cursor->query, out))
+         return 0;
+   }
+}
+
+/**
+ * libretrodb_cursor_tell:
+ * @cursor              : Handle to database cursor.
+ *
+ * Returns: file offset of the next item @cursor will read.
+ * Can be passed to libretrodb_read_item_at() to read
+ * that item again later without iterating the database.
+ **/
+uint64_t libretrodb_cursor_tell(libretrodb_cursor_t *cursor)
+{
+   if (cursor->db && cursor->db->map)
+      return cursor->offset;
+   return (uint64_t)filestream_tell(cursor->fd);
+}
+
+/**
+ * libretrodb_read_item_at:
+ * @db                  : Handle to database.
+ * @offset              : Item offset, as returned by
+ *                        libretrodb_cursor_tell().
+ * @out                 : Item read from the database.
+ *
+ * Reads a single item directly from @offset.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_read_item_at(libretrodb_t *db, uint64_t offset,
+      struct rmsgpack_dom_value *out)
+{
+   if (!db || (!db->fd && !db->map))
+      return -EINVAL;
+
+   if (offset < db->root + sizeof(libretrodb_header_t))
+      return -EINVAL;
+
+   if (db->map)
+   {
+      struct rmsgpack_view view;
+
+      if (libretrodb_read_view_at(db, offset, &view) < 0)
+         return -EINVAL;
+
+      return rmsgpack_dom_read_view(&view, out) < 0 ? -EINVAL : 0;
+   }
+
+   if (filestream_seek(db->fd, (ssize_t)offset,
+            RETRO_VFS_SEEK_POSITION_START) < 0)
+      return -EIO;
+
+   if (rmsgpack_dom_read(db->fd, out) < 0)
+      return -EINVAL;
+
+   return 0;
+}
+
+/**
+ * libretrodb_read_view_at:
+ * @db                  : Handle to a mapped database.
+ * @offset              : Item offset, as returned by
+ *                        libretrodb_cursor_tell().
+ * @out                 : View of the item.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_read_view_at(libretrodb_t *db, uint64_t offset,
+      struct rmsgpack_view *out)
+{
+   if (!db || !db->map)
+      return -EINVAL;
+
+   if (     offset < db->root + sizeof(libretrodb_header_t)
+         || offset >= db->map_size)
+      return -EINVAL;
+
+   if (rmsgpack_view_init(out, db->map + offset,
+            (size_t)(db->map_size - offset)) < 0)
+      return -EINVAL;
+
+   return 0;
+}
+
+uint64_t libretrodb_get_count(libretrodb_t *db)
+{
+   return db->count;
+}
+
 /**
  * libretrodb_cursor_close:
  * @cursor              : Handle to database cursor.
@@ -442,6 +869,20 @@ int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
    if (!db || string_is_empty(db->path))
       return -errno;
 
+   if (db->map)
+   {
+      cursor->fd       = NULL;
+      cursor->db       = db;
+      cursor->is_valid = 1;
+      libretrodb_cursor_reset(cursor);
+      cursor->query    = q;
+
+      if (q)
+         libretrodb_query_inc_ref(q);
+
+      return 0;
+   }
+
    fd = filestream_open(db->path,
          RETRO_VFS_FILE_ACCESS_READ,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
@@ -472,11 +913,6 @@ static int node_iter(void *value, void *ctx)
    return -1;
 }
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
-{
-   return filestream_tell(db->fd);
-}
-
 static int node_compare(const void *a, const void *b, void *ctx)
 {
    return memcmp(a, b, *(uint8_t *)ctx);
@@ -494,7 +930,7 @@ int libretrodb_create_index(libretrodb_t *db,
    void *buff                       = NULL;
    uint64_t *buff_u64               = NULL;
    uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
+   uint64_t item_loc                = 0;
    bintree_t *tree                  = bintree_new(node_compare, &field_size);
 
    item.type                        = RDT_NULL;
@@ -505,6 +941,7 @@ int libretrodb_create_index(libretrodb_t *db,
    key.type            = RDT_STRING;
    key.val.string.len  = (uint32_t)strlen(field_name);
    key.val.string.buff = (char *) field_name;   /* We know we aren't going to change it */
+   item_loc            = libretrodb_cursor_tell(&cur);
 
    while (libretrodb_cursor_read_item(&cur, &item) == 0)
    {
@@ -548,7 +985,7 @@ int libretrodb_create_index(libretrodb_t *db,
 
       memcpy(buff, field->val.binary.buff, field_size);
 
-      buff_u64 = (uint64_t *)buff + field_size;
+      buff_u64 = (uint64_t *)((uint8_t *)buff + field_size);
 
       memcpy(buff_u64, &item_loc, sizeof(uint64_t));
 
@@ -561,7 +998,7 @@ int libretrodb_create_index(libretrodb_t *db,
       }
       buff     = NULL;
       rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
+      item_loc = libretrodb_cursor_tell(&cur);
    }
 
    filestream_seek(db->fd, 0, RETRO_VFS_SEEK_POSITION_END);
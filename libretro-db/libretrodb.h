@@ -33,6 +33,7 @@
 #include <retro_common_api.h>
 
 #include "query.h"
+#include "rmsgpack.h"
 #include "rmsgpack_dom.h"
 
 RETRO_BEGIN_DECLS
@@ -51,12 +52,28 @@ void libretrodb_close(libretrodb_t *db);
 
 int libretrodb_open(const char *path, libretrodb_t *db);
 
+/**
+ * libretrodb_open_mapped:
+ * @path                : Path to the database.
+ * @db                  : Handle to database.
+ *
+ * Opens the database read-only by mapping it into memory.
+ * Index tables are located once here and stay resident,
+ * and cursors read items as views into the mapping.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_open_mapped(const char *path, libretrodb_t *db);
+
 int libretrodb_create_index(libretrodb_t *db, const char *name,
       const char *field_name);
 
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
         const void *key, struct rmsgpack_dom_value *out);
 
+int libretrodb_find_entry_view(libretrodb_t *db, const char *index_name,
+        const void *key, struct rmsgpack_view *out);
+
 libretrodb_t *libretrodb_new(void);
 
 void libretrodb_free(libretrodb_t *db);
@@ -105,6 +122,22 @@ void libretrodb_query_free(void *q);
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out);
 
+/* Views returned by the following functions point into the
+ * mapping of a database opened with libretrodb_open_mapped(),
+ * and stay valid until that database is closed */
+int libretrodb_cursor_read_view(libretrodb_cursor_t *cursor,
+      struct rmsgpack_view *out);
+
+int libretrodb_read_view_at(libretrodb_t *db, uint64_t offset,
+      struct rmsgpack_view *out);
+
+uint64_t libretrodb_cursor_tell(libretrodb_cursor_t *cursor);
+
+int libretrodb_read_item_at(libretrodb_t *db, uint64_t offset,
+      struct rmsgpack_dom_value *out);
+
+uint64_t libretrodb_get_count(libretrodb_t *db);
+
 RETRO_END_DECLS
 
 #endif
@@ -0,0 +1,195 @@
+/* Copyright  (C) 2010-2020 The RetroArch team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (libretrodb_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Compares reading databases through the stream backend
+ * (a decoded DOM per record) with the mapped backend
+ * (views into the mapping), for full scans and queries.
+ *
+ * Usage: libretrodb_bench [-q <query>] <db file> [<db file> ...]
+ *
+ * e.g. libretrodb_bench rdb/Nintendo*.rdb */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "libretrodb.h"
+#include "rmsgpack.h"
+#include "rmsgpack_dom.h"
+
+struct bench_result
+{
+   double seconds;
+   unsigned items;
+};
+
+static const char *default_queries[] = {
+   "{'name':glob('*(USA)*')}",
+   "{'crc':b'00000000'}",
+   NULL
+};
+
+static double bench_now(void)
+{
+   return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static int bench_run(const char *path, const char *query, int mapped,
+      struct bench_result *res)
+{
+   const char *error        = NULL;
+   libretrodb_query_t *q    = NULL;
+   libretrodb_t *db         = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+   double start             = bench_now();
+   int rv                   = -1;
+
+   res->items = 0;
+
+   if (!db || !cur)
+      goto end;
+
+   if ((mapped ? libretrodb_open_mapped(path, db)
+            : libretrodb_open(path, db)) != 0)
+      goto end;
+
+   if (query)
+   {
+      q = (libretrodb_query_t*)libretrodb_query_compile(db, query,
+            strlen(query), &error);
+      if (error)
+      {
+         printf("%s\n", error);
+         goto end;
+      }
+   }
+
+   if (libretrodb_cursor_open(db, cur, q) != 0)
+      goto end;
+
+   if (mapped)
+   {
+      struct rmsgpack_view view;
+
+      while (libretrodb_cursor_read_view(cur, &view) == 0)
+         res->items++;
+   }
+   else
+   {
+      struct rmsgpack_dom_value item;
+
+      while (libretrodb_cursor_read_item(cur, &item) == 0)
+      {
+         rmsgpack_dom_value_free(&item);
+         res->items++;
+      }
+   }
+
+   libretrodb_cursor_close(cur);
+   rv = 0;
+
+end:
+   if (q)
+      libretrodb_query_free(q);
+   if (db)
+   {
+      libretrodb_close(db);
+      libretrodb_free(db);
+   }
+   if (cur)
+      libretrodb_cursor_free(cur);
+
+   res->seconds = bench_now() - start;
+   return rv;
+}
+
+int main(int argc, char **argv)
+{
+   int i, j;
+   const char *queries[2]  = {NULL, NULL};
+   const char **query_list = default_queries;
+   double totals[2][2]     = {{0}};
+   int mismatches          = 0;
+
+   if (argc > 2 && strcmp(argv[1], "-q") == 0)
+   {
+      queries[0] = argv[2];
+      query_list = queries;
+      argc      -= 2;
+      argv      += 2;
+   }
+
+   if (argc < 2)
+   {
+      printf("Usage: %s [-q <query>] <db file> [<db file> ...]\n", argv[0]);
+      return 1;
+   }
+
+   for (i = 1; i < argc; i++)
+   {
+      struct bench_result stream, mapped;
+
+      if (     bench_run(argv[i], NULL, 0, &stream) != 0
+            || bench_run(argv[i], NULL, 1, &mapped) != 0)
+      {
+         printf("Could not read db file '%s'\n", argv[i]);
+         mismatches++;
+         continue;
+      }
+
+      printf("%s: %u items, scan %.2f ms stream / %.2f ms mapped\n",
+            argv[i], stream.items,
+            stream.seconds * 1000.0, mapped.seconds * 1000.0);
+
+      if (stream.items != mapped.items)
+         mismatches++;
+
+      totals[0][0] += stream.seconds;
+      totals[0][1] += mapped.seconds;
+
+      for (j = 0; query_list[j]; j++)
+      {
+         bench_run(argv[i], query_list[j], 0, &stream);
+         bench_run(argv[i], query_list[j], 1, &mapped);
+
+         printf("  %s: %u matches, %.2f ms stream / %.2f ms mapped\n",
+               query_list[j], stream.items,
+               stream.seconds * 1000.0, mapped.seconds * 1000.0);
+
+         if (stream.items != mapped.items)
+         {
+            printf("  mismatch: %u mapped matches\n", mapped.items);
+            mismatches++;
+         }
+
+         totals[1][0] += stream.seconds;
+         totals[1][1] += mapped.seconds;
+      }
+   }
+
+   printf("total: scan %.2f ms stream / %.2f ms mapped, "
+         "queries %.2f ms stream / %.2f ms mapped\n",
+         totals[0][0] * 1000.0, totals[0][1] * 1000.0,
+         totals[1][0] * 1000.0, totals[1][1] * 1000.0);
+
+   return mismatches ? 1 : 0;
+}
@@ -36,6 +36,7 @@
 
 #include "libretrodb.h"
 #include "query.h"
+#include "rmsgpack.h"
 #include "rmsgpack_dom.h"
 
 #define MAX_ERROR_LEN   256
@@ -257,24 +258,35 @@ static struct rmsgpack_dom_value query_func_glob(
       unsigned argc, const struct argument * argv)
 {
    struct rmsgpack_dom_value res;
-   unsigned i = 0;
+   char buf[256];
+   char *str     = buf;
+   uint32_t len  = 0;
 
    res.type      = RDT_BOOL;
    res.val.bool_ = 0;
 
-   (void)i;
-
    if (argc != 1)
       return res;
    if (argv[0].type != AT_VALUE || argv[0].a.value.type != RDT_STRING)
       return res;
    if (input.type != RDT_STRING)
       return res;
+
+   /* Strings borrowed from a view are not NUL terminated */
+   len = input.val.string.len;
+   if (len >= sizeof(buf) && !(str = (char*)malloc(len + 1)))
+      return res;
+   memcpy(str, input.val.string.buff, len);
+   str[len] = '\0';
+
    res.val.bool_ = rl_fnmatch(
          argv[0].a.value.val.string.buff,
-         input.val.string.buff,
+         str,
          0
          ) == 0;
+
+   if (str != buf)
+      free(str);
    return res;
 }
 
@@ -969,6 +981,112 @@ void libretrodb_query_inc_ref(libretrodb_query_t *q)
       rq->ref_count += 1;
 }
 
+static int query_invoke_view(const struct invocation *inv,
+      const struct rmsgpack_view *input);
+
+/* query_func_all_map() for views, looking fields up
+ * in place instead of in a decoded map */
+static int query_all_map_view(const struct rmsgpack_view *input,
+      unsigned argc, const struct argument *argv)
+{
+   unsigned i;
+
+   if (argc % 2 != 0)
+      return 0;
+
+   if (rmsgpack_view_type(input) != RDT_MAP)
+      return 1;
+
+   for (i = 0; i < argc; i += 2)
+   {
+      int match;
+      struct rmsgpack_view field;
+      const struct rmsgpack_view *value = NULL;
+      const struct argument *key        = &argv[i];
+      const struct argument *arg        = &argv[i + 1];
+
+      if (key->type != AT_VALUE)
+         return 0;
+
+      /* All missing fields are nil */
+      if (     key->a.value.type == RDT_STRING
+            && rmsgpack_view_map_find(input,
+               key->a.value.val.string.buff,
+               key->a.value.val.string.len, &field) == 0)
+         value = &field;
+
+      if (arg->type == AT_VALUE)
+      {
+         struct rmsgpack_dom_value scalar;
+
+         scalar.type = RDT_NULL;
+
+         if (value && rmsgpack_view_scalar(value, &scalar) < 0)
+         {
+            /* Comparing against a map or array, decode it */
+            if (rmsgpack_dom_read_view(value, &scalar) < 0)
+               return 0;
+            match = func_equals(scalar, 1, arg).val.bool_;
+            rmsgpack_dom_value_free(&scalar);
+         }
+         else
+            match = func_equals(scalar, 1, arg).val.bool_;
+      }
+      else
+         match = query_invoke_view(&arg->a.invocation, value);
+
+      if (!match)
+         return 0;
+   }
+
+   return 1;
+}
+
+/* 'input' is NULL for missing fields */
+static int query_invoke_view(const struct invocation *inv,
+      const struct rmsgpack_view *input)
+{
+   struct rmsgpack_dom_value value;
+   struct rmsgpack_dom_value res;
+
+   if (inv->func == query_func_all_map)
+   {
+      if (!input)
+         return 1;
+      return query_all_map_view(input, inv->argc, inv->argv);
+   }
+
+   value.type = RDT_NULL;
+
+   if (!input || rmsgpack_view_scalar(input, &value) == 0)
+      res = inv->func(value, inv->argc, inv->argv);
+   else
+   {
+      if (rmsgpack_dom_read_view(input, &value) < 0)
+         return 0;
+      res = inv->func(value, inv->argc, inv->argv);
+      rmsgpack_dom_value_free(&value);
+   }
+
+   return (res.type == RDT_BOOL && res.val.bool_);
+}
+
+/**
+ * libretrodb_query_filter_view:
+ * @q                   : Compiled query.
+ * @v                   : Item to test.
+ *
+ * Same as libretrodb_query_filter(), but runs on a view
+ * without decoding it.
+ *
+ * Returns: non-zero if @v matches @q.
+ **/
+int libretrodb_query_filter_view(libretrodb_query_t *q,
+      const struct rmsgpack_view *v)
+{
+   return query_invoke_view(&((struct query *)q)->root, v);
+}
+
 int libretrodb_query_filter(libretrodb_query_t *q,
       struct rmsgpack_dom_value *v)
 {
@@ -38,6 +38,11 @@ void libretrodb_query_dec_ref(libretrodb_query_t *q);
 
 int libretrodb_query_filter(libretrodb_query_t *q, struct rmsgpack_dom_value *v);
 
+struct rmsgpack_view;
+
+int libretrodb_query_filter_view(libretrodb_query_t *q,
+      const struct rmsgpack_view *v);
+
 RETRO_END_DECLS
 
 #endif
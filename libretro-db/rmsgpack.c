@@ -658,3 +658,390 @@ int rmsgpack_read(RFILE *fd,
 error:
    return -errno;
 }
+
+/* Views */
+
+struct rmsgpack_view_header
+{
+   enum rmsgpack_dom_type type;
+   uint32_t header_size;
+   uint64_t len;        /* payload bytes, or number of items */
+   uint64_t uint_;
+   int64_t int_;
+};
+
+static uint64_t view_read_be(const uint8_t *p, size_t size)
+{
+   size_t i;
+   uint64_t value = 0;
+
+   for (i = 0; i < size; i++)
+      value = (value << 8) | p[i];
+
+   return value;
+}
+
+static int64_t view_read_be_signed(const uint8_t *p, size_t size)
+{
+   uint64_t value = view_read_be(p, size);
+
+   switch (size)
+   {
+      case 1:
+         return (int8_t)value;
+      case 2:
+         return (int16_t)value;
+      case 4:
+         return (int32_t)value;
+   }
+
+   return (int64_t)value;
+}
+
+/* Decodes the type byte and length fields of the value
+ * at 'p', following the same rules as rmsgpack_read() */
+static int rmsgpack_view_decode(const uint8_t *p, const uint8_t *end,
+      struct rmsgpack_view_header *hdr)
+{
+   size_t size;
+   uint8_t type;
+
+   if (!p || p >= end)
+      return -EINVAL;
+
+   type             = *p;
+   hdr->header_size = 1;
+   hdr->len         = 0;
+   hdr->uint_       = 0;
+   hdr->int_        = 0;
+
+   if (type < MPF_FIXMAP)
+   {
+      hdr->type = RDT_INT;
+      hdr->int_ = type;
+      return 0;
+   }
+   else if (type < MPF_FIXARRAY)
+   {
+      hdr->type = RDT_MAP;
+      hdr->len  = type - MPF_FIXMAP;
+      return 0;
+   }
+   else if (type < MPF_FIXSTR)
+   {
+      hdr->type = RDT_ARRAY;
+      hdr->len  = type - MPF_FIXARRAY;
+      return 0;
+   }
+   else if (type < MPF_NIL)
+   {
+      hdr->type = RDT_STRING;
+      hdr->len  = type - MPF_FIXSTR;
+      goto check_payload;
+   }
+   else if (type > MPF_MAP32)
+   {
+      hdr->type = RDT_INT;
+      hdr->int_ = (int64_t)type - 0xff - 1;
+      return 0;
+   }
+
+   switch (type)
+   {
+      case _MPF_NIL:
+         hdr->type  = RDT_NULL;
+         return 0;
+      case _MPF_FALSE:
+      case _MPF_TRUE:
+         hdr->type  = RDT_BOOL;
+         hdr->uint_ = (type == _MPF_TRUE);
+         return 0;
+      case _MPF_BIN8:
+      case _MPF_BIN16:
+      case _MPF_BIN32:
+      case _MPF_STR8:
+      case _MPF_STR16:
+      case _MPF_STR32:
+         if (type <= _MPF_BIN32)
+         {
+            hdr->type = RDT_BINARY;
+            size      = (size_t)1 << (type - _MPF_BIN8);
+         }
+         else
+         {
+            hdr->type = RDT_STRING;
+            size      = (size_t)1 << (type - _MPF_STR8);
+         }
+         if ((size_t)(end - p) < 1 + size)
+            return -EINVAL;
+         hdr->len         = view_read_be(p + 1, size);
+         hdr->header_size = (uint32_t)(1 + size);
+         goto check_payload;
+      case _MPF_UINT8:
+      case _MPF_UINT16:
+      case _MPF_UINT32:
+      case _MPF_UINT64:
+         size = (size_t)1 << (type - _MPF_UINT8);
+         if ((size_t)(end - p) < 1 + size)
+            return -EINVAL;
+         hdr->type        = RDT_UINT;
+         hdr->uint_       = view_read_be(p + 1, size);
+         hdr->header_size = (uint32_t)(1 + size);
+         return 0;
+      case _MPF_INT8:
+      case _MPF_INT16:
+      case _MPF_INT32:
+      case _MPF_INT64:
+         size = (size_t)1 << (type - _MPF_INT8);
+         if ((size_t)(end - p) < 1 + size)
+            return -EINVAL;
+         hdr->type        = RDT_INT;
+         hdr->int_        = view_read_be_signed(p + 1, size);
+         hdr->header_size = (uint32_t)(1 + size);
+         return 0;
+      case _MPF_ARRAY16:
+      case _MPF_ARRAY32:
+      case _MPF_MAP16:
+      case _MPF_MAP32:
+         if (type == _MPF_ARRAY16 || type == _MPF_MAP16)
+            size = 2;
+         else
+            size = 4;
+         if ((size_t)(end - p) < 1 + size)
+            return -EINVAL;
+         hdr->type        = (type <= _MPF_ARRAY32) ? RDT_ARRAY : RDT_MAP;
+         hdr->len         = view_read_be(p + 1, size);
+         hdr->header_size = (uint32_t)(1 + size);
+         return 0;
+   }
+
+   /* Extension types are never written by rmsgpack */
+   return -EINVAL;
+
+check_payload:
+   if ((uint64_t)(end - p) - hdr->header_size < hdr->len)
+      return -EINVAL;
+   return 0;
+}
+
+int rmsgpack_view_init(struct rmsgpack_view *view,
+      const void *data, size_t len)
+{
+   struct rmsgpack_view_header hdr;
+
+   view->data = (const uint8_t*)data;
+   view->end  = view->data + len;
+
+   return rmsgpack_view_decode(view->data, view->end, &hdr);
+}
+
+enum rmsgpack_dom_type rmsgpack_view_type(const struct rmsgpack_view *view)
+{
+   struct rmsgpack_view_header hdr;
+
+   if (rmsgpack_view_decode(view->data, view->end, &hdr) < 0)
+      return RDT_NULL;
+
+   return hdr.type;
+}
+
+uint32_t rmsgpack_view_len(const struct rmsgpack_view *view)
+{
+   struct rmsgpack_view_header hdr;
+
+   if (rmsgpack_view_decode(view->data, view->end, &hdr) < 0)
+      return 0;
+
+   switch (hdr.type)
+   {
+      case RDT_STRING:
+      case RDT_BINARY:
+      case RDT_MAP:
+      case RDT_ARRAY:
+         return (uint32_t)hdr.len;
+      default:
+         break;
+   }
+
+   return 0;
+}
+
+size_t rmsgpack_view_size(const struct rmsgpack_view *view)
+{
+   uint64_t i;
+   uint64_t items;
+   struct rmsgpack_view child;
+   struct rmsgpack_view_header hdr;
+
+   if (rmsgpack_view_decode(view->data, view->end, &hdr) < 0)
+      return 0;
+
+   switch (hdr.type)
+   {
+      case RDT_STRING:
+      case RDT_BINARY:
+         return (size_t)(hdr.header_size + hdr.len);
+      case RDT_MAP:
+      case RDT_ARRAY:
+         items      = (hdr.type == RDT_MAP) ? hdr.len * 2 : hdr.len;
+         child.data = view->data + hdr.header_size;
+         child.end  = view->end;
+         for (i = 0; i < items; i++)
+         {
+            size_t size = rmsgpack_view_size(&child);
+            if (size == 0)
+               return 0;
+            child.data += size;
+         }
+         return (size_t)(child.data - view->data);
+      default:
+         break;
+   }
+
+   return hdr.header_size;
+}
+
+int rmsgpack_view_next(struct rmsgpack_view *view)
+{
+   size_t size = rmsgpack_view_size(view);
+
+   if (size == 0)
+      return -EINVAL;
+
+   view->data += size;
+   return 0;
+}
+
+int rmsgpack_view_child(const struct rmsgpack_view *view,
+      struct rmsgpack_view *child)
+{
+   struct rmsgpack_view_header hdr;
+
+   if (rmsgpack_view_decode(view->data, view->end, &hdr) < 0)
+      return -EINVAL;
+
+   if ((hdr.type != RDT_MAP && hdr.type != RDT_ARRAY) || hdr.len == 0)
+      return -EINVAL;
+
+   child->data = view->data + hdr.header_size;
+   child->end  = view->end;
+   return 0;
+}
+
+int rmsgpack_view_map_find(const struct rmsgpack_view *map,
+      const char *key, uint32_t key_len, struct rmsgpack_view *out)
+{
+   uint32_t i;
+   struct rmsgpack_view cur;
+   uint32_t count = 0;
+
+   if (rmsgpack_view_type(map) != RDT_MAP)
+      return -EINVAL;
+
+   count = rmsgpack_view_len(map);
+
+   if (rmsgpack_view_child(map, &cur) < 0)
+      return -EINVAL;
+
+   for (i = 0; i < count; i++)
+   {
+      uint32_t len     = 0;
+      const char *name = rmsgpack_view_bytes(&cur, &len);
+
+      if (rmsgpack_view_next(&cur) < 0)
+         return -EINVAL;
+
+      if (     name
+            && len == key_len
+            && memcmp(name, key, key_len) == 0)
+      {
+         *out = cur;
+         return 0;
+      }
+
+      if (rmsgpack_view_next(&cur) < 0)
+         return -EINVAL;
+   }
+
+   return -1;
+}
+
+const char *rmsgpack_view_bytes(const struct rmsgpack_view *view,
+      uint32_t *len)
+{
+   struct rmsgpack_view_header hdr;
+
+   *len = 0;
+
+   if (rmsgpack_view_decode(view->data, view->end, &hdr) < 0)
+      return NULL;
+
+   if (hdr.type != RDT_STRING && hdr.type != RDT_BINARY)
+      return NULL;
+
+   *len = (uint32_t)hdr.len;
+   return (const char*)view->data + hdr.header_size;
+}
+
+uint64_t rmsgpack_view_uint(const struct rmsgpack_view *view)
+{
+   struct rmsgpack_view_header hdr;
+
+   if (rmsgpack_view_decode(view->data, view->end, &hdr) < 0)
+      return 0;
+
+   switch (hdr.type)
+   {
+      case RDT_UINT:
+      case RDT_BOOL:
+         return hdr.uint_;
+      case RDT_INT:
+         return (uint64_t)hdr.int_;
+      default:
+         break;
+   }
+
+   return 0;
+}
+
+int64_t rmsgpack_view_int(const struct rmsgpack_view *view)
+{
+   return (int64_t)rmsgpack_view_uint(view);
+}
+
+int rmsgpack_view_scalar(const struct rmsgpack_view *view,
+      struct rmsgpack_dom_value *out)
+{
+   struct rmsgpack_view_header hdr;
+
+   if (rmsgpack_view_decode(view->data, view->end, &hdr) < 0)
+      return -EINVAL;
+
+   out->type = hdr.type;
+
+   switch (hdr.type)
+   {
+      case RDT_NULL:
+         break;
+      case RDT_BOOL:
+         out->val.bool_ = (int)hdr.uint_;
+         break;
+      case RDT_UINT:
+         out->val.uint_ = hdr.uint_;
+         break;
+      case RDT_INT:
+         out->val.int_  = hdr.int_;
+         break;
+      case RDT_STRING:
+      case RDT_BINARY:
+         /* string and binary share a layout */
+         out->val.string.len  = (uint32_t)hdr.len;
+         out->val.string.buff = (char*)view->data + hdr.header_size;
+         break;
+      case RDT_MAP:
+      case RDT_ARRAY:
+         return -EINVAL;
+   }
+
+   return 0;
+}
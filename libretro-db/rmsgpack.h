@@ -27,6 +27,8 @@
 
 #include <streams/file_stream.h>
 
+#include "rmsgpack_dom.h"
+
 struct rmsgpack_read_callbacks
 {
    int (*read_nil        )(void *);
@@ -57,4 +59,52 @@ int rmsgpack_write_uint(RFILE *fd, uint64_t value );
 
 int rmsgpack_read(RFILE *fd, struct rmsgpack_read_callbacks *callbacks, void *data);
 
+/* A view is a read-only cursor onto one encoded value inside
+ * a buffer that outlives it (e.g. a memory mapped database).
+ * Nothing is decoded or allocated until one of the accessors
+ * below asks for it. */
+struct rmsgpack_view
+{
+   const uint8_t *data;   /* first byte of the value */
+   const uint8_t *end;    /* end of the enclosing buffer */
+};
+
+int rmsgpack_view_init(struct rmsgpack_view *view,
+      const void *data, size_t len);
+
+enum rmsgpack_dom_type rmsgpack_view_type(const struct rmsgpack_view *view);
+
+/* Number of items for maps and arrays, payload size
+ * for strings and binaries, 0 otherwise */
+uint32_t rmsgpack_view_len(const struct rmsgpack_view *view);
+
+/* Encoded size of the value, including any nested items.
+ * Returns 0 if the value runs past the end of the buffer. */
+size_t rmsgpack_view_size(const struct rmsgpack_view *view);
+
+/* Moves the view to the value that follows it */
+int rmsgpack_view_next(struct rmsgpack_view *view);
+
+/* Points 'child' at the first item of a non-empty map
+ * or array. Map items alternate between key and value. */
+int rmsgpack_view_child(const struct rmsgpack_view *view,
+      struct rmsgpack_view *child);
+
+int rmsgpack_view_map_find(const struct rmsgpack_view *map,
+      const char *key, uint32_t key_len, struct rmsgpack_view *out);
+
+/* Payload of a string or binary. Strings are NOT NUL terminated. */
+const char *rmsgpack_view_bytes(const struct rmsgpack_view *view,
+      uint32_t *len);
+
+uint64_t rmsgpack_view_uint(const struct rmsgpack_view *view);
+
+int64_t rmsgpack_view_int(const struct rmsgpack_view *view);
+
+/* Fills 'out' with a scalar value that borrows its string or
+ * binary payload from the view. 'out' must not be passed to
+ * rmsgpack_dom_value_free(). Fails for maps and arrays. */
+int rmsgpack_view_scalar(const struct rmsgpack_view *view,
+      struct rmsgpack_dom_value *out);
+
 #endif
@@ -418,6 +418,90 @@ int rmsgpack_dom_read(RFILE *fd, struct rmsgpack_dom_value *out)
    return rv;
 }
 
+/* Same as rmsgpack_dom_read(), but decodes from a view. */
+int rmsgpack_dom_read_view(const struct rmsgpack_view *view,
+      struct rmsgpack_dom_value *out)
+{
+   uint32_t i;
+   uint32_t len;
+   const char *bytes;
+   struct rmsgpack_view child;
+
+   out->type = RDT_NULL;
+
+   switch (rmsgpack_view_type(view))
+   {
+      case RDT_STRING:
+      case RDT_BINARY:
+         if (!(bytes = rmsgpack_view_bytes(view, &len)))
+            return -EINVAL;
+         if (!(out->val.string.buff = (char*)malloc(len + 1)))
+            return -ENOMEM;
+         memcpy(out->val.string.buff, bytes, len);
+         out->val.string.buff[len] = '\0';
+         out->val.string.len       = len;
+         out->type                 = rmsgpack_view_type(view);
+         return 0;
+      case RDT_MAP:
+         /* Don't trust the item count of a truncated map */
+         if (rmsgpack_view_size(view) == 0)
+            return -EINVAL;
+         len                = rmsgpack_view_len(view);
+         out->type          = RDT_MAP;
+         out->val.map.len   = 0;
+         out->val.map.items = NULL;
+         if (len == 0)
+            return 0;
+         if (!(out->val.map.items = (struct rmsgpack_dom_pair*)
+                  calloc(len, sizeof(*out->val.map.items))))
+            return -ENOMEM;
+         rmsgpack_view_child(view, &child);
+         for (i = 0; i < len; i++)
+         {
+            out->val.map.len++;
+            if (     rmsgpack_dom_read_view(&child,
+                        &out->val.map.items[i].key) < 0
+                  || rmsgpack_view_next(&child) < 0
+                  || rmsgpack_dom_read_view(&child,
+                        &out->val.map.items[i].value) < 0
+                  || rmsgpack_view_next(&child) < 0)
+               goto error;
+         }
+         return 0;
+      case RDT_ARRAY:
+         if (rmsgpack_view_size(view) == 0)
+            return -EINVAL;
+         len                  = rmsgpack_view_len(view);
+         out->type            = RDT_ARRAY;
+         out->val.array.len   = 0;
+         out->val.array.items = NULL;
+         if (len == 0)
+            return 0;
+         if (!(out->val.array.items = (struct rmsgpack_dom_value*)
+                  calloc(len, sizeof(*out->val.array.items))))
+            return -ENOMEM;
+         rmsgpack_view_child(view, &child);
+         for (i = 0; i < len; i++)
+         {
+            out->val.array.len++;
+            if (     rmsgpack_dom_read_view(&child,
+                        &out->val.array.items[i]) < 0
+                  || rmsgpack_view_next(&child) < 0)
+               goto error;
+         }
+         return 0;
+      default:
+         break;
+   }
+
+   return rmsgpack_view_scalar(view, out);
+
+error:
+   rmsgpack_dom_value_free(out);
+   out->type = RDT_NULL;
+   return -EINVAL;
+}
+
 int rmsgpack_dom_read_into(RFILE *fd, ...)
 {
    va_list ap;
@@ -42,6 +42,7 @@
 #endif
 
 #include "cheat_manager.h"
+#include "cheat_search.h"
 
 #include "../msg_hash.h"
 #include "../retroarch.h"
@@ -290,8 +291,7 @@ static void cheat_manager_free(void)
    if (cheat_manager_state.prev_memory_buf)
       free(cheat_manager_state.prev_memory_buf);
 
-   if (cheat_manager_state.matches)
-      free(cheat_manager_state.matches);
+   cheat_search_free(cheat_manager_state.search);
 
    if (cheat_manager_state.memory_buf_list)
       free(cheat_manager_state.memory_buf_list);
@@ -306,7 +306,7 @@ static void cheat_manager_free(void)
    cheat_manager_state.curr_memory_buf = NULL;
    cheat_manager_state.memory_buf_list = NULL;
    cheat_manager_state.memory_size_list = NULL;
-   cheat_manager_state.matches = NULL;
+   cheat_manager_state.search = NULL;
    cheat_manager_state.num_memory_buffers = 0;
    cheat_manager_state.total_memory_size = 0;
    cheat_manager_state.memory_initialized = false;
@@ -841,14 +841,12 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, bool wraparound)
          return 0;
       }
 
-      if (cheat_manager_state.matches)
-      {
-         free(cheat_manager_state.matches);
-         cheat_manager_state.matches = NULL;
-      }
+      cheat_search_free(cheat_manager_state.search);
 
-      cheat_manager_state.matches = (uint8_t*)calloc(cheat_manager_state.total_memory_size, sizeof(uint8_t));
-      if (!cheat_manager_state.matches)
+      cheat_manager_state.search = cheat_search_new(
+            cheat_manager_state.search_bit_size,
+            cheat_manager_state.total_memory_size);
+      if (!cheat_manager_state.search)
       {
          free(cheat_manager_state.prev_memory_buf);
          cheat_manager_state.prev_memory_buf = NULL;
@@ -856,8 +854,6 @@ int cheat_manager_initialize_memory(rarch_setting_t *setting, bool wraparound)
          return 0;
       }
 
-      memset(cheat_manager_state.matches, 0xFF, cheat_manager_state.total_memory_size);
-
       offset = 0;
 
       for (i = 0; i < cheat_manager_state.num_memory_buffers; i++)
@@ -940,119 +936,69 @@ static void cheat_manager_setup_search_meta(unsigned int bitsize, unsigned int *
    }
 }
 
+static void cheat_manager_search_memory(cheat_search_memory_t *memory)
+{
+   memory->regions     = cheat_manager_state.memory_buf_list;
+   memory->sizes       = cheat_manager_state.memory_size_list;
+   memory->prev        = cheat_manager_state.prev_memory_buf;
+   memory->num_regions = cheat_manager_state.num_memory_buffers;
+   memory->big_endian  = cheat_manager_state.big_endian;
+}
+
 static int cheat_manager_search(enum cheat_search_type search_type)
 {
    char msg[100];
-   unsigned char *curr         = cheat_manager_state.curr_memory_buf;
-   unsigned char *prev         = cheat_manager_state.prev_memory_buf;
-   unsigned int idx            = 0;
-   unsigned int curr_val       = 0;
-   unsigned int prev_val       = 0;
-   unsigned int mask           = 0;
-   unsigned int bytes_per_item = 1;
-   unsigned int bits           = 8;
+   cheat_search_memory_t memory;
+   video_frame_jobs_t *jobs    = NULL;
+   unsigned int value          = 0;
    unsigned int offset         = 0;
    unsigned int i              = 0;
    bool refresh                = false;
 
-   if (cheat_manager_state.num_memory_buffers == 0)
+   if (cheat_manager_state.num_memory_buffers == 0 ||
+         !cheat_manager_state.search || !cheat_manager_state.prev_memory_buf)
    {
       runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_NOT_INITIALIZED), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
       return 0;
    }
 
-   cheat_manager_setup_search_meta(cheat_manager_state.search_bit_size, &bytes_per_item, &mask, &bits);
-
-   /* little endian FF000000 = 256 */
-   for (idx = 0; idx < cheat_manager_state.total_memory_size; idx = idx + bytes_per_item)
+   /* The candidates are items of the size the search started
+    * with, a new size starts over with all items of that size. */
+   if (cheat_search_bit_size(cheat_manager_state.search) != cheat_manager_state.search_bit_size)
    {
-      unsigned byte_part;
-
-      offset = translate_address(idx, &curr);
-
-      switch (bytes_per_item)
+      cheat_search_free(cheat_manager_state.search);
+      cheat_manager_state.search = cheat_search_new(
+            cheat_manager_state.search_bit_size,
+            cheat_manager_state.total_memory_size);
+      if (!cheat_manager_state.search)
       {
-         case 2:
-            curr_val = cheat_manager_state.big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-            prev_val = cheat_manager_state.big_endian ?
-               (*(prev + idx) * 256) + *(prev + idx + 1) :
-               *(prev + idx) + (*(prev + idx + 1) * 256);
-            break;
-         case 4:
-            curr_val = cheat_manager_state.big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-            prev_val = cheat_manager_state.big_endian ?
-               (*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
-               *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + (*(prev + idx + 3) * 256 * 256 * 256);
-            break;
-         case 1:
-         default:
-            curr_val = *(curr - offset + idx);
-            prev_val = *(prev + idx);
-            break;
+         runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_NOT_INITIALIZED), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         return 0;
       }
+   }
 
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
-      {
-         unsigned int curr_subval = (curr_val >> (byte_part * bits)) & mask;
-         unsigned int prev_subval = (prev_val >> (byte_part * bits)) & mask;
-         unsigned int prev_match;
+   switch (search_type)
+   {
+      case CHEAT_SEARCH_TYPE_EXACT:
+         value = cheat_manager_state.search_exact_value;
+         break;
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+         value = cheat_manager_state.search_eqplus_value;
+         break;
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         value = cheat_manager_state.search_eqminus_value;
+         break;
+      default:
+         break;
+   }
 
-         if (bits < 8)
-            prev_match = *(cheat_manager_state.matches + idx) & (mask << (byte_part * bits));
-         else
-            prev_match = *(cheat_manager_state.matches + idx);
+   if (cheat_manager_state.total_memory_size >= CHEAT_SEARCH_THREADED_MIN_SIZE)
+      jobs = video_frame_jobs_shared();
 
-         if (prev_match > 0)
-         {
-            bool match = false;
-            switch (search_type)
-            {
-               case CHEAT_SEARCH_TYPE_EXACT:
-                  match = (curr_subval == cheat_manager_state.search_exact_value);
-                  break;
-               case CHEAT_SEARCH_TYPE_LT:
-                  match = (curr_subval < prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_GT:
-                  match = (curr_subval > prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_LTE:
-                  match = (curr_subval <= prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_GTE:
-                  match = (curr_subval >= prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQ:
-                  match = (curr_subval == prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_NEQ:
-                  match = (curr_subval != prev_subval);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQPLUS:
-                  match = (curr_subval == prev_subval + cheat_manager_state.search_eqplus_value);
-                  break;
-               case CHEAT_SEARCH_TYPE_EQMINUS:
-                  match = (curr_subval == prev_subval - cheat_manager_state.search_eqminus_value);
-                  break;
-            }
+   cheat_manager_search_memory(&memory);
 
-            if (!match)
-            {
-               if (bits < 8)
-                  *(cheat_manager_state.matches + idx) = *(cheat_manager_state.matches + idx) &
-                     ((~(mask << (byte_part * bits))) & 0xFF);
-               else
-                  memset(cheat_manager_state.matches + idx, 0, bytes_per_item);
-               if (cheat_manager_state.num_matches > 0)
-                  cheat_manager_state.num_matches--;
-            }
-         }
-      }
-   }
+   cheat_manager_state.num_matches = (unsigned)cheat_search_step(
+         cheat_manager_state.search, &memory, search_type, value, jobs);
 
    offset = 0;
 
@@ -1140,16 +1086,14 @@ int cheat_manager_add_matches(const char *path,
       const char *label, unsigned type, size_t menuidx, size_t entry_idx)
 {
    char msg[100];
+   cheat_search_memory_t memory;
    bool refresh = false;
-   unsigned byte_part = 0;
-   unsigned int idx = 0;
+   size_t candidate = 0;
    unsigned int mask = 0;
    unsigned int bytes_per_item = 1;
    unsigned int bits = 8;
    unsigned int curr_val = 0;
    unsigned int num_added = 0;
-   unsigned int offset = 0;
-   unsigned char *curr = cheat_manager_state.curr_memory_buf;
 
    if (cheat_manager_state.num_matches + cheat_manager_state.size > 100)
    {
@@ -1157,62 +1101,23 @@ int cheat_manager_add_matches(const char *path,
       return 0;
    }
    cheat_manager_setup_search_meta(cheat_manager_state.search_bit_size, &bytes_per_item, &mask, &bits);
+   cheat_manager_search_memory(&memory);
 
-   for (idx = 0; idx < cheat_manager_state.total_memory_size; idx = idx + bytes_per_item)
+   for (; cheat_search_next(cheat_manager_state.search, &candidate); candidate++)
    {
-      offset = translate_address(idx, &curr);
+      unsigned int address      = 0;
+      unsigned int address_mask = 0;
 
-      switch (bytes_per_item)
-      {
-      case 2:
-         curr_val = cheat_manager_state.big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-         break;
-      case 4:
-         curr_val = cheat_manager_state.big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-         break;
-      case 1:
-      default:
-         curr_val = *(curr - offset + idx);
-         break;
-      }
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
-      {
-         unsigned int prev_match;
-
-         if (bits < 8)
-         {
-            prev_match = *(cheat_manager_state.matches + idx) & (mask << (byte_part * bits));
-            if (prev_match)
-            {
-               if (!cheat_manager_add_new_code(cheat_manager_state.search_bit_size, idx, (mask << (byte_part * bits)),
-                     cheat_manager_state.big_endian, curr_val))
-               {
-                  runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                  return 0;
-               }
-               num_added++;
-            }
-         }
-         else
-         {
-            prev_match = *(cheat_manager_state.matches + idx);
-            if (prev_match)
-            {
-               if (!cheat_manager_add_new_code(cheat_manager_state.search_bit_size, idx, 0xFF,
-                     cheat_manager_state.big_endian, curr_val))
-               {
-                  runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                  return 0;
-               }
-               num_added++;
-            }
-         }
+      cheat_search_address(cheat_manager_state.search, candidate, &address, &address_mask);
+      curr_val = cheat_search_read(&memory, address, bytes_per_item, false);
 
+      if (!cheat_manager_add_new_code(cheat_manager_state.search_bit_size, address, address_mask,
+            cheat_manager_state.big_endian, curr_val))
+      {
+         runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         return 0;
       }
+      num_added++;
    }
 
    snprintf(msg, sizeof(msg), msg_hash_to_str(MSG_CHEAT_SEARCH_ADDED_MATCHES_SUCCESS), cheat_manager_state.num_matches);
@@ -1500,18 +1405,15 @@ void cheat_manager_apply_retro_cheats(void)
 void cheat_manager_match_action(enum cheat_match_action_type match_action, unsigned int target_match_idx, unsigned int *address, unsigned int *address_mask,
       unsigned int *prev_value, unsigned int *curr_value)
 {
-   unsigned int byte_part;
+   cheat_search_memory_t memory;
+   size_t candidate = 0;
    unsigned int idx;
-   unsigned int start_idx;
    unsigned int mask = 0;
    unsigned int bytes_per_item = 1;
    unsigned int bits = 8;
    unsigned int curr_val = 0;
    unsigned int prev_val = 0;
-   unsigned int offset = 0;
-   unsigned char *curr = cheat_manager_state.curr_memory_buf;
-   unsigned char *prev = cheat_manager_state.prev_memory_buf;
-   unsigned int curr_match_idx = 0;
+   unsigned int match_mask = 0;
 
    if (target_match_idx > cheat_manager_state.num_matches - 1)
       return;
@@ -1520,141 +1422,51 @@ void cheat_manager_match_action(enum cheat_match_action_type match_action, unsig
       return;
 
    cheat_manager_setup_search_meta(cheat_manager_state.search_bit_size, &bytes_per_item, &mask, &bits);
+   cheat_manager_search_memory(&memory);
 
    if (match_action == CHEAT_MATCH_ACTION_TYPE_BROWSE)
-      start_idx = *address;
-   else
-      start_idx = 0;
-
-   for (idx = start_idx; idx < cheat_manager_state.total_memory_size; idx = idx + bytes_per_item)
    {
-      offset = translate_address(idx, &curr);
-
-      switch (bytes_per_item)
-      {
-      case 2:
-         curr_val = cheat_manager_state.big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-         if (prev)
-            prev_val = cheat_manager_state.big_endian ?
-                  (*(prev + idx) * 256) + *(prev + idx + 1) :
-                  *(prev + idx) + (*(prev + idx + 1) * 256);
-         break;
-      case 4:
-         curr_val = cheat_manager_state.big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-         if (prev)
-            prev_val = cheat_manager_state.big_endian ?
-                  (*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
-                  *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + (*(prev + idx + 3) * 256 * 256 * 256);
-         break;
-      case 1:
-      default:
-         curr_val = *(curr + idx - offset);
-         if (prev)
-            prev_val = *(prev + idx);
-         break;
-      }
+      idx = *address;
 
-      if (match_action == CHEAT_MATCH_ACTION_TYPE_BROWSE)
-      {
-         *curr_value = curr_val;
-         *prev_value = prev_val;
+      if (idx >= cheat_manager_state.total_memory_size)
          return;
-      }
 
-      if (!prev)
-         return;
+      *curr_value = cheat_search_read(&memory, idx, bytes_per_item, false);
+      *prev_value = memory.prev ?
+         cheat_search_read(&memory, idx, bytes_per_item, true) : 0;
+      return;
+   }
 
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
-      {
-         unsigned int prev_match;
+   if (!memory.prev || !cheat_search_nth(cheat_manager_state.search, target_match_idx, &candidate))
+      return;
 
-         if (bits < 8)
-         {
-            prev_match = *(cheat_manager_state.matches + idx) & (mask << (byte_part * bits));
-            if (prev_match)
-            {
-               if (target_match_idx == curr_match_idx)
-               {
-                  switch (match_action)
-                  {
-                  case CHEAT_MATCH_ACTION_TYPE_BROWSE:
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_VIEW:
-                     *address = idx;
-                     *address_mask = (mask << (byte_part * bits));
-                     *curr_value = curr_val;
-                     *prev_value = prev_val;
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_COPY:
-                     if (!cheat_manager_add_new_code(cheat_manager_state.search_bit_size, idx, (mask << (byte_part * bits)),
-                           cheat_manager_state.big_endian, curr_val))
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     else
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_DELETE:
-                     if (bits < 8)
-                        *(cheat_manager_state.matches + idx) = *(cheat_manager_state.matches + idx) &
-                              ((~(mask << (byte_part * bits))) & 0xFF);
-                     else
-                        memset(cheat_manager_state.matches + idx, 0, bytes_per_item);
-                     if (cheat_manager_state.num_matches > 0)
-                        cheat_manager_state.num_matches--;
-                     runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  }
-                  return;
-               }
-               curr_match_idx++;
-            }
-         }
-         else
-         {
-            prev_match = *(cheat_manager_state.matches + idx);
-            if (prev_match)
-            {
-               if (target_match_idx == curr_match_idx)
-               {
-                  switch (match_action)
-                  {
-                  case CHEAT_MATCH_ACTION_TYPE_BROWSE:
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_VIEW:
-                     *address = idx;
-                     *address_mask = 0xFF;
-                     *curr_value = curr_val;
-                     *prev_value = prev_val;
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_COPY:
-                     if (!cheat_manager_add_new_code(cheat_manager_state.search_bit_size, idx, 0xFF,
-                           cheat_manager_state.big_endian, curr_val))
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     else
-                        runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  case CHEAT_MATCH_ACTION_TYPE_DELETE:
-                     if (bits < 8)
-                        *(cheat_manager_state.matches + idx) = *(cheat_manager_state.matches + idx) &
-                              ((~(mask << (byte_part * bits))) & 0xFF);
-                     else
-                        memset(cheat_manager_state.matches + idx, 0, bytes_per_item);
-                     if (cheat_manager_state.num_matches > 0)
-                        cheat_manager_state.num_matches--;
-                     runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
-                     return;
-                  }
-               }
+   cheat_search_address(cheat_manager_state.search, candidate, &idx, &match_mask);
+   curr_val = cheat_search_read(&memory, idx, bytes_per_item, false);
+   prev_val = cheat_search_read(&memory, idx, bytes_per_item, true);
 
-               curr_match_idx++;
-            }
-         }
-      }
+   switch (match_action)
+   {
+   case CHEAT_MATCH_ACTION_TYPE_VIEW:
+      *address = idx;
+      *address_mask = match_mask;
+      *curr_value = curr_val;
+      *prev_value = prev_val;
+      break;
+   case CHEAT_MATCH_ACTION_TYPE_COPY:
+      if (!cheat_manager_add_new_code(cheat_manager_state.search_bit_size, idx, match_mask,
+            cheat_manager_state.big_endian, curr_val))
+         runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_FAIL), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      else
+         runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_ADD_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      break;
+   case CHEAT_MATCH_ACTION_TYPE_DELETE:
+      cheat_search_remove(cheat_manager_state.search, candidate);
+      cheat_manager_state.num_matches = (unsigned)cheat_search_count(cheat_manager_state.search);
+      runloop_msg_queue_push(msg_hash_to_str(MSG_CHEAT_SEARCH_DELETE_MATCH_SUCCESS), 1, 180, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      break;
+   default:
+      break;
    }
-
 }
 int cheat_manager_copy_match(rarch_setting_t *setting, bool wraparound)
 {
@@ -160,7 +160,8 @@ struct cheat_manager
    unsigned total_memory_size;
    uint8_t *curr_memory_buf;
    uint8_t *prev_memory_buf;
-   uint8_t *matches;
+   /* Candidates left of the running search */
+   struct cheat_search *search;
    uint8_t **memory_buf_list;
    unsigned *memory_size_list;
    unsigned num_memory_buffers;
@@ -0,0 +1,1157 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_inline.h>
+#include <retro_miscellaneous.h>
+#include <features/features_cpu.h>
+
+#if defined(_MSC_VER) && !defined(_XBOX) && (_MSC_VER > 1310)
+#include <intrin.h>
+#endif
+
+#include "cheat_search.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(__i486__) || defined(__i686__) || defined(_M_IX86) || defined(_M_AMD64) || defined(_M_X64)
+#define CPU_X86
+#endif
+
+#if __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* AVX2 is not part of the baseline; build it with a target
+ * attribute and only use it if the CPU reports it. */
+#if defined(CPU_X86)
+#if defined(__clang__)
+#if (__clang_major__ > 3) || (__clang_major__ == 3 && __clang_minor__ >= 8)
+#define CHEAT_SEARCH_HAVE_AVX2
+#define CHEAT_SEARCH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__GNUC__)
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define CHEAT_SEARCH_HAVE_AVX2
+#define CHEAT_SEARCH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(_MSC_VER) && (_MSC_VER >= 1800)
+#define CHEAT_SEARCH_HAVE_AVX2
+#define CHEAT_SEARCH_TARGET_AVX2
+#endif
+#endif
+
+/* The NEON kernels have not been run on ARM hardware yet; build
+ * with -DCHEAT_SEARCH_WANT_NEON to use them, and check them with
+ * samples/cheat_search first. */
+#if defined(CHEAT_SEARCH_WANT_NEON) && (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#define CHEAT_SEARCH_HAVE_NEON
+#endif
+
+#if defined(CHEAT_SEARCH_HAVE_AVX2)
+#include <immintrin.h>
+#endif
+
+#if defined(CHEAT_SEARCH_HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+/* Candidates per word of the set, and words per summary word.
+ * The job pool splits the set on summary words, so no two jobs
+ * ever write the same word. */
+#define CHEAT_SEARCH_WORD_BITS    64
+#define CHEAT_SEARCH_SUMMARY_BITS 64
+
+/* Words with at most this many candidates left are compared one
+ * candidate at a time, it's cheaper than loading 64 items. */
+#define CHEAT_SEARCH_SPARSE_WORD  8
+
+/* Byte sized items are looked up in a table of all current and
+ * previous byte pairs if there are at least this many left and
+ * no SIMD kernel can compare them. */
+#define CHEAT_SEARCH_TABLE_MIN    65536
+
+/* Jobs per thread of the pool, evens out regions which have
+ * lost most of their candidates already. */
+#define CHEAT_SEARCH_JOBS_PER_THREAD 4
+
+typedef struct cheat_search_query
+{
+   enum cheat_search_type type;
+   unsigned value;
+   bool big_endian;
+} cheat_search_query_t;
+
+/* Compares 64 consecutive items of the current and previous
+ * memory, returns a bit for each item which passes. */
+typedef uint64_t (*cheat_search_kernel_t)(const uint8_t *curr,
+      const uint8_t *prev, const cheat_search_query_t *query);
+
+struct cheat_search
+{
+   /* One bit per candidate, and one bit per word of those
+    * which still holds a candidate. */
+   uint64_t *words;
+   uint64_t *summary;
+   size_t num_candidates;
+   size_t num_words;
+   size_t num_summary;
+   size_t count;
+
+   unsigned bit_size;
+   unsigned bytes_per_item;
+   /* Items smaller than a byte, 1 and 8 for larger ones */
+   unsigned items_per_byte;
+   unsigned item_bits;
+};
+
+typedef struct cheat_search_step_ctx
+{
+   cheat_search_t *search;
+   const cheat_search_memory_t *memory;
+   /* Address of each region, plus the end of the memory */
+   const size_t *starts;
+   cheat_search_kernel_t kernel;
+   /* Matching items of each byte, indexed by curr << 8 | prev */
+   uint8_t *table;
+   cheat_search_query_t query;
+   size_t summary_per_job;
+   size_t counts[VIDEO_FRAME_JOBS_MAX];
+} cheat_search_step_ctx_t;
+
+static INLINE unsigned cheat_search_popcount(uint64_t x)
+{
+#if defined(__GNUC__)
+   return __builtin_popcountll(x);
+#else
+   const uint64_t m1  = ~(uint64_t)0 / 3;
+   const uint64_t m2  = ~(uint64_t)0 / 5;
+   const uint64_t m4  = ~(uint64_t)0 / 17;
+   const uint64_t h01 = ~(uint64_t)0 / 255;
+
+   x = x - ((x >> 1) & m1);
+   x = (x & m2) + ((x >> 2) & m2);
+   x = (x + (x >> 4)) & m4;
+   return (unsigned)((x * h01) >> 56);
+#endif
+}
+
+/* Index of the lowest set bit, x must not be zero. */
+static INLINE unsigned cheat_search_ctz(uint64_t x)
+{
+#if defined(__GNUC__)
+   return __builtin_ctzll(x);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64)) && !defined(_XBOX)
+   unsigned long r = 0;
+   _BitScanForward64(&r, x);
+   return (unsigned)r;
+#else
+   unsigned r = 0;
+   while (!(x & 1))
+   {
+      x >>= 1;
+      r++;
+   }
+   return r;
+#endif
+}
+
+static INLINE unsigned cheat_search_value(const uint8_t *data,
+      unsigned bytes, bool big_endian)
+{
+   switch (bytes)
+   {
+      case 2:
+         return big_endian ?
+            (data[0] << 8) | data[1] :
+            data[0] | (data[1] << 8);
+      case 4:
+         return big_endian ?
+            ((unsigned)data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3] :
+            data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned)data[3] << 24);
+      default:
+         break;
+   }
+
+   return data[0];
+}
+
+/* Same arithmetic as the comparisons always had, values are
+ * compared as unsigned int. */
+static INLINE bool cheat_search_match(const cheat_search_query_t *query,
+      unsigned curr, unsigned prev)
+{
+   switch (query->type)
+   {
+      case CHEAT_SEARCH_TYPE_EXACT:
+         return curr == query->value;
+      case CHEAT_SEARCH_TYPE_LT:
+         return curr < prev;
+      case CHEAT_SEARCH_TYPE_GT:
+         return curr > prev;
+      case CHEAT_SEARCH_TYPE_LTE:
+         return curr <= prev;
+      case CHEAT_SEARCH_TYPE_GTE:
+         return curr >= prev;
+      case CHEAT_SEARCH_TYPE_EQ:
+         return curr == prev;
+      case CHEAT_SEARCH_TYPE_NEQ:
+         return curr != prev;
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+         return curr == prev + query->value;
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         return curr == prev - query->value;
+   }
+
+   return false;
+}
+
+/* Without SIMD, 16 and 32-bit items are still compared in runs
+ * of 64, which saves looking up their region one by one. Bytes
+ * go through a table, see cheat_search_table_new(). */
+static INLINE uint64_t cheat_search_kernel_generic(const uint8_t *curr,
+      const uint8_t *prev, const cheat_search_query_t *query,
+      unsigned bytes)
+{
+   unsigned i;
+   uint64_t matches = 0;
+
+   for (i = 0; i < 64; i++)
+      if (cheat_search_match(query,
+               cheat_search_value(curr + i * bytes, bytes, query->big_endian),
+               cheat_search_value(prev + i * bytes, bytes, query->big_endian)))
+         matches |= (uint64_t)1 << i;
+
+   return matches;
+}
+
+static uint64_t cheat_search_kernel16_generic(const uint8_t *curr,
+      const uint8_t *prev, const cheat_search_query_t *query)
+{
+   return cheat_search_kernel_generic(curr, prev, query, 2);
+}
+
+static uint64_t cheat_search_kernel32_generic(const uint8_t *curr,
+      const uint8_t *prev, const cheat_search_query_t *query)
+{
+   return cheat_search_kernel_generic(curr, prev, query, 4);
+}
+
+/* The SIMD comparisons below work on the item width, where the
+ * additions can't overflow into the upper bits like they do as
+ * unsigned int. For 8 and 16-bit items EQPLUS and EQMINUS only
+ * match without wrapping around, which is what unsigned int
+ * arithmetic gives as long as the operand fits the item. */
+#if __SSE2__ || defined(CHEAT_SEARCH_HAVE_AVX2)
+#define CHEAT_SEARCH_X86_COMPARE(name, attr, vec, mm, si, w, sign) \
+static INLINE attr vec name(vec c, vec p, const cheat_search_query_t *query) \
+{ \
+   const vec ones  = mm##set1_epi32(-1); \
+   const vec bias  = mm##set1_epi##w(sign); \
+   const vec value = mm##set1_epi##w(query->value); \
+   vec cs, ps; \
+   switch (query->type) \
+   { \
+      case CHEAT_SEARCH_TYPE_EXACT: \
+         return mm##cmpeq_epi##w(c, value); \
+      case CHEAT_SEARCH_TYPE_EQ: \
+         return mm##cmpeq_epi##w(c, p); \
+      case CHEAT_SEARCH_TYPE_NEQ: \
+         return mm##xor_##si(mm##cmpeq_epi##w(c, p), ones); \
+      case CHEAT_SEARCH_TYPE_EQPLUS: \
+         if (w == 32) \
+            return mm##cmpeq_epi##w(c, mm##add_epi##w(p, value)); \
+         /* curr >= value && curr - value == prev */ \
+         return mm##andnot_##si( \
+               mm##cmpgt_epi##w(mm##xor_##si(value, bias), mm##xor_##si(c, bias)), \
+               mm##cmpeq_epi##w(mm##sub_epi##w(c, value), p)); \
+      case CHEAT_SEARCH_TYPE_EQMINUS: \
+         if (w == 32) \
+            return mm##cmpeq_epi##w(c, mm##sub_epi##w(p, value)); \
+         /* prev >= value && prev - value == curr */ \
+         return mm##andnot_##si( \
+               mm##cmpgt_epi##w(mm##xor_##si(value, bias), mm##xor_##si(p, bias)), \
+               mm##cmpeq_epi##w(mm##sub_epi##w(p, value), c)); \
+      default: \
+         break; \
+   } \
+   /* Unsigned order, with the sign bits flipped */ \
+   cs = mm##xor_##si(c, bias); \
+   ps = mm##xor_##si(p, bias); \
+   switch (query->type) \
+   { \
+      case CHEAT_SEARCH_TYPE_LT: \
+         return mm##cmpgt_epi##w(ps, cs); \
+      case CHEAT_SEARCH_TYPE_GT: \
+         return mm##cmpgt_epi##w(cs, ps); \
+      case CHEAT_SEARCH_TYPE_LTE: \
+         return mm##xor_##si(mm##cmpgt_epi##w(cs, ps), ones); \
+      case CHEAT_SEARCH_TYPE_GTE: \
+         return mm##xor_##si(mm##cmpgt_epi##w(ps, cs), ones); \
+      default: \
+         break; \
+   } \
+   return mm##setzero_##si(); \
+}
+#endif
+
+#if __SSE2__
+#define CHEAT_SEARCH_TARGET_SSE2
+
+CHEAT_SEARCH_X86_COMPARE(cheat_search_compare8_sse2,
+      CHEAT_SEARCH_TARGET_SSE2, __m128i, _mm_, si128, 8, (char)0x80)
+CHEAT_SEARCH_X86_COMPARE(cheat_search_compare16_sse2,
+      CHEAT_SEARCH_TARGET_SSE2, __m128i, _mm_, si128, 16, (short)0x8000)
+CHEAT_SEARCH_X86_COMPARE(cheat_search_compare32_sse2,
+      CHEAT_SEARCH_TARGET_SSE2, __m128i, _mm_, si128, 32, (int)0x80000000)
+
+static INLINE __m128i cheat_search_bswap16_sse2(__m128i x)
+{
+   return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+static INLINE __m128i cheat_search_bswap32_sse2(__m128i x)
+{
+   x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xB1), 0xB1);
+   return cheat_search_bswap16_sse2(x);
+}
+
+static uint64_t cheat_search_kernel8_sse2(const uint8_t *curr,
+      const uint8_t *prev, const cheat_search_query_t *query)
+{
+   unsigned i;
+   uint64_t matches = 0;
+
+   for (i = 0; i < 64; i += 16)
+   {
+      __m128i c = _mm_loadu_si128((const __m128i*)(curr + i));
+      __m128i p = _mm_loadu_si128((const __m128i*)(prev + i));
+      matches  |= (uint64_t)(unsigned)_mm_movemask_epi8(
+            cheat_search_compare8_sse2(c, p, query)) << i;
+   }
+
+   return matches;
+}
+
+static uint64_t cheat_search_kernel16_sse2(const uint8_t *curr,
+      const uint8_t *prev, const cheat_search_query_t *query)
+{
+   unsigned i;
+   uint64_t matches = 0;
+
+   for (i = 0; i < 64; i += 16)
+   {
+      __m128i c0 = _mm_loadu_si128((const __m128i*)(curr + i * 2));
+      __m128i c1 = _mm_loadu_si128((const __m128i*)(curr + i * 2 + 16));
+      __m128i p0 = _mm_loadu_si128((const __m128i*)(prev + i * 2));
+      __m128i p1 = _mm_loadu_si128((const __m128i*)(prev + i * 2 + 16));
+
+      if (query->big_endian)
+      {
+         c0 = cheat_search_bswap16_sse2(c0);
+         c1 = cheat_search_bswap16_sse2(c1);
+         p0 = cheat_search_bswap16_sse2(p0);
+         p1 = cheat_search_bswap16_sse2(p1);
+      }
+
+      matches   |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_packs_epi16(
+               cheat_search_compare16_sse2(c0, p0, query),
+               cheat_search_compare16_sse2(c1, p1, query))) << i;
+   }
+
+   return matches;
+}
+
+static uint64_t cheat_search_kernel32_sse2(const uint8_t *curr,
+      const uint8_t *prev, const cheat_search_query_t *query)
+{
+   unsigned i;
+   uint64_t matches = 0;
+
+   for (i = 0; i < 64; i += 4)
+   {
+      __m128i c = _mm_loadu_si128((const __m128i*)(curr + i * 4));
+      __m128i p = _mm_loadu_si128((const __m128i*)(prev + i * 4));
+
+      if (query->big_endian)
+      {
+         c = cheat_search_bswap32_sse2(c);
+         p = cheat_search_bswap32_sse2(p);
+      }
+
+      matches  |= (uint64_t)(unsigned)_mm_movemask_ps(_mm_castsi128_ps(
+               cheat_search_compare32_sse2(c, p, query))) << i;
+   }
+
+   return matches;
+}
+#endif
+
+#if defined(CHEAT_SEARCH_HAVE_AVX2)
+CHEAT_SEARCH_X86_COMPARE(cheat_search_compare8_avx2,
+      CHEAT_SEARCH_TARGET_AVX2, __m256i, _mm256_, si256, 8, (char)0x80)
+CHEAT_SEARCH_X86_COMPARE(cheat_search_compare16_avx2,
+      CHEAT_SEARCH_TARGET_AVX2, __m256i, _mm256_, si256, 16, (short)0x8000)
+CHEAT_SEARCH_X86_COMPARE(cheat_search_compare32_avx2,
+      CHEAT_SEARCH_TARGET_AVX2, __m256i, _mm256_, si256, 32, (int)0x80000000)
+
+static INLINE CHEAT_SEARCH_TARGET_AVX2 __m256i cheat_search_load_avx2(
+      const uint8_t *ptr, unsigned bytes, bool big_endian)
+{
+   __m256i v = _mm256_loadu_si256((const __m256i*)ptr);
+
+   if (big_endian)
+   {
+      if (bytes == 2)
+         return _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+                  1,  0,  3,  2,  5,  4,  7,  6,
+                  9,  8, 11, 10, 13, 12, 15, 14,
+                  1,  0,  3,  2,  5,  4,  7,  6,
+                  9,  8, 11, 10, 13, 12, 15, 14));
+      return _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+               3,  2,  1,  0,  7,  6,  5,  4,
+              11, 10,  9,  8, 15, 14, 13, 12,
+               3,  2,  1,  0,  7,  6,  5,  4,
+              11, 10,  9,  8, 15, 14, 13, 12));
+   }
+
+   return v;
+}
+
+static CHEAT_SEARCH_TARGET_AVX2 uint64_t cheat_search_kernel8_avx2(
+      const uint8_t *curr, const uint8_t *prev,
+      const cheat_search_query_t *query)
+{
+   unsigned i;
+   uint64_t matches = 0;
+
+   for (i = 0; i < 64; i += 32)
+   {
+      __m256i c = _mm256_loadu_si256((const __m256i*)(curr + i));
+      __m256i p = _mm256_loadu_si256((const __m256i*)(prev + i));
+      matches  |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+            cheat_search_compare8_avx2(c, p, query)) << i;
+   }
+
+   return matches;
+}
+
+static CHEAT_SEARCH_TARGET_AVX2 uint64_t cheat_search_kernel16_avx2(
+      const uint8_t *curr, const uint8_t *prev,
+      const cheat_search_query_t *query)
+{
+   unsigned i;
+   uint64_t matches = 0;
+
+   for (i = 0; i < 64; i += 32)
+   {
+      __m256i c0 = cheat_search_load_avx2(curr + i * 2,      2, query->big_endian);
+      __m256i c1 = cheat_search_load_avx2(curr + i * 2 + 32, 2, query->big_endian);
+      __m256i p0 = cheat_search_load_avx2(prev + i * 2,      2, query->big_endian);
+      __m256i p1 = cheat_search_load_avx2(prev + i * 2 + 32, 2, query->big_endian);
+      /* packs works per 128-bit lane, put the quarters back in order */
+      __m256i m  = _mm256_permute4x64_epi64(_mm256_packs_epi16(
+               cheat_search_compare16_avx2(c0, p0, query),
+               cheat_search_compare16_avx2(c1, p1, query)), 0xD8);
+      matches   |= (uint64_t)(uint32_t)_mm256_movemask_epi8(m) << i;
+   }
+
+   return matches;
+}
+
+static CHEAT_SEARCH_TARGET_AVX2 uint64_t cheat_search_kernel32_avx2(
+      const uint8_t *curr, const uint8_t *prev,
+      const cheat_search_query_t *query)
+{
+   unsigned i;
+   uint64_t matches = 0;
+
+   for (i = 0; i < 64; i += 8)
+   {
+      __m256i c = cheat_search_load_avx2(curr + i * 4, 4, query->big_endian);
+      __m256i p = cheat_search_load_avx2(prev + i * 4, 4, query->big_endian);
+      matches  |= (uint64_t)(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(
+               cheat_search_compare32_avx2(c, p, query))) << i;
+   }
+
+   return matches;
+}
+#endif
+
+#if defined(CHEAT_SEARCH_HAVE_NEON)
+#define CHEAT_SEARCH_NEON_COMPARE(name, vec, sfx, w) \
+static INLINE vec name(vec c, vec p, const cheat_search_query_t *query) \
+{ \
+   const vec value = vdupq_n_##sfx(query->value); \
+   switch (query->type) \
+   { \
+      case CHEAT_SEARCH_TYPE_EXACT: \
+         return vceqq_##sfx(c, value); \
+      case CHEAT_SEARCH_TYPE_LT: \
+         return vcltq_##sfx(c, p); \
+      case CHEAT_SEARCH_TYPE_GT: \
+         return vcgtq_##sfx(c, p); \
+      case CHEAT_SEARCH_TYPE_LTE: \
+         return vcleq_##sfx(c, p); \
+      case CHEAT_SEARCH_TYPE_GTE: \
+         return vcgeq_##sfx(c, p); \
+      case CHEAT_SEARCH_TYPE_EQ: \
+         return vceqq_##sfx(c, p); \
+      case CHEAT_SEARCH_TYPE_NEQ: \
+         return vmvnq_##sfx(vceqq_##sfx(c, p)); \
+      case CHEAT_SEARCH_TYPE_EQPLUS: \
+         if (w == 32) \
+            return vceqq_##sfx(c, vaddq_##sfx(p, value)); \
+         return vandq_##sfx(vcgeq_##sfx(c, value), \
+               vceqq_##sfx(vsubq_##sfx(c, value), p)); \
+      case CHEAT_SEARCH_TYPE_EQMINUS: \
+         if (w == 32) \
+            return vceqq_##sfx(c, vsubq_##sfx(p, value)); \
+         return vandq_##sfx(vcgeq_##sfx(p, value), \
+               vceqq_##sfx(vsubq_##sfx(p, value), c)); \
+   } \
+   return vdupq_n_##sfx(0); \
+}
+
+CHEAT_SEARCH_NEON_COMPARE(cheat_search_compare8_neon,  uint8x16_t, u8,  8)
+CHEAT_SEARCH_NEON_COMPARE(cheat_search_compare16_neon, uint16x8_t, u16, 16)
+CHEAT_SEARCH_NEON_COMPARE(cheat_search_compare32_neon, uint32x4_t, u32, 32)
+
+/* One bit per lane of a byte mask, like _mm_movemask_epi8(). */
+static INLINE unsigned cheat_search_movemask_neon(uint8x16_t m)
+{
+   static const uint8_t weights[16] = {
+      1, 2, 4, 8, 16, 32, 64, 128,
+      1, 2, 4, 8, 16, 32, 64, 128
+   };
+   uint8x16_t t = vandq_u8(m, vld1q_u8(weights));
+   uint8x8_t  s = vpadd_u8(vget_low_u8(t), vget_high_u8(t));
+   s            = vpadd_u8(s, s);
+   s            = vpadd_u8(s, s);
+   return vget_lane_u8(s, 0) | (vget_lane_u8(s, 1) << 8);
+}
+
+static INLINE uint8x16_t cheat_search_load_neon(const uint8_t *ptr,
+      unsigned bytes, bool big_endian)
+{
+   uint8x16_t v = vld1q_u8(ptr);
+
+   if (big_endian)
+      return bytes == 2 ? vrev16q_u8(v) : vrev32q_u8(v);
+   return v;
+}
+
+static uint64_t cheat_search_kernel8_neon(const uint8_t *curr,
+      const uint8_t *prev, const cheat_search_query_t *query)
+{
+   unsigned i;
+   uint64_t matches = 0;
+
+   for (i = 0; i < 64; i += 16)
+      matches |= (uint64_t)cheat_search_movemask_neon(
+            cheat_search_compare8_neon(vld1q_u8(curr + i),
+               vld1q_u8(prev + i), query)) << i;
+
+   return matches;
+}
+
+static uint64_t cheat_search_kernel16_neon(const uint8_t *curr,
+      const uint8_t *prev, const cheat_search_query_t *query)
+{
+   unsigned i;
+   uint64_t matches = 0;
+
+   for (i = 0; i < 64; i += 16)
+   {
+      uint16x8_t m0 = cheat_search_compare16_neon(
+            vreinterpretq_u16_u8(cheat_search_load_neon(curr + i * 2,      2, query->big_endian)),
+            vreinterpretq_u16_u8(cheat_search_load_neon(prev + i * 2,      2, query->big_endian)),
+            query);
+      uint16x8_t m1 = cheat_search_compare16_neon(
+            vreinterpretq_u16_u8(cheat_search_load_neon(curr + i * 2 + 16, 2, query->big_endian)),
+            vreinterpretq_u16_u8(cheat_search_load_neon(prev + i * 2 + 16, 2, query->big_endian)),
+            query);
+      matches      |= (uint64_t)cheat_search_movemask_neon(
+            vcombine_u8(vmovn_u16(m0), vmovn_u16(m1))) << i;
+   }
+
+   return matches;
+}
+
+static uint64_t cheat_search_kernel32_neon(const uint8_t *curr,
+      const uint8_t *prev, const cheat_search_query_t *query)
+{
+   unsigned i, j;
+   uint64_t matches = 0;
+
+   for (i = 0; i < 64; i += 16)
+   {
+      uint32x4_t m[4];
+
+      for (j = 0; j < 4; j++)
+         m[j] = cheat_search_compare32_neon(
+               vreinterpretq_u32_u8(cheat_search_load_neon(curr + i * 4 + j * 16, 4, query->big_endian)),
+               vreinterpretq_u32_u8(cheat_search_load_neon(prev + i * 4 + j * 16, 4, query->big_endian)),
+               query);
+
+      matches |= (uint64_t)cheat_search_movemask_neon(vcombine_u8(
+               vmovn_u16(vcombine_u16(vmovn_u32(m[0]), vmovn_u32(m[1]))),
+               vmovn_u16(vcombine_u16(vmovn_u32(m[2]), vmovn_u32(m[3]))))) << i;
+   }
+
+   return matches;
+}
+#endif
+
+struct cheat_search_kernels
+{
+   const char *ident;
+   /* RETRO_SIMD_* flags the kernels need */
+   uint64_t simd;
+   /* For 8, 16 and 32-bit items */
+   cheat_search_kernel_t items[3];
+};
+
+/* In order of preference */
+static const struct cheat_search_kernels cheat_search_kernels[] = {
+#if defined(CHEAT_SEARCH_HAVE_AVX2)
+   { "avx2",    RETRO_SIMD_AVX2, { cheat_search_kernel8_avx2, cheat_search_kernel16_avx2, cheat_search_kernel32_avx2 } },
+#endif
+#if defined(CHEAT_SEARCH_HAVE_NEON)
+   { "neon",    RETRO_SIMD_NEON, { cheat_search_kernel8_neon, cheat_search_kernel16_neon, cheat_search_kernel32_neon } },
+#endif
+#if __SSE2__
+   { "sse2",    RETRO_SIMD_SSE2, { cheat_search_kernel8_sse2, cheat_search_kernel16_sse2, cheat_search_kernel32_sse2 } },
+#endif
+   { "generic", 0,               { NULL, cheat_search_kernel16_generic, cheat_search_kernel32_generic } },
+};
+
+/* Picked by cheat_search_kernel_init() */
+static const struct cheat_search_kernels *cheat_search_kernel = NULL;
+
+static void cheat_search_kernel_init(void)
+{
+   unsigned i;
+   uint64_t cpu = cpu_features_get();
+
+   for (i = 0; (cpu & cheat_search_kernels[i].simd)
+         != cheat_search_kernels[i].simd; )
+      i++;
+   cheat_search_kernel = &cheat_search_kernels[i];
+}
+
+const char *cheat_search_kernel_name(void)
+{
+   if (!cheat_search_kernel)
+      cheat_search_kernel_init();
+   return cheat_search_kernel->ident;
+}
+
+static uint8_t cheat_search_byte(const cheat_search_memory_t *memory,
+      size_t address)
+{
+   unsigned i;
+
+   for (i = 0; i < memory->num_regions; i++)
+   {
+      if (address < memory->sizes[i])
+         return memory->regions[i][address];
+      address -= memory->sizes[i];
+   }
+
+   return 0;
+}
+
+unsigned cheat_search_read(const cheat_search_memory_t *memory,
+      size_t address, unsigned bytes, bool prev)
+{
+   unsigned i;
+   uint8_t data[4] = {0};
+   size_t size     = 0;
+
+   if (prev)
+      for (i = 0; i < memory->num_regions; i++)
+         size += memory->sizes[i];
+
+   for (i = 0; i < bytes && i < sizeof(data); i++)
+   {
+      if (!prev)
+         data[i] = cheat_search_byte(memory, address + i);
+      else if (address + i < size)
+         data[i] = memory->prev[address + i];
+   }
+
+   return cheat_search_value(data, bytes, memory->big_endian);
+}
+
+/* Region holding @address, looking forward from @region first
+ * since addresses mostly only grow. */
+static INLINE unsigned cheat_search_region(const cheat_search_step_ctx_t *ctx,
+      size_t address, unsigned region)
+{
+   if (address < ctx->starts[region])
+      region = 0;
+   while (region + 1 < ctx->memory->num_regions
+         && address >= ctx->starts[region + 1])
+      region++;
+   return region;
+}
+
+static uint8_t *cheat_search_table_new(const cheat_search_t *search,
+      const cheat_search_query_t *query)
+{
+   unsigned curr, prev, part;
+   unsigned mask  = (1 << search->item_bits) - 1;
+   uint8_t *table = (uint8_t*)malloc(256 * 256);
+
+   if (!table)
+      return NULL;
+
+   for (curr = 0; curr < 256; curr++)
+   {
+      for (prev = 0; prev < 256; prev++)
+      {
+         uint8_t matches = 0;
+
+         for (part = 0; part < search->items_per_byte; part++)
+         {
+            unsigned shift = part * search->item_bits;
+
+            if (cheat_search_match(query, (curr >> shift) & mask,
+                     (prev >> shift) & mask))
+               matches |= 1 << part;
+         }
+
+         table[(curr << 8) | prev] = matches;
+      }
+   }
+
+   return table;
+}
+
+static INLINE uint64_t cheat_search_table_word(const uint8_t *table,
+      const uint8_t *curr, const uint8_t *prev, unsigned bytes,
+      unsigned items_per_byte)
+{
+   unsigned i;
+   uint64_t matches = 0;
+
+   for (i = 0; i < bytes; i++)
+      matches |= (uint64_t)table[(curr[i] << 8) | prev[i]]
+         << (i * items_per_byte);
+
+   return matches;
+}
+
+static bool cheat_search_step_candidate(const cheat_search_step_ctx_t *ctx,
+      size_t candidate, unsigned *region)
+{
+   const cheat_search_t *search        = ctx->search;
+   const cheat_search_memory_t *memory = ctx->memory;
+   unsigned curr, prev;
+
+   if (search->items_per_byte > 1)
+   {
+      size_t address = candidate / search->items_per_byte;
+      unsigned shift = (unsigned)(candidate % search->items_per_byte)
+         * search->item_bits;
+      unsigned mask  = (1 << search->item_bits) - 1;
+
+      *region        = cheat_search_region(ctx, address, *region);
+      curr           = (memory->regions[*region][address
+            - ctx->starts[*region]] >> shift) & mask;
+      prev           = (memory->prev[address] >> shift) & mask;
+   }
+   else
+   {
+      unsigned bytes = search->bytes_per_item;
+      size_t address = candidate * bytes;
+
+      *region        = cheat_search_region(ctx, address, *region);
+      if (address + bytes <= ctx->starts[*region + 1])
+         curr        = cheat_search_value(memory->regions[*region]
+               + address - ctx->starts[*region], bytes, memory->big_endian);
+      else
+         curr        = cheat_search_read(memory, address, bytes, false);
+      prev           = cheat_search_value(memory->prev + address,
+            bytes, memory->big_endian);
+   }
+
+   return cheat_search_match(&ctx->query, curr, prev);
+}
+
+static uint64_t cheat_search_step_word(const cheat_search_step_ctx_t *ctx,
+      size_t index, uint64_t word, unsigned *region)
+{
+   const cheat_search_t *search = ctx->search;
+   size_t first                 = index * CHEAT_SEARCH_WORD_BITS;
+   uint64_t pending;
+
+   if (     (ctx->kernel || ctx->table)
+         && cheat_search_popcount(word) > CHEAT_SEARCH_SPARSE_WORD)
+   {
+      size_t bytes   = CHEAT_SEARCH_WORD_BITS * search->bytes_per_item
+         / search->items_per_byte;
+      size_t address = first * search->bytes_per_item
+         / search->items_per_byte;
+      const uint8_t *curr, *prev;
+
+      *region        = cheat_search_region(ctx, address, *region);
+
+      /* All items in one region, this also keeps the loads
+       * inside the memory for the last word. */
+      if (address + bytes <= ctx->starts[*region + 1])
+      {
+         curr = ctx->memory->regions[*region] + address - ctx->starts[*region];
+         prev = ctx->memory->prev + address;
+
+         if (ctx->kernel)
+            return word & ctx->kernel(curr, prev, &ctx->query);
+         return word & cheat_search_table_word(ctx->table, curr, prev,
+               (unsigned)bytes, search->items_per_byte);
+      }
+   }
+
+   for (pending = word; pending; pending &= pending - 1)
+   {
+      unsigned bit = cheat_search_ctz(pending);
+
+      if (!cheat_search_step_candidate(ctx, first + bit, region))
+         word &= ~((uint64_t)1 << bit);
+   }
+
+   return word;
+}
+
+/* Steps the words covered by summary words [start, end). */
+static size_t cheat_search_step_range(const cheat_search_step_ctx_t *ctx,
+      size_t start, size_t end)
+{
+   size_t i;
+   size_t count           = 0;
+   unsigned region        = 0;
+   cheat_search_t *search = ctx->search;
+
+   for (i = start; i < end; i++)
+   {
+      uint64_t pending;
+
+      for (pending = search->summary[i]; pending; pending &= pending - 1)
+      {
+         unsigned bit = cheat_search_ctz(pending);
+         size_t index = i * CHEAT_SEARCH_SUMMARY_BITS + bit;
+         uint64_t word = cheat_search_step_word(ctx, index,
+               search->words[index], &region);
+
+         search->words[index] = word;
+         if (word)
+            count += cheat_search_popcount(word);
+         else
+            search->summary[i] &= ~((uint64_t)1 << bit);
+      }
+   }
+
+   return count;
+}
+
+static void cheat_search_step_job(void *data, unsigned index)
+{
+   cheat_search_step_ctx_t *ctx = (cheat_search_step_ctx_t*)data;
+   size_t start                 = index * ctx->summary_per_job;
+   size_t end                   = MIN(start + ctx->summary_per_job,
+         ctx->search->num_summary);
+
+   ctx->counts[index]           = cheat_search_step_range(ctx, start, end);
+}
+
+size_t cheat_search_step(cheat_search_t *search,
+      const cheat_search_memory_t *memory,
+      enum cheat_search_type type, unsigned value,
+      video_frame_jobs_t *jobs)
+{
+   unsigned i;
+   unsigned threads;
+   size_t *starts;
+   cheat_search_step_ctx_t *ctx;
+
+   if (!search || !memory || !memory->num_regions)
+      return search ? search->count : 0;
+
+   starts = (size_t*)malloc((memory->num_regions + 1) * sizeof(*starts));
+   ctx    = (cheat_search_step_ctx_t*)calloc(1, sizeof(*ctx));
+
+   if (!starts || !ctx)
+   {
+      free(starts);
+      free(ctx);
+      return search->count;
+   }
+
+   starts[0] = 0;
+   for (i = 0; i < memory->num_regions; i++)
+      starts[i + 1] = starts[i] + memory->sizes[i];
+
+   ctx->search           = search;
+   ctx->memory           = memory;
+   ctx->starts           = starts;
+   ctx->query.type       = type;
+   ctx->query.value      = value;
+   ctx->query.big_endian = memory->big_endian;
+
+   if (search->items_per_byte == 1)
+   {
+      unsigned width = search->bytes_per_item == 4 ? 2
+         : search->bytes_per_item - 1;
+      unsigned max   = search->bytes_per_item == 4 ? 0xFFFFFFFF
+         : (1u << (8 * search->bytes_per_item)) - 1;
+
+      ctx->kernel    = cheat_search_kernel->items[width];
+
+      /* An operand wider than the item only matches through the
+       * unsigned int wrap around, which the SIMD kernels don't do. */
+      if (cheat_search_kernel->simd && value > max && (type == CHEAT_SEARCH_TYPE_EXACT
+               || type == CHEAT_SEARCH_TYPE_EQPLUS
+               || type == CHEAT_SEARCH_TYPE_EQMINUS))
+         ctx->kernel = NULL;
+   }
+
+   if (     !ctx->kernel && search->bytes_per_item == 1
+         && search->count >= CHEAT_SEARCH_TABLE_MIN)
+      ctx->table = cheat_search_table_new(search, &ctx->query);
+
+   threads = jobs ? video_frame_jobs_num_threads(jobs) : 1;
+
+   if (threads > 1 && search->num_summary > 1)
+   {
+      unsigned count;
+
+      ctx->summary_per_job = (search->num_summary
+            + threads * CHEAT_SEARCH_JOBS_PER_THREAD - 1)
+         / (threads * CHEAT_SEARCH_JOBS_PER_THREAD);
+      count                = (unsigned)((search->num_summary
+               + ctx->summary_per_job - 1) / ctx->summary_per_job);
+
+      video_frame_jobs_run(jobs, cheat_search_step_job, ctx, count);
+
+      search->count = 0;
+      for (i = 0; i < count; i++)
+         search->count += ctx->counts[i];
+   }
+   else
+      search->count = cheat_search_step_range(ctx, 0, search->num_summary);
+
+   free(ctx->table);
+   free(starts);
+   free(ctx);
+
+   return search->count;
+}
+
+cheat_search_t *cheat_search_new(unsigned bit_size, size_t memory_size)
+{
+   size_t i;
+   cheat_search_t *search = (cheat_search_t*)calloc(1, sizeof(*search));
+
+   if (!search)
+      return NULL;
+
+   if (!cheat_search_kernel)
+      cheat_search_kernel_init();
+
+   search->bit_size = bit_size;
+
+   if (bit_size < 3)
+   {
+      search->bytes_per_item = 1;
+      search->item_bits      = 1 << bit_size;
+      search->items_per_byte = 8 >> bit_size;
+      search->num_candidates = memory_size * search->items_per_byte;
+   }
+   else
+   {
+      search->bytes_per_item = 1 << (MIN(bit_size, 5) - 3);
+      search->item_bits      = 8;
+      search->items_per_byte = 1;
+      search->num_candidates = memory_size / search->bytes_per_item;
+   }
+
+   search->num_words   = (search->num_candidates + CHEAT_SEARCH_WORD_BITS - 1)
+      / CHEAT_SEARCH_WORD_BITS;
+   search->num_summary = (search->num_words + CHEAT_SEARCH_SUMMARY_BITS - 1)
+      / CHEAT_SEARCH_SUMMARY_BITS;
+   search->count       = search->num_candidates;
+
+   if (search->num_words)
+   {
+      search->words   = (uint64_t*)malloc(
+            search->num_words * sizeof(*search->words));
+      search->summary = (uint64_t*)calloc(
+            search->num_summary, sizeof(*search->summary));
+
+      if (!search->words || !search->summary)
+      {
+         cheat_search_free(search);
+         return NULL;
+      }
+
+      memset(search->words, 0xFF, search->num_words * sizeof(*search->words));
+      if (search->num_candidates % CHEAT_SEARCH_WORD_BITS)
+         search->words[search->num_words - 1] = ((uint64_t)1
+               << (search->num_candidates % CHEAT_SEARCH_WORD_BITS)) - 1;
+
+      for (i = 0; i < search->num_words; i++)
+         search->summary[i / CHEAT_SEARCH_SUMMARY_BITS] |=
+            (uint64_t)1 << (i % CHEAT_SEARCH_SUMMARY_BITS);
+   }
+
+   return search;
+}
+
+void cheat_search_free(cheat_search_t *search)
+{
+   if (!search)
+      return;
+
+   free(search->words);
+   free(search->summary);
+   free(search);
+}
+
+unsigned cheat_search_bit_size(const cheat_search_t *search)
+{
+   return search->bit_size;
+}
+
+size_t cheat_search_count(const cheat_search_t *search)
+{
+   return search ? search->count : 0;
+}
+
+bool cheat_search_next(const cheat_search_t *search, size_t *candidate)
+{
+   size_t index, i;
+   unsigned bit;
+   uint64_t word, pending;
+
+   if (!search || *candidate >= search->num_candidates)
+      return false;
+
+   index = *candidate / CHEAT_SEARCH_WORD_BITS;
+   word  = search->words[index]
+      & (~(uint64_t)0 << (*candidate % CHEAT_SEARCH_WORD_BITS));
+
+   if (word)
+   {
+      *candidate = index * CHEAT_SEARCH_WORD_BITS + cheat_search_ctz(word);
+      return true;
+   }
+
+   /* Words after this one, found through the summary */
+   i       = index / CHEAT_SEARCH_SUMMARY_BITS;
+   bit     = index % CHEAT_SEARCH_SUMMARY_BITS;
+   pending = bit == CHEAT_SEARCH_SUMMARY_BITS - 1 ? 0
+      : search->summary[i] & (~(uint64_t)0 << (bit + 1));
+
+   for (;;)
+   {
+      if (pending)
+      {
+         index      = i * CHEAT_SEARCH_SUMMARY_BITS + cheat_search_ctz(pending);
+         *candidate = index * CHEAT_SEARCH_WORD_BITS
+            + cheat_search_ctz(search->words[index]);
+         return true;
+      }
+
+      if (++i >= search->num_summary)
+         return false;
+      pending = search->summary[i];
+   }
+}
+
+bool cheat_search_nth(const cheat_search_t *search, size_t n,
+      size_t *candidate)
+{
+   size_t i;
+
+   if (!search || n >= search->count)
+      return false;
+
+   for (i = 0; i < search->num_summary; i++)
+   {
+      uint64_t pending;
+
+      for (pending = search->summary[i]; pending; pending &= pending - 1)
+      {
+         size_t index  = i * CHEAT_SEARCH_SUMMARY_BITS
+            + cheat_search_ctz(pending);
+         uint64_t word = search->words[index];
+         unsigned bits = cheat_search_popcount(word);
+
+         if (n >= bits)
+         {
+            n -= bits;
+            continue;
+         }
+
+         while (n--)
+            word &= word - 1;
+
+         *candidate = index * CHEAT_SEARCH_WORD_BITS + cheat_search_ctz(word);
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void cheat_search_remove(cheat_search_t *search, size_t candidate)
+{
+   size_t index;
+   uint64_t bit;
+
+   if (!search || candidate >= search->num_candidates)
+      return;
+
+   index = candidate / CHEAT_SEARCH_WORD_BITS;
+   bit   = (uint64_t)1 << (candidate % CHEAT_SEARCH_WORD_BITS);
+
+   if (!(search->words[index] & bit))
+      return;
+
+   search->words[index] &= ~bit;
+   search->count--;
+
+   if (!search->words[index])
+      search->summary[index / CHEAT_SEARCH_SUMMARY_BITS] &=
+         ~((uint64_t)1 << (index % CHEAT_SEARCH_SUMMARY_BITS));
+}
+
+void cheat_search_address(const cheat_search_t *search, size_t candidate,
+      unsigned *address, unsigned *address_mask)
+{
+   if (search->items_per_byte > 1)
+   {
+      *address      = (unsigned)(candidate / search->items_per_byte);
+      *address_mask = ((1 << search->item_bits) - 1)
+         << ((candidate % search->items_per_byte) * search->item_bits);
+   }
+   else
+   {
+      *address      = (unsigned)(candidate * search->bytes_per_item);
+      *address_mask = 0xFF;
+   }
+}
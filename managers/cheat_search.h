@@ -0,0 +1,138 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CHEAT_SEARCH_H
+#define __CHEAT_SEARCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+#include "cheat_manager.h"
+#include "../gfx/video_frame_jobs.h"
+
+/* Memory at least this large is searched on the shared job pool */
+#define CHEAT_SEARCH_THREADED_MIN_SIZE (4 * 1024 * 1024)
+
+RETRO_BEGIN_DECLS
+
+typedef struct cheat_search cheat_search_t;
+
+/* The memory a search runs over. Addresses are offsets into the
+ * regions laid out back to back, the way prev holds them. */
+typedef struct cheat_search_memory
+{
+   uint8_t **regions;
+   const unsigned *sizes;
+   const uint8_t *prev;
+   unsigned num_regions;
+   bool big_endian;
+} cheat_search_memory_t;
+
+/**
+ * cheat_search_new:
+ * @bit_size     : Search size as in cheat_manager::search_bit_size,
+ *                 0 to 5 for 1, 2, 4, 8, 16 and 32-bit items.
+ * @memory_size  : Total size of the searched memory in bytes.
+ *
+ * Creates a candidate set holding every item of the memory.
+ *
+ * Returns: the candidate set, or NULL on allocation failure.
+ **/
+cheat_search_t *cheat_search_new(unsigned bit_size, size_t memory_size);
+
+void cheat_search_free(cheat_search_t *search);
+
+unsigned cheat_search_bit_size(const cheat_search_t *search);
+
+/**
+ * cheat_search_step:
+ * @search       : The candidate set.
+ * @memory       : Current memory and its copy of the previous step.
+ * @type         : Comparison to run.
+ * @value        : Operand of the EXACT, EQPLUS and EQMINUS comparisons.
+ * @jobs         : Job pool to split the memory over, or NULL.
+ *
+ * Drops every candidate that doesn't pass the comparison. Only
+ * words of the candidate set which still hold candidates are
+ * looked at, dense words are compared with SIMD where the items
+ * lie in a single region.
+ *
+ * Returns: the number of candidates left.
+ **/
+size_t cheat_search_step(cheat_search_t *search,
+      const cheat_search_memory_t *memory,
+      enum cheat_search_type type, unsigned value,
+      video_frame_jobs_t *jobs);
+
+size_t cheat_search_count(const cheat_search_t *search);
+
+/**
+ * cheat_search_next:
+ * @search       : The candidate set.
+ * @candidate    : Candidate to start from, set to the one found.
+ *
+ * Finds the first candidate at or after @candidate.
+ *
+ * Returns: false if there is none.
+ **/
+bool cheat_search_next(const cheat_search_t *search, size_t *candidate);
+
+/**
+ * cheat_search_nth:
+ * @search       : The candidate set.
+ * @n            : Zero-based index among the remaining candidates.
+ * @candidate    : Set to the candidate found.
+ *
+ * Returns: false if fewer than @n + 1 candidates are left.
+ **/
+bool cheat_search_nth(const cheat_search_t *search, size_t n,
+      size_t *candidate);
+
+void cheat_search_remove(cheat_search_t *search, size_t candidate);
+
+/**
+ * cheat_search_address:
+ * @search       : The candidate set.
+ * @candidate    : A candidate.
+ * @address      : Set to the address of its first byte.
+ * @address_mask : Set to the bits of that byte the candidate covers,
+ *                 0xFF for items of 8 bits and more.
+ **/
+void cheat_search_address(const cheat_search_t *search, size_t candidate,
+      unsigned *address, unsigned *address_mask);
+
+/**
+ * cheat_search_read:
+ * @memory       : The memory.
+ * @address      : Address of the item.
+ * @bytes        : Size of the item, 1, 2 or 4 bytes.
+ * @prev         : Read from the previous step's copy instead.
+ *
+ * Reads an item, which may span more than one region.
+ *
+ * Returns: the value, 0 for bytes past the end of the memory.
+ **/
+unsigned cheat_search_read(const cheat_search_memory_t *memory,
+      size_t address, unsigned bytes, bool prev);
+
+const char *cheat_search_kernel_name(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -26,6 +26,10 @@
 #include <retro_inline.h>
 #include <compat/strl.h>
 #include <compat/intrinsics.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "state_manager.h"
 #include "../msg_hash.h"
@@ -62,46 +66,76 @@
 #include <emmintrin.h>
 #endif
 
-/* There's no equivalent in libc, you'd think so ...
- * std::mismatch exists, but it's not optimized at all. */
-static size_t find_change(const uint16_t *a, const uint16_t *b)
-{
-#if __SSE2__
-   const __m128i *a128 = (const __m128i*)a;
-   const __m128i *b128 = (const __m128i*)b;
+/* AVX2 is not part of the baseline; build it with a target
+ * attribute and only use it if the CPU reports it. */
+#if defined(CPU_X86)
+#if defined(__clang__)
+#if (__clang_major__ > 3) || (__clang_major__ == 3 && __clang_minor__ >= 8)
+#define STATE_MANAGER_HAVE_AVX2
+#define STATE_MANAGER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__GNUC__)
+#if (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define STATE_MANAGER_HAVE_AVX2
+#define STATE_MANAGER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(_MSC_VER) && (_MSC_VER >= 1800)
+#define STATE_MANAGER_HAVE_AVX2
+#define STATE_MANAGER_TARGET_AVX2
+#endif
+#endif
 
-   for (;;)
-   {
-      __m128i v0    = _mm_loadu_si128(a128);
-      __m128i v1    = _mm_loadu_si128(b128);
-      __m128i c     = _mm_cmpeq_epi32(v0, v1);
-      uint32_t mask = _mm_movemask_epi8(c);
+/* The NEON kernels have not been run on ARM hardware yet; build
+ * with -DSTATE_MANAGER_WANT_NEON to use them, and check them with
+ * samples/rewind first. */
+#if defined(STATE_MANAGER_WANT_NEON) && (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#define STATE_MANAGER_HAVE_NEON
+#endif
 
-      if (mask != 0xffff) /* Something has changed, figure out where. */
-      {
-         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
-               (compat_ctz(~mask))) >> 1;
-         return ret | (a[ret] == b[ret]);
-      }
+#if defined(STATE_MANAGER_HAVE_AVX2)
+#include <immintrin.h>
+#endif
 
-      a128++;
-      b128++;
-   }
-#else
+#if defined(STATE_MANAGER_HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifdef HAVE_THREADS
+/* States at least this large are diffed on worker threads */
+#define STATE_MANAGER_THREADED_MIN_SIZE (1024 * 1024)
+/* Smallest piece of a state diffed by a single worker */
+#define STATE_MANAGER_MIN_CHUNK_SIZE    (256 * 1024)
+#define STATE_MANAGER_MAX_WORKERS       8
+#endif
+
+/* There's no equivalent in libc, you'd think so ...
+ * std::mismatch exists, but it's not optimized at all.
+ *
+ * find_change() returns the index of the first word that differs,
+ * find_same() the index of the first run of (usually) two equal
+ * words. Both scans stop after about 'len' words; the result may
+ * overshoot 'len' slightly, callers have to clamp it.
+ *
+ * The vector versions read up to 32 bytes past 'len', see
+ * state_manager_raw_alloc(). */
+static size_t find_change_generic(const uint16_t *a,
+      const uint16_t *b, size_t len)
+{
    const uint16_t *a_org = a;
+   const uint16_t *a_end = a + len;
 #ifdef NO_UNALIGNED_MEM
-   while (((uintptr_t)a & (sizeof(size_t) - 1)) && *a == *b)
+   while (((uintptr_t)a & (sizeof(size_t) - 1)) && a < a_end && *a == *b)
    {
       a++;
       b++;
    }
-   if (*a == *b)
+   if (a < a_end && *a == *b)
 #endif
    {
       const size_t *a_big = (const size_t*)a;
       const size_t *b_big = (const size_t*)b;
 
-      while (*a_big == *b_big)
+      while ((const uint16_t*)a_big < a_end && *a_big == *b_big)
       {
          a_big++;
          b_big++;
@@ -109,19 +143,20 @@ static size_t find_change(const uint16_t *a, const uint16_t *b)
       a = (const uint16_t*)a_big;
       b = (const uint16_t*)b_big;
 
-      while (*a == *b)
+      while (a < a_end && *a == *b)
       {
          a++;
          b++;
       }
    }
    return a - a_org;
-#endif
 }
 
-static size_t find_same(const uint16_t *a, const uint16_t *b)
+static size_t find_same_generic(const uint16_t *a,
+      const uint16_t *b, size_t len)
 {
    const uint16_t *a_org = a;
+   const uint16_t *a_end = a + len;
 #ifdef NO_UNALIGNED_MEM
    if (((uintptr_t)a & (sizeof(uint32_t) - 1)) && *a != *b)
    {
@@ -142,7 +177,7 @@ static size_t find_same(const uint16_t *a, const uint16_t *b)
       const uint32_t *a_big = (const uint32_t*)a;
       const uint32_t *b_big = (const uint32_t*)b;
 
-      while (*a_big != *b_big)
+      while ((const uint16_t*)a_big < a_end && *a_big != *b_big)
       {
          a_big++;
          b_big++;
@@ -159,6 +194,186 @@ static size_t find_same(const uint16_t *a, const uint16_t *b)
    return a - a_org;
 }
 
+#if __SSE2__
+static size_t find_change_sse2(const uint16_t *a,
+      const uint16_t *b, size_t len)
+{
+   size_t i;
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
+
+   for (i = 0; i < len; i += 8)
+   {
+      __m128i v0    = _mm_loadu_si128(a128);
+      __m128i v1    = _mm_loadu_si128(b128);
+      __m128i c     = _mm_cmpeq_epi32(v0, v1);
+      uint32_t mask = _mm_movemask_epi8(c);
+
+      if (mask != 0xffff) /* Something has changed, figure out where. */
+      {
+         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
+               (compat_ctz(~mask))) >> 1;
+         return ret | (a[ret] == b[ret]);
+      }
+
+      a128++;
+      b128++;
+   }
+
+   return len;
+}
+#endif
+
+#if defined(STATE_MANAGER_HAVE_AVX2)
+static STATE_MANAGER_TARGET_AVX2 size_t find_change_avx2(
+      const uint16_t *a, const uint16_t *b, size_t len)
+{
+   size_t i;
+
+   for (i = 0; i < len; i += 16)
+   {
+      __m256i v0    = _mm256_loadu_si256((const __m256i*)(a + i));
+      __m256i v1    = _mm256_loadu_si256((const __m256i*)(b + i));
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi32(v0, v1));
+
+      if (mask != 0xffffffff)
+      {
+         /* The compare works on pairs of words,
+          * the pair's second word may be the first change. */
+         size_t ret = i + (compat_ctz(~mask) >> 1);
+         return ret | (a[ret] == b[ret]);
+      }
+   }
+
+   return len;
+}
+
+static STATE_MANAGER_TARGET_AVX2 size_t find_same_avx2(
+      const uint16_t *a, const uint16_t *b, size_t len)
+{
+   size_t i;
+
+   for (i = 0; i < len; i += 16)
+   {
+      __m256i v0    = _mm256_loadu_si256((const __m256i*)(a + i));
+      __m256i v1    = _mm256_loadu_si256((const __m256i*)(b + i));
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi32(v0, v1));
+
+      if (mask)
+      {
+         /* Same rounding as find_same_generic() */
+         size_t ret = i + (compat_ctz(mask) >> 1);
+         if (ret && a[ret - 1] == b[ret - 1])
+            ret--;
+         return ret;
+      }
+   }
+
+   return len;
+}
+#endif
+
+#if defined(STATE_MANAGER_HAVE_NEON)
+/* 32-bit ARM has no across-vector ops, so the lane masks are
+ * narrowed to 64 bits and tested as a whole; the exact position
+ * is then found with a scalar pass over the 8 words. */
+static size_t find_change_neon(const uint16_t *a,
+      const uint16_t *b, size_t len)
+{
+   size_t i, j;
+
+   for (i = 0; i < len; i += 8)
+   {
+      uint16x8_t c = vceqq_u16(vld1q_u16(a + i), vld1q_u16(b + i));
+      uint64_t   m = vget_lane_u64(vreinterpret_u64_u8(
+               vmovn_u16(c)), 0);
+
+      if (m != UINT64_MAX)
+      {
+         for (j = i; a[j] == b[j]; j++);
+         return j;
+      }
+   }
+
+   return len;
+}
+
+static size_t find_same_neon(const uint16_t *a,
+      const uint16_t *b, size_t len)
+{
+   size_t i, j;
+
+   for (i = 0; i < len; i += 8)
+   {
+      uint32x4_t c = vceqq_u32(
+            vreinterpretq_u32_u16(vld1q_u16(a + i)),
+            vreinterpretq_u32_u16(vld1q_u16(b + i)));
+      uint64_t   m = vget_lane_u64(vreinterpret_u64_u16(
+               vmovn_u32(c)), 0);
+
+      if (m)
+      {
+         /* Same rounding as find_same_generic() */
+         for (j = i; a[j] != b[j] || a[j + 1] != b[j + 1]; j += 2);
+         if (j && a[j - 1] == b[j - 1])
+            j--;
+         return j;
+      }
+   }
+
+   return len;
+}
+#endif
+
+struct state_manager_kernel
+{
+   const char *ident;
+   /* RETRO_SIMD_* flags the kernel needs */
+   uint64_t simd;
+   size_t (*find_change)(const uint16_t *a,
+         const uint16_t *b, size_t len);
+   size_t (*find_same)(const uint16_t *a,
+         const uint16_t *b, size_t len);
+};
+
+/* In order of preference */
+static const struct state_manager_kernel state_manager_kernels[] = {
+#if defined(STATE_MANAGER_HAVE_AVX2)
+   { "avx2",    RETRO_SIMD_AVX2, find_change_avx2,    find_same_avx2    },
+#endif
+#if defined(STATE_MANAGER_HAVE_NEON)
+   { "neon",    RETRO_SIMD_NEON, find_change_neon,    find_same_neon    },
+#endif
+#if __SSE2__
+   { "sse2",    RETRO_SIMD_SSE2, find_change_sse2,    find_same_generic },
+#endif
+   { "generic", 0,               find_change_generic, find_same_generic },
+};
+
+/* Picked by state_manager_kernel_init() */
+static const struct state_manager_kernel *state_manager_kernel =
+      &state_manager_kernels[
+      sizeof(state_manager_kernels) / sizeof(state_manager_kernels[0]) - 1];
+
+static void state_manager_kernel_init(void)
+{
+   unsigned i;
+   uint64_t cpu = cpu_features_get();
+
+   for (i = 0; i < sizeof(state_manager_kernels)
+         / sizeof(state_manager_kernels[0]); i++)
+   {
+      if ((cpu & state_manager_kernels[i].simd)
+            == state_manager_kernels[i].simd)
+      {
+         state_manager_kernel = &state_manager_kernels[i];
+         return;
+      }
+   }
+}
+
 struct state_manager
 {
    uint8_t *data;
@@ -179,8 +394,34 @@ struct state_manager
     * (yes, the math is a bit ugly). */
    size_t maxcompsize;
 
+   /* The state is diffed in 'num_chunks' pieces of 'chunksize'
+    * bytes (the last one may be shorter), each with its own patch.
+    * Without worker threads there is only one. */
+   size_t chunksize;
+   unsigned num_chunks;
+
    unsigned entries;
    bool thisblock_valid;
+#ifdef HAVE_THREADS
+   /* Threaded mode: a push hands thisblock and nextblock to the
+    * workers and continues with spareblock. The patches the
+    * workers produce are written to 'data' on the next push or
+    * pop, see state_manager_flush(). */
+   uint8_t *spareblock;
+   uint8_t **patches;
+   size_t *patch_sizes;
+   const uint8_t *job_old;
+   const uint8_t *job_new;
+   sthread_t *workers[STATE_MANAGER_MAX_WORKERS];
+   slock_t *lock;
+   scond_t *work_cond;
+   scond_t *done_cond;
+   unsigned num_workers;
+   unsigned next_chunk;
+   unsigned chunks_done;
+   bool job_pending;
+   bool quit;
+#endif
 #if STRICT_BUF_SIZE
    size_t debugsize;
    uint8_t *debugblock;
@@ -190,18 +431,20 @@ struct state_manager
 /* Format per frame (pseudocode): */
 #if 0
 size nextstart;
-repeat {
-   uint16 numchanged; /* everything is counted in units of uint16 */
-   if (numchanged)
-   {
-      uint16 numunchanged; /* skip these before handling numchanged */
-      uint16[numchanged] changeddata;
-   }
-   else
-   {
-      uint32 numunchanged;
-      if (!numunchanged)
-         break;
+repeat num_chunks times { /* relative to the start of each chunk */
+   repeat {
+      uint16 numchanged; /* everything is counted in units of uint16 */
+      if (numchanged)
+      {
+         uint16 numunchanged; /* skip these before handling numchanged */
+         uint16[numchanged] changeddata;
+      }
+      else
+      {
+         uint32 numunchanged;
+         if (!numunchanged)
+            break;
+      }
    }
 }
 size thisstart;
@@ -238,7 +481,7 @@ static size_t state_manager_raw_maxsize(size_t uncomp)
 static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
 {
    size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
-   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 16, 1);
+   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 32, 1);
 
    /* Force in a different byte at the end, so we don't need to check
     * bounds in the innermost loop (it's expensive).
@@ -249,8 +492,8 @@ static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
     * There is also some padding at the end. This is so we don't
     * read outside the buffer end if we're reading in large blocks;
     *
-    * It doesn't make any difference to us, but sacrificing 16 bytes to get
-    * Valgrind happy is worth it. */
+    * It doesn't make any difference to us, but sacrificing 32 bytes
+    * (one AVX2 load) to get Valgrind happy is worth it. */
    ret[len16/sizeof(uint16_t) + 3] = uniq;
 
    return ret;
@@ -276,7 +519,8 @@ static size_t state_manager_raw_compress(const void *src,
    while (num16s)
    {
       size_t i, changed;
-      size_t skip = find_change(old16, new16);
+      size_t skip = state_manager_kernel->find_change(
+            old16, new16, num16s);
 
       if (skip >= num16s)
          break;
@@ -300,7 +544,9 @@ static size_t state_manager_raw_compress(const void *src,
          continue;
       }
 
-      changed = find_same(old16, new16);
+      changed = state_manager_kernel->find_same(old16, new16, num16s);
+      if (changed > num16s)
+         changed = num16s;
       if (changed > UINT16_MAX)
          changed = UINT16_MAX;
 
@@ -330,8 +576,10 @@ static size_t state_manager_raw_compress(const void *src,
  *
  * If the given arguments do not match a previous call to
  * state_manager_raw_compress(), anything at all can happen.
+ *
+ * Returns the end of the patch.
  */
-static void state_manager_raw_decompress(const void *patch,
+static const void *state_manager_raw_decompress(const void *patch,
       size_t patchlen, void *data, size_t datalen)
 {
    uint16_t         *out16 = (uint16_t*)data;
@@ -365,12 +613,15 @@ static void state_manager_raw_decompress(const void *patch,
       {
          uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
 
+         patch16 += 2;
+
          if (!numunchanged)
             break;
-         patch16 += 2;
          out16 += numunchanged;
       }
    }
+
+   return patch16;
 }
 
 /* The start offsets point to 'nextstart' of any given compressed frame.
@@ -408,11 +659,202 @@ static INLINE size_t read_size_t(const void *ptr)
    return ret;
 }
 
+static size_t state_manager_chunk_len(state_manager_t *state, unsigned chunk)
+{
+   size_t offset = chunk * state->chunksize;
+   size_t len    = state->blocksize - offset;
+
+   return len < state->chunksize ? len : state->chunksize;
+}
+
+/* Writes the patches that turn each chunk of 'newb'
+ * back into 'oldb' to 'patch', one after another */
+static size_t state_manager_compress_frame(state_manager_t *state,
+      const uint8_t *oldb, const uint8_t *newb, uint8_t *patch)
+{
+   unsigned i;
+   uint8_t *out = patch;
+
+   for (i = 0; i < state->num_chunks; i++)
+   {
+      size_t offset = i * state->chunksize;
+      out += state_manager_raw_compress(oldb + offset, newb + offset,
+            state_manager_chunk_len(state, i), out);
+   }
+
+   return out - patch;
+}
+
+static void state_manager_decompress_frame(state_manager_t *state,
+      const uint8_t *patch, uint8_t *data)
+{
+   unsigned i;
+
+   for (i = 0; i < state->num_chunks; i++)
+   {
+      size_t offset = i * state->chunksize;
+      size_t len    = state_manager_chunk_len(state, i);
+      patch         = (const uint8_t*)state_manager_raw_decompress(patch,
+            state_manager_raw_maxsize(len), data + offset, len);
+   }
+}
+
+#ifdef HAVE_THREADS
+static void state_manager_worker(void *data)
+{
+   state_manager_t *state = (state_manager_t*)data;
+
+   slock_lock(state->lock);
+
+   for (;;)
+   {
+      unsigned chunk;
+      size_t offset;
+
+      while (!state->quit && state->next_chunk >= state->num_chunks)
+         scond_wait(state->work_cond, state->lock);
+
+      if (state->quit)
+         break;
+
+      chunk  = state->next_chunk++;
+      offset = chunk * state->chunksize;
+
+      slock_unlock(state->lock);
+
+      state->patch_sizes[chunk] = state_manager_raw_compress(
+            state->job_old + offset, state->job_new + offset,
+            state_manager_chunk_len(state, chunk), state->patches[chunk]);
+
+      slock_lock(state->lock);
+
+      if (++state->chunks_done == state->num_chunks)
+         scond_signal(state->done_cond);
+   }
+
+   slock_unlock(state->lock);
+}
+
+static void state_manager_stop_workers(state_manager_t *state)
+{
+   unsigned i;
+
+   if (state->lock)
+   {
+      slock_lock(state->lock);
+      state->quit = true;
+      if (state->work_cond)
+         scond_broadcast(state->work_cond);
+      slock_unlock(state->lock);
+   }
+
+   for (i = 0; i < state->num_workers; i++)
+      sthread_join(state->workers[i]);
+   state->num_workers = 0;
+
+   if (state->patches)
+   {
+      for (i = 0; i < state->num_chunks; i++)
+         free(state->patches[i]);
+      free(state->patches);
+   }
+   if (state->patch_sizes)
+      free(state->patch_sizes);
+   if (state->spareblock)
+      free(state->spareblock);
+   if (state->work_cond)
+      scond_free(state->work_cond);
+   if (state->done_cond)
+      scond_free(state->done_cond);
+   if (state->lock)
+      slock_free(state->lock);
+
+   state->patches     = NULL;
+   state->patch_sizes = NULL;
+   state->spareblock  = NULL;
+   state->work_cond   = NULL;
+   state->done_cond   = NULL;
+   state->lock        = NULL;
+}
+
+/* Splits the state into one chunk per worker (but no
+ * smaller than STATE_MANAGER_MIN_CHUNK_SIZE) and starts
+ * the workers. On failure, the state manager stays
+ * single threaded. */
+static bool state_manager_start_workers(state_manager_t *state,
+      size_t state_size)
+{
+   unsigned i;
+   unsigned num_cores   = cpu_features_get_core_amount();
+   unsigned num_workers = num_cores > 1 ? num_cores - 1 : 1;
+   size_t chunksize     = 0;
+
+   if (num_workers > STATE_MANAGER_MAX_WORKERS)
+      num_workers = STATE_MANAGER_MAX_WORKERS;
+
+   chunksize = (state->blocksize + num_workers - 1) / num_workers;
+   if (chunksize < STATE_MANAGER_MIN_CHUNK_SIZE)
+      chunksize = STATE_MANAGER_MIN_CHUNK_SIZE;
+   /* Keep chunks 64 byte aligned */
+   chunksize = (chunksize + 63) & ~(size_t)63;
+
+   state->chunksize   = chunksize;
+   state->num_chunks  = (unsigned)((state->blocksize + chunksize - 1)
+         / chunksize);
+   state->next_chunk  = state->num_chunks;
+
+   state->spareblock  = (uint8_t*)state_manager_raw_alloc(state_size, 2);
+   state->patches     = (uint8_t**)calloc(state->num_chunks,
+         sizeof(*state->patches));
+   state->patch_sizes = (size_t*)calloc(state->num_chunks,
+         sizeof(*state->patch_sizes));
+   state->lock        = slock_new();
+   state->work_cond   = scond_new();
+   state->done_cond   = scond_new();
+
+   if (     !state->spareblock || !state->patches || !state->patch_sizes
+         || !state->lock || !state->work_cond || !state->done_cond)
+      goto error;
+
+   for (i = 0; i < state->num_chunks; i++)
+   {
+      if (!(state->patches[i] = (uint8_t*)malloc(state_manager_raw_maxsize(
+                  state_manager_chunk_len(state, i)))))
+         goto error;
+   }
+
+   if (num_workers > state->num_chunks)
+      num_workers = state->num_chunks;
+
+   for (i = 0; i < num_workers; i++)
+   {
+      if (!(state->workers[i] = sthread_create(state_manager_worker, state)))
+         break;
+      state->num_workers++;
+   }
+
+   if (state->num_workers == 0)
+      goto error;
+
+   return true;
+
+error:
+   state_manager_stop_workers(state);
+   state->chunksize   = state->blocksize;
+   state->num_chunks  = 1;
+   return false;
+}
+#endif
+
 static void state_manager_free(state_manager_t *state)
 {
    if (!state)
       return;
 
+#ifdef HAVE_THREADS
+   state_manager_stop_workers(state);
+#endif
+
    if (state->data)
       free(state->data);
    if (state->thisblock)
@@ -431,6 +873,7 @@ static void state_manager_free(state_manager_t *state)
 
 static state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
 {
+   unsigned i;
    size_t max_comp_size, block_size;
    uint8_t *next_block    = NULL;
    uint8_t *this_block    = NULL;
@@ -442,8 +885,29 @@ static state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
 
    block_size         = (state_size + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
 
+   state->blocksize   = block_size;
+   state->chunksize   = block_size;
+   state->num_chunks  = 1;
+
+   state_manager_kernel_init();
+   RARCH_LOG("[Rewind]: Using %s delta kernel.\n",
+         state_manager_kernel->ident);
+
+#ifdef HAVE_THREADS
+   if (state_size >= STATE_MANAGER_THREADED_MIN_SIZE)
+   {
+      if (state_manager_start_workers(state, state_size))
+         RARCH_LOG("[Rewind]: Diffing states in %u chunks on %u threads.\n",
+               state->num_chunks, state->num_workers);
+   }
+#endif
+
    /* the compressed data is surrounded by pointers to the other side */
-   max_comp_size      = state_manager_raw_maxsize(state_size) + sizeof(size_t) * 2;
+   max_comp_size      = sizeof(size_t) * 2;
+   for (i = 0; i < state->num_chunks; i++)
+      max_comp_size  += state_manager_raw_maxsize(
+            state_manager_chunk_len(state, i));
+
    state_data         = (uint8_t*)malloc(buffer_size);
 
    if (!state_data)
@@ -455,7 +919,6 @@ static state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
    if (!this_block || !next_block)
       goto error;
 
-   state->blocksize   = block_size;
    state->maxcompsize = max_comp_size;
    state->data        = state_data;
    state->thisblock   = this_block;
@@ -475,20 +938,97 @@ static state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
 error:
    if (state_data)
       free(state_data);
+   if (this_block)
+      free(this_block);
+   if (next_block)
+      free(next_block);
    state_manager_free(state);
    free(state);
 
    return NULL;
 }
 
+/* Makes room for a compressed frame at the head,
+ * discarding the oldest frames if needed. Returns
+ * where the compressed data goes. */
+static uint8_t *state_manager_reserve(state_manager_t *state)
+{
+   size_t headpos, tailpos, remaining;
+
+recheckcapacity:;
+
+   headpos = state->head - state->data;
+   tailpos = state->tail - state->data;
+   remaining = (tailpos + state->capacity -
+         sizeof(size_t) - headpos - 1) % state->capacity + 1;
+
+   if (remaining <= state->maxcompsize)
+   {
+      state->tail = state->data + read_size_t(state->tail);
+      state->entries--;
+      goto recheckcapacity;
+   }
+
+   return state->head + sizeof(size_t);
+}
+
+/* Links the frame ending at 'compressed' into the buffer */
+static void state_manager_commit(state_manager_t *state,
+      uint8_t *compressed)
+{
+   if (compressed - state->data + state->maxcompsize > state->capacity)
+   {
+      compressed = state->data;
+      if (state->tail == state->data + sizeof(size_t))
+         state->tail = state->data + read_size_t(state->tail);
+   }
+   write_size_t(compressed, state->head-state->data);
+   compressed += sizeof(size_t);
+   write_size_t(state->head, compressed-state->data);
+   state->head = compressed;
+}
+
+#ifdef HAVE_THREADS
+/* Waits for the workers to finish the last pushed
+ * state and writes its patches to the buffer */
+static void state_manager_flush(state_manager_t *state)
+{
+   unsigned i;
+   uint8_t *compressed = NULL;
+
+   if (!state->job_pending)
+      return;
+
+   slock_lock(state->lock);
+   while (state->chunks_done < state->num_chunks)
+      scond_wait(state->done_cond, state->lock);
+   slock_unlock(state->lock);
+
+   state->job_pending = false;
+
+   compressed = state_manager_reserve(state);
+
+   for (i = 0; i < state->num_chunks; i++)
+   {
+      memcpy(compressed, state->patches[i], state->patch_sizes[i]);
+      compressed += state->patch_sizes[i];
+   }
+
+   state_manager_commit(state, compressed);
+}
+#endif
+
 static bool state_manager_pop(state_manager_t *state, const void **data)
 {
    size_t start;
-   uint8_t *out                 = NULL;
    const uint8_t *compressed    = NULL;
 
    *data = NULL;
 
+#ifdef HAVE_THREADS
+   state_manager_flush(state);
+#endif
+
    if (state->thisblock_valid)
    {
       state->thisblock_valid = false;
@@ -505,10 +1045,8 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
    state->head = state->data + start;
 
    compressed = state->data + start + sizeof(size_t);
-   out = state->thisblock;
 
-   state_manager_raw_decompress(compressed,
-         state->maxcompsize, out, state->blocksize);
+   state_manager_decompress_frame(state, compressed, state->thisblock);
 
    state->entries--;
    return true;
@@ -546,43 +1084,43 @@ static void state_manager_push_do(state_manager_t *state)
 
    if (state->thisblock_valid)
    {
-      const uint8_t *oldb, *newb;
       uint8_t *compressed;
-      size_t headpos, tailpos, remaining;
+
       if (state->capacity < sizeof(size_t) + state->maxcompsize)
          return;
 
-recheckcapacity:;
-
-      headpos = state->head - state->data;
-      tailpos = state->tail - state->data;
-      remaining = (tailpos + state->capacity -
-            sizeof(size_t) - headpos - 1) % state->capacity + 1;
-
-      if (remaining <= state->maxcompsize)
+#ifdef HAVE_THREADS
+      if (state->num_workers)
       {
-         state->tail = state->data + read_size_t(state->tail);
-         state->entries--;
-         goto recheckcapacity;
-      }
+         state_manager_flush(state);
+
+         /* The workers diff thisblock against nextblock while the
+          * next state is serialized into what was spareblock,
+          * which the previous job was done with at the flush. */
+         slock_lock(state->lock);
+         state->job_old     = state->thisblock;
+         state->job_new     = state->nextblock;
+         state->next_chunk  = 0;
+         state->chunks_done = 0;
+         state->job_pending = true;
+         scond_broadcast(state->work_cond);
+         slock_unlock(state->lock);
+
+         swap               = state->spareblock;
+         state->spareblock  = state->thisblock;
+         state->thisblock   = state->nextblock;
+         state->nextblock   = swap;
 
-      oldb        = state->thisblock;
-      newb        = state->nextblock;
-      compressed  = state->head + sizeof(size_t);
+         state->entries++;
+         return;
+      }
+#endif
 
-      compressed += state_manager_raw_compress(oldb, newb,
-            state->blocksize, compressed);
+      compressed  = state_manager_reserve(state);
+      compressed += state_manager_compress_frame(state,
+            state->thisblock, state->nextblock, compressed);
 
-      if (compressed - state->data + state->maxcompsize > state->capacity)
-      {
-         compressed = state->data;
-         if (state->tail == state->data + sizeof(size_t))
-            state->tail = state->data + read_size_t(state->tail);
-      }
-      write_size_t(compressed, state->head-state->data);
-      compressed += sizeof(size_t);
-      write_size_t(state->head, compressed-state->data);
-      state->head = compressed;
+      state_manager_commit(state, compressed);
    }
    else
       state->thisblock_valid = true;
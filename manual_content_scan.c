@@ -866,10 +866,11 @@ bool manual_content_scan_get_task_config(
 /* Creates a list of all valid content in the specified
  * content directory
  * > Returns NULL in the event of failure
- * > Returned string list must be free()'d */
-struct string_list *manual_content_scan_get_content_list(manual_content_scan_task_config_t *task_config)
+ * > Returned list must be freed with
+ *   dir_list_parallel_free() */
+struct dir_list *manual_content_scan_get_content_list(manual_content_scan_task_config_t *task_config)
 {
-   struct string_list *dir_list = NULL;
+   struct dir_list *dir_list = NULL;
    bool filter_exts;
    bool include_compressed;
 
@@ -897,14 +898,18 @@ struct string_list *manual_content_scan_get_content_list(manual_content_scan_tas
 
    /* Get directory listing
     * > Exclude directories and hidden files
-    * > Scan recursively */
-   dir_list = dir_list_new(
+    * > Scan recursively, reading subdirectories
+    *   concurrently (content is often on network
+    *   shares, where each readdir() is slow) */
+   dir_list = dir_list_new_parallel(
          task_config->content_dir,
          filter_exts ? task_config->file_exts : NULL,
          false, /* include_dirs */
          false, /* include_hidden */
          include_compressed,
-         true   /* recursive */
+         true,  /* recursive */
+         false, /* get_size */
+         0      /* num_threads */
    );
 
    /* Sanity check */
@@ -918,13 +923,13 @@ struct string_list *manual_content_scan_get_content_list(manual_content_scan_tas
     * > Not strictly required, but task status
     *   messages will be unintuitive if we leave
     *   the order 'random' */
-   dir_list_sort(dir_list, true);
+   dir_list_parallel_sort(dir_list, true);
 
    return dir_list;
 
 error:
    if (dir_list)
-      string_list_free(dir_list);
+      dir_list_parallel_free(dir_list);
    return NULL;
 }
 
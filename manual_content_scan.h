@@ -29,6 +29,7 @@
 #include <boolean.h>
 
 #include <lists/string_list.h>
+#include <lists/dir_list.h>
 #include <formats/logiqx_dat.h>
 
 #include "playlist.h"
@@ -220,8 +221,9 @@ bool manual_content_scan_get_task_config(
 /* Creates a list of all valid content in the specified
  * content directory
  * > Returns NULL in the event of failure
- * > Returned string list must be free()'d */
-struct string_list *manual_content_scan_get_content_list(manual_content_scan_task_config_t *task_config);
+ * > Returned list must be freed with
+ *   dir_list_parallel_free() */
+struct dir_list *manual_content_scan_get_content_list(manual_content_scan_task_config_t *task_config);
 
 /* Adds specified content to playlist, if not already
  * present */
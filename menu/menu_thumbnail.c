@@ -35,6 +35,7 @@
 #include "menu_thumbnail.h"
 
 #include "../retroarch.h"
+#include "../verbosity.h"
 #include "../tasks/tasks_internal.h"
 
 /* When streaming thumbnails, to minimise the processing
@@ -60,12 +61,21 @@ static float menu_thumbnail_fade_duration = DEFAULT_MENU_THUMBNAIL_FADE_DURATION
  * at the time when the load completes */
 static uint64_t menu_thumbnail_list_id = 0;
 
+/* Time from request to texture upload of the most
+ * recent thumbnails. Once the buffer fills up, the
+ * median is logged along with the decoded image cache
+ * hit rate. */
+#define MENU_THUMBNAIL_LATENCY_SAMPLES 64
+static retro_time_t menu_thumbnail_latency[MENU_THUMBNAIL_LATENCY_SAMPLES];
+static unsigned menu_thumbnail_latency_count = 0;
+
 /* Utility structure, sent as userdata when pushing
  * an image load */
 typedef struct
 {
    menu_thumbnail_t *thumbnail;
    retro_time_t list_id;
+   retro_time_t request_time;
 } menu_thumbnail_tag_t;
 
 /* Setters */
@@ -101,6 +111,40 @@ float menu_thumbnail_get_fade_duration(void)
    return menu_thumbnail_fade_duration;
 }
 
+/* Utility functions */
+
+static int menu_thumbnail_latency_cmp(const void *a, const void *b)
+{
+   retro_time_t l = *(const retro_time_t*)a;
+   retro_time_t r = *(const retro_time_t*)b;
+
+   return (l > r) - (l < r);
+}
+
+static void menu_thumbnail_add_latency(retro_time_t latency)
+{
+   unsigned hits   = 0;
+   unsigned misses = 0;
+
+   menu_thumbnail_latency[menu_thumbnail_latency_count++] = latency;
+
+   if (menu_thumbnail_latency_count < MENU_THUMBNAIL_LATENCY_SAMPLES)
+      return;
+
+   menu_thumbnail_latency_count = 0;
+
+   qsort(menu_thumbnail_latency, MENU_THUMBNAIL_LATENCY_SAMPLES,
+         sizeof(retro_time_t), menu_thumbnail_latency_cmp);
+
+   task_image_cache_get_stats(&hits, &misses);
+
+   RARCH_LOG("[Thumbnail]: Cache hit rate %.1f%% (%u/%u), "
+         "median request to upload latency %.2f ms.\n",
+         (hits + misses) ? 100.0f * hits / (hits + misses) : 0.0f,
+         hits, hits + misses,
+         menu_thumbnail_latency[MENU_THUMBNAIL_LATENCY_SAMPLES / 2] / 1000.0f);
+}
+
 /* Callbacks */
 
 /* Used to process thumbnail data following completion
@@ -155,6 +199,10 @@ static void menu_thumbnail_handle_upload(
    /* Update thumbnail status */
    thumbnail_tag->thumbnail->status = MENU_THUMBNAIL_STATUS_AVAILABLE;
 
+   if (thumbnail_tag->request_time)
+      menu_thumbnail_add_latency(
+            cpu_features_get_time_usec() - thumbnail_tag->request_time);
+
    /* Trigger 'fade in' animation, if required */
    if (menu_thumbnail_fade_duration > 0.0f)
    {
@@ -245,12 +293,15 @@ void menu_thumbnail_request(
             return;
 
          /* Configure user data */
-         thumbnail_tag->thumbnail = thumbnail;
-         thumbnail_tag->list_id   = menu_thumbnail_list_id;
+         thumbnail_tag->thumbnail    = thumbnail;
+         thumbnail_tag->list_id      = menu_thumbnail_list_id;
+         thumbnail_tag->request_time = cpu_features_get_time_usec();
 
          /* Would like to cancel any existing image load tasks
-          * here, but can't see how to do it... */
-         if(task_push_image_load(
+          * here, but can't see how to do it...
+          * Playlist thumbnails are shown again and again,
+          * so they go through the decoded image cache */
+         if(task_push_image_load_cached(
                thumbnail_path, video_driver_supports_rgba(),
                menu_thumbnail_upscale_threshold,
                menu_thumbnail_handle_upload, thumbnail_tag))
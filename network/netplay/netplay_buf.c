@@ -63,6 +63,7 @@ bool netplay_init_socket_buffer(struct socket_buffer *sbuf, size_t size)
       return false;
    sbuf->bufsz = size;
    sbuf->start = sbuf->read = sbuf->end = 0;
+   sbuf->relay = NULL;
    return true;
 }
 
@@ -127,6 +128,9 @@ void netplay_clear_socket_buffer(struct socket_buffer *sbuf)
 bool netplay_send(struct socket_buffer *sbuf, int sockfd, const void *buf,
    size_t len)
 {
+   if (sbuf->relay)
+      return netplay_relay_send(sbuf->relay, buf, len);
+
    if (buf_remaining(sbuf) < len)
    {
       /* Need to force a blocking send */
@@ -177,6 +181,9 @@ bool netplay_send_flush(struct socket_buffer *sbuf, int sockfd, bool block)
 {
    ssize_t sent;
 
+   if (sbuf->relay)
+      return netplay_relay_flush(sbuf->relay);
+
    if (buf_used(sbuf) == 0)
       return true;
 
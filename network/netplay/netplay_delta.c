@@ -53,11 +53,16 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
        * so we can't overwrite it! */
       if (netplay->other_frame_count <= delta->frame)
          return false;
+      /* Nor the snapshot we'd replay it from */
+      if (netplay->sparse_snapshots && netplay->other_frame_count <
+            delta->frame + NETPLAY_SNAPSHOT_INTERVAL_MAX)
+         return false;
    }
 
-   delta->used  = true;
-   delta->frame = frame;
-   delta->crc   = 0;
+   delta->used       = true;
+   delta->frame      = frame;
+   delta->crc        = 0;
+   delta->have_state = false;
 
    for (i = 0; i < MAX_INPUT_DEVICES; i++)
    {
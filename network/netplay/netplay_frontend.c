@@ -253,9 +253,12 @@ static bool get_self_input_state(netplay_t *netplay)
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->send_packet_buffer.relay)
+         continue;
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
          netplay_send_cur_input(netplay, &netplay->connections[i]);
    }
+   netplay_send_cur_input_relayed(netplay);
 
    /* Handle any delayed state changes */
    if (netplay->is_server)
@@ -1230,6 +1233,75 @@ void netplay_send_savestate(netplay_t *netplay,
    }
 }
 
+/**
+ * netplay_send_savestate_delta
+ * @netplay              : pointer to netplay object
+ * @connection           : peer which supports NETPLAY_COMPRESSION_DELTA
+ * @serial_info          : the savestate being loaded
+ *
+ * Send a loaded savestate to a peer as a delta against the last one we
+ * sent it, through its compression scheme. Only what changed since goes
+ * over the wire, which keeps resyncs of cores with large states short.
+ */
+static void netplay_send_savestate_delta(netplay_t *netplay,
+   struct netplay_connection *connection,
+   retro_ctx_serialize_info_t *serial_info)
+{
+   uint32_t header[4];
+   uint32_t rd, wn;
+   size_t delta_size;
+   bool compressed;
+   enum trans_stream_error error;
+   struct compression_transcoder *z = &netplay->compress_nil;
+
+   if (connection->compression_supported & NETPLAY_COMPRESSION_ZLIB)
+      z = &netplay->compress_zlib;
+
+   if (!connection->savestate_sent)
+      connection->savestate_sent = (uint8_t*)calloc(netplay->state_size, 1);
+
+   if (!connection->savestate_sent || !netplay->state_delta)
+   {
+      netplay_hangup(netplay, connection);
+      return;
+   }
+
+   delta_size = netplay_state_delta_encode(connection->savestate_sent,
+      (const uint8_t*)serial_info->data_const,
+      MIN(serial_info->size, netplay->state_size), netplay->state_delta);
+
+   /* Compress it */
+   if (z->compression_backend->define)
+      z->compression_backend->define(z->compression_stream, "level",
+         NETPLAY_STATE_DELTA_ZLIB_LEVEL);
+   z->compression_backend->set_in(z->compression_stream,
+      netplay->state_delta, (uint32_t)delta_size);
+   z->compression_backend->set_out(z->compression_stream,
+      netplay->zbuffer, (uint32_t)netplay->zbuffer_size);
+   compressed = z->compression_backend->trans(z->compression_stream, true,
+      &rd, &wn, &error);
+   if (z->compression_backend->define)
+      z->compression_backend->define(z->compression_stream, "level",
+         NETPLAY_ZLIB_LEVEL);
+
+   if (!compressed)
+   {
+      netplay_hangup(netplay, connection);
+      return;
+   }
+
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
+   header[1] = htonl(wn + 2*sizeof(uint32_t));
+   header[2] = htonl(netplay->run_frame_count);
+   header[3] = htonl(serial_info->size);
+
+   if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
+         sizeof(header)) ||
+       !netplay_send(&connection->send_packet_buffer, connection->fd,
+         netplay->zbuffer, wn))
+      netplay_hangup(netplay, connection);
+}
+
 /**
  * netplay_load_savestate
  * @netplay              : pointer to netplay object
@@ -1243,6 +1315,7 @@ void netplay_send_savestate(netplay_t *netplay,
 void netplay_load_savestate(netplay_t *netplay,
       retro_ctx_serialize_info_t *serial_info, bool save)
 {
+   size_t i;
    retro_ctx_serialize_info_t tmp_serial_info;
 
    netplay_force_future(netplay);
@@ -1268,6 +1341,7 @@ void netplay_load_savestate(netplay_t *netplay,
                memcpy(netplay->buffer[netplay->run_ptr].state,
                      serial_info->data_const, serial_info->size);
          }
+         netplay->buffer[netplay->run_ptr].have_state = true;
       }
       /* FIXME: This is a critical failure! */
       else
@@ -1290,6 +1364,18 @@ void netplay_load_savestate(netplay_t *netplay,
    if (netplay->compress_zlib.compression_backend)
       netplay_send_savestate(netplay, serial_info, NETPLAY_COMPRESSION_ZLIB,
          &netplay->compress_zlib);
+
+   /* Peers taking deltas each get their own */
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active ||
+          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+          !(connection->compression_supported & NETPLAY_COMPRESSION_DELTA))
+         continue;
+
+      netplay_send_savestate_delta(netplay, connection, serial_info);
+   }
 }
 
 /**
@@ -1504,6 +1590,7 @@ bool init_netplay(void *direct_host, const char *server, unsigned port)
             : server_port_deferred   ) : (port != 0 ? port : RARCH_DEFAULT_PORT),
          settings->bools.netplay_stateless_mode,
          settings->ints.netplay_check_frames,
+         settings->bools.netplay_sparse_snapshots,
          &cbs,
          settings->bools.netplay_nat_traversal && !settings->bools.netplay_use_mitm_server,
 #ifdef HAVE_DISCORD
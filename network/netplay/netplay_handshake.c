@@ -395,6 +395,9 @@ bool netplay_handshake_init(netplay_t *netplay,
       connection->compression_supported = 0;
    }
 
+   /* Savestates go through the transcoder as deltas */
+   connection->compression_supported |= compression & NETPLAY_COMPRESSION_DELTA;
+
    if (!ctrans->decompression_backend)
       ctrans->decompression_backend = ctrans->compression_backend->reverse;
 
@@ -680,6 +683,7 @@ bool netplay_handshake_sync(netplay_t *netplay,
    /* Now we're ready! */
    connection->mode = NETPLAY_CONNECTION_SPECTATING;
    netplay_handshake_ready(netplay, connection);
+   netplay_relay_attach(netplay, connection);
 
    return true;
 }
@@ -1009,6 +1013,9 @@ bool netplay_handshake_pre_sync(netplay_t *netplay,
 
       }
    }
+
+   /* Nothing before this frame can be replayed from, so snapshot it */
+   netplay->snapshot_frame_count = new_frame_count + 1;
    for (i = 0; i < MAX_CLIENTS; i++)
    {
       netplay->read_ptr[i]         = netplay->self_ptr;
@@ -295,12 +295,15 @@ bool netplay_init_serialization(netplay_t *netplay)
       }
    }
 
-   netplay->zbuffer_size = netplay->state_size * 2;
+   netplay->state_delta_size = netplay_state_delta_max_size(netplay->state_size);
+   netplay->zbuffer_size = MAX(netplay->state_size * 2, netplay->state_delta_size);
    netplay->zbuffer = (uint8_t *) calloc(netplay->zbuffer_size, 1);
-   if (!netplay->zbuffer)
+   netplay->state_delta = (uint8_t *) malloc(netplay->state_delta_size);
+   if (!netplay->zbuffer || !netplay->state_delta)
    {
       netplay->quirks |= NETPLAY_QUIRK_NO_TRANSMISSION;
       netplay->zbuffer_size = 0;
+      netplay->state_delta_size = 0;
       return false;
    }
 
@@ -331,6 +334,7 @@ bool netplay_try_init_serialization(netplay_t *netplay)
 
    if (!core_serialize(&serial_info))
       return false;
+   netplay->buffer[netplay->run_ptr].have_state = true;
 
    /* Once initialized, we no longer exhibit this quirk */
    netplay->quirks &= ~((uint64_t) NETPLAY_QUIRK_INITIALIZATION);
@@ -384,6 +388,10 @@ static bool netplay_init_buffers(netplay_t *netplay)
    if (netplay->is_server)
       netplay->buffer_size *= 2;
 
+   /* Plus the frames back to the snapshot a replay starts from */
+   if (netplay->sparse_snapshots)
+      netplay->buffer_size += NETPLAY_SNAPSHOT_INTERVAL_MAX;
+
    delta_frames = (struct delta_frame*)calloc(netplay->buffer_size,
          sizeof(*delta_frames));
 
@@ -405,6 +413,7 @@ static bool netplay_init_buffers(netplay_t *netplay)
  * @port                 : Port of server.
  * @stateless_mode       : Shall we use stateless mode?
  * @check_frames         : Frequency with which to check CRCs.
+ * @sparse_snapshots     : Only snapshot every few frames for rollback?
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
  * @nick                 : Nickname of user.
@@ -416,7 +425,7 @@ static bool netplay_init_buffers(netplay_t *netplay)
  * Returns: new netplay data.
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
-   bool stateless_mode, int check_frames,
+   bool stateless_mode, int check_frames, bool sparse_snapshots,
    const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
    uint64_t quirks)
 {
@@ -432,6 +441,8 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    netplay->nat_traversal        = netplay->is_server ? nat_traversal : false;
    netplay->stateless_mode       = stateless_mode;
    netplay->check_frames         = check_frames;
+   netplay->sparse_snapshots     = sparse_snapshots;
+   netplay->snapshot_interval    = 1;
    netplay->crc_validity_checked = false;
    netplay->crcs_valid           = true;
    netplay->quirks               = quirks;
@@ -532,6 +543,8 @@ void netplay_free(netplay_t *netplay)
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   netplay_relay_free(netplay->relay);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -540,6 +553,8 @@ void netplay_free(netplay_t *netplay)
          socket_close(connection->fd);
          netplay_deinit_socket_buffer(&connection->send_packet_buffer);
          netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+         free(connection->savestate_sent);
+         free(connection->savestate_received);
       }
    }
 
@@ -559,6 +574,8 @@ void netplay_free(netplay_t *netplay)
 
    if (netplay->zbuffer)
       free(netplay->zbuffer);
+   if (netplay->state_delta)
+      free(netplay->state_delta);
 
    if (netplay->compress_nil.compression_stream)
    {
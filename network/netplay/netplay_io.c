@@ -133,10 +133,15 @@ void netplay_hangup(netplay_t *netplay, struct netplay_connection *connection)
    RARCH_LOG("[netplay] %s\n", dmsg);
    runloop_msg_queue_push(dmsg, 1, 180, false, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
 
+   netplay_relay_detach(netplay, connection, false);
    socket_close(connection->fd);
    connection->active = false;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
+   free(connection->savestate_sent);
+   free(connection->savestate_received);
+   connection->savestate_sent     = NULL;
+   connection->savestate_received = NULL;
 
    if (!netplay->is_server)
    {
@@ -223,13 +228,14 @@ void netplay_delayed_state_change(netplay_t *netplay)
    }
 }
 
-/* Send the specified input data */
-static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
-      struct netplay_connection *only, struct netplay_connection *except,
-      uint32_t client_num, bool slave)
-{
 #define BUFSZ 16 /* FIXME: Arbitrary restriction */
-   uint32_t buffer[BUFSZ], devices, device;
+
+/* Serialize the specified input data, returns the number of words used */
+static size_t serialize_input_frame(netplay_t *netplay,
+      struct delta_frame *dframe, uint32_t client_num, bool slave,
+      uint32_t *buffer)
+{
+   uint32_t devices, device;
    size_t bufused, i;
 
    /* Set up the basic buffer */
@@ -258,6 +264,19 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
    }
    buffer[1] = htonl((bufused-2) * sizeof(uint32_t));
 
+   return bufused;
+}
+
+/* Send the specified input data */
+static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
+      struct netplay_connection *only, struct netplay_connection *except,
+      uint32_t client_num, bool slave)
+{
+   uint32_t buffer[BUFSZ];
+   size_t i;
+   size_t bufused = serialize_input_frame(netplay, dframe, client_num, slave,
+         buffer);
+
 #ifdef DEBUG_NETPLAY_STEPS
    RARCH_LOG("[netplay] Sending input for client %u\n", (unsigned) client_num);
    print_state(netplay);
@@ -276,7 +295,7 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
       for (i = 0; i < netplay->connections_size; i++)
       {
          struct netplay_connection *connection = &netplay->connections[i];
-         if (connection == except)
+         if (connection == except || connection->send_packet_buffer.relay)
             continue;
          if (connection->active &&
              connection->mode >= NETPLAY_CONNECTION_CONNECTED &&
@@ -288,10 +307,13 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
                netplay_hangup(netplay, connection);
          }
       }
+
+      /* Relayed spectators are never playing */
+      netplay_relay_broadcast(netplay, except, buffer,
+            bufused*sizeof(uint32_t));
    }
 
    return true;
-#undef BUFSZ
 }
 
 /**
@@ -356,6 +378,55 @@ bool netplay_send_cur_input(netplay_t *netplay,
    return true;
 }
 
+/**
+ * netplay_send_cur_input_relayed
+ *
+ * Send the current input frame to all relayed spectators, serialized once.
+ */
+void netplay_send_cur_input_relayed(netplay_t *netplay)
+{
+   uint32_t buffer[BUFSZ];
+   uint32_t from_client;
+   size_t bufused;
+   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
+
+   if (!netplay->relay)
+      return;
+
+   /* As netplay_send_cur_input for a spectator */
+   for (from_client = 1; from_client < MAX_CLIENTS; from_client++)
+   {
+      if ((netplay->connected_players & (1<<from_client)) &&
+            dframe->have_real[from_client])
+      {
+         bufused = serialize_input_frame(netplay, dframe, from_client, false,
+               buffer);
+         netplay_relay_broadcast(netplay, NULL, buffer,
+               bufused*sizeof(uint32_t));
+      }
+   }
+
+   if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
+   {
+      buffer[0] = htonl(NETPLAY_CMD_NOINPUT);
+      buffer[1] = htonl(sizeof(uint32_t));
+      buffer[2] = htonl(netplay->self_frame_count);
+      netplay_relay_broadcast(netplay, NULL, buffer, 3*sizeof(uint32_t));
+   }
+
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING
+         || netplay->self_mode == NETPLAY_CONNECTION_SLAVE)
+   {
+      bufused = serialize_input_frame(netplay, dframe,
+            netplay->self_client_num,
+            netplay->self_mode == NETPLAY_CONNECTION_SLAVE, buffer);
+      netplay_relay_broadcast(netplay, NULL, buffer,
+            bufused*sizeof(uint32_t));
+   }
+}
+
+#undef BUFSZ
+
 /**
  * netplay_send_raw_cmd
  *
@@ -397,7 +468,7 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (connection == except)
+      if (connection == except || connection->send_packet_buffer.relay)
          continue;
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
       {
@@ -405,6 +476,16 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
             netplay_hangup(netplay, connection);
       }
    }
+
+   if (netplay->relay)
+   {
+      uint32_t cmdbuf[2];
+      cmdbuf[0] = htonl(cmd);
+      cmdbuf[1] = htonl(size);
+      netplay_relay_broadcast(netplay, except, cmdbuf, sizeof(cmdbuf));
+      if (size > 0)
+         netplay_relay_broadcast(netplay, except, data, size);
+   }
 }
 
 /**
@@ -451,11 +532,23 @@ bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
    payload[1] = htonl(delta->crc);
    for (i = 0; i < netplay->connections_size; i++)
    {
+      if (netplay->connections[i].send_packet_buffer.relay)
+         continue;
       if (netplay->connections[i].active &&
             netplay->connections[i].mode >= NETPLAY_CONNECTION_CONNECTED)
          success = netplay_send_raw_cmd(netplay, &netplay->connections[i],
             NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
    }
+
+   if (netplay->relay)
+   {
+      uint32_t cmdbuf[4];
+      cmdbuf[0] = htonl(NETPLAY_CMD_CRC);
+      cmdbuf[1] = htonl(sizeof(payload));
+      cmdbuf[2] = payload[0];
+      cmdbuf[3] = payload[1];
+      netplay_relay_broadcast(netplay, NULL, cmdbuf, sizeof(cmdbuf));
+   }
    return success;
 }
 
@@ -723,6 +816,10 @@ static void handle_play_spectate(netplay_t *netplay, uint32_t client_num,
          /* Announce it */
          announce_play_spectate(netplay, connection ? connection->nick : NULL,
                NETPLAY_CONNECTION_SPECTATING, 0);
+
+         /* Spectators are sent to by the relay */
+         if (connection)
+            netplay_relay_attach(netplay, connection);
          break;
       }
 
@@ -852,6 +949,14 @@ static void handle_play_spectate(netplay_t *netplay, uint32_t client_num,
 
          payload[2] = htonl(devices);
 
+         /* Players are sent to directly, after what the relay still has */
+         if (connection)
+         {
+            netplay_relay_detach(netplay, connection, true);
+            if (!connection->active)
+               return;
+         }
+
          /* Mark them as playing */
          if (connection)
             connection->mode =
@@ -1537,12 +1642,13 @@ static bool netplay_get_cmd(netplay_t *netplay,
             if (buffer[0] <= netplay->other_frame_count)
             {
                /* We've already replayed up to this frame, so we can check it
-                * directly */
+                * directly, if we kept a snapshot of it */
                uint32_t local_crc = netplay_delta_frame_crc(
                      netplay, &netplay->buffer[tmp_ptr]);
 
                /* Problem! */
-               if (buffer[1] != local_crc)
+               if (netplay->buffer[tmp_ptr].have_state &&
+                     buffer[1] != local_crc)
                   netplay_cmd_request_savestate(netplay);
             }
             else
@@ -1569,6 +1675,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
             uint32_t client;
             uint32_t load_frame_count;
             size_t load_ptr;
+            enum trans_stream_error error;
             struct compression_transcoder *ctrans = NULL;
             uint32_t                   client_num = (uint32_t)
              (connection - netplay->connections + 1);
@@ -1677,21 +1784,44 @@ static bool netplay_get_cmd(netplay_t *netplay,
                }
 
                /* And decompress it */
-               switch (connection->compression_supported)
-               {
-                  case NETPLAY_COMPRESSION_ZLIB:
-                     ctrans = &netplay->compress_zlib;
-                     break;
-                  default:
-                     ctrans = &netplay->compress_nil;
-               }
+               if (connection->compression_supported & NETPLAY_COMPRESSION_ZLIB)
+                  ctrans = &netplay->compress_zlib;
+               else
+                  ctrans = &netplay->compress_nil;
                ctrans->decompression_backend->set_in(ctrans->decompression_stream,
                   netplay->zbuffer, cmd_size - 2*sizeof(uint32_t));
-               ctrans->decompression_backend->set_out(ctrans->decompression_stream,
-                  (uint8_t*)netplay->buffer[load_ptr].state,
-                  (unsigned)netplay->state_size);
-               ctrans->decompression_backend->trans(ctrans->decompression_stream,
-                  true, &rd, &wn, NULL);
+
+               if (connection->compression_supported & NETPLAY_COMPRESSION_DELTA)
+               {
+                  /* It's a delta against the last state this peer sent */
+                  if (!connection->savestate_received)
+                     connection->savestate_received = (uint8_t*)calloc(
+                           netplay->state_size, 1);
+
+                  ctrans->decompression_backend->set_out(ctrans->decompression_stream,
+                     netplay->state_delta, (uint32_t)netplay->state_delta_size);
+                  if (!connection->savestate_received ||
+                      !ctrans->decompression_backend->trans(
+                        ctrans->decompression_stream, true, &rd, &wn, &error) ||
+                      !netplay_state_delta_decode(connection->savestate_received,
+                        netplay->state_size, netplay->state_delta, wn))
+                  {
+                     RARCH_ERR("CMD_LOAD_SAVESTATE failed to decode savestate delta.\n");
+                     return netplay_cmd_nak(netplay, connection);
+                  }
+
+                  memcpy(netplay->buffer[load_ptr].state,
+                        connection->savestate_received, netplay->state_size);
+               }
+               else
+               {
+                  ctrans->decompression_backend->set_out(ctrans->decompression_stream,
+                     (uint8_t*)netplay->buffer[load_ptr].state,
+                     (unsigned)netplay->state_size);
+                  ctrans->decompression_backend->trans(ctrans->decompression_stream,
+                     true, &rd, &wn, NULL);
+               }
+               netplay->buffer[load_ptr].have_state = true;
 
                /* Force a rewind to the relevant frame */
                netplay->force_rewind = true;
@@ -52,8 +52,24 @@ typedef uint32_t client_bitmap_t;
  * callbacks are in use, we assign a pseudodevice for it */
 #define RETRO_DEVICE_NETPLAY_KEYBOARD RETRO_DEVICE_SUBCLASS(RETRO_DEVICE_KEYBOARD, 65535)
 
+/* The server hands its spectators to a relay thread, which needs threads
+ * and poll(2) */
+#if defined(HAVE_THREADS) && !defined(_WIN32) && (defined(__unix__) || defined(__APPLE__)) \
+   && !defined(VITA) && !defined(WIIU) && !defined(__CELLOS_LV2__) && !defined(__SWITCH__)
+#define HAVE_NETPLAY_RELAY 1
+#endif
+
+/* Bytes a relayed spectator may fall behind, on top of a savestate,
+ * before it's dropped */
+#define NETPLAY_RELAY_BACKLOG (256*1024)
+
 #define NETPLAY_MAX_STALL_FRAMES       60
 #define NETPLAY_FRAME_RUN_TIME_WINDOW  120
+
+/* With sparse snapshots, the most frames between two snapshots, and how
+ * often the interval is tuned */
+#define NETPLAY_SNAPSHOT_INTERVAL_MAX  8
+#define NETPLAY_SNAPSHOT_TUNE_FRAMES   60
 #define NETPLAY_MAX_REQ_STALL_TIME     60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
 
@@ -89,10 +105,17 @@ typedef uint32_t client_bitmap_t;
 
 /* Compression protocols supported */
 #define NETPLAY_COMPRESSION_ZLIB (1<<0)
+/* Savestates are encoded against the last one exchanged before
+ * going through the transcoder */
+#define NETPLAY_COMPRESSION_DELTA (1<<1)
+/* zlib level for deltas. They are mostly long runs which the default
+ * level of 9 spends many times longer on for a few percent. */
+#define NETPLAY_STATE_DELTA_ZLIB_LEVEL 5
+#define NETPLAY_ZLIB_LEVEL             9
 #if HAVE_ZLIB
-#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_ZLIB
+#define NETPLAY_COMPRESSION_SUPPORTED (NETPLAY_COMPRESSION_ZLIB | NETPLAY_COMPRESSION_DELTA)
 #else
-#define NETPLAY_COMPRESSION_SUPPORTED 0
+#define NETPLAY_COMPRESSION_SUPPORTED NETPLAY_COMPRESSION_DELTA
 #endif
 
 enum netplay_cmd
@@ -295,6 +318,10 @@ struct delta_frame
    /* The serialized state of the core at this frame, before input */
    void *state;
 
+   /* Does state hold a snapshot of this frame? With sparse snapshots, most
+    * frames don't have one */
+   bool have_state;
+
    /* The CRC-32 of the serialized state if we've calculated it, else 0 */
    uint32_t crc;
 
@@ -316,12 +343,19 @@ struct delta_frame
    bool have_real[MAX_CLIENTS];
 };
 
+struct netplay_relay;
+struct netplay_relay_peer;
+
 struct socket_buffer
 {
    unsigned char *data;
    size_t bufsz;
    size_t start, end;
    size_t read;
+
+   /* If set, data sent through this buffer is queued to the relay thread
+    * instead of being written to the socket */
+   struct netplay_relay_peer *relay;
 };
 
 /* Each connection gets a connection struct */
@@ -359,6 +393,13 @@ struct netplay_connection
    /* What compression does this peer support? */
    uint32_t compression_supported;
 
+   /* With NETPLAY_COMPRESSION_DELTA, the last savestate we sent to this
+    * peer and the last one it sent us, both all zeroes at first. The
+    * stream is reliable and in order, so these are what the peer holds
+    * when it gets the next delta. */
+   uint8_t *savestate_sent;
+   uint8_t *savestate_received;
+
    /* Is this player paused? */
    bool paused;
 
@@ -459,6 +500,13 @@ struct netplay
    uint8_t *zbuffer;
    size_t zbuffer_size;
 
+   /* A buffer for savestate deltas before and after the transcoder */
+   uint8_t *state_delta;
+   size_t state_delta_size;
+
+   /* The thread which sends to our spectators, if any */
+   struct netplay_relay *relay;
+
    /* The size of our packet buffers */
    size_t packet_buffer_size;
 
@@ -541,6 +589,20 @@ struct netplay
    int frame_run_time_ptr;
    retro_time_t frame_run_time_sum, frame_run_time_avg;
 
+   /* Sparse snapshots: instead of serializing every frame, we take a
+    * snapshot every snapshot_interval frames and replay from the nearest
+    * one. The interval is tuned from how long serializing and replaying
+    * take and how far back rollbacks go. */
+   bool sparse_snapshots;
+   unsigned snapshot_interval;
+   uint32_t snapshot_frame_count;
+   retro_time_t serialize_time_avg;
+
+   /* Rollbacks since the interval was last tuned, and the frames they
+    * replayed before the sparse snapshots added theirs */
+   unsigned snapshot_tune_frames;
+   unsigned rollbacks, rollback_frames;
+
    /* Latency frames; positive to hide network latency, negative to hide input latency */
    int input_latency_frames;
 
@@ -683,6 +745,100 @@ netplay_input_state_t netplay_input_state_for(netplay_input_state_t *list,
  */
 uint32_t netplay_expected_input_size(netplay_t *netplay, uint32_t devices);
 
+/***************************************************************
+ * NETPLAY-RELAY.C
+ **************************************************************/
+
+/**
+ * netplay_relay_free
+ *
+ * Stop the relay thread and drop whatever it didn't send yet.
+ */
+void netplay_relay_free(struct netplay_relay *relay);
+
+/**
+ * netplay_relay_attach
+ *
+ * Hand a spectator over to the relay thread, starting it if need be. From
+ * now on everything sent to the connection is queued to the relay, and
+ * broadcasts reach it through netplay_relay_broadcast.
+ *
+ * Returns false if the connection stays as it is.
+ */
+bool netplay_relay_attach(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_relay_detach
+ *
+ * Take a connection back from the relay. If keep is set, what the relay
+ * didn't send yet is put back into the connection's send buffer, else it
+ * is dropped along with the connection.
+ */
+void netplay_relay_detach(netplay_t *netplay,
+   struct netplay_connection *connection, bool keep);
+
+/**
+ * netplay_relay_send
+ *
+ * Queue data for a single relayed connection.
+ *
+ * Returns false if the relay dropped the connection.
+ */
+bool netplay_relay_send(struct netplay_relay_peer *peer, const void *buf,
+   size_t len);
+
+/**
+ * netplay_relay_flush
+ *
+ * Have the relay thread send what was queued.
+ *
+ * Returns false if the relay dropped the connection.
+ */
+bool netplay_relay_flush(struct netplay_relay_peer *peer);
+
+/**
+ * netplay_relay_broadcast
+ *
+ * Queue data for all relayed connections, optionally excluding one. The
+ * data is copied once and shared by all of them.
+ */
+void netplay_relay_broadcast(netplay_t *netplay,
+   struct netplay_connection *except, const void *buf, size_t len);
+
+/***************************************************************
+ * NETPLAY-STATE-DELTA.C
+ **************************************************************/
+
+/**
+ * netplay_state_delta_max_size
+ *
+ * Size of the longest delta of a savestate of the given size.
+ */
+size_t netplay_state_delta_max_size(size_t size);
+
+/**
+ * netplay_state_delta_encode
+ *
+ * Encode a savestate against the one the peer holds, and update base to
+ * the new state.
+ *
+ * Returns the size of the delta.
+ */
+size_t netplay_state_delta_encode(uint8_t *base, const uint8_t *state,
+      size_t size, uint8_t *delta);
+
+/**
+ * netplay_state_delta_decode
+ *
+ * Apply a delta from netplay_state_delta_encode to the savestate the
+ * peer encoded it against.
+ *
+ * Returns false if the delta doesn't fit the savestate.
+ */
+bool netplay_state_delta_decode(uint8_t *base, size_t size,
+      const uint8_t *delta, size_t delta_size);
+
 /***************************************************************
  * NETPLAY-DISCOVERY.C
  **************************************************************/
@@ -775,6 +931,7 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  * @port                 : Port of server.
  * @stateless_mode       : Shall we run in stateless mode?
  * @check_frames         : Frequency with which to check CRCs.
+ * @sparse_snapshots     : Only snapshot every few frames for rollback?
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
  * @nick                 : Nickname of user.
@@ -786,7 +943,7 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  * Returns: new netplay data.
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
-   bool stateless_mode, int check_frames,
+   bool stateless_mode, int check_frames, bool sparse_snapshots,
    const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
    uint64_t quirks);
 
@@ -827,6 +984,13 @@ void netplay_delayed_state_change(netplay_t *netplay);
 bool netplay_send_cur_input(netplay_t *netplay,
    struct netplay_connection *connection);
 
+/**
+ * netplay_send_cur_input_relayed
+ *
+ * Send the current input frame to all relayed spectators, serialized once.
+ */
+void netplay_send_cur_input_relayed(netplay_t *netplay);
+
 /**
  * netplay_send_raw_cmd
  *
@@ -0,0 +1,728 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Spectators only ever get what everyone gets, so the server doesn't
+ * serialize and write every frame to each of them. Instead it hands their
+ * sockets to a relay thread: what is broadcast to them is copied once into
+ * a packet which every spectator's queue shares, and the thread writes the
+ * queues out as their sockets allow. A spectator which can't keep up is
+ * dropped rather than stalling the server. The server still reads from the
+ * spectators itself. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+
+#include "netplay_private.h"
+
+#ifdef HAVE_NETPLAY_RELAY
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <rthreads/rthreads.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* Smallest packet allocated for data sent to a single spectator, which
+ * later small commands are appended to */
+#define NETPLAY_RELAY_PACKET_SIZE 256
+
+struct netplay_relay_packet
+{
+   /* Queues this packet is in, or 0 while it's being staged */
+   unsigned refs;
+   bool shared;
+   size_t size;
+   size_t cap;
+   uint8_t *data;
+};
+
+struct netplay_relay_peer
+{
+   struct netplay_relay *relay;
+   struct netplay_relay_peer *next;
+   int fd;
+
+   /* Packets to send, as a ring */
+   struct netplay_relay_packet **queue;
+   size_t head, count, cap;
+
+   /* Bytes of the first packet already sent, and of all packets left */
+   size_t offset;
+   size_t queued;
+
+   /* The socket is full, wait for poll */
+   bool blocked;
+
+   /* Too slow or disconnected, nothing is sent anymore */
+   bool failed;
+
+   /* The server took the connection back, the thread frees the peer */
+   bool detached;
+};
+
+struct netplay_relay
+{
+   sthread_t *thread;
+   slock_t *lock;
+
+   /* Written to wake the thread from poll */
+   int wake[2];
+   bool woken;
+   bool quit;
+
+   struct netplay_relay_peer *peers;
+   size_t num_peers;
+   size_t backlog;
+
+   /* Broadcasts since the last commit, and the peer they skip */
+   struct netplay_relay_packet *staging;
+   struct netplay_relay_peer *staging_except;
+
+   /* Owned by the thread */
+   struct pollfd *fds;
+   struct netplay_relay_peer **fd_peers;
+   size_t fds_cap;
+};
+
+static struct netplay_relay_packet *netplay_relay_packet_new(size_t cap,
+      bool shared)
+{
+   struct netplay_relay_packet *packet = (struct netplay_relay_packet*)
+      calloc(1, sizeof(*packet));
+
+   if (!packet)
+      return NULL;
+
+   packet->data = (uint8_t*)malloc(cap);
+   if (!packet->data)
+   {
+      free(packet);
+      return NULL;
+   }
+
+   packet->cap    = cap;
+   packet->shared = shared;
+   return packet;
+}
+
+static void netplay_relay_packet_unref(struct netplay_relay_packet *packet)
+{
+   if (--packet->refs)
+      return;
+   free(packet->data);
+   free(packet);
+}
+
+static bool netplay_relay_packet_append(struct netplay_relay_packet *packet,
+      const void *buf, size_t len)
+{
+   if (packet->size + len > packet->cap)
+   {
+      size_t cap    = MAX(packet->cap * 2, packet->size + len);
+      uint8_t *data = (uint8_t*)realloc(packet->data, cap);
+      if (!data)
+         return false;
+      packet->data = data;
+      packet->cap  = cap;
+   }
+
+   memcpy(packet->data + packet->size, buf, len);
+   packet->size += len;
+   return true;
+}
+
+static void netplay_relay_wake(struct netplay_relay *relay)
+{
+   ssize_t ret;
+
+   if (relay->woken)
+      return;
+   relay->woken = true;
+
+   /* If the pipe is full, the thread is being woken anyway */
+   ret = write(relay->wake[1], "", 1);
+   (void)ret;
+}
+
+/* Drop everything queued for a peer. */
+static void netplay_relay_peer_clear(struct netplay_relay_peer *peer)
+{
+   while (peer->count)
+   {
+      netplay_relay_packet_unref(peer->queue[peer->head]);
+      peer->head = (peer->head + 1) % peer->cap;
+      peer->count--;
+   }
+   peer->head   = 0;
+   peer->offset = 0;
+   peer->queued = 0;
+}
+
+static void netplay_relay_peer_fail(struct netplay_relay_peer *peer)
+{
+   peer->failed = true;
+   netplay_relay_peer_clear(peer);
+}
+
+static bool netplay_relay_peer_push(struct netplay_relay_peer *peer,
+      struct netplay_relay_packet *packet)
+{
+   if (peer->count == peer->cap)
+   {
+      size_t i;
+      size_t cap = peer->cap ? peer->cap * 2 : 64;
+      struct netplay_relay_packet **queue = (struct netplay_relay_packet**)
+         malloc(cap * sizeof(*queue));
+
+      if (!queue)
+         return false;
+
+      for (i = 0; i < peer->count; i++)
+         queue[i] = peer->queue[(peer->head + i) % peer->cap];
+
+      free(peer->queue);
+      peer->queue = queue;
+      peer->head  = 0;
+      peer->cap   = cap;
+   }
+
+   peer->queue[(peer->head + peer->count) % peer->cap] = packet;
+   peer->count++;
+   peer->queued += packet->size;
+   packet->refs++;
+   return true;
+}
+
+/* Queue the staged broadcasts to every peer. Peers which fall too far
+ * behind are dropped here. */
+static void netplay_relay_commit(struct netplay_relay *relay)
+{
+   struct netplay_relay_peer *peer;
+   struct netplay_relay_packet *packet = relay->staging;
+
+   if (!packet)
+      return;
+
+   relay->staging = NULL;
+
+   /* Hold a reference while queueing, so that dropping a peer which had
+    * it queued can't free it */
+   packet->refs = 1;
+
+   for (peer = relay->peers; peer; peer = peer->next)
+   {
+      if (peer == relay->staging_except || peer->failed || peer->detached)
+         continue;
+
+      if (peer->queued + packet->size > relay->backlog
+            || !netplay_relay_peer_push(peer, packet))
+         netplay_relay_peer_fail(peer);
+   }
+
+   netplay_relay_packet_unref(packet);
+   netplay_relay_wake(relay);
+}
+
+/* Write as much of the queue as the socket takes. */
+static void netplay_relay_peer_write(struct netplay_relay_peer *peer)
+{
+   while (peer->count)
+   {
+      struct netplay_relay_packet *packet = peer->queue[peer->head];
+      ssize_t sent = send(peer->fd, (const char*)packet->data + peer->offset,
+            packet->size - peer->offset, MSG_NOSIGNAL);
+
+      if (sent < 0)
+      {
+         if (errno == EINTR)
+            continue;
+         if (errno == EAGAIN || errno == EWOULDBLOCK)
+            peer->blocked = true;
+         else
+            netplay_relay_peer_fail(peer);
+         return;
+      }
+
+      peer->offset += sent;
+      peer->queued -= sent;
+
+      if (peer->offset < packet->size)
+         continue;
+
+      netplay_relay_packet_unref(packet);
+      peer->head   = (peer->head + 1) % peer->cap;
+      peer->offset = 0;
+      peer->count--;
+   }
+}
+
+static void netplay_relay_peer_free(struct netplay_relay_peer *peer)
+{
+   netplay_relay_peer_clear(peer);
+   free(peer->queue);
+   free(peer);
+}
+
+static void netplay_relay_thread(void *data)
+{
+   struct netplay_relay *relay = (struct netplay_relay*)data;
+
+   slock_lock(relay->lock);
+
+   while (!relay->quit)
+   {
+      size_t i;
+      size_t nfds                       = 1;
+      struct netplay_relay_peer **ptr = &relay->peers;
+
+      /* Room for every peer and the wakeup pipe */
+      if (relay->fds_cap < relay->num_peers + 1)
+      {
+         size_t cap                      = (relay->num_peers + 1) * 2;
+         struct pollfd *fds              = (struct pollfd*)
+            realloc(relay->fds, cap * sizeof(*fds));
+         struct netplay_relay_peer **fd_peers;
+
+         if (fds)
+            relay->fds = fds;
+         fd_peers = (struct netplay_relay_peer**)
+            realloc(relay->fd_peers, cap * sizeof(*fd_peers));
+         if (fd_peers)
+            relay->fd_peers = fd_peers;
+         if (fds && fd_peers)
+            relay->fds_cap = cap;
+      }
+
+      relay->fds[0].fd      = relay->wake[0];
+      relay->fds[0].events  = POLLIN;
+      relay->fds[0].revents = 0;
+
+      /* Send what we can, and wait on whoever is full */
+      while (*ptr)
+      {
+         struct netplay_relay_peer *peer = *ptr;
+
+         if (peer->detached)
+         {
+            *ptr = peer->next;
+            relay->num_peers--;
+            netplay_relay_peer_free(peer);
+            continue;
+         }
+
+         if (!peer->blocked && !peer->failed)
+            netplay_relay_peer_write(peer);
+
+         if (peer->blocked && !peer->failed && nfds < relay->fds_cap)
+         {
+            relay->fds[nfds].fd      = peer->fd;
+            relay->fds[nfds].events  = POLLOUT;
+            relay->fds[nfds].revents = 0;
+            relay->fd_peers[nfds]    = peer;
+            nfds++;
+         }
+
+         ptr = &peer->next;
+      }
+
+      slock_unlock(relay->lock);
+      poll(relay->fds, nfds, -1);
+      slock_lock(relay->lock);
+
+      if (relay->fds[0].revents)
+      {
+         char buf[64];
+         while (read(relay->wake[0], buf, sizeof(buf)) > 0);
+         relay->woken = false;
+      }
+
+      /* Peers detached meanwhile are still in the list, so these are
+       * valid, and they are skipped above */
+      for (i = 1; i < nfds; i++)
+         if (relay->fds[i].revents)
+            relay->fd_peers[i]->blocked = false;
+   }
+
+   slock_unlock(relay->lock);
+}
+
+static void netplay_relay_close_pipe(struct netplay_relay *relay)
+{
+   if (relay->wake[0] >= 0)
+      close(relay->wake[0]);
+   if (relay->wake[1] >= 0)
+      close(relay->wake[1]);
+}
+
+static struct netplay_relay *netplay_relay_new(size_t backlog)
+{
+   struct netplay_relay *relay = (struct netplay_relay*)
+      calloc(1, sizeof(*relay));
+
+   if (!relay)
+      return NULL;
+
+   relay->backlog = backlog;
+   relay->wake[0] = relay->wake[1] = -1;
+   relay->fds_cap = 16;
+   relay->fds     = (struct pollfd*)malloc(relay->fds_cap * sizeof(*relay->fds));
+   relay->fd_peers = (struct netplay_relay_peer**)
+      malloc(relay->fds_cap * sizeof(*relay->fd_peers));
+   relay->lock    = slock_new();
+
+   if (!relay->fds || !relay->fd_peers || !relay->lock ||
+         pipe(relay->wake) < 0 ||
+         fcntl(relay->wake[0], F_SETFL, O_NONBLOCK) < 0 ||
+         fcntl(relay->wake[1], F_SETFL, O_NONBLOCK) < 0)
+      goto error;
+
+   relay->thread = sthread_create(netplay_relay_thread, relay);
+   if (!relay->thread)
+      goto error;
+
+   return relay;
+
+error:
+   netplay_relay_close_pipe(relay);
+   if (relay->lock)
+      slock_free(relay->lock);
+   free(relay->fds);
+   free(relay->fd_peers);
+   free(relay);
+   return NULL;
+}
+
+/**
+ * netplay_relay_free
+ *
+ * Stop the relay thread and drop whatever it didn't send yet.
+ */
+void netplay_relay_free(struct netplay_relay *relay)
+{
+   if (!relay)
+      return;
+
+   slock_lock(relay->lock);
+   relay->quit = true;
+   netplay_relay_wake(relay);
+   slock_unlock(relay->lock);
+   sthread_join(relay->thread);
+
+   while (relay->peers)
+   {
+      struct netplay_relay_peer *peer = relay->peers;
+      relay->peers                    = peer->next;
+      netplay_relay_peer_free(peer);
+   }
+
+   if (relay->staging)
+   {
+      free(relay->staging->data);
+      free(relay->staging);
+   }
+
+   netplay_relay_close_pipe(relay);
+   slock_free(relay->lock);
+   free(relay->fds);
+   free(relay->fd_peers);
+   free(relay);
+}
+
+/**
+ * netplay_relay_attach
+ *
+ * Hand a spectator over to the relay thread, starting it if need be. From
+ * now on everything sent to the connection is queued to the relay, and
+ * broadcasts reach it through netplay_relay_broadcast.
+ *
+ * Returns false if the connection stays as it is.
+ */
+bool netplay_relay_attach(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   struct netplay_relay *relay;
+   struct netplay_relay_peer *peer;
+
+   if (!netplay->is_server || connection->send_packet_buffer.relay)
+      return false;
+
+   if (!netplay->relay)
+   {
+      netplay->relay = netplay_relay_new(
+            netplay->zbuffer_size + NETPLAY_RELAY_BACKLOG);
+      if (!netplay->relay)
+         return false;
+   }
+
+   relay = netplay->relay;
+   peer  = (struct netplay_relay_peer*)calloc(1, sizeof(*peer));
+   if (!peer)
+      return false;
+
+   /* Whatever is still buffered goes out first */
+   if (!netplay_send_flush(&connection->send_packet_buffer, connection->fd,
+            true))
+   {
+      free(peer);
+      return false;
+   }
+
+   peer->relay = relay;
+   peer->fd    = connection->fd;
+
+   slock_lock(relay->lock);
+   netplay_relay_commit(relay);
+   peer->next   = relay->peers;
+   relay->peers = peer;
+   relay->num_peers++;
+   slock_unlock(relay->lock);
+
+   connection->send_packet_buffer.relay = peer;
+   return true;
+}
+
+/**
+ * netplay_relay_detach
+ *
+ * Take a connection back from the relay. If keep is set, what the relay
+ * didn't send yet is put back into the connection's send buffer, else it
+ * is dropped along with the connection.
+ */
+void netplay_relay_detach(netplay_t *netplay,
+   struct netplay_connection *connection, bool keep)
+{
+   uint8_t *unsent                 = NULL;
+   size_t unsent_size              = 0;
+   bool lost                       = false;
+   struct netplay_relay_peer *peer = connection->send_packet_buffer.relay;
+   struct netplay_relay *relay;
+
+   if (!peer)
+      return;
+
+   relay = peer->relay;
+
+   slock_lock(relay->lock);
+   netplay_relay_commit(relay);
+
+   if (keep && peer->failed)
+      lost = true;
+   else if (keep && peer->queued)
+   {
+      size_t i;
+
+      unsent = (uint8_t*)malloc(peer->queued);
+      if (!unsent)
+         lost = true;
+
+      for (i = 0; unsent && i < peer->count; i++)
+      {
+         struct netplay_relay_packet *packet =
+            peer->queue[(peer->head + i) % peer->cap];
+         size_t skip = i ? 0 : peer->offset;
+         memcpy(unsent + unsent_size, packet->data + skip,
+               packet->size - skip);
+         unsent_size += packet->size - skip;
+      }
+   }
+
+   /* The thread frees it, it may be polling it right now */
+   peer->detached = true;
+   netplay_relay_peer_clear(peer);
+   netplay_relay_wake(relay);
+   slock_unlock(relay->lock);
+
+   connection->send_packet_buffer.relay = NULL;
+
+   if (lost || (unsent_size && !netplay_send(&connection->send_packet_buffer,
+            connection->fd, unsent, unsent_size)))
+      netplay_hangup(netplay, connection);
+
+   free(unsent);
+}
+
+/**
+ * netplay_relay_send
+ *
+ * Queue data for a single relayed connection.
+ *
+ * Returns false if the relay dropped the connection.
+ */
+bool netplay_relay_send(struct netplay_relay_peer *peer, const void *buf,
+   size_t len)
+{
+   bool ret                    = false;
+   struct netplay_relay *relay = peer->relay;
+
+   slock_lock(relay->lock);
+
+   /* Broadcasts made before this go out first */
+   netplay_relay_commit(relay);
+
+   if (!peer->failed)
+   {
+      struct netplay_relay_packet *tail = peer->count
+         ? peer->queue[(peer->head + peer->count - 1) % peer->cap]
+         : NULL;
+
+      if (peer->queued + len > relay->backlog)
+         netplay_relay_peer_fail(peer);
+      /* Small commands are gathered into the last packet if it's this
+       * peer's alone */
+      else if (tail && !tail->shared && netplay_relay_packet_append(tail,
+               buf, len))
+      {
+         peer->queued += len;
+         ret           = true;
+      }
+      else
+      {
+         struct netplay_relay_packet *packet = netplay_relay_packet_new(
+               MAX(len, NETPLAY_RELAY_PACKET_SIZE), false);
+
+         if (packet && netplay_relay_packet_append(packet, buf, len)
+               && netplay_relay_peer_push(peer, packet))
+            ret = true;
+         else
+         {
+            if (packet)
+            {
+               free(packet->data);
+               free(packet);
+            }
+            netplay_relay_peer_fail(peer);
+         }
+      }
+   }
+
+   slock_unlock(relay->lock);
+   return ret;
+}
+
+/**
+ * netplay_relay_flush
+ *
+ * Have the relay thread send what was queued.
+ *
+ * Returns false if the relay dropped the connection.
+ */
+bool netplay_relay_flush(struct netplay_relay_peer *peer)
+{
+   bool failed;
+   struct netplay_relay *relay = peer->relay;
+
+   slock_lock(relay->lock);
+   netplay_relay_commit(relay);
+   if (peer->count)
+      netplay_relay_wake(relay);
+   failed = peer->failed;
+   slock_unlock(relay->lock);
+
+   return !failed;
+}
+
+/**
+ * netplay_relay_broadcast
+ *
+ * Queue data for all relayed connections, optionally excluding one. The
+ * data is copied once and shared by all of them.
+ */
+void netplay_relay_broadcast(netplay_t *netplay,
+   struct netplay_connection *except, const void *buf, size_t len)
+{
+   struct netplay_relay *relay       = netplay->relay;
+   struct netplay_relay_peer *exceptp = except
+      ? except->send_packet_buffer.relay : NULL;
+
+   if (!relay)
+      return;
+
+   slock_lock(relay->lock);
+
+   if (!relay->peers)
+   {
+      slock_unlock(relay->lock);
+      return;
+   }
+
+   /* Broadcasts to the same peers are gathered into one packet until the
+    * next flush */
+   if (relay->staging && relay->staging_except != exceptp)
+      netplay_relay_commit(relay);
+
+   if (!relay->staging)
+   {
+      relay->staging = netplay_relay_packet_new(
+            MAX(len, NETPLAY_RELAY_PACKET_SIZE), true);
+      relay->staging_except = exceptp;
+   }
+
+   if (!relay->staging ||
+         !netplay_relay_packet_append(relay->staging, buf, len))
+   {
+      /* Spectators can't miss anything, so they go */
+      struct netplay_relay_peer *peer;
+      for (peer = relay->peers; peer; peer = peer->next)
+         if (peer != exceptp)
+            netplay_relay_peer_fail(peer);
+   }
+
+   slock_unlock(relay->lock);
+}
+
+#else
+
+void netplay_relay_free(struct netplay_relay *relay)
+{
+}
+
+bool netplay_relay_attach(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   return false;
+}
+
+void netplay_relay_detach(netplay_t *netplay,
+   struct netplay_connection *connection, bool keep)
+{
+}
+
+bool netplay_relay_send(struct netplay_relay_peer *peer, const void *buf,
+   size_t len)
+{
+   return false;
+}
+
+bool netplay_relay_flush(struct netplay_relay_peer *peer)
+{
+   return false;
+}
+
+void netplay_relay_broadcast(netplay_t *netplay,
+   struct netplay_connection *except, const void *buf, size_t len)
+{
+}
+
+#endif
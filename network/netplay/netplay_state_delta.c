@@ -0,0 +1,181 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+
+#include "netplay_private.h"
+
+/* Unchanged memory is skipped a block at a time with memcmp,
+ * runs of changes are found a word at a time. */
+#define NETPLAY_STATE_DELTA_BLOCK 256
+#define NETPLAY_STATE_DELTA_WORD  8
+
+/* Longest varint of a uint32_t */
+#define NETPLAY_STATE_DELTA_VARINT 5
+
+static INLINE bool netplay_state_delta_same(const uint8_t *a,
+      const uint8_t *b, size_t pos, size_t size)
+{
+   uint64_t x, y;
+
+   if (size - pos < NETPLAY_STATE_DELTA_WORD)
+      return !memcmp(a + pos, b + pos, size - pos);
+
+   memcpy(&x, a + pos, sizeof(x));
+   memcpy(&y, b + pos, sizeof(y));
+   return x == y;
+}
+
+static INLINE uint8_t *netplay_state_delta_put(uint8_t *out, uint32_t val)
+{
+   while (val >= 0x80)
+   {
+      *out++ = (uint8_t)(val | 0x80);
+      val  >>= 7;
+   }
+   *out++ = (uint8_t)val;
+   return out;
+}
+
+static INLINE bool netplay_state_delta_get(const uint8_t **in,
+      const uint8_t *end, uint32_t *val)
+{
+   unsigned shift   = 0;
+   const uint8_t *p = *in;
+
+   *val = 0;
+
+   while (p < end && shift < 7 * NETPLAY_STATE_DELTA_VARINT)
+   {
+      uint8_t byte = *p++;
+      *val        |= (uint32_t)(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+      {
+         *in = p;
+         return true;
+      }
+      shift += 7;
+   }
+
+   return false;
+}
+
+/**
+ * netplay_state_delta_max_size
+ *
+ * Size of the longest delta of a savestate of the given size.
+ */
+size_t netplay_state_delta_max_size(size_t size)
+{
+   /* Every run but the first follows at least a word
+    * which didn't change and has a header of two varints. */
+   return size + (size / (2 * NETPLAY_STATE_DELTA_WORD) + 1)
+      * 2 * NETPLAY_STATE_DELTA_VARINT;
+}
+
+/**
+ * netplay_state_delta_encode
+ *
+ * Encode a savestate against the one the peer holds. The delta is a
+ * sequence of runs, each the number of unchanged bytes to skip and the
+ * number of changed bytes that follow, as varints, then the changed
+ * bytes XORed with the peer's. Unchanged memory costs next to nothing
+ * and what is left is mostly small values for the transcoder.
+ *
+ * Updates base to the new state. Returns the size of the delta.
+ */
+size_t netplay_state_delta_encode(uint8_t *base, const uint8_t *state,
+      size_t size, uint8_t *delta)
+{
+   uint8_t *out = delta;
+   size_t pos   = 0;
+   size_t last  = 0;
+
+   for (;;)
+   {
+      size_t i, start;
+
+      while (size - pos >= NETPLAY_STATE_DELTA_BLOCK
+            && !memcmp(base + pos, state + pos, NETPLAY_STATE_DELTA_BLOCK))
+         pos += NETPLAY_STATE_DELTA_BLOCK;
+
+      while (pos < size && netplay_state_delta_same(base, state, pos, size))
+         pos += NETPLAY_STATE_DELTA_WORD;
+
+      if (pos >= size)
+         break;
+
+      start = pos;
+      while (pos < size && !netplay_state_delta_same(base, state, pos, size))
+         pos += NETPLAY_STATE_DELTA_WORD;
+      if (pos > size)
+         pos = size;
+
+      out = netplay_state_delta_put(out, (uint32_t)(start - last));
+      out = netplay_state_delta_put(out, (uint32_t)(pos - start));
+
+      for (i = start; i < pos; i++)
+      {
+         *out++  = base[i] ^ state[i];
+         base[i] = state[i];
+      }
+
+      last = pos;
+   }
+
+   return out - delta;
+}
+
+/**
+ * netplay_state_delta_decode
+ *
+ * Apply a delta from netplay_state_delta_encode to the savestate the
+ * peer encoded it against.
+ *
+ * Returns false if the delta doesn't fit the savestate.
+ */
+bool netplay_state_delta_decode(uint8_t *base, size_t size,
+      const uint8_t *delta, size_t delta_size)
+{
+   const uint8_t *end = delta + delta_size;
+   size_t pos         = 0;
+
+   while (delta < end)
+   {
+      uint32_t skip, len, i;
+
+      if (!netplay_state_delta_get(&delta, end, &skip) ||
+          !netplay_state_delta_get(&delta, end, &len))
+         return false;
+
+      if (skip > size - pos || len > size - pos - skip ||
+          len > (size_t)(end - delta))
+         return false;
+
+      pos += skip;
+      for (i = 0; i < len; i++)
+         base[pos + i] ^= delta[i];
+
+      pos   += len;
+      delta += len;
+   }
+
+   return true;
+}
@@ -25,12 +25,26 @@
 
 #include "../../autosave.h"
 #include "../../driver.h"
+#include "../../performance_counters.h"
+#include "../../retroarch.h"
 #include "../../input/input_driver.h"
 
 #if 0
 #define DEBUG_NONDETERMINISTIC_CORES
 #endif
 
+static struct retro_perf_counter netplay_serialize_perf;
+static struct retro_perf_counter netplay_resim_perf;
+
+static bool netplay_perfcnt_enabled(void)
+{
+   if (!rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL))
+      return false;
+   performance_counter_init(netplay_serialize_perf, "netplay_serialize");
+   performance_counter_init(netplay_resim_perf, "netplay_resim");
+   return true;
+}
+
 /**
  * netplay_update_unread_ptr
  *
@@ -506,19 +520,28 @@ bool netplay_resolve_input(netplay_t *netplay, size_t sim_ptr, bool resim)
    return ret;
 }
 
+/* Frames we send or check the CRC of, which is taken of the snapshot */
+static bool netplay_is_check_frame(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   if (netplay->is_server)
+      return netplay->check_frames &&
+         delta->frame % abs(netplay->check_frames) == 0;
+   return delta->crc != 0;
+}
+
 static void netplay_handle_frame_hash(netplay_t *netplay,
       struct delta_frame *delta)
 {
    if (netplay->is_server)
    {
-      if (netplay->check_frames &&
-          delta->frame % abs(netplay->check_frames) == 0)
+      if (netplay_is_check_frame(netplay, delta))
       {
          delta->crc = netplay_delta_frame_crc(netplay, delta);
          netplay_cmd_crc(netplay, delta);
       }
    }
-   else if (delta->crc && netplay->crcs_valid)
+   else if (delta->crc && delta->have_state && netplay->crcs_valid)
    {
       /* We have a remote CRC, so check it */
       uint32_t local_crc = netplay_delta_frame_crc(netplay, delta);
@@ -545,6 +568,167 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
    }
 }
 
+/**
+ * netplay_sync_serialize
+ * @netplay              : pointer to netplay object
+ * @delta                : frame to snapshot
+ * @perfcnt              : whether performance counters are enabled
+ *
+ * Serialize the core into the frame's state, keeping track of how long it
+ * takes.
+ */
+static bool netplay_sync_serialize(netplay_t *netplay,
+      struct delta_frame *delta, bool perfcnt)
+{
+   retro_ctx_serialize_info_t serial_info;
+   retro_time_t start = cpu_features_get_time_usec();
+   bool ret;
+
+   serial_info.data_const = NULL;
+   serial_info.data       = delta->state;
+   serial_info.size       = netplay->state_size;
+
+   performance_counter_start_plus(perfcnt, netplay_serialize_perf);
+   memset(serial_info.data, 0, serial_info.size);
+   ret = core_serialize(&serial_info);
+   performance_counter_stop_plus(perfcnt, netplay_serialize_perf);
+
+   delta->have_state = ret;
+
+   /* Running average, weighted by 1/16 */
+   start = cpu_features_get_time_usec() - start;
+   if (netplay->serialize_time_avg)
+      netplay->serialize_time_avg += (start - netplay->serialize_time_avg) / 16;
+   else
+      netplay->serialize_time_avg  = start;
+   return ret;
+}
+
+/**
+ * netplay_sync_wants_snapshot
+ * @netplay              : pointer to netplay object
+ * @delta                : frame about to be run for the first time
+ *
+ * Whether to snapshot this frame. Without sparse snapshots, every frame is.
+ */
+static bool netplay_sync_wants_snapshot(netplay_t *netplay,
+      struct delta_frame *delta)
+{
+   if (netplay->snapshot_interval <= 1 || netplay->force_send_savestate ||
+         netplay_is_check_frame(netplay, delta))
+      return true;
+
+   /* Going back past the last snapshot means it's of no use */
+   return delta->frame < netplay->snapshot_frame_count ||
+      delta->frame - netplay->snapshot_frame_count >=
+      netplay->snapshot_interval;
+}
+
+/**
+ * netplay_sync_tune_snapshots
+ * @netplay              : pointer to netplay object
+ *
+ * Choose how often to snapshot. Every snapshot we skip saves a serialize,
+ * both when the frame is first run and when it's replayed, but a rollback
+ * has to replay from the last snapshot before the frame it goes back to,
+ * on average half an interval more. So we pick the interval with the least
+ * serializing plus replaying for the rollbacks we have seen, as long as the
+ * replay of a rollback as deep as theirs still fits in a frame, or doesn't
+ * take longer than it did with a snapshot of every frame.
+ */
+static void netplay_sync_tune_snapshots(netplay_t *netplay)
+{
+   unsigned interval, depth;
+   retro_time_t serialize, run, budget;
+   retro_time_t best_cost = 0;
+   unsigned best         = 1;
+
+   if (!netplay->sparse_snapshots || netplay->stateless_mode)
+   {
+      netplay->snapshot_interval = 1;
+      return;
+   }
+
+   /* Nobody to roll back for, the snapshots are only there to be sent */
+   if (netplay->is_server && netplay->connected_players <= 1)
+   {
+      netplay->snapshot_interval = NETPLAY_SNAPSHOT_INTERVAL_MAX;
+      return;
+   }
+
+   /* We haven't replayed anything yet, so keep to what we have */
+   if (!netplay->frame_run_time_avg || !netplay->serialize_time_avg)
+      return;
+
+   /* The time to replay a frame includes the snapshots taken meanwhile */
+   serialize = netplay->serialize_time_avg;
+   run       = netplay->frame_run_time_avg -
+      serialize / netplay->snapshot_interval;
+   if (run < 1)
+      run = 1;
+   depth     = netplay->rollbacks ?
+      netplay->rollback_frames / netplay->rollbacks : 0;
+
+   /* FIXME: Using fixed 60fps for this calculation */
+   budget    = MAX(16666, (retro_time_t)depth * (run + serialize));
+
+   for (interval = 1; interval <= NETPLAY_SNAPSHOT_INTERVAL_MAX; interval++)
+   {
+      /* Over the last frames, with the cost doubled to stay in integers:
+       * frames * serialize / n + rollbacks * depth * serialize / n
+       *    + rollbacks * run * (n-1) / 2 */
+      retro_time_t cost  = 2 * (netplay->snapshot_tune_frames +
+            (retro_time_t)netplay->rollbacks * depth) * serialize / interval
+         + (retro_time_t)netplay->rollbacks * run * (interval - 1);
+      retro_time_t spike = (depth + interval - 1) * run +
+         depth * serialize / interval;
+
+      if (interval > 1 && spike > budget)
+         break;
+
+      if (interval == 1 || cost < best_cost)
+      {
+         best      = interval;
+         best_cost = cost;
+      }
+   }
+
+   netplay->snapshot_interval = best;
+}
+
+/**
+ * netplay_sync_find_snapshot
+ * @netplay              : pointer to netplay object
+ * @snapshot_ptr         : buffer index of the snapshot found
+ * @snapshot_frame_count : frame of the snapshot found
+ *
+ * Find the last frame at or before the replay frame that has a snapshot.
+ *
+ * Returns false if the buffer holds no such frame.
+ */
+static bool netplay_sync_find_snapshot(netplay_t *netplay,
+      size_t *snapshot_ptr, uint32_t *snapshot_frame_count)
+{
+   size_t ptr     = netplay->replay_ptr;
+   uint32_t frame = netplay->replay_frame_count;
+
+   while (!netplay->buffer[ptr].have_state)
+   {
+      ptr = PREV_PTR(ptr);
+      frame--;
+      if (ptr == netplay->replay_ptr || !netplay->buffer[ptr].used ||
+            netplay->buffer[ptr].frame != frame)
+         return false;
+   }
+
+   if (!netplay->buffer[ptr].used || netplay->buffer[ptr].frame != frame)
+      return false;
+
+   *snapshot_ptr         = ptr;
+   *snapshot_frame_count = frame;
+   return true;
+}
+
 /**
  * netplay_sync_pre_frame
  * @netplay              : pointer to netplay object
@@ -553,24 +737,32 @@ static void netplay_handle_frame_hash(netplay_t *netplay,
  */
 bool netplay_sync_pre_frame(netplay_t *netplay)
 {
-   retro_ctx_serialize_info_t serial_info;
+   struct delta_frame *delta = &netplay->buffer[netplay->run_ptr];
 
-   if (netplay_delta_frame_ready(netplay,
-            &netplay->buffer[netplay->run_ptr], netplay->run_frame_count))
+   if (netplay_delta_frame_ready(netplay, delta, netplay->run_frame_count))
    {
+      retro_ctx_serialize_info_t serial_info;
+
       serial_info.data_const = NULL;
-      serial_info.data       = netplay->buffer[netplay->run_ptr].state;
+      serial_info.data       = delta->state;
       serial_info.size       = netplay->state_size;
 
-      memset(serial_info.data, 0, serial_info.size);
       if ((netplay->quirks & NETPLAY_QUIRK_INITIALIZATION)
             || netplay->run_frame_count == 0)
       {
          /* Don't serialize until it's safe */
+         memset(serial_info.data, 0, serial_info.size);
+      }
+      else if (!netplay_sync_wants_snapshot(netplay, delta))
+      {
+         /* We'll replay from an earlier snapshot */
       }
       else if (!(netplay->quirks & NETPLAY_QUIRK_NO_SAVESTATES)
-            && core_serialize(&serial_info))
+            && netplay_sync_serialize(netplay, delta,
+               netplay_perfcnt_enabled()))
       {
+         netplay->snapshot_frame_count = delta->frame;
+
          if (netplay->force_send_savestate && !netplay->stall
                && !netplay->remote_paused)
          {
@@ -581,6 +773,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
                memcpy(netplay->buffer[netplay->self_ptr].state,
                   netplay->buffer[netplay->run_ptr].state,
                   netplay->state_size);
+               netplay->buffer[netplay->self_ptr].have_state = true;
                netplay->run_ptr         = netplay->self_ptr;
                netplay->run_frame_count = netplay->self_frame_count;
             }
@@ -748,12 +941,22 @@ process:
 void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
 {
    uint32_t lo_frame_count, hi_frame_count;
+   size_t snapshot_ptr           = 0;
+   uint32_t snapshot_frame_count = 0;
 
    /* Unless we're stalling, we've just finished running a frame */
    if (!stalled)
    {
       netplay->run_ptr = NEXT_PTR(netplay->run_ptr);
       netplay->run_frame_count++;
+
+      if (++netplay->snapshot_tune_frames >= NETPLAY_SNAPSHOT_TUNE_FRAMES)
+      {
+         netplay_sync_tune_snapshots(netplay);
+         netplay->snapshot_tune_frames = 0;
+         netplay->rollbacks            = 0;
+         netplay->rollback_frames      = 0;
+      }
    }
 
    /* We've finished an input frame even if we're stalling */
@@ -832,11 +1035,58 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
    }
 #endif
 
+   /* Without a snapshot of the frame we go back to, we replay from the
+    * last one before it. If there is none, replaying would start from
+    * whatever state the buffer slot held last, so we resync instead. */
+   if ((netplay->force_rewind ||
+         netplay->replay_frame_count < netplay->run_frame_count) &&
+       netplay->sparse_snapshots &&
+       !netplay_sync_find_snapshot(netplay, &snapshot_ptr,
+          &snapshot_frame_count))
+   {
+      RARCH_WARN("Netplay has no snapshot to roll back to from frame %u, "
+            "resyncing.\n", netplay->replay_frame_count);
+
+      if (netplay->is_server)
+         netplay->force_send_savestate = true;
+      else
+         netplay_cmd_request_savestate(netplay);
+
+      netplay->replay_ptr           = netplay->run_ptr;
+      netplay->replay_frame_count   = netplay->run_frame_count;
+      if (netplay->unread_frame_count < netplay->run_frame_count)
+      {
+         netplay->other_ptr         = netplay->unread_ptr;
+         netplay->other_frame_count = netplay->unread_frame_count;
+      }
+      else
+      {
+         netplay->other_ptr         = netplay->run_ptr;
+         netplay->other_frame_count = netplay->run_frame_count;
+      }
+      netplay->force_rewind         = false;
+   }
+
    /* Now replay the real input if we've gotten ahead of it */
    if (netplay->force_rewind ||
        netplay->replay_frame_count < netplay->run_frame_count)
    {
       retro_ctx_serialize_info_t serial_info;
+      bool perfcnt                = netplay_perfcnt_enabled();
+      uint32_t resim_frame_count  = netplay->replay_frame_count;
+
+      netplay->rollbacks++;
+      netplay->rollback_frames += netplay->run_frame_count -
+         netplay->replay_frame_count;
+
+      /* Replay from the snapshot found above */
+      if (netplay->sparse_snapshots)
+      {
+         netplay->replay_ptr         = snapshot_ptr;
+         netplay->replay_frame_count = snapshot_frame_count;
+      }
+
+      performance_counter_start_plus(perfcnt, netplay_resim_perf);
 
       /* Replay frames. */
       netplay->is_replay = true;
@@ -883,11 +1133,17 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
 
          start                   = cpu_features_get_time_usec();
 
-         /* Remember the current state */
-         memset(serial_info.data, 0, serial_info.size);
-         core_serialize(&serial_info);
-         if (netplay->replay_frame_count < netplay->unread_frame_count)
-            netplay_handle_frame_hash(netplay, ptr);
+         /* Frames before the one we went back to are replayed as they
+          * were, the rest get their snapshots and CRCs redone */
+         if (netplay->replay_frame_count >= resim_frame_count)
+         {
+            /* Remember the current state */
+            if (ptr->have_state || netplay->snapshot_interval <= 1 ||
+                  netplay_is_check_frame(netplay, ptr))
+               netplay_sync_serialize(netplay, ptr, perfcnt);
+            if (netplay->replay_frame_count < netplay->unread_frame_count)
+               netplay_handle_frame_hash(netplay, ptr);
+         }
 
          /* Re-simulate this frame's input */
          netplay_resolve_input(netplay, netplay->replay_ptr, true);
@@ -928,6 +1184,8 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
             netplay->frame_run_time_ptr = 0;
       }
 
+      performance_counter_stop_plus(perfcnt, netplay_resim_perf);
+
       /* Average our time */
       netplay->frame_run_time_avg   = netplay->frame_run_time_sum / NETPLAY_FRAME_RUN_TIME_WINDOW;
 
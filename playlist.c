@@ -26,6 +26,7 @@
 #include <retro_miscellaneous.h>
 #include <compat/posix_string.h>
 #include <string/stdstring.h>
+#include <rhash.h>
 #include <streams/interface_stream.h>
 #include <streams/file_stream.h>
 #include <file/file_path.h>
@@ -40,11 +41,56 @@
 #define PLAYLIST_ENTRIES 6
 #endif
 
+#define PLAYLIST_INDEX_MIN_BUCKETS    256
+#define PLAYLIST_INDEX_MAX_CANDIDATES 32
+
+/* Node of the path index. Maps the normalised
+ * 'real' path (or the archive part of it) of an
+ * entry to the entry's 'path' string and position.
+ * The string is owned by the entry and is only ever
+ * compared by address, so it doubles as a stable
+ * entry identifier when entries are moved around.
+ * 'pos' minus the playlist's index_origin is the
+ * index of the entry, so that pushing an entry to
+ * the top does not have to touch every node */
+typedef struct playlist_index_node
+{
+   uint32_t hash;
+   char *key;
+   const char *path;
+   size_t pos;
+   struct playlist_index_node *next;
+} playlist_index_node_t;
+
+typedef struct
+{
+   playlist_index_node_t **buckets;
+   size_t num_buckets;
+   size_t count;
+} playlist_index_table_t;
+
+/* Set of entries that may match a search path,
+ * as entry indices in ascending order.
+ * If 'valid' is false, the index could not be
+ * used and every entry must be considered */
+typedef struct
+{
+   size_t idx[PLAYLIST_INDEX_MAX_CANDIDATES];
+   size_t count;
+   bool valid;
+} playlist_candidates_t;
+
 struct content_playlist
 {
    bool modified;
+   /* Set once path_index and archive_index have
+    * been built. Built lazily on first lookup */
+   bool index_built;
    size_t size;
    size_t cap;
+   /* Position of entry 0 in the path index,
+    * see playlist_index_node_t */
+   size_t index_origin;
 
    enum playlist_label_display_mode label_display_mode;
    enum playlist_thumbnail_mode right_thumbnail_mode;
@@ -54,6 +100,9 @@ struct content_playlist
    char *default_core_path;
    char *default_core_name;
    struct playlist_entry *entries;
+
+   playlist_index_table_t path_index;
+   playlist_index_table_t archive_index;
 };
 
 typedef struct
@@ -215,6 +264,412 @@ static bool playlist_core_path_equal(const char *real_core_path, const char *ent
    return false;
 }
 
+/**
+ * playlist_index_key:
+ * @path                : Entry or search path
+ * @key                 : Output normalised 'real' path
+ * @archive_key         : Output archive part of path
+ *                        (set to "" if path is not
+ *                        an archive path)
+ *
+ * Generates the path index keys of @path, such that
+ * paths considered equal by playlist_path_equal()
+ * share the same @key, or the same @archive_key when
+ * fuzzy archive matching applies.
+ **/
+static void playlist_index_key(const char *path,
+      char *key, char *archive_key, size_t size)
+{
+   const char *delim = NULL;
+
+   key[0]         = '\0';
+   archive_key[0] = '\0';
+
+   if (string_is_empty(path))
+      return;
+
+   strlcpy(key, path, size);
+   path_resolve_realpath(key, size, true);
+
+#ifdef _WIN32
+   /* Handle case-insensitive operating systems*/
+   string_to_lower(key);
+#endif
+
+   if (path_is_compressed_file(key))
+      strlcpy(archive_key, key, size);
+   else if ((delim = path_get_archive_delim(key)))
+   {
+      size_t len = (size_t)(1 + delim - key);
+      strlcpy(archive_key, key, (len < size) ? len : size);
+   }
+}
+
+static void playlist_index_table_free(playlist_index_table_t *table)
+{
+   size_t i;
+
+   for (i = 0; i < table->num_buckets; i++)
+   {
+      playlist_index_node_t *node = table->buckets[i];
+
+      while (node)
+      {
+         playlist_index_node_t *next = node->next;
+         free(node->key);
+         free(node);
+         node = next;
+      }
+   }
+
+   free(table->buckets);
+
+   table->buckets     = NULL;
+   table->num_buckets = 0;
+   table->count       = 0;
+}
+
+static bool playlist_index_table_grow(playlist_index_table_t *table)
+{
+   size_t i;
+   size_t num_buckets             = table->num_buckets ?
+      table->num_buckets * 2 : PLAYLIST_INDEX_MIN_BUCKETS;
+   playlist_index_node_t **buckets = (playlist_index_node_t**)
+      calloc(num_buckets, sizeof(*buckets));
+
+   if (!buckets)
+      return false;
+
+   for (i = 0; i < table->num_buckets; i++)
+   {
+      playlist_index_node_t *node = table->buckets[i];
+
+      while (node)
+      {
+         playlist_index_node_t *next = node->next;
+         size_t idx                  = node->hash & (num_buckets - 1);
+
+         node->next   = buckets[idx];
+         buckets[idx] = node;
+         node         = next;
+      }
+   }
+
+   free(table->buckets);
+
+   table->buckets     = buckets;
+   table->num_buckets = num_buckets;
+
+   return true;
+}
+
+static void playlist_index_table_add(playlist_index_table_t *table,
+      const char *key, const char *path, size_t pos)
+{
+   size_t idx;
+   playlist_index_node_t *node = NULL;
+
+   if (string_is_empty(key))
+      return;
+
+   if (table->count >= table->num_buckets)
+      if (!playlist_index_table_grow(table))
+         return;
+
+   node = (playlist_index_node_t*)malloc(sizeof(*node));
+
+   if (!node)
+      return;
+
+   node->hash          = djb2_calculate(key);
+   node->key           = strdup(key);
+   node->path          = path;
+   node->pos           = pos;
+
+   idx                 = node->hash & (table->num_buckets - 1);
+   node->next          = table->buckets[idx];
+   table->buckets[idx] = node;
+   table->count++;
+}
+
+static void playlist_index_table_remove(playlist_index_table_t *table,
+      const char *key, const char *path)
+{
+   size_t i;
+
+   if (!table->buckets)
+      return;
+
+   /* Check the bucket of the current key first.
+    * If the file system has changed since the
+    * entry was added, the key may now differ -
+    * so fall back to checking every bucket */
+   for (i = 0; i <= table->num_buckets; i++)
+   {
+      playlist_index_node_t **prev = NULL;
+      size_t idx                   = i;
+
+      if (i == 0)
+      {
+         if (string_is_empty(key))
+            continue;
+         idx = djb2_calculate(key) & (table->num_buckets - 1);
+      }
+      else
+         idx = i - 1;
+
+      for (prev = &table->buckets[idx]; *prev; prev = &(*prev)->next)
+      {
+         playlist_index_node_t *node = *prev;
+
+         if (node->path != path)
+            continue;
+
+         *prev = node->next;
+         free(node->key);
+         free(node);
+         table->count--;
+         return;
+      }
+   }
+}
+
+static void playlist_index_table_find(playlist_t *playlist,
+      playlist_index_table_t *table, const char *key,
+      playlist_candidates_t *candidates)
+{
+   uint32_t hash;
+   playlist_index_node_t *node = NULL;
+
+   if (!candidates->valid || !table->buckets || string_is_empty(key))
+      return;
+
+   hash = djb2_calculate(key);
+
+   for (node = table->buckets[hash & (table->num_buckets - 1)];
+         node; node = node->next)
+   {
+      size_t i = node->pos - playlist->index_origin;
+      size_t j;
+
+      if (node->hash != hash || !string_is_equal(node->key, key))
+         continue;
+
+      /* Too many entries share this key, or the
+       * position is stale - give up and let the
+       * caller check every entry */
+      if (     candidates->count >= PLAYLIST_INDEX_MAX_CANDIDATES
+            || i >= playlist->size
+            || playlist->entries[i].path != node->path)
+      {
+         candidates->valid = false;
+         return;
+      }
+
+      /* Keep the set sorted and free of duplicates,
+       * an entry can be found through both tables */
+      for (j = candidates->count; j > 0; j--)
+         if (candidates->idx[j - 1] <= i)
+            break;
+
+      if (j > 0 && candidates->idx[j - 1] == i)
+         continue;
+
+      memmove(candidates->idx + j + 1, candidates->idx + j,
+            (candidates->count - j) * sizeof(size_t));
+      candidates->idx[j] = i;
+      candidates->count++;
+   }
+}
+
+static void playlist_index_table_move(playlist_index_table_t *table,
+      size_t origin, size_t from, size_t to)
+{
+   size_t i;
+
+   for (i = 0; i < table->num_buckets; i++)
+   {
+      playlist_index_node_t *node;
+
+      for (node = table->buckets[i]; node; node = node->next)
+      {
+         size_t idx = node->pos - origin;
+
+         if (idx == from)
+            node->pos = origin + to;
+         else if (from < to && idx > from && idx <= to)
+            node->pos--;
+         else if (from > to && idx >= to && idx < from)
+            node->pos++;
+      }
+   }
+}
+
+/**
+ * playlist_index_add:
+ * @playlist            : Playlist handle.
+ * @path                : 'path' string of a playlist entry.
+ * @idx                 : Index of the playlist entry.
+ *
+ * Registers a new playlist entry in the path index.
+ * Does nothing if the index has not been built yet.
+ **/
+static void playlist_index_add(playlist_t *playlist, const char *path,
+      size_t idx)
+{
+   char key[PATH_MAX_LENGTH];
+   char archive_key[PATH_MAX_LENGTH];
+
+   if (!playlist->index_built || string_is_empty(path))
+      return;
+
+   playlist_index_key(path, key, archive_key, sizeof(key));
+   playlist_index_table_add(&playlist->path_index, key, path,
+         playlist->index_origin + idx);
+   playlist_index_table_add(&playlist->archive_index, archive_key, path,
+         playlist->index_origin + idx);
+}
+
+/**
+ * playlist_index_remove:
+ * @playlist            : Playlist handle.
+ * @path                : 'path' string of a playlist entry.
+ *
+ * Removes a playlist entry from the path index.
+ * Must be called before @path is freed.
+ **/
+static void playlist_index_remove(playlist_t *playlist, const char *path)
+{
+   char key[PATH_MAX_LENGTH];
+   char archive_key[PATH_MAX_LENGTH];
+
+   if (!playlist->index_built || string_is_empty(path))
+      return;
+
+   playlist_index_key(path, key, archive_key, sizeof(key));
+   playlist_index_table_remove(&playlist->path_index, key, path);
+   playlist_index_table_remove(&playlist->archive_index, archive_key, path);
+}
+
+/**
+ * playlist_index_move:
+ * @playlist            : Playlist handle.
+ * @from                : Old index of the entry.
+ * @to                  : New index of the entry.
+ *
+ * Updates the path index after the entry at @from
+ * was moved to @to and the entries in between were
+ * shifted by one to make room. Deleting an entry is
+ * moving it to the end, after it has been removed.
+ **/
+static void playlist_index_move(playlist_t *playlist,
+      size_t from, size_t to)
+{
+   if (!playlist->index_built || from == to)
+      return;
+
+   playlist_index_table_move(&playlist->path_index,
+         playlist->index_origin, from, to);
+   playlist_index_table_move(&playlist->archive_index,
+         playlist->index_origin, from, to);
+}
+
+/**
+ * playlist_index_insert_front:
+ * @playlist            : Playlist handle.
+ *
+ * Updates the path index after every entry was
+ * shifted up by one to insert a new entry at the top.
+ **/
+static void playlist_index_insert_front(playlist_t *playlist)
+{
+   playlist->index_origin--;
+}
+
+static void playlist_index_free(playlist_t *playlist)
+{
+   playlist_index_table_free(&playlist->path_index);
+   playlist_index_table_free(&playlist->archive_index);
+   playlist->index_built = false;
+}
+
+static void playlist_index_build(playlist_t *playlist)
+{
+   size_t i;
+
+   if (playlist->index_built)
+      return;
+
+   playlist->index_built = true;
+
+   for (i = 0; i < playlist->size; i++)
+      playlist_index_add(playlist, playlist->entries[i].path, i);
+}
+
+/**
+ * playlist_index_get_candidates:
+ * @playlist            : Playlist handle.
+ * @real_path           : 'Real' search path, generated by path_resolve_realpath()
+ * @candidates          : Output set of entries that may match @real_path
+ *
+ * Looks up the entries whose path may be equal to
+ * @real_path according to playlist_path_equal().
+ * Callers must still check each candidate with
+ * playlist_path_equal().
+ **/
+static void playlist_index_get_candidates(playlist_t *playlist,
+      const char *real_path, bool fuzzy_archive_match,
+      playlist_candidates_t *candidates)
+{
+   char key[PATH_MAX_LENGTH];
+   char archive_key[PATH_MAX_LENGTH];
+
+   candidates->count = 0;
+   candidates->valid = !string_is_empty(real_path);
+
+   if (!candidates->valid)
+      return;
+
+   playlist_index_build(playlist);
+   playlist_index_key(real_path, key, archive_key, sizeof(key));
+
+   playlist_index_table_find(playlist, &playlist->path_index,
+         key, candidates);
+
+#ifdef RARCH_INTERNAL
+   if (!fuzzy_archive_match)
+      return;
+#endif
+
+   playlist_index_table_find(playlist, &playlist->archive_index,
+         archive_key, candidates);
+}
+
+/**
+ * playlist_index_next_candidate:
+ * @playlist            : Playlist handle.
+ * @candidates          : Set returned by playlist_index_get_candidates()
+ * @idx                 : First index to check
+ *
+ * Returns the index of the first candidate entry
+ * at or after @idx, or the playlist size if there
+ * are none left.
+ **/
+static size_t playlist_index_next_candidate(playlist_t *playlist,
+      const playlist_candidates_t *candidates, size_t idx)
+{
+   size_t j;
+
+   if (!candidates->valid)
+      return idx;
+
+   for (j = 0; j < candidates->count; j++)
+      if (candidates->idx[j] >= idx)
+         return candidates->idx[j];
+
+   return playlist->size;
+}
+
 uint32_t playlist_get_size(playlist_t *playlist)
 {
    if (!playlist)
@@ -329,11 +784,15 @@ void playlist_delete_index(playlist_t *playlist,
    /* Free unwanted entry */
    entry_to_delete = (struct playlist_entry *)(playlist->entries + idx);
    if (entry_to_delete)
+   {
+      playlist_index_remove(playlist, entry_to_delete->path);
       playlist_free_entry(entry_to_delete);
+   }
 
    /* Shift remaining entries to fill the gap */
    memmove(playlist->entries + idx, playlist->entries + idx + 1,
          (playlist->size - idx) * sizeof(struct playlist_entry));
+   playlist_index_move(playlist, idx, playlist->size);
 
    playlist->modified = true;
 }
@@ -344,6 +803,7 @@ void playlist_get_index_by_path(playlist_t *playlist,
       bool fuzzy_archive_match)
 {
    size_t i;
+   playlist_candidates_t candidates;
    char real_search_path[PATH_MAX_LENGTH];
 
    real_search_path[0] = '\0';
@@ -355,7 +815,12 @@ void playlist_get_index_by_path(playlist_t *playlist,
    strlcpy(real_search_path, search_path, sizeof(real_search_path));
    path_resolve_realpath(real_search_path, sizeof(real_search_path), true);
 
-   for (i = 0; i < playlist->size; i++)
+   playlist_index_get_candidates(playlist, real_search_path,
+         fuzzy_archive_match, &candidates);
+
+   for (i = playlist_index_next_candidate(playlist, &candidates, 0);
+        i < playlist->size;
+        i = playlist_index_next_candidate(playlist, &candidates, i + 1))
    {
       if (!playlist_path_equal(real_search_path, playlist->entries[i].path,
                fuzzy_archive_match))
@@ -371,6 +836,7 @@ bool playlist_entry_exists(playlist_t *playlist,
       const char *path, bool fuzzy_archive_match)
 {
    size_t i;
+   playlist_candidates_t candidates;
    char real_search_path[PATH_MAX_LENGTH];
 
    real_search_path[0] = '\0';
@@ -382,7 +848,12 @@ bool playlist_entry_exists(playlist_t *playlist,
    strlcpy(real_search_path, path, sizeof(real_search_path));
    path_resolve_realpath(real_search_path, sizeof(real_search_path), true);
 
-   for (i = 0; i < playlist->size; i++)
+   playlist_index_get_candidates(playlist, real_search_path,
+         fuzzy_archive_match, &candidates);
+
+   for (i = playlist_index_next_candidate(playlist, &candidates, 0);
+        i < playlist->size;
+        i = playlist_index_next_candidate(playlist, &candidates, i + 1))
       if (playlist_path_equal(real_search_path, playlist->entries[i].path,
                fuzzy_archive_match))
          return true;
@@ -403,8 +874,12 @@ void playlist_update(playlist_t *playlist, size_t idx,
    if (update_entry->path && (update_entry->path != entry->path))
    {
       if (entry->path != NULL)
+      {
+         playlist_index_remove(playlist, entry->path);
          free(entry->path);
+      }
       entry->path        = strdup(update_entry->path);
+      playlist_index_add(playlist, entry->path, idx);
       playlist->modified = true;
    }
 
@@ -464,9 +939,13 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
    if (update_entry->path && (update_entry->path != entry->path))
    {
       if (entry->path != NULL)
+      {
+         playlist_index_remove(playlist, entry->path);
          free(entry->path);
+      }
       entry->path        = NULL;
       entry->path        = strdup(update_entry->path);
+      playlist_index_add(playlist, entry->path, idx);
       playlist->modified = playlist->modified || register_update;
    }
 
@@ -563,6 +1042,7 @@ bool playlist_push_runtime(playlist_t *playlist,
       bool fuzzy_archive_match)
 {
    size_t i;
+   playlist_candidates_t candidates;
    char real_path[PATH_MAX_LENGTH];
    char real_core_path[PATH_MAX_LENGTH];
 
@@ -596,7 +1076,12 @@ bool playlist_push_runtime(playlist_t *playlist,
       return false;
    }
 
-   for (i = 0; i < playlist->size; i++)
+   playlist_index_get_candidates(playlist, real_path,
+         fuzzy_archive_match, &candidates);
+
+   for (i = playlist_index_next_candidate(playlist, &candidates, 0);
+        i < playlist->size;
+        i = playlist_index_next_candidate(playlist, &candidates, i + 1))
    {
       struct playlist_entry tmp;
       const char *entry_path = playlist->entries[i].path;
@@ -622,6 +1107,7 @@ bool playlist_push_runtime(playlist_t *playlist,
       memmove(playlist->entries + 1, playlist->entries,
             i * sizeof(struct playlist_entry));
       playlist->entries[0] = tmp;
+      playlist_index_move(playlist, i, 0);
 
       goto success;
    }
@@ -631,20 +1117,27 @@ bool playlist_push_runtime(playlist_t *playlist,
       struct playlist_entry *last_entry = &playlist->entries[playlist->cap - 1];
 
       if (last_entry)
+      {
+         playlist_index_remove(playlist, last_entry->path);
          playlist_free_entry(last_entry);
+      }
       playlist->size--;
    }
 
    if (playlist->entries)
    {
+      /* Only entries up to 'size' are valid, and
+       * 'size' is below 'cap' at this point */
       memmove(playlist->entries + 1, playlist->entries,
-            (playlist->cap - 1) * sizeof(struct playlist_entry));
+            playlist->size * sizeof(struct playlist_entry));
+      playlist_index_insert_front(playlist);
 
       playlist->entries[0].path            = NULL;
       playlist->entries[0].core_path       = NULL;
 
       if (!string_is_empty(real_path))
          playlist->entries[0].path      = strdup(real_path);
+      playlist_index_add(playlist, playlist->entries[0].path, 0);
       if (!string_is_empty(real_core_path))
          playlist->entries[0].core_path = strdup(real_core_path);
 
@@ -731,6 +1224,7 @@ bool playlist_push(playlist_t *playlist,
       bool fuzzy_archive_match)
 {
    size_t i;
+   playlist_candidates_t candidates;
    char real_path[PATH_MAX_LENGTH];
    char real_core_path[PATH_MAX_LENGTH];
    const char *core_name = entry->core_name;
@@ -779,7 +1273,12 @@ bool playlist_push(playlist_t *playlist,
       }
    }
 
-   for (i = 0; i < playlist->size; i++)
+   playlist_index_get_candidates(playlist, real_path,
+         fuzzy_archive_match, &candidates);
+
+   for (i = playlist_index_next_candidate(playlist, &candidates, 0);
+        i < playlist->size;
+        i = playlist_index_next_candidate(playlist, &candidates, i + 1))
    {
       struct playlist_entry tmp;
       const char *entry_path = playlist->entries[i].path;
@@ -889,6 +1388,7 @@ bool playlist_push(playlist_t *playlist,
       memmove(playlist->entries + 1, playlist->entries,
             i * sizeof(struct playlist_entry));
       playlist->entries[0] = tmp;
+      playlist_index_move(playlist, i, 0);
 
       goto success;
    }
@@ -899,14 +1399,20 @@ bool playlist_push(playlist_t *playlist,
          &playlist->entries[playlist->cap - 1];
 
       if (last_entry)
+      {
+         playlist_index_remove(playlist, last_entry->path);
          playlist_free_entry(last_entry);
+      }
       playlist->size--;
    }
 
    if (playlist->entries)
    {
+      /* Only entries up to 'size' are valid, and
+       * 'size' is below 'cap' at this point */
       memmove(playlist->entries + 1, playlist->entries,
-            (playlist->cap - 1) * sizeof(struct playlist_entry));
+            playlist->size * sizeof(struct playlist_entry));
+      playlist_index_insert_front(playlist);
 
       playlist->entries[0].path               = NULL;
       playlist->entries[0].label              = NULL;
@@ -931,6 +1437,7 @@ bool playlist_push(playlist_t *playlist,
       playlist->entries[0].last_played_second = 0;
       if (!string_is_empty(real_path))
          playlist->entries[0].path            = strdup(real_path);
+      playlist_index_add(playlist, playlist->entries[0].path, 0);
       if (!string_is_empty(entry->label))
          playlist->entries[0].label           = strdup(entry->label);
       if (!string_is_empty(real_core_path))
@@ -1593,6 +2100,8 @@ void playlist_free(playlist_t *playlist)
    free(playlist->entries);
    playlist->entries = NULL;
 
+   playlist_index_free(playlist);
+
    free(playlist);
 }
 
@@ -1616,6 +2125,8 @@ void playlist_clear(playlist_t *playlist)
          playlist_free_entry(entry);
    }
    playlist->size = 0;
+
+   playlist_index_free(playlist);
 }
 
 /**
@@ -2360,6 +2871,14 @@ playlist_t *playlist_init(const char *path, size_t size)
    playlist->default_core_name    = NULL;
    playlist->default_core_path    = NULL;
    playlist->entries              = entries;
+   playlist->index_built          = false;
+   playlist->index_origin         = 0;
+   playlist->path_index.buckets       = NULL;
+   playlist->path_index.num_buckets   = 0;
+   playlist->path_index.count         = 0;
+   playlist->archive_index.buckets     = NULL;
+   playlist->archive_index.num_buckets = 0;
+   playlist->archive_index.count       = 0;
    playlist->label_display_mode   = LABEL_DISPLAY_MODE_DEFAULT;
    playlist->right_thumbnail_mode = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
    playlist->left_thumbnail_mode  = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
@@ -2448,6 +2967,9 @@ end:
 
 void playlist_qsort(playlist_t *playlist)
 {
+   /* Entry positions change, rebuild the
+    * path index on the next lookup */
+   playlist_index_free(playlist);
    qsort(playlist->entries, playlist->size,
          sizeof(struct playlist_entry),
          (int (*)(const void *, const void *))playlist_qsort_func);
@@ -199,6 +199,7 @@
 #endif
 #include "gfx/video_display_server.h"
 #include "gfx/video_crt_switch.h"
+#include "gfx/video_frame_jobs.h"
 #include "wifi/wifi_driver.h"
 #include "led/led_driver.h"
 #include "midi/midi_driver.h"
@@ -221,12 +222,17 @@
 #include "retroarch.h"
 
 #ifdef HAVE_RUNAHEAD
+#include <memalign.h>
+#if defined(__linux__) && !defined(ANDROID)
+#include <sys/mman.h>
+#endif
 #include "runahead/mylist.h"
 #include "runahead/mem_util.h"
 #endif
 
 #ifdef HAVE_THREADS
 #include "audio/audio_thread_wrapper.h"
+#include "audio/audio_pipeline.h"
 #endif
 
 /* DRIVERS */
@@ -3068,6 +3074,11 @@ static struct retro_system_av_info video_driver_av_info;
 /* AUDIO GLOBAL VARIABLES */
 #define AUDIO_BUFFER_FREE_SAMPLES_COUNT (8 * 1024)
 
+/* Chunks the audio pipeline ring holds: one being processed,
+ * one queued and one being filled. Every queued chunk adds to
+ * the latency once audio sync blocks on the ring. */
+#define AUDIO_PIPELINE_SLOTS 3
+
 #define MENU_SOUND_FORMATS "ogg|mod|xm|s3m|mp3|flac"
 
 /**
@@ -3133,6 +3144,12 @@ static void *audio_driver_context_audio_data             = NULL;
 
 static bool audio_suspended                              = false;
 static bool audio_is_threaded                            = false;
+static bool audio_driver_nonblock                        = false;
+
+#ifdef HAVE_THREADS
+static audio_pipeline_t *audio_driver_pipeline           = NULL;
+static uint64_t audio_driver_pipeline_frame_count        = 0;
+#endif
 
 /* RUNAHEAD GLOBAL VARIABLES */
 
@@ -3152,8 +3169,11 @@ static bool request_fast_savestate              = false;
 static bool hard_disable_audio                  = false;
 
 #ifdef HAVE_RUNAHEAD
-/* Save State List for Run Ahead */
-static MyList *runahead_save_state_list         = NULL;
+/* Save State for Run Ahead, see runahead_save_state_arena_init() */
+static retro_ctx_serialize_info_t runahead_save_state_info;
+static void *runahead_save_state_arena          = NULL;
+static struct retro_perf_counter runahead_serialize_perf;
+static struct retro_perf_counter runahead_unserialize_perf;
 static MyList *input_state_list                 = NULL;
 
 static bool input_is_dirty                      = false;
@@ -3476,6 +3496,8 @@ static void ui_companion_driver_deinit(void);
 
 static bool audio_driver_stop(void);
 static bool audio_driver_start(bool is_shutdown);
+static void audio_driver_pipeline_init(void);
+static void audio_driver_pipeline_deinit(void);
 
 static bool recording_init(void);
 static bool recording_deinit(void);
@@ -7039,6 +7061,7 @@ TODO: Add a setting for these tweaks */
             if (!string_is_empty(settings->paths.directory_libretro))
                core_info_init_list(settings->paths.path_libretro_info,
                      settings->paths.directory_libretro,
+                     settings->paths.directory_cache,
                      ext_name,
                      settings->bools.show_hidden_files
                      );
@@ -7956,6 +7979,7 @@ void main_exit(void *args)
 
    retroarch_msg_queue_deinit();
    driver_uninit(DRIVERS_CMD_ALL);
+   video_frame_jobs_shared_free();
    command_event(CMD_EVENT_LOG_FILE_DEINIT, NULL);
 
    rarch_ctl(RARCH_CTL_STATE_FREE,  NULL);
@@ -18399,6 +18423,37 @@ size_t midi_driver_get_event_size(uint8_t status)
 
 /* AUDIO */
 
+/* Keeps the audio pipeline thread out of audio_driver_process()
+ * and the driver while state they use is changed. */
+static void audio_driver_pipeline_lock(void)
+{
+#ifdef HAVE_THREADS
+   if (audio_driver_pipeline)
+      audio_pipeline_lock(audio_driver_pipeline);
+#endif
+}
+
+static void audio_driver_pipeline_unlock(void)
+{
+#ifdef HAVE_THREADS
+   if (audio_driver_pipeline)
+      audio_pipeline_unlock(audio_driver_pipeline);
+#endif
+}
+
+static void audio_driver_set_nonblock_state(bool enable)
+{
+   audio_driver_nonblock = enable;
+
+   if (!audio_driver_active || !audio_driver_context_audio_data)
+      return;
+
+   audio_driver_pipeline_lock();
+   current_audio->set_nonblock_state(audio_driver_context_audio_data,
+         enable);
+   audio_driver_pipeline_unlock();
+}
+
 #ifdef HAVE_AUDIOMIXER
 static void audio_mixer_play_stop_sequential_cb(
       audio_mixer_sound_t *sound, unsigned reason);
@@ -18406,6 +18461,8 @@ static void audio_mixer_play_stop_cb(
       audio_mixer_sound_t *sound, unsigned reason);
 static void audio_mixer_menu_stop_cb(
       audio_mixer_sound_t *sound, unsigned reason);
+static void audio_driver_mixer_play_stream_internal(
+      unsigned i, unsigned type);
 #endif
 
 static enum resampler_quality audio_driver_get_resampler_quality(void)
@@ -18633,6 +18690,7 @@ static bool audio_driver_free_devices_list(void)
 
 static bool audio_driver_deinit(void)
 {
+   audio_driver_pipeline_deinit();
 #ifdef HAVE_AUDIOMIXER
    audio_driver_mixer_deinit();
 #endif
@@ -18772,10 +18830,10 @@ static bool audio_driver_init_internal(bool audio_cb_inited)
          && current_audio->use_float(audio_driver_context_audio_data))
       audio_driver_use_float = true;
 
+   audio_driver_nonblock = false;
    if (!settings->bools.audio_sync && audio_driver_active)
    {
-      if (audio_driver_active && audio_driver_context_audio_data)
-         current_audio->set_nonblock_state(audio_driver_context_audio_data, true);
+      audio_driver_set_nonblock_state(true);
       audio_driver_chunk_size = audio_driver_chunk_nonblock_size;
    }
 
@@ -18850,6 +18908,13 @@ static bool audio_driver_init_internal(bool audio_cb_inited)
    audio_mixer_init(settings->uints.audio_out_rate);
 #endif
 
+   if (
+         audio_driver_active
+         && !audio_cb_inited
+         && settings->bools.audio_pipeline_thread
+      )
+      audio_driver_pipeline_init();
+
    /* Threaded driver is initially stopped. */
    if (
          audio_driver_active
@@ -18864,15 +18929,22 @@ error:
 }
 
 /**
- * audio_driver_flush:
+ * audio_driver_process:
+ * @userdata             : unused.
  * @data                 : pointer to audio buffer.
- * @right                : amount of samples to write.
+ * @samples              : amount of samples to process.
+ * @is_slowmotion        : whether slow motion is active.
+ * @output               : set to the samples to write.
  *
- * Writes audio samples to audio driver. Will first
- * perform DSP processing (if enabled) and resampling.
+ * Performs conversion, DSP processing (if enabled),
+ * resampling and mixing on audio samples. Runs on the
+ * audio pipeline thread if there is one.
+ *
+ * Returns: size of @output in bytes.
  **/
-static void audio_driver_flush(const int16_t *data, size_t samples,
-      bool is_slowmotion)
+static size_t audio_driver_process(void *userdata,
+      const int16_t *data, size_t samples,
+      bool is_slowmotion, const void **output)
 {
    struct resampler_data src_data;
    float audio_volume_gain           = !audio_driver_mute_enable ?
@@ -18973,12 +19045,111 @@ static void audio_driver_flush(const int16_t *data, size_t samples,
          output_frames  *= sizeof(int16_t);
       }
 
-      if (current_audio->write(audio_driver_context_audio_data,
-               output_data, output_frames * 2) < 0)
-         audio_driver_active = false;
+      *output            = output_data;
+      return output_frames * 2;
    }
 }
 
+static void audio_driver_write(void *userdata,
+      const void *output, size_t size)
+{
+   if (current_audio->write(audio_driver_context_audio_data,
+            output, size) < 0)
+      audio_driver_active = false;
+}
+
+/**
+ * audio_driver_flush:
+ * @data                 : pointer to audio buffer.
+ * @samples              : amount of samples to write.
+ * @is_slowmotion        : whether slow motion is active.
+ *
+ * Writes audio samples to audio driver, or queues them
+ * for the audio pipeline thread to do so.
+ **/
+static void audio_driver_flush(const int16_t *data, size_t samples,
+      bool is_slowmotion)
+{
+   const void *output = NULL;
+   size_t output_size = 0;
+
+#ifdef HAVE_THREADS
+   if (audio_driver_pipeline)
+   {
+      audio_pipeline_push(audio_driver_pipeline, data, samples,
+            is_slowmotion, !audio_driver_nonblock);
+      return;
+   }
+#endif
+
+   output_size = audio_driver_process(NULL, data, samples,
+         is_slowmotion, &output);
+   audio_driver_write(NULL, output, output_size);
+}
+
+/**
+ * audio_driver_pipeline_init:
+ *
+ * Moves audio_driver_process() and the driver writes
+ * off the main thread, onto a thread of their own.
+ **/
+static void audio_driver_pipeline_init(void)
+{
+#ifdef HAVE_THREADS
+   audio_driver_pipeline = audio_pipeline_new(
+         AUDIO_CHUNK_SIZE_NONBLOCKING * 2, AUDIO_CHUNK_SIZE_BLOCKING,
+         AUDIO_PIPELINE_SLOTS, audio_driver_process, audio_driver_write,
+         NULL);
+
+   if (!audio_driver_pipeline)
+   {
+      RARCH_WARN("[Audio]: Failed to start audio pipeline thread,"
+            " processing audio on the main thread.\n");
+      return;
+   }
+
+   audio_driver_pipeline_frame_count = video_driver_frame_count;
+   RARCH_LOG("[Audio]: Processing audio on the audio pipeline thread.\n");
+#endif
+}
+
+static void audio_driver_pipeline_deinit(void)
+{
+#ifdef HAVE_THREADS
+   audio_pipeline_stats_t stats;
+   uint64_t frames;
+
+   if (!audio_driver_pipeline)
+      return;
+
+   audio_pipeline_flush(audio_driver_pipeline);
+   audio_pipeline_get_stats(audio_driver_pipeline, &stats);
+   audio_pipeline_free(audio_driver_pipeline);
+   audio_driver_pipeline = NULL;
+
+   frames = video_driver_frame_count - audio_driver_pipeline_frame_count;
+   if (!frames || !stats.chunks)
+      return;
+
+   /* Without the pipeline, the main thread would have spent
+    * the processing and write time in audio_driver_flush().
+    * Waiting for room in the ring is what audio sync blocked
+    * on in the driver write before. */
+   RARCH_LOG("[Audio]: Audio pipeline stats: Processing: %.1f us/frame,"
+         " driver writes: %.1f us/frame, main thread queuing: %.1f us/frame"
+         " (%.1f us/frame waiting on the audio thread).\n",
+         (double)stats.process_usec / frames,
+         (double)stats.write_usec   / frames,
+         (double)stats.push_usec    / frames,
+         (double)stats.wait_usec    / frames);
+   RARCH_LOG("[Audio]: Main thread time saved: %.1f us/frame."
+         " Samples dropped: %u.\n",
+         ((double)stats.process_usec + (double)stats.write_usec
+          - (double)stats.push_usec) / frames,
+         (unsigned)stats.dropped_samples);
+#endif
+}
+
 /**
  * audio_driver_sample:
  * @left                 : value of the left audio channel.
@@ -19146,13 +19317,20 @@ static size_t audio_driver_sample_batch_rewind(
 
 void audio_driver_dsp_filter_free(void)
 {
-   if (audio_driver_dsp)
-      retro_dsp_filter_free(audio_driver_dsp);
+   retro_dsp_filter_t *dsp = NULL;
+
+   audio_driver_pipeline_lock();
+   dsp              = audio_driver_dsp;
    audio_driver_dsp = NULL;
+   audio_driver_pipeline_unlock();
+
+   if (dsp)
+      retro_dsp_filter_free(dsp);
 }
 
 bool audio_driver_dsp_filter_init(const char *device)
 {
+   retro_dsp_filter_t *dsp       = NULL;
    struct string_list *plugs     = NULL;
 #if defined(HAVE_DYLIB) && !defined(HAVE_FILTERS_BUILTIN)
    char *basedir   = (char*)calloc(PATH_MAX_LENGTH, sizeof(*basedir));
@@ -19173,11 +19351,14 @@ bool audio_driver_dsp_filter_init(const char *device)
    if (!plugs)
       return false;
 #endif
-   audio_driver_dsp = retro_dsp_filter_new(
-         device, plugs, audio_driver_input);
-   if (!audio_driver_dsp)
+   dsp = retro_dsp_filter_new(device, plugs, audio_driver_input);
+   if (!dsp)
       return false;
 
+   audio_driver_pipeline_lock();
+   audio_driver_dsp = dsp;
+   audio_driver_pipeline_unlock();
+
    return true;
 }
 
@@ -19386,7 +19567,12 @@ static void audio_mixer_play_stop_sequential_cb(
             {
                if (audio_mixer_streams[i].state == AUDIO_STREAM_STATE_STOPPED)
                {
-                  audio_driver_mixer_play_stream_sequential(i);
+                  /* Runs inside audio_mixer_mix(), which the audio
+                   * pipeline thread calls with its lock held. */
+                  audio_mixer_streams[i].stop_cb =
+                     audio_mixer_play_stop_sequential_cb;
+                  audio_driver_mixer_play_stream_internal(i,
+                        AUDIO_STREAM_STATE_PLAYING_SEQUENTIAL);
                   break;
                }
             }
@@ -19481,6 +19667,8 @@ bool audio_driver_mixer_add_stream(audio_mixer_stream_params_t *params)
       return false;
    }
 
+   audio_driver_pipeline_lock();
+
    switch (params->state)
    {
       case AUDIO_STREAM_STATE_PLAYING_LOOPED:
@@ -19510,6 +19698,8 @@ bool audio_driver_mixer_add_stream(audio_mixer_stream_params_t *params)
    audio_mixer_streams[free_slot].volume  = params->volume;
    audio_mixer_streams[free_slot].stop_cb = stop_cb;
 
+   audio_driver_pipeline_unlock();
+
    return true;
 }
 
@@ -19656,32 +19846,42 @@ end:
 
 void audio_driver_mixer_play_stream(unsigned i)
 {
+   audio_driver_pipeline_lock();
    audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_cb;
    audio_driver_mixer_play_stream_internal(i, AUDIO_STREAM_STATE_PLAYING);
+   audio_driver_pipeline_unlock();
 }
 
 void audio_driver_mixer_play_menu_sound_looped(unsigned i)
 {
+   audio_driver_pipeline_lock();
    audio_mixer_streams[i].stop_cb = audio_mixer_menu_stop_cb;
    audio_driver_mixer_play_stream_internal(i, AUDIO_STREAM_STATE_PLAYING_LOOPED);
+   audio_driver_pipeline_unlock();
 }
 
 void audio_driver_mixer_play_menu_sound(unsigned i)
 {
+   audio_driver_pipeline_lock();
    audio_mixer_streams[i].stop_cb = audio_mixer_menu_stop_cb;
    audio_driver_mixer_play_stream_internal(i, AUDIO_STREAM_STATE_PLAYING);
+   audio_driver_pipeline_unlock();
 }
 
 void audio_driver_mixer_play_stream_looped(unsigned i)
 {
+   audio_driver_pipeline_lock();
    audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_cb;
    audio_driver_mixer_play_stream_internal(i, AUDIO_STREAM_STATE_PLAYING_LOOPED);
+   audio_driver_pipeline_unlock();
 }
 
 void audio_driver_mixer_play_stream_sequential(unsigned i)
 {
+   audio_driver_pipeline_lock();
    audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_sequential_cb;
    audio_driver_mixer_play_stream_internal(i, AUDIO_STREAM_STATE_PLAYING_SEQUENTIAL);
+   audio_driver_pipeline_unlock();
 }
 
 float audio_driver_mixer_get_stream_volume(unsigned i)
@@ -19699,12 +19899,14 @@ void audio_driver_mixer_set_stream_volume(unsigned i, float vol)
    if (i >= AUDIO_MIXER_MAX_SYSTEM_STREAMS)
       return;
 
+   audio_driver_pipeline_lock();
    audio_mixer_streams[i].volume  = vol;
 
    voice                          = audio_mixer_streams[i].voice;
 
    if (voice)
       audio_mixer_voice_set_volume(voice, db_to_gain(vol));
+   audio_driver_pipeline_unlock();
 }
 
 void audio_driver_mixer_stop_stream(unsigned i)
@@ -19728,12 +19930,16 @@ void audio_driver_mixer_stop_stream(unsigned i)
 
    if (set_state)
    {
-      audio_mixer_voice_t *voice     = audio_mixer_streams[i].voice;
+      audio_mixer_voice_t *voice     = NULL;
+
+      audio_driver_pipeline_lock();
+      voice                          = audio_mixer_streams[i].voice;
 
       if (voice)
          audio_mixer_stop(voice);
       audio_mixer_streams[i].state   = AUDIO_STREAM_STATE_STOPPED;
       audio_mixer_streams[i].volume  = 1.0f;
+      audio_driver_pipeline_unlock();
    }
 }
 
@@ -19761,7 +19967,10 @@ void audio_driver_mixer_remove_stream(unsigned i)
 
    if (destroy)
    {
-      audio_mixer_sound_t *handle = audio_mixer_streams[i].handle;
+      audio_mixer_sound_t *handle = NULL;
+
+      audio_driver_pipeline_lock();
+      handle                      = audio_mixer_streams[i].handle;
       if (handle)
          audio_mixer_destroy(handle);
 
@@ -19774,6 +19983,7 @@ void audio_driver_mixer_remove_stream(unsigned i)
       audio_mixer_streams[i].handle  = NULL;
       audio_mixer_streams[i].voice   = NULL;
       audio_mixer_streams[i].name    = NULL;
+      audio_driver_pipeline_unlock();
    }
 }
 #endif
@@ -19804,8 +20014,10 @@ static void audio_driver_monitor_set_rate(void)
    double new_src_ratio       = (double)settings->uints.audio_out_rate /
       audio_driver_input;
 
+   audio_driver_pipeline_lock();
    audio_source_ratio_original = new_src_ratio;
    audio_source_ratio_current  = new_src_ratio;
+   audio_driver_pipeline_unlock();
 }
 
 bool audio_driver_callback(void)
@@ -19845,10 +20057,18 @@ static INLINE bool audio_driver_alive(void)
 
 static bool audio_driver_start(bool is_shutdown)
 {
+   bool started = false;
+
    if (!current_audio || !current_audio->start
          || !audio_driver_context_audio_data)
       goto error;
-   if (!current_audio->start(audio_driver_context_audio_data, is_shutdown))
+
+   audio_driver_pipeline_lock();
+   started = current_audio->start(audio_driver_context_audio_data,
+         is_shutdown);
+   audio_driver_pipeline_unlock();
+
+   if (!started)
       goto error;
 
    return true;
@@ -19862,12 +20082,24 @@ error:
 
 static bool audio_driver_stop(void)
 {
+   bool stopped = false;
+
    if (!current_audio || !current_audio->stop
          || !audio_driver_context_audio_data)
       return false;
-   if (!audio_driver_alive())
-      return false;
-   return current_audio->stop(audio_driver_context_audio_data);
+
+#ifdef HAVE_THREADS
+   /* A stopped driver might never take the queued chunks. */
+   if (audio_driver_pipeline)
+      audio_pipeline_flush(audio_driver_pipeline);
+#endif
+
+   audio_driver_pipeline_lock();
+   if (audio_driver_alive())
+      stopped = current_audio->stop(audio_driver_context_audio_data);
+   audio_driver_pipeline_unlock();
+
+   return stopped;
 }
 
 void audio_driver_frame_is_reverse(void)
@@ -21663,14 +21895,23 @@ static void video_driver_frame(const void *data, unsigned width,
          && data
          && (video_driver_pix_fmt == RETRO_PIXEL_FORMAT_0RGB1555)
          && (data != RETRO_HW_FRAME_BUFFER_VALID)
-         && video_pixel_frame_scale(
-            video_driver_scaler_ptr->scaler,
-            video_driver_scaler_ptr->scaler_out,
-            data, width, height, pitch)
       )
    {
+      struct scaler_ctx *scaler = video_driver_scaler_ptr->scaler;
+
+      scaler->in_width          = width;
+      scaler->in_height         = height;
+      scaler->out_width         = width;
+      scaler->out_height        = height;
+      scaler->in_stride         = (int)pitch;
+      scaler->out_stride        = width * sizeof(uint16_t);
+
+      /* Split into row bands on the frame job pool. */
+      video_frame_jobs_scale(video_frame_jobs_shared(), scaler,
+            video_driver_scaler_ptr->scaler_out, data);
+
       data                = video_driver_scaler_ptr->scaler_out;
-      pitch               = video_driver_scaler_ptr->scaler->out_stride;
+      pitch               = scaler->out_stride;
    }
 
    video_driver_build_info(&video_info);
@@ -23243,9 +23484,8 @@ void driver_set_nonblock_state(void)
       }
    }
 
-   if (audio_driver_active && audio_driver_context_audio_data)
-      current_audio->set_nonblock_state(audio_driver_context_audio_data,
-            settings->bools.audio_sync ? enable : true);
+   audio_driver_set_nonblock_state(settings->bools.audio_sync
+         ? enable : true);
    audio_driver_chunk_size = enable
       ? audio_driver_chunk_nonblock_size
       : audio_driver_chunk_block_size;
@@ -23802,60 +24042,56 @@ static void remove_input_state_hook(void)
    }
 }
 
-static void *runahead_save_state_alloc(void)
-{
-   retro_ctx_serialize_info_t *savestate = (retro_ctx_serialize_info_t*)
-      malloc(sizeof(retro_ctx_serialize_info_t));
-
-   if (!savestate)
-      return NULL;
-
-   savestate->data          = NULL;
-   savestate->data_const    = NULL;
-   savestate->size          = 0;
+/* States at least this large are backed by huge pages
+ * where the OS supports it */
+#define RUNAHEAD_HUGE_PAGE_SIZE (2 * 1024 * 1024)
 
-   if (runahead_save_state_size > 0 && runahead_save_state_size_known)
-   {
-      savestate->data       = malloc(runahead_save_state_size);
-      savestate->data_const = savestate->data;
-      savestate->size       = runahead_save_state_size;
-   }
+static void runahead_save_state_arena_free(void)
+{
+   if (runahead_save_state_arena)
+      memalign_free(runahead_save_state_arena);
 
-   return savestate;
+   runahead_save_state_arena           = NULL;
+   runahead_save_state_info.data       = NULL;
+   runahead_save_state_info.data_const = NULL;
+   runahead_save_state_info.size       = 0;
 }
 
-static void runahead_save_state_free(void *data)
+/* Allocates the state buffer once when run ahead starts, so
+ * that saving and loading it every frame never allocates. */
+static bool runahead_save_state_arena_init(size_t size)
 {
-   retro_ctx_serialize_info_t *savestate = (retro_ctx_serialize_info_t*)data;
-   if (!savestate)
-      return;
-   free(savestate->data);
-   free(savestate);
-}
+   void *arena                    = NULL;
 
-static void runahead_save_state_list_init(size_t saveStateSize)
-{
-   runahead_save_state_size       = saveStateSize;
+   runahead_save_state_arena_free();
+
+   runahead_save_state_size       = size;
    runahead_save_state_size_known = true;
 
-   mylist_create(&runahead_save_state_list, 16,
-         runahead_save_state_alloc, runahead_save_state_free);
-}
+   if (size == 0)
+      return false;
 
-#if 0
-static void runahead_save_state_list_rotate(void)
-{
-   unsigned i;
-   void *element      = NULL;
-   void *firstElement = runahead_save_state_list->data[0];
+#if defined(__linux__) && !defined(ANDROID) && defined(MADV_HUGEPAGE)
+   if (size >= RUNAHEAD_HUGE_PAGE_SIZE)
+   {
+      if ((arena = memalign_alloc(RUNAHEAD_HUGE_PAGE_SIZE, size)))
+         madvise(arena, size & ~(size_t)(RUNAHEAD_HUGE_PAGE_SIZE - 1),
+               MADV_HUGEPAGE);
+   }
+   else
+#endif
+      arena = memalign_alloc_aligned(size);
+
+   if (!arena)
+      return false;
+
+   runahead_save_state_arena           = arena;
+   runahead_save_state_info.data       = arena;
+   runahead_save_state_info.data_const = arena;
+   runahead_save_state_info.size       = size;
 
-   for (i = 1; i < runahead_save_state_list->size; i++)
-      runahead_save_state_list->data[i - 1] =
-         runahead_save_state_list->data[i];
-   runahead_save_state_list->data[runahead_save_state_list->size - 1] =
-      firstElement;
+   return true;
 }
-#endif
 
 /* Hooks - Hooks to cleanup, and add dirty input hooks */
 static void runahead_remove_hooks(void)
@@ -23887,7 +24123,7 @@ static void runahead_clear_variables(void)
 
 static void runahead_destroy(void)
 {
-   mylist_destroy(&runahead_save_state_list);
+   runahead_save_state_arena_free();
    runahead_remove_hooks();
    runahead_clear_variables();
 }
@@ -23932,7 +24168,7 @@ static void runahead_add_hooks(void)
 static void runahead_error(void)
 {
    runahead_available             = false;
-   mylist_destroy(&runahead_save_state_list);
+   runahead_save_state_arena_free();
    runahead_remove_hooks();
    runahead_save_state_size       = 0;
    runahead_save_state_size_known = true;
@@ -23946,35 +24182,38 @@ static bool runahead_create(void)
    core_serialize_size(&info);
    request_fast_savestate = false;
 
-   runahead_save_state_list_init(info.size);
    runahead_video_driver_is_active = video_driver_active;
 
-   if (runahead_save_state_size == 0 || !runahead_save_state_size_known)
+   if (!runahead_save_state_arena_init(info.size))
    {
       runahead_error();
       return false;
    }
 
+   performance_counter_init(runahead_serialize_perf,
+         "runahead_serialize");
+   performance_counter_init(runahead_unserialize_perf,
+         "runahead_unserialize");
+
    runahead_add_hooks();
    runahead_force_input_dirty = true;
-   mylist_resize(runahead_save_state_list, 1, true);
    return true;
 }
 
 static bool runahead_save_state(void)
 {
-   retro_ctx_serialize_info_t *serialize_info;
    bool okay                                  = false;
 
-   if (!runahead_save_state_list)
+   if (!runahead_save_state_arena)
       return false;
 
-   serialize_info         =
-      (retro_ctx_serialize_info_t*)runahead_save_state_list->data[0];
-
+   performance_counter_start_plus(runloop_perfcnt_enable,
+         runahead_serialize_perf);
    request_fast_savestate = true;
-   okay                   = core_serialize(serialize_info);
+   okay                   = core_serialize(&runahead_save_state_info);
    request_fast_savestate = false;
+   performance_counter_stop_plus(runloop_perfcnt_enable,
+         runahead_serialize_perf);
 
    if (okay)
       return true;
@@ -23986,10 +24225,11 @@ static bool runahead_save_state(void)
 static bool runahead_load_state(void)
 {
    bool okay                                  = false;
-   retro_ctx_serialize_info_t *serialize_info = (retro_ctx_serialize_info_t*)
-      runahead_save_state_list->data[0];
+   retro_ctx_serialize_info_t *serialize_info = &runahead_save_state_info;
    bool last_dirty                            = input_is_dirty;
 
+   performance_counter_start_plus(runloop_perfcnt_enable,
+         runahead_unserialize_perf);
    request_fast_savestate                     = true;
    /* calling core_unserialize has side effects with
     * netplay (it triggers transmitting your save state)
@@ -23998,6 +24238,8 @@ static bool runahead_load_state(void)
          serialize_info->data_const, serialize_info->size);
 
    request_fast_savestate = false;
+   performance_counter_stop_plus(runloop_perfcnt_enable,
+         runahead_unserialize_perf);
    input_is_dirty         = last_dirty;
 
    if (!okay)
@@ -24010,13 +24252,16 @@ static bool runahead_load_state(void)
 static bool runahead_load_state_secondary(void)
 {
    bool okay                                  = false;
-   retro_ctx_serialize_info_t *serialize_info =
-      (retro_ctx_serialize_info_t*)runahead_save_state_list->data[0];
+   retro_ctx_serialize_info_t *serialize_info = &runahead_save_state_info;
 
+   performance_counter_start_plus(runloop_perfcnt_enable,
+         runahead_unserialize_perf);
    request_fast_savestate                     = true;
    okay                                       = secondary_core_deserialize(
          serialize_info->data_const, (int)serialize_info->size);
    request_fast_savestate = false;
+   performance_counter_stop_plus(runloop_perfcnt_enable,
+         runahead_unserialize_perf);
 
    if (!okay)
    {
@@ -26005,13 +26250,29 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
          return runloop_paused;
       case RARCH_CTL_TASK_INIT:
          {
+            char image_cache_dir[PATH_MAX_LENGTH];
 #ifdef HAVE_THREADS
             settings_t *settings       = configuration_settings;
             bool threaded_enable       = settings->bools.threaded_data_runloop_enable;
+
+            task_queue_set_worker_count(
+                  settings->uints.threaded_data_runloop_workers);
 #else
             bool threaded_enable = false;
 #endif
             task_queue_deinit();
+#ifdef HAVE_NETWORKING
+            task_http_pool_deinit();
+            task_http_pool_init();
+#endif
+            /* Decoded thumbnails go to the cache directory,
+             * without one they are decoded every time */
+            image_cache_dir[0] = '\0';
+            if (!string_is_empty(configuration_settings->paths.directory_cache))
+               fill_pathname_join(image_cache_dir,
+                     configuration_settings->paths.directory_cache,
+                     "thumbnails", sizeof(image_cache_dir));
+            task_image_cache_init(image_cache_dir);
             task_queue_init(threaded_enable, runloop_task_msg_queue_push);
          }
          break;
@@ -26022,6 +26283,10 @@ bool rarch_ctl(enum rarch_ctl_state state, void *data)
          return runloop_shutdown_initiated;
       case RARCH_CTL_DATA_DEINIT:
          task_queue_deinit();
+#ifdef HAVE_NETWORKING
+         task_http_pool_deinit();
+#endif
+         task_image_cache_deinit();
          break;
       case RARCH_CTL_CORE_OPTION_PREV:
          /*
@@ -27864,8 +28129,7 @@ end:
          if (fastforward_after_frames == 1)
          {
             /* Nonblocking audio */
-            if (audio_driver_active && audio_driver_context_audio_data)
-               current_audio->set_nonblock_state(audio_driver_context_audio_data, true);
+            audio_driver_set_nonblock_state(true);
             audio_driver_chunk_size = audio_driver_chunk_nonblock_size;
          }
 
@@ -27874,10 +28138,8 @@ end:
          if (fastforward_after_frames == 6)
          {
             /* Blocking audio */
-            if (audio_driver_active && audio_driver_context_audio_data)
-               current_audio->set_nonblock_state(
-                     audio_driver_context_audio_data,
-                     settings->bools.audio_sync ? false : true);
+            audio_driver_set_nonblock_state(
+                  settings->bools.audio_sync ? false : true);
             audio_driver_chunk_size = audio_driver_chunk_block_size;
             fastforward_after_frames = 0;
          }
@@ -0,0 +1,380 @@
+/* Runs cheat searches over synthetic memory with every kernel
+ * this CPU supports, single threaded and on a job pool. Each
+ * step's candidates are checked against a byte-per-address
+ * reference of the search loop the cheat manager used to run,
+ * then the first pass over the whole memory is timed.
+ *
+ * Usage: cheat_search_bench [megabytes]
+ *
+ * Without arguments, 32 MB split into three regions are used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The kernels are internal to the search, pull it in the way
+ * griffin does. */
+#include "managers/cheat_search.c"
+
+#define NUM_KERNELS (sizeof(cheat_search_kernels) / sizeof(cheat_search_kernels[0]))
+#define NUM_REGIONS 3
+
+/* Memory the candidates are checked on, odd so the last item
+ * of every size is cut off. */
+#define CHECK_SIZE  (1024 * 1024 + 5)
+
+/* Timed passes per kernel and item size */
+#define BENCH_PASSES 8
+
+static uint32_t bench_seed = 1;
+
+static uint32_t bench_rand(void)
+{
+   bench_seed = bench_seed * 1103515245 + 12345;
+   return bench_seed >> 8;
+}
+
+typedef struct bench_memory
+{
+   uint8_t *data;
+   uint8_t *prev;
+   uint8_t *regions[NUM_REGIONS];
+   unsigned sizes[NUM_REGIONS];
+   size_t size;
+} bench_memory_t;
+
+/* Small values, so EXACT and the arithmetic comparisons hit. */
+static void bench_fill(bench_memory_t *mem)
+{
+   size_t i;
+
+   for (i = 0; i < mem->size; i++)
+      mem->data[i] = (bench_rand() & 3) ? (uint8_t)(bench_rand() & 7)
+         : (uint8_t)bench_rand();
+   memcpy(mem->prev, mem->data, mem->size);
+}
+
+/* Nudges a quarter of the bytes up or down, rewrites a few. */
+static void bench_mutate(bench_memory_t *mem)
+{
+   size_t i;
+
+   memcpy(mem->prev, mem->data, mem->size);
+
+   for (i = 0; i < mem->size; i++)
+   {
+      uint32_t r = bench_rand();
+
+      switch (r & 7)
+      {
+         case 0:
+            mem->data[i] += 1 + ((r >> 3) & 1);
+            break;
+         case 1:
+            mem->data[i] -= 1 + ((r >> 3) & 1);
+            break;
+         case 2:
+            if (!(r & 0xf00))
+               mem->data[i] = (uint8_t)(r >> 12);
+            break;
+         default:
+            break;
+      }
+   }
+}
+
+/* The regions are views into one allocation, with sizes that
+ * don't line up with any item size. */
+static void bench_regions(bench_memory_t *mem, cheat_search_memory_t *memory,
+      bool big_endian)
+{
+   mem->sizes[0]       = (unsigned)(mem->size / 2 + 3);
+   mem->sizes[1]       = (unsigned)(mem->size / 4 + 2);
+   mem->sizes[2]       = (unsigned)(mem->size - mem->sizes[0] - mem->sizes[1]);
+   mem->regions[0]     = mem->data;
+   mem->regions[1]     = mem->data + mem->sizes[0];
+   mem->regions[2]     = mem->data + mem->sizes[0] + mem->sizes[1];
+
+   memory->regions     = mem->regions;
+   memory->sizes       = mem->sizes;
+   memory->prev        = mem->prev;
+   memory->num_regions = NUM_REGIONS;
+   memory->big_endian  = big_endian;
+}
+
+/* The search loop of the cheat manager before the candidate
+ * set, on contiguous memory. */
+static size_t reference_step(uint8_t *matches, const bench_memory_t *mem,
+      unsigned bit_size, bool big_endian,
+      enum cheat_search_type type, unsigned value)
+{
+   size_t idx;
+   size_t count     = 0;
+   unsigned bits    = bit_size < 3 ? 1 << bit_size : 8;
+   unsigned bytes   = bit_size < 3 ? 1 : 1 << (bit_size - 3);
+   unsigned mask    = bits < 8 ? (1 << bits) - 1 : 0xFFFFFFFF;
+   cheat_search_query_t query;
+
+   query.type       = type;
+   query.value      = value;
+   query.big_endian = big_endian;
+
+   for (idx = 0; idx + bytes <= mem->size; idx += bytes)
+   {
+      unsigned part;
+      unsigned curr_val = cheat_search_value(mem->data + idx, bytes, big_endian);
+      unsigned prev_val = cheat_search_value(mem->prev + idx, bytes, big_endian);
+
+      for (part = 0; part < 8 / bits; part++)
+      {
+         unsigned part_mask = bits < 8 ? mask << (part * bits) : 0xFF;
+
+         if (!(matches[idx] & part_mask))
+            continue;
+
+         if (cheat_search_match(&query, (curr_val >> (part * bits)) & mask,
+                  (prev_val >> (part * bits)) & mask))
+            count++;
+         else
+            matches[idx] &= ~part_mask;
+      }
+   }
+
+   return count;
+}
+
+static bool check_candidates(const cheat_search_t *search,
+      const uint8_t *matches, size_t size, size_t expected)
+{
+   size_t candidate = 0;
+   size_t found     = 0;
+   size_t stride    = expected / 16 + 1;
+
+   if (cheat_search_count(search) != expected)
+   {
+      printf("count %u, expected %u\n",
+            (unsigned)cheat_search_count(search), (unsigned)expected);
+      return false;
+   }
+
+   for (; cheat_search_next(search, &candidate); candidate++)
+   {
+      unsigned address, address_mask;
+
+      cheat_search_address(search, candidate, &address, &address_mask);
+      if (address >= size || !(matches[address] & address_mask))
+      {
+         printf("stray candidate at %u/%02x\n", address, address_mask);
+         return false;
+      }
+
+      /* Spot check the nth lookup against the walk */
+      if (!(found % stride))
+      {
+         size_t nth = 0;
+
+         if (!cheat_search_nth(search, found, &nth) || nth != candidate)
+         {
+            printf("candidate %u is %u, walking gives %u\n",
+                  (unsigned)found, (unsigned)nth, (unsigned)candidate);
+            return false;
+         }
+      }
+      found++;
+   }
+
+   if (found != expected)
+   {
+      printf("walked %u candidates, expected %u\n",
+            (unsigned)found, (unsigned)expected);
+      return false;
+   }
+
+   return true;
+}
+
+static const struct
+{
+   enum cheat_search_type type;
+   unsigned value;
+} bench_steps[] = {
+   { CHEAT_SEARCH_TYPE_EXACT,   5          },
+   { CHEAT_SEARCH_TYPE_EXACT,   0x1FF      },
+   { CHEAT_SEARCH_TYPE_LT,      0          },
+   { CHEAT_SEARCH_TYPE_LTE,     0          },
+   { CHEAT_SEARCH_TYPE_GT,      0          },
+   { CHEAT_SEARCH_TYPE_GTE,     0          },
+   { CHEAT_SEARCH_TYPE_EQ,      0          },
+   { CHEAT_SEARCH_TYPE_NEQ,     0          },
+   { CHEAT_SEARCH_TYPE_EQPLUS,  1          },
+   { CHEAT_SEARCH_TYPE_EQPLUS,  0xFFFFFFFF },
+   { CHEAT_SEARCH_TYPE_EQMINUS, 2          },
+   { CHEAT_SEARCH_TYPE_EQMINUS, 0xFFFFFFFE },
+};
+
+#define NUM_STEPS (sizeof(bench_steps) / sizeof(bench_steps[0]))
+
+/* Every comparison as the first pass, then refined twice. */
+static bool check_kernel(bench_memory_t *mem, uint8_t *matches,
+      video_frame_jobs_t *jobs)
+{
+   unsigned bit_size, step, endian;
+
+   for (bit_size = 0; bit_size <= 5; bit_size++)
+   {
+      for (endian = 0; endian < 2; endian++)
+      {
+         for (step = 0; step < NUM_STEPS; step++)
+         {
+            unsigned refine;
+            cheat_search_memory_t memory;
+            cheat_search_t *search = cheat_search_new(bit_size, mem->size);
+
+            bench_regions(mem, &memory, endian != 0);
+            memset(matches, 0xFF, mem->size);
+
+            for (refine = 0; refine < 3; refine++)
+            {
+               size_t expected;
+               unsigned i  = (step + refine * 5) % NUM_STEPS;
+
+               bench_mutate(mem);
+               expected    = reference_step(matches, mem, bit_size,
+                     endian != 0, bench_steps[i].type, bench_steps[i].value);
+               cheat_search_step(search, &memory,
+                     bench_steps[i].type, bench_steps[i].value, jobs);
+
+               if (!check_candidates(search, matches, mem->size, expected))
+               {
+                  printf("  mismatch: %u-bit items, %s endian, search %u, value %u, pass %u\n",
+                        bit_size < 3 ? 1 << bit_size : 8 << (bit_size - 3),
+                        endian ? "big" : "little",
+                        (unsigned)bench_steps[i].type, bench_steps[i].value,
+                        refine);
+                  cheat_search_free(search);
+                  return false;
+               }
+            }
+
+            cheat_search_free(search);
+         }
+      }
+   }
+
+   return true;
+}
+
+static double bench_kernel(bench_memory_t *mem, unsigned bit_size,
+      video_frame_jobs_t *jobs)
+{
+   unsigned i;
+   cheat_search_memory_t memory;
+   retro_time_t total = 0;
+
+   bench_regions(mem, &memory, false);
+
+   for (i = 0; i < BENCH_PASSES; i++)
+   {
+      retro_time_t start;
+      cheat_search_t *search = cheat_search_new(bit_size, mem->size);
+
+      start  = cpu_features_get_time_usec();
+      cheat_search_step(search, &memory, CHEAT_SEARCH_TYPE_GTE, 0, jobs);
+      total += cpu_features_get_time_usec() - start;
+
+      cheat_search_free(search);
+   }
+
+   return (double)total / BENCH_PASSES / 1000.0;
+}
+
+static double bench_reference(bench_memory_t *mem, uint8_t *matches,
+      unsigned bit_size)
+{
+   retro_time_t start;
+
+   memset(matches, 0xFF, mem->size);
+   start = cpu_features_get_time_usec();
+   reference_step(matches, mem, bit_size, false, CHEAT_SEARCH_TYPE_GTE, 0);
+   return (cpu_features_get_time_usec() - start) / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned k, bit_size;
+   bench_memory_t mem, check;
+   uint8_t *matches;
+   video_frame_jobs_t *jobs;
+   uint64_t cpu       = cpu_features_get();
+   size_t megabytes   = argc > 1 ? strtoul(argv[1], NULL, 0) : 32;
+   int ret            = 0;
+
+   mem.size           = megabytes * 1024 * 1024;
+   mem.data           = (uint8_t*)malloc(mem.size);
+   mem.prev           = (uint8_t*)malloc(mem.size);
+   matches            = (uint8_t*)malloc(mem.size);
+   jobs               = video_frame_jobs_new(4);
+
+   if (!mem.size || !mem.data || !mem.prev || !matches)
+      return 1;
+
+   bench_fill(&mem);
+
+   check              = mem;
+   check.size         = MIN(mem.size, CHECK_SIZE);
+
+   setvbuf(stdout, NULL, _IONBF, 0);
+   printf("%u MB of memory, %u threads in the job pool\n",
+         (unsigned)megabytes, video_frame_jobs_num_threads(jobs));
+
+   for (k = 0; k < NUM_KERNELS; k++)
+   {
+      if ((cpu & cheat_search_kernels[k].simd) != cheat_search_kernels[k].simd)
+         continue;
+
+      cheat_search_kernel = &cheat_search_kernels[k];
+
+      if (     !check_kernel(&check, matches, NULL)
+            || !check_kernel(&check, matches, jobs))
+      {
+         printf("%-8s: candidates differ from the reference\n",
+               cheat_search_kernel->ident);
+         ret = 1;
+         continue;
+      }
+
+      printf("%-8s: matches the reference\n", cheat_search_kernel->ident);
+   }
+
+   printf("\nFirst pass over all items, ms per search:\n");
+   printf("%-10s %10s", "", "reference");
+   for (k = 0; k < NUM_KERNELS; k++)
+      if ((cpu & cheat_search_kernels[k].simd) == cheat_search_kernels[k].simd)
+         printf(" %10s %10s", cheat_search_kernels[k].ident, "+jobs");
+   printf("\n");
+
+   for (bit_size = 0; bit_size <= 5; bit_size++)
+   {
+      printf("%2u-bit     %10.2f",
+            bit_size < 3 ? 1 << bit_size : 8 << (bit_size - 3),
+            bench_reference(&mem, matches, bit_size));
+
+      for (k = 0; k < NUM_KERNELS; k++)
+      {
+         if ((cpu & cheat_search_kernels[k].simd) != cheat_search_kernels[k].simd)
+            continue;
+
+         cheat_search_kernel = &cheat_search_kernels[k];
+         printf(" %10.2f", bench_kernel(&mem, bit_size, NULL));
+         printf(" %10.2f", bench_kernel(&mem, bit_size, jobs));
+      }
+      printf("\n");
+   }
+
+   video_frame_jobs_free(jobs);
+   free(matches);
+   free(mem.prev);
+   free(mem.data);
+   return ret;
+}
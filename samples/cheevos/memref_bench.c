@@ -0,0 +1,381 @@
+/* Replays a RAM trace through the achievement evaluator, once
+ * with every peek going through the fixup lookup and once
+ * through the per-frame memory reference snapshot. The trigger
+ * results of both passes are checked against each other.
+ *
+ * Usage: memref_bench [-a <triggers>] [<trace> <ram size>]
+ *
+ * A trace is the system RAM dumped after each frame, one dump
+ * after the other. The triggers file has one achievement
+ * memaddr string per line. Without a trace, a synthetic 2 KB
+ * RAM trace and a synthetic set of triggers are used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <streams/file_stream.h>
+
+#include "cheevos-new/fixup.h"
+#include "retroarch.h"
+#include "core.h"
+
+#include <rcheevos.h>
+
+#define BENCH_MAX_TRIGGERS 4096
+
+/* The RAM the "core" exposes, the trace is copied into it
+ * frame by frame like a core would update its memory. */
+static uint8_t *bench_ram     = NULL;
+static size_t bench_ram_size  = 0;
+static rarch_system_info_t bench_system;
+
+rarch_system_info_t *runloop_get_system_info(void)
+{
+   return &bench_system;
+}
+
+bool core_get_memory(retro_ctx_memory_info_t *info)
+{
+   info->data = NULL;
+   info->size = 0;
+
+   if (info->id == RETRO_MEMORY_SYSTEM_RAM)
+   {
+      info->data = bench_ram;
+      info->size = bench_ram_size;
+   }
+
+   return true;
+}
+
+struct bench_state
+{
+   rcheevos_fixups_t fixups;
+   rcheevos_memrefs_t *memrefs;
+   unsigned invalid;
+};
+
+static unsigned bench_peek(unsigned address, unsigned num_bytes, void *ud)
+{
+   struct bench_state *state = (struct bench_state*)ud;
+   const uint8_t *data       = NULL;
+   unsigned value            = 0;
+
+   if (state->memrefs)
+      data = rcheevos_memrefs_find(state->memrefs, address, num_bytes);
+
+   if (!data)
+      data = rcheevos_fixup_find(&state->fixups, address, 0);
+
+   if (data)
+   {
+      switch (num_bytes)
+      {
+         case 4: value |= data[2] << 16 | data[3] << 24;
+         case 2: value |= data[1] << 8;
+         case 1: value |= data[0];
+      }
+   }
+   else
+      state->invalid++;
+
+   return value;
+}
+
+static double bench_now(void)
+{
+   return (double)clock() / CLOCKS_PER_SEC;
+}
+
+static uint32_t bench_rand(uint32_t *seed)
+{
+   *seed = *seed * 1103515245 + 12345;
+   return *seed >> 8;
+}
+
+/* A timer, a frame counter, a handful of slowly changing
+ * values and scattered writes, like a game's work RAM. */
+static uint8_t *make_synthetic_trace(size_t ram_size, unsigned frames)
+{
+   unsigned i, j;
+   uint32_t seed  = 1;
+   uint8_t *trace = (uint8_t*)malloc(ram_size * frames);
+   uint8_t *ram   = NULL;
+
+   if (!trace)
+      return NULL;
+
+   for (i = 0; i < ram_size; i++)
+      trace[i] = (uint8_t)bench_rand(&seed);
+
+   for (i = 1; i < frames; i++)
+   {
+      ram = trace + i * ram_size;
+      memcpy(ram, ram - ram_size, ram_size);
+
+      ram[0x10]++;
+      if ((i % 60) == 0)
+         ram[0x11]++;
+
+      for (j = 0; j < 8; j++)
+         if ((bench_rand(&seed) & 31) == 0)
+            ram[0x40 + j] += (uint8_t)(bench_rand(&seed) & 3);
+
+      for (j = 0; j < 32; j++)
+         ram[bench_rand(&seed) % ram_size] = (uint8_t)bench_rand(&seed);
+   }
+
+   return trace;
+}
+
+static char *make_synthetic_trigger(uint32_t *seed, size_t ram_size)
+{
+   static const char *sizes[] = { "0xH", "0x ", "0xX", "0xM", "0xU" };
+   char buffer[512];
+   size_t len       = 0;
+   unsigned i;
+   unsigned conds   = 3 + bench_rand(seed) % 4;
+
+   buffer[0] = '\0';
+
+   /* Some triggers dereference a pointer read from RAM. */
+   if ((bench_rand(seed) & 7) == 0)
+      len += snprintf(buffer + len, sizeof(buffer) - len,
+            "I:0xH%04x_0xH%04x=%u_",
+            (unsigned)(bench_rand(seed) % ram_size),
+            (unsigned)(bench_rand(seed) % 64),
+            (unsigned)(bench_rand(seed) & 0xff));
+
+   for (i = 0; i < conds; i++)
+   {
+      const char *size = sizes[bench_rand(seed) % 5];
+      unsigned addr    = (unsigned)(bench_rand(seed) % (ram_size - 4));
+
+      if (i > 0)
+         buffer[len++] = '_';
+
+      switch (bench_rand(seed) % 3)
+      {
+         case 0:
+            len += snprintf(buffer + len, sizeof(buffer) - len,
+                  "%s%04x=%u", size, addr, (unsigned)(bench_rand(seed) & 0x0f));
+            break;
+         case 1:
+            len += snprintf(buffer + len, sizeof(buffer) - len,
+                  "d%s%04x<%s%04x", size, addr, size, addr);
+            break;
+         default:
+            len += snprintf(buffer + len, sizeof(buffer) - len,
+                  "%s%04x!=0.%u.", size, addr, 2 + (unsigned)(bench_rand(seed) % 8));
+            break;
+      }
+   }
+
+   return strdup(buffer);
+}
+
+static unsigned read_triggers(const char *path, char **memaddrs)
+{
+   char line[4096];
+   unsigned count = 0;
+   FILE *file     = fopen(path, "r");
+
+   if (!file)
+      return 0;
+
+   while (count < BENCH_MAX_TRIGGERS && fgets(line, sizeof(line), file))
+   {
+      size_t len = strlen(line);
+
+      while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+         line[--len] = '\0';
+
+      if (len > 0)
+         memaddrs[count++] = strdup(line);
+   }
+
+   fclose(file);
+   return count;
+}
+
+/* Runs the whole trace through every trigger and returns a
+ * hash of the results so both passes can be compared. */
+static uint32_t bench_replay(char **memaddrs, unsigned num_triggers,
+      const uint8_t *trace, unsigned frames, bool snapshot,
+      double *seconds, unsigned *invalid)
+{
+   unsigned i, f;
+   struct bench_state state;
+   rcheevos_memrefs_t memrefs;
+   rc_trigger_t **triggers = (rc_trigger_t**)calloc(num_triggers, sizeof(*triggers));
+   uint32_t hash           = 2166136261U;
+   uint32_t memory_key     = 0;
+   double start;
+
+   rcheevos_fixup_init(&state.fixups);
+   rcheevos_memrefs_init(&memrefs);
+   state.memrefs = NULL;
+   state.invalid = 0;
+
+   for (i = 0; i < num_triggers; i++)
+   {
+      int size = rc_trigger_size(memaddrs[i]);
+
+      if (size < 0)
+         continue;
+
+      triggers[i] = (rc_trigger_t*)calloc(1, size);
+      rc_parse_trigger(triggers[i], memaddrs[i], NULL, 0);
+   }
+
+   start = bench_now();
+
+   for (f = 0; f < frames; f++)
+   {
+      memcpy(bench_ram, trace + f * bench_ram_size, bench_ram_size);
+
+      if (snapshot)
+      {
+         uint32_t key = rcheevos_memory_key();
+
+         if (key != memory_key)
+         {
+            rcheevos_fixup_destroy(&state.fixups);
+            memory_key    = key;
+            memrefs.dirty = true;
+         }
+
+         if (memrefs.dirty)
+         {
+            memrefs.count = 0;
+
+            for (i = 0; i < num_triggers; i++)
+               if (triggers[i])
+                  rcheevos_memrefs_add(&memrefs, triggers[i]->memrefs);
+
+            rcheevos_memrefs_resolve(&memrefs, &state.fixups, 0);
+            state.memrefs = &memrefs;
+         }
+
+         rcheevos_memrefs_snapshot(&memrefs);
+      }
+
+      for (i = 0; i < num_triggers; i++)
+      {
+         if (triggers[i])
+         {
+            int valid = rc_test_trigger(triggers[i], bench_peek, &state, NULL);
+            hash = (hash ^ (uint32_t)valid) * 16777619U;
+
+            if (valid)
+               rc_reset_trigger(triggers[i]);
+         }
+      }
+   }
+
+   *seconds = bench_now() - start;
+   *invalid = state.invalid;
+
+   for (i = 0; i < num_triggers; i++)
+      free(triggers[i]);
+   free(triggers);
+
+   rcheevos_memrefs_destroy(&memrefs);
+   rcheevos_fixup_destroy(&state.fixups);
+   return hash;
+}
+
+int main(int argc, char **argv)
+{
+   unsigned i;
+   unsigned frames;
+   unsigned num_triggers = 0;
+   uint8_t *trace        = NULL;
+   const char *triggers  = NULL;
+   char **memaddrs       = (char**)calloc(BENCH_MAX_TRIGGERS, sizeof(char*));
+   uint32_t hashes[2];
+   double seconds[2];
+   unsigned invalid[2];
+
+   if (argc > 2 && !strcmp(argv[1], "-a"))
+   {
+      triggers = argv[2];
+      argc    -= 2;
+      argv    += 2;
+   }
+
+   if (argc == 3)
+   {
+      int64_t len = 0;
+      void *buf   = NULL;
+
+      bench_ram_size = (size_t)strtoul(argv[2], NULL, 0);
+
+      if (bench_ram_size == 0 || !filestream_read_file(argv[1], &buf, &len))
+      {
+         printf("Could not read trace '%s'\n", argv[1]);
+         return 1;
+      }
+
+      trace  = (uint8_t*)buf;
+      frames = (unsigned)(len / bench_ram_size);
+   }
+   else if (argc == 1)
+   {
+      bench_ram_size = 2048;
+      frames         = 3600;
+      trace          = make_synthetic_trace(bench_ram_size, frames);
+   }
+   else
+   {
+      printf("Usage: %s [-a <triggers>] [<trace> <ram size>]\n", argv[0]);
+      return 1;
+   }
+
+   if (triggers)
+      num_triggers = read_triggers(triggers, memaddrs);
+   else
+   {
+      uint32_t seed = 7;
+
+      for (num_triggers = 0; num_triggers < 400; num_triggers++)
+         memaddrs[num_triggers] = make_synthetic_trigger(&seed, bench_ram_size);
+   }
+
+   if (!trace || frames == 0 || num_triggers == 0)
+   {
+      printf("Nothing to replay\n");
+      return 1;
+   }
+
+   bench_ram = (uint8_t*)malloc(bench_ram_size);
+
+   for (i = 0; i < 2; i++)
+      hashes[i] = bench_replay(memaddrs, num_triggers, trace, frames,
+            i == 1, &seconds[i], &invalid[i]);
+
+   printf("%u triggers, %u frames of %u bytes\n",
+         num_triggers, frames, (unsigned)bench_ram_size);
+   printf("fixups:   %8.2f ms, %.3f us/frame\n",
+         seconds[0] * 1000.0, seconds[0] * 1000000.0 / frames);
+   printf("snapshot: %8.2f ms, %.3f us/frame\n",
+         seconds[1] * 1000.0, seconds[1] * 1000000.0 / frames);
+
+   if (hashes[0] != hashes[1] || invalid[0] != invalid[1])
+   {
+      printf("mismatch: results %08x / %08x, invalid peeks %u / %u\n",
+            hashes[0], hashes[1], invalid[0], invalid[1]);
+      return 1;
+   }
+
+   for (i = 0; i < num_triggers; i++)
+      free(memaddrs[i]);
+   free(memaddrs);
+   free(bench_ram);
+   free(trace);
+
+   return 0;
+}
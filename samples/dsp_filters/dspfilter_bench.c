@@ -0,0 +1,432 @@
+/* Runs .dsp presets over audio with the scalar DSP filter
+ * kernels and with each set of SIMD kernels this CPU supports,
+ * reports the time per sample and how far the output of the
+ * SIMD kernels is from the scalar output.
+ *
+ * Usage: dspfilter_bench [-n <iterations>] [-c <chunk frames>] [-w <input.wav>] <preset.dsp>...
+ *
+ * Input is 8 or 16-bit PCM WAV, mono or stereo. Without it,
+ * ten seconds of synthetic tones and noise at 44.1 kHz are used.
+ * The audio is fed to the filter chain in chunks the way
+ * audio_driver_flush() does, one video frame worth at a time
+ * by default. A sample is one channel of a frame.
+ *
+ * e.g. dspfilter_bench -w music.wav ../../libretro-common/audio/dsp_filters/ *.dsp
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <file/config_file.h>
+#include <file/config_file_userdata.h>
+#include <file/file_path.h>
+#include <features/features_cpu.h>
+#include <formats/rwav.h>
+#include <libretro_dspfilter.h>
+#include <retro_miscellaneous.h>
+#include <string/stdstring.h>
+
+#define BENCH_MAX_FILTERS 32
+
+/* The filters are built with HAVE_FILTERS_BUILTIN, which
+ * gives each entry point its own name. */
+extern const struct dspfilter_implementation *chorus_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *delta_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *echo_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *eq_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *iir_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *panning_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *phaser_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *reverb_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *tremolo_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *vibrato_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *wahwah_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+
+static const dspfilter_get_implementation_t bench_plugs[] = {
+   chorus_dspfilter_get_implementation,
+   delta_dspfilter_get_implementation,
+   echo_dspfilter_get_implementation,
+   eq_dspfilter_get_implementation,
+   iir_dspfilter_get_implementation,
+   panning_dspfilter_get_implementation,
+   phaser_dspfilter_get_implementation,
+   reverb_dspfilter_get_implementation,
+   tremolo_dspfilter_get_implementation,
+   vibrato_dspfilter_get_implementation,
+   wahwah_dspfilter_get_implementation,
+};
+
+/* The first entry is the scalar code everything else is
+ * compared against. */
+static const struct
+{
+   const char *name;
+   dspfilter_simd_mask_t simd;
+} bench_backends[] = {
+   { "c",    0 },
+   { "sse",  DSPFILTER_SIMD_SSE },
+   { "avx",  DSPFILTER_SIMD_SSE | DSPFILTER_SIMD_AVX },
+   { "neon", DSPFILTER_SIMD_NEON },
+};
+
+static const struct dspfilter_config bench_config = {
+   config_userdata_get_float,
+   config_userdata_get_int,
+   config_userdata_get_float_array,
+   config_userdata_get_int_array,
+   config_userdata_get_string,
+   config_userdata_free,
+};
+
+struct bench_audio
+{
+   float *samples;
+   unsigned frames;
+   float rate;
+};
+
+struct bench_instance
+{
+   const struct dspfilter_implementation *impl;
+   void *data;
+};
+
+static struct bench_audio *make_tones(void)
+{
+   unsigned i;
+   struct bench_audio *audio = (struct bench_audio*)
+      calloc(1, sizeof(*audio));
+
+   audio->rate    = 44100.0f;
+   audio->frames  = 10 * 44100;
+   audio->samples = (float*)malloc(audio->frames * 2 * sizeof(float));
+
+   srand(1);
+
+   for (i = 0; i < audio->frames; i++)
+   {
+      double t  = i / (double)audio->rate;
+      float  l  = (float)(0.3 * sin(2.0 * M_PI * 440.0 * t)
+            + 0.2 * sin(2.0 * M_PI * 2750.0 * t));
+      float  r  = (float)(0.3 * sin(2.0 * M_PI * 330.0 * t)
+            + 0.2 * sin(2.0 * M_PI * 5100.0 * t));
+
+      audio->samples[i * 2 + 0] = l + 0.1f * (rand() / (float)RAND_MAX - 0.5f);
+      audio->samples[i * 2 + 1] = r + 0.1f * (rand() / (float)RAND_MAX - 0.5f);
+   }
+
+   return audio;
+}
+
+static struct bench_audio *load_wav(const char *path)
+{
+   unsigned i, c;
+   rwav_t wav;
+   long size;
+   struct bench_audio *audio = NULL;
+   void *buf                 = NULL;
+   FILE *file                = fopen(path, "rb");
+
+   if (!file)
+      return NULL;
+
+   fseek(file, 0, SEEK_END);
+   size = ftell(file);
+   rewind(file);
+
+   buf  = malloc(size > 0 ? size : 1);
+
+   if (size <= 0 || fread(buf, 1, size, file) != (size_t)size)
+      goto end;
+
+   if (rwav_load(&wav, buf, size) != RWAV_ITERATE_DONE)
+      goto end;
+
+   if (wav.numchannels == 1 || wav.numchannels == 2)
+   {
+      audio          = (struct bench_audio*)calloc(1, sizeof(*audio));
+      audio->rate    = (float)wav.samplerate;
+      audio->frames  = (unsigned)wav.numsamples;
+      audio->samples = (float*)malloc(audio->frames * 2 * sizeof(float));
+
+      for (i = 0; i < audio->frames; i++)
+      {
+         for (c = 0; c < 2; c++)
+         {
+            unsigned s = i * wav.numchannels + (wav.numchannels == 2 ? c : 0);
+
+            if (wav.bitspersample == 16)
+               audio->samples[i * 2 + c] =
+                  ((const int16_t*)wav.samples)[s] / 32768.0f;
+            else
+               audio->samples[i * 2 + c] =
+                  (((const uint8_t*)wav.samples)[s] - 128) / 128.0f;
+         }
+      }
+   }
+
+   rwav_free(&wav);
+
+end:
+   free(buf);
+   fclose(file);
+   return audio;
+}
+
+static void free_chain(struct bench_instance *instances, unsigned num)
+{
+   unsigned i;
+   for (i = 0; i < num; i++)
+      if (instances[i].data)
+         instances[i].impl->free(instances[i].data);
+}
+
+/* Same as create_filter_graph() in dsp_filter.c, with the
+ * implementations picked for 'simd'. */
+static unsigned make_chain(config_file_t *conf, dspfilter_simd_mask_t simd,
+      float rate, struct bench_instance *instances)
+{
+   unsigned i, j;
+   unsigned filters = 0;
+
+   if (!config_get_uint(conf, "filters", &filters)
+         || filters == 0 || filters > BENCH_MAX_FILTERS)
+      return 0;
+
+   memset(instances, 0, filters * sizeof(*instances));
+
+   for (i = 0; i < filters; i++)
+   {
+      struct config_file_userdata userdata;
+      struct dspfilter_info info;
+      char key[64];
+      char name[64];
+
+      info.input_rate = rate;
+
+      snprintf(key, sizeof(key), "filter%u", i);
+
+      if (!config_get_array(conf, key, name, sizeof(name)))
+         goto error;
+
+      for (j = 0; j < ARRAY_SIZE(bench_plugs); j++)
+      {
+         const struct dspfilter_implementation *impl = bench_plugs[j](simd);
+         if (string_is_equal(impl->short_ident, name))
+            instances[i].impl = impl;
+      }
+
+      if (!instances[i].impl)
+      {
+         printf("Unknown filter '%s'\n", name);
+         goto error;
+      }
+
+      userdata.conf      = conf;
+      userdata.prefix[0] = key;
+      userdata.prefix[1] = instances[i].impl->short_ident;
+
+      if (!(instances[i].data = instances[i].impl->init(&info,
+                  &bench_config, &userdata)))
+         goto error;
+   }
+
+   return filters;
+
+error:
+   free_chain(instances, filters);
+   return 0;
+}
+
+/* Processes the audio in place, chunk by chunk, like
+ * retro_dsp_filter_process(). Filters with their own output
+ * buffer (eq) never return more frames than they were given
+ * in total, so their output is moved back into the buffer
+ * behind the input that is still to come. */
+static double run_chain(struct bench_instance *instances, unsigned num,
+      float *samples, unsigned frames, unsigned chunk, unsigned *out_frames)
+{
+   unsigned i, pos;
+   retro_time_t start = cpu_features_get_time_usec();
+
+   *out_frames        = 0;
+
+   for (pos = 0; pos < frames; pos += chunk)
+   {
+      struct dspfilter_output output;
+      struct dspfilter_input input;
+
+      output.samples = samples + pos * 2;
+      output.frames  = MIN(chunk, frames - pos);
+
+      for (i = 0; i < num; i++)
+      {
+         input.samples = output.samples;
+         input.frames  = output.frames;
+         instances[i].impl->process(instances[i].data, &output, &input);
+      }
+
+      if (output.samples != samples + *out_frames * 2)
+         memmove(samples + *out_frames * 2, output.samples,
+               output.frames * 2 * sizeof(float));
+      *out_frames += output.frames;
+   }
+
+   return (cpu_features_get_time_usec() - start) / 1000000.0;
+}
+
+static int bench_preset(const char *path, const struct bench_audio *audio,
+      unsigned chunk, unsigned iterations)
+{
+   unsigned b, i;
+   struct bench_instance instances[BENCH_MAX_FILTERS];
+   float *reference          = NULL;
+   unsigned reference_frames = 0;
+   double reference_time     = 0.0;
+   float *samples            = (float*)malloc(audio->frames * 2 * sizeof(float));
+   uint64_t features         = cpu_features_get();
+   config_file_t *conf       = config_file_new_from_path_to_string(path);
+   int mismatches            = 0;
+
+   if (!conf)
+   {
+      printf("%s: could not read preset\n", path);
+      free(samples);
+      return 1;
+   }
+
+   for (b = 0; b < ARRAY_SIZE(bench_backends); b++)
+   {
+      unsigned out_frames  = 0;
+      double best          = 0.0;
+      float max_diff       = 0.0f;
+
+      if ((features & bench_backends[b].simd) != bench_backends[b].simd)
+         continue;
+
+      for (i = 0; i < iterations; i++)
+      {
+         double time;
+         unsigned num = make_chain(conf, bench_backends[b].simd,
+               audio->rate, instances);
+
+         if (!num)
+         {
+            printf("%s: could not create filters\n", path);
+            mismatches++;
+            goto end;
+         }
+
+         memcpy(samples, audio->samples, audio->frames * 2 * sizeof(float));
+         time = run_chain(instances, num, samples, audio->frames,
+               chunk, &out_frames);
+         free_chain(instances, num);
+
+         if (i == 0 || time < best)
+            best = time;
+      }
+
+      if (!reference)
+      {
+         reference        = samples;
+         reference_frames = out_frames;
+         reference_time   = best;
+         samples          = (float*)malloc(audio->frames * 2 * sizeof(float));
+      }
+      else if (out_frames != reference_frames)
+      {
+         printf("%s: %s returned %u frames, c returned %u\n", path,
+               bench_backends[b].name, out_frames, reference_frames);
+         mismatches++;
+         continue;
+      }
+      else
+      {
+         for (i = 0; i < out_frames * 2; i++)
+         {
+            float diff = (float)fabs(samples[i] - reference[i]);
+            if (diff > max_diff || diff != diff)
+               max_diff = diff;
+         }
+
+         /* The kernels are exact, apart from the divide
+          * on 32-bit ARM. */
+         if (!(max_diff <= 1e-5f))
+            mismatches++;
+      }
+
+      printf("%-24s %-5s %8.3f ns/sample", path_basename(path),
+            bench_backends[b].name,
+            best * 1e9 / (audio->frames * 2.0));
+
+      if (b)
+         printf("  %6.2fx  max diff %g", reference_time / best, max_diff);
+
+      printf("\n");
+   }
+
+end:
+   free(reference);
+   free(samples);
+   config_file_free(conf);
+   return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+   int i;
+   struct bench_audio *audio = NULL;
+   unsigned iterations       = 5;
+   unsigned chunk            = 0;
+   int mismatches            = 0;
+
+   for (i = 1; i < argc - 1 && argv[i][0] == '-'; i += 2)
+   {
+      if (!strcmp(argv[i], "-n"))
+         iterations = (unsigned)strtoul(argv[i + 1], NULL, 0);
+      else if (!strcmp(argv[i], "-c"))
+         chunk = (unsigned)strtoul(argv[i + 1], NULL, 0);
+      else if (!strcmp(argv[i], "-w") && !audio)
+      {
+         if (!(audio = load_wav(argv[i + 1])))
+         {
+            printf("Could not read WAV '%s'\n", argv[i + 1]);
+            return 1;
+         }
+      }
+      else
+         break;
+   }
+
+   if (i >= argc || iterations == 0)
+   {
+      printf("Usage: %s [-n <iterations>] [-c <chunk frames>] [-w <input.wav>] <preset.dsp>...\n",
+            argv[0]);
+      return 1;
+   }
+
+   if (!audio)
+      audio = make_tones();
+
+   /* eq has room for 4096 frames of output per call. */
+   if (chunk == 0)
+      chunk = (unsigned)(audio->rate / 60.0f + 0.5f);
+   if (chunk > 2048)
+      chunk = 2048;
+
+   printf("%u frames at %.0f Hz, %u frames per chunk\n",
+         audio->frames, audio->rate, chunk);
+
+   for (; i < argc; i++)
+      mismatches += bench_preset(argv[i], audio, chunk, iterations);
+
+   free(audio->samples);
+   free(audio);
+
+   if (mismatches)
+      printf("%d mismatches\n", mismatches);
+
+   return mismatches ? 1 : 0;
+}
@@ -0,0 +1,366 @@
+/* Renders a scrolling menu of multilingual labels on the CPU,
+ * once with the stb_unicode glyph cache and once with the fixed
+ * 16x16 slot cache it replaced, and reports the time per frame,
+ * how often glyphs had to be rasterized and how many atlas
+ * texels a renderer would have uploaded.
+ *
+ * Usage: font_atlas_bench [font.ttf] [size]
+ *
+ * Without arguments, the default font of stb_unicode at 24
+ * pixels is used. Scripts the font lacks are drawn with its
+ * missing glyph, which still takes a cache entry per code.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+
+/* The renderer and the cache are pulled in the way griffin does,
+ * the renderer brings the stb_truetype implementation along. */
+#include "gfx/font_atlas_cache.c"
+#include "gfx/drivers_font_renderer/stb_unicode.c"
+
+#define NUM_LABELS     4096
+#define VISIBLE_LABELS 24
+#define NUM_FRAMES     4096
+#define MAX_LABEL_LEN  48
+
+typedef struct bench_script
+{
+   const char *name;
+   uint32_t first;
+   uint32_t count;
+} bench_script_t;
+
+static const bench_script_t bench_scripts[] = {
+   { "latin",    0x0061, 26    },
+   { "latin-1",  0x00C0, 64    },
+   { "latin-a",  0x0100, 128   },
+   { "greek",    0x03B1, 25    },
+   { "cyrillic", 0x0430, 32    },
+   { "armenian", 0x0561, 38    },
+   { "hebrew",   0x05D0, 27    },
+   { "arabic",   0x0627, 36    },
+   { "georgian", 0x10D0, 33    },
+   { "kana",     0x3041, 86    },
+   { "hangul",   0xAC00, 2350  },
+   { "cjk",      0x4E00, 3000  },
+};
+
+#define NUM_SCRIPTS (sizeof(bench_scripts) / sizeof(bench_scripts[0]))
+
+typedef struct bench_label
+{
+   uint32_t codes[MAX_LABEL_LEN];
+   unsigned len;
+} bench_label_t;
+
+static uint32_t bench_seed = 1;
+
+static uint32_t bench_rand(void)
+{
+   bench_seed = bench_seed * 1103515245 + 12345;
+   return bench_seed >> 8;
+}
+
+/* Words of a single script, like a translated menu label. CJK
+ * labels mostly repeat the more common characters. */
+static void bench_make_labels(bench_label_t *labels)
+{
+   unsigned i;
+
+   for (i = 0; i < NUM_LABELS; i++)
+   {
+      const bench_script_t *script = &bench_scripts[bench_rand() % NUM_SCRIPTS];
+      bench_label_t *label         = &labels[i];
+      unsigned words               = 1 + bench_rand() % 4;
+
+      label->len = 0;
+
+      while (words-- && label->len < MAX_LABEL_LEN - 2)
+      {
+         unsigned chars = 2 + bench_rand() % 8;
+
+         if (label->len)
+            label->codes[label->len++] = ' ';
+
+         while (chars-- && label->len < MAX_LABEL_LEN)
+         {
+            uint32_t r = bench_rand() % script->count;
+            if (script->count > 256 && (bench_rand() & 3))
+               r %= 256;
+            label->codes[label->len++] = script->first + r;
+         }
+      }
+   }
+}
+
+/* The cache stb_unicode used before: fixed slots of the
+ * largest glyph size and a linear scan for the oldest one. */
+typedef struct ref_slot
+{
+   struct font_glyph glyph;
+   unsigned charcode;
+   unsigned last_used;
+   struct ref_slot *next;
+} ref_slot_t;
+
+typedef struct ref_renderer
+{
+   stb_unicode_font_renderer_t *font;
+   struct font_atlas atlas;
+   ref_slot_t slots[STB_UNICODE_ATLAS_ROWS * STB_UNICODE_ATLAS_COLS];
+   ref_slot_t *uc_map[0x100];
+   unsigned usage_counter;
+   unsigned misses;
+} ref_renderer_t;
+
+static ref_slot_t *ref_get_slot(ref_renderer_t *ref)
+{
+   int i, map_id;
+   unsigned oldest = 0;
+
+   for (i = 1; i < STB_UNICODE_ATLAS_ROWS * STB_UNICODE_ATLAS_COLS; i++)
+      if ((ref->usage_counter - ref->slots[i].last_used) >
+         (ref->usage_counter - ref->slots[oldest].last_used))
+         oldest = i;
+
+   map_id = ref->slots[oldest].charcode & 0xFF;
+   if (ref->uc_map[map_id] == &ref->slots[oldest])
+      ref->uc_map[map_id] = ref->slots[oldest].next;
+   else if (ref->uc_map[map_id])
+   {
+      ref_slot_t *ptr = ref->uc_map[map_id];
+      while (ptr->next && ptr->next != &ref->slots[oldest])
+         ptr = ptr->next;
+      ptr->next = ref->slots[oldest].next;
+   }
+
+   return &ref->slots[oldest];
+}
+
+static const struct font_glyph *ref_get_glyph(ref_renderer_t *ref,
+      uint32_t charcode)
+{
+   int x0 = 0, y1 = 0, advance_width = 0, left_side_bearing = 0;
+   int glyph_index;
+   uint8_t *dst;
+   unsigned map_id                 = charcode & 0xFF;
+   ref_slot_t *slot                = ref->uc_map[map_id];
+   stb_unicode_font_renderer_t *self = ref->font;
+
+   for (; slot; slot = slot->next)
+   {
+      if (slot->charcode == charcode)
+      {
+         slot->last_used = ref->usage_counter++;
+         return &slot->glyph;
+      }
+   }
+
+   ref->misses++;
+
+   slot                = ref_get_slot(ref);
+   slot->charcode      = charcode;
+   slot->next          = ref->uc_map[map_id];
+   ref->uc_map[map_id] = slot;
+
+   glyph_index = stbtt_FindGlyphIndex(&self->info, charcode);
+   dst         = ref->atlas.buffer + slot->glyph.atlas_offset_x
+      + slot->glyph.atlas_offset_y * ref->atlas.width;
+
+   stbtt_GetGlyphHMetrics(&self->info, glyph_index,
+         &advance_width, &left_side_bearing);
+   if (stbtt_GetGlyphBox(&self->info, glyph_index, &x0, NULL, NULL, &y1))
+      stbtt_MakeGlyphBitmap(&self->info, dst, self->max_glyph_width,
+            self->max_glyph_height, ref->atlas.width,
+            self->scale_factor, self->scale_factor, glyph_index);
+   else
+   {
+      int y;
+      for (y = 0; y < self->max_glyph_height; y++)
+         memset(dst + y * ref->atlas.width, 0, self->max_glyph_width);
+   }
+
+   slot->glyph.width         = self->max_glyph_width;
+   slot->glyph.height        = self->max_glyph_height;
+   slot->glyph.advance_x     = round_away_from_zero(
+         (float)advance_width * self->scale_factor);
+   slot->glyph.draw_offset_x = round_away_from_zero(
+         (float)x0 * self->scale_factor);
+   slot->glyph.draw_offset_y = round_away_from_zero(
+         (float)(-y1) * self->scale_factor);
+
+   ref->atlas.dirty = true;
+   slot->last_used  = ref->usage_counter++;
+   return &slot->glyph;
+}
+
+static bool ref_init(ref_renderer_t *ref, stb_unicode_font_renderer_t *font)
+{
+   unsigned x, y;
+   ref_slot_t *slot = ref->slots;
+
+   memset(ref, 0, sizeof(*ref));
+   ref->font         = font;
+   ref->atlas.width  = font->atlas.width;
+   ref->atlas.height = font->atlas.height;
+   ref->atlas.buffer = (uint8_t*)calloc(ref->atlas.width, ref->atlas.height);
+
+   if (!ref->atlas.buffer)
+      return false;
+
+   for (y = 0; y < STB_UNICODE_ATLAS_ROWS; y++)
+      for (x = 0; x < STB_UNICODE_ATLAS_COLS; x++, slot++)
+      {
+         slot->glyph.atlas_offset_x = x * font->max_glyph_width;
+         slot->glyph.atlas_offset_y = y * font->max_glyph_height;
+      }
+
+   for (x = 0; x < 256; x++)
+      ref_get_glyph(ref, x);
+
+   return true;
+}
+
+typedef struct bench_result
+{
+   retro_time_t usec;
+   uint64_t quads;
+   uint64_t texels;
+   uint64_t glyph_texels;
+   int64_t advance;
+   unsigned uploads;
+   unsigned misses;
+} bench_result_t;
+
+/* Measures and lays out the visible labels the way a menu
+ * driver does, then uploads the atlas if it changed. */
+static void bench_run(const bench_label_t *labels,
+      stb_unicode_font_renderer_t *font, ref_renderer_t *ref,
+      bench_result_t *result)
+{
+   unsigned frame, i, j;
+   struct font_atlas *atlas = ref ? &ref->atlas : &font->atlas;
+   retro_time_t start;
+
+   memset(result, 0, sizeof(*result));
+   atlas->dirty = false;
+   start        = cpu_features_get_time_usec();
+
+   for (frame = 0; frame < NUM_FRAMES; frame++)
+   {
+      /* Scroll one label every fourth frame. */
+      unsigned top = (frame / 4) % (NUM_LABELS - VISIBLE_LABELS);
+
+      for (i = top; i < top + VISIBLE_LABELS; i++)
+      {
+         int x     = 0;
+         int width = 0;
+
+         for (j = 0; j < labels[i].len; j++)
+         {
+            const struct font_glyph *glyph = ref
+               ? ref_get_glyph(ref, labels[i].codes[j])
+               : font_renderer_stb_unicode_get_glyph(font, labels[i].codes[j]);
+            if (glyph)
+               width += glyph->advance_x;
+         }
+
+         for (j = 0; j < labels[i].len; j++)
+         {
+            const struct font_glyph *glyph = ref
+               ? ref_get_glyph(ref, labels[i].codes[j])
+               : font_renderer_stb_unicode_get_glyph(font, labels[i].codes[j]);
+            if (!glyph)
+               continue;
+            x                    += glyph->advance_x;
+            result->quads++;
+            result->glyph_texels += glyph->width * glyph->height;
+         }
+
+         result->advance += width + x;
+      }
+
+      if (atlas->dirty)
+      {
+         if (atlas->dirty_width && atlas->dirty_height)
+            result->texels += atlas->dirty_width * atlas->dirty_height;
+         else
+            result->texels += atlas->width * atlas->height;
+         result->uploads++;
+         atlas->dirty = false;
+      }
+   }
+
+   result->usec = cpu_features_get_time_usec() - start;
+}
+
+static void bench_print(const char *name, const bench_result_t *result)
+{
+   printf("%-8s %8.2f us/frame %8u misses %6u uploads %10.1f Ktexels uploaded"
+         " %6.1f texels/quad\n",
+         name, (double)result->usec / NUM_FRAMES, result->misses,
+         result->uploads, result->texels / 1000.0,
+         result->quads ? (double)result->glyph_texels / result->quads : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+   ref_renderer_t *ref               = NULL;
+   bench_label_t *labels             = NULL;
+   stb_unicode_font_renderer_t *font = NULL;
+   const char *font_path             = argc > 1 ? argv[1]
+      : font_renderer_stb_unicode_get_default_font();
+   float font_size                   = argc > 2 ? atof(argv[2]) : 24.0f;
+   font_atlas_cache_stats_t stats;
+   bench_result_t result;
+
+   if (!font_path)
+   {
+      fprintf(stderr, "No font found, pass the path of a TrueType font.\n");
+      return 1;
+   }
+
+   font = (stb_unicode_font_renderer_t*)font_renderer_stb_unicode_init(
+         font_path, font_size);
+   if (!font)
+   {
+      fprintf(stderr, "Could not load %s.\n", font_path);
+      return 1;
+   }
+
+   labels = (bench_label_t*)malloc(NUM_LABELS * sizeof(*labels));
+   ref    = (ref_renderer_t*)malloc(sizeof(*ref));
+   if (!labels || !ref || !ref_init(ref, font))
+      return 1;
+
+   bench_make_labels(labels);
+
+   printf("%s at %.0f px, %ux%u atlas, %u labels, %u visible, %u frames\n",
+         font_path, font_size, font->atlas.width, font->atlas.height,
+         NUM_LABELS, VISIBLE_LABELS, NUM_FRAMES);
+
+   bench_run(labels, font, ref, &result);
+   result.misses = ref->misses;
+   bench_print("slots", &result);
+
+   font_atlas_cache_get_stats(font->cache, &stats);
+   bench_run(labels, font, NULL, &result);
+   {
+      font_atlas_cache_stats_t after;
+      font_atlas_cache_get_stats(font->cache, &after);
+      result.misses = after.misses - stats.misses;
+      bench_print("shelves", &result);
+      printf("shelves  %u evictions, %u glyphs cached\n",
+            after.evictions - stats.evictions, after.glyphs);
+   }
+
+   free(ref->atlas.buffer);
+   free(ref);
+   free(labels);
+   font_renderer_stb_unicode_free(font);
+   return 0;
+}
@@ -0,0 +1,431 @@
+/* Sends savestate resyncs between two netplay socket buffers over
+ * TCP loopback, the way CMD_LOAD_SAVESTATE does, with the whole
+ * state deflated as before and as deltas against the last state
+ * sent. The receiving thread decodes every state, checks it and
+ * acknowledges it, so that the latency covers encoding, the wire
+ * and decoding.
+ *
+ * Usage: netplay_delta_bench [megabytes] [frames between resyncs]
+ *
+ * Without arguments, a 4 MB state resynced every 120 frames of a
+ * synthetic core is used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <net/net_socket.h>
+#include <rthreads/rthreads.h>
+
+/* The codec is pulled in the way griffin does. */
+#include "network/netplay/netplay_state_delta.c"
+
+#define NUM_RESYNCS 16
+
+/* The socket buffers link against the spectator relay, which
+ * hangs up through this. No relay is attached here. */
+void netplay_hangup(netplay_t *netplay, struct netplay_connection *connection)
+{
+}
+
+enum bench_mode
+{
+   BENCH_ZLIB = 0,
+   BENCH_DELTA,
+   BENCH_DELTA_ZLIB
+};
+
+static const char *bench_mode_names[] = { "zlib", "delta", "delta+zlib" };
+
+typedef struct bench_peer
+{
+   int fd;
+   struct socket_buffer send_buf;
+   struct socket_buffer recv_buf;
+   struct compression_transcoder z;
+   uint8_t *base;
+   uint8_t *zbuffer;
+   uint8_t *delta;
+} bench_peer_t;
+
+typedef struct bench
+{
+   enum bench_mode mode;
+   size_t state_size;
+   size_t zbuffer_size;
+   size_t delta_size;
+
+   /* The state of the synthetic core, only changed while
+    * no resync is in flight. */
+   uint8_t *state;
+
+   bench_peer_t sender;
+   bench_peer_t receiver;
+
+   bool mismatch;
+} bench_t;
+
+static uint32_t bench_seed = 1;
+
+static uint32_t bench_rand(void)
+{
+   bench_seed = bench_seed * 1103515245 + 12345;
+   return bench_seed >> 8;
+}
+
+/* Work RAM, video RAM and sound RAM of about PS1 proportions,
+ * part empty, part tables, part noise. */
+static void bench_state_init(uint8_t *state, size_t size)
+{
+   size_t i;
+
+   for (i = 0; i < size; i += 4096)
+   {
+      size_t len = MIN(4096, size - i);
+      switch (bench_rand() % 4)
+      {
+         case 0:
+            memset(state + i, 0, len);
+            break;
+         case 1:
+         {
+            size_t j;
+            for (j = 0; j < len; j++)
+               state[i + j] = (uint8_t)(j * 7 + (j >> 5));
+            break;
+         }
+         default:
+         {
+            size_t j;
+            for (j = 0; j < len; j++)
+               state[i + j] = (uint8_t)(bench_rand() & 0x3F);
+            break;
+         }
+      }
+   }
+}
+
+/* A frame scatters writes over a hot part of work RAM and
+ * redraws the frame buffer at the start of video RAM. */
+static void bench_state_run(uint8_t *state, size_t size, unsigned frames)
+{
+   size_t hot   = size / 16;
+   size_t vram  = size / 2;
+   size_t fb    = MIN(size / 32, 150 * 1024);
+   unsigned f;
+
+   for (f = 0; f < frames; f++)
+   {
+      unsigned i;
+      uint8_t shade = (uint8_t)bench_rand();
+
+      for (i = 0; i < 512; i++)
+         state[bench_rand() % hot] = (uint8_t)bench_rand();
+
+      for (i = 0; i < fb; i += 64)
+         memset(state + vram + i, shade + (i >> 12), MIN(64, fb - i));
+   }
+}
+
+static bool bench_peer_init(bench_t *bench, bench_peer_t *peer, int fd)
+{
+   size_t buf_size = bench->zbuffer_size + 64;
+
+   peer->fd = fd;
+
+   if (bench->mode == BENCH_DELTA)
+      peer->z.compression_backend = trans_stream_get_pipe_backend();
+   else
+      peer->z.compression_backend = trans_stream_get_zlib_deflate_backend();
+   peer->z.decompression_backend  = peer->z.compression_backend->reverse;
+   peer->z.compression_stream     = peer->z.compression_backend->stream_new();
+   peer->z.decompression_stream   = peer->z.decompression_backend->stream_new();
+
+   peer->base    = (uint8_t*)calloc(bench->state_size, 1);
+   peer->zbuffer = (uint8_t*)malloc(bench->zbuffer_size);
+   peer->delta   = (uint8_t*)malloc(bench->delta_size);
+
+   return peer->z.compression_stream && peer->z.decompression_stream
+      && peer->base && peer->zbuffer && peer->delta
+      && netplay_init_socket_buffer(&peer->send_buf, buf_size)
+      && netplay_init_socket_buffer(&peer->recv_buf, buf_size);
+}
+
+static void bench_peer_deinit(bench_peer_t *peer)
+{
+   peer->z.compression_backend->stream_free(peer->z.compression_stream);
+   peer->z.decompression_backend->stream_free(peer->z.decompression_stream);
+   netplay_deinit_socket_buffer(&peer->send_buf);
+   netplay_deinit_socket_buffer(&peer->recv_buf);
+   free(peer->base);
+   free(peer->zbuffer);
+   free(peer->delta);
+   close(peer->fd);
+}
+
+/* The netplay_send_savestate side, returns the bytes sent. */
+static size_t bench_send(bench_t *bench, uint32_t frame)
+{
+   uint32_t header[4];
+   uint32_t rd, wn;
+   enum trans_stream_error err;
+   bench_peer_t *peer = &bench->sender;
+   const uint8_t *in  = bench->state;
+   size_t in_size     = bench->state_size;
+
+   if (bench->mode != BENCH_ZLIB)
+   {
+      in_size = netplay_state_delta_encode(peer->base, bench->state,
+            bench->state_size, peer->delta);
+      in      = peer->delta;
+   }
+
+   /* Deltas are deflated at the level netplay uses for them */
+   if (bench->mode == BENCH_DELTA_ZLIB)
+      peer->z.compression_backend->define(peer->z.compression_stream,
+            "level", NETPLAY_STATE_DELTA_ZLIB_LEVEL);
+   peer->z.compression_backend->set_in(peer->z.compression_stream,
+         in, (uint32_t)in_size);
+   peer->z.compression_backend->set_out(peer->z.compression_stream,
+         peer->zbuffer, (uint32_t)bench->zbuffer_size);
+   if (!peer->z.compression_backend->trans(peer->z.compression_stream,
+            true, &rd, &wn, &err))
+      return 0;
+
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
+   header[1] = htonl(wn + 2*sizeof(uint32_t));
+   header[2] = htonl(frame);
+   header[3] = htonl((uint32_t)bench->state_size);
+
+   if (!netplay_send(&peer->send_buf, peer->fd, header, sizeof(header)) ||
+       !netplay_send(&peer->send_buf, peer->fd, peer->zbuffer, wn) ||
+       !netplay_send_flush(&peer->send_buf, peer->fd, true))
+      return 0;
+
+   return sizeof(header) + wn;
+}
+
+/* Netplay waits for its nonblocking sockets with select
+ * before it reads, so does this. */
+static bool bench_recv_all(bench_peer_t *peer, void *buf, size_t len)
+{
+   size_t got = 0;
+
+   for (;;)
+   {
+      fd_set fds;
+      ssize_t recvd = netplay_recv(&peer->recv_buf, peer->fd,
+            (uint8_t*)buf + got, len - got, false);
+
+      if (recvd < 0)
+         return false;
+      got += recvd;
+      if (got >= len)
+         return true;
+
+      FD_ZERO(&fds);
+      FD_SET(peer->fd, &fds);
+      if (select(peer->fd + 1, &fds, NULL, NULL, NULL) < 0)
+         return false;
+   }
+}
+
+/* The CMD_LOAD_SAVESTATE side, until a zero frame ends it. */
+static void bench_receiver(void *data)
+{
+   bench_t *bench     = (bench_t*)data;
+   bench_peer_t *peer = &bench->receiver;
+   uint8_t *state     = (uint8_t*)malloc(bench->state_size);
+
+   for (;;)
+   {
+      uint32_t header[4];
+      uint32_t rd, wn, payload, frame;
+      enum trans_stream_error err;
+      bool ok;
+
+      if (!bench_recv_all(peer, header, sizeof(header)))
+         break;
+      netplay_recv_flush(&peer->recv_buf);
+
+      payload = ntohl(header[1]) - 2*sizeof(uint32_t);
+      frame   = ntohl(header[2]);
+      if (!frame || payload > bench->zbuffer_size
+            || !bench_recv_all(peer, peer->zbuffer, payload))
+         break;
+      netplay_recv_flush(&peer->recv_buf);
+
+      peer->z.decompression_backend->set_in(peer->z.decompression_stream,
+            peer->zbuffer, payload);
+
+      if (bench->mode == BENCH_ZLIB)
+      {
+         peer->z.decompression_backend->set_out(peer->z.decompression_stream,
+               state, (uint32_t)bench->state_size);
+         ok = peer->z.decompression_backend->trans(
+               peer->z.decompression_stream, true, &rd, &wn, &err);
+      }
+      else
+      {
+         peer->z.decompression_backend->set_out(peer->z.decompression_stream,
+               peer->delta, (uint32_t)bench->delta_size);
+         ok = peer->z.decompression_backend->trans(
+               peer->z.decompression_stream, true, &rd, &wn, &err)
+            && netplay_state_delta_decode(peer->base, bench->state_size,
+               peer->delta, wn);
+         if (ok)
+            memcpy(state, peer->base, bench->state_size);
+      }
+
+      if (!ok || memcmp(state, bench->state, bench->state_size))
+         bench->mismatch = true;
+
+      header[0] = htonl(frame);
+      if (!netplay_send(&peer->send_buf, peer->fd, header, sizeof(uint32_t)) ||
+          !netplay_send_flush(&peer->send_buf, peer->fd, true))
+         break;
+   }
+
+   free(state);
+}
+
+static bool bench_connect(int *client, int *server)
+{
+   struct sockaddr_in addr;
+   socklen_t len = sizeof(addr);
+   int one       = 1;
+   int listener  = socket(AF_INET, SOCK_STREAM, 0);
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+   if (listener < 0
+         || bind(listener, (struct sockaddr*)&addr, sizeof(addr))
+         || listen(listener, 1)
+         || getsockname(listener, (struct sockaddr*)&addr, &len))
+      return false;
+
+   *client = socket(AF_INET, SOCK_STREAM, 0);
+   if (*client < 0 || connect(*client, (struct sockaddr*)&addr, sizeof(addr)))
+      return false;
+   *server = accept(listener, NULL, NULL);
+   close(listener);
+
+   if (*server < 0)
+      return false;
+
+   /* Set up like netplay's connections */
+   setsockopt(*client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+   setsockopt(*server, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+   return socket_nonblock(*client) && socket_nonblock(*server);
+}
+
+static bool bench_run(enum bench_mode mode, size_t state_size,
+      unsigned frames)
+{
+   unsigned i;
+   int client, server;
+   bench_t bench;
+   sthread_t *thread;
+   uint32_t ack;
+   uint64_t bytes       = 0;
+   retro_time_t usec    = 0;
+   size_t first_bytes   = 0;
+   retro_time_t first_usec = 0;
+
+   memset(&bench, 0, sizeof(bench));
+   bench.mode         = mode;
+   bench.state_size   = state_size;
+   bench.delta_size   = netplay_state_delta_max_size(state_size);
+   bench.zbuffer_size = MAX(state_size * 2, bench.delta_size);
+   bench.state        = (uint8_t*)malloc(state_size);
+
+   bench_seed         = 1;
+   bench_state_init(bench.state, state_size);
+
+   if (!bench.state || !bench_connect(&client, &server)
+         || !bench_peer_init(&bench, &bench.sender, server)
+         || !bench_peer_init(&bench, &bench.receiver, client))
+   {
+      printf("%-10s setup failed\n", bench_mode_names[mode]);
+      return false;
+   }
+
+   thread = sthread_create(bench_receiver, &bench);
+
+   for (i = 0; i < NUM_RESYNCS; i++)
+   {
+      size_t sent;
+      retro_time_t start;
+
+      if (i)
+         bench_state_run(bench.state, state_size, frames);
+
+      start = cpu_features_get_time_usec();
+      sent  = bench_send(&bench, (i + 1) * frames);
+      if (!sent || !bench_recv_all(&bench.sender, &ack, sizeof(ack)))
+      {
+         printf("%-10s resync %u failed\n", bench_mode_names[mode], i);
+         return false;
+      }
+      netplay_recv_flush(&bench.sender.recv_buf);
+
+      /* The first one is a join, against nothing */
+      if (!i)
+      {
+         first_bytes = sent;
+         first_usec  = cpu_features_get_time_usec() - start;
+         continue;
+      }
+
+      bytes += sent;
+      usec  += cpu_features_get_time_usec() - start;
+   }
+
+   /* Frame 0 stops the receiver */
+   {
+      uint32_t header[4] = { 0 };
+      header[1]          = htonl(2*sizeof(uint32_t));
+      netplay_send(&bench.sender.send_buf, server, header, sizeof(header));
+      netplay_send_flush(&bench.sender.send_buf, server, true);
+   }
+   sthread_join(thread);
+
+   printf("%-10s join %9u bytes %7.2f ms, resync %9u bytes %7.2f ms%s\n",
+         bench_mode_names[mode],
+         (unsigned)first_bytes, first_usec / 1000.0,
+         (unsigned)(bytes / (NUM_RESYNCS - 1)),
+         usec / 1000.0 / (NUM_RESYNCS - 1),
+         bench.mismatch ? "  MISMATCH" : "");
+
+   bench_peer_deinit(&bench.sender);
+   bench_peer_deinit(&bench.receiver);
+   free(bench.state);
+   return !bench.mismatch;
+}
+
+int main(int argc, char *argv[])
+{
+   size_t state_size = (argc > 1 ? atoi(argv[1]) : 4) * 1024 * 1024;
+   unsigned frames   = argc > 2 ? atoi(argv[2]) : 120;
+   bool ok           = true;
+
+   setvbuf(stdout, NULL, _IONBF, 0);
+   printf("%u byte state, resync every %u frames, %u resyncs\n",
+         (unsigned)state_size, frames, NUM_RESYNCS);
+
+   ok &= bench_run(BENCH_ZLIB,       state_size, frames);
+   ok &= bench_run(BENCH_DELTA,      state_size, frames);
+   ok &= bench_run(BENCH_DELTA_ZLIB, state_size, frames);
+
+   return ok ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+/* Hosts a netplay session of two players for a crowd of spectators
+ * played by tools/ranetplayer over TCP loopback, at 60 frames per
+ * second. Each frame the spectators get both players' input, every
+ * second a CRC and a savestate, the way the server sends them. This
+ * is done once by writing to every spectator from the host as before,
+ * and once through the relay thread, and the time the host spends
+ * sending per frame is reported, along with the spectators dropped.
+ *
+ * A few of the spectators stop reading once they've joined. Writing
+ * to them directly ends up blocking the host until they go away, the
+ * relay drops them instead.
+ *
+ * Usage: netplay_relay_bench [spectators] [stalled] [seconds]
+ *
+ * Without arguments, 256 spectators of which 8 stall are hosted for
+ * 15 seconds. ranetplayer stays a few seconds longer, so that only
+ * the host drops spectators.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <net/net_socket.h>
+#include <retro_timers.h>
+
+/* The relay is pulled in the way griffin does. */
+#include "network/netplay/netplay_relay.c"
+
+#define RANETPLAYER      "../../tools/ranetplayer/ranetplayer"
+#define FPS              60
+#define PLAYERS          2
+#define SAVESTATE_SIZE   (128 * 1024)
+#define SEND_BUFFER_SIZE (256 * 1024)
+
+/* Like a spectator on a slower link than loopback */
+#define SOCKET_SNDBUF    (64 * 1024)
+
+static unsigned bench_dropped;
+
+/* The relay hangs up through this, as netplay does. */
+void netplay_hangup(netplay_t *netplay, struct netplay_connection *connection)
+{
+   if (!connection->active)
+      return;
+   netplay_relay_detach(netplay, connection, false);
+   socket_close(connection->fd);
+   connection->active = false;
+   bench_dropped++;
+}
+
+static bool bench_send_cmd(int fd, uint32_t cmd, const void *data,
+      uint32_t size)
+{
+   uint32_t header[2];
+   header[0] = htonl(cmd);
+   header[1] = htonl(size);
+   return socket_send_all_blocking(fd, header, sizeof(header), true)
+      && (!size || socket_send_all_blocking(fd, data, size, true));
+}
+
+static bool bench_recv_cmd(int fd, uint32_t *cmd, void *data, size_t max)
+{
+   uint32_t header[2];
+   if (!socket_receive_all_blocking(fd, header, sizeof(header)) ||
+         ntohl(header[1]) > max)
+      return false;
+   *cmd = ntohl(header[0]);
+   return socket_receive_all_blocking(fd, data, ntohl(header[1]));
+}
+
+/* Just enough of netplay_handshake_* for ranetplayer to spectate */
+static bool bench_handshake(int fd, uint32_t frame)
+{
+   uint32_t header[6] = { 0 };
+   uint32_t buf[64];
+   uint32_t cmd;
+   char nick[NETPLAY_NICK_LEN] = "relay bench";
+
+   header[0] = htonl(0x52414E50); /* "RANP" */
+
+   if (!socket_send_all_blocking(fd, header, sizeof(header), true) ||
+       !socket_receive_all_blocking(fd, header, sizeof(header)) ||
+       !bench_recv_cmd(fd, &cmd, buf, sizeof(buf)) ||
+       cmd != NETPLAY_CMD_NICK ||
+       !bench_send_cmd(fd, NETPLAY_CMD_NICK, nick, sizeof(nick)))
+      return false;
+
+   memset(buf, 0, sizeof(buf));
+   if (!bench_send_cmd(fd, NETPLAY_CMD_INFO, buf, 4 * sizeof(uint32_t)) ||
+       !bench_recv_cmd(fd, &cmd, buf, sizeof(buf)) ||
+       cmd != NETPLAY_CMD_INFO)
+      return false;
+
+   buf[0] = htonl(frame);
+   return bench_send_cmd(fd, NETPLAY_CMD_SYNC, buf, sizeof(uint32_t));
+}
+
+/* An INPUT command the way send_input_frame makes it */
+static size_t bench_input(uint32_t *buf, uint32_t frame, uint32_t client)
+{
+   buf[0] = htonl(NETPLAY_CMD_INPUT);
+   buf[1] = htonl(3 * sizeof(uint32_t));
+   buf[2] = htonl(frame);
+   buf[3] = htonl(client);
+   buf[4] = htonl((frame * 7 + client) & 0xFFF);
+   return 5 * sizeof(uint32_t);
+}
+
+static pid_t bench_spawn(int port, unsigned spectators, unsigned stalled,
+      unsigned seconds)
+{
+   pid_t pid = fork();
+
+   if (pid == 0)
+   {
+      char port_str[16], spec_str[16], stall_str[16], secs_str[16];
+      snprintf(port_str,  sizeof(port_str),  "%d", port);
+      snprintf(spec_str,  sizeof(spec_str),  "%u", spectators);
+      snprintf(stall_str, sizeof(stall_str), "%u", stalled);
+      snprintf(secs_str,  sizeof(secs_str),  "%u", seconds + 5);
+      execl(RANETPLAYER, RANETPLAYER, "-H", "127.0.0.1", "-P", port_str,
+            "-s", spec_str, "-S", stall_str, "-d", secs_str, (char*)NULL);
+      perror(RANETPLAYER);
+      _exit(1);
+   }
+
+   return pid;
+}
+
+static bool bench_run(bool relay, unsigned spectators, unsigned stalled,
+      unsigned seconds)
+{
+   unsigned i, frame;
+   int listener, status;
+   pid_t pid;
+   struct sockaddr_in addr;
+   socklen_t len              = sizeof(addr);
+   netplay_t *netplay         = (netplay_t*)calloc(1, sizeof(*netplay));
+   uint8_t *savestate         = (uint8_t*)calloc(1, SAVESTATE_SIZE);
+   retro_time_t busy          = 0;
+   retro_time_t worst         = 0;
+   retro_time_t begin, next;
+
+   bench_dropped = 0;
+
+   netplay->is_server        = true;
+   netplay->zbuffer_size     = 2 * SAVESTATE_SIZE;
+   netplay->connections_size = spectators;
+   netplay->connections      = (struct netplay_connection*)
+      calloc(spectators, sizeof(*netplay->connections));
+
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   listener             = socket(AF_INET, SOCK_STREAM, 0);
+
+   if (!netplay->connections || !savestate || listener < 0
+         || bind(listener, (struct sockaddr*)&addr, sizeof(addr))
+         || listen(listener, spectators)
+         || getsockname(listener, (struct sockaddr*)&addr, &len))
+      return false;
+
+   pid = bench_spawn(ntohs(addr.sin_port), spectators, stalled, seconds);
+
+   for (i = 0; i < spectators; i++)
+   {
+      int size                              = SOCKET_SNDBUF;
+      struct netplay_connection *connection = &netplay->connections[i];
+
+      connection->fd = accept(listener, NULL, NULL);
+      if (connection->fd < 0)
+         return false;
+      setsockopt(connection->fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+      if (!bench_handshake(connection->fd, 1) ||
+          !socket_nonblock(connection->fd) ||
+          !netplay_init_socket_buffer(&connection->send_packet_buffer,
+            SEND_BUFFER_SIZE))
+         return false;
+
+      connection->active = true;
+      connection->mode   = NETPLAY_CONNECTION_SPECTATING;
+
+      if (relay && !netplay_relay_attach(netplay, connection))
+         return false;
+   }
+   close(listener);
+
+   begin = next = cpu_features_get_time_usec();
+
+   for (frame = 1; frame <= seconds * FPS; frame++)
+   {
+      uint32_t buf[PLAYERS][8];
+      size_t sizes[PLAYERS];
+      uint32_t crc[4];
+      retro_time_t start, spent;
+      unsigned p;
+
+      next += 1000000 / FPS;
+      while (cpu_features_get_time_usec() < next)
+         retro_sleep(1);
+
+      start = cpu_features_get_time_usec();
+
+      crc[0] = htonl(NETPLAY_CMD_CRC);
+      crc[1] = htonl(2 * sizeof(uint32_t));
+      crc[2] = htonl(frame);
+      crc[3] = htonl(frame * 2654435761u);
+
+      if (relay)
+      {
+         /* netplay_send_cur_input_relayed */
+         for (p = 0; p < PLAYERS; p++)
+            netplay_relay_broadcast(netplay, NULL, buf[p],
+                  bench_input(buf[p], frame, p));
+         if (!(frame % FPS))
+            netplay_relay_broadcast(netplay, NULL, crc, sizeof(crc));
+      }
+
+      for (i = 0; i < spectators; i++)
+      {
+         struct netplay_connection *connection = &netplay->connections[i];
+         bool ok                               = true;
+
+         if (!connection->active)
+            continue;
+
+         /* netplay_send_cur_input, per spectator */
+         if (!relay)
+         {
+            for (p = 0; p < PLAYERS; p++)
+            {
+               sizes[p] = bench_input(buf[p], frame, p);
+               ok       = ok && netplay_send(&connection->send_packet_buffer,
+                     connection->fd, buf[p], sizes[p]);
+            }
+            if (!(frame % FPS))
+               ok = ok && netplay_send(&connection->send_packet_buffer,
+                     connection->fd, crc, sizeof(crc));
+         }
+
+         /* A savestate is sent to each of them on its own */
+         if (!(frame % FPS))
+         {
+            uint32_t header[4];
+            header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
+            header[1] = htonl(SAVESTATE_SIZE + 2 * sizeof(uint32_t));
+            header[2] = htonl(frame);
+            header[3] = htonl(SAVESTATE_SIZE);
+            ok = ok && netplay_send(&connection->send_packet_buffer,
+                  connection->fd, header, sizeof(header))
+               && netplay_send(&connection->send_packet_buffer,
+                  connection->fd, savestate, SAVESTATE_SIZE);
+         }
+
+         /* netplay_post_frame */
+         if (!ok || !netplay_send_flush(&connection->send_packet_buffer,
+                  connection->fd, false))
+            netplay_hangup(netplay, connection);
+      }
+
+      spent  = cpu_features_get_time_usec() - start;
+      busy  += spent;
+      worst  = MAX(worst, spent);
+   }
+
+   printf("%-6s %u frames in %5.1f s, host sends in %7.1f us/frame, "
+         "worst %8.1f ms, %u spectators dropped\n",
+         relay ? "relay" : "direct", seconds * FPS,
+         (cpu_features_get_time_usec() - begin) / 1000000.0,
+         (double)busy / (seconds * FPS), worst / 1000.0, bench_dropped);
+
+   waitpid(pid, &status, 0);
+
+   netplay_relay_free(netplay->relay);
+   for (i = 0; i < spectators; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->active)
+         socket_close(connection->fd);
+      netplay_deinit_socket_buffer(&connection->send_packet_buffer);
+   }
+   free(netplay->connections);
+   free(netplay);
+   free(savestate);
+   return true;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned spectators = argc > 1 ? atoi(argv[1]) : 256;
+   unsigned stalled    = argc > 2 ? atoi(argv[2]) : 8;
+   unsigned seconds    = argc > 3 ? atoi(argv[3]) : 15;
+
+   setvbuf(stdout, NULL, _IONBF, 0);
+   printf("%u spectators, %u stalled, %u seconds at %u fps\n",
+         spectators, stalled, seconds, FPS);
+
+   if (!bench_run(false, spectators, stalled, seconds) ||
+       !bench_run(true,  spectators, stalled, seconds))
+   {
+      fprintf(stderr, "Setting up the spectators failed.\n");
+      return 1;
+   }
+
+   return 0;
+}
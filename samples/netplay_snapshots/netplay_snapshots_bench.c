@@ -0,0 +1,342 @@
+/* Runs netplay's rollback on a stand-in core with a large state, as the
+ * server of a remote player whose input arrives a few frames late, once
+ * snapshotting every frame and once with sparse snapshots. Reports the
+ * time netplay takes per frame, how many snapshots were taken and frames
+ * replayed, and the serialize and resimulation performance counters.
+ *
+ * Both runs have to end in the state of running the real input straight
+ * through, and send the same CRCs on the check frames.
+ *
+ * Usage: netplay_snapshots_bench [latency] [state KB] [frames]
+ *
+ * Without arguments, input arrives 3 frames late (give or take one) for
+ * a core with an 8 MB state, for 1200 frames.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <encodings/crc32.h>
+
+/* The rollback is pulled in the way griffin does. */
+#include "network/netplay/netplay_delta.c"
+#include "network/netplay/netplay_sync.c"
+
+#define CHECK_FRAMES   60
+#define MAX_CRCS       1024
+
+/* Part of the state the core touches each frame */
+#define RUN_BYTES      (1024 * 1024)
+
+static uint8_t *core_state;
+static size_t core_state_size;
+static netplay_t *bench_netplay;
+static unsigned bench_serializes;
+static unsigned bench_replayed;
+
+static uint32_t bench_crcs[MAX_CRCS];
+static unsigned bench_num_crcs;
+
+/* What the remote player presses: held for a while, then something else */
+static uint32_t bench_input(uint32_t frame)
+{
+   uint32_t seed = (frame / 7) * 2654435761u;
+   return (seed >> 20) & 0xFFF;
+}
+
+static void bench_core_frame(uint32_t frame, uint32_t input)
+{
+   size_t i;
+   uint32_t x     = frame * 0x9E3779B9u ^ input;
+   size_t offset  = ((size_t)frame * 4099 * 64) % core_state_size;
+
+   for (i = 0; i < RUN_BYTES; i += 4)
+   {
+      size_t pos = (offset + i) % core_state_size;
+      x          = x * 1664525u + 1013904223u + core_state[pos];
+      core_state[pos] ^= (uint8_t)(x >> 24);
+   }
+}
+
+/* The core, as netplay drives it */
+bool core_run(void)
+{
+   netplay_t *netplay      = bench_netplay;
+   struct delta_frame *ptr = &netplay->buffer[netplay->is_replay
+      ? netplay->replay_ptr : netplay->run_ptr];
+   netplay_input_state_t istate = ptr->resolved_input[0];
+
+   if (netplay->is_replay)
+      bench_replayed++;
+   bench_core_frame(ptr->frame, istate ? istate->data[0] : 0);
+   return true;
+}
+
+bool core_serialize(retro_ctx_serialize_info_t *info)
+{
+   if (info->size < core_state_size)
+      return false;
+   memcpy(info->data, core_state, core_state_size);
+   bench_serializes++;
+   return true;
+}
+
+bool core_unserialize(retro_ctx_serialize_info_t *info)
+{
+   if (info->size < core_state_size)
+      return false;
+   memcpy(core_state, info->data_const, core_state_size);
+   return true;
+}
+
+bool core_reset(void) { return true; }
+void autosave_lock(void) { }
+void autosave_unlock(void) { }
+void input_driver_set_nonblock_state(void) { }
+void input_driver_unset_nonblock_state(void) { }
+void driver_set_nonblock_state(void) { }
+void input_poll_net(void) { }
+
+bool rarch_ctl(enum rarch_ctl_state state, void *data)
+{
+   return state == RARCH_CTL_IS_PERFCNT_ENABLE;
+}
+
+void rarch_perf_register(struct retro_perf_counter *perf)
+{
+   perf->registered = true;
+}
+
+const char *msg_hash_to_str(enum msg_hash_enums msg) { return ""; }
+
+void RARCH_ERR(const char *fmt, ...)
+{
+   va_list ap;
+   va_start(ap, fmt);
+   vfprintf(stderr, fmt, ap);
+   va_end(ap);
+}
+
+void RARCH_WARN(const char *fmt, ...) { }
+
+bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
+{
+   if (bench_num_crcs < MAX_CRCS)
+      bench_crcs[bench_num_crcs++] = delta->crc;
+   return true;
+}
+
+bool netplay_cmd_request_savestate(netplay_t *netplay) { return true; }
+bool netplay_cmd_stall(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t frames) { return true; }
+bool netplay_wait_and_init_serialization(netplay_t *netplay) { return true; }
+bool netplay_handshake_init_send(netplay_t *netplay,
+      struct netplay_connection *connection) { return true; }
+bool netplay_init_socket_buffer(struct socket_buffer *sbuf, size_t size)
+{
+   return false;
+}
+void netplay_deinit_socket_buffer(struct socket_buffer *sbuf) { }
+void netplay_load_savestate(netplay_t *netplay,
+      retro_ctx_serialize_info_t *serial_info, bool save) { }
+
+typedef struct bench_result
+{
+   retro_time_t usec;
+   uint32_t crc;
+   uint32_t crcs[MAX_CRCS];
+   unsigned num_crcs;
+   unsigned serializes;
+   unsigned replayed;
+   unsigned interval;
+   struct retro_perf_counter serialize, resim;
+} bench_result_t;
+
+/* Hand the player's input for the next frame to netplay, as
+ * netplay_get_cmd does */
+static bool bench_deliver(netplay_t *netplay)
+{
+   netplay_input_state_t istate;
+   struct delta_frame *ptr = &netplay->buffer[netplay->read_ptr[1]];
+
+   if (!netplay_delta_frame_ready(netplay, ptr, netplay->read_frame_count[1]))
+      return false;
+
+   istate = netplay_input_state_for(&ptr->real_input[0], 1, 1, true, false);
+   if (!istate)
+      return false;
+   istate->data[0]  = bench_input(netplay->read_frame_count[1]);
+   ptr->have_real[1] = true;
+
+   netplay->read_ptr[1] = NEXT_PTR(netplay->read_ptr[1]);
+   netplay->read_frame_count[1]++;
+   return true;
+}
+
+static bool bench_run(bool sparse, unsigned latency, unsigned frames,
+      bench_result_t *result)
+{
+   size_t i;
+   int listener;
+   struct sockaddr_in addr;
+   retro_time_t start;
+   netplay_t *netplay = (netplay_t*)calloc(1, sizeof(*netplay));
+
+   memset(core_state, 0, core_state_size);
+   memset(&netplay_serialize_perf, 0, sizeof(netplay_serialize_perf));
+   memset(&netplay_resim_perf, 0, sizeof(netplay_resim_perf));
+   bench_serializes = 0;
+   bench_replayed   = 0;
+   bench_num_crcs   = 0;
+   bench_netplay    = netplay;
+
+   /* Nobody connects, but the server looks for them */
+   memset(&addr, 0, sizeof(addr));
+   addr.sin_family      = AF_INET;
+   addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+   listener             = socket(AF_INET, SOCK_STREAM, 0);
+   if (!netplay || listener < 0 ||
+         bind(listener, (struct sockaddr*)&addr, sizeof(addr)) ||
+         listen(listener, 1))
+      return false;
+
+   netplay->listen_fd         = listener;
+   netplay->is_server         = true;
+   netplay->self_mode         = NETPLAY_CONNECTION_PLAYING;
+   netplay->connected_players = 1 << 1;
+   netplay->device_clients[0] = 1 << 1;
+   netplay->config_devices[0] = RETRO_DEVICE_JOYPAD;
+   netplay->check_frames      = CHECK_FRAMES;
+   netplay->crcs_valid        = true;
+   netplay->state_size        = core_state_size;
+   netplay->sparse_snapshots  = sparse;
+   netplay->snapshot_interval = 1;
+
+   /* Sized as netplay_init_buffers does */
+   netplay->buffer_size       = (NETPLAY_MAX_STALL_FRAMES + 2) * 2 +
+      (sparse ? NETPLAY_SNAPSHOT_INTERVAL_MAX : 0);
+   netplay->buffer            = (struct delta_frame*)calloc(
+         netplay->buffer_size, sizeof(*netplay->buffer));
+   if (!netplay->buffer)
+      return false;
+   for (i = 0; i < netplay->buffer_size; i++)
+      if (!(netplay->buffer[i].state = calloc(core_state_size, 1)))
+         return false;
+
+   start = cpu_features_get_time_usec();
+
+   while (netplay->run_frame_count < frames)
+   {
+      uint32_t frame = netplay->run_frame_count;
+      /* Late by latency frames, give or take one */
+      uint32_t late  = latency + (frame * 7 % 3) - 1;
+
+      while (netplay->read_frame_count[1] + late < frame &&
+            bench_deliver(netplay));
+
+      netplay_sync_pre_frame(netplay);
+      netplay_resolve_input(netplay, netplay->run_ptr, false);
+      core_run();
+
+      /* As netplay_poll does */
+      netplay_update_unread_ptr(netplay);
+      netplay_sync_post_frame(netplay, false);
+   }
+
+   /* Everything arrives, and the last rollback settles it */
+   while (netplay->read_frame_count[1] < frames && bench_deliver(netplay));
+   netplay_update_unread_ptr(netplay);
+   netplay_sync_post_frame(netplay, true);
+
+   result->usec       = cpu_features_get_time_usec() - start;
+   result->crc        = encoding_crc32(0, core_state, core_state_size);
+   result->serializes = bench_serializes;
+   result->replayed   = bench_replayed;
+   result->interval   = netplay->snapshot_interval;
+   result->serialize  = netplay_serialize_perf;
+   result->resim      = netplay_resim_perf;
+   result->num_crcs   = bench_num_crcs;
+   memcpy(result->crcs, bench_crcs, sizeof(bench_crcs));
+
+   close(listener);
+   for (i = 0; i < netplay->buffer_size; i++)
+      netplay_delta_frame_free(&netplay->buffer[i]);
+   free(netplay->buffer);
+   free(netplay);
+   return true;
+}
+
+static void bench_print(const char *name, const bench_result_t *result,
+      unsigned frames, uint32_t ref_crc, const uint32_t *ref_crcs,
+      unsigned num_ref_crcs)
+{
+   bool crcs_ok = result->num_crcs == num_ref_crcs &&
+      !memcmp(result->crcs, ref_crcs, num_ref_crcs * sizeof(uint32_t));
+
+   printf("%-6s %6.2f ms/frame, %5u serializes, %5u frames replayed, "
+         "interval %u, state %s, %u CRCs %s\n",
+         name, result->usec / 1000.0 / frames, result->serializes,
+         result->replayed, result->interval,
+         result->crc == ref_crc ? "ok" : "WRONG",
+         result->num_crcs, crcs_ok ? "ok" : "WRONG");
+   printf("%-6s netplay_serialize %5u calls %10.0f ticks each, "
+         "netplay_resim %5u calls %10.0f ticks each\n",
+         name, (unsigned)result->serialize.call_cnt,
+         result->serialize.call_cnt ? (double)result->serialize.total /
+            result->serialize.call_cnt : 0.0,
+         (unsigned)result->resim.call_cnt,
+         result->resim.call_cnt ? (double)result->resim.total /
+            result->resim.call_cnt : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned latency    = argc > 1 ? atoi(argv[1]) : 3;
+   unsigned state_kb   = argc > 2 ? atoi(argv[2]) : 8192;
+   unsigned frames     = argc > 3 ? atoi(argv[3]) : 1200;
+   uint32_t ref_crcs[MAX_CRCS];
+   unsigned num_ref_crcs = 0;
+   uint32_t frame, ref_crc;
+   bench_result_t every, sparse;
+   retro_time_t start, core_usec;
+
+   core_state_size = (size_t)state_kb * 1024;
+   core_state      = (uint8_t*)calloc(core_state_size, 1);
+   if (!core_state || latency < 1 || core_state_size < RUN_BYTES)
+      return 1;
+
+   /* The real input straight through */
+   start = cpu_features_get_time_usec();
+   for (frame = 0; frame < frames; frame++)
+   {
+      if (frame % CHECK_FRAMES == 0 && num_ref_crcs < MAX_CRCS)
+         ref_crcs[num_ref_crcs++] = encoding_crc32(0, core_state,
+               core_state_size);
+      bench_core_frame(frame, bench_input(frame));
+   }
+   core_usec = (cpu_features_get_time_usec() - start) / frames;
+   ref_crc   = encoding_crc32(0, core_state, core_state_size);
+
+   printf("%u KB state, %u frames, input %u frames late, "
+         "%.2f ms/frame to run the core\n",
+         state_kb, frames, latency, core_usec / 1000.0);
+
+   if (!bench_run(false, latency, frames, &every) ||
+       !bench_run(true,  latency, frames, &sparse))
+   {
+      fprintf(stderr, "Setting up netplay failed.\n");
+      return 1;
+   }
+
+   bench_print("every", &every, frames, ref_crc, ref_crcs, num_ref_crcs);
+   bench_print("sparse", &sparse, frames, ref_crc, ref_crcs, num_ref_crcs);
+
+   free(core_state);
+   return 0;
+}
@@ -0,0 +1,100 @@
+/* Fills a synthetic playlist the way a content scan does
+ * (membership check followed by a push for every file),
+ * then times path lookups against the filled playlist.
+ *
+ * Usage: playlist_bench [entries] [lookups]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <features/features_cpu.h>
+
+#include "playlist.h"
+
+static void bench_entry_path(char *s, size_t len, size_t i)
+{
+   /* Every other entry is an archive path, so that
+    * fuzzy archive matching gets exercised too */
+   if (i & 1)
+      snprintf(s, len, "/roms/system/game %u.zip#game %u.bin",
+            (unsigned)i, (unsigned)i);
+   else
+      snprintf(s, len, "/roms/system/game %u.bin", (unsigned)i);
+}
+
+int main(int argc, char *argv[])
+{
+   size_t i;
+   char path[256];
+   retro_time_t t_start;
+   retro_time_t t_fill;
+   retro_time_t t_lookup;
+   size_t num_entries   = 50000;
+   size_t num_lookups   = 50000;
+   size_t num_found     = 0;
+   playlist_t *playlist = NULL;
+
+   if (argc > 1)
+      num_entries = strtoul(argv[1], NULL, 10);
+   if (argc > 2)
+      num_lookups = strtoul(argv[2], NULL, 10);
+
+   if (num_entries < 2)
+      num_entries = 2;
+
+   if (!(playlist = playlist_init("playlist_bench.lpl", num_entries)))
+      return 1;
+
+   t_start = cpu_features_get_time_usec();
+
+   for (i = 0; i < num_entries; i++)
+   {
+      struct playlist_entry entry = {0};
+
+      bench_entry_path(path, sizeof(path), i);
+
+      if (playlist_entry_exists(playlist, path, true))
+         continue;
+
+      entry.path      = path;
+      entry.label     = path;
+      entry.core_path = "DETECT";
+      entry.core_name = "DETECT";
+
+      playlist_push(playlist, &entry, true);
+   }
+
+   t_fill  = cpu_features_get_time_usec() - t_start;
+   t_start = cpu_features_get_time_usec();
+
+   for (i = 0; i < num_lookups; i++)
+   {
+      const struct playlist_entry *entry = NULL;
+
+      /* Look up archives without their [delimiter][rom_file]
+       * part, as an external launcher would */
+      snprintf(path, sizeof(path), "/roms/system/game %u.zip",
+            (unsigned)(((i * 7919) % (num_entries / 2)) * 2 + 1));
+
+      playlist_get_index_by_path(playlist, path, &entry, true);
+
+      if (entry)
+         num_found++;
+   }
+
+   t_lookup = cpu_features_get_time_usec() - t_start;
+
+   printf("fill:   %u entries in %.3f s (%.1f us/entry)\n",
+         (unsigned)playlist_size(playlist), t_fill / 1000000.0,
+         (double)t_fill / (num_entries ? num_entries : 1));
+   printf("lookup: %u/%u found in %.3f s (%.1f us/lookup)\n",
+         (unsigned)num_found, (unsigned)num_lookups, t_lookup / 1000000.0,
+         (double)t_lookup / (num_lookups ? num_lookups : 1));
+
+   playlist_free(playlist);
+
+   return 0;
+}
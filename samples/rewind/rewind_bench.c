@@ -0,0 +1,222 @@
+/* Replays pairs of savestates through the rewind delta
+ * compressor with every find_change/find_same kernel this
+ * CPU supports. Each kernel's patch is checked against the
+ * generic one and round-tripped before it is timed.
+ *
+ * Usage: rewind_bench [old.state new.state]...
+ *
+ * Without arguments, a synthetic 4 MB pair is used.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <streams/file_stream.h>
+
+/* The delta codec is internal to the state manager,
+ * pull it in the way griffin does. */
+#include "managers/state_manager.c"
+
+/* Only state_manager_raw_* are exercised; the rest
+ * of the state manager needs these to link. */
+bool core_serialize_size(retro_ctx_size_info_t *info) { info->size = 0; return false; }
+bool core_serialize(retro_ctx_serialize_info_t *info) { return false; }
+bool core_unserialize(retro_ctx_serialize_info_t *info) { return false; }
+bool core_set_rewind_callbacks(void) { return false; }
+bool audio_driver_has_callback(void) { return false; }
+void audio_driver_frame_is_reverse(void) { }
+void audio_driver_setup_rewind(void) { }
+void bsv_movie_frame_rewind(void) { }
+bool rarch_ctl(enum rarch_ctl_state state, void *data) { return false; }
+const char *msg_hash_to_str(enum msg_hash_enums msg) { return ""; }
+
+#define NUM_KERNELS (sizeof(state_manager_kernels) / sizeof(state_manager_kernels[0]))
+
+/* Bytes of state pushed through each kernel per pair */
+#define BENCH_BYTES (2048 * 1024 * 1024ULL)
+
+/* Mostly unchanged state with some scattered small writes
+ * and a few larger dirty regions, like a frame of emulation. */
+static void make_synthetic_pair(uint8_t *old_state, uint8_t *new_state,
+      size_t len)
+{
+   size_t i;
+   uint32_t seed = 1;
+
+   for (i = 0; i < len; i++)
+   {
+      seed         = seed * 1103515245 + 12345;
+      old_state[i] = (uint8_t)(seed >> 16);
+   }
+
+   memcpy(new_state, old_state, len);
+
+   for (i = 0; i < 4096; i++)
+   {
+      size_t j;
+      size_t off;
+      seed = seed * 1103515245 + 12345;
+      off  = (seed >> 8) % len;
+
+      for (j = 0; j < 8 && off + j < len; j++)
+         new_state[off + j] ^= 0xff;
+   }
+
+   for (i = 0; i < 4; i++)
+   {
+      size_t off = (len / 4) * i;
+      size_t end = off + len / 64;
+
+      for (; off < end; off++)
+         new_state[off] ^= 0x5a;
+   }
+}
+
+static int bench_pair(const char *name, const uint8_t *old_data,
+      const uint8_t *new_data, size_t len)
+{
+   unsigned i, k;
+   unsigned iterations;
+   size_t ref_size;
+   int ret               = 0;
+   uint64_t cpu          = cpu_features_get();
+   size_t maxsize        = state_manager_raw_maxsize(len);
+   uint8_t *old_state    = (uint8_t*)state_manager_raw_alloc(len, 0);
+   uint8_t *new_state    = (uint8_t*)state_manager_raw_alloc(len, 1);
+   uint8_t *scratch      = (uint8_t*)state_manager_raw_alloc(len, 2);
+   uint8_t *patch        = (uint8_t*)malloc(maxsize);
+   uint8_t *ref_patch    = (uint8_t*)malloc(maxsize);
+
+   if (!old_state || !new_state || !scratch || !patch || !ref_patch)
+   {
+      ret = 1;
+      goto end;
+   }
+
+   memcpy(old_state, old_data, len);
+   memcpy(new_state, new_data, len);
+
+   /* The last kernel is the generic one */
+   state_manager_kernel = &state_manager_kernels[NUM_KERNELS - 1];
+   ref_size             = state_manager_raw_compress(old_state,
+         new_state, len, ref_patch);
+
+   iterations = (unsigned)(BENCH_BYTES / len);
+   if (iterations < 1)
+      iterations = 1;
+
+   printf("%s: %u bytes, patch %u bytes, %u iterations\n",
+         name, (unsigned)len, (unsigned)ref_size, iterations);
+
+   for (k = 0; k < NUM_KERNELS; k++)
+   {
+      size_t size;
+      retro_time_t t_start;
+      retro_time_t t_comp;
+      retro_time_t t_decomp;
+
+      if ((cpu & state_manager_kernels[k].simd)
+            != state_manager_kernels[k].simd)
+      {
+         printf("  %-8s not supported\n", state_manager_kernels[k].ident);
+         continue;
+      }
+
+      state_manager_kernel = &state_manager_kernels[k];
+
+      size = state_manager_raw_compress(old_state, new_state, len, patch);
+      if (size != ref_size || memcmp(patch, ref_patch, size))
+      {
+         printf("  %-8s patch differs from generic\n",
+               state_manager_kernel->ident);
+         ret = 1;
+         continue;
+      }
+
+      memcpy(scratch, new_state, len);
+      state_manager_raw_decompress(patch, size, scratch, len);
+      if (memcmp(scratch, old_state, len))
+      {
+         printf("  %-8s round trip failed\n", state_manager_kernel->ident);
+         ret = 1;
+         continue;
+      }
+
+      t_start = cpu_features_get_time_usec();
+      for (i = 0; i < iterations; i++)
+         state_manager_raw_compress(old_state, new_state, len, patch);
+      t_comp  = cpu_features_get_time_usec() - t_start;
+
+      /* Applying a patch again writes the same data, so
+       * scratch can be reused as is */
+      t_start = cpu_features_get_time_usec();
+      for (i = 0; i < iterations; i++)
+         state_manager_raw_decompress(patch, size, scratch, len);
+      t_decomp = cpu_features_get_time_usec() - t_start;
+
+      printf("  %-8s compress %6.2f GB/s, decompress %6.2f GB/s\n",
+            state_manager_kernel->ident,
+            (double)len * iterations / 1000.0 / (t_comp   ? t_comp   : 1),
+            (double)len * iterations / 1000.0 / (t_decomp ? t_decomp : 1));
+   }
+
+end:
+   free(old_state);
+   free(new_state);
+   free(scratch);
+   free(patch);
+   free(ref_patch);
+   return ret;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   int ret = 0;
+
+   if (argc < 3)
+   {
+      size_t len         = 4 * 1024 * 1024;
+      uint8_t *old_state = (uint8_t*)malloc(len);
+      uint8_t *new_state = (uint8_t*)malloc(len);
+
+      if (!old_state || !new_state)
+         return 1;
+
+      make_synthetic_pair(old_state, new_state, len);
+      ret = bench_pair("synthetic", old_state, new_state, len);
+
+      free(old_state);
+      free(new_state);
+      return ret;
+   }
+
+   for (i = 1; i + 1 < argc; i += 2)
+   {
+      void *old_state  = NULL;
+      void *new_state  = NULL;
+      int64_t old_len  = 0;
+      int64_t new_len  = 0;
+
+      if (     !filestream_read_file(argv[i],     &old_state, &old_len)
+            || !filestream_read_file(argv[i + 1], &new_state, &new_len))
+      {
+         fprintf(stderr, "Could not read %s or %s.\n", argv[i], argv[i + 1]);
+         ret = 1;
+      }
+      else if (old_len != new_len || old_len <= 0)
+      {
+         fprintf(stderr, "%s and %s differ in size.\n", argv[i], argv[i + 1]);
+         ret = 1;
+      }
+      else if (bench_pair(argv[i], (const uint8_t*)old_state,
+               (const uint8_t*)new_state, (size_t)old_len))
+         ret = 1;
+
+      free(old_state);
+      free(new_state);
+   }
+
+   return ret;
+}
@@ -0,0 +1,492 @@
+/* Runs softfilter presets over frames with the scalar kernels
+ * and with each set of SIMD kernels this CPU supports, checks
+ * that all of them produce the same output and times them.
+ * The fastest kernels are then run again split into row bands
+ * on a frame job pool, which has to give the same output too.
+ *
+ * Usage: softfilter_check [-n <iterations>] [-t <threads>] [-f <frame.ppm>]... <preset.filt>...
+ *
+ * Frames are binary PPMs (P6), e.g. converted screenshots.
+ * Without frames, synthetic pixel art and noise frames are used.
+ *
+ * e.g. softfilter_check ../../gfx/video_filters/ *.filt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <file/config_file.h>
+#include <file/config_file_userdata.h>
+#include <file/file_path.h>
+#include <features/features_cpu.h>
+#include <retro_miscellaneous.h>
+#include <string/stdstring.h>
+
+/* The filters are built in, the way griffin does it. */
+#include "gfx/video_filters/2xsai.c"
+#include "gfx/video_filters/super2xsai.c"
+#include "gfx/video_filters/supereagle.c"
+#include "gfx/video_filters/2xbr.c"
+#include "gfx/video_filters/darken.c"
+#include "gfx/video_filters/epx.c"
+#include "gfx/video_filters/scale2x.c"
+#include "gfx/video_filters/blargg_ntsc_snes.c"
+#include "gfx/video_filters/lq2x.c"
+#include "gfx/video_filters/phosphor2x.c"
+#include "gfx/video_filters/normal2x.c"
+#include "gfx/video_filters/scanline2x.c"
+
+#include "gfx/video_frame_jobs.h"
+
+#define CHECK_MAX_FRAMES 64
+
+/* Filters read a couple of pixels around their input,
+ * frames are stored with a border of black pixels. */
+#define CHECK_BORDER 8
+
+struct check_frame
+{
+   char name[64];
+   unsigned width;
+   unsigned height;
+   uint32_t *pixels;
+};
+
+static const softfilter_get_implementation_t check_plugs[] = {
+   blargg_ntsc_snes_get_implementation,
+   lq2x_get_implementation,
+   phosphor2x_get_implementation,
+   twoxbr_get_implementation,
+   darken_get_implementation,
+   twoxsai_get_implementation,
+   supertwoxsai_get_implementation,
+   supereagle_get_implementation,
+   epx_get_implementation,
+   scale2x_get_implementation,
+   normal2x_get_implementation,
+   scanline2x_get_implementation,
+};
+
+/* Scalar first */
+static const struct
+{
+   softfilter_simd_mask_t simd;
+   const char *name;
+} check_backends[] = {
+   { 0,                    "scalar" },
+   { SOFTFILTER_SIMD_SSE2, "sse2"   },
+   { SOFTFILTER_SIMD_AVX2, "avx2"   },
+   { SOFTFILTER_SIMD_NEON, "neon"   },
+};
+
+static const struct softfilter_config check_config = {
+   config_userdata_get_float,
+   config_userdata_get_int,
+   config_userdata_get_float_array,
+   config_userdata_get_int_array,
+   config_userdata_get_string,
+   config_userdata_free,
+};
+
+static const char *check_backend_name(softfilter_simd_mask_t simd)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(check_backends); i++)
+      if (check_backends[i].simd == simd)
+         return check_backends[i].name;
+
+   return "?";
+}
+
+static uint32_t check_rand(uint32_t *seed)
+{
+   *seed = *seed * 1103515245 + 12345;
+   return *seed >> 8;
+}
+
+static struct check_frame *check_frame_new(const char *name,
+      unsigned width, unsigned height)
+{
+   struct check_frame *frame = (struct check_frame*)
+      calloc(1, sizeof(*frame));
+
+   strlcpy(frame->name, name, sizeof(frame->name));
+   frame->width  = width;
+   frame->height = height;
+   frame->pixels = (uint32_t*)malloc(width * height * sizeof(uint32_t));
+
+   return frame;
+}
+
+/* Flat areas, hard diagonal edges and dithering, which takes
+ * every branch of the edge-directed scalers. */
+static struct check_frame *make_pixel_art(void)
+{
+   unsigned x, y;
+   uint32_t seed             = 3;
+   uint32_t palette[16];
+   struct check_frame *frame = check_frame_new("pixel art", 256, 224);
+
+   for (x = 0; x < 16; x++)
+      palette[x] = check_rand(&seed) & 0xffffff;
+
+   for (y = 0; y < frame->height; y++)
+   {
+      for (x = 0; x < frame->width; x++)
+      {
+         unsigned c = ((x / 16) + (y / 16)) & 3;
+
+         if (((x + y) % 23) < 3 || ((x + 2 * y) % 37) == 0)
+            c = 4 + ((x / 32) & 3);
+         else if (((x - y) & 31) < 2)
+            c = 8;
+         else if ((x / 8 + y / 8) % 11 == 0)
+            c = 9 + ((x ^ y) & 1);
+         else if ((check_rand(&seed) & 63) == 0)
+            c = 11 + (check_rand(&seed) & 3);
+
+         frame->pixels[y * frame->width + x] = palette[c];
+      }
+   }
+
+   return frame;
+}
+
+/* A few colors in random places, every neighbourhood differs. */
+static struct check_frame *make_noise(unsigned colors)
+{
+   unsigned i;
+   uint32_t seed             = colors;
+   struct check_frame *frame = check_frame_new(
+         colors ? "palette noise" : "noise", 320, 240);
+
+   for (i = 0; i < frame->width * frame->height; i++)
+   {
+      uint32_t c = check_rand(&seed) ^ (check_rand(&seed) << 16);
+
+      if (colors)
+         c = (c % colors) * 0x3f1f2f;
+
+      frame->pixels[i] = c & 0xffffff;
+   }
+
+   return frame;
+}
+
+static struct check_frame *load_ppm(const char *path)
+{
+   unsigned i, width, height, maxval;
+   struct check_frame *frame = NULL;
+   FILE *file                = fopen(path, "rb");
+   uint8_t *rgb              = NULL;
+
+   if (!file)
+      return NULL;
+
+   if (fscanf(file, "P6 %u %u %u", &width, &height, &maxval) != 3
+         || maxval != 255 || fgetc(file) == EOF
+         || width == 0 || height == 0)
+      goto end;
+
+   rgb = (uint8_t*)malloc(width * height * 3);
+
+   if (fread(rgb, 3, width * height, file) != width * height)
+      goto end;
+
+   frame = check_frame_new(path_basename(path), width, height);
+
+   for (i = 0; i < width * height; i++)
+      frame->pixels[i] = (rgb[i * 3] << 16)
+         | (rgb[i * 3 + 1] << 8) | rgb[i * 3 + 2];
+
+end:
+   free(rgb);
+   fclose(file);
+   return frame;
+}
+
+/* Copies the frame into a bordered buffer in the given format,
+ * returns a pointer to its first pixel. */
+static void *frame_to_input(const struct check_frame *frame,
+      unsigned fmt, void **buffer, size_t *pitch)
+{
+   unsigned x, y;
+   unsigned bpp  = (fmt == SOFTFILTER_FMT_RGB565) ? 2 : 4;
+   size_t stride = frame->width + 2 * CHECK_BORDER;
+   uint8_t *base = (uint8_t*)calloc(stride
+         * (frame->height + 2 * CHECK_BORDER), bpp);
+   uint8_t *first = base + (CHECK_BORDER * stride + CHECK_BORDER) * bpp;
+
+   for (y = 0; y < frame->height; y++)
+   {
+      for (x = 0; x < frame->width; x++)
+      {
+         uint32_t c = frame->pixels[y * frame->width + x];
+
+         if (fmt == SOFTFILTER_FMT_RGB565)
+            ((uint16_t*)first)[y * stride + x] = (uint16_t)(
+                  ((c >> 8) & 0xf800) | ((c >> 5) & 0x07e0) | ((c >> 3) & 0x001f));
+         else
+            ((uint32_t*)first)[y * stride + x] = c;
+      }
+   }
+
+   *buffer = base;
+   *pitch  = stride * bpp;
+   return first;
+}
+
+static void *check_create(const struct softfilter_implementation *impl,
+      config_file_t *conf, unsigned fmt, unsigned width, unsigned height,
+      unsigned threads, softfilter_simd_mask_t simd)
+{
+   struct config_file_userdata userdata;
+
+   userdata.conf      = conf;
+   userdata.prefix[0] = "filter";
+   userdata.prefix[1] = impl->short_ident;
+
+   return impl->create(&check_config, fmt, fmt, width, height, threads,
+         simd, &userdata);
+}
+
+struct check_job
+{
+   void *data;
+   struct softfilter_work_packet *packets;
+};
+
+static void check_job(void *data, unsigned index)
+{
+   struct check_job *job = (struct check_job*)data;
+
+   job->packets[index].work(job->data, job->packets[index].thread_data);
+}
+
+/* Wall clock, the pool runs on several threads. */
+static double check_run(const struct softfilter_implementation *impl,
+      void *data, video_frame_jobs_t *jobs, void *output, size_t out_pitch,
+      const void *input, size_t in_pitch,
+      unsigned width, unsigned height, unsigned iterations)
+{
+   unsigned i;
+   struct check_job job;
+   unsigned threads = impl->query_num_threads(data);
+   retro_time_t start;
+
+   job.data    = data;
+   job.packets = (struct softfilter_work_packet*)
+      calloc(threads, sizeof(*job.packets));
+   start       = cpu_features_get_time_usec();
+
+   for (i = 0; i < iterations; i++)
+   {
+      impl->get_work_packets(data, job.packets, output, out_pitch,
+            input, width, height, in_pitch);
+
+      video_frame_jobs_run(jobs, check_job, &job, threads);
+   }
+
+   free(job.packets);
+   return (cpu_features_get_time_usec() - start) / 1000000.0;
+}
+
+static int check_preset(const char *path, struct check_frame **frames,
+      unsigned num_frames, unsigned iterations, video_frame_jobs_t *jobs)
+{
+   unsigned i, f, fmt;
+   char name[64];
+   /* One more run for the fastest kernels on the pool */
+   softfilter_simd_mask_t simd[ARRAY_SIZE(check_backends) + 1];
+   unsigned num_simd           = 1;
+   unsigned num_runs           = 0;
+   const struct softfilter_implementation *impl = NULL;
+   uint64_t features           = cpu_features_get();
+   config_file_t *conf         = config_file_new_from_path_to_string(path);
+   int mismatches              = 0;
+
+   if (!conf || !config_get_array(conf, "filter", name, sizeof(name)))
+   {
+      printf("%s: could not read preset\n", path);
+      if (conf)
+         config_file_free(conf);
+      return 1;
+   }
+
+   for (i = 0; i < ARRAY_SIZE(check_plugs); i++)
+   {
+      const struct softfilter_implementation *plug =
+         check_plugs[i]((softfilter_simd_mask_t)features);
+      if (string_is_equal(plug->short_ident, name))
+         impl = plug;
+   }
+
+   if (!impl)
+   {
+      printf("%s: unknown filter '%s'\n", path, name);
+      config_file_free(conf);
+      return 1;
+   }
+
+   /* The scalar kernels, then each backend this CPU has
+    * on its own. */
+   simd[0] = 0;
+   for (i = 1; i < ARRAY_SIZE(check_backends); i++)
+      if (features & check_backends[i].simd)
+         simd[num_simd++] = check_backends[i].simd;
+
+   num_runs       = num_simd + 1;
+   simd[num_simd] = simd[num_simd - 1];
+
+   for (fmt = SOFTFILTER_FMT_RGB565; fmt <= SOFTFILTER_FMT_XRGB8888; fmt <<= 1)
+   {
+      double totals[ARRAY_SIZE(check_backends) + 1] = {0};
+      unsigned bands                                = 1;
+
+      if (!(impl->query_input_formats() & fmt))
+         continue;
+
+      for (f = 0; f < num_frames; f++)
+      {
+         unsigned y, out_width, out_height, out_fmt;
+         size_t in_pitch, out_pitch, row_bytes;
+         void *in_buffer;
+         uint8_t *out[ARRAY_SIZE(check_backends) + 1];
+         void *data[ARRAY_SIZE(check_backends) + 1];
+         const struct check_frame *frame = frames[f];
+         void *input  = frame_to_input(frame, fmt, &in_buffer, &in_pitch);
+
+         bands = video_frame_jobs_bands(jobs, frame->height,
+               frame->width * sizeof(uint32_t) * 5);
+
+         for (i = 0; i < num_runs; i++)
+            data[i] = check_create(impl, conf, fmt,
+                  frame->width, frame->height,
+                  i == num_simd ? bands : 1, simd[i]);
+
+         impl->query_output_size(data[0], &out_width, &out_height,
+               frame->width, frame->height);
+
+         out_fmt   = (impl->query_output_formats(fmt) & fmt)
+            ? fmt : SOFTFILTER_FMT_XRGB8888;
+         row_bytes = out_width * ((out_fmt == SOFTFILTER_FMT_RGB565)
+               ? SOFTFILTER_BPP_RGB565 : SOFTFILTER_BPP_XRGB8888);
+         out_pitch = row_bytes;
+
+         for (i = 0; i < num_runs; i++)
+         {
+            out[i]     = (uint8_t*)calloc(out_height, out_pitch);
+            totals[i] += check_run(impl, data[i],
+                  i == num_simd ? jobs : NULL, out[i], out_pitch,
+                  input, in_pitch, frame->width, frame->height, iterations);
+         }
+
+         for (i = 1; i < num_runs; i++)
+         {
+            for (y = 0; y < out_height; y++)
+            {
+               if (memcmp(out[0] + y * out_pitch, out[i] + y * out_pitch,
+                        row_bytes))
+               {
+                  printf("%s (%s, %s, %s%s): mismatch in output row %u\n",
+                        path_basename(path), frame->name,
+                        fmt == SOFTFILTER_FMT_RGB565 ? "RGB565" : "XRGB8888",
+                        check_backend_name(simd[i]),
+                        i == num_simd ? " on the pool" : "", y);
+                  mismatches++;
+                  break;
+               }
+            }
+         }
+
+         for (i = 0; i < num_runs; i++)
+         {
+            impl->destroy(data[i]);
+            free(out[i]);
+         }
+         free(in_buffer);
+      }
+
+      printf("%-32s %-8s", path_basename(path),
+            fmt == SOFTFILTER_FMT_RGB565 ? "RGB565" : "XRGB8888");
+      for (i = 0; i < num_runs; i++)
+      {
+         if (i == num_simd)
+            printf(" | %u bands on %u threads", bands,
+                  video_frame_jobs_num_threads(jobs));
+         printf(" %s %7.3f ms", check_backend_name(simd[i]),
+               totals[i] * 1000.0 / (num_frames * iterations));
+         if (i > 0)
+            printf(" (%.2fx)", totals[i] > 0.0 ? totals[0] / totals[i] : 0.0);
+      }
+      printf("\n");
+   }
+
+   config_file_free(conf);
+   return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+   int i;
+   struct check_frame *frames[CHECK_MAX_FRAMES];
+   video_frame_jobs_t *jobs = NULL;
+   unsigned num_frames      = 0;
+   unsigned iterations      = 20;
+   unsigned threads         = 0;
+   int mismatches           = 0;
+
+   for (i = 1; i < argc - 1 && argv[i][0] == '-'; i += 2)
+   {
+      if (!strcmp(argv[i], "-n"))
+         iterations = (unsigned)strtoul(argv[i + 1], NULL, 0);
+      else if (!strcmp(argv[i], "-t"))
+         threads = (unsigned)strtoul(argv[i + 1], NULL, 0);
+      else if (!strcmp(argv[i], "-f") && num_frames < CHECK_MAX_FRAMES)
+      {
+         if (!(frames[num_frames] = load_ppm(argv[i + 1])))
+         {
+            printf("Could not read frame '%s'\n", argv[i + 1]);
+            return 1;
+         }
+         num_frames++;
+      }
+      else
+         break;
+   }
+
+   if (i >= argc || iterations == 0)
+   {
+      printf("Usage: %s [-n <iterations>] [-t <threads>] [-f <frame.ppm>]... <preset.filt>...\n",
+            argv[0]);
+      return 1;
+   }
+
+   if (num_frames == 0)
+   {
+      frames[num_frames++] = make_pixel_art();
+      frames[num_frames++] = make_noise(4);
+      frames[num_frames++] = make_noise(0);
+   }
+
+   jobs = video_frame_jobs_new(threads);
+
+   for (; i < argc; i++)
+      mismatches += check_preset(argv[i], frames, num_frames,
+            iterations, jobs);
+
+   video_frame_jobs_free(jobs);
+
+   for (i = 0; i < (int)num_frames; i++)
+   {
+      free(frames[i]->pixels);
+      free(frames[i]);
+   }
+
+   if (mismatches)
+      printf("%d mismatches\n", mismatches);
+
+   return mismatches ? 1 : 0;
+}
@@ -462,7 +462,7 @@ void cb_http_task_core_updater_download(
    if (!data || !transf)
       goto finish;
 
-   if (!data->data || string_is_empty(transf->path))
+   if (string_is_empty(transf->path))
       goto finish;
 
    download_handle = (core_updater_download_handle_t*)transf->user_data;
@@ -479,16 +479,11 @@ void cb_http_task_core_updater_download(
    download_handle->http_task_complete       = true;
    download_handle->decompress_task_complete = true;
 
-   /* Create output directory, if required */
+   /* Output directory was created before the transfer
+    * was pushed, see CORE_UPDATER_DOWNLOAD_BEGIN */
    strlcpy(output_dir, transf->path, sizeof(output_dir));
    path_basedir_wrapper(output_dir);
 
-   if (!path_mkdir(output_dir))
-   {
-      err = msg_hash_to_str(MSG_FAILED_TO_CREATE_THE_DIRECTORY);
-      goto finish;
-   }
-
 #ifdef HAVE_COMPRESSION
    /* If core file is an archive, make sure it is
     * not being decompressed already (by another task) */
@@ -502,12 +497,8 @@ void cb_http_task_core_updater_download(
    }
 #endif
 
-   /* Write core file to disk */
-   if (!filestream_write_file(transf->path, data->data, data->len))
-   {
-      err = "Write failed.";
-      goto finish;
-   }
+   /* Core file has already been streamed to disk
+    * by the HTTP task */
 
 #if defined(HAVE_COMPRESSION) && defined(HAVE_ZLIB)
    /* Decompress core file, if required
@@ -598,8 +589,11 @@ static void task_core_updater_download_handler(retro_task_t *task)
    {
       case CORE_UPDATER_DOWNLOAD_BEGIN:
          {
+            char output_dir[PATH_MAX_LENGTH];
             file_transfer_t *transf = NULL;
 
+            output_dir[0] = '\0';
+
             /* Check CRC of existing core, if required */
             if (download_handle->check_crc)
                download_handle->crc_match = local_core_matches_remote_crc(
@@ -613,6 +607,18 @@ static void task_core_updater_download_handler(retro_task_t *task)
                break;
             }
 
+            /* Create output directory, if required */
+            strlcpy(output_dir, download_handle->local_download_path,
+                  sizeof(output_dir));
+            path_basedir_wrapper(output_dir);
+
+            if (!path_mkdir(output_dir))
+            {
+               RARCH_ERR("%s\n",
+                     msg_hash_to_str(MSG_FAILED_TO_CREATE_THE_DIRECTORY));
+               goto task_finished;
+            }
+
             /* Configure file transfer object */
             transf = (file_transfer_t*)calloc(1, sizeof(file_transfer_t));
 
@@ -625,9 +631,12 @@ static void task_core_updater_download_handler(retro_task_t *task)
 
             transf->user_data = (void*)download_handle;
 
-            /* Push HTTP transfer task */
-            download_handle->http_task = (retro_task_t*)task_push_http_transfer(
-                  download_handle->remote_core_path, true, NULL,
+            /* Push HTTP transfer task, the core file is
+             * written to disk as it arrives instead of
+             * being held in memory */
+            download_handle->http_task = (retro_task_t*)task_push_http_transfer_file(
+                  download_handle->remote_core_path,
+                  download_handle->local_download_path, true, NULL,
                   cb_http_task_core_updater_download, transf);
 
             /* Start waiting for HTTP transfer to complete */
@@ -27,6 +27,10 @@
 #include <streams/file_stream.h>
 #include <streams/chd_stream.h>
 #include <streams/interface_stream.h>
+#include <features/features_cpu.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 #include "tasks_internal.h"
 
 #include "../core_info.h"
@@ -53,9 +57,57 @@ typedef struct database_state_handle
    char archive_name[511];
    char serial[4096];
    database_info_list_t *info;
+   database_info_index_t *index;
    struct string_list *list;
 } database_state_handle_t;
 
+/* How a file is looked up in the databases,
+ * as worked out by task_database_identify() */
+typedef struct database_scan_ident
+{
+   unsigned type;
+   uint32_t crc;
+   uint32_t archive_crc;
+   char serial[4096];
+} database_scan_ident_t;
+
+#ifdef HAVE_THREADS
+#define DATABASE_SCAN_MAX_THREADS     8
+#define DATABASE_SCAN_JOBS_PER_THREAD 4
+
+typedef struct database_scan_job
+{
+   char *path;
+   size_t list_index;
+   int ret;
+   bool done;
+   database_scan_ident_t ident;
+} database_scan_job_t;
+
+/* Reads and hashes files ahead of the scan task on a pool
+ * of worker threads. Jobs are queued and taken in database
+ * list order, so matching and playlist writes still happen
+ * one file at a time, in the same order as without the pool.
+ *
+ * 'head', 'next' and 'tail' only ever increase, jobs live
+ * in ring slot (counter % num_jobs). */
+typedef struct database_scan_pool
+{
+   sthread_t *threads[DATABASE_SCAN_MAX_THREADS];
+   slock_t *lock;
+   scond_t *work_cond;
+   scond_t *done_cond;
+   database_scan_job_t *jobs;
+   size_t num_jobs;
+   size_t head;     /* oldest job not yet taken by the scan task */
+   size_t next;     /* next job for the workers */
+   size_t tail;     /* next free slot */
+   size_t list_ptr; /* next database list entry to queue */
+   unsigned num_threads;
+   bool quit;
+} database_scan_pool_t;
+#endif
+
 typedef struct db_handle
 {
    bool pl_fuzzy_archive_match;
@@ -67,8 +119,13 @@ typedef struct db_handle
    unsigned status;
    char *playlist_directory;
    char *content_database_path;
+   char *cache_directory;
    char *fullpath;
+   retro_time_t scan_start_time;
    database_info_handle_t *handle;
+#ifdef HAVE_THREADS
+   database_scan_pool_t *scan_pool;
+#endif
    database_state_handle_t state;
 } db_handle_t;
 
@@ -135,21 +192,33 @@ static const char *database_info_get_current_element_name(
 }
 
 static int task_database_iterate_start(retro_task_t *task,
+      db_handle_t *_db,
       database_info_handle_t *db,
       const char *name)
 {
    char msg[256];
    const char *basename_path = !string_is_empty(name) ?
       path_basename(name) : "";
+   retro_time_t elapsed      = cpu_features_get_time_usec()
+      - _db->scan_start_time;
 
    msg[0] = '\0';
 
-   snprintf(msg, sizeof(msg),
-         STRING_REP_USIZE "/" STRING_REP_USIZE ": %s %s...\n",
-         (size_t)db->list_ptr,
-         (size_t)db->list->size,
-         msg_hash_to_str(MSG_SCANNING),
-         basename_path);
+   if (db->list_ptr > 0 && elapsed > 0)
+      snprintf(msg, sizeof(msg),
+            STRING_REP_USIZE "/" STRING_REP_USIZE ": %s %s... (%.1f files/s)\n",
+            (size_t)db->list_ptr,
+            (size_t)db->list->size,
+            msg_hash_to_str(MSG_SCANNING),
+            basename_path,
+            (double)db->list_ptr * 1000000.0 / (double)elapsed);
+   else
+      snprintf(msg, sizeof(msg),
+            STRING_REP_USIZE "/" STRING_REP_USIZE ": %s %s...\n",
+            (size_t)db->list_ptr,
+            (size_t)db->list->size,
+            msg_hash_to_str(MSG_SCANNING),
+            basename_path);
 
    if (!string_is_empty(msg))
    {
@@ -512,7 +581,7 @@ static bool task_database_chd_get_crc(const char *name, uint32_t *crc)
 }
 
 static void task_database_cue_prune(database_info_handle_t *db,
-      const char *name)
+      const char *name, size_t start)
 {
    size_t i;
    char       *path = (char *)malloc(PATH_MAX_LENGTH + 1);
@@ -524,7 +593,7 @@ static void task_database_cue_prune(database_info_handle_t *db,
 
    while (cue_next_file(fd, name, path, PATH_MAX_LENGTH))
    {
-      for (i = db->list_ptr; i < db->list->size; ++i)
+      for (i = start; i < db->list->size; ++i)
       {
          if (db->list->elems[i].data
                && string_is_equal(path, db->list->elems[i].data))
@@ -545,7 +614,8 @@ end:
    free(path);
 }
 
-static void gdi_prune(database_info_handle_t *db, const char *name)
+static void gdi_prune(database_info_handle_t *db, const char *name,
+      size_t start)
 {
    size_t i;
    char       *path = (char *)malloc(PATH_MAX_LENGTH + 1);
@@ -557,7 +627,7 @@ static void gdi_prune(database_info_handle_t *db, const char *name)
 
    while (gdi_next_file(fd, name, path, PATH_MAX_LENGTH))
    {
-      for (i = db->list_ptr; i < db->list->size; ++i)
+      for (i = start; i < db->list->size; ++i)
       {
          if (db->list->elems[i].data
                && string_is_equal(path, db->list->elems[i].data))
@@ -618,73 +688,339 @@ static enum msg_file_type extension_to_file_type(const char *ext)
    return FILE_TYPE_NONE;
 }
 
-static int task_database_iterate_playlist(
-      database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name)
+/* Works out how the file should be looked up and reads
+ * its crc or serial. Only writes to 'ident', so this
+ * can run on a scan worker thread.
+ * Returns 0 if the file can't be looked up. */
+static int task_database_identify(const char *name,
+      database_scan_ident_t *ident)
 {
    switch (extension_to_file_type(path_get_extension(name)))
    {
       case FILE_TYPE_COMPRESSED:
 #ifdef HAVE_COMPRESSION
-         database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
+         ident->type = DATABASE_TYPE_CRC_LOOKUP;
          /* first check crc of archive itself */
          return intfstream_file_get_crc(name,
-               0, SIZE_MAX, &db_state->archive_crc);
+               0, SIZE_MAX, &ident->archive_crc);
 #else
          break;
 #endif
       case FILE_TYPE_CUE:
-         task_database_cue_prune(db, name);
-         db_state->serial[0] = '\0';
-         if (task_database_cue_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         if (task_database_cue_get_serial(name, ident->serial))
+            ident->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_cue_get_crc(name, &db_state->crc);
+            ident->type = DATABASE_TYPE_CRC_LOOKUP;
+            return task_database_cue_get_crc(name, &ident->crc);
          }
          break;
       case FILE_TYPE_GDI:
-         gdi_prune(db, name);
-         db_state->serial[0] = '\0';
          /* There are no serial databases, so don't bother with
             serials at the moment */
-         if (0 && task_database_gdi_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         if (0 && task_database_gdi_get_serial(name, ident->serial))
+            ident->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_gdi_get_crc(name, &db_state->crc);
+            ident->type = DATABASE_TYPE_CRC_LOOKUP;
+            return task_database_gdi_get_crc(name, &ident->crc);
          }
          break;
       /* Consider Wii WBFS files similar to ISO files. */
       case FILE_TYPE_WBFS:
       case FILE_TYPE_ISO:
-         db_state->serial[0] = '\0';
-         intfstream_file_get_serial(name, 0, SIZE_MAX, db_state->serial);
-         database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         intfstream_file_get_serial(name, 0, SIZE_MAX, ident->serial);
+         ident->type = DATABASE_TYPE_SERIAL_LOOKUP;
          break;
       case FILE_TYPE_CHD:
-         db_state->serial[0] = '\0';
-         if (task_database_chd_get_serial(name, db_state->serial))
-            database_info_set_type(db, DATABASE_TYPE_SERIAL_LOOKUP);
+         if (task_database_chd_get_serial(name, ident->serial))
+            ident->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
          {
-            database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-            return task_database_chd_get_crc(name, &db_state->crc);
+            ident->type = DATABASE_TYPE_CRC_LOOKUP;
+            return task_database_chd_get_crc(name, &ident->crc);
          }
          break;
       case FILE_TYPE_LUTRO:
-         database_info_set_type(db, DATABASE_TYPE_ITERATE_LUTRO);
+         ident->type = DATABASE_TYPE_ITERATE_LUTRO;
          break;
       default:
-         database_info_set_type(db, DATABASE_TYPE_CRC_LOOKUP);
-         return intfstream_file_get_crc(name, 0, SIZE_MAX, &db_state->crc);
+         ident->type = DATABASE_TYPE_CRC_LOOKUP;
+         return intfstream_file_get_crc(name, 0, SIZE_MAX, &ident->crc);
    }
 
    return 1;
 }
 
+static void task_database_ident_init(database_scan_ident_t *ident)
+{
+   ident->type        = DATABASE_TYPE_NONE;
+   ident->crc         = 0;
+   ident->archive_crc = 0;
+   ident->serial[0]   = '\0';
+}
+
+static void task_database_ident_apply(database_state_handle_t *db_state,
+      database_info_handle_t *db, const database_scan_ident_t *ident)
+{
+   if (ident->type != DATABASE_TYPE_NONE)
+      database_info_set_type(db, (enum database_type)ident->type);
+
+   db_state->crc         = ident->crc;
+   db_state->archive_crc = ident->archive_crc;
+   strlcpy(db_state->serial, ident->serial, sizeof(db_state->serial));
+}
+
+/* Drops the tracks referenced by cue/gdi sheets from the
+ * rest of the scan list, they are scanned via the sheet */
+static void task_database_prune(database_info_handle_t *db,
+      const char *name, size_t start)
+{
+   switch (extension_to_file_type(path_get_extension(name)))
+   {
+      case FILE_TYPE_CUE:
+         task_database_cue_prune(db, name, start);
+         break;
+      case FILE_TYPE_GDI:
+         gdi_prune(db, name, start);
+         break;
+      default:
+         break;
+   }
+}
+
+#ifdef HAVE_THREADS
+static void task_database_scan_worker(void *data)
+{
+   database_scan_pool_t *pool = (database_scan_pool_t*)data;
+
+   slock_lock(pool->lock);
+
+   for (;;)
+   {
+      database_scan_job_t *job = NULL;
+
+      while (!pool->quit && pool->next == pool->tail)
+         scond_wait(pool->work_cond, pool->lock);
+
+      if (pool->quit)
+         break;
+
+      job = &pool->jobs[pool->next++ % pool->num_jobs];
+
+      slock_unlock(pool->lock);
+
+      job->ret = task_database_identify(job->path, &job->ident);
+
+      slock_lock(pool->lock);
+      job->done = true;
+      scond_signal(pool->done_cond);
+   }
+
+   slock_unlock(pool->lock);
+}
+
+static void task_database_scan_pool_free(database_scan_pool_t *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   if (pool->lock)
+   {
+      slock_lock(pool->lock);
+      pool->quit = true;
+      if (pool->work_cond)
+         scond_broadcast(pool->work_cond);
+      slock_unlock(pool->lock);
+   }
+
+   for (i = 0; i < pool->num_threads; i++)
+      sthread_join(pool->threads[i]);
+
+   if (pool->jobs)
+   {
+      for (; pool->head != pool->tail; pool->head++)
+      {
+         database_scan_job_t *job = &pool->jobs[pool->head % pool->num_jobs];
+         if (job->path)
+            free(job->path);
+      }
+      free(pool->jobs);
+   }
+
+   if (pool->work_cond)
+      scond_free(pool->work_cond);
+   if (pool->done_cond)
+      scond_free(pool->done_cond);
+   if (pool->lock)
+      slock_free(pool->lock);
+
+   free(pool);
+}
+
+static database_scan_pool_t *task_database_scan_pool_new(unsigned num_threads)
+{
+   unsigned i;
+   database_scan_pool_t *pool = (database_scan_pool_t*)
+      calloc(1, sizeof(*pool));
+
+   if (!pool)
+      return NULL;
+
+   if (num_threads > DATABASE_SCAN_MAX_THREADS)
+      num_threads    = DATABASE_SCAN_MAX_THREADS;
+
+   pool->num_jobs    = num_threads * DATABASE_SCAN_JOBS_PER_THREAD;
+   pool->jobs        = (database_scan_job_t*)calloc(pool->num_jobs,
+         sizeof(*pool->jobs));
+   pool->lock        = slock_new();
+   pool->work_cond   = scond_new();
+   pool->done_cond   = scond_new();
+
+   if (!pool->jobs || !pool->lock || !pool->work_cond || !pool->done_cond)
+      goto error;
+
+   for (i = 0; i < num_threads; i++)
+   {
+      if (!(pool->threads[i] = sthread_create(
+                  task_database_scan_worker, pool)))
+         break;
+      pool->num_threads++;
+   }
+
+   if (pool->num_threads == 0)
+      goto error;
+
+   return pool;
+
+error:
+   task_database_scan_pool_free(pool);
+   return NULL;
+}
+
+/* Queues files from the database list, in list order,
+ * until the job ring is full. Runs on the scan task. */
+static void task_database_scan_pool_fill(database_scan_pool_t *pool,
+      database_info_handle_t *db)
+{
+   if (pool->list_ptr < db->list_ptr)
+      pool->list_ptr = db->list_ptr;
+
+   while (pool->list_ptr < db->list->size)
+   {
+      bool full;
+      database_scan_job_t *job = NULL;
+      size_t list_index        = pool->list_ptr;
+      const char *name         = db->list->elems[list_index].data;
+
+      slock_lock(pool->lock);
+      full = (pool->tail - pool->head) >= pool->num_jobs;
+      slock_unlock(pool->lock);
+
+      if (full)
+         break;
+
+      pool->list_ptr++;
+
+      /* Archive members are looked up by the archive's
+       * directory, pruned entries are skipped */
+      if (!name || path_contains_compressed_file(name))
+         continue;
+
+      /* Prune now rather than when the sheet is matched,
+       * so the workers never read tracks that will be
+       * dropped from the list anyway */
+      task_database_prune(db, name, list_index + 1);
+
+      /* Workers only ever see slots between 'next' and 'tail',
+       * so this one can be filled in without the lock */
+      job             = &pool->jobs[pool->tail % pool->num_jobs];
+      job->path       = strdup(name);
+      job->list_index = list_index;
+      job->ret        = 0;
+      job->done       = false;
+      task_database_ident_init(&job->ident);
+
+      slock_lock(pool->lock);
+      pool->tail++;
+      scond_signal(pool->work_cond);
+      slock_unlock(pool->lock);
+   }
+}
+
+/* Takes the prefetched result for the current file.
+ * Returns false if the file wasn't queued, in which
+ * case it has to be identified synchronously. */
+static bool task_database_scan_pool_take(database_scan_pool_t *pool,
+      database_state_handle_t *db_state,
+      database_info_handle_t *db, int *ret)
+{
+   bool found = false;
+
+   task_database_scan_pool_fill(pool, db);
+
+   slock_lock(pool->lock);
+
+   while (pool->head != pool->tail)
+   {
+      database_scan_job_t *job = &pool->jobs[pool->head % pool->num_jobs];
+
+      if (job->list_index > db->list_ptr)
+         break;
+
+      while (!job->done)
+         scond_wait(pool->done_cond, pool->lock);
+
+      pool->head++;
+
+      if (job->list_index == db->list_ptr)
+      {
+         task_database_ident_apply(db_state, db, &job->ident);
+         *ret  = job->ret;
+         found = true;
+      }
+
+      free(job->path);
+      job->path = NULL;
+
+      if (found)
+         break;
+   }
+
+   slock_unlock(pool->lock);
+
+   /* Keep the workers busy while this file is matched */
+   if (found)
+      task_database_scan_pool_fill(pool, db);
+
+   return found;
+}
+#endif
+
+static int task_database_iterate_playlist(
+      db_handle_t *_db,
+      database_state_handle_t *db_state,
+      database_info_handle_t *db, const char *name)
+{
+   int ret;
+   database_scan_ident_t ident;
+
+#ifdef HAVE_THREADS
+   if (_db->scan_pool && task_database_scan_pool_take(
+            _db->scan_pool, db_state, db, &ret))
+      return ret;
+#endif
+
+   task_database_prune(db, name, db->list_ptr);
+   task_database_ident_init(&ident);
+   ret = task_database_identify(name, &ident);
+   task_database_ident_apply(db_state, db, &ident);
+
+   return ret;
+}
+
 static int database_info_list_iterate_end_no_match(
       database_info_handle_t *db,
       database_state_handle_t *db_state,
@@ -756,8 +1092,10 @@ static int task_database_iterate_next(database_info_handle_t *db)
    return -1;
 }
 
-static int database_info_list_iterate_new(database_state_handle_t *db_state,
-      const char *query)
+/* Drops the results of the previous database and
+ * returns the name of the one to check next. */
+static const char *database_info_list_iterate_begin(
+      database_state_handle_t *db_state)
 {
    const char *new_database = database_info_get_current_name(db_state);
 
@@ -770,10 +1108,68 @@ static int database_info_list_iterate_new(database_state_handle_t *db_state,
       database_info_list_free(db_state->info);
       free(db_state->info);
    }
+   db_state->info = NULL;
+
+   return new_database;
+}
+
+static int database_info_list_iterate_new(database_state_handle_t *db_state,
+      const char *query)
+{
+   const char *new_database = database_info_list_iterate_begin(db_state);
+
    db_state->info = database_info_list_new(new_database, query);
    return 0;
 }
 
+static int database_info_list_iterate_crc(database_state_handle_t *db_state)
+{
+   char query[50];
+   const char *new_database = NULL;
+
+   if (!db_state->index)
+   {
+      query[0] = '\0';
+      snprintf(query, sizeof(query),
+            "{crc:or(b\"%08X\",b\"%08X\")}",
+            db_state->crc, db_state->archive_crc);
+      return database_info_list_iterate_new(db_state, query);
+   }
+
+   new_database = database_info_list_iterate_begin(db_state);
+   db_state->info = database_info_index_find_crc(db_state->index,
+         new_database, db_state->crc, db_state->archive_crc);
+   return 0;
+}
+
+static int database_info_list_iterate_serial(database_state_handle_t *db_state)
+{
+   const char *new_database = NULL;
+
+   if (!db_state->index)
+   {
+      char query[50];
+      char *serial_buf =
+         bin_to_hex_alloc((uint8_t*)db_state->serial, strlen(db_state->serial) * sizeof(uint8_t));
+
+      if (!serial_buf)
+         return -1;
+
+      query[0] = '\0';
+
+      snprintf(query, sizeof(query), "{'serial': b'%s'}", serial_buf);
+      database_info_list_iterate_new(db_state, query);
+
+      free(serial_buf);
+      return 0;
+   }
+
+   new_database = database_info_list_iterate_begin(db_state);
+   db_state->info = database_info_index_find_serial(db_state->index,
+         new_database, db_state->serial);
+   return 0;
+}
+
 static int database_info_list_iterate_found_match(
       db_handle_t *_db,
       database_state_handle_t *db_state,
@@ -948,10 +1344,6 @@ static int task_database_iterate_crc_lookup(
 
    if (db_state->entry_index == 0)
    {
-      char query[50];
-
-      query[0] = '\0';
-
       if (!_db->scan_without_core_match)
       {
          /* don't scan files that can't be in this database.
@@ -971,11 +1363,7 @@ static int task_database_iterate_crc_lookup(
          }
       }
 
-      snprintf(query, sizeof(query),
-            "{crc:or(b\"%08X\",b\"%08X\")}",
-            db_state->crc, db_state->archive_crc);
-
-      database_info_list_iterate_new(db_state, query);
+      database_info_list_iterate_crc(db_state);
    }
 
    if (db_state->info)
@@ -1108,19 +1496,8 @@ static int task_database_iterate_serial_lookup(
 
    if (db_state->entry_index == 0)
    {
-      char query[50];
-      char *serial_buf =
-         bin_to_hex_alloc((uint8_t*)db_state->serial, strlen(db_state->serial) * sizeof(uint8_t));
-
-      if (!serial_buf)
+      if (database_info_list_iterate_serial(db_state) != 0)
          return 1;
-
-      query[0] = '\0';
-
-      snprintf(query, sizeof(query), "{'serial': b'%s'}", serial_buf);
-      database_info_list_iterate_new(db_state, query);
-
-      free(serial_buf);
    }
 
    if (db_state->info)
@@ -1176,7 +1553,7 @@ static int task_database_iterate(
    switch (database_info_get_type(db))
    {
       case DATABASE_TYPE_ITERATE:
-         return task_database_iterate_playlist(db_state, db, name);
+         return task_database_iterate_playlist(_db, db_state, db, name);
       case DATABASE_TYPE_ITERATE_ARCHIVE:
          return task_database_iterate_playlist_archive(_db, db_state, db, name);
       case DATABASE_TYPE_ITERATE_LUTRO:
@@ -1232,7 +1609,21 @@ static void task_database_handler(retro_task_t *task)
       }
 
       if (db->handle)
+      {
          db->handle->status = DATABASE_STATUS_ITERATE_BEGIN;
+#ifdef HAVE_THREADS
+         {
+            unsigned num_cores = cpu_features_get_core_amount();
+
+            /* Not worth it for a single file, and on a single
+             * core the hand-off only adds context switches */
+            if (db->handle->list->size > 1 && num_cores > 1)
+               db->scan_pool = task_database_scan_pool_new(num_cores);
+         }
+#endif
+      }
+
+      db->scan_start_time = cpu_features_get_time_usec();
    }
 
    dbinfo  = db->handle;
@@ -1293,6 +1684,12 @@ static void task_database_handler(retro_task_t *task)
                }
             }
          }
+
+         /* Lookup tables are built per database on first use
+          * and shared by every file of this scan */
+         if (dbstate && !dbstate->index)
+            dbstate->index = database_info_index_new(db->cache_directory);
+
          dbinfo->status = DATABASE_STATUS_ITERATE_START;
          break;
       case DATABASE_STATUS_ITERATE_START:
@@ -1300,7 +1697,7 @@ static void task_database_handler(retro_task_t *task)
          task_database_cleanup_state(dbstate);
          dbstate->list_index  = 0;
          dbstate->entry_index = 0;
-         task_database_iterate_start(task, dbinfo, name);
+         task_database_iterate_start(task, db, dbinfo, name);
          break;
       case DATABASE_STATUS_ITERATE:
          if (task_database_iterate(db, dbstate, dbinfo) == 0)
@@ -1348,14 +1745,21 @@ task_finished:
    {
       if (dbstate->list)
          dir_list_free(dbstate->list);
+      if (dbstate->index)
+         database_info_index_free(dbstate->index);
    }
 
    if (db)
    {
+#ifdef HAVE_THREADS
+      task_database_scan_pool_free(db->scan_pool);
+#endif
       if (!string_is_empty(db->playlist_directory))
          free(db->playlist_directory);
       if (!string_is_empty(db->content_database_path))
          free(db->content_database_path);
+      if (db->cache_directory)
+         free(db->cache_directory);
       if (!string_is_empty(db->fullpath))
          free(db->fullpath);
       if (db->state.buf)
@@ -1407,6 +1811,7 @@ bool task_push_dbscan(
    db->scan_without_core_match = settings->bools.scan_without_core_match;
    db->pl_fuzzy_archive_match  = settings->bools.playlist_fuzzy_archive_match;
    db->pl_use_old_format       = settings->bools.playlist_use_old_format;
+   db->cache_directory         = strdup(settings->paths.directory_cache);
 #else
    db->pl_fuzzy_archive_match  = false;
    db->pl_use_old_format       = false;
@@ -1418,6 +1823,8 @@ bool task_push_dbscan(
    db->playlist_directory      = strdup(playlist_directory);
    db->content_database_path   = strdup(content_database);
 
+   t->priority                 = TASK_PRIORITY_LOW;
+
    task_queue_push(t);
 
    return true;
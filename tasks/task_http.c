@@ -19,9 +19,15 @@
 #include <string/stdstring.h>
 #include <compat/strl.h>
 #include <file/file_path.h>
+#include <streams/file_stream.h>
+#include <features/features_cpu.h>
 #include <net/net_compat.h>
 #include <retro_timers.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #ifdef RARCH_INTERNAL
 #include "../gfx/video_display_server.h"
 #endif
@@ -54,13 +60,202 @@ struct http_handle
    } connection;
    struct http_t *handle;
    transfer_cb_t  cb;
+   /* Set for transfers streamed to disk, see
+    * task_push_http_transfer_file(). The body goes to
+    * 'path' with ".part" appended until it is complete. */
+   char *path;
+   RFILE *file;
    unsigned status;
    bool error;
+   /* The connection came from http_pool */
+   bool reused;
 };
 
 typedef struct http_transfer_info http_transfer_info_t;
 typedef struct http_handle http_handle_t;
 
+/* Idle keep-alive connections, most servers drop
+ * them after a few seconds of inactivity.
+ *
+ * Task handlers may run on several workers at once,
+ * so the pool is only used while http_pool_lock exists,
+ * see task_http_pool_init(). */
+#define HTTP_POOL_SIZE      8
+#define HTTP_POOL_IDLE_USEC (5 * 1000000)
+
+static struct
+{
+   struct http_t *handle;
+   retro_time_t  since;
+} http_pool[HTTP_POOL_SIZE];
+
+#ifdef HAVE_THREADS
+static slock_t *http_pool_lock = NULL;
+#else
+static bool     http_pool_lock = false;
+#endif
+
+void task_http_pool_init(void)
+{
+#ifdef HAVE_THREADS
+   if (!http_pool_lock)
+      http_pool_lock = slock_new();
+#else
+   http_pool_lock    = true;
+#endif
+}
+
+void task_http_pool_deinit(void)
+{
+   unsigned i;
+
+   for (i = 0; i < HTTP_POOL_SIZE; i++)
+   {
+      if (http_pool[i].handle)
+         net_http_delete(http_pool[i].handle);
+      http_pool[i].handle = NULL;
+   }
+
+#ifdef HAVE_THREADS
+   if (http_pool_lock)
+      slock_free(http_pool_lock);
+   http_pool_lock = NULL;
+#else
+   http_pool_lock = false;
+#endif
+}
+
+/* Takes an idle connection to the host of 'conn' out of the pool */
+static struct http_t *task_http_pool_acquire(struct http_connection_t *conn)
+{
+   unsigned i;
+   struct http_t *handle = NULL;
+   retro_time_t now      = cpu_features_get_time_usec();
+
+   if (!http_pool_lock)
+      return NULL;
+
+#ifdef HAVE_THREADS
+   slock_lock(http_pool_lock);
+#endif
+   for (i = 0; i < HTTP_POOL_SIZE; i++)
+   {
+      if (!http_pool[i].handle)
+         continue;
+
+      if (now - http_pool[i].since > HTTP_POOL_IDLE_USEC)
+      {
+         net_http_delete(http_pool[i].handle);
+         http_pool[i].handle = NULL;
+      }
+      else if (!handle && net_http_connection_matches(
+               conn, http_pool[i].handle))
+      {
+         handle              = http_pool[i].handle;
+         http_pool[i].handle = NULL;
+      }
+   }
+#ifdef HAVE_THREADS
+   slock_unlock(http_pool_lock);
+#endif
+
+   return handle;
+}
+
+/* Parks a finished keep-alive connection, evicting the
+ * longest idle one if the pool is full */
+static void task_http_pool_release(struct http_t *handle)
+{
+   unsigned i;
+   unsigned slot          = 0;
+   struct http_t *evicted = NULL;
+
+   if (!http_pool_lock)
+   {
+      net_http_delete(handle);
+      return;
+   }
+
+#ifdef HAVE_THREADS
+   slock_lock(http_pool_lock);
+#endif
+   for (i = 0; i < HTTP_POOL_SIZE; i++)
+   {
+      if (!http_pool[i].handle)
+      {
+         slot = i;
+         break;
+      }
+      if (http_pool[i].since < http_pool[slot].since)
+         slot = i;
+   }
+
+   evicted                = http_pool[slot].handle;
+   http_pool[slot].handle = handle;
+   http_pool[slot].since  = cpu_features_get_time_usec();
+#ifdef HAVE_THREADS
+   slock_unlock(http_pool_lock);
+#endif
+
+   if (evicted)
+      net_http_delete(evicted);
+}
+
+static bool task_http_write_file(void *userdata,
+      const void *data, size_t len)
+{
+   http_handle_t *http = (http_handle_t*)userdata;
+
+   if (!http->file)
+   {
+      char part_path[PATH_MAX_LENGTH];
+
+      strlcpy(part_path, http->path, sizeof(part_path));
+      strlcat(part_path, ".part",    sizeof(part_path));
+
+      http->file = filestream_open(part_path,
+            RETRO_VFS_FILE_ACCESS_WRITE,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+      if (!http->file)
+         return false;
+   }
+
+   return filestream_write(http->file, data, len) == (int64_t)len;
+}
+
+/* Closes the ".part" file and moves it into place on success */
+static bool task_http_finish_file(http_handle_t *http, bool success)
+{
+   char part_path[PATH_MAX_LENGTH];
+
+   strlcpy(part_path, http->path, sizeof(part_path));
+   strlcat(part_path, ".part",    sizeof(part_path));
+
+   /* Empty body, nothing was written */
+   if (success && !http->file)
+      http->file = filestream_open(part_path,
+            RETRO_VFS_FILE_ACCESS_WRITE,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!http->file)
+      return false;
+
+   filestream_close(http->file);
+   http->file = NULL;
+
+   if (success)
+   {
+      if (path_is_valid(http->path))
+         filestream_delete(http->path);
+      if (!filestream_rename(part_path, http->path))
+         return true;
+   }
+
+   filestream_delete(part_path);
+   return false;
+}
+
 static int task_http_con_iterate_transfer(http_handle_t *http)
 {
    if (!net_http_connection_iterate(http->connection.handle))
@@ -71,15 +266,15 @@ static int task_http_con_iterate_transfer(http_handle_t *http)
 static int task_http_conn_iterate_transfer_parse(
       http_handle_t *http)
 {
+   /* The connection is kept until the task finishes,
+    * in case a reused connection turns out to be dead */
    if (net_http_connection_done(http->connection.handle))
    {
       if (http->connection.handle && http->connection.cb)
          http->connection.cb(http, 0);
    }
-
-   net_http_connection_free(http->connection.handle);
-
-   http->connection.handle = NULL;
+   else
+      http->error = true;
 
    return 0;
 }
@@ -94,7 +289,18 @@ static int cb_http_conn_default(void *data_, size_t len)
    if (!network_init())
       return -1;
 
-   http->handle = net_http_new(http->connection.handle);
+   http->handle = task_http_pool_acquire(http->connection.handle);
+   http->reused = false;
+
+   if (http->handle)
+   {
+      http->handle = net_http_new_reuse(http->connection.handle,
+            http->handle);
+      http->reused = http->handle != NULL;
+   }
+
+   if (!http->handle)
+      http->handle = net_http_new(http->connection.handle);
 
    if (!http->handle)
    {
@@ -102,6 +308,9 @@ static int cb_http_conn_default(void *data_, size_t len)
       return -1;
    }
 
+   if (http->path)
+      net_http_set_write_cb(http->handle, task_http_write_file, http);
+
    http->cb     = NULL;
 
    return 0;
@@ -130,6 +339,33 @@ static int task_http_iterate_transfer(retro_task_t *task)
       return -1;
    }
 
+   /* The server may have closed an idle connection just as
+    * we reused it; try once more on a fresh one */
+   if (     http->reused
+         && net_http_status(http->handle) == -1
+         && !task_get_cancelled(task))
+   {
+      net_http_delete(http->handle);
+      http->handle = NULL;
+      http->reused = false;
+
+      /* The connection may have dropped mid-body, start the
+       * ".part" file over instead of appending to it */
+      if (http->file)
+         task_http_finish_file(http, false);
+
+      if (!(http->handle = net_http_new(http->connection.handle)))
+      {
+         http->error = true;
+         return 0;
+      }
+
+      if (http->path)
+         net_http_set_write_cb(http->handle, task_http_write_file, http);
+
+      return -1;
+   }
+
    return 0;
 }
 
@@ -170,13 +406,19 @@ task_finished:
 
    if (http->handle)
    {
-      size_t len = 0;
-      char  *tmp = (char*)net_http_data(http->handle, &len, false);
+      size_t len   = 0;
+      char  *tmp   = (char*)net_http_data(http->handle, &len, false);
+      bool  failed = net_http_error(http->handle)
+         || task_get_cancelled(task);
 
       if (tmp && http->cb)
          http->cb(tmp, len);
 
-      if (net_http_error(http->handle) || task_get_cancelled(task))
+      /* Streamed bodies are already on disk */
+      if (http->path && !task_http_finish_file(http, !failed))
+         failed = true;
+
+      if (failed)
       {
          tmp = (char*)net_http_data(http->handle, &len, true);
 
@@ -190,6 +432,12 @@ task_finished:
       }
       else
       {
+         if (http->path)
+         {
+            free(tmp);
+            tmp = NULL;
+         }
+
          data = (http_transfer_data_t*)calloc(1, sizeof(*data));
          data->data = tmp;
          data->len  = len;
@@ -197,10 +445,22 @@ task_finished:
          task_set_data(task, data);
       }
 
-      net_http_delete(http->handle);
-   } else if (http->error)
-      task_set_error(task, strdup("Internal error."));
+      if (!failed && net_http_keep_alive(http->handle))
+         task_http_pool_release(http->handle);
+      else
+         net_http_delete(http->handle);
+   }
+   else
+   {
+      if (http->path)
+         task_http_finish_file(http, false);
+      if (http->error)
+         task_set_error(task, strdup("Internal error."));
+   }
 
+   if (http->connection.handle)
+      net_http_connection_free(http->connection.handle);
+   free(http->path);
    free(http);
 }
 
@@ -246,7 +506,7 @@ static void http_transfer_progress_cb(retro_task_t *task)
 
 static void* task_push_http_transfer_generic(
       struct http_connection_t *conn,
-      const char *url, bool mute, const char *type,
+      const char *url, const char *path, bool mute, const char *type,
       retro_task_callback_t cb, void *user_data)
 {
    task_finder_data_t find_data;
@@ -280,6 +540,11 @@ static void* task_push_http_transfer_generic(
    http->connection.handle = conn;
    http->connection.cb     = &cb_http_conn_default;
 
+   net_http_connection_set_keep_alive(conn, true);
+
+   if (path && !(http->path = strdup(path)))
+      goto error;
+
    if (type)
       strlcpy(http->connection.elem1, type, sizeof(http->connection.elem1));
 
@@ -323,7 +588,10 @@ error:
    if (conn)
       net_http_connection_free(conn);
    if (http)
+   {
+      free(http->path);
       free(http);
+   }
 
    return NULL;
 }
@@ -336,7 +604,18 @@ void* task_push_http_transfer(const char *url, bool mute,
       return NULL;
    return task_push_http_transfer_generic(
          net_http_connection_new(url, "GET", NULL),
-         url, mute, type, cb, user_data);
+         url, NULL, mute, type, cb, user_data);
+}
+
+void* task_push_http_transfer_file(const char *url, const char *path,
+      bool mute, const char *type,
+      retro_task_callback_t cb, void *user_data)
+{
+   if (string_is_empty(url) || string_is_empty(path))
+      return NULL;
+   return task_push_http_transfer_generic(
+         net_http_connection_new(url, "GET", NULL),
+         url, path, mute, type, cb, user_data);
 }
 
 void* task_push_http_transfer_with_user_agent(const char *url, bool mute,
@@ -356,7 +635,7 @@ void* task_push_http_transfer_with_user_agent(const char *url, bool mute,
       net_http_connection_set_user_agent(conn, user_agent);
 
    /* assert: task_push_http_transfer_generic will free conn on failure */
-   return task_push_http_transfer_generic(conn, url, mute, type, cb, user_data);
+   return task_push_http_transfer_generic(conn, url, NULL, mute, type, cb, user_data);
 }
 
 void* task_push_http_post_transfer(const char *url,
@@ -367,7 +646,7 @@ void* task_push_http_post_transfer(const char *url,
       return NULL;
    return task_push_http_transfer_generic(
          net_http_connection_new(url, "POST", post_data),
-         url, mute, type, cb, user_data);
+         url, NULL, mute, type, cb, user_data);
 }
 
 task_retriever_info_t *http_task_get_transfer_list(void)
@@ -19,16 +19,83 @@
 #include <errno.h>
 
 #include <file/nbio.h>
+#include <file/file_path.h>
 #include <formats/image.h>
 #include <compat/strl.h>
 #include <string/stdstring.h>
+#include <streams/file_stream.h>
+#include <encodings/crc32.h>
+#include <lists/dir_list.h>
 #include <retro_miscellaneous.h>
 #include <features/features_cpu.h>
+#include <rhash.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "task_file_transfer.h"
 #include "tasks_internal.h"
 
 #include "../configuration.h"
+#include "../verbosity.h"
+
+/* Decoded (and upscaled) images are kept on disk, named
+ * after the CRC and size of the source file plus the
+ * upscale threshold and pixel format. A hit reads the
+ * pixels straight into the texture without touching
+ * the decoder. */
+#define IMAGE_CACHE_EXT        "rtex"
+#define IMAGE_CACHE_MAGIC      "RTEX"
+#define IMAGE_CACHE_VERSION    1
+/* Least recently used files are deleted past this size */
+#define IMAGE_CACHE_MAX_SIZE   (256 * 1024 * 1024)
+
+/* The header is padded to 32 bytes so that the pixels
+ * stay aligned when the file is mapped */
+typedef struct
+{
+   char     magic[4];
+   uint32_t version;
+   uint32_t width;
+   uint32_t height;
+   uint32_t src_crc;
+   uint32_t src_size;
+   uint32_t upscale_threshold;
+   uint32_t supports_rgba;
+} image_cache_header_t;
+
+#define IMAGE_CACHE_MIN_BUCKETS 256
+
+typedef struct image_cache_entry
+{
+   char *name;
+   int64_t size;
+   uint32_t hash;
+   struct image_cache_entry *hash_next;
+   struct image_cache_entry *lru_prev;
+   struct image_cache_entry *lru_next;
+} image_cache_entry_t;
+
+/* Image loads may run on several task workers at once,
+ * the cache is only used while image_cache.lock exists */
+static struct
+{
+   image_cache_entry_t **buckets;
+   size_t num_buckets;
+   size_t count;
+   /* Sentinel of the LRU list, next is the least recently used */
+   image_cache_entry_t lru;
+   int64_t total_size;
+   unsigned hits;
+   unsigned misses;
+   char dir[PATH_MAX_LENGTH];
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#else
+   bool lock;
+#endif
+} image_cache;
 
 enum image_status_enum
 {
@@ -50,11 +117,412 @@ struct nbio_image_handle
    unsigned frame_duration;
    size_t size;
    unsigned upscale_threshold;
+   /* Look up and store the decoded image in image_cache */
+   bool use_cache;
+   /* Pixels came from image_cache, already upscaled */
+   bool from_cache;
+   uint32_t src_crc;
    void *handle;
    transfer_cb_t  cb;
    struct texture_image ti;
 };
 
+static void image_cache_lock(void)
+{
+#ifdef HAVE_THREADS
+   slock_lock(image_cache.lock);
+#endif
+}
+
+static void image_cache_unlock(void)
+{
+#ifdef HAVE_THREADS
+   slock_unlock(image_cache.lock);
+#endif
+}
+
+static void image_cache_file_name(char *s, size_t len,
+      uint32_t src_crc, size_t src_size, unsigned upscale_threshold,
+      bool supports_rgba)
+{
+   snprintf(s, len, "%08x%08x-%u-%s." IMAGE_CACHE_EXT,
+         (unsigned)src_crc, (unsigned)src_size, upscale_threshold,
+         supports_rgba ? "rgba" : "argb");
+}
+
+static image_cache_entry_t *image_cache_find(const char *name)
+{
+   image_cache_entry_t *entry;
+   uint32_t hash = djb2_calculate(name);
+
+   if (!image_cache.buckets)
+      return NULL;
+
+   for (entry = image_cache.buckets[hash & (image_cache.num_buckets - 1)];
+         entry; entry = entry->hash_next)
+      if (entry->hash == hash && string_is_equal(entry->name, name))
+         return entry;
+
+   return NULL;
+}
+
+static void image_cache_lru_unlink(image_cache_entry_t *entry)
+{
+   entry->lru_prev->lru_next = entry->lru_next;
+   entry->lru_next->lru_prev = entry->lru_prev;
+}
+
+static void image_cache_lru_push(image_cache_entry_t *entry)
+{
+   entry->lru_prev                    = image_cache.lru.lru_prev;
+   entry->lru_next                    = &image_cache.lru;
+   image_cache.lru.lru_prev->lru_next = entry;
+   image_cache.lru.lru_prev           = entry;
+}
+
+/* Marks an entry as the most recently used one */
+static void image_cache_touch(image_cache_entry_t *entry)
+{
+   image_cache_lru_unlink(entry);
+   image_cache_lru_push(entry);
+}
+
+static void image_cache_remove(image_cache_entry_t *entry)
+{
+   char path[PATH_MAX_LENGTH];
+   image_cache_entry_t **prev = &image_cache.buckets[
+      entry->hash & (image_cache.num_buckets - 1)];
+
+   fill_pathname_join(path, image_cache.dir, entry->name, sizeof(path));
+   filestream_delete(path);
+
+   while (*prev != entry)
+      prev = &(*prev)->hash_next;
+   *prev = entry->hash_next;
+   image_cache_lru_unlink(entry);
+
+   image_cache.total_size -= entry->size;
+   image_cache.count--;
+   free(entry->name);
+   free(entry);
+}
+
+/* Deletes least recently used files until the
+ * cache fits the size budget */
+static void image_cache_evict(void)
+{
+   while (image_cache.total_size > IMAGE_CACHE_MAX_SIZE
+         && image_cache.lru.lru_next != &image_cache.lru)
+      image_cache_remove(image_cache.lru.lru_next);
+}
+
+static bool image_cache_grow(void)
+{
+   image_cache_entry_t *entry;
+   size_t num_buckets            = image_cache.num_buckets
+      ? image_cache.num_buckets * 2 : IMAGE_CACHE_MIN_BUCKETS;
+   image_cache_entry_t **buckets = (image_cache_entry_t**)
+      calloc(num_buckets, sizeof(*buckets));
+
+   if (!buckets)
+      return false;
+
+   for (entry = image_cache.lru.lru_next; entry != &image_cache.lru;
+         entry = entry->lru_next)
+   {
+      size_t idx       = entry->hash & (num_buckets - 1);
+      entry->hash_next = buckets[idx];
+      buckets[idx]     = entry;
+   }
+
+   free(image_cache.buckets);
+   image_cache.buckets     = buckets;
+   image_cache.num_buckets = num_buckets;
+
+   return true;
+}
+
+/* Adds a file as the most recently used one */
+static bool image_cache_add(const char *name, int64_t size)
+{
+   size_t idx;
+   image_cache_entry_t *entry;
+
+   if (image_cache.count >= image_cache.num_buckets && !image_cache_grow())
+      return false;
+
+   if (!(entry = (image_cache_entry_t*)malloc(sizeof(*entry))))
+      return false;
+
+   if (!(entry->name = strdup(name)))
+   {
+      free(entry);
+      return false;
+   }
+
+   entry->size              = size;
+   entry->hash              = djb2_calculate(name);
+   idx                      = entry->hash & (image_cache.num_buckets - 1);
+   entry->hash_next         = image_cache.buckets[idx];
+   image_cache.buckets[idx] = entry;
+   image_cache_lru_push(entry);
+
+   image_cache.count++;
+   image_cache.total_size += size;
+
+   return true;
+}
+
+/**
+ * task_image_cache_init:
+ * @dir : directory holding the decoded images.
+ *
+ * Indexes the decoded image cache in @dir. The directory
+ * is created once the first image is stored. Must be
+ * called while no image load runs.
+ **/
+void task_image_cache_init(const char *dir)
+{
+   size_t i;
+   struct dir_list *list = NULL;
+
+   task_image_cache_deinit();
+
+   if (string_is_empty(dir))
+      return;
+
+#ifdef HAVE_THREADS
+   if (!(image_cache.lock = slock_new()))
+      return;
+#else
+   image_cache.lock = true;
+#endif
+
+   strlcpy(image_cache.dir, dir, sizeof(image_cache.dir));
+
+   /* Previous sessions leave no record of use, so
+    * existing files are evicted in listing order */
+   if (     path_is_directory(dir)
+         && (list = dir_list_new_parallel(dir, IMAGE_CACHE_EXT,
+               false, false, false, false, true, 1)))
+   {
+      for (i = 0; i < list->size; i++)
+         if (list->entries[i].size > 0)
+            image_cache_add(path_basename(list->entries[i].path),
+                  list->entries[i].size);
+      dir_list_parallel_free(list);
+   }
+
+   image_cache_evict();
+}
+
+/**
+ * task_image_cache_deinit:
+ *
+ * Drops the index of the decoded image cache. The
+ * files stay on disk. Must be called while no image
+ * load runs.
+ **/
+void task_image_cache_deinit(void)
+{
+   image_cache_entry_t *entry = image_cache.lru.lru_next;
+
+   while (entry && entry != &image_cache.lru)
+   {
+      image_cache_entry_t *next = entry->lru_next;
+      free(entry->name);
+      free(entry);
+      entry = next;
+   }
+   free(image_cache.buckets);
+
+   image_cache.buckets      = NULL;
+   image_cache.num_buckets  = 0;
+   image_cache.count        = 0;
+   image_cache.lru.lru_prev = &image_cache.lru;
+   image_cache.lru.lru_next = &image_cache.lru;
+   image_cache.total_size   = 0;
+   image_cache.dir[0]     = '\0';
+
+#ifdef HAVE_THREADS
+   if (image_cache.lock)
+      slock_free(image_cache.lock);
+   image_cache.lock       = NULL;
+#else
+   image_cache.lock       = false;
+#endif
+}
+
+/**
+ * task_image_cache_get_stats:
+ * @hits   : number of loads served from the cache.
+ * @misses : number of cacheable loads that had to be decoded.
+ *
+ * Gets the decoded image cache counters since startup.
+ **/
+void task_image_cache_get_stats(unsigned *hits, unsigned *misses)
+{
+   *hits   = 0;
+   *misses = 0;
+
+   if (!image_cache.lock)
+      return;
+
+   image_cache_lock();
+   *hits   = image_cache.hits;
+   *misses = image_cache.misses;
+   image_cache_unlock();
+}
+
+/* Reads the decoded image for the source file in 'data'.
+ * On success the texture owns the returned pixels. */
+static bool image_cache_load(struct nbio_image_handle *image,
+      const void *data, size_t len)
+{
+   char name[64];
+   char path[PATH_MAX_LENGTH];
+   image_cache_header_t header;
+   image_cache_entry_t *entry = NULL;
+   void *buf                  = NULL;
+   int64_t buf_len            = 0;
+   size_t pixels_size;
+
+   image->src_crc = encoding_crc32(0, (const uint8_t*)data, len);
+
+   image_cache_file_name(name, sizeof(name),
+         image->src_crc, len, image->upscale_threshold,
+         image->ti.supports_rgba);
+
+   image_cache_lock();
+   if ((entry = image_cache_find(name)))
+      image_cache_touch(entry);
+   else
+      image_cache.misses++;
+   image_cache_unlock();
+
+   if (!entry)
+      return false;
+
+   fill_pathname_join(path, image_cache.dir, name, sizeof(path));
+
+   if (!filestream_read_file(path, &buf, &buf_len))
+      goto error;
+
+   if ((size_t)buf_len < sizeof(header))
+      goto error;
+
+   memcpy(&header, buf, sizeof(header));
+   pixels_size = (size_t)header.width * header.height * sizeof(uint32_t);
+
+   if (     memcmp(header.magic, IMAGE_CACHE_MAGIC, sizeof(header.magic))
+         || header.version           != IMAGE_CACHE_VERSION
+         || header.src_crc           != image->src_crc
+         || header.src_size          != (uint32_t)len
+         || header.upscale_threshold != image->upscale_threshold
+         || header.supports_rgba     != (uint32_t)image->ti.supports_rgba
+         || !header.width || !header.height
+         || (size_t)buf_len          != sizeof(header) + pixels_size)
+      goto error;
+
+   /* The pixels are moved to the front of the buffer
+    * rather than copied into a new one */
+   memmove(buf, (uint8_t*)buf + sizeof(header), pixels_size);
+
+   image->ti.pixels   = (uint32_t*)buf;
+   image->ti.width    = header.width;
+   image->ti.height   = header.height;
+   image->from_cache  = true;
+
+   image_cache_lock();
+   image_cache.hits++;
+   image_cache_unlock();
+
+   return true;
+
+error:
+   free(buf);
+
+   /* Drop the damaged (or vanished) file */
+   image_cache_lock();
+   image_cache.misses++;
+   if ((entry = image_cache_find(name)))
+      image_cache_remove(entry);
+   image_cache_unlock();
+
+   return false;
+}
+
+/* Stores the decoded, upscaled image of a cache miss */
+static void image_cache_save(struct nbio_image_handle *image)
+{
+   char name[64];
+   char path[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   image_cache_header_t header;
+   RFILE *file        = NULL;
+   size_t pixels_size = (size_t)image->ti.width
+      * image->ti.height * sizeof(uint32_t);
+   bool exists        = false;
+   bool success       = false;
+
+   image_cache_file_name(name, sizeof(name),
+         image->src_crc, image->size, image->upscale_threshold,
+         image->ti.supports_rgba);
+   fill_pathname_join(path, image_cache.dir, name, sizeof(path));
+
+   /* Another worker may have decoded the same image */
+   image_cache_lock();
+   exists = image_cache_find(name) != NULL;
+   image_cache_unlock();
+
+   if (exists)
+      return;
+
+   memcpy(header.magic, IMAGE_CACHE_MAGIC, sizeof(header.magic));
+   header.version           = IMAGE_CACHE_VERSION;
+   header.width             = image->ti.width;
+   header.height            = image->ti.height;
+   header.src_crc           = image->src_crc;
+   header.src_size          = (uint32_t)image->size;
+   header.upscale_threshold = image->upscale_threshold;
+   header.supports_rgba     = image->ti.supports_rgba;
+
+   if (!path_is_directory(image_cache.dir) && !path_mkdir(image_cache.dir))
+      return;
+
+   /* Written under a temporary name, so a reader never
+    * sees a partial file */
+   snprintf(tmp_path, sizeof(tmp_path), "%s.%p", path, (void*)image);
+
+   if (!(file = filestream_open(tmp_path,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return;
+
+   success =
+         filestream_write(file, &header, sizeof(header)) == sizeof(header)
+      && filestream_write(file, image->ti.pixels, pixels_size)
+         == (int64_t)pixels_size;
+
+   filestream_close(file);
+
+   image_cache_lock();
+   if (success && !image_cache_find(name))
+   {
+      if (path_is_valid(path))
+         filestream_delete(path);
+      success = !filestream_rename(tmp_path, path)
+         && image_cache_add(name, sizeof(header) + pixels_size);
+      image_cache_evict();
+   }
+   else
+      success = false;
+   image_cache_unlock();
+
+   if (!success)
+      filestream_delete(tmp_path);
+}
+
 static int cb_image_upload_generic(void *data, size_t len)
 {
    unsigned r_shift, g_shift, b_shift, a_shift;
@@ -189,21 +657,38 @@ static void task_image_load_free(retro_task_t *task)
 static int cb_nbio_image_thumbnail(void *data, size_t len)
 {
    void *ptr                       = NULL;
+   void *handle                    = NULL;
    nbio_handle_t *nbio             = (nbio_handle_t*)data;
    struct nbio_image_handle *image = nbio  ? (struct nbio_image_handle*)nbio->data : NULL;
-   void *handle                    = image ? image_transfer_new(image->type)       : NULL;
    settings_t *settings            = config_get_ptr();
    float refresh_rate              = 0.0f;
 
-   if (!handle)
+   if (!image)
+      return -1;
+
+   ptr                             = nbio_get_ptr(nbio->handle, &len);
+
+   if (image->use_cache && image_cache.lock && ptr && len)
+   {
+      image->size                  = len;
+
+      if (image_cache_load(image, ptr, len))
+      {
+         image->status             = IMAGE_STATUS_TRANSFER;
+         image->is_blocking        = true;
+         image->is_finished        = true;
+         nbio->is_finished         = true;
+         return 0;
+      }
+   }
+
+   if (!(handle = image_transfer_new(image->type)))
       return -1;
 
    image->status                   = IMAGE_STATUS_TRANSFER;
    image->handle                   = handle;
    image->cb                       = &cb_image_thumbnail;
 
-   ptr                             = nbio_get_ptr(nbio->handle, &len);
-
    image_transfer_set_buffer_ptr(image->handle, image->type, ptr, len);
 
    /* Set image size */
@@ -333,7 +818,7 @@ bool task_image_load_handler(retro_task_t *task)
       if (img)
       {
          /* Upscale image, if required */
-         if (image->upscale_threshold > 0)
+         if (image->upscale_threshold > 0 && !image->from_cache)
          {
             if (((image->ti.width > 0) && (image->ti.height > 0)) &&
                 ((image->ti.width  < image->upscale_threshold) ||
@@ -366,6 +851,12 @@ bool task_image_load_handler(retro_task_t *task)
             }
          }
 
+         if (     image->use_cache
+               && !image->from_cache
+               && image_cache.lock
+               && image->ti.pixels)
+            image_cache_save(image);
+
          img->width         = image->ti.width;
          img->height        = image->ti.height;
          img->pixels        = image->ti.pixels;
@@ -380,8 +871,8 @@ bool task_image_load_handler(retro_task_t *task)
    return true;
 }
 
-bool task_push_image_load(const char *fullpath, 
-      bool supports_rgba, unsigned upscale_threshold,
+static bool task_push_image_load_internal(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold, bool use_cache,
       retro_task_callback_t cb, void *user_data)
 {
    nbio_handle_t             *nbio   = NULL;
@@ -431,6 +922,9 @@ bool task_push_image_load(const char *fullpath,
    image->frame_duration             = 0;
    image->size                       = 0;
    image->upscale_threshold          = upscale_threshold;
+   image->use_cache                  = use_cache;
+   image->from_cache                 = false;
+   image->src_crc                    = 0;
    image->handle                     = NULL;
 
    image->ti.width                   = 0;
@@ -468,8 +962,28 @@ bool task_push_image_load(const char *fullpath,
    t->cleanup         = task_image_load_free;
    t->callback        = cb;
    t->user_data       = user_data;
+   t->priority        = TASK_PRIORITY_HIGH;
 
    task_queue_push(t);
 
    return true;
 }
+
+bool task_push_image_load(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *user_data)
+{
+   return task_push_image_load_internal(fullpath, supports_rgba,
+         upscale_threshold, false, cb, user_data);
+}
+
+/* Same as task_push_image_load(), but goes through the
+ * decoded image cache. Meant for images that are loaded
+ * over and over, such as playlist thumbnails. */
+bool task_push_image_load_cached(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *user_data)
+{
+   return task_push_image_load_internal(fullpath, supports_rgba,
+         upscale_threshold, true, cb, user_data);
+}
@@ -26,6 +26,7 @@
 #include <lists/string_list.h>
 #include <file/file_path.h>
 #include <formats/logiqx_dat.h>
+#include <features/features_cpu.h>
 
 #include "tasks_internal.h"
 
@@ -52,10 +53,11 @@ typedef struct manual_scan_handle
 {
    manual_content_scan_task_config_t *task_config;
    playlist_t *playlist;
-   struct string_list *content_list;
+   struct dir_list *content_list;
    logiqx_dat_t *dat_file;
    size_t list_size;
    size_t list_index;
+   retro_time_t start_time;
    enum manual_scan_status status;
    bool fuzzy_archive_match;
    bool use_old_format;
@@ -81,7 +83,7 @@ static void free_manual_content_scan_handle(manual_scan_handle_t *manual_scan)
 
    if (manual_scan->content_list)
    {
-      string_list_free(manual_scan->content_list);
+      dir_list_parallel_free(manual_scan->content_list);
       manual_scan->content_list = NULL;
    }
 
@@ -166,22 +168,27 @@ static void task_manual_content_scan_handler(retro_task_t *task)
             }
 
             /* All good - can start iterating */
-            manual_scan->status = MANUAL_SCAN_ITERATE_CONTENT;
+            manual_scan->start_time = cpu_features_get_time_usec();
+            manual_scan->status     = MANUAL_SCAN_ITERATE_CONTENT;
          }
          break;
       case MANUAL_SCAN_ITERATE_CONTENT:
          {
             const char *content_path =
-                  manual_scan->content_list->elems[manual_scan->list_index].data;
+                  manual_scan->content_list->entries[manual_scan->list_index].path;
             int content_type         =
-                  manual_scan->content_list->elems[manual_scan->list_index].attr.i;
+                  manual_scan->content_list->entries[manual_scan->list_index].type;
 
             if (!string_is_empty(content_path))
             {
                const char *content_file = path_basename(content_path);
+               retro_time_t elapsed     = cpu_features_get_time_usec()
+                  - manual_scan->start_time;
                char task_title[PATH_MAX_LENGTH];
+               char rate[32];
 
                task_title[0] = '\0';
+               rate[0]       = '\0';
 
                /* Update progress display */
                task_free_title(task);
@@ -193,6 +200,15 @@ static void task_manual_content_scan_handler(retro_task_t *task)
                if (!string_is_empty(content_file))
                   strlcat(task_title, content_file, sizeof(task_title));
 
+               /* Files per second, averaged over the whole scan */
+               if (elapsed > 0)
+               {
+                  snprintf(rate, sizeof(rate), " (%.1f files/s)",
+                        (double)manual_scan->list_index * 1000000.0
+                        / (double)elapsed);
+                  strlcat(task_title, rate, sizeof(task_title));
+               }
+
                task_set_title(task, strdup(task_title));
                task_set_progress(task, (manual_scan->list_index * 100) / manual_scan->list_size);
 
@@ -318,6 +334,7 @@ bool task_push_manual_content_scan(void)
    manual_scan->dat_file            = NULL;
    manual_scan->list_size           = 0;
    manual_scan->list_index          = 0;
+   manual_scan->start_time          = 0;
    manual_scan->status              = MANUAL_SCAN_BEGIN;
    manual_scan->fuzzy_archive_match = settings->bools.playlist_fuzzy_archive_match;
    manual_scan->use_old_format      = settings->bools.playlist_use_old_format;
@@ -369,6 +386,7 @@ bool task_push_manual_content_scan(void)
    task->alternative_look        = true;
    task->progress                = 0;
    task->callback                = cb_task_manual_content_scan_refresh_menu;
+   task->priority                = TASK_PRIORITY_LOW;
 
    /* > Push task */
    task_queue_push(task);
@@ -436,6 +436,8 @@ bool task_push_pl_thumbnail_download(
    pl_thumb->type_idx            = 1;
    pl_thumb->overwrite           = false;
    pl_thumb->status              = PL_THUMB_BEGIN;
+
+   task->priority                = TASK_PRIORITY_LOW;
    
    task_queue_push(task);
    
@@ -56,6 +56,19 @@ typedef struct
 void *task_push_http_transfer(const char *url, bool mute, const char *type,
       retro_task_callback_t cb, void *userdata);
 
+/* Sets up and tears down the pool of idle keep-alive
+ * connections. Must be called while no HTTP task runs. */
+void task_http_pool_init(void);
+
+void task_http_pool_deinit(void);
+
+/* Like task_push_http_transfer(), but writes the body to 'path'
+ * as it arrives. The callback gets a http_transfer_data_t with
+ * 'data' set to NULL and 'len' set to the size written. */
+void *task_push_http_transfer_file(const char *url, const char *path,
+      bool mute, const char *type,
+      retro_task_callback_t cb, void *userdata);
+
 void *task_push_http_transfer_with_user_agent(const char *url, bool mute, const char *type,
       const char* user_agent, retro_task_callback_t cb, void *userdata);
 
@@ -100,6 +113,16 @@ bool task_push_image_load(const char *fullpath,
       bool supports_rgba, unsigned upscale_threshold,
       retro_task_callback_t cb, void *userdata);
 
+bool task_push_image_load_cached(const char *fullpath,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *userdata);
+
+void task_image_cache_init(const char *dir);
+
+void task_image_cache_deinit(void);
+
+void task_image_cache_get_stats(unsigned *hits, unsigned *misses);
+
 #ifdef HAVE_LIBRETRODB
 bool task_push_dbscan(
       const char *playlist_directory,
@@ -14,11 +14,14 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 
 #include "compat/getopt.h"
 #include "net/net_socket.h"
@@ -91,6 +94,22 @@ static size_t payload_size;
  * recorded */
 static uint32_t frame_offset = 0;
 
+/* A spectator of a load test */
+struct spectator
+{
+   int fd;
+
+   /* The command being read, and how much of it we have */
+   uint32_t header[2];
+   uint32_t *buf;
+   size_t buf_size, got;
+
+   /* Latest frame the server told us about */
+   uint32_t frame;
+
+   bool stalled, dropped;
+};
+
 /* Usage statement */
 void usage()
 {
@@ -104,9 +123,269 @@ void usage()
       "    -a|--ahead <frames>:  Number of frames by which to play ahead of the\n"
       "                          server. Tests rewind if negative, catch-up if\n"
       "                          positive.\n"
+      "    -s|--spectators <n>:  Load test: join as n spectators which read\n"
+      "                          everything, and report how they keep up.\n"
+      "    -S|--stalled <n>:     Of those, n stop reading once joined, to test\n"
+      "                          that the server drops them.\n"
+      "    -d|--duration <sec>:  Length of the load test. Defaults to 10.\n"
       "\n");
 }
 
+/* Connect and go through the handshake up to the server's INFO, which
+ * is left in the payload */
+static void handshake_start(struct addrinfo *addr)
+{
+   if (socket_connect(sock, addr, false) < 0)
+   {
+      perror("connect");
+      exit(1);
+   }
+
+   /* Expect the header */
+   if (!socket_receive_all_blocking(sock, payload, 6*sizeof(uint32_t)))
+   {
+      fprintf(stderr, "Failed to receive connection header.\n");
+      exit(1);
+   }
+
+   /* If it needs a password, too bad! */
+   if (payload[3])
+   {
+      fprintf(stderr, "Password required but unsupported.\n");
+      exit(1);
+   }
+
+   /* Echo the connection header back */
+   socket_send_all_blocking(sock, payload, 6*sizeof(uint32_t), true);
+
+   /* Send a nickname */
+   cmd = NETPLAY_CMD_NICK;
+   cmd_size = 32;
+   strcpy((char *) payload, "RANetplayer");
+   SEND();
+
+   /* Receive (and ignore) the nickname */
+   RECV();
+
+   /* Receive INFO */
+   RECV();
+   if (cmd != NETPLAY_CMD_INFO)
+   {
+      fprintf(stderr, "Failed to receive INFO.");
+      exit(1);
+   }
+}
+
+/* Read whatever a spectator has, returns the number of bytes */
+static size_t spectator_read(struct spectator *spec)
+{
+   size_t total = 0;
+
+   while (!spec->dropped)
+   {
+      ssize_t rd;
+      uint8_t *dst;
+      size_t want;
+
+      if (spec->got < sizeof(spec->header))
+      {
+         dst  = (uint8_t *) spec->header + spec->got;
+         want = sizeof(spec->header) - spec->got;
+      }
+      else
+      {
+         size_t size = ntohl(spec->header[1]);
+         if (size > spec->buf_size)
+         {
+            spec->buf = realloc(spec->buf, size);
+            if (!spec->buf)
+            {
+               perror("realloc");
+               exit(1);
+            }
+            spec->buf_size = size;
+         }
+         dst  = (uint8_t *) spec->buf + spec->got - sizeof(spec->header);
+         want = size - (spec->got - sizeof(spec->header));
+      }
+
+      if (want)
+      {
+         rd = recv(spec->fd, dst, want, 0);
+         if (rd == 0 || (rd < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+         {
+            spec->dropped = true;
+            break;
+         }
+         if (rd < 0)
+            break;
+         spec->got += rd;
+         total     += rd;
+      }
+
+      /* A whole command, keep track of the frame */
+      if (spec->got >= sizeof(spec->header) &&
+          spec->got == sizeof(spec->header) + ntohl(spec->header[1]))
+      {
+         switch (ntohl(spec->header[0]))
+         {
+            case NETPLAY_CMD_INPUT:
+            case NETPLAY_CMD_NOINPUT:
+            case NETPLAY_CMD_CRC:
+               if (ntohl(spec->header[1]) >= sizeof(uint32_t) &&
+                   ntohl(spec->buf[0]) > spec->frame)
+                  spec->frame = ntohl(spec->buf[0]);
+               break;
+         }
+         spec->got = 0;
+      }
+   }
+
+   return total;
+}
+
+/* Join as many spectators, read for a while and report */
+static int spectate(struct addrinfo *addr, const char *host, int port,
+   unsigned count, unsigned stalled, unsigned duration)
+{
+   unsigned i, n, rounds, seconds = 0;
+   uint64_t bytes         = 0;
+   uint32_t max_lag       = 0;
+   time_t start, last;
+   struct spectator *specs = calloc(count, sizeof(*specs));
+   struct pollfd *fds      = calloc(count, sizeof(*fds));
+
+   if (!specs || !fds)
+   {
+      perror("calloc");
+      return 1;
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      if ((sock = socket_init((void **) &addr, port, host,
+            SOCKET_PROTOCOL_TCP)) < 0)
+      {
+         perror("socket");
+         return 1;
+      }
+
+      handshake_start(addr);
+
+      /* Echo the INFO and receive SYNC */
+      SEND();
+      RECV();
+
+      specs[i].fd      = sock;
+      specs[i].frame   = ntohl(payload[0]);
+      specs[i].stalled = i < stalled;
+      socket_nonblock(sock);
+   }
+
+   printf("%u spectators joined, %u stalled\n", count, stalled);
+   start = last = time(NULL);
+
+   while (seconds < duration)
+   {
+      uint32_t lo = (uint32_t) -1, hi = 0;
+      unsigned dropped = 0;
+
+      /* Stalled spectators are only watched for the server hanging up */
+      for (i = 0; i < count; i++)
+      {
+         fds[i].fd      = specs[i].dropped ? -1 : specs[i].fd;
+#ifdef POLLRDHUP
+         fds[i].events  = specs[i].stalled ? POLLRDHUP : POLLIN;
+#else
+         fds[i].events  = specs[i].stalled ? 0 : POLLIN;
+#endif
+         fds[i].revents = 0;
+      }
+
+      if (poll(fds, count, 100) < 0 && errno != EINTR)
+      {
+         perror("poll");
+         return 1;
+      }
+
+      for (i = 0; i < count; i++)
+      {
+         if (!fds[i].revents)
+            continue;
+         if (specs[i].stalled)
+            specs[i].dropped = true;
+         else
+            bytes += spectator_read(&specs[i]);
+      }
+
+      if (time(NULL) == last)
+         continue;
+      last    = time(NULL);
+      seconds = (unsigned) (last - start);
+
+      for (i = 0, n = 0; i < count; i++)
+      {
+         if (specs[i].dropped)
+         {
+            dropped++;
+            continue;
+         }
+         if (specs[i].stalled)
+            continue;
+         if (specs[i].frame < lo)
+            lo = specs[i].frame;
+         if (specs[i].frame > hi)
+            hi = specs[i].frame;
+         n++;
+      }
+
+      if (n && hi - lo > max_lag)
+         max_lag = hi - lo;
+
+      printf("%3us: %u reading, %u dropped, frame %u, spread %u frames, "
+            "%.1f KB/s\n",
+            seconds, n, dropped, n ? hi : 0, n ? hi - lo : 0,
+            bytes / 1024.0 / (seconds ? seconds : 1));
+   }
+
+   /* A stalled spectator only sees the server hang up once it has read
+    * what was sent before, so drain them for a moment */
+   for (rounds = 0; rounds < 100; rounds++)
+   {
+      for (i = 0, n = 0; i < count; i++)
+      {
+         fds[i].fd      = (specs[i].stalled && !specs[i].dropped)
+            ? specs[i].fd : -1;
+         fds[i].events  = POLLIN;
+         fds[i].revents = 0;
+         if (fds[i].fd >= 0)
+            n++;
+      }
+
+      if (!n || poll(fds, count, 100) <= 0)
+         break;
+
+      for (i = 0; i < count; i++)
+         if (fds[i].revents)
+            spectator_read(&specs[i]);
+   }
+
+   for (i = 0, n = 0; i < count; i++)
+   {
+      if (specs[i].dropped)
+         n++;
+      socket_close(specs[i].fd);
+      free(specs[i].buf);
+   }
+
+   printf("%u spectators, %u dropped, largest spread %u frames, "
+         "%.1f KB read\n", count, n, max_lag, bytes / 1024.0);
+
+   free(specs);
+   free(fds);
+   return 0;
+}
+
 /* Offset the frame in a network packet to or from network time */
 uint32_t frame_offset_cmd(bool ntoh)
 {
@@ -178,6 +457,7 @@ int main(int argc, char **argv)
       *ranp_in_file_name = NULL,
       *ranp_out_file_name = NULL;
    int port = RARCH_DEFAULT_PORT;
+   unsigned spectators = 0, stalled = 0, duration = 10;
    bool playing = false, playing_started = false,
       recording = false, recording_started = false;
    const char *optstring = NULL;
@@ -187,14 +467,17 @@ int main(int argc, char **argv)
       {"port",       1, NULL, 'P'},
       {"play",       1, NULL, 'p'},
       {"record",     1, NULL, 'r'},
-      {"ahead",      1, NULL, 'a'}
+      {"ahead",      1, NULL, 'a'},
+      {"spectators", 1, NULL, 's'},
+      {"stalled",    1, NULL, 'S'},
+      {"duration",   1, NULL, 'd'}
    };
 
    while (1)
    {
       int c;
 
-      c = getopt_long(argc, argv, "H:P:p:r:a:", opt, NULL);
+      c = getopt_long(argc, argv, "H:P:p:r:a:s:S:d:", opt, NULL);
       if (c == -1)
          break;
 
@@ -222,6 +505,18 @@ int main(int argc, char **argv)
             ahead = atoi(optarg);
             break;
 
+         case 's':
+            spectators = atoi(optarg);
+            break;
+
+         case 'S':
+            stalled = atoi(optarg);
+            break;
+
+         case 'd':
+            duration = atoi(optarg);
+            break;
+
          default:
             usage();
             return 1;
@@ -233,7 +528,7 @@ int main(int argc, char **argv)
       playing = true;
       ranp_in_file_name = argv[optind++];
    }
-   if (!playing && !recording)
+   if (!playing && !recording && !spectators)
    {
       usage();
       return 1;
@@ -248,6 +543,9 @@ int main(int argc, char **argv)
       return 1;
    }
 
+   if (spectators)
+      return spectate(addr, host, port, spectators, stalled, duration);
+
    /* Open the input file, if applicable */
    if (playing)
    {
@@ -277,45 +575,7 @@ int main(int argc, char **argv)
       return 1;
    }
 
-   if (socket_connect(sock, addr, false) < 0)
-   {
-      perror("connect");
-      return 1;
-   }
-
-   /* Expect the header */
-   if (!socket_receive_all_blocking(sock, payload, 6*sizeof(uint32_t)))
-   {
-      fprintf(stderr, "Failed to receive connection header.\n");
-      return 1;
-   }
-
-   /* If it needs a password, too bad! */
-   if (payload[3])
-   {
-      fprintf(stderr, "Password required but unsupported.\n");
-      return 1;
-   }
-
-   /* Echo the connection header back */
-   socket_send_all_blocking(sock, payload, 6*sizeof(uint32_t), true);
-
-   /* Send a nickname */
-   cmd = NETPLAY_CMD_NICK;
-   cmd_size = 32;
-   strcpy((char *) payload, "RANetplayer");
-   SEND();
-
-   /* Receive (and ignore) the nickname */
-   RECV();
-
-   /* Receive INFO */
-   RECV();
-   if (cmd != NETPLAY_CMD_INFO)
-   {
-      fprintf(stderr, "Failed to receive INFO.");
-      return 1;
-   }
+   handshake_start(addr);
 
    /* Save the INFO */
    if (recording)